@@ -28,6 +28,9 @@ struct sha256_ce_state {
 asmlinkage void sha2_ce_transform(struct sha256_ce_state *sst, u8 const *src,
 				  int blocks);
 
+asmlinkage void sha2_ce_transform2x(u32 *dg1, u32 *dg2, u8 const *src1,
+				    u8 const *src2, int blocks);
+
 static void __sha2_ce_transform(struct sha256_state *sst, u8 const *src,
 				int blocks)
 {
@@ -109,6 +112,67 @@ static int sha256_ce_final(struct shash_desc *desc, u8 *out)
 	return sha256_base_finish(desc, out);
 }
 
+/*
+ * Bound the time spent with the NEON unit claimed, sha2_ce_transform2x()
+ * does not yield by itself.
+ */
+#define SHA256_CE_2X_MAX_BLOCKS	64
+
+/*
+ * Finish two messages of the same length, starting from the same state, in
+ * one go.  Only the case with no partial data buffered is handled, which is
+ * all that callers hashing many equally sized blocks after a common,
+ * block aligned prefix need.
+ */
+static int sha256_ce_finup2x(struct shash_desc *desc, const u8 *data1,
+			     const u8 *data2, unsigned int len, u8 *out1,
+			     u8 *out2)
+{
+	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
+	unsigned int ds = crypto_shash_digestsize(desc->tfm);
+	u8 pad[2][2 * SHA256_BLOCK_SIZE];
+	unsigned int tail = len % SHA256_BLOCK_SIZE;
+	unsigned int npad = tail < SHA256_BLOCK_SIZE - sizeof(__be64) ? 1 : 2;
+	int blocks = len / SHA256_BLOCK_SIZE;
+	u64 bits = (sctx->sst.count + len) << 3;
+	u32 dg[2][SHA256_DIGEST_SIZE / 4];
+	int i;
+
+	if (sctx->sst.count % SHA256_BLOCK_SIZE || !crypto_simd_usable())
+		return -EOPNOTSUPP;
+
+	memcpy(dg[0], sctx->sst.state, sizeof(dg[0]));
+	memcpy(dg[1], sctx->sst.state, sizeof(dg[1]));
+
+	memset(pad, 0, sizeof(pad));
+	memcpy(pad[0], data1 + len - tail, tail);
+	memcpy(pad[1], data2 + len - tail, tail);
+	pad[0][tail] = pad[1][tail] = 0x80;
+	put_unaligned_be64(bits, &pad[0][npad * SHA256_BLOCK_SIZE - 8]);
+	put_unaligned_be64(bits, &pad[1][npad * SHA256_BLOCK_SIZE - 8]);
+
+	while (blocks > 0) {
+		int chunk = min(blocks, SHA256_CE_2X_MAX_BLOCKS);
+
+		kernel_neon_begin();
+		sha2_ce_transform2x(dg[0], dg[1], data1, data2, chunk);
+		kernel_neon_end();
+		data1 += chunk * SHA256_BLOCK_SIZE;
+		data2 += chunk * SHA256_BLOCK_SIZE;
+		blocks -= chunk;
+	}
+	kernel_neon_begin();
+	sha2_ce_transform2x(dg[0], dg[1], pad[0], pad[1], npad);
+	kernel_neon_end();
+
+	for (i = 0; i < ds / 4; i++) {
+		put_unaligned_be32(dg[0][i], out1 + i * 4);
+		put_unaligned_be32(dg[1][i], out2 + i * 4);
+	}
+	*sctx = (struct sha256_ce_state){};
+	return 0;
+}
+
 static int sha256_ce_export(struct shash_desc *desc, void *out)
 {
 	struct sha256_ce_state *sctx = shash_desc_ctx(desc);
@@ -148,6 +212,7 @@ static struct shash_alg algs[] = { {
 	.update			= sha256_ce_update,
 	.final			= sha256_ce_final,
 	.finup			= sha256_ce_finup,
+	.finup2x		= sha256_ce_finup2x,
 	.export			= sha256_ce_export,
 	.import			= sha256_ce_import,
 	.descsize		= sizeof(struct sha256_ce_state),
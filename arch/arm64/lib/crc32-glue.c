@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Selection between the generic, single chain and 3-way interleaved
+ * CRC32(C) routines
+ */
+
+#include <linux/crc32.h>
+#include <linux/linkage.h>
+
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/*
+ * Below this size the cost of claiming the NEON unit for the PMULL based
+ * merging of the lanes eats up most of what the interleaving gains.
+ */
+#define CRC32_3WAY_MIN_LEN	1024
+
+u32 __pure crc32_le_base(u32 crc, unsigned char const *p, size_t len);
+u32 __pure __crc32c_le_base(u32 crc, unsigned char const *p, size_t len);
+
+asmlinkage u32 crc32_le_arm64(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32c_le_arm64(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32_le_arm64_3way(u32 crc, unsigned char const *p,
+				   size_t len);
+asmlinkage u32 crc32c_le_arm64_3way(u32 crc, unsigned char const *p,
+				    size_t len);
+
+static bool crc32_use_3way(size_t len)
+{
+	return len >= CRC32_3WAY_MIN_LEN && cpu_have_named_feature(PMULL) &&
+	       may_use_simd();
+}
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!cpus_have_const_cap(ARM64_HAS_CRC32))
+		return crc32_le_base(crc, p, len);
+
+	if (crc32_use_3way(len)) {
+		kernel_neon_begin();
+		crc = crc32_le_arm64_3way(crc, p, len);
+		kernel_neon_end();
+		return crc;
+	}
+	return crc32_le_arm64(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!cpus_have_const_cap(ARM64_HAS_CRC32))
+		return __crc32c_le_base(crc, p, len);
+
+	if (crc32_use_3way(len)) {
+		kernel_neon_begin();
+		crc = crc32c_le_arm64_3way(crc, p, len);
+		kernel_neon_end();
+		return crc;
+	}
+	return crc32c_le_arm64(crc, p, len);
+}
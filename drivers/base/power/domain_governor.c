@@ -254,7 +254,7 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	struct generic_pm_domain *genpd = pd_to_genpd(pd);
 	struct cpuidle_device *dev;
 	ktime_t domain_wakeup, next_hrtimer;
-	s64 idle_duration_ns;
+	s64 idle_duration_ns, latency_req, req;
 	int cpu, i;
 
 	/* Validate dev PM QoS constraints. */
@@ -270,6 +270,7 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	 * contains a mask of all CPUs from subdomains.
 	 */
 	domain_wakeup = ktime_set(KTIME_SEC_MAX, 0);
+	latency_req = S64_MAX;
 	for_each_cpu_and(cpu, genpd->cpus, cpu_online_mask) {
 		dev = per_cpu(cpuidle_devices, cpu);
 		if (dev) {
@@ -277,6 +278,15 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 			if (ktime_before(next_hrtimer, domain_wakeup))
 				domain_wakeup = next_hrtimer;
 		}
+
+		/*
+		 * Any of the CPUs may be the one to wake up, so honour the
+		 * tightest of the latency constraints the cpuidle governors
+		 * apply to the CPU states.
+		 */
+		req = cpuidle_governor_latency_req(cpu);
+		if (req < latency_req)
+			latency_req = req;
 	}
 
 	/* The minimum idle duration is from now - until the next wakeup. */
@@ -291,6 +301,10 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	 */
 	i = genpd->state_idx;
 	do {
+		if (genpd->states[i].power_off_latency_ns +
+		    genpd->states[i].power_on_latency_ns > latency_req)
+			continue;
+
 		if (idle_duration_ns >= (genpd->states[i].residency_ns +
 		    genpd->states[i].power_off_latency_ns)) {
 			genpd->state_idx = i;
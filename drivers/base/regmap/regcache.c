@@ -9,6 +9,7 @@
 #include <linux/bsearch.h>
 #include <linux/device.h>
 #include <linux/export.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include <linux/sort.h>
 
@@ -291,11 +292,92 @@ static bool regcache_reg_needs_sync(struct regmap *map, unsigned int reg,
 	return true;
 }
 
+static int regcache_default_sync_raw_flush(struct regmap *map, void *buf,
+					   unsigned int min, unsigned int base,
+					   unsigned int cur)
+{
+	size_t val_bytes = map->format.val_bytes;
+	unsigned int count = (cur - base) / map->reg_stride;
+	unsigned int idx = (base - min) / map->reg_stride;
+	int ret;
+
+	if (!count)
+		return 0;
+
+	dev_dbg(map->dev, "Writing %zu bytes for %u registers from 0x%x-0x%x\n",
+		count * val_bytes, count, base, cur - map->reg_stride);
+
+	map->cache_bypass = true;
+	ret = _regmap_raw_write(map, base, buf + idx * val_bytes,
+				count * val_bytes);
+	map->cache_bypass = false;
+	if (ret)
+		dev_err(map->dev, "Unable to sync registers %#x-%#x. %d\n",
+			base, cur - map->reg_stride, ret);
+
+	return ret;
+}
+
+/*
+ * Coalesce the runs of contiguous registers needing a sync into raw writes,
+ * the values are formatted into a temporary buffer since caches using the
+ * default sync don't keep them in the device format.
+ */
+static int regcache_default_sync_raw(struct regmap *map, void *buf,
+				     unsigned int min, unsigned int max)
+{
+	size_t val_bytes = map->format.val_bytes;
+	unsigned int reg, base = min;
+	int ret;
+
+	for (reg = min; reg <= max; reg += map->reg_stride) {
+		unsigned int val;
+
+		if (regmap_volatile(map, reg) ||
+		    !regmap_writeable(map, reg))
+			goto flush;
+
+		ret = regcache_read(map, reg, &val);
+		if (ret)
+			return ret;
+
+		if (!regcache_reg_needs_sync(map, reg, val))
+			goto flush;
+
+		map->format.format_val(buf + ((reg - min) / map->reg_stride) *
+				       val_bytes, val, 0);
+		continue;
+flush:
+		ret = regcache_default_sync_raw_flush(map, buf, min, base, reg);
+		if (ret)
+			return ret;
+		base = reg + map->reg_stride;
+	}
+
+	return regcache_default_sync_raw_flush(map, buf, min, base, reg);
+}
+
 static int regcache_default_sync(struct regmap *map, unsigned int min,
 				 unsigned int max)
 {
 	unsigned int reg;
 
+	if (regmap_can_raw_write(map) && !map->use_single_write &&
+	    map->format.format_val) {
+		void *buf;
+		int ret;
+
+		buf = kmalloc_array((max - min) / map->reg_stride + 1,
+				    map->format.val_bytes, map->alloc_flags);
+		if (buf) {
+			ret = regcache_default_sync_raw(map, buf, min, max);
+			/* async writes still point to the buffer */
+			regmap_async_complete(map);
+			kfree(buf);
+			return ret;
+		}
+	}
+
 	for (reg = min; reg <= max; reg += map->reg_stride) {
 		unsigned int val;
 		int ret;
@@ -341,10 +423,12 @@ int regcache_sync(struct regmap *map)
 	int ret = 0;
 	unsigned int i;
 	const char *name;
+	ktime_t start;
 	bool bypass;
 
 	BUG_ON(!map->cache_ops);
 
+	start = ktime_get();
 	map->lock(map->lock_arg);
 	/* Remember the initial bypass state */
 	bypass = map->cache_bypass;
@@ -388,6 +472,8 @@ int regcache_sync(struct regmap *map)
 	regmap_async_complete(map);
 
 	trace_regcache_sync(map, name, "stop");
+	trace_regcache_sync_duration(map, name,
+				     ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	return ret;
 }
@@ -410,10 +496,12 @@ int regcache_sync_region(struct regmap *map, unsigned int min,
 {
 	int ret = 0;
 	const char *name;
+	ktime_t start;
 	bool bypass;
 
 	BUG_ON(!map->cache_ops);
 
+	start = ktime_get();
 	map->lock(map->lock_arg);
 
 	/* Remember the initial bypass state */
@@ -444,6 +532,8 @@ int regcache_sync_region(struct regmap *map, unsigned int min,
 	regmap_async_complete(map);
 
 	trace_regcache_sync(map, name, "stop region");
+	trace_regcache_sync_duration(map, name,
+				     ktime_to_ns(ktime_sub(ktime_get(), start)));
 
 	return ret;
 }
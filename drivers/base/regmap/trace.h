@@ -139,6 +139,28 @@ TRACE_EVENT(regcache_sync,
 		  __get_str(type), __get_str(status))
 );
 
+TRACE_EVENT(regcache_sync_duration,
+
+	TP_PROTO(struct regmap *map, const char *type, s64 duration_ns),
+
+	TP_ARGS(map, type, duration_ns),
+
+	TP_STRUCT__entry(
+		__string(       name,           regmap_name(map)	)
+		__string(	type,		type			)
+		__field(	s64,		duration_ns		)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, regmap_name(map));
+		__assign_str(type, type);
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("%s type=%s duration=%lldns", __get_str(name),
+		  __get_str(type), (long long)__entry->duration_ns)
+);
+
 DECLARE_EVENT_CLASS(regmap_bool,
 
 	TP_PROTO(struct regmap *map, bool flag),
@@ -526,6 +526,19 @@ static void h5_unslip_one_byte(struct h5 *h5, unsigned char c)
 	BT_DBG("unslipped 0x%02hhx, rx_pending %zu", *byte, h5->rx_pending);
 }
 
+/* Number of leading bytes of buf which unslip to themselves */
+static size_t h5_unslip_len(const unsigned char *buf, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (buf[i] == SLIP_DELIMITER || buf[i] == SLIP_ESC)
+			break;
+	}
+
+	return i;
+}
+
 static void h5_reset_rx(struct h5 *h5)
 {
 	if (h5->rx_skb) {
@@ -550,6 +563,20 @@ static int h5_recv(struct hci_uart *hu, const void *data, int count)
 		int processed;
 
 		if (h5->rx_pending > 0) {
+			size_t len = 0;
+
+			/* Copy runs of plain bytes at once */
+			if (!test_bit(H5_RX_ESC, &h5->flags))
+				len = h5_unslip_len(ptr, min_t(size_t, count,
+							      h5->rx_pending));
+			if (len) {
+				skb_put_data(h5->rx_skb, ptr, len);
+				h5->rx_pending -= len;
+
+				ptr += len; count -= len;
+				continue;
+			}
+
 			if (*ptr == SLIP_DELIMITER) {
 				bt_dev_err(hu->hdev, "Too short H5 packet");
 				h5_reset_rx(h5);
@@ -4,6 +4,7 @@
  * Author: Neil Armstrong <narmstrong@baylibre.com>
  * Copyright (C) 2014 Amlogic, Inc.
  */
+#include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/module.h>
 #include <linux/io.h>
@@ -16,6 +17,14 @@
 
 #define RNG_DATA 0x00
 
+/*
+ * The block has no ready flag and no documented generation rate. Only the
+ * first word of a read is taken right away, the following ones are paced
+ * with a conservative delay and only if the caller may wait.
+ */
+#define RNG_READ_DELAY_US	10
+#define RNG_MAX_READ		32
+
 struct meson_rng_data {
 	void __iomem *base;
 	struct platform_device *pdev;
@@ -27,10 +36,25 @@ static int meson_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 {
 	struct meson_rng_data *data =
 			container_of(rng, struct meson_rng_data, rng);
+	size_t len = 0, n;
+	u32 val;
+
+	max = min_t(size_t, max, RNG_MAX_READ);
+
+	while (len < max) {
+		if (len) {
+			if (!wait)
+				break;
+			udelay(RNG_READ_DELAY_US);
+		}
+
+		val = readl_relaxed(data->base + RNG_DATA);
+		n = min(max - len, sizeof(val));
+		memcpy(buf + len, &val, n);
+		len += n;
+	}
 
-	*(u32 *)buf = readl_relaxed(data->base + RNG_DATA);
-
-	return sizeof(u32);
+	return len;
 }
 
 static void meson_rng_clk_disable(void *data)
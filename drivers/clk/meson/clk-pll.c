@@ -222,6 +222,19 @@ static int meson_clk_get_pll_settings(unsigned long rate,
 	unsigned int i, m, n;
 	int ret;
 
+	/*
+	 * The clock framework usually asks for the same rate several times
+	 * in a row, through round_rate() then set_rate() at least. These are
+	 * all called with the prepare lock held so the last result can be
+	 * kept without further locking.
+	 */
+	if (pll->cache.n && pll->cache.rate == rate &&
+	    pll->cache.parent_rate == parent_rate) {
+		*best_m = pll->cache.m;
+		*best_n = pll->cache.n;
+		return 0;
+	}
+
 	for (i = 0, ret = 0; !ret; i++) {
 		ret = meson_clk_get_pll_get_index(rate, parent_rate,
 						  i, &m, &n, pll);
@@ -239,7 +252,15 @@ static int meson_clk_get_pll_settings(unsigned long rate,
 		}
 	}
 
-	return best ? 0 : -EINVAL;
+	if (!best)
+		return -EINVAL;
+
+	pll->cache.rate = rate;
+	pll->cache.parent_rate = parent_rate;
+	pll->cache.m = *best_m;
+	pll->cache.n = *best_n;
+
+	return 0;
 }
 
 static long meson_clk_pll_round_rate(struct clk_hw *hw, unsigned long rate,
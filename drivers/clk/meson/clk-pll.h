@@ -29,6 +29,14 @@ struct pll_mult_range {
 
 #define CLK_MESON_PLL_ROUND_CLOSEST	BIT(0)
 
+/* Last settings found for a rate, see meson_clk_get_pll_settings() */
+struct meson_clk_pll_cache {
+	unsigned long	rate;
+	unsigned long	parent_rate;
+	unsigned int	m;
+	unsigned int	n;
+};
+
 struct meson_clk_pll_data {
 	struct parm en;
 	struct parm m;
@@ -41,6 +49,7 @@ struct meson_clk_pll_data {
 	const struct pll_params_table *table;
 	const struct pll_mult_range *range;
 	u8 flags;
+	struct meson_clk_pll_cache cache;
 };
 
 extern const struct clk_ops meson_clk_pll_ro_ops;
@@ -150,7 +150,14 @@ static irqreturn_t meson6_timer_interrupt(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static int __init meson6_timer_init(struct device_node *node)
+/*
+ * On the 64bit SoCs the per-cpu arch timer provides the clocksource, the
+ * sched_clock and the delay loop, but it stops in the cluster power-down
+ * idle states. The ISA timers sit in the EE domain which stays powered in
+ * those states, so the clockevent is only registered there to serve as the
+ * tick broadcast device, allowing such states to be entered.
+ */
+static int __init meson_timer_init(struct device_node *node, bool broadcast)
 {
 	u32 val;
 	int ret, irq;
@@ -174,9 +181,12 @@ static int __init meson6_timer_init(struct device_node *node)
 			  MESON_ISA_TIMER_MUX_TIMERE_INPUT_CLOCK_1US);
 	writel(val, timer_base + MESON_ISA_TIMER_MUX);
 
-	sched_clock_register(meson6_timer_sched_read, 32, USEC_PER_SEC);
-	clocksource_mmio_init(timer_base + MESON_ISA_TIMERE, node->name,
-			      1000 * 1000, 300, 32, clocksource_mmio_readl_up);
+	if (!broadcast) {
+		sched_clock_register(meson6_timer_sched_read, 32, USEC_PER_SEC);
+		clocksource_mmio_init(timer_base + MESON_ISA_TIMERE,
+				      node->name, 1000 * 1000, 300, 32,
+				      clocksource_mmio_readl_up);
+	}
 
 	/* Timer A base 1us */
 	val &= ~MESON_ISA_TIMER_MUX_TIMERA_INPUT_CLOCK_MASK;
@@ -187,9 +197,16 @@ static int __init meson6_timer_init(struct device_node *node)
 	/* Stop the timer A */
 	meson6_clkevt_time_stop();
 
+	/* Let the broadcast code steer the interrupt to the CPU to wake */
+	if (broadcast) {
+		meson6_clockevent.rating = 300;
+		meson6_clockevent.features |= CLOCK_EVT_FEAT_DYNIRQ;
+	}
+
 	ret = request_irq(irq, meson6_timer_interrupt,
-			  IRQF_TIMER | IRQF_IRQPOLL, "meson6_timer",
-			  &meson6_clockevent);
+			  IRQF_TIMER | IRQF_IRQPOLL |
+			  (broadcast ? IRQF_NOBALANCING : 0),
+			  "meson6_timer", &meson6_clockevent);
 	if (ret) {
 		pr_warn("failed to setup irq %d\n", irq);
 		return ret;
@@ -208,5 +225,17 @@ static int __init meson6_timer_init(struct device_node *node)
 
 	return 0;
 }
+
+static int __init meson6_timer_init(struct device_node *node)
+{
+	return meson_timer_init(node, false);
+}
 TIMER_OF_DECLARE(meson6, "amlogic,meson6-timer",
 		       meson6_timer_init);
+
+static int __init meson_gx_timer_init(struct device_node *node)
+{
+	return meson_timer_init(node, true);
+}
+TIMER_OF_DECLARE(meson_gx, "amlogic,meson-gx-timer",
+		       meson_gx_timer_init);
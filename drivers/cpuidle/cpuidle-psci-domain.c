@@ -236,9 +236,22 @@ static int __init psci_idle_init_domains(void)
 	if (!np)
 		return -ENODEV;
 
-	/* Currently limit the hierarchical topology to be used in OSI mode. */
-	if (!psci_has_osi_support())
+	/*
+	 * Currently limit the hierarchical topology to be used in OSI mode.
+	 * Without it cluster states have to be described as flattened CPU
+	 * idle states, coordinated by the firmware, so say why the domain
+	 * idle states of the DT go unused.
+	 */
+	if (!psci_has_osi_support()) {
+		for_each_child_of_node(np, node) {
+			if (of_find_property(node, "#power-domain-cells", NULL)) {
+				pr_info("no OSI mode support, ignoring CPU PM domain topology\n");
+				of_node_put(node);
+				break;
+			}
+		}
 		goto out;
+	}
 
 	/*
 	 * Parse child nodes for the "#power-domain-cells" property and
@@ -43,13 +43,20 @@
  *   target residency of the idle state selected so far, use those values to
  *   compute the new expected idle duration and find an idle state matching it
  *   (which has to be shallower than the one selected so far).
+ *
+ * - If the interrupt timings code can predict the next device interrupt on the
+ *   CPU and it is going to occur before the target residency of the idle state
+ *   selected so far, use the time till that interrupt as the expected idle
+ *   duration and find a shallower idle state matching it.
  */
 
 #include <linux/cpuidle.h>
+#include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/sched/clock.h>
 #include <linux/tick.h>
+#include <linux/workqueue.h>
 
 /*
  * The PULSE value is added to metrics when they grow and the DECAY_SHIFT value
@@ -231,6 +238,63 @@ static int teo_find_shallower_state(struct cpuidle_driver *drv,
 	return state_idx;
 }
 
+#ifdef CONFIG_CPU_IDLE_GOV_TEO_IRQ_TIMINGS
+/**
+ * teo_irq_next_ns - Get the time till the next predicted device interrupt.
+ * @now: Current time as returned by local_clock().
+ *
+ * Must be called with interrupts disabled, which is the case in the idle loop.
+ * Return U64_MAX if no prediction can be made.
+ */
+static u64 teo_irq_next_ns(u64 now)
+{
+	u64 next = irq_timings_next_event(now);
+
+	if (next == U64_MAX)
+		return U64_MAX;
+
+	return next > now ? next - now : 0;
+}
+
+/*
+ * IRQ timings cost something on every interrupt, so only keep them on while
+ * some CPU uses this governor. Flipping the static key may sleep and take
+ * the CPU hotplug lock, so do it from a work item which applies the latest
+ * state.
+ */
+static atomic_t teo_irq_timings_users = ATOMIC_INIT(0);
+
+static void teo_irq_timings_fn(struct work_struct *work)
+{
+	if (atomic_read(&teo_irq_timings_users))
+		irq_timings_enable();
+	else
+		irq_timings_disable();
+}
+
+static DECLARE_WORK(teo_irq_timings_work, teo_irq_timings_fn);
+
+static void teo_irq_timings_get(void)
+{
+	if (atomic_inc_return(&teo_irq_timings_users) == 1)
+		schedule_work(&teo_irq_timings_work);
+}
+
+static void teo_irq_timings_put(void)
+{
+	if (atomic_dec_and_test(&teo_irq_timings_users))
+		schedule_work(&teo_irq_timings_work);
+}
+#else
+static inline u64 teo_irq_next_ns(u64 now)
+{
+	return U64_MAX;
+}
+
+static inline void teo_irq_timings_get(void) {}
+static inline void teo_irq_timings_put(void) {}
+#endif
+
 /**
  * teo_select - Selects the next idle state to enter.
  * @drv: cpuidle driver containing state data.
@@ -242,7 +306,7 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 {
 	struct teo_cpu *cpu_data = per_cpu_ptr(&teo_cpus, dev->cpu);
 	s64 latency_req = cpuidle_governor_latency_req(dev->cpu);
-	u64 duration_ns;
+	u64 duration_ns, irq_ns;
 	unsigned int hits, misses, early_hits;
 	int max_early_idx, prev_max_early_idx, constraint_idx, idx, i;
 	ktime_t delta_tick;
@@ -412,6 +476,20 @@ static int teo_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 								       idx, avg_ns);
 			}
 		}
+
+		/*
+		 * A device interrupt predicted to occur before the target
+		 * residency of the selected state would make entering it
+		 * a waste of energy, so look for a shallower one.
+		 */
+		irq_ns = teo_irq_next_ns(cpu_data->time_span_ns);
+		if (irq_ns < duration_ns) {
+			duration_ns = irq_ns;
+			if (idx > 0 &&
+			    drv->states[idx].target_residency_ns > irq_ns)
+				idx = teo_find_shallower_state(drv, dev, idx,
+							       irq_ns);
+		}
 	}
 
 	/*
@@ -475,13 +553,27 @@ static int teo_enable_device(struct cpuidle_driver *drv,
 	for (i = 0; i < INTERVALS; i++)
 		cpu_data->intervals[i] = U64_MAX;
 
+	teo_irq_timings_get();
+
 	return 0;
 }
 
+/**
+ * teo_disable_device - Stop using the governor on the target CPU.
+ * @drv: cpuidle driver (not used).
+ * @dev: Target CPU (not used).
+ */
+static void teo_disable_device(struct cpuidle_driver *drv,
+			       struct cpuidle_device *dev)
+{
+	teo_irq_timings_put();
+}
+
 static struct cpuidle_governor teo_governor = {
 	.name =		"teo",
 	.rating =	19,
 	.enable =	teo_enable_device,
+	.disable =	teo_disable_device,
 	.select =	teo_select,
 	.reflect =	teo_reflect,
 };
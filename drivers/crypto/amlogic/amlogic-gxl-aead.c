@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * amlogic-gxl-aead.c - hardware cryptographic offloader for Amlogic GXL SoC
+ *
+ * This file add support for AES-GCM.
+ * The CTR keystream is done by the hardware through ctr-aes-gxl, GHASH is
+ * done by the CPU. The gcm template glues them together, this AEAD only
+ * makes sure that it is the one picked up for gcm(aes).
+ */
+
+#include <crypto/gcm.h>
+#include <crypto/internal/aead.h>
+#include "amlogic-gxl.h"
+
+#define MESON_GCM_BASE "gcm_base(ctr-aes-gxl,ghash)"
+
+static void meson_aead_done(struct crypto_async_request *areq, int err)
+{
+	struct aead_request *req = areq->data;
+
+	aead_request_complete(req, err);
+}
+
+static int meson_aead_crypt(struct aead_request *req, bool encrypt)
+{
+	struct crypto_aead *tfm = crypto_aead_reqtfm(req);
+	struct meson_aead_tfm_ctx *op = crypto_aead_ctx(tfm);
+	struct aead_request *subreq = aead_request_ctx(req);
+#ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct meson_alg_template *algt;
+
+	algt = container_of(alg, struct meson_alg_template, alg.aead);
+	algt->stat_req++;
+#endif
+
+	aead_request_set_tfm(subreq, op->child);
+	aead_request_set_callback(subreq, req->base.flags, meson_aead_done,
+				  req);
+	aead_request_set_crypt(subreq, req->src, req->dst, req->cryptlen,
+			       req->iv);
+	aead_request_set_ad(subreq, req->assoclen);
+
+	return encrypt ? crypto_aead_encrypt(subreq) :
+			 crypto_aead_decrypt(subreq);
+}
+
+int meson_aead_encrypt(struct aead_request *req)
+{
+	return meson_aead_crypt(req, true);
+}
+
+int meson_aead_decrypt(struct aead_request *req)
+{
+	return meson_aead_crypt(req, false);
+}
+
+int meson_aead_setkey(struct crypto_aead *tfm, const u8 *key,
+		      unsigned int keylen)
+{
+	struct meson_aead_tfm_ctx *op = crypto_aead_ctx(tfm);
+
+	crypto_aead_clear_flags(op->child, CRYPTO_TFM_REQ_MASK);
+	crypto_aead_set_flags(op->child,
+			      crypto_aead_get_flags(tfm) & CRYPTO_TFM_REQ_MASK);
+	return crypto_aead_setkey(op->child, key, keylen);
+}
+
+int meson_aead_setauthsize(struct crypto_aead *tfm, unsigned int authsize)
+{
+	struct meson_aead_tfm_ctx *op = crypto_aead_ctx(tfm);
+
+	return crypto_aead_setauthsize(op->child, authsize);
+}
+
+int meson_aead_init(struct crypto_aead *tfm)
+{
+	struct meson_aead_tfm_ctx *op = crypto_aead_ctx(tfm);
+	struct aead_alg *alg = crypto_aead_alg(tfm);
+	struct meson_alg_template *algt;
+
+	algt = container_of(alg, struct meson_alg_template, alg.aead);
+	op->mc = algt->mc;
+
+	op->child = crypto_alloc_aead(MESON_GCM_BASE, 0, 0);
+	if (IS_ERR(op->child)) {
+		dev_err(op->mc->dev, "ERROR: Cannot allocate %s %ld\n",
+			MESON_GCM_BASE, PTR_ERR(op->child));
+		return PTR_ERR(op->child);
+	}
+
+	crypto_aead_set_reqsize(tfm, sizeof(struct aead_request) +
+				crypto_aead_reqsize(op->child));
+	return 0;
+}
+
+void meson_aead_exit(struct crypto_aead *tfm)
+{
+	struct meson_aead_tfm_ctx *op = crypto_aead_ctx(tfm);
+
+	crypto_free_aead(op->child);
+}
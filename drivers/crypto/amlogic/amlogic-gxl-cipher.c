@@ -6,6 +6,8 @@
  *
  * This file add support for AES cipher with 128,192,256 bits keysize in
  * CBC and ECB mode.
+ * CTR and XTS modes are done with the hardware in ECB mode, the counter
+ * stream and the tweaks being computed by the CPU.
  */
 
 #include <linux/crypto.h>
@@ -14,12 +16,30 @@
 #include <crypto/scatterwalk.h>
 #include <linux/scatterlist.h>
 #include <linux/dma-mapping.h>
+#include <crypto/gf128mul.h>
 #include <crypto/internal/skcipher.h>
+#include <crypto/xts.h>
 #include "amlogic-gxl.h"
 
-static int get_engine_number(struct meson_dev *mc)
+/*
+ * Select the flow with the fewest bytes still queued or in progress.
+ * The search starts at a rotating flow so that ties are spread.
+ */
+int meson_get_engine_number(struct meson_dev *mc, unsigned int len)
 {
-	return atomic_inc_return(&mc->flow) % MAXFLOW;
+	int start = atomic_inc_return(&mc->flow) % MAXFLOW;
+	int best = start;
+	int i, f;
+
+	for (i = 1; i < MAXFLOW; i++) {
+		f = (start + i) % MAXFLOW;
+		if (atomic_read(&mc->chanlist[f].inflight) <
+		    atomic_read(&mc->chanlist[best].inflight))
+			best = f;
+	}
+	atomic_add(len, &mc->chanlist[best].inflight);
+
+	return best;
 }
 
 static bool meson_cipher_need_fallback(struct skcipher_request *areq)
@@ -55,6 +75,81 @@ static bool meson_cipher_need_fallback(struct skcipher_request *areq)
 	return false;
 }
 
+/*
+ * Size used in the bounce buffer by a request.
+ * For CTR, the counter blocks are stored before the data.
+ */
+static unsigned int meson_cipher_bounce_len(struct skcipher_request *areq)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
+	if (algt->swmode == MESON_SWMODE_CTR)
+		return 2 * round_up(areq->cryptlen, AES_BLOCK_SIZE);
+
+	return areq->cryptlen;
+}
+
+/*
+ * Requests rejected by meson_cipher_need_fallback() can still be done by the
+ * hardware if they fit in the bounce buffer of a flow.
+ * CTR and XTS requests always go through the bounce buffer.
+ */
+static bool meson_cipher_can_bounce(struct skcipher_request *areq)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
+
+	if (areq->cryptlen < MESON_BOUNCE_MIN_LEN)
+		return false;
+	if (meson_cipher_bounce_len(areq) > MESON_BOUNCE_SIZE)
+		return false;
+	/* CTR is a stream mode, XTS ciphertext stealing is not handled */
+	if (algt->swmode != MESON_SWMODE_CTR &&
+	    areq->cryptlen % AES_BLOCK_SIZE)
+		return false;
+	if (sg_nents_for_len(areq->src, areq->cryptlen) < 0)
+		return false;
+	if (sg_nents_for_len(areq->dst, areq->cryptlen) < 0)
+		return false;
+
+	return true;
+}
+
+/*
+ * Fill buf with len bytes of successive counter blocks starting at iv,
+ * and store the counter following the last one in next.
+ */
+static void meson_ctr_fill(u8 *buf, const u8 *iv, u8 *next, unsigned int len)
+{
+	unsigned int i;
+
+	memcpy(next, iv, AES_BLOCK_SIZE);
+	for (i = 0; i < len; i += AES_BLOCK_SIZE) {
+		memcpy(buf + i, next, AES_BLOCK_SIZE);
+		crypto_inc(next, AES_BLOCK_SIZE);
+	}
+}
+
+/* XOR each block of buf with its XTS tweak, the first one being tweak */
+static void meson_xts_xor(u8 *buf, const u8 *tweak, unsigned int len)
+{
+	unsigned int i;
+	le128 t;
+
+	memcpy(&t, tweak, sizeof(t));
+	for (i = 0; i < len; i += AES_BLOCK_SIZE) {
+		le128_xor((le128 *)(buf + i), (le128 *)(buf + i), &t);
+		gf128mul_x_ble(&t, &t);
+	}
+	memzero_explicit(&t, sizeof(t));
+}
+
 static int meson_cipher_do_fallback(struct skcipher_request *areq)
 {
 	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
@@ -83,7 +178,115 @@ static int meson_cipher_do_fallback(struct skcipher_request *areq)
 	return err;
 }
 
-static int meson_cipher(struct skcipher_request *areq)
+/*
+ * Number of descriptors needed by a request: key (and IV) descriptors plus
+ * one descriptor per SG entry, or a single one when using the bounce buffer.
+ */
+static unsigned int meson_cipher_ndesc(struct skcipher_request *areq)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
+	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
+	struct meson_cipher_req_ctx *rctx = skcipher_request_ctx(areq);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+	unsigned int keyivlen = op->keylen;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
+	if (!algt->swmode && areq->iv && crypto_skcipher_ivsize(tfm) > 0)
+		keyivlen = 48;
+	if (keyivlen == 24)
+		keyivlen = 32;
+
+	return keyivlen / 16 + (rctx->bounce ? 1 : sg_nents(areq->src));
+}
+
+/*
+ * Unmap and release everything meson_cipher_prepare() did for a request,
+ * and update its IV if the operation succeeded.
+ */
+static void meson_cipher_finish(struct skcipher_request *areq, int err)
+{
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
+	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
+	struct meson_cipher_req_ctx *rctx = skcipher_request_ctx(areq);
+	struct meson_dev *mc = op->mc;
+	struct meson_flow *mf = &mc->chanlist[rctx->flow];
+	unsigned int ivsize = crypto_skcipher_ivsize(tfm);
+	unsigned int hwlen = round_up(areq->cryptlen, AES_BLOCK_SIZE);
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+	u8 *buf;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
+
+	if (rctx->keyivlen)
+		dma_unmap_single(mc->dev, rctx->phykeyiv, rctx->keyivlen,
+				 DMA_TO_DEVICE);
+
+	if (rctx->bounce) {
+		buf = mf->bounce + rctx->bounce_off;
+		dma_sync_single_for_cpu(mc->dev,
+					mf->bounce_phy + rctx->bounce_off,
+					hwlen, DMA_BIDIRECTIONAL);
+		if (!err) {
+			switch (algt->swmode) {
+			case MESON_SWMODE_CTR:
+				/* buf holds the key stream, data is after it */
+				crypto_xor(buf + hwlen, buf, areq->cryptlen);
+				buf += hwlen;
+				memcpy(areq->iv, rctx->sw_iv, AES_BLOCK_SIZE);
+				break;
+			case MESON_SWMODE_XTS:
+				meson_xts_xor(buf, rctx->sw_iv, hwlen);
+				break;
+			}
+			sg_copy_from_buffer(areq->dst, sg_nents(areq->dst),
+					    buf, areq->cryptlen);
+		}
+		memzero_explicit(mf->bounce + rctx->bounce_off,
+				 meson_cipher_bounce_len(areq));
+		memzero_explicit(rctx->sw_iv, AES_BLOCK_SIZE);
+	} else if (areq->src == areq->dst) {
+		if (rctx->nr_sgs > 0)
+			dma_unmap_sg(mc->dev, areq->src, sg_nents(areq->src),
+				     DMA_BIDIRECTIONAL);
+	} else {
+		if (rctx->nr_sgs > 0)
+			dma_unmap_sg(mc->dev, areq->src, sg_nents(areq->src),
+				     DMA_TO_DEVICE);
+		if (rctx->nr_sgd > 0)
+			dma_unmap_sg(mc->dev, areq->dst, sg_nents(areq->dst),
+				     DMA_FROM_DEVICE);
+	}
+
+	if (!err && !algt->swmode && areq->iv && ivsize > 0) {
+		if (rctx->op_dir == MESON_DECRYPT) {
+			memcpy(areq->iv, rctx->backup_iv, ivsize);
+		} else {
+			scatterwalk_map_and_copy(areq->iv, areq->dst,
+						 areq->cryptlen - ivsize,
+						 ivsize, 0);
+		}
+	}
+
+	kzfree(rctx->bkeyiv);
+	kzfree(rctx->backup_iv);
+	rctx->bkeyiv = NULL;
+	rctx->backup_iv = NULL;
+
+	atomic_sub(areq->cryptlen, &mf->inflight);
+}
+
+/*
+ * Write the descriptors for a request in the ring of its flow, starting at
+ * *tloffset. On return *tloffset points after the last descriptor of the
+ * request and *last to its last data descriptor.
+ * DESC_LAST is not set, this is done by the caller once the whole batch is
+ * built.
+ */
+static int meson_cipher_prepare(struct skcipher_request *areq,
+				unsigned int *tloffset, unsigned int *last,
+				unsigned int *bounce_off)
 {
 	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(areq);
 	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
@@ -92,15 +295,16 @@ static int meson_cipher(struct skcipher_request *areq)
 	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
 	struct meson_alg_template *algt;
 	int flow = rctx->flow;
+	struct meson_flow *mf = &mc->chanlist[flow];
 	unsigned int todo, eat, len;
 	struct scatterlist *src_sg = areq->src;
 	struct scatterlist *dst_sg = areq->dst;
 	struct meson_desc *desc;
-	int nr_sgs, nr_sgd;
 	int i, err = 0;
-	unsigned int keyivlen, ivsize, offset, tloffset;
+	unsigned int keyivlen, ivsize, offset, hwlen;
 	dma_addr_t phykeyiv;
-	void *backup_iv = NULL, *bkeyiv;
+	u32 op_dir;
+	u8 *buf;
 	__le32 v;
 
 	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
@@ -116,54 +320,57 @@ static int meson_cipher(struct skcipher_request *areq)
 	mc->chanlist[flow].stat_req++;
 #endif
 
+	rctx->keyivlen = 0;
+	rctx->nr_sgs = 0;
+	rctx->nr_sgd = 0;
+	rctx->backup_iv = NULL;
+
 	/*
 	 * The hardware expect a list of meson_desc structures.
 	 * The 2 first structures store key
 	 * The third stores IV
 	 */
-	bkeyiv = kzalloc(48, GFP_KERNEL | GFP_DMA);
-	if (!bkeyiv)
+	rctx->bkeyiv = kzalloc(48, GFP_KERNEL | GFP_DMA);
+	if (!rctx->bkeyiv)
 		return -ENOMEM;
 
-	memcpy(bkeyiv, op->key, op->keylen);
+	memcpy(rctx->bkeyiv, op->key, op->keylen);
 	keyivlen = op->keylen;
 
 	ivsize = crypto_skcipher_ivsize(tfm);
-	if (areq->iv && ivsize > 0) {
+	if (!algt->swmode && areq->iv && ivsize > 0) {
 		if (ivsize > areq->cryptlen) {
 			dev_err(mc->dev, "invalid ivsize=%d vs len=%d\n", ivsize, areq->cryptlen);
-			err = -EINVAL;
-			goto theend;
+			return -EINVAL;
 		}
-		memcpy(bkeyiv + 32, areq->iv, ivsize);
+		memcpy(rctx->bkeyiv + 32, areq->iv, ivsize);
 		keyivlen = 48;
 		if (rctx->op_dir == MESON_DECRYPT) {
-			backup_iv = kzalloc(ivsize, GFP_KERNEL);
-			if (!backup_iv) {
-				err = -ENOMEM;
-				goto theend;
-			}
+			rctx->backup_iv = kzalloc(ivsize, GFP_KERNEL);
+			if (!rctx->backup_iv)
+				return -ENOMEM;
 			offset = areq->cryptlen - ivsize;
-			scatterwalk_map_and_copy(backup_iv, areq->src, offset,
-						 ivsize, 0);
+			scatterwalk_map_and_copy(rctx->backup_iv, areq->src,
+						 offset, ivsize, 0);
 		}
 	}
 	if (keyivlen == 24)
 		keyivlen = 32;
 
-	phykeyiv = dma_map_single(mc->dev, bkeyiv, keyivlen,
+	phykeyiv = dma_map_single(mc->dev, rctx->bkeyiv, keyivlen,
 				  DMA_TO_DEVICE);
 	err = dma_mapping_error(mc->dev, phykeyiv);
 	if (err) {
 		dev_err(mc->dev, "Cannot DMA MAP KEY IV\n");
-		goto theend;
+		return err;
 	}
+	rctx->phykeyiv = phykeyiv;
+	rctx->keyivlen = keyivlen;
 
-	tloffset = 0;
 	eat = 0;
 	i = 0;
 	while (keyivlen > eat) {
-		desc = &mc->chanlist[flow].tl[tloffset];
+		desc = &mf->tl[*tloffset];
 		memset(desc, 0, sizeof(struct meson_desc));
 		todo = min(keyivlen - eat, 16u);
 		desc->t_src = cpu_to_le32(phykeyiv + i * 16);
@@ -173,32 +380,77 @@ static int meson_cipher(struct skcipher_request *areq)
 
 		eat += todo;
 		i++;
-		tloffset++;
+		(*tloffset)++;
+	}
+
+	if (rctx->bounce) {
+#ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
+		algt->stat_bb++;
+#endif
+		rctx->bounce_off = *bounce_off;
+		*bounce_off += meson_cipher_bounce_len(areq);
+		buf = mf->bounce + rctx->bounce_off;
+		hwlen = round_up(areq->cryptlen, AES_BLOCK_SIZE);
+		op_dir = rctx->op_dir;
+
+		switch (algt->swmode) {
+		case MESON_SWMODE_CTR:
+			/* the hardware encrypts the counters in ECB mode */
+			meson_ctr_fill(buf, areq->iv, rctx->sw_iv, hwlen);
+			sg_copy_to_buffer(areq->src, sg_nents(areq->src),
+					  buf + hwlen, areq->cryptlen);
+			op_dir = MESON_ENCRYPT;
+			break;
+		case MESON_SWMODE_XTS:
+			sg_copy_to_buffer(areq->src, sg_nents(areq->src), buf,
+					  areq->cryptlen);
+			aes_encrypt(&op->tweak_key, rctx->sw_iv, areq->iv);
+			meson_xts_xor(buf, rctx->sw_iv, hwlen);
+			break;
+		default:
+			sg_copy_to_buffer(areq->src, sg_nents(areq->src), buf,
+					  areq->cryptlen);
+			break;
+		}
+		dma_sync_single_for_device(mc->dev,
+					   mf->bounce_phy + rctx->bounce_off,
+					   hwlen, DMA_BIDIRECTIONAL);
+
+		desc = &mf->tl[*tloffset];
+		memset(desc, 0, sizeof(struct meson_desc));
+		desc->t_src = cpu_to_le32(mf->bounce_phy + rctx->bounce_off);
+		desc->t_dst = cpu_to_le32(mf->bounce_phy + rctx->bounce_off);
+		v = (op->keymode << 20) | DESC_OWN | hwlen |
+		    (algt->blockmode << 26);
+		if (op_dir)
+			v |= DESC_ENCRYPTION;
+		desc->t_status = cpu_to_le32(v);
+		*last = *tloffset;
+		(*tloffset)++;
+		return 0;
 	}
 
 	if (areq->src == areq->dst) {
-		nr_sgs = dma_map_sg(mc->dev, areq->src, sg_nents(areq->src),
-				    DMA_BIDIRECTIONAL);
-		if (nr_sgs < 0) {
-			dev_err(mc->dev, "Invalid SG count %d\n", nr_sgs);
-			err = -EINVAL;
-			goto theend;
+		rctx->nr_sgs = dma_map_sg(mc->dev, areq->src,
+					  sg_nents(areq->src),
+					  DMA_BIDIRECTIONAL);
+		if (rctx->nr_sgs <= 0) {
+			dev_err(mc->dev, "Invalid SG count %d\n", rctx->nr_sgs);
+			return -EINVAL;
 		}
-		nr_sgd = nr_sgs;
+		rctx->nr_sgd = rctx->nr_sgs;
 	} else {
-		nr_sgs = dma_map_sg(mc->dev, areq->src, sg_nents(areq->src),
-				    DMA_TO_DEVICE);
-		if (nr_sgs < 0 || nr_sgs > MAXDESC - 3) {
-			dev_err(mc->dev, "Invalid SG count %d\n", nr_sgs);
-			err = -EINVAL;
-			goto theend;
+		rctx->nr_sgs = dma_map_sg(mc->dev, areq->src,
+					  sg_nents(areq->src), DMA_TO_DEVICE);
+		if (rctx->nr_sgs <= 0 || rctx->nr_sgs > MAXDESC - 3) {
+			dev_err(mc->dev, "Invalid SG count %d\n", rctx->nr_sgs);
+			return -EINVAL;
 		}
-		nr_sgd = dma_map_sg(mc->dev, areq->dst, sg_nents(areq->dst),
-				    DMA_FROM_DEVICE);
-		if (nr_sgd < 0 || nr_sgd > MAXDESC - 3) {
-			dev_err(mc->dev, "Invalid SG count %d\n", nr_sgd);
-			err = -EINVAL;
-			goto theend;
+		rctx->nr_sgd = dma_map_sg(mc->dev, areq->dst,
+					  sg_nents(areq->dst), DMA_FROM_DEVICE);
+		if (rctx->nr_sgd <= 0 || rctx->nr_sgd > MAXDESC - 3) {
+			dev_err(mc->dev, "Invalid SG count %d\n", rctx->nr_sgd);
+			return -EINVAL;
 		}
 	}
 
@@ -206,7 +458,7 @@ static int meson_cipher(struct skcipher_request *areq)
 	dst_sg = areq->dst;
 	len = areq->cryptlen;
 	while (src_sg) {
-		desc = &mc->chanlist[flow].tl[tloffset];
+		desc = &mf->tl[*tloffset];
 		memset(desc, 0, sizeof(struct meson_desc));
 
 		desc->t_src = cpu_to_le32(sg_dma_address(src_sg));
@@ -217,57 +469,128 @@ static int meson_cipher(struct skcipher_request *areq)
 			v |= DESC_ENCRYPTION;
 		len -= todo;
 
-		if (!sg_next(src_sg))
-			v |= DESC_LAST;
 		desc->t_status = cpu_to_le32(v);
-		tloffset++;
+		*last = *tloffset;
+		(*tloffset)++;
 		src_sg = sg_next(src_sg);
 		dst_sg = sg_next(dst_sg);
 	}
 
-	reinit_completion(&mc->chanlist[flow].complete);
-	mc->chanlist[flow].status = 0;
-	writel(mc->chanlist[flow].t_phy | 2, mc->base + (flow << 2));
-	wait_for_completion_interruptible_timeout(&mc->chanlist[flow].complete,
-						  msecs_to_jiffies(500));
-	if (mc->chanlist[flow].status == 0) {
-		dev_err(mc->dev, "DMA timeout for flow %d\n", flow);
-		err = -EINVAL;
-	}
-
-	dma_unmap_single(mc->dev, phykeyiv, keyivlen, DMA_TO_DEVICE);
-
-	if (areq->src == areq->dst) {
-		dma_unmap_sg(mc->dev, areq->src, nr_sgs, DMA_BIDIRECTIONAL);
-	} else {
-		dma_unmap_sg(mc->dev, areq->src, nr_sgs, DMA_TO_DEVICE);
-		dma_unmap_sg(mc->dev, areq->dst, nr_sgd, DMA_FROM_DEVICE);
-	}
+	return 0;
+}
 
-	if (areq->iv && ivsize > 0) {
-		if (rctx->op_dir == MESON_DECRYPT) {
-			memcpy(areq->iv, backup_iv, ivsize);
-		} else {
-			scatterwalk_map_and_copy(areq->iv, areq->dst,
-						 areq->cryptlen - ivsize,
-						 ivsize, 0);
-		}
+/*
+ * Take the next request queued on the engine if it is a skcipher request
+ * which fits in the remaining descriptors and bounce buffer space.
+ */
+static struct skcipher_request *meson_cipher_next(struct crypto_engine *engine,
+						  unsigned int tloffset,
+						  unsigned int bounce_off)
+{
+	struct crypto_async_request *async_req, *backlog;
+	struct skcipher_request *req;
+	struct meson_cipher_req_ctx *rctx;
+	unsigned long flags;
+
+	spin_lock_irqsave(&engine->queue_lock, flags);
+	if (list_empty(&engine->queue.list)) {
+		spin_unlock_irqrestore(&engine->queue_lock, flags);
+		return NULL;
 	}
-theend:
-	kzfree(bkeyiv);
-	kzfree(backup_iv);
-
-	return err;
+	async_req = list_first_entry(&engine->queue.list,
+				     struct crypto_async_request, list);
+	if (crypto_tfm_alg_type(async_req->tfm) != CRYPTO_ALG_TYPE_SKCIPHER)
+		goto nofit;
+	req = skcipher_request_cast(async_req);
+	rctx = skcipher_request_ctx(req);
+	if (tloffset + meson_cipher_ndesc(req) > MAXDESC)
+		goto nofit;
+	if (rctx->bounce &&
+	    bounce_off + meson_cipher_bounce_len(req) > MESON_BOUNCE_SIZE)
+		goto nofit;
+
+	backlog = crypto_get_backlog(&engine->queue);
+	crypto_dequeue_request(&engine->queue);
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
+
+	if (backlog)
+		backlog->complete(backlog, -EINPROGRESS);
+
+	return req;
+nofit:
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
+	return NULL;
 }
 
+/*
+ * The crypto_engine gives us one request, but all other requests already
+ * queued on the same flow are packed in the descriptor ring behind it,
+ * so that the whole batch is completed by a single interrupt.
+ */
 static int meson_handle_cipher_request(struct crypto_engine *engine,
 				       void *areq)
 {
-	int err;
 	struct skcipher_request *breq = container_of(areq, struct skcipher_request, base);
+	struct meson_cipher_req_ctx *rctx = skcipher_request_ctx(breq);
+	struct crypto_skcipher *tfm = crypto_skcipher_reqtfm(breq);
+	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
+	struct meson_dev *mc = op->mc;
+	int flow = rctx->flow;
+	struct meson_flow *mf = &mc->chanlist[flow];
+	struct skcipher_request *batch[MESON_MAX_BATCH];
+	unsigned int tloffset = 0, last = 0, bounce_off = 0;
+	unsigned int nreq = 0, i;
+	int err;
+
+	batch[nreq++] = breq;
+	err = meson_cipher_prepare(breq, &tloffset, &last, &bounce_off);
+	if (err)
+		goto theend;
+
+	while (nreq < MESON_MAX_BATCH) {
+		struct skcipher_request *req;
+		unsigned int prev_last = last;
+
+		req = meson_cipher_next(engine, tloffset, bounce_off);
+		if (!req)
+			break;
+		err = meson_cipher_prepare(req, &tloffset, &last, &bounce_off);
+		if (err) {
+			/*
+			 * The descriptors written for this request are after
+			 * the DESC_LAST of the batch, so the hardware ignores
+			 * them.
+			 */
+			last = prev_last;
+			meson_cipher_finish(req, err);
+			crypto_finalize_skcipher_request(engine, req, err);
+			err = 0;
+			break;
+		}
+		batch[nreq++] = req;
+	}
 
-	err = meson_cipher(breq);
-	crypto_finalize_skcipher_request(engine, breq, err);
+	mf->tl[last].t_status |= cpu_to_le32(DESC_LAST);
+
+#ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
+	mf->stat_batch[nreq - 1]++;
+#endif
+
+	reinit_completion(&mf->complete);
+	mf->status = 0;
+	writel(mf->t_phy | 2, mc->base + (flow << 2));
+	wait_for_completion_interruptible_timeout(&mf->complete,
+						  msecs_to_jiffies(500));
+	if (mf->status == 0) {
+		dev_err(mc->dev, "DMA timeout for flow %d\n", flow);
+		err = -EINVAL;
+	}
+
+theend:
+	for (i = 0; i < nreq; i++) {
+		meson_cipher_finish(batch[i], err);
+		crypto_finalize_skcipher_request(engine, batch[i], err);
+	}
 
 	return 0;
 }
@@ -278,16 +601,28 @@ int meson_skdecrypt(struct skcipher_request *areq)
 	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
 	struct meson_cipher_req_ctx *rctx = skcipher_request_ctx(areq);
 	struct crypto_engine *engine;
-	int e;
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+	int e, err;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
 
 	rctx->op_dir = MESON_DECRYPT;
-	if (meson_cipher_need_fallback(areq))
-		return meson_cipher_do_fallback(areq);
-	e = get_engine_number(op->mc);
+	rctx->bounce = false;
+	if (algt->swmode || meson_cipher_need_fallback(areq)) {
+		if (!meson_cipher_can_bounce(areq))
+			return meson_cipher_do_fallback(areq);
+		rctx->bounce = true;
+	}
+	e = meson_get_engine_number(op->mc, areq->cryptlen);
 	engine = op->mc->chanlist[e].engine;
 	rctx->flow = e;
 
-	return crypto_transfer_skcipher_request_to_engine(engine, areq);
+	err = crypto_transfer_skcipher_request_to_engine(engine, areq);
+	if (err != -EINPROGRESS && err != -EBUSY)
+		atomic_sub(areq->cryptlen, &op->mc->chanlist[e].inflight);
+
+	return err;
 }
 
 int meson_skencrypt(struct skcipher_request *areq)
@@ -296,16 +631,28 @@ int meson_skencrypt(struct skcipher_request *areq)
 	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
 	struct meson_cipher_req_ctx *rctx = skcipher_request_ctx(areq);
 	struct crypto_engine *engine;
-	int e;
+	struct skcipher_alg *alg = crypto_skcipher_alg(tfm);
+	struct meson_alg_template *algt;
+	int e, err;
+
+	algt = container_of(alg, struct meson_alg_template, alg.skcipher);
 
 	rctx->op_dir = MESON_ENCRYPT;
-	if (meson_cipher_need_fallback(areq))
-		return meson_cipher_do_fallback(areq);
-	e = get_engine_number(op->mc);
+	rctx->bounce = false;
+	if (algt->swmode || meson_cipher_need_fallback(areq)) {
+		if (!meson_cipher_can_bounce(areq))
+			return meson_cipher_do_fallback(areq);
+		rctx->bounce = true;
+	}
+	e = meson_get_engine_number(op->mc, areq->cryptlen);
 	engine = op->mc->chanlist[e].engine;
 	rctx->flow = e;
 
-	return crypto_transfer_skcipher_request_to_engine(engine, areq);
+	err = crypto_transfer_skcipher_request_to_engine(engine, areq);
+	if (err != -EINPROGRESS && err != -EBUSY)
+		atomic_sub(areq->cryptlen, &op->mc->chanlist[e].inflight);
+
+	return err;
 }
 
 int meson_cipher_init(struct crypto_tfm *tfm)
@@ -345,13 +692,13 @@ void meson_cipher_exit(struct crypto_tfm *tfm)
 		memzero_explicit(op->key, op->keylen);
 		kfree(op->key);
 	}
+	memzero_explicit(&op->tweak_key, sizeof(op->tweak_key));
 	crypto_free_sync_skcipher(op->fallback_tfm);
 }
 
-int meson_aes_setkey(struct crypto_skcipher *tfm, const u8 *key,
-		     unsigned int keylen)
+static int meson_aes_set_hwkey(struct meson_cipher_tfm_ctx *op, const u8 *key,
+			       unsigned int keylen)
 {
-	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
 	struct meson_dev *mc = op->mc;
 
 	switch (keylen) {
@@ -377,5 +724,43 @@ int meson_aes_setkey(struct crypto_skcipher *tfm, const u8 *key,
 	if (!op->key)
 		return -ENOMEM;
 
+	return 0;
+}
+
+int meson_aes_setkey(struct crypto_skcipher *tfm, const u8 *key,
+		     unsigned int keylen)
+{
+	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
+	int err;
+
+	err = meson_aes_set_hwkey(op, key, keylen);
+	if (err)
+		return err;
+
+	return crypto_sync_skcipher_setkey(op->fallback_tfm, key, keylen);
+}
+
+/*
+ * The first half of the key is given to the hardware, the second half is
+ * the tweak key used by the CPU for computing the first tweak.
+ */
+int meson_aes_xts_setkey(struct crypto_skcipher *tfm, const u8 *key,
+			 unsigned int keylen)
+{
+	struct meson_cipher_tfm_ctx *op = crypto_skcipher_ctx(tfm);
+	int err;
+
+	err = xts_verify_key(tfm, key, keylen);
+	if (err)
+		return err;
+
+	err = meson_aes_set_hwkey(op, key, keylen / 2);
+	if (err)
+		return err;
+
+	err = aes_expandkey(&op->tweak_key, key + keylen / 2, keylen / 2);
+	if (err)
+		return err;
+
 	return crypto_sync_skcipher_setkey(op->fallback_tfm, key, keylen);
 }
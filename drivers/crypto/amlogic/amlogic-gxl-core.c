@@ -15,6 +15,9 @@
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
+#include <crypto/gcm.h>
+#include <crypto/internal/aead.h>
+#include <crypto/internal/hash.h>
 #include <crypto/internal/skcipher.h>
 #include <linux/dma-mapping.h>
 
@@ -93,23 +96,299 @@ static struct meson_alg_template mc_algs[] = {
 		.decrypt	= meson_skdecrypt,
 	}
 },
+{
+	.type = CRYPTO_ALG_TYPE_SKCIPHER,
+	.blockmode = MESON_OPMODE_ECB,
+	.swmode = MESON_SWMODE_CTR,
+	.alg.skcipher = {
+		.base = {
+			.cra_name = "ctr(aes)",
+			.cra_driver_name = "ctr-aes-gxl",
+			.cra_priority = 400,
+			.cra_blocksize = 1,
+			.cra_flags = CRYPTO_ALG_TYPE_SKCIPHER |
+				CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+			.cra_ctxsize = sizeof(struct meson_cipher_tfm_ctx),
+			.cra_module = THIS_MODULE,
+			.cra_alignmask = 0xf,
+			.cra_init = meson_cipher_init,
+			.cra_exit = meson_cipher_exit,
+		},
+		.min_keysize	= AES_MIN_KEY_SIZE,
+		.max_keysize	= AES_MAX_KEY_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.chunksize	= AES_BLOCK_SIZE,
+		.setkey		= meson_aes_setkey,
+		.encrypt	= meson_skencrypt,
+		.decrypt	= meson_skdecrypt,
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_SKCIPHER,
+	.blockmode = MESON_OPMODE_ECB,
+	.swmode = MESON_SWMODE_XTS,
+	.alg.skcipher = {
+		.base = {
+			.cra_name = "xts(aes)",
+			.cra_driver_name = "xts-aes-gxl",
+			.cra_priority = 400,
+			.cra_blocksize = AES_BLOCK_SIZE,
+			.cra_flags = CRYPTO_ALG_TYPE_SKCIPHER |
+				CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+			.cra_ctxsize = sizeof(struct meson_cipher_tfm_ctx),
+			.cra_module = THIS_MODULE,
+			.cra_alignmask = 0xf,
+			.cra_init = meson_cipher_init,
+			.cra_exit = meson_cipher_exit,
+		},
+		.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+		.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+		.ivsize		= AES_BLOCK_SIZE,
+		.setkey		= meson_aes_xts_setkey,
+		.encrypt	= meson_skencrypt,
+		.decrypt	= meson_skdecrypt,
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AEAD,
+	.alg.aead = {
+		.base = {
+			.cra_name = "gcm(aes)",
+			.cra_driver_name = "gcm-aes-gxl",
+			.cra_priority = 400,
+			.cra_blocksize = 1,
+			.cra_flags = CRYPTO_ALG_ASYNC,
+			.cra_ctxsize = sizeof(struct meson_aead_tfm_ctx),
+			.cra_module = THIS_MODULE,
+		},
+		.ivsize		= GCM_AES_IV_SIZE,
+		.maxauthsize	= AES_BLOCK_SIZE,
+		.chunksize	= AES_BLOCK_SIZE,
+		.setkey		= meson_aead_setkey,
+		.setauthsize	= meson_aead_setauthsize,
+		.encrypt	= meson_aead_encrypt,
+		.decrypt	= meson_aead_decrypt,
+		.init		= meson_aead_init,
+		.exit		= meson_aead_exit,
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA1,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.halg = {
+			.digestsize = SHA1_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "sha1",
+				.cra_driver_name = "sha1-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA1_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA224,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.halg = {
+			.digestsize = SHA224_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "sha224",
+				.cra_driver_name = "sha224-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA224_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA256,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.halg = {
+			.digestsize = SHA256_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "sha256",
+				.cra_driver_name = "sha256-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA256_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA1,
+	.swmode = MESON_SWMODE_HMAC,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.setkey = meson_hash_setkey,
+		.halg = {
+			.digestsize = SHA1_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "hmac(sha1)",
+				.cra_driver_name = "hmac-sha1-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA1_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA224,
+	.swmode = MESON_SWMODE_HMAC,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.setkey = meson_hash_setkey,
+		.halg = {
+			.digestsize = SHA224_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "hmac(sha224)",
+				.cra_driver_name = "hmac-sha224-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA224_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
+{
+	.type = CRYPTO_ALG_TYPE_AHASH,
+	.hashmode = MODE_SHA256,
+	.swmode = MESON_SWMODE_HMAC,
+	.alg.hash = {
+		.init = meson_hash_init,
+		.update = meson_hash_update,
+		.final = meson_hash_final,
+		.finup = meson_hash_finup,
+		.digest = meson_hash_digest,
+		.export = meson_hash_export,
+		.import = meson_hash_import,
+		.setkey = meson_hash_setkey,
+		.halg = {
+			.digestsize = SHA256_DIGEST_SIZE,
+			.statesize = sizeof(struct meson_hash_state),
+			.base = {
+				.cra_name = "hmac(sha256)",
+				.cra_driver_name = "hmac-sha256-gxl",
+				.cra_priority = 400,
+				.cra_blocksize = SHA256_BLOCK_SIZE,
+				.cra_flags = CRYPTO_ALG_TYPE_AHASH |
+					CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK,
+				.cra_ctxsize = sizeof(struct meson_hash_tfm_ctx),
+				.cra_module = THIS_MODULE,
+				.cra_init = meson_hash_init_tfm,
+				.cra_exit = meson_hash_exit_tfm,
+			}
+		}
+	}
+},
 };
 
 #ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
 static int meson_dbgfs_read(struct seq_file *seq, void *v)
 {
 	struct meson_dev *mc = seq->private;
-	int i;
+	int i, j;
 
-	for (i = 0; i < MAXFLOW; i++)
-		seq_printf(seq, "Channel %d: nreq %lu\n", i, mc->chanlist[i].stat_req);
+	for (i = 0; i < MAXFLOW; i++) {
+		seq_printf(seq, "Channel %d: nreq %lu inflight %d\n", i,
+			   mc->chanlist[i].stat_req,
+			   atomic_read(&mc->chanlist[i].inflight));
+		seq_printf(seq, "Channel %d: batch", i);
+		for (j = 0; j < MESON_MAX_BATCH; j++)
+			seq_printf(seq, " %lu", mc->chanlist[i].stat_batch[j]);
+		seq_puts(seq, "\n");
+	}
 
 	for (i = 0; i < ARRAY_SIZE(mc_algs); i++) {
 		switch (mc_algs[i].type) {
 		case CRYPTO_ALG_TYPE_SKCIPHER:
-			seq_printf(seq, "%s %s %lu %lu\n",
+			seq_printf(seq, "%s %s %lu %lu %lu\n",
 				   mc_algs[i].alg.skcipher.base.cra_driver_name,
 				   mc_algs[i].alg.skcipher.base.cra_name,
+				   mc_algs[i].stat_req, mc_algs[i].stat_fb,
+				   mc_algs[i].stat_bb);
+			break;
+		case CRYPTO_ALG_TYPE_AEAD:
+			seq_printf(seq, "%s %s %lu\n",
+				   mc_algs[i].alg.aead.base.cra_driver_name,
+				   mc_algs[i].alg.aead.base.cra_name,
+				   mc_algs[i].stat_req);
+			break;
+		case CRYPTO_ALG_TYPE_AHASH:
+			seq_printf(seq, "%s %s %lu %lu\n",
+				   mc_algs[i].alg.hash.halg.base.cra_driver_name,
+				   mc_algs[i].alg.hash.halg.base.cra_name,
 				   mc_algs[i].stat_req, mc_algs[i].stat_fb);
 			break;
 		}
@@ -139,6 +418,11 @@ static void meson_free_chanlist(struct meson_dev *mc, int i)
 			dma_free_coherent(mc->dev, sizeof(struct meson_desc) * MAXDESC,
 					  mc->chanlist[i].tl,
 					  mc->chanlist[i].t_phy);
+		if (mc->chanlist[i].bounce) {
+			dma_unmap_single(mc->dev, mc->chanlist[i].bounce_phy,
+					 MESON_BOUNCE_SIZE, DMA_BIDIRECTIONAL);
+			kfree(mc->chanlist[i].bounce);
+		}
 		i--;
 	}
 }
@@ -178,6 +462,22 @@ static int meson_allocate_chanlist(struct meson_dev *mc)
 			err = -ENOMEM;
 			goto error_engine;
 		}
+		mc->chanlist[i].bounce = kzalloc(MESON_BOUNCE_SIZE, GFP_KERNEL);
+		if (!mc->chanlist[i].bounce) {
+			err = -ENOMEM;
+			goto error_engine;
+		}
+		mc->chanlist[i].bounce_phy = dma_map_single(mc->dev,
+							    mc->chanlist[i].bounce,
+							    MESON_BOUNCE_SIZE,
+							    DMA_BIDIRECTIONAL);
+		err = dma_mapping_error(mc->dev, mc->chanlist[i].bounce_phy);
+		if (err) {
+			dev_err(mc->dev, "Cannot DMA MAP bounce buffer\n");
+			kfree(mc->chanlist[i].bounce);
+			mc->chanlist[i].bounce = NULL;
+			goto error_engine;
+		}
 	}
 	return 0;
 error_engine:
@@ -201,6 +501,24 @@ static int meson_register_algs(struct meson_dev *mc)
 				return err;
 			}
 			break;
+		case CRYPTO_ALG_TYPE_AEAD:
+			err = crypto_register_aead(&mc_algs[i].alg.aead);
+			if (err) {
+				dev_err(mc->dev, "Fail to register %s\n",
+					mc_algs[i].alg.aead.base.cra_name);
+				mc_algs[i].mc = NULL;
+				return err;
+			}
+			break;
+		case CRYPTO_ALG_TYPE_AHASH:
+			err = crypto_register_ahash(&mc_algs[i].alg.hash);
+			if (err) {
+				dev_err(mc->dev, "Fail to register %s\n",
+					mc_algs[i].alg.hash.halg.base.cra_name);
+				mc_algs[i].mc = NULL;
+				return err;
+			}
+			break;
 		}
 	}
 
@@ -218,6 +536,12 @@ static void meson_unregister_algs(struct meson_dev *mc)
 		case CRYPTO_ALG_TYPE_SKCIPHER:
 			crypto_unregister_skcipher(&mc_algs[i].alg.skcipher);
 			break;
+		case CRYPTO_ALG_TYPE_AEAD:
+			crypto_unregister_aead(&mc_algs[i].alg.aead);
+			break;
+		case CRYPTO_ALG_TYPE_AHASH:
+			crypto_unregister_ahash(&mc_algs[i].alg.hash);
+			break;
 		}
 	}
 }
@@ -266,6 +590,11 @@ static int meson_crypto_probe(struct platform_device *pdev)
 		}
 	}
 
+	/* each flow has its own queue, let them complete on different CPUs */
+	err = devm_irq_spread_affinity(mc->dev, mc->irqs, MAXFLOW, NULL);
+	if (err)
+		dev_warn(mc->dev, "Cannot spread flow IRQs: %d\n", err);
+
 	err = clk_prepare_enable(mc->busclk);
 	if (err != 0) {
 		dev_err(&pdev->dev, "Cannot prepare_enable busclk\n");
@@ -0,0 +1,407 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * amlogic-gxl-hash.c - hardware cryptographic offloader for Amlogic GXL SoC
+ *
+ * This file add support for SHA1, SHA224 and SHA256 and their HMAC variants.
+ * The data is linearized in the bounce buffer of a flow and hashed by the
+ * hardware, the state being saved after each chunk so that a request can be
+ * exported and resumed at any point.
+ * For HMAC, the inner hash is done by the hardware, the key padding and the
+ * outer hash over the inner digest by the CPU.
+ */
+
+#include <linux/dma-mapping.h>
+#include <linux/scatterlist.h>
+#include <crypto/hmac.h>
+#include <crypto/internal/hash.h>
+#include "amlogic-gxl.h"
+
+static struct meson_alg_template *meson_hash_algt(struct crypto_ahash *tfm)
+{
+	struct ahash_alg *alg = __crypto_ahash_alg(tfm->base.__crt_alg);
+
+	return container_of(alg, struct meson_alg_template, alg.hash);
+}
+
+static const char *meson_hash_name(u32 hashmode)
+{
+	switch (hashmode) {
+	case MODE_SHA1:
+		return "sha1";
+	case MODE_SHA224:
+		return "sha224";
+	default:
+		return "sha256";
+	}
+}
+
+/*
+ * Store the digest of the message in the request result, doing the outer
+ * hash for HMAC.
+ */
+static int meson_hash_result(struct ahash_request *areq, const u8 *digest)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(areq);
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	struct meson_alg_template *algt = meson_hash_algt(tfm);
+	unsigned int ds = crypto_ahash_digestsize(tfm);
+	SHASH_DESC_ON_STACK(desc, op->fallback_tfm);
+	int err;
+
+	if (algt->swmode != MESON_SWMODE_HMAC) {
+		memcpy(areq->result, digest, ds);
+		return 0;
+	}
+
+	desc->tfm = op->fallback_tfm;
+	err = crypto_shash_init(desc) ?:
+	      crypto_shash_update(desc, op->opad,
+				  crypto_ahash_blocksize(tfm)) ?:
+	      crypto_shash_finup(desc, digest, ds, areq->result);
+	shash_desc_zero(desc);
+
+	return err;
+}
+
+/* Hash a message which never reached the hardware */
+static int meson_hash_do_fallback(struct ahash_request *areq)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(areq);
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	u8 digest[SHA256_DIGEST_SIZE];
+	SHASH_DESC_ON_STACK(desc, op->fallback_tfm);
+	int err;
+#ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
+	struct meson_alg_template *algt = meson_hash_algt(tfm);
+
+	algt->stat_fb++;
+#endif
+
+	desc->tfm = op->fallback_tfm;
+	err = crypto_shash_digest(desc, rctx->st.buf, rctx->st.buflen, digest);
+	shash_desc_zero(desc);
+	if (!err)
+		err = meson_hash_result(areq, digest);
+
+	memzero_explicit(digest, sizeof(digest));
+	memzero_explicit(&rctx->st, sizeof(rctx->st));
+	return err;
+}
+
+/*
+ * Copy len bytes starting at offset off of the message pending in the
+ * request, made of the buffered data followed by the request source.
+ */
+static void meson_hash_copy(struct ahash_request *areq, u8 *dst,
+			    unsigned int off, unsigned int len)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct meson_hash_state *st = &rctx->st;
+	unsigned int n = 0;
+
+	if (off < st->buflen) {
+		n = min(st->buflen - off, len);
+		memmove(dst, st->buf + off, n);
+	}
+	if (len > n)
+		sg_pcopy_to_buffer(areq->src, sg_nents(areq->src), dst + n,
+				   len - n, off + n - st->buflen);
+}
+
+/*
+ * Hash the first len bytes of the bounce buffer of a flow, resuming from
+ * the saved state unless this is the start of the message.
+ */
+static int meson_hash_submit(struct meson_hash_tfm_ctx *op, int flow,
+			     struct meson_hash_state *st, unsigned int len,
+			     bool end)
+{
+	struct meson_dev *mc = op->mc;
+	struct meson_flow *mf = &mc->chanlist[flow];
+	unsigned int state_off = MESON_BOUNCE_SIZE - MESON_HASH_STATE_SIZE;
+	dma_addr_t state_phy = mf->bounce_phy + state_off;
+	struct meson_desc *desc;
+	unsigned int tloffset = 0, i;
+	u32 v;
+
+	if (!st->first) {
+		memcpy(mf->bounce + state_off, st->hwstate,
+		       MESON_HASH_STATE_SIZE);
+		for (i = 0; i < MESON_HASH_STATE_SIZE / 16; i++) {
+			desc = &mf->tl[tloffset++];
+			desc->t_src = cpu_to_le32(state_phy + i * 16);
+			desc->t_dst = cpu_to_le32(i * 16);
+			v = (MODE_KEY << 20) | DESC_OWN | 16;
+			desc->t_status = cpu_to_le32(v);
+		}
+	}
+
+	desc = &mf->tl[tloffset];
+	desc->t_src = cpu_to_le32(mf->bounce_phy);
+	desc->t_dst = cpu_to_le32(state_phy);
+	v = (op->hashmode << 20) | DESC_OWN | DESC_LAST | len;
+	if (st->first)
+		v |= DESC_HASH_BEGIN;
+	if (end)
+		v |= DESC_HASH_END;
+	desc->t_status = cpu_to_le32(v);
+
+	dma_sync_single_for_device(mc->dev, mf->bounce_phy, len,
+				   DMA_BIDIRECTIONAL);
+	dma_sync_single_for_device(mc->dev, state_phy, MESON_HASH_STATE_SIZE,
+				   DMA_BIDIRECTIONAL);
+
+	reinit_completion(&mf->complete);
+	mf->status = 0;
+	writel(mf->t_phy | 2, mc->base + (flow << 2));
+	wait_for_completion_interruptible_timeout(&mf->complete,
+						  msecs_to_jiffies(500));
+	if (mf->status == 0) {
+		dev_err(mc->dev, "DMA timeout for flow %d\n", flow);
+		return -EINVAL;
+	}
+
+	dma_sync_single_for_cpu(mc->dev, state_phy, MESON_HASH_STATE_SIZE,
+				DMA_BIDIRECTIONAL);
+	memcpy(st->hwstate, mf->bounce + state_off, MESON_HASH_STATE_SIZE);
+	memzero_explicit(mf->bounce + state_off, MESON_HASH_STATE_SIZE);
+	st->first = false;
+
+	return 0;
+}
+
+static int meson_handle_hash_request(struct crypto_engine *engine, void *breq)
+{
+	struct ahash_request *areq = container_of(breq, struct ahash_request, base);
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(areq);
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct meson_hash_state *st = &rctx->st;
+	struct meson_dev *mc = op->mc;
+	int flow = rctx->flow;
+	struct meson_flow *mf = &mc->chanlist[flow];
+	unsigned int bs = crypto_ahash_blocksize(tfm);
+	unsigned int total = st->buflen + rctx->nbytes;
+	unsigned int hwlen, done, len;
+	int err = 0;
+#ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
+	struct meson_alg_template *algt = meson_hash_algt(tfm);
+
+	algt->stat_req++;
+	mf->stat_req++;
+	mf->stat_batch[0]++;
+#endif
+
+	/*
+	 * Only whole blocks are hashed before the final descriptor, which
+	 * always gets at least one byte.
+	 */
+	hwlen = round_down(total - 1, bs);
+
+	for (done = 0; done < hwlen; done += len) {
+		len = min_t(unsigned int, hwlen - done, MESON_HASH_CHUNK);
+		meson_hash_copy(areq, mf->bounce, done, len);
+		err = meson_hash_submit(op, flow, st, len, false);
+		memzero_explicit(mf->bounce, len);
+		if (err)
+			goto theend;
+	}
+
+	meson_hash_copy(areq, st->buf, hwlen, total - hwlen);
+	st->buflen = total - hwlen;
+
+	if (rctx->final) {
+		memcpy(mf->bounce, st->buf, st->buflen);
+		err = meson_hash_submit(op, flow, st, st->buflen, true);
+		memzero_explicit(mf->bounce, st->buflen);
+		if (!err)
+			err = meson_hash_result(areq, st->hwstate);
+		memzero_explicit(st, sizeof(*st));
+	}
+
+theend:
+	atomic_sub(rctx->inflight, &mf->inflight);
+	crypto_finalize_hash_request(engine, areq, err);
+	return 0;
+}
+
+static int meson_hash_enqueue(struct ahash_request *areq)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(areq);
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct crypto_engine *engine;
+	int e, err;
+
+	rctx->inflight = rctx->st.buflen + rctx->nbytes;
+	e = meson_get_engine_number(op->mc, rctx->inflight);
+	engine = op->mc->chanlist[e].engine;
+	rctx->flow = e;
+
+	err = crypto_transfer_hash_request_to_engine(engine, areq);
+	if (err != -EINPROGRESS && err != -EBUSY)
+		atomic_sub(rctx->inflight, &op->mc->chanlist[e].inflight);
+
+	return err;
+}
+
+int meson_hash_init(struct ahash_request *areq)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(areq);
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct meson_alg_template *algt = meson_hash_algt(tfm);
+	unsigned int bs = crypto_ahash_blocksize(tfm);
+
+	memset(rctx, 0, sizeof(*rctx));
+	rctx->st.first = true;
+
+	/* The inner HMAC hash starts with the padded key */
+	if (algt->swmode == MESON_SWMODE_HMAC) {
+		memcpy(rctx->st.buf, op->ipad, bs);
+		rctx->st.buflen = bs;
+	}
+
+	return 0;
+}
+
+int meson_hash_update(struct ahash_request *areq)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct meson_hash_state *st = &rctx->st;
+
+	if (!areq->nbytes)
+		return 0;
+
+	if (st->buflen + areq->nbytes <= MESON_HASH_BUF_LEN) {
+		sg_copy_to_buffer(areq->src, sg_nents(areq->src),
+				  st->buf + st->buflen, areq->nbytes);
+		st->buflen += areq->nbytes;
+		return 0;
+	}
+
+	rctx->nbytes = areq->nbytes;
+	rctx->final = false;
+
+	return meson_hash_enqueue(areq);
+}
+
+int meson_hash_final(struct ahash_request *areq)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+
+	if (rctx->st.first)
+		return meson_hash_do_fallback(areq);
+
+	rctx->nbytes = 0;
+	rctx->final = true;
+
+	return meson_hash_enqueue(areq);
+}
+
+int meson_hash_finup(struct ahash_request *areq)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+	struct meson_hash_state *st = &rctx->st;
+
+	if (st->first && st->buflen + areq->nbytes <= MESON_HASH_BUF_LEN) {
+		sg_copy_to_buffer(areq->src, sg_nents(areq->src),
+				  st->buf + st->buflen, areq->nbytes);
+		st->buflen += areq->nbytes;
+		return meson_hash_do_fallback(areq);
+	}
+
+	rctx->nbytes = areq->nbytes;
+	rctx->final = true;
+
+	return meson_hash_enqueue(areq);
+}
+
+int meson_hash_digest(struct ahash_request *areq)
+{
+	return meson_hash_init(areq) ?: meson_hash_finup(areq);
+}
+
+int meson_hash_export(struct ahash_request *areq, void *out)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+
+	memcpy(out, &rctx->st, sizeof(rctx->st));
+	return 0;
+}
+
+int meson_hash_import(struct ahash_request *areq, const void *in)
+{
+	struct meson_hash_req_ctx *rctx = ahash_request_ctx(areq);
+
+	memset(rctx, 0, sizeof(*rctx));
+	memcpy(&rctx->st, in, sizeof(rctx->st));
+	return 0;
+}
+
+int meson_hash_setkey(struct crypto_ahash *tfm, const u8 *key,
+		      unsigned int keylen)
+{
+	struct meson_hash_tfm_ctx *op = crypto_ahash_ctx(tfm);
+	unsigned int bs = crypto_ahash_blocksize(tfm);
+	SHASH_DESC_ON_STACK(desc, op->fallback_tfm);
+	unsigned int i;
+	int err;
+
+	memset(op->ipad, 0, sizeof(op->ipad));
+	if (keylen > bs) {
+		desc->tfm = op->fallback_tfm;
+		err = crypto_shash_digest(desc, key, keylen, op->ipad);
+		shash_desc_zero(desc);
+		if (err)
+			return err;
+	} else {
+		memcpy(op->ipad, key, keylen);
+	}
+
+	memcpy(op->opad, op->ipad, bs);
+	for (i = 0; i < bs; i++) {
+		op->ipad[i] ^= HMAC_IPAD_VALUE;
+		op->opad[i] ^= HMAC_OPAD_VALUE;
+	}
+
+	return 0;
+}
+
+int meson_hash_init_tfm(struct crypto_tfm *tfm)
+{
+	struct meson_hash_tfm_ctx *op = crypto_tfm_ctx(tfm);
+	struct crypto_ahash *ahash = __crypto_ahash_cast(tfm);
+	struct meson_alg_template *algt = meson_hash_algt(ahash);
+	const char *name = meson_hash_name(algt->hashmode);
+
+	memset(op, 0, sizeof(struct meson_hash_tfm_ctx));
+
+	op->mc = algt->mc;
+	op->hashmode = algt->hashmode;
+
+	crypto_ahash_set_reqsize(ahash, sizeof(struct meson_hash_req_ctx));
+
+	op->fallback_tfm = crypto_alloc_shash(name, 0, CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(op->fallback_tfm)) {
+		dev_err(op->mc->dev, "ERROR: Cannot allocate fallback for %s %ld\n",
+			name, PTR_ERR(op->fallback_tfm));
+		return PTR_ERR(op->fallback_tfm);
+	}
+
+	op->enginectx.op.do_one_request = meson_handle_hash_request;
+	op->enginectx.op.prepare_request = NULL;
+	op->enginectx.op.unprepare_request = NULL;
+
+	return 0;
+}
+
+void meson_hash_exit_tfm(struct crypto_tfm *tfm)
+{
+	struct meson_hash_tfm_ctx *op = crypto_tfm_ctx(tfm);
+
+	memzero_explicit(op->ipad, sizeof(op->ipad));
+	memzero_explicit(op->opad, sizeof(op->opad));
+	crypto_free_shash(op->fallback_tfm);
+}
@@ -4,14 +4,21 @@
  *
  * Copyright (C) 2018-2019 Corentin LABBE <clabbe@baylibre.com>
  */
+#include <crypto/aead.h>
 #include <crypto/aes.h>
 #include <crypto/engine.h>
+#include <crypto/hash.h>
+#include <crypto/sha.h>
 #include <crypto/skcipher.h>
 #include <linux/debugfs.h>
 #include <linux/crypto.h>
 #include <linux/scatterlist.h>
+#include <linux/sizes.h>
 
 #define MODE_KEY 1
+#define MODE_SHA1 0x4
+#define MODE_SHA256 0x5
+#define MODE_SHA224 0x6
 #define MODE_AES_128 0x8
 #define MODE_AES_192 0x9
 #define MODE_AES_256 0xa
@@ -22,11 +29,34 @@
 #define MESON_OPMODE_ECB 0
 #define MESON_OPMODE_CBC 1
 
+/* Modes done with the hardware in ECB mode and the CPU doing the rest */
+#define MESON_SWMODE_NONE 0
+#define MESON_SWMODE_CTR 1
+#define MESON_SWMODE_XTS 2
+#define MESON_SWMODE_HMAC 3
+
 #define MAXFLOW 2
 
 #define MAXDESC 64
 
+/*
+ * Requests whose scatterlists cannot be handed to the hardware as-is are
+ * linearized into a per-flow bounce buffer of MESON_BOUNCE_SIZE bytes.
+ * Below MESON_BOUNCE_MIN_LEN the copy and the IRQ round trip cost more than
+ * doing the work in software, so such requests still use the fallback.
+ */
+#define MESON_BOUNCE_SIZE	SZ_64K
+#define MESON_BOUNCE_MIN_LEN	512
+
+/*
+ * Maximum number of requests packed in the descriptor ring of a flow, each
+ * request needs at least one key descriptor and one data descriptor.
+ */
+#define MESON_MAX_BATCH	(MAXDESC / 2)
+
 #define DESC_LAST BIT(18)
+#define DESC_HASH_BEGIN BIT(24)
+#define DESC_HASH_END BIT(25)
 #define DESC_ENCRYPTION BIT(28)
 #define DESC_OWN BIT(31)
 
@@ -42,8 +72,8 @@
  * @eoc:	18	End means the descriptor is the last
  * @loop:	19	Unknown
  * @mode:	20-23	Type of algorithm (AES, SHA)
- * @begin:	24	Unknown
- * @end:	25	Unknown
+ * @begin:	24	SHA: start from the initial hash value
+ * @end:	25	SHA: pad the message and write the digest
  * @op_mode:	26-27	Blockmode (CBC, ECB)
  * @enc:	28	0 means decryption, 1 is for encryption
  * @block:	29	Unknown
@@ -64,7 +94,11 @@ struct meson_desc {
  * @status:	set to 1 by interrupt if task is done
  * @t_phy:	Physical address of task
  * @tl:		pointer to the current ce_task for this flow
+ * @bounce:	bounce buffer used for linearizing unaligned requests
+ * @bounce_phy:	DMA address of the bounce buffer
+ * @inflight:	number of bytes queued or in progress on this flow
  * @stat_req:	number of request done by this flow
+ * @stat_batch:	histogram of the number of requests done per interrupt
  */
 struct meson_flow {
 	struct crypto_engine *engine;
@@ -73,8 +107,12 @@ struct meson_flow {
 	unsigned int keylen;
 	dma_addr_t t_phy;
 	struct meson_desc *tl;
+	void *bounce;
+	dma_addr_t bounce_phy;
+	atomic_t inflight;
 #ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
 	unsigned long stat_req;
+	unsigned long stat_batch[MESON_MAX_BATCH];
 #endif
 };
 
@@ -84,7 +122,7 @@ struct meson_flow {
  * @busclk:	bus clock for amlogic-crypto
  * @dev:	the platform device
  * @chanlist:	array of all flow
- * @flow:	flow to use in next request
+ * @flow:	flow where the search for the least loaded flow begins
  * @irqs:	IRQ numbers for amlogic-crypto
  * @dbgfs_dir:	Debugfs dentry for statistic directory
  * @dbgfs_stats: Debugfs dentry for statistic counters
@@ -105,10 +143,28 @@ struct meson_dev {
  * struct meson_cipher_req_ctx - context for a skcipher request
  * @op_dir:	direction (encrypt vs decrypt) for this request
  * @flow:	the flow to use for this request
+ * @bounce:	true if the request must go through the flow bounce buffer
+ * @bounce_off:	offset of the request data in the flow bounce buffer
+ * @bkeyiv:	buffer holding the key and IV given to the hardware
+ * @phykeyiv:	DMA address of bkeyiv
+ * @keyivlen:	mapped length of bkeyiv, 0 if not mapped
+ * @backup_iv:	last ciphertext block, used as next IV when decrypting
+ * @nr_sgs:	number of mapped source SG entries
+ * @nr_sgd:	number of mapped destination SG entries
+ * @sw_iv:	next counter for CTR, first tweak for XTS
  */
 struct meson_cipher_req_ctx {
 	u32 op_dir;
 	int flow;
+	bool bounce;
+	unsigned int bounce_off;
+	void *bkeyiv;
+	dma_addr_t phykeyiv;
+	unsigned int keyivlen;
+	void *backup_iv;
+	int nr_sgs;
+	int nr_sgd;
+	u8 sw_iv[AES_BLOCK_SIZE];
 };
 
 /*
@@ -119,6 +175,7 @@ struct meson_cipher_req_ctx {
  * @keymode:		The keymode(type and size of key) associated with this TFM
  * @mc:			pointer to the private data of driver handling this TFM
  * @fallback_tfm:	pointer to the fallback TFM
+ * @tweak_key:		expanded tweak key, only used by XTS
  */
 struct meson_cipher_tfm_ctx {
 	struct crypto_engine_ctx enginectx;
@@ -127,35 +184,141 @@ struct meson_cipher_tfm_ctx {
 	u32 keymode;
 	struct meson_dev *mc;
 	struct crypto_sync_skcipher *fallback_tfm;
+	struct crypto_aes_ctx tweak_key;
+};
+
+/*
+ * The hardware writes the intermediate SHA state, followed by the message
+ * length it needs for padding, to t_dst. This state is given back with
+ * MODE_KEY descriptors for resuming a partially hashed message.
+ */
+#define MESON_HASH_STATE_SIZE	48
+
+/*
+ * Updates are buffered until more than MESON_HASH_BUF_LEN bytes are
+ * pending, and messages which never grow beyond it are hashed by the CPU.
+ */
+#define MESON_HASH_BUF_LEN	(4 * SHA256_BLOCK_SIZE)
+
+/* Largest multiple of the block size fitting in the bounce buffer */
+#define MESON_HASH_CHUNK	(MESON_BOUNCE_SIZE - SHA256_BLOCK_SIZE)
+
+/*
+ * struct meson_hash_state - exported state of a hash request
+ * @hwstate:	state written by the hardware, valid if @first is false
+ * @buf:	data not yet given to the hardware
+ * @buflen:	number of bytes in @buf
+ * @first:	true until the hardware has processed some data
+ */
+struct meson_hash_state {
+	u8 hwstate[MESON_HASH_STATE_SIZE];
+	u8 buf[MESON_HASH_BUF_LEN];
+	unsigned int buflen;
+	bool first;
+};
+
+/*
+ * struct meson_hash_req_ctx - context for an ahash request
+ * @st:		state of the message being hashed
+ * @flow:	the flow to use for this request
+ * @nbytes:	number of bytes of the request source to hash
+ * @inflight:	number of bytes accounted in the inflight counter of @flow
+ * @final:	true if the digest must be computed after @nbytes
+ */
+struct meson_hash_req_ctx {
+	struct meson_hash_state st;
+	int flow;
+	unsigned int nbytes;
+	unsigned int inflight;
+	bool final;
+};
+
+/*
+ * struct meson_hash_tfm_ctx - context for an ahash TFM
+ * @enginectx:		crypto_engine used by this TFM
+ * @mc:			pointer to the private data of driver handling this TFM
+ * @hashmode:		descriptor mode for this hash
+ * @fallback_tfm:	CPU implementation of the hash
+ * @ipad:		HMAC key XORed with the inner pad
+ * @opad:		HMAC key XORed with the outer pad
+ */
+struct meson_hash_tfm_ctx {
+	struct crypto_engine_ctx enginectx;
+	struct meson_dev *mc;
+	u32 hashmode;
+	struct crypto_shash *fallback_tfm;
+	u8 ipad[SHA256_BLOCK_SIZE];
+	u8 opad[SHA256_BLOCK_SIZE];
+};
+
+/*
+ * struct meson_aead_tfm_ctx - context for an AEAD TFM
+ * @mc:		pointer to the private data of driver handling this TFM
+ * @child:	gcm_base instance doing the work on top of ctr-aes-gxl
+ */
+struct meson_aead_tfm_ctx {
+	struct meson_dev *mc;
+	struct crypto_aead *child;
 };
 
 /*
  * struct meson_alg_template - crypto_alg template
  * @type:		the CRYPTO_ALG_TYPE for this template
  * @blockmode:		the type of block operation
+ * @swmode:		the mode done by the CPU on top of blockmode
+ * @hashmode:		the descriptor mode of a hash
  * @mc:			pointer to the meson_dev structure associated with this template
  * @alg:		one of sub struct must be used
  * @stat_req:		number of request done on this template
- * @stat_fb:		total of all data len done on this template
+ * @stat_fb:		number of request done by the fallback
+ * @stat_bb:		number of request done through a bounce buffer
  */
 struct meson_alg_template {
 	u32 type;
 	u32 blockmode;
+	u32 swmode;
+	u32 hashmode;
 	union {
 		struct skcipher_alg skcipher;
+		struct aead_alg aead;
+		struct ahash_alg hash;
 	} alg;
 	struct meson_dev *mc;
 #ifdef CONFIG_CRYPTO_DEV_AMLOGIC_GXL_DEBUG
 	unsigned long stat_req;
 	unsigned long stat_fb;
+	unsigned long stat_bb;
 #endif
 };
 
 int meson_enqueue(struct crypto_async_request *areq, u32 type);
+int meson_get_engine_number(struct meson_dev *mc, unsigned int len);
 
 int meson_aes_setkey(struct crypto_skcipher *tfm, const u8 *key,
 		     unsigned int keylen);
+int meson_aes_xts_setkey(struct crypto_skcipher *tfm, const u8 *key,
+			 unsigned int keylen);
 int meson_cipher_init(struct crypto_tfm *tfm);
 void meson_cipher_exit(struct crypto_tfm *tfm);
 int meson_skdecrypt(struct skcipher_request *areq);
 int meson_skencrypt(struct skcipher_request *areq);
+
+int meson_aead_setkey(struct crypto_aead *tfm, const u8 *key,
+		      unsigned int keylen);
+int meson_aead_setauthsize(struct crypto_aead *tfm, unsigned int authsize);
+int meson_aead_init(struct crypto_aead *tfm);
+void meson_aead_exit(struct crypto_aead *tfm);
+int meson_aead_encrypt(struct aead_request *req);
+int meson_aead_decrypt(struct aead_request *req);
+
+int meson_hash_init_tfm(struct crypto_tfm *tfm);
+void meson_hash_exit_tfm(struct crypto_tfm *tfm);
+int meson_hash_init(struct ahash_request *areq);
+int meson_hash_update(struct ahash_request *areq);
+int meson_hash_final(struct ahash_request *areq);
+int meson_hash_finup(struct ahash_request *areq);
+int meson_hash_digest(struct ahash_request *areq);
+int meson_hash_export(struct ahash_request *areq, void *out);
+int meson_hash_import(struct ahash_request *areq, const void *in);
+int meson_hash_setkey(struct crypto_ahash *tfm, const u8 *key,
+		      unsigned int keylen);
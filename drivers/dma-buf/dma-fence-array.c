@@ -42,10 +42,25 @@ static void dma_fence_array_clear_pending_error(struct dma_fence_array *array)
 	cmpxchg(&array->base.error, PENDING_ERROR, 0);
 }
 
+static void dma_fence_array_collect_errors(struct dma_fence_array *array)
+{
+	unsigned i;
+
+	/*
+	 * Fences skipped by dma_fence_array_is_covered() never reported their
+	 * error through a callback, pick it up now that they are signaled.
+	 */
+	for (i = 0; i < array->num_fences; ++i)
+		dma_fence_array_set_pending_error(array,
+						  array->fences[i]->error);
+}
+
 static void irq_dma_fence_array_work(struct irq_work *wrk)
 {
 	struct dma_fence_array *array = container_of(wrk, typeof(*array), work);
 
+	if (!array->signal_on_any)
+		dma_fence_array_collect_errors(array);
 	dma_fence_array_clear_pending_error(array);
 
 	dma_fence_signal(&array->base);
@@ -67,6 +82,31 @@ static void dma_fence_array_cb_func(struct dma_fence *f,
 		dma_fence_put(&array->base);
 }
 
+/*
+ * Fences sharing a context signal in seqno order, so waiting for all of them
+ * only needs a callback on the latest one. Returns true if fence @i is
+ * implied by a later (or, for duplicates, a following) fence of the array.
+ */
+static bool dma_fence_array_is_covered(struct dma_fence_array *array,
+				       unsigned i)
+{
+	struct dma_fence *fence = array->fences[i];
+	unsigned j;
+
+	for (j = 0; j < array->num_fences; ++j) {
+		struct dma_fence *other = array->fences[j];
+
+		if (j == i || other->context != fence->context)
+			continue;
+
+		if (dma_fence_is_later(other, fence) ||
+		    (other->seqno == fence->seqno && j > i))
+			return true;
+	}
+
+	return false;
+}
+
 static bool dma_fence_array_enable_signaling(struct dma_fence *fence)
 {
 	struct dma_fence_array *array = to_dma_fence_array(fence);
@@ -75,6 +115,17 @@ static bool dma_fence_array_enable_signaling(struct dma_fence *fence)
 
 	for (i = 0; i < array->num_fences; ++i) {
 		cb[i].array = array;
+
+		if (!array->signal_on_any &&
+		    dma_fence_array_is_covered(array, i)) {
+			if (atomic_dec_and_test(&array->num_pending)) {
+				dma_fence_array_collect_errors(array);
+				dma_fence_array_clear_pending_error(array);
+				return false;
+			}
+			continue;
+		}
+
 		/*
 		 * As we may report that the fence is signaled before all
 		 * callbacks are complete, we need to take an additional
@@ -91,6 +142,8 @@ static bool dma_fence_array_enable_signaling(struct dma_fence *fence)
 			dma_fence_array_set_pending_error(array, error);
 			dma_fence_put(&array->base);
 			if (atomic_dec_and_test(&array->num_pending)) {
+				if (!array->signal_on_any)
+					dma_fence_array_collect_errors(array);
 				dma_fence_array_clear_pending_error(array);
 				return false;
 			}
@@ -145,7 +198,9 @@ EXPORT_SYMBOL(dma_fence_array_ops);
  * array is taken and dma_fence_put() is used on each fence on release.
  *
  * If @signal_on_any is true the fence array signals if any fence in the array
- * signals, otherwise it signals when all fences in the array signal.
+ * signals, otherwise it signals when all fences in the array signal. In the
+ * latter case only the latest fence of each context gets a callback
+ * installed, the earlier ones are implied by it.
  */
 struct dma_fence_array *dma_fence_array_create(int num_fences,
 					       struct dma_fence **fences,
@@ -169,6 +224,7 @@ struct dma_fence_array *dma_fence_array_create(int num_fences,
 	array->num_fences = num_fences;
 	atomic_set(&array->num_pending, signal_on_any ? 1 : num_fences);
 	array->fences = fences;
+	array->signal_on_any = signal_on_any;
 
 	array->base.error = PENDING_ERROR;
 
@@ -174,6 +174,10 @@ int dma_fence_signal(struct dma_fence *fence)
 	if (!fence)
 		return -EINVAL;
 
+	/* Already signaled fences don't need the lock, nothing to do. */
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags))
+		return -EINVAL;
+
 	spin_lock_irqsave(fence->lock, flags);
 	ret = dma_fence_signal_locked(fence);
 	spin_unlock_irqrestore(fence->lock, flags);
@@ -390,6 +394,15 @@ int dma_fence_get_status(struct dma_fence *fence)
 	unsigned long flags;
 	int status;
 
+	/*
+	 * The error is set before the signaled bit, which is flipped with a
+	 * fully ordered test_and_set_bit(), so this can go without the lock.
+	 */
+	if (test_bit(DMA_FENCE_FLAG_SIGNALED_BIT, &fence->flags)) {
+		smp_rmb();
+		return fence->error ?: 1;
+	}
+
 	spin_lock_irqsave(fence->lock, flags);
 	status = dma_fence_get_status_locked(fence);
 	spin_unlock_irqrestore(fence->lock, flags);
@@ -28,6 +28,7 @@
  * @name:		used for debugging/device-node name
  * @ops:		ops struct for this heap
  * @heap_devt		heap device node
+ * @dev			heap device
  * @list		list head connecting to list of heaps
  * @heap_cdev		heap char device
  *
@@ -38,6 +39,7 @@ struct dma_heap {
 	const struct dma_heap_ops *ops;
 	void *priv;
 	dev_t heap_devt;
+	struct device *dev;
 	struct list_head list;
 	struct cdev heap_cdev;
 };
@@ -190,6 +192,18 @@ void *dma_heap_get_drvdata(struct dma_heap *heap)
 	return heap->priv;
 }
 
+/**
+ * dma_heap_get_dev() - get device struct for the heap
+ * @heap: DMA-Heap to retrieve device struct from
+ *
+ * Returns:
+ * The device struct for the heap.
+ */
+struct device *dma_heap_get_dev(struct dma_heap *heap)
+{
+	return heap->dev;
+}
+
 struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info)
 {
 	struct dma_heap *heap, *h, *err_ret;
@@ -257,6 +271,7 @@ struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info)
 		err_ret = ERR_CAST(dev_ret);
 		goto err2;
 	}
+	heap->dev = dev_ret;
 	/* Add heap to the list */
 	mutex_lock(&heap_list_lock);
 	list_add(&heap->list, &heap_list);
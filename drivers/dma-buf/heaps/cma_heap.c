@@ -4,6 +4,11 @@
  *
  * Copyright (C) 2012, 2019 Linaro Ltd.
  * Author: <benjamin.gaignard@linaro.org> for ST-Ericsson.
+ *
+ * Each CMA area gets a cached heap named after it, whose buffers are synced
+ * in begin/end_cpu_access, and an uncached "<name>-uncached" heap for buffers
+ * the CPU does not read, e.g. scanout or decode targets. Besides the default
+ * area, the DT reserved-memory regions marked "linux,dma-heap" are exported.
  */
 
 #include <linux/cma.h>
@@ -11,6 +16,7 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-heap.h>
 #include <linux/dma-contiguous.h>
+#include <linux/dma-mapping.h>
 #include <linux/err.h>
 #include <linux/errno.h>
 #include <linux/highmem.h>
@@ -24,6 +30,7 @@
 struct cma_heap {
 	struct dma_heap *heap;
 	struct cma *cma;
+	bool uncached;
 };
 
 static void cma_heap_free(struct heap_helper_buffer *buffer)
@@ -65,6 +72,7 @@ static int cma_heap_allocate(struct dma_heap *heap,
 	init_heap_helper_buffer(helper_buffer, cma_heap_free);
 	helper_buffer->heap = heap;
 	helper_buffer->size = len;
+	helper_buffer->uncached = cma_heap->uncached;
 
 	cma_pages = cma_alloc(cma_heap->cma, nr_pages, align, false);
 	if (!cma_pages)
@@ -93,6 +101,22 @@ static int cma_heap_allocate(struct dma_heap *heap,
 		memset(page_address(cma_pages), 0, size);
 	}
 
+	/*
+	 * Write the zeroes back and drop any line of the cacheable alias
+	 * now, as uncached buffers never see any cache maintenance later.
+	 */
+	if (cma_heap->uncached) {
+		struct device *dev = dma_heap_get_dev(heap);
+		dma_addr_t addr;
+
+		addr = dma_map_page(dev, cma_pages, 0, size,
+				    DMA_BIDIRECTIONAL);
+		if (dma_mapping_error(dev, addr))
+			goto free_cma;
+		dma_unmap_page_attrs(dev, addr, size, DMA_BIDIRECTIONAL,
+				     DMA_ATTR_SKIP_CPU_SYNC);
+	}
+
 	helper_buffer->pagecount = nr_pages;
 	helper_buffer->pages = kmalloc_array(helper_buffer->pagecount,
 					     sizeof(*helper_buffer->pages),
@@ -137,7 +161,8 @@ static const struct dma_heap_ops cma_heap_ops = {
 	.allocate = cma_heap_allocate,
 };
 
-static int __add_cma_heap(struct cma *cma, void *data)
+static int __add_cma_heap_variant(struct cma *cma, const char *name,
+				  bool uncached)
 {
 	struct cma_heap *cma_heap;
 	struct dma_heap_export_info exp_info;
@@ -146,8 +171,9 @@ static int __add_cma_heap(struct cma *cma, void *data)
 	if (!cma_heap)
 		return -ENOMEM;
 	cma_heap->cma = cma;
+	cma_heap->uncached = uncached;
 
-	exp_info.name = cma_get_name(cma);
+	exp_info.name = name;
 	exp_info.ops = &cma_heap_ops;
 	exp_info.priv = cma_heap;
 
@@ -159,19 +185,55 @@ static int __add_cma_heap(struct cma *cma, void *data)
 		return ret;
 	}
 
+	/* the heap device is what uncached buffers are flushed through */
+	if (uncached)
+		dma_coerce_mask_and_coherent(dma_heap_get_dev(cma_heap->heap),
+					     DMA_BIT_MASK(64));
+
 	return 0;
 }
 
-static int add_default_cma_heap(void)
+static int __add_cma_heap(struct cma *cma, void *data)
+{
+	const char *name;
+	int ret;
+
+	ret = __add_cma_heap_variant(cma, cma_get_name(cma), false);
+	if (ret)
+		return ret;
+
+	name = kasprintf(GFP_KERNEL, "%s-uncached", cma_get_name(cma));
+	if (!name)
+		return -ENOMEM;
+
+	ret = __add_cma_heap_variant(cma, name, true);
+	if (ret)
+		kfree(name);
+
+	return ret;
+}
+
+/* a failure on one area should not keep the other heaps from being added */
+static int add_cma_heap_area(struct cma *cma, void *data)
+{
+	int ret = __add_cma_heap(cma, data);
+
+	if (ret)
+		pr_err("cma_heap: failed to add heaps for %s: %d\n",
+		       cma_get_name(cma), ret);
+
+	return 0;
+}
+
+static int add_cma_heaps(void)
 {
 	struct cma *default_cma = dev_get_cma_area(NULL);
-	int ret = 0;
 
 	if (default_cma)
-		ret = __add_cma_heap(default_cma, NULL);
+		add_cma_heap_area(default_cma, NULL);
 
-	return ret;
+	return dma_contiguous_for_each_heap_area(add_cma_heap_area, NULL);
 }
-module_init(add_default_cma_heap);
+module_init(add_cma_heaps);
 MODULE_DESCRIPTION("DMA-BUF CMA Heap");
 MODULE_LICENSE("GPL v2");
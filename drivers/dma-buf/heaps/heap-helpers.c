@@ -22,6 +22,7 @@ void init_heap_helper_buffer(struct heap_helper_buffer *buffer,
 	buffer->pagecount = 0;
 	buffer->pages = NULL;
 	INIT_LIST_HEAD(&buffer->attachments);
+	buffer->uncached = false;
 	buffer->free = free;
 }
 
@@ -40,9 +41,13 @@ struct dma_buf *heap_helper_export_dmabuf(struct heap_helper_buffer *buffer,
 
 static void *dma_heap_map_kernel(struct heap_helper_buffer *buffer)
 {
+	pgprot_t pgprot = PAGE_KERNEL;
 	void *vaddr;
 
-	vaddr = vmap(buffer->pages, buffer->pagecount, VM_MAP, PAGE_KERNEL);
+	if (buffer->uncached)
+		pgprot = pgprot_writecombine(PAGE_KERNEL);
+
+	vaddr = vmap(buffer->pages, buffer->pagecount, VM_MAP, pgprot);
 	if (!vaddr)
 		return ERR_PTR(-ENOMEM);
 
@@ -140,12 +145,18 @@ struct sg_table *dma_heap_map_dma_buf(struct dma_buf_attachment *attachment,
 				      enum dma_data_direction direction)
 {
 	struct dma_heaps_attachment *a = attachment->priv;
+	struct heap_helper_buffer *buffer = attachment->dmabuf->priv;
+	unsigned long attrs = 0;
 	struct sg_table *table;
 
 	table = &a->table;
 
-	if (!dma_map_sg(attachment->dev, table->sgl, table->nents,
-			direction))
+	/* uncached buffers were flushed once and for all at allocation */
+	if (buffer->uncached)
+		attrs = DMA_ATTR_SKIP_CPU_SYNC;
+
+	if (!dma_map_sg_attrs(attachment->dev, table->sgl, table->nents,
+			      direction, attrs))
 		table = ERR_PTR(-ENOMEM);
 	return table;
 }
@@ -154,7 +165,14 @@ static void dma_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				   struct sg_table *table,
 				   enum dma_data_direction direction)
 {
-	dma_unmap_sg(attachment->dev, table->sgl, table->nents, direction);
+	struct heap_helper_buffer *buffer = attachment->dmabuf->priv;
+	unsigned long attrs = 0;
+
+	if (buffer->uncached)
+		attrs = DMA_ATTR_SKIP_CPU_SYNC;
+
+	dma_unmap_sg_attrs(attachment->dev, table->sgl, table->nents,
+			   direction, attrs);
 }
 
 static vm_fault_t dma_heap_vm_fault(struct vm_fault *vmf)
@@ -182,6 +200,9 @@ static int dma_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	if ((vma->vm_flags & (VM_SHARED | VM_MAYSHARE)) == 0)
 		return -EINVAL;
 
+	if (buffer->uncached)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
 	vma->vm_ops = &dma_heap_vm_ops;
 	vma->vm_private_data = buffer;
 
@@ -202,6 +223,9 @@ static int dma_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct dma_heaps_attachment *a;
 	int ret = 0;
 
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -222,6 +246,9 @@ static int dma_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct heap_helper_buffer *buffer = dmabuf->priv;
 	struct dma_heaps_attachment *a;
 
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -24,6 +24,8 @@
  * @pagecount		number of pages in the buffer
  * @pages		list of page pointers
  * @attachments		list of device attachments
+ * @uncached		buffer is mapped write-combined for the CPU, and its
+ *			caches are never maintained after allocation
  *
  * @free		heap callback to free the buffer
  */
@@ -39,6 +41,7 @@ struct heap_helper_buffer {
 	pgoff_t pagecount;
 	struct page **pages;
 	struct list_head attachments;
+	bool uncached;
 
 	void (*free)(struct heap_helper_buffer *buffer);
 };
@@ -3,6 +3,7 @@
 #include <linux/device.h>
 #include <linux/dma-buf.h>
 #include <linux/highmem.h>
+#include <linux/hugetlb.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/memfd.h>
@@ -58,9 +59,15 @@ static struct sg_table *get_sg_table(struct device *dev, struct dma_buf *buf,
 	sg = kzalloc(sizeof(*sg), GFP_KERNEL);
 	if (!sg)
 		return ERR_PTR(-ENOMEM);
-	ret = sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
-					0, ubuf->pagecount << PAGE_SHIFT,
-					GFP_KERNEL);
+	/*
+	 * Physically contiguous pages (hugetlbfs backing, or shmem pages that
+	 * happen to be adjacent) are merged into one entry, as large as the
+	 * importing device allows.
+	 */
+	ret = __sg_alloc_table_from_pages(sg, ubuf->pages, ubuf->pagecount,
+					  0, ubuf->pagecount << PAGE_SHIFT,
+					  dma_get_max_seg_size(dev),
+					  GFP_KERNEL);
 	if (ret < 0)
 		goto err;
 	if (!dma_map_sg(dev, sg->sgl, sg->nents, direction)) {
@@ -161,10 +168,13 @@ static long udmabuf_create(struct miscdevice *device,
 {
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
 	struct file *memfd = NULL;
+	struct address_space *mapping;
 	struct udmabuf *ubuf;
 	struct dma_buf *buf;
 	pgoff_t pgoff, pgcnt, pgidx, pgbuf = 0, pglimit;
-	struct page *page;
+	pgoff_t subpgoff, maxsubpgs;
+	struct hstate *hpstate;
+	struct page *page, *hpage = NULL;
 	int seals, ret = -EINVAL;
 	u32 i, flags;
 
@@ -195,7 +205,8 @@ static long udmabuf_create(struct miscdevice *device,
 		memfd = fget(list[i].memfd);
 		if (!memfd)
 			goto err;
-		if (!shmem_mapping(file_inode(memfd)->i_mapping))
+		mapping = file_inode(memfd)->i_mapping;
+		if (!shmem_mapping(mapping) && !is_file_hugepages(memfd))
 			goto err;
 		seals = memfd_fcntl(memfd, F_GET_SEALS, 0);
 		if (seals == -EINVAL)
@@ -206,15 +217,48 @@ static long udmabuf_create(struct miscdevice *device,
 			goto err;
 		pgoff = list[i].offset >> PAGE_SHIFT;
 		pgcnt = list[i].size   >> PAGE_SHIFT;
+		subpgoff = 0;
+		maxsubpgs = 0;
+		if (is_file_hugepages(memfd)) {
+			/* hugetlbfs indexes its page cache in huge pages */
+			hpstate = hstate_file(memfd);
+			pgoff = list[i].offset >> huge_page_shift(hpstate);
+			subpgoff = (list[i].offset &
+				    ~huge_page_mask(hpstate)) >> PAGE_SHIFT;
+			maxsubpgs = huge_page_size(hpstate) >> PAGE_SHIFT;
+		}
 		for (pgidx = 0; pgidx < pgcnt; pgidx++) {
-			page = shmem_read_mapping_page(
-				file_inode(memfd)->i_mapping, pgoff + pgidx);
-			if (IS_ERR(page)) {
-				ret = PTR_ERR(page);
-				goto err;
+			if (is_file_hugepages(memfd)) {
+				if (!hpage) {
+					hpage = find_get_page_flags(mapping,
+							pgoff, FGP_ACCESSED);
+					if (!hpage) {
+						ret = -EINVAL;
+						goto err;
+					}
+				}
+				page = hpage + subpgoff;
+				get_page(page);
+				if (++subpgoff == maxsubpgs) {
+					put_page(hpage);
+					hpage = NULL;
+					subpgoff = 0;
+					pgoff++;
+				}
+			} else {
+				page = shmem_read_mapping_page(mapping,
+							       pgoff + pgidx);
+				if (IS_ERR(page)) {
+					ret = PTR_ERR(page);
+					goto err;
+				}
 			}
 			ubuf->pages[pgbuf++] = page;
 		}
+		if (hpage) {
+			put_page(hpage);
+			hpage = NULL;
+		}
 		fput(memfd);
 		memfd = NULL;
 	}
@@ -239,6 +283,8 @@ static long udmabuf_create(struct miscdevice *device,
 err:
 	while (pgbuf > 0)
 		put_page(ubuf->pages[--pgbuf]);
+	if (hpage)
+		put_page(hpage);
 	if (memfd)
 		fput(memfd);
 	kfree(ubuf->pages);
@@ -7,6 +7,7 @@
  */
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
@@ -14,10 +15,14 @@
 #include <linux/init.h>
 #include <linux/kthread.h>
 #include <linux/sched/task.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
+#include <linux/platform_device.h>
 #include <linux/random.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/wait.h>
 
 static unsigned int test_buf_size = 16384;
@@ -168,6 +173,41 @@ static const struct kernel_param_ops test_list_ops = {
 module_param_cb(test_list, &test_list_ops, NULL, 0444);
 MODULE_PARM_DESC(test_list, "Print current test list");
 
+static int dmatest_bench_set(const char *val, const struct kernel_param *kp);
+static int dmatest_bench_get(char *val, const struct kernel_param *kp);
+static const struct kernel_param_ops bench_ops = {
+	.set = dmatest_bench_set,
+	.get = dmatest_bench_get,
+};
+module_param_cb(bench, &bench_ops, NULL, 0644);
+MODULE_PARM_DESC(bench, "Run the benchmark: \"copy\" through the DMA engine, \"map\" through the DMA-API mapping paths only");
+
+#define DMATEST_BENCH_MAX_POINTS	16
+#define DMATEST_BENCH_MAX_THREADS	32
+#define DMATEST_BENCH_MAX_ITERATIONS	100000
+
+static unsigned int bench_sizes[DMATEST_BENCH_MAX_POINTS];
+static unsigned int bench_nr_sizes;
+module_param_array(bench_sizes, uint, &bench_nr_sizes, 0644);
+MODULE_PARM_DESC(bench_sizes, "Transfer sizes swept by the benchmark (default: test_buf_size)");
+
+static unsigned int bench_aligns[DMATEST_BENCH_MAX_POINTS];
+static unsigned int bench_nr_aligns;
+module_param_array(bench_aligns, uint, &bench_nr_aligns, 0644);
+MODULE_PARM_DESC(bench_aligns, "Buffer alignments swept by the benchmark, taken as 2^(align) (default: page aligned)");
+
+static unsigned int bench_threads = 1;
+module_param(bench_threads, uint, 0644);
+MODULE_PARM_DESC(bench_threads, "Sweep from 1 up to this many channels (copy) or threads (map) (default: 1)");
+
+static unsigned int bench_iterations = 1000;
+module_param(bench_iterations, uint, 0644);
+MODULE_PARM_DESC(bench_iterations, "Transfers per thread and benchmark point (default: 1000)");
+
+static unsigned int bench_dma_bits = 32;
+module_param(bench_dma_bits, uint, 0644);
+MODULE_PARM_DESC(bench_dma_bits, "DMA mask width of the device used by the map benchmark (default: 32)");
+
 /* Maximum amount of mismatched bytes in buffer to print */
 #define MAX_ERROR_COUNT		32
 
@@ -1285,11 +1325,517 @@ static int dmatest_test_list_get(char *val, const struct kernel_param *kp)
 	return 0;
 }
 
+/**
+ * struct dmatest_bench_result - one point of the benchmark sweep
+ * @threads:	number of channels (copy) or threads (map) run concurrently
+ * @size:	transfer size in bytes
+ * @align:	buffer alignment, taken as 2^(align)
+ * @ops:	number of completed transfers
+ * @errors:	number of threads which stopped on an error
+ * @hmbps:	aggregate throughput in 1/100 MB/s
+ * @lat_*:	submit to complete (copy) or map to unmap (map) latency in ns
+ */
+struct dmatest_bench_result {
+	unsigned int	threads;
+	unsigned int	size;
+	unsigned int	align;
+	unsigned int	ops;
+	unsigned int	errors;
+	u64		hmbps;
+	u32		lat_min;
+	u32		lat_p50;
+	u32		lat_p90;
+	u32		lat_p99;
+	u32		lat_p999;
+	u32		lat_max;
+};
+
+static struct dmatest_bench_info {
+	struct mutex			lock;
+	const char			*mode;
+	struct dmatest_bench_result	*res;
+	unsigned int			nr_res;
+	struct dentry			*debugfs;
+} bench_info = {
+	.lock = __MUTEX_INITIALIZER(bench_info.lock),
+};
+
+struct dmatest_bench_thread {
+	struct task_struct	*task;
+	struct dma_chan		*chan;
+	struct device		*dev;
+	void			*src_buf;
+	void			*dst_buf;
+	unsigned int		offset;
+	unsigned int		size;
+	unsigned int		iterations;
+	unsigned int		ops;
+	unsigned int		errors;
+	u32			*lat;
+	u64			start;
+	u64			end;
+	u64			completed;
+	wait_queue_head_t	done_wait;
+	bool			tx_done;
+	bool			done;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(bench_wait);
+
+static void dmatest_bench_callback(void *arg)
+{
+	struct dmatest_bench_thread *thread = arg;
+
+	thread->completed = ktime_get_ns();
+	thread->tx_done = true;
+	wake_up_all(&thread->done_wait);
+}
+
+/* One memcpy through the engine, returns the submit to complete latency */
+static s64 dmatest_bench_copy(struct dmatest_bench_thread *thread,
+			      dma_addr_t src, dma_addr_t dst)
+{
+	struct dma_chan *chan = thread->chan;
+	struct dma_async_tx_descriptor *tx;
+	enum dma_ctrl_flags flags;
+	enum dma_status status;
+	dma_cookie_t cookie;
+	u64 start;
+
+	if (polled)
+		flags = DMA_CTRL_ACK;
+	else
+		flags = DMA_CTRL_ACK | DMA_PREP_INTERRUPT;
+
+	tx = chan->device->device_prep_dma_memcpy(chan, dst, src, thread->size,
+						  flags);
+	if (!tx)
+		return -ENOMEM;
+
+	thread->tx_done = false;
+	if (!polled) {
+		tx->callback = dmatest_bench_callback;
+		tx->callback_param = thread;
+	}
+
+	start = ktime_get_ns();
+	cookie = tx->tx_submit(tx);
+	if (dma_submit_error(cookie))
+		return -EIO;
+
+	if (polled) {
+		status = dma_sync_wait(chan, cookie);
+		thread->completed = ktime_get_ns();
+	} else {
+		dma_async_issue_pending(chan);
+
+		wait_event_timeout(thread->done_wait, thread->tx_done,
+				   msecs_to_jiffies(timeout));
+		if (!thread->tx_done)
+			return -ETIMEDOUT;
+
+		status = dma_async_is_tx_complete(chan, cookie, NULL, NULL);
+	}
+
+	if (status != DMA_COMPLETE)
+		return -EIO;
+
+	return thread->completed - start;
+}
+
+/* One map/unmap round trip through the DMA-API, no engine involved */
+static s64 dmatest_bench_map(struct dmatest_bench_thread *thread, void *buf)
+{
+	struct device *dev = thread->dev;
+	dma_addr_t addr;
+	u64 start;
+
+	start = ktime_get_ns();
+	addr = dma_map_single(dev, buf, thread->size, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev, addr))
+		return -ENOMEM;
+	dma_unmap_single(dev, addr, thread->size, DMA_BIDIRECTIONAL);
+
+	return ktime_get_ns() - start;
+}
+
+static int dmatest_bench_func(void *data)
+{
+	struct dmatest_bench_thread *thread = data;
+	void *src = thread->src_buf + thread->offset;
+	struct device *dev = thread->dev;
+	dma_addr_t src_dma = 0, dst_dma = 0;
+	unsigned int i;
+	int ret = 0;
+	s64 lat;
+
+	/* The engine benchmark maps once, the mappings are not measured */
+	if (thread->chan) {
+		src_dma = dma_map_single(dev, src, thread->size, DMA_TO_DEVICE);
+		dst_dma = dma_map_single(dev, thread->dst_buf + thread->offset,
+					 thread->size, DMA_FROM_DEVICE);
+		if (dma_mapping_error(dev, src_dma) ||
+		    dma_mapping_error(dev, dst_dma)) {
+			ret = -ENOMEM;
+			goto out_unmap;
+		}
+	}
+
+	thread->start = ktime_get_ns();
+	for (i = 0; i < thread->iterations && !kthread_should_stop(); i++) {
+		if (thread->chan)
+			lat = dmatest_bench_copy(thread, src_dma, dst_dma);
+		else
+			lat = dmatest_bench_map(thread, src);
+
+		if (lat < 0) {
+			ret = lat;
+			break;
+		}
+
+		thread->lat[thread->ops++] = min_t(s64, lat, U32_MAX);
+	}
+	thread->end = ktime_get_ns();
+
+	if (ret && thread->chan)
+		dmaengine_terminate_sync(thread->chan);
+
+out_unmap:
+	if (thread->chan) {
+		if (!dma_mapping_error(dev, dst_dma))
+			dma_unmap_single(dev, dst_dma, thread->size,
+					 DMA_FROM_DEVICE);
+		if (!dma_mapping_error(dev, src_dma))
+			dma_unmap_single(dev, src_dma, thread->size,
+					 DMA_TO_DEVICE);
+	}
+
+	if (ret) {
+		pr_warn("%s: benchmark stopped after %u transfers (%d)\n",
+			current->comm, thread->ops, ret);
+		thread->errors++;
+	}
+
+	thread->done = true;
+	wake_up(&bench_wait);
+
+	return ret;
+}
+
+static int dmatest_bench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 dmatest_bench_pct(const u32 *lat, unsigned int n,
+			     unsigned int permille)
+{
+	return lat[min_t(u64, div_u64((u64)n * permille, 1000), n - 1)];
+}
+
+static int dmatest_bench_point(struct dmatest_bench_result *res,
+			       struct dma_chan **chans, struct device *dev)
+{
+	unsigned int off = res->align < PAGE_SHIFT ? 1 << res->align : 0;
+	unsigned int i, n = res->threads, iterations = bench_iterations;
+	size_t buf_size = res->size + PAGE_SIZE;
+	struct dmatest_bench_thread *threads;
+	u64 start = U64_MAX, end = 0;
+	u32 *lat;
+	int ret = 0;
+
+	threads = kcalloc(n, sizeof(*threads), GFP_KERNEL);
+	lat = kvmalloc_array(n * iterations, sizeof(*lat), GFP_KERNEL);
+	if (!threads || !lat) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < n; i++) {
+		struct dmatest_bench_thread *thread = &threads[i];
+
+		thread->chan = chans ? chans[i] : NULL;
+		thread->dev = chans ? chans[i]->device->dev : dev;
+		thread->offset = off;
+		thread->size = res->size;
+		thread->iterations = iterations;
+		thread->lat = lat + i * iterations;
+		init_waitqueue_head(&thread->done_wait);
+
+		/* page aligned, then offset so 2^align is the exact alignment */
+		thread->src_buf = alloc_pages_exact(buf_size, GFP_KERNEL);
+		if (chans)
+			thread->dst_buf = alloc_pages_exact(buf_size,
+							    GFP_KERNEL);
+		if (!thread->src_buf || (chans && !thread->dst_buf)) {
+			ret = -ENOMEM;
+			goto out_threads;
+		}
+
+		thread->task = kthread_create(dmatest_bench_func, thread,
+					      "dmatest-bench%u", i);
+		if (IS_ERR(thread->task)) {
+			ret = PTR_ERR(thread->task);
+			thread->task = NULL;
+			goto out_threads;
+		}
+		get_task_struct(thread->task);
+	}
+
+	for (i = 0; i < n; i++)
+		wake_up_process(threads[i].task);
+	for (i = 0; i < n; i++)
+		wait_event(bench_wait, threads[i].done);
+
+	for (i = 0; i < n; i++) {
+		struct dmatest_bench_thread *thread = &threads[i];
+
+		memmove(lat + res->ops, thread->lat,
+			thread->ops * sizeof(*lat));
+		res->ops += thread->ops;
+		res->errors += thread->errors;
+		if (thread->ops) {
+			start = min(start, thread->start);
+			end = max(end, thread->end);
+		}
+	}
+
+	if (res->ops) {
+		sort(lat, res->ops, sizeof(*lat), dmatest_bench_cmp, NULL);
+		res->lat_min = lat[0];
+		res->lat_p50 = dmatest_bench_pct(lat, res->ops, 500);
+		res->lat_p90 = dmatest_bench_pct(lat, res->ops, 900);
+		res->lat_p99 = dmatest_bench_pct(lat, res->ops, 990);
+		res->lat_p999 = dmatest_bench_pct(lat, res->ops, 999);
+		res->lat_max = lat[res->ops - 1];
+		if (end > start)
+			res->hmbps = div64_u64((u64)res->ops * res->size *
+					       100000, end - start);
+	}
+
+out_threads:
+	for (i = 0; i < n; i++) {
+		struct dmatest_bench_thread *thread = &threads[i];
+
+		if (thread->task) {
+			kthread_stop(thread->task);
+			put_task_struct(thread->task);
+		}
+		if (thread->dst_buf)
+			free_pages_exact(thread->dst_buf, buf_size);
+		if (thread->src_buf)
+			free_pages_exact(thread->src_buf, buf_size);
+	}
+out_free:
+	kvfree(lat);
+	kfree(threads);
+
+	return ret;
+}
+
+static bool dmatest_bench_aligned(struct dma_chan **chans,
+				  struct dmatest_bench_result *res)
+{
+	unsigned int off = res->align < PAGE_SHIFT ? 1 << res->align : 0;
+	unsigned int i;
+
+	for (i = 0; i < res->threads; i++)
+		if (!is_dma_copy_aligned(chans[i]->device, off, off, res->size))
+			return false;
+
+	return true;
+}
+
+/*
+ * Sweep channel/thread count, transfer size and alignment, and publish the
+ * results in debugfs. "copy" benchmarks memcpy on the DMA engine channels
+ * matching the channel and device parameters; "map" needs no engine and
+ * benchmarks dma_map_single()/dma_unmap_single() on a dummy platform
+ * device, which goes through dma-direct and, with a small enough
+ * bench_dma_bits or swiotlb=force, through swiotlb bouncing.
+ */
+static int dmatest_bench_run(const char *mode)
+{
+	unsigned int nr_sizes = bench_nr_sizes ? bench_nr_sizes : 1;
+	unsigned int nr_aligns = bench_nr_aligns ? bench_nr_aligns : 1;
+	bool map = !strcmp(mode, "map");
+	struct dmatest_bench_result *res = NULL;
+	struct platform_device *pdev = NULL;
+	struct dmatest_params params = { };
+	struct dma_chan **chans = NULL;
+	unsigned int nr_chans = 0, n = 0;
+	unsigned int t, s, a;
+	dma_cap_mask_t mask;
+	int ret;
+
+	if (!bench_threads || bench_threads > DMATEST_BENCH_MAX_THREADS ||
+	    !bench_iterations ||
+	    bench_iterations > DMATEST_BENCH_MAX_ITERATIONS ||
+	    bench_dma_bits < 24 || bench_dma_bits > 64)
+		return -EINVAL;
+
+	if (map) {
+		pdev = platform_device_register_simple("dmatest-bench",
+						       PLATFORM_DEVID_NONE,
+						       NULL, 0);
+		if (IS_ERR(pdev))
+			return PTR_ERR(pdev);
+
+		ret = dma_coerce_mask_and_coherent(&pdev->dev,
+						   DMA_BIT_MASK(bench_dma_bits));
+		if (ret)
+			goto out_release;
+
+		nr_chans = bench_threads;
+	} else {
+		chans = kcalloc(bench_threads, sizeof(*chans), GFP_KERNEL);
+		if (!chans)
+			return -ENOMEM;
+
+		strlcpy(params.channel, strim(test_channel),
+			sizeof(params.channel));
+		strlcpy(params.device, strim(test_device),
+			sizeof(params.device));
+
+		dma_cap_zero(mask);
+		dma_cap_set(DMA_MEMCPY, mask);
+		while (nr_chans < bench_threads) {
+			chans[nr_chans] = dma_request_channel(mask, filter,
+							      &params);
+			if (!chans[nr_chans])
+				break;
+			nr_chans++;
+		}
+
+		if (!nr_chans) {
+			pr_err("No memcpy channel available for the benchmark\n");
+			ret = -ENODEV;
+			goto out_release;
+		}
+	}
+
+	res = kcalloc(nr_chans * nr_sizes * nr_aligns, sizeof(*res),
+		      GFP_KERNEL);
+	if (!res) {
+		ret = -ENOMEM;
+		goto out_release;
+	}
+
+	ret = 0;
+	for (t = 1; t <= nr_chans && !ret; t++) {
+		for (s = 0; s < nr_sizes && !ret; s++) {
+			for (a = 0; a < nr_aligns && !ret; a++) {
+				struct dmatest_bench_result *r = &res[n];
+
+				r->threads = t;
+				r->size = bench_nr_sizes ? bench_sizes[s] :
+							   test_buf_size;
+				r->align = bench_nr_aligns ? bench_aligns[a] :
+							     PAGE_SHIFT;
+				if (!r->size) {
+					ret = -EINVAL;
+					break;
+				}
+
+				if (!map && !dmatest_bench_aligned(chans, r)) {
+					pr_info("skipping size %u align %u, not supported by the engine\n",
+						r->size, r->align);
+					memset(r, 0, sizeof(*r));
+					continue;
+				}
+
+				ret = dmatest_bench_point(r, chans,
+							  map ? &pdev->dev : NULL);
+				if (!ret)
+					n++;
+			}
+		}
+	}
+
+	pr_info("benchmark '%s': %u points on %u %s (%d)\n", mode, n,
+		nr_chans, map ? "threads" : "channels", ret);
+
+	/* Partial results are published as well */
+	swap(bench_info.res, res);
+	bench_info.nr_res = n;
+	bench_info.mode = map ? "map" : "copy";
+
+out_release:
+	kfree(res);
+	while (nr_chans && chans)
+		dma_release_channel(chans[--nr_chans]);
+	kfree(chans);
+	if (pdev)
+		platform_device_unregister(pdev);
+
+	return ret;
+}
+
+static int dmatest_bench_set(const char *val, const struct kernel_param *kp)
+{
+	const char *mode;
+	int ret;
+
+	if (sysfs_streq(val, "copy"))
+		mode = "copy";
+	else if (sysfs_streq(val, "map"))
+		mode = "map";
+	else
+		return -EINVAL;
+
+	mutex_lock(&bench_info.lock);
+	ret = dmatest_bench_run(mode);
+	mutex_unlock(&bench_info.lock);
+
+	return ret;
+}
+
+static int dmatest_bench_get(char *val, const struct kernel_param *kp)
+{
+	int ret;
+
+	mutex_lock(&bench_info.lock);
+	ret = sprintf(val, "%s\n", bench_info.mode ? bench_info.mode : "");
+	mutex_unlock(&bench_info.lock);
+
+	return ret;
+}
+
+static int dmatest_bench_show(struct seq_file *s, void *unused)
+{
+	struct dmatest_bench_result *r;
+	unsigned int i;
+	u32 frac;
+	u64 mbps;
+
+	mutex_lock(&bench_info.lock);
+	seq_puts(s, "mode,threads,size,align,ops,errors,MB/s,lat_min_ns,lat_p50_ns,lat_p90_ns,lat_p99_ns,lat_p999_ns,lat_max_ns\n");
+	for (i = 0; i < bench_info.nr_res; i++) {
+		r = &bench_info.res[i];
+		mbps = div_u64_rem(r->hmbps, 100, &frac);
+		seq_printf(s, "%s,%u,%u,%u,%u,%u,%llu.%02u,%u,%u,%u,%u,%u,%u\n",
+			   bench_info.mode, r->threads, r->size, r->align,
+			   r->ops, r->errors, mbps, frac, r->lat_min,
+			   r->lat_p50, r->lat_p90, r->lat_p99, r->lat_p999,
+			   r->lat_max);
+	}
+	mutex_unlock(&bench_info.lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dmatest_bench);
+
 static int __init dmatest_init(void)
 {
 	struct dmatest_info *info = &test_info;
 	struct dmatest_params *params = &info->params;
 
+	bench_info.debugfs = debugfs_create_dir("dmatest", NULL);
+	debugfs_create_file("bench", 0444, bench_info.debugfs, NULL,
+			    &dmatest_bench_fops);
+
 	if (dmatest_run) {
 		mutex_lock(&info->lock);
 		add_threaded_test(info);
@@ -1317,6 +1863,9 @@ static void __exit dmatest_exit(void)
 	mutex_lock(&info->lock);
 	stop_threaded_test(info);
 	mutex_unlock(&info->lock);
+
+	debugfs_remove_recursive(bench_info.debugfs);
+	kfree(bench_info.res);
 }
 module_exit(dmatest_exit);
 
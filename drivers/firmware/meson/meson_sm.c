@@ -12,6 +12,7 @@
 #include <linux/bug.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
@@ -54,6 +55,7 @@ struct meson_sm_firmware {
 	const struct meson_sm_chip *chip;
 	void __iomem *sm_shmem_in_base;
 	void __iomem *sm_shmem_out_base;
+	struct mutex shmem_lock; /* protects the shared memory windows */
 };
 
 static u32 meson_sm_get_cmd(const struct meson_sm_chip *chip,
@@ -155,11 +157,18 @@ int meson_sm_call_read(struct meson_sm_firmware *fw, void *buffer,
 	if (bsize > fw->chip->shmem_size)
 		return -EINVAL;
 
-	if (meson_sm_call(fw, cmd_index, &size, arg0, arg1, arg2, arg3, arg4) < 0)
-		return -EINVAL;
+	/* The output window is shared, keep it until the data is copied */
+	mutex_lock(&fw->shmem_lock);
 
-	if (size > bsize)
-		return -EINVAL;
+	if (meson_sm_call(fw, cmd_index, &size, arg0, arg1, arg2, arg3, arg4) < 0) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (size > bsize) {
+		ret = -EINVAL;
+		goto out;
+	}
 
 	ret = size;
 
@@ -169,6 +178,8 @@ int meson_sm_call_read(struct meson_sm_firmware *fw, void *buffer,
 	if (buffer)
 		memcpy(buffer, fw->sm_shmem_out_base, size);
 
+out:
+	mutex_unlock(&fw->shmem_lock);
 	return ret;
 }
 EXPORT_SYMBOL(meson_sm_call_read);
@@ -203,10 +214,15 @@ int meson_sm_call_write(struct meson_sm_firmware *fw, void *buffer,
 	if (!fw->chip->cmd_shmem_in_base)
 		return -EINVAL;
 
+	/* The input window is shared, keep it until the call returns */
+	mutex_lock(&fw->shmem_lock);
+
 	memcpy(fw->sm_shmem_in_base, buffer, size);
 
 	if (meson_sm_call(fw, cmd_index, &written, arg0, arg1, arg2, arg3, arg4) < 0)
-		return -EINVAL;
+		written = 0;
+
+	mutex_unlock(&fw->shmem_lock);
 
 	if (!written)
 		return -EINVAL;
@@ -292,6 +308,7 @@ static int __init meson_sm_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	chip = of_match_device(meson_sm_ids, dev)->data;
+	mutex_init(&fw->shmem_lock);
 
 	if (chip->cmd_shmem_in_base) {
 		fw->sm_shmem_in_base = meson_sm_map_shmem(chip->cmd_shmem_in_base,
@@ -15,22 +15,41 @@
 
 #include "lima_device.h"
 #include "lima_devfreq.h"
+#include "lima_drv.h"
 
+/*
+ * Busy time is accounted separately for GP and PP, and the busier of
+ * the two is reported as the utilization, so that a short burst on one
+ * unit while the other one idles does not look like a fully loaded GPU.
+ */
 static void lima_devfreq_update_utilization(struct lima_devfreq *devfreq)
 {
 	ktime_t now, last;
+	int i;
 
 	now = ktime_get();
 	last = devfreq->time_last_update;
 
-	if (devfreq->busy_count > 0)
-		devfreq->busy_time += ktime_sub(now, last);
-	else
-		devfreq->idle_time += ktime_sub(now, last);
+	for (i = 0; i < LIMA_DEVFREQ_NUM_UNITS; i++) {
+		if (devfreq->busy_count[i] > 0)
+			devfreq->busy_time[i] += ktime_sub(now, last);
+	}
 
 	devfreq->time_last_update = now;
 }
 
+static bool lima_devfreq_is_idle(struct lima_devfreq *devfreq)
+{
+	int i;
+
+	for (i = 0; i < LIMA_DEVFREQ_NUM_UNITS; i++) {
+		if (devfreq->busy_count[i] > 0)
+			return false;
+	}
+
+	return true;
+}
+
 static int lima_devfreq_target(struct device *dev, unsigned long *freq,
 			       u32 flags)
 {
@@ -51,9 +70,13 @@ static int lima_devfreq_target(struct device *dev, unsigned long *freq,
 
 static void lima_devfreq_reset(struct lima_devfreq *devfreq)
 {
-	devfreq->busy_time = 0;
-	devfreq->idle_time = 0;
-	devfreq->time_last_update = ktime_get();
+	int i;
+
+	for (i = 0; i < LIMA_DEVFREQ_NUM_UNITS; i++)
+		devfreq->busy_time[i] = 0;
+
+	devfreq->time_window_start = ktime_get();
+	devfreq->time_last_update = devfreq->time_window_start;
 }
 
 static int lima_devfreq_get_dev_status(struct device *dev,
@@ -62,6 +85,8 @@ static int lima_devfreq_get_dev_status(struct device *dev,
 	struct lima_device *ldev = dev_get_drvdata(dev);
 	struct lima_devfreq *devfreq = &ldev->devfreq;
 	unsigned long irqflags;
+	ktime_t busy_time = 0;
+	int i;
 
 	status->current_frequency = clk_get_rate(ldev->clk_gpu);
 
@@ -69,9 +94,18 @@ static int lima_devfreq_get_dev_status(struct device *dev,
 
 	lima_devfreq_update_utilization(devfreq);
 
-	status->total_time = ktime_to_ns(ktime_add(devfreq->busy_time,
-						   devfreq->idle_time));
-	status->busy_time = ktime_to_ns(devfreq->busy_time);
+	for (i = 0; i < LIMA_DEVFREQ_NUM_UNITS; i++)
+		busy_time = max(busy_time, devfreq->busy_time[i]);
+
+	status->total_time = ktime_to_ns(ktime_sub(devfreq->time_last_update,
+						   devfreq->time_window_start));
+	status->busy_time = ktime_to_ns(busy_time);
+
+	/* report a fully busy window to make the governor jump to max */
+	if (devfreq->boost) {
+		status->busy_time = status->total_time;
+		devfreq->boost = false;
+	}
 
 	lima_devfreq_reset(devfreq);
 
@@ -79,7 +113,8 @@ static int lima_devfreq_get_dev_status(struct device *dev,
 
 	dev_dbg(ldev->dev, "busy %lu total %lu %lu %% freq %lu MHz\n",
 		status->busy_time, status->total_time,
-		status->busy_time / (status->total_time / 100),
+		status->total_time >= 100 ?
+		status->busy_time / (status->total_time / 100) : 0,
 		status->current_frequency / 1000 / 1000);
 
 	return 0;
@@ -91,6 +126,17 @@ static struct devfreq_dev_profile lima_devfreq_profile = {
 	.get_dev_status = lima_devfreq_get_dev_status,
 };
 
+static void lima_devfreq_boost_work(struct work_struct *work)
+{
+	struct lima_devfreq *ldevfreq =
+		container_of(work, struct lima_devfreq, boost_work);
+	struct devfreq *devfreq = ldevfreq->devfreq;
+
+	mutex_lock(&devfreq->lock);
+	update_devfreq(devfreq);
+	mutex_unlock(&devfreq->lock);
+}
+
 void lima_devfreq_fini(struct lima_device *ldev)
 {
 	struct lima_devfreq *devfreq = &ldev->devfreq;
@@ -101,6 +147,7 @@ void lima_devfreq_fini(struct lima_device *ldev)
 	}
 
 	if (devfreq->devfreq) {
+		cancel_work_sync(&devfreq->boost_work);
 		devm_devfreq_remove_device(ldev->dev, devfreq->devfreq);
 		devfreq->devfreq = NULL;
 	}
@@ -137,6 +184,7 @@ int lima_devfreq_init(struct lima_device *ldev)
 		return 0;
 
 	spin_lock_init(&ldevfreq->lock);
+	INIT_WORK(&ldevfreq->boost_work, lima_devfreq_boost_work);
 
 	opp_table = dev_pm_opp_set_clkname(dev, "core");
 	if (IS_ERR(opp_table)) {
@@ -165,6 +213,7 @@ int lima_devfreq_init(struct lima_device *ldev)
 	ldevfreq->opp_of_table_added = true;
 
 	lima_devfreq_reset(ldevfreq);
+	ldevfreq->time_idle_start = ldevfreq->time_window_start;
 
 	cur_freq = clk_get_rate(ldev->clk_gpu);
 
@@ -200,9 +249,10 @@ int lima_devfreq_init(struct lima_device *ldev)
 	return ret;
 }
 
-void lima_devfreq_record_busy(struct lima_devfreq *devfreq)
+void lima_devfreq_record_busy(struct lima_devfreq *devfreq, int unit)
 {
 	unsigned long irqflags;
+	bool boost = false;
 
 	if (!devfreq->devfreq)
 		return;
@@ -211,12 +261,29 @@ void lima_devfreq_record_busy(struct lima_devfreq *devfreq)
 
 	lima_devfreq_update_utilization(devfreq);
 
-	devfreq->busy_count++;
+	/*
+	 * Work after the GPU idled for a full polling period is likely the
+	 * first frame of a new burst, so optionally raise the frequency now
+	 * instead of after the next polling period.
+	 */
+	if (lima_devfreq_boost && !devfreq->boost &&
+	    lima_devfreq_is_idle(devfreq) &&
+	    ktime_ms_delta(devfreq->time_last_update,
+			   devfreq->time_idle_start) >=
+	    lima_devfreq_profile.polling_ms) {
+		devfreq->boost = true;
+		boost = true;
+	}
+
+	devfreq->busy_count[unit]++;
 
 	spin_unlock_irqrestore(&devfreq->lock, irqflags);
+
+	if (boost)
+		schedule_work(&devfreq->boost_work);
 }
 
-void lima_devfreq_record_idle(struct lima_devfreq *devfreq)
+void lima_devfreq_record_idle(struct lima_devfreq *devfreq, int unit)
 {
 	unsigned long irqflags;
 
@@ -227,7 +294,10 @@ void lima_devfreq_record_idle(struct lima_devfreq *devfreq)
 
 	lima_devfreq_update_utilization(devfreq);
 
-	WARN_ON(--devfreq->busy_count < 0);
+	WARN_ON(--devfreq->busy_count[unit] < 0);
+
+	if (lima_devfreq_is_idle(devfreq))
+		devfreq->time_idle_start = devfreq->time_last_update;
 
 	spin_unlock_irqrestore(&devfreq->lock, irqflags);
 }
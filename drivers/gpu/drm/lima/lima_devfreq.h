@@ -6,6 +6,7 @@
 
 #include <linux/spinlock.h>
 #include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 struct devfreq;
 struct opp_table;
@@ -13,6 +14,9 @@ struct thermal_cooling_device;
 
 struct lima_device;
 
+/* GP and PP, indexed by enum lima_pipe_id */
+#define LIMA_DEVFREQ_NUM_UNITS 2
+
 struct lima_devfreq {
 	struct devfreq *devfreq;
 	struct opp_table *clkname_opp_table;
@@ -20,23 +24,27 @@ struct lima_devfreq {
 	struct thermal_cooling_device *cooling;
 	bool opp_of_table_added;
 
-	ktime_t busy_time;
-	ktime_t idle_time;
+	ktime_t busy_time[LIMA_DEVFREQ_NUM_UNITS];
+	ktime_t time_window_start;
 	ktime_t time_last_update;
-	int busy_count;
+	ktime_t time_idle_start;
+	int busy_count[LIMA_DEVFREQ_NUM_UNITS];
+	bool boost;
 	/*
-	 * Protect busy_time, idle_time, time_last_update and busy_count
+	 * Protect busy_time, the time stamps, busy_count and boost
 	 * because these can be updated concurrently, for example by the GP
 	 * and PP interrupts.
 	 */
 	spinlock_t lock;
+
+	struct work_struct boost_work;
 };
 
 int lima_devfreq_init(struct lima_device *ldev);
 void lima_devfreq_fini(struct lima_device *ldev);
 
-void lima_devfreq_record_busy(struct lima_devfreq *devfreq);
-void lima_devfreq_record_idle(struct lima_devfreq *devfreq);
+void lima_devfreq_record_busy(struct lima_devfreq *devfreq, int unit);
+void lima_devfreq_record_idle(struct lima_devfreq *devfreq, int unit);
 
 int lima_devfreq_resume(struct lima_devfreq *devfreq);
 int lima_devfreq_suspend(struct lima_devfreq *devfreq);
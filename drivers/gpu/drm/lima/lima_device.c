@@ -358,6 +358,8 @@ int lima_device_init(struct lima_device *ldev)
 
 	dma_set_coherent_mask(ldev->dev, DMA_BIT_MASK(32));
 
+	lima_perfcnt_init(ldev);
+
 	err = lima_clk_init(ldev);
 	if (err)
 		return err;
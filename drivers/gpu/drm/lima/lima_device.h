@@ -7,11 +7,14 @@
 #include <drm/drm_device.h>
 #include <linux/delay.h>
 #include <linux/list.h>
+#include <linux/ktime.h>
 #include <linux/mutex.h>
+#include <linux/shrinker.h>
 
 #include "lima_sched.h"
 #include "lima_dump.h"
 #include "lima_devfreq.h"
+#include "lima_perfcnt.h"
 
 enum lima_gpu_id {
 	lima_gpu_mali400 = 0,
@@ -67,6 +70,11 @@ struct lima_ip {
 		/* pmu/bcast */
 		u32 mask;
 	} data;
+
+	/* pp busy time statistics, shown in debugfs */
+	ktime_t busy_start;
+	u64 busy_ns;
+	u64 jobs;
 };
 
 enum lima_pipe_id {
@@ -102,6 +110,13 @@ struct lima_device {
 
 	struct lima_devfreq devfreq;
 
+	struct lima_perfcnt perfcnt;
+
+	/* purgeable BOs, see lima_gem_shrinker.c */
+	struct mutex shrinker_lock;
+	struct list_head shrinker_list;
+	struct shrinker shrinker;
+
 	/* debug info */
 	struct lima_dump_head dump;
 	struct list_head error_task_list;
@@ -121,6 +136,17 @@ const char *lima_ip_name(struct lima_ip *ip);
 
 typedef int (*lima_poll_func_t)(struct lima_ip *);
 
+static inline void lima_ip_busy_begin(struct lima_ip *ip)
+{
+	ip->busy_start = ktime_get();
+}
+
+static inline void lima_ip_busy_end(struct lima_ip *ip)
+{
+	ip->busy_ns += ktime_to_ns(ktime_sub(ktime_get(), ip->busy_start));
+	ip->jobs++;
+}
+
 static inline int lima_poll_timeout(struct lima_ip *ip, lima_poll_func_t func,
 				    int sleep_us, int timeout_us)
 {
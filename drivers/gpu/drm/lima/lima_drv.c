@@ -6,6 +6,8 @@
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
+#include <drm/drm_debugfs.h>
 #include <drm/drm_ioctl.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_prime.h>
@@ -19,6 +21,7 @@
 int lima_sched_timeout_ms;
 uint lima_heap_init_nr_pages = 8;
 uint lima_max_error_tasks;
+bool lima_devfreq_boost;
 
 MODULE_PARM_DESC(sched_timeout_ms, "task run timeout in ms");
 module_param_named(sched_timeout_ms, lima_sched_timeout_ms, int, 0444);
@@ -29,6 +32,9 @@ module_param_named(heap_init_nr_pages, lima_heap_init_nr_pages, uint, 0444);
 MODULE_PARM_DESC(max_error_tasks, "max number of error tasks to save");
 module_param_named(max_error_tasks, lima_max_error_tasks, uint, 0644);
 
+MODULE_PARM_DESC(devfreq_boost, "raise GPU frequency when work arrives after idle");
+module_param_named(devfreq_boost, lima_devfreq_boost, bool, 0644);
+
 static int lima_ioctl_get_param(struct drm_device *dev, void *data, struct drm_file *file)
 {
 	struct drm_lima_get_param *args = data;
@@ -94,35 +100,31 @@ static int lima_ioctl_gem_info(struct drm_device *dev, void *data, struct drm_fi
 	return lima_gem_get_info(file, args->handle, &args->va, &args->offset);
 }
 
-static int lima_ioctl_gem_submit(struct drm_device *dev, void *data, struct drm_file *file)
+static int lima_submit_init(struct lima_device *ldev, struct lima_submit *submit,
+			    u32 pipe_id, u32 nr_bos, u64 bos, u32 frame_size,
+			    u64 frame, u32 flags)
 {
-	struct drm_lima_gem_submit *args = data;
-	struct lima_device *ldev = to_lima_dev(dev);
-	struct lima_drm_priv *priv = file->driver_priv;
-	struct drm_lima_gem_submit_bo *bos;
 	struct lima_sched_pipe *pipe;
 	struct lima_sched_task *task;
-	struct lima_ctx *ctx;
-	struct lima_submit submit = {0};
 	size_t size;
-	int err = 0;
+	int err;
 
-	if (args->pipe >= lima_pipe_num || args->nr_bos == 0)
+	if (pipe_id >= lima_pipe_num || nr_bos == 0)
 		return -EINVAL;
 
-	if (args->flags & ~(LIMA_SUBMIT_FLAG_EXPLICIT_FENCE))
+	if (flags & ~(LIMA_SUBMIT_FLAG_EXPLICIT_FENCE))
 		return -EINVAL;
 
-	pipe = ldev->pipe + args->pipe;
-	if (args->frame_size != pipe->frame_size)
+	pipe = ldev->pipe + pipe_id;
+	if (frame_size != pipe->frame_size)
 		return -EINVAL;
 
-	bos = kvcalloc(args->nr_bos, sizeof(*submit.bos) + sizeof(*submit.lbos), GFP_KERNEL);
-	if (!bos)
+	submit->bos = kvcalloc(nr_bos, sizeof(*submit->bos) + sizeof(*submit->lbos), GFP_KERNEL);
+	if (!submit->bos)
 		return -ENOMEM;
 
-	size = args->nr_bos * sizeof(*submit.bos);
-	if (copy_from_user(bos, u64_to_user_ptr(args->bos), size)) {
+	size = nr_bos * sizeof(*submit->bos);
+	if (copy_from_user(submit->bos, u64_to_user_ptr(bos), size)) {
 		err = -EFAULT;
 		goto out0;
 	}
@@ -134,7 +136,7 @@ static int lima_ioctl_gem_submit(struct drm_device *dev, void *data, struct drm_
 	}
 
 	task->frame = task + 1;
-	if (copy_from_user(task->frame, u64_to_user_ptr(args->frame), args->frame_size)) {
+	if (copy_from_user(task->frame, u64_to_user_ptr(frame), frame_size)) {
 		err = -EFAULT;
 		goto out1;
 	}
@@ -143,31 +145,132 @@ static int lima_ioctl_gem_submit(struct drm_device *dev, void *data, struct drm_
 	if (err)
 		goto out1;
 
+	submit->pipe = pipe_id;
+	submit->lbos = (void *)submit->bos + size;
+	submit->nr_bos = nr_bos;
+	submit->task = task;
+	submit->flags = flags;
+	return 0;
+
+out1:
+	kmem_cache_free(pipe->task_slab, task);
+out0:
+	kvfree(submit->bos);
+	submit->bos = NULL;
+	return err;
+}
+
+/* the task belongs to the scheduler once it has been queued */
+static void lima_submit_fini(struct lima_device *ldev, struct lima_submit *submit,
+			     bool queued)
+{
+	if (!queued && submit->task)
+		kmem_cache_free(ldev->pipe[submit->pipe].task_slab, submit->task);
+	kvfree(submit->bos);
+}
+
+static int lima_ioctl_gem_submit(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_lima_gem_submit *args = data;
+	struct lima_device *ldev = to_lima_dev(dev);
+	struct lima_drm_priv *priv = file->driver_priv;
+	struct lima_ctx *ctx;
+	struct lima_submit submit = {0};
+	int err;
+
+	err = lima_submit_init(ldev, &submit, args->pipe, args->nr_bos,
+			       args->bos, args->frame_size, args->frame,
+			       args->flags);
+	if (err)
+		return err;
+
 	ctx = lima_ctx_get(&priv->ctx_mgr, args->ctx);
 	if (!ctx) {
 		err = -ENOENT;
-		goto out1;
+		goto out;
 	}
 
-	submit.pipe = args->pipe;
-	submit.bos = bos;
-	submit.lbos = (void *)bos + size;
-	submit.nr_bos = args->nr_bos;
-	submit.task = task;
 	submit.ctx = ctx;
-	submit.flags = args->flags;
 	submit.in_sync[0] = args->in_sync[0];
 	submit.in_sync[1] = args->in_sync[1];
 	submit.out_sync = args->out_sync;
 
-	err = lima_gem_submit(file, &submit);
+	err = lima_gem_submit(file, &submit, 1);
+
+	lima_ctx_put(ctx);
+out:
+	lima_submit_fini(ldev, &submit, !err);
+	return err;
+}
+
+static int lima_ioctl_gem_submit_batch(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_lima_gem_submit_batch *args = data;
+	struct lima_device *ldev = to_lima_dev(dev);
+	struct lima_drm_priv *priv = file->driver_priv;
+	struct drm_lima_gem_submit_task *tasks;
+	struct lima_submit *submits;
+	struct lima_ctx *ctx;
+	int i, err;
+
+	if (!args->nr_tasks || args->nr_tasks > LIMA_SUBMIT_BATCH_MAX_TASKS)
+		return -EINVAL;
+
+	tasks = kvmalloc_array(args->nr_tasks, sizeof(*tasks), GFP_KERNEL);
+	if (!tasks)
+		return -ENOMEM;
+
+	submits = kvcalloc(args->nr_tasks, sizeof(*submits), GFP_KERNEL);
+	if (!submits) {
+		err = -ENOMEM;
+		goto out0;
+	}
+
+	if (copy_from_user(tasks, u64_to_user_ptr(args->tasks),
+			   args->nr_tasks * sizeof(*tasks))) {
+		err = -EFAULT;
+		goto out1;
+	}
+
+	for (i = 0; i < args->nr_tasks; i++) {
+		struct drm_lima_gem_submit_task *t = tasks + i;
+
+		/* a task can only wait for the ones before it */
+		if (t->deps & ~(BIT(i) - 1)) {
+			err = -EINVAL;
+			goto out1;
+		}
+
+		err = lima_submit_init(ldev, submits + i, t->pipe, t->nr_bos,
+				       t->bos, t->frame_size, t->frame,
+				       t->flags);
+		if (err)
+			goto out1;
+
+		submits[i].in_sync[0] = t->in_sync[0];
+		submits[i].in_sync[1] = t->in_sync[1];
+		submits[i].out_sync = t->out_sync;
+		submits[i].deps = t->deps;
+	}
+
+	ctx = lima_ctx_get(&priv->ctx_mgr, args->ctx);
+	if (!ctx) {
+		err = -ENOENT;
+		goto out1;
+	}
+
+	for (i = 0; i < args->nr_tasks; i++)
+		submits[i].ctx = ctx;
+
+	err = lima_gem_submit(file, submits, args->nr_tasks);
 
 	lima_ctx_put(ctx);
 out1:
-	if (err)
-		kmem_cache_free(pipe->task_slab, task);
+	for (i = 0; i < args->nr_tasks; i++)
+		lima_submit_fini(ldev, submits + i, !err);
+	kvfree(submits);
 out0:
-	kvfree(bos);
+	kvfree(tasks);
 	return err;
 }
 
@@ -181,6 +284,34 @@ static int lima_ioctl_gem_wait(struct drm_device *dev, void *data, struct drm_fi
 	return lima_gem_wait(file, args->handle, args->op, args->timeout_ns);
 }
 
+static int lima_ioctl_gem_madvise(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_lima_gem_madvise *args = data;
+
+	if (args->pad)
+		return -EINVAL;
+
+	if (args->madv != LIMA_MADV_WILLNEED && args->madv != LIMA_MADV_DONTNEED)
+		return -EINVAL;
+
+	return lima_gem_madvise(file, args->handle, args->madv, &args->retained);
+}
+
+static int lima_ioctl_perfcnt_enable(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	struct drm_lima_perfcnt_enable *args = data;
+
+	if (args->_pad || args->enable > 1)
+		return -EINVAL;
+
+	return lima_perfcnt_enable(to_lima_dev(dev), file, args);
+}
+
+static int lima_ioctl_perfcnt_dump(struct drm_device *dev, void *data, struct drm_file *file)
+{
+	return lima_perfcnt_dump(to_lima_dev(dev), file, data);
+}
+
 static int lima_ioctl_ctx_create(struct drm_device *dev, void *data, struct drm_file *file)
 {
 	struct drm_lima_ctx_create *args = data;
@@ -234,6 +365,7 @@ static void lima_drm_driver_postclose(struct drm_device *dev, struct drm_file *f
 {
 	struct lima_drm_priv *priv = file->driver_priv;
 
+	lima_perfcnt_close(to_lima_dev(dev), file);
 	lima_ctx_mgr_fini(&priv->ctx_mgr);
 	lima_vm_put(priv->vm);
 	kfree(priv);
@@ -247,14 +379,74 @@ static const struct drm_ioctl_desc lima_drm_driver_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(LIMA_GEM_WAIT, lima_ioctl_gem_wait, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(LIMA_CTX_CREATE, lima_ioctl_ctx_create, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(LIMA_CTX_FREE, lima_ioctl_ctx_free, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(LIMA_GEM_MADVISE, lima_ioctl_gem_madvise, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(LIMA_PERFCNT_ENABLE, lima_ioctl_perfcnt_enable, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(LIMA_PERFCNT_DUMP, lima_ioctl_perfcnt_dump, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(LIMA_GEM_SUBMIT_BATCH, lima_ioctl_gem_submit_batch, DRM_RENDER_ALLOW),
+};
+
+static void lima_show_fdinfo(struct seq_file *m, struct file *f)
+{
+	struct drm_file *file = f->private_data;
+	struct lima_drm_priv *priv = file->driver_priv;
+
+	seq_printf(m, "drm-driver:\t%s\n", file->minor->dev->driver->name);
+	seq_printf(m, "drm-engine-gp:\t%llu ns\n",
+		   (u64)atomic64_read(&priv->vm->busy_ns[lima_pipe_gp]));
+	seq_printf(m, "drm-engine-pp:\t%llu ns\n",
+		   (u64)atomic64_read(&priv->vm->busy_ns[lima_pipe_pp]));
+}
+
+static const struct file_operations lima_drm_driver_fops = {
+	.owner		= THIS_MODULE,
+	.open		= drm_open,
+	.release	= drm_release,
+	.unlocked_ioctl	= drm_ioctl,
+	.compat_ioctl	= drm_compat_ioctl,
+	.poll		= drm_poll,
+	.read		= drm_read,
+	.llseek		= noop_llseek,
+	.mmap		= drm_gem_mmap,
+	.show_fdinfo	= lima_show_fdinfo,
 };
 
-DEFINE_DRM_GEM_FOPS(lima_drm_driver_fops);
+#ifdef CONFIG_DEBUG_FS
+static int lima_debugfs_pp_stats(struct seq_file *m, void *data)
+{
+	struct drm_info_node *node = m->private;
+	struct lima_device *ldev = to_lima_dev(node->minor->dev);
+	struct lima_sched_pipe *pipe = ldev->pipe + lima_pipe_pp;
+	int i;
+
+	for (i = 0; i < pipe->num_processor; i++) {
+		struct lima_ip *ip = pipe->processor[i];
+
+		seq_printf(m, "%s: %llu jobs, %llu ns busy\n",
+			   lima_ip_name(ip), ip->jobs, ip->busy_ns);
+	}
+
+	return 0;
+}
+
+static const struct drm_info_list lima_debugfs_list[] = {
+	{ "pp_stats", lima_debugfs_pp_stats, 0 },
+};
+
+static int lima_debugfs_init(struct drm_minor *minor)
+{
+	return drm_debugfs_create_files(lima_debugfs_list,
+					ARRAY_SIZE(lima_debugfs_list),
+					minor->debugfs_root, minor);
+}
+#endif
 
 /**
  * Changelog:
  *
  * - 1.1.0 - add heap buffer support
+ * - 1.2.0 - add madvise and purgeable buffer support
+ * - 1.3.0 - add performance counter support
+ * - 1.4.0 - add batched submit
  */
 
 static struct drm_driver lima_drm_driver = {
@@ -268,7 +460,7 @@ static struct drm_driver lima_drm_driver = {
 	.desc               = "lima DRM",
 	.date               = "20191231",
 	.major              = 1,
-	.minor              = 1,
+	.minor              = 4,
 	.patchlevel         = 0,
 
 	.gem_create_object  = lima_gem_create_object,
@@ -276,6 +468,9 @@ static struct drm_driver lima_drm_driver = {
 	.gem_prime_import_sg_table = drm_gem_shmem_prime_import_sg_table,
 	.prime_handle_to_fd = drm_gem_prime_handle_to_fd,
 	.gem_prime_mmap = drm_gem_prime_mmap,
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init = lima_debugfs_init,
+#endif
 };
 
 struct lima_block_reader {
@@ -404,6 +599,10 @@ static int lima_pdev_probe(struct platform_device *pdev)
 		goto err_out2;
 	}
 
+	err = lima_gem_shrinker_init(ldev);
+	if (err)
+		goto err_out3;
+
 	pm_runtime_set_active(ldev->dev);
 	pm_runtime_mark_last_busy(ldev->dev);
 	pm_runtime_set_autosuspend_delay(ldev->dev, 200);
@@ -416,15 +615,17 @@ static int lima_pdev_probe(struct platform_device *pdev)
 	 */
 	err = drm_dev_register(ddev, 0);
 	if (err < 0)
-		goto err_out3;
+		goto err_out4;
 
 	if (sysfs_create_bin_file(&ldev->dev->kobj, &lima_error_state_attr))
 		dev_warn(ldev->dev, "fail to create error state sysfs\n");
 
 	return 0;
 
-err_out3:
+err_out4:
 	pm_runtime_disable(ldev->dev);
+	lima_gem_shrinker_fini(ldev);
+err_out3:
 	lima_devfreq_fini(ldev);
 err_out2:
 	lima_device_fini(ldev);
@@ -448,6 +649,7 @@ static int lima_pdev_remove(struct platform_device *pdev)
 	pm_runtime_set_autosuspend_delay(ldev->dev, -1);
 	pm_runtime_disable(ldev->dev);
 
+	lima_gem_shrinker_fini(ldev);
 	lima_devfreq_fini(ldev);
 	lima_device_fini(ldev);
 
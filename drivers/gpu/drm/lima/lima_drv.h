@@ -11,10 +11,13 @@
 extern int lima_sched_timeout_ms;
 extern uint lima_heap_init_nr_pages;
 extern uint lima_max_error_tasks;
+extern bool lima_devfreq_boost;
 
 struct lima_vm;
 struct lima_bo;
 struct lima_sched_task;
+struct drm_syncobj;
+struct dma_fence;
 
 struct drm_lima_gem_submit_bo;
 
@@ -34,8 +37,13 @@ struct lima_submit {
 
 	u32 in_sync[2];
 	u32 out_sync;
+	struct drm_syncobj *out_syncobj;
+
+	/* earlier tasks of the same batch this one waits for */
+	u32 deps;
 
 	struct lima_sched_task *task;
+	struct dma_fence *fence;
 };
 
 static inline struct lima_drm_priv *
@@ -13,28 +13,35 @@
 
 #include <drm/lima_drm.h>
 
+#include "lima_device.h"
 #include "lima_drv.h"
 #include "lima_gem.h"
 #include "lima_vm.h"
 
-int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm)
+/*
+ * Grow a heap buffer to new_size. Only the pages added by this call are
+ * read in, DMA mapped and mapped into vm, so the cost of a growth step
+ * does not depend on how large the heap already is.
+ */
+int lima_heap_grow(struct lima_bo *bo, struct lima_vm *vm, size_t new_size)
 {
 	struct page **pages;
 	struct address_space *mapping = bo->base.base.filp->f_mapping;
 	struct device *dev = bo->base.base.dev->dev;
-	size_t old_size = bo->heap_size;
-	size_t new_size = bo->heap_size ? bo->heap_size * 2 :
-		(lima_heap_init_nr_pages << PAGE_SHIFT);
-	struct sg_table sgt;
-	int i, ret;
-
-	if (bo->heap_size >= bo->base.base.size)
-		return -ENOSPC;
+	struct lima_heap_chunk *chunk;
+	size_t old_size;
+	int i, n, ret;
 
-	new_size = min(new_size, bo->base.base.size);
+	new_size = min(PAGE_ALIGN(new_size), bo->base.base.size);
 
 	mutex_lock(&bo->base.pages_lock);
 
+	old_size = bo->heap_size;
+	if (new_size <= old_size) {
+		mutex_unlock(&bo->base.pages_lock);
+		return 0;
+	}
+
 	if (bo->base.pages) {
 		pages = bo->base.pages;
 	} else {
@@ -51,47 +58,77 @@ int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm)
 		mapping_set_unevictable(mapping);
 	}
 
-	for (i = old_size >> PAGE_SHIFT; i < new_size >> PAGE_SHIFT; i++) {
+	chunk = kzalloc(sizeof(*chunk), GFP_KERNEL);
+	if (!chunk) {
+		ret = -ENOMEM;
+		goto err_out0;
+	}
+
+	chunk->pageoff = old_size >> PAGE_SHIFT;
+
+	for (i = chunk->pageoff; i < new_size >> PAGE_SHIFT; i++) {
 		struct page *page = shmem_read_mapping_page(mapping, i);
 
 		if (IS_ERR(page)) {
-			mutex_unlock(&bo->base.pages_lock);
-			return PTR_ERR(page);
+			ret = PTR_ERR(page);
+			goto err_out1;
 		}
 		pages[i] = page;
 	}
 
-	mutex_unlock(&bo->base.pages_lock);
-
-	ret = sg_alloc_table_from_pages(&sgt, pages, i, 0,
-					new_size, GFP_KERNEL);
+	ret = sg_alloc_table_from_pages(&chunk->sgt, pages + chunk->pageoff,
+					i - chunk->pageoff, 0,
+					new_size - old_size, GFP_KERNEL);
 	if (ret)
-		return ret;
+		goto err_out1;
 
-	if (bo->base.sgt) {
-		dma_unmap_sg(dev, bo->base.sgt->sgl,
-			     bo->base.sgt->nents, DMA_BIDIRECTIONAL);
-		sg_free_table(bo->base.sgt);
-	} else {
-		bo->base.sgt = kmalloc(sizeof(*bo->base.sgt), GFP_KERNEL);
-		if (!bo->base.sgt) {
-			sg_free_table(&sgt);
-			return -ENOMEM;
-		}
+	n = dma_map_sg(dev, chunk->sgt.sgl, chunk->sgt.orig_nents,
+		       DMA_BIDIRECTIONAL);
+	if (!n) {
+		ret = -ENOMEM;
+		goto err_out2;
 	}
-
-	dma_map_sg(dev, sgt.sgl, sgt.nents, DMA_BIDIRECTIONAL);
-
-	*bo->base.sgt = sgt;
+	chunk->sgt.nents = n;
 
 	if (vm) {
-		ret = lima_vm_map_bo(vm, bo, old_size >> PAGE_SHIFT);
+		ret = lima_vm_map_bo(vm, bo, &chunk->sgt, chunk->pageoff);
 		if (ret)
-			return ret;
+			goto err_out3;
 	}
 
+	mutex_lock(&bo->lock);
+	list_add_tail(&chunk->list, &bo->heap_chunks);
 	bo->heap_size = new_size;
+	mutex_unlock(&bo->lock);
+
+	mutex_unlock(&bo->base.pages_lock);
 	return 0;
+
+err_out3:
+	dma_unmap_sg(dev, chunk->sgt.sgl, chunk->sgt.orig_nents,
+		     DMA_BIDIRECTIONAL);
+err_out2:
+	sg_free_table(&chunk->sgt);
+err_out1:
+	while (--i >= (int)chunk->pageoff) {
+		put_page(pages[i]);
+		pages[i] = NULL;
+	}
+	kfree(chunk);
+err_out0:
+	mutex_unlock(&bo->base.pages_lock);
+	return ret;
+}
+
+int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm)
+{
+	size_t new_size = bo->heap_size ? bo->heap_size * 2 :
+		(lima_heap_init_nr_pages << PAGE_SHIFT);
+
+	if (bo->heap_size >= bo->base.base.size)
+		return -ENOSPC;
+
+	return lima_heap_grow(bo, vm, new_size);
 }
 
 int lima_gem_create_handle(struct drm_device *dev, struct drm_file *file,
@@ -142,10 +179,24 @@ int lima_gem_create_handle(struct drm_device *dev, struct drm_file *file,
 static void lima_gem_free_object(struct drm_gem_object *obj)
 {
 	struct lima_bo *bo = to_lima_bo(obj);
+	struct lima_device *ldev = to_lima_dev(obj->dev);
+	struct lima_heap_chunk *chunk, *tmp;
 
 	if (!list_empty(&bo->va))
 		dev_err(obj->dev->dev, "lima gem free bo still has va\n");
 
+	/* make sure the shrinker can no longer find this BO */
+	mutex_lock(&ldev->shrinker_lock);
+	list_del_init(&bo->base.madv_list);
+	mutex_unlock(&ldev->shrinker_lock);
+
+	list_for_each_entry_safe(chunk, tmp, &bo->heap_chunks, list) {
+		dma_unmap_sg(obj->dev->dev, chunk->sgt.sgl,
+			     chunk->sgt.orig_nents, DMA_BIDIRECTIONAL);
+		sg_free_table(&chunk->sgt);
+		kfree(chunk);
+	}
+
 	drm_gem_shmem_free_object(obj);
 }
 
@@ -155,6 +206,10 @@ static int lima_gem_object_open(struct drm_gem_object *obj, struct drm_file *fil
 	struct lima_drm_priv *priv = to_lima_drm_priv(file);
 	struct lima_vm *vm = priv->vm;
 
+	/* purged BOs have no pages left to map */
+	if (bo->base.madv < 0)
+		return -EINVAL;
+
 	return lima_vm_bo_add(vm, bo, true);
 }
 
@@ -220,6 +275,7 @@ struct drm_gem_object *lima_gem_create_object(struct drm_device *dev, size_t siz
 
 	mutex_init(&bo->lock);
 	INIT_LIST_HEAD(&bo->va);
+	INIT_LIST_HEAD(&bo->heap_chunks);
 
 	bo->base.base.funcs = &lima_gem_funcs;
 
@@ -248,12 +304,12 @@ int lima_gem_get_info(struct drm_file *file, u32 handle, u32 *va, u64 *offset)
 }
 
 static int lima_gem_sync_bo(struct lima_sched_task *task, struct lima_bo *bo,
-			    bool write, bool explicit)
+			    bool write, bool explicit, int num_fences)
 {
 	int err = 0;
 
 	if (!write) {
-		err = dma_resv_reserve_shared(lima_bo_resv(bo), 1);
+		err = dma_resv_reserve_shared(lima_bo_resv(bo), num_fences);
 		if (err)
 			return err;
 	}
@@ -265,8 +321,10 @@ static int lima_gem_sync_bo(struct lima_sched_task *task, struct lima_bo *bo,
 	return drm_gem_fence_array_add_implicit(&task->deps, &bo->base.base, write);
 }
 
-static int lima_gem_add_deps(struct drm_file *file, struct lima_submit *submit)
+static int lima_gem_add_deps(struct drm_file *file, struct lima_submit *submit,
+			     struct lima_submit *batch)
 {
+	unsigned long deps = submit->deps;
 	int i, err;
 
 	for (i = 0; i < ARRAY_SIZE(submit->in_sync); i++) {
@@ -287,22 +345,46 @@ static int lima_gem_add_deps(struct drm_file *file, struct lima_submit *submit)
 		}
 	}
 
+	/* tasks earlier in the same batch are not queued yet, but their
+	 * scheduler fences already exist
+	 */
+	for_each_set_bit(i, &deps, LIMA_SUBMIT_BATCH_MAX_TASKS) {
+		struct dma_fence *fence;
+
+		fence = dma_fence_get(&batch[i].task->base.s_fence->finished);
+		err = drm_gem_fence_array_add(&submit->task->deps, fence);
+		if (err) {
+			dma_fence_put(fence);
+			return err;
+		}
+	}
+
 	return 0;
 }
 
-int lima_gem_submit(struct drm_file *file, struct lima_submit *submit)
+static void lima_gem_put_bos(struct lima_vm *vm, struct lima_submit *submit)
+{
+	int i;
+
+	for (i = 0; i < submit->nr_bos; i++) {
+		if (!submit->lbos[i])
+			break;
+		lima_vm_bo_del(vm, submit->lbos[i]);
+		drm_gem_object_put_unlocked(&submit->lbos[i]->base.base);
+	}
+	if (submit->out_syncobj)
+		drm_syncobj_put(submit->out_syncobj);
+}
+
+static int lima_gem_lookup_bos(struct drm_file *file, struct lima_submit *submit)
 {
-	int i, err = 0;
-	struct ww_acquire_ctx ctx;
 	struct lima_drm_priv *priv = to_lima_drm_priv(file);
 	struct lima_vm *vm = priv->vm;
-	struct drm_syncobj *out_sync = NULL;
-	struct dma_fence *fence;
-	struct lima_bo **bos = submit->lbos;
+	int i, err;
 
 	if (submit->out_sync) {
-		out_sync = drm_syncobj_find(file, submit->out_sync);
-		if (!out_sync)
+		submit->out_syncobj = drm_syncobj_find(file, submit->out_sync);
+		if (!submit->out_syncobj)
 			return -ENOENT;
 	}
 
@@ -313,86 +395,232 @@ int lima_gem_submit(struct drm_file *file, struct lima_submit *submit)
 		obj = drm_gem_object_lookup(file, submit->bos[i].handle);
 		if (!obj) {
 			err = -ENOENT;
-			goto err_out0;
+			goto err_out;
 		}
 
 		bo = to_lima_bo(obj);
 
+		/* the contents of purgeable BOs may be gone at any time */
+		if (bo->base.madv != LIMA_MADV_WILLNEED) {
+			drm_gem_object_put_unlocked(obj);
+			err = -EINVAL;
+			goto err_out;
+		}
+
 		/* increase refcnt of gpu va map to prevent unmapped when executing,
 		 * will be decreased when task done
 		 */
 		err = lima_vm_bo_add(vm, bo, false);
 		if (err) {
 			drm_gem_object_put_unlocked(obj);
-			goto err_out0;
+			goto err_out;
 		}
 
-		bos[i] = bo;
+		submit->lbos[i] = bo;
 	}
 
-	err = drm_gem_lock_reservations((struct drm_gem_object **)bos,
-					submit->nr_bos, &ctx);
-	if (err)
-		goto err_out0;
+	return 0;
+
+err_out:
+	lima_gem_put_bos(vm, submit);
+	return err;
+}
+
+/* Add the BOs of a task not already in objs, return the new count */
+static int lima_gem_add_objs(struct drm_gem_object **objs, int nr_objs,
+			     struct lima_submit *submit)
+{
+	int i, j;
+
+	for (i = 0; i < submit->nr_bos; i++) {
+		struct drm_gem_object *obj = &submit->lbos[i]->base.base;
+
+		for (j = 0; j < nr_objs; j++) {
+			if (objs[j] == obj)
+				break;
+		}
+		if (j == nr_objs)
+			objs[nr_objs++] = obj;
+	}
+
+	return nr_objs;
+}
+
+static int lima_gem_prepare_task(struct drm_file *file,
+				 struct lima_submit *submit,
+				 struct lima_submit *batch, int nr)
+{
+	struct lima_drm_priv *priv = to_lima_drm_priv(file);
+	int i, err;
 
 	err = lima_sched_task_init(
 		submit->task, submit->ctx->context + submit->pipe,
-		bos, submit->nr_bos, vm);
+		submit->lbos, submit->nr_bos, priv->vm);
 	if (err)
-		goto err_out1;
+		return err;
+
+	lima_perfcnt_task_init(to_lima_dev(file->minor->dev), file,
+			       submit->task, submit->pipe);
 
-	err = lima_gem_add_deps(file, submit);
+	err = lima_gem_add_deps(file, submit, batch);
 	if (err)
-		goto err_out2;
+		goto err_out;
 
 	for (i = 0; i < submit->nr_bos; i++) {
 		err = lima_gem_sync_bo(
-			submit->task, bos[i],
+			submit->task, submit->lbos[i],
 			submit->bos[i].flags & LIMA_SUBMIT_BO_WRITE,
-			submit->flags & LIMA_SUBMIT_FLAG_EXPLICIT_FENCE);
+			submit->flags & LIMA_SUBMIT_FLAG_EXPLICIT_FENCE, nr);
 		if (err)
-			goto err_out2;
+			goto err_out;
 	}
 
-	fence = lima_sched_context_queue_task(
+	return 0;
+
+err_out:
+	lima_sched_task_fini(submit->task);
+	return err;
+}
+
+static void lima_gem_push_task(struct lima_submit *submit)
+{
+	int i;
+
+	submit->fence = lima_sched_context_queue_task(
 		submit->ctx->context + submit->pipe, submit->task);
 
 	for (i = 0; i < submit->nr_bos; i++) {
 		if (submit->bos[i].flags & LIMA_SUBMIT_BO_WRITE)
-			dma_resv_add_excl_fence(lima_bo_resv(bos[i]), fence);
+			dma_resv_add_excl_fence(lima_bo_resv(submit->lbos[i]),
+						submit->fence);
 		else
-			dma_resv_add_shared_fence(lima_bo_resv(bos[i]), fence);
+			dma_resv_add_shared_fence(lima_bo_resv(submit->lbos[i]),
+						  submit->fence);
 	}
+}
+
+/*
+ * Queue nr tasks of the same context. The BOs used by the whole batch are
+ * reserved once, and the tasks are only queued once all of them could be
+ * set up, so either every task is queued or none is.
+ */
+int lima_gem_submit(struct drm_file *file, struct lima_submit *submits, int nr)
+{
+	struct lima_drm_priv *priv = to_lima_drm_priv(file);
+	struct lima_vm *vm = priv->vm;
+	struct drm_gem_object **objs;
+	struct ww_acquire_ctx ctx;
+	int i, j, total = 0, nr_objs = 0;
+	int err = 0;
 
-	drm_gem_unlock_reservations((struct drm_gem_object **)bos,
-				    submit->nr_bos, &ctx);
+	for (i = 0; i < nr; i++)
+		total += submits[i].nr_bos;
 
-	for (i = 0; i < submit->nr_bos; i++)
-		drm_gem_object_put_unlocked(&bos[i]->base.base);
+	objs = kvmalloc_array(total, sizeof(*objs), GFP_KERNEL);
+	if (!objs)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		err = lima_gem_lookup_bos(file, submits + i);
+		if (err)
+			goto err_out0;
+		nr_objs = lima_gem_add_objs(objs, nr_objs, submits + i);
+	}
+
+	err = drm_gem_lock_reservations(objs, nr_objs, &ctx);
+	if (err)
+		goto err_out0;
 
-	if (out_sync) {
-		drm_syncobj_replace_fence(out_sync, fence);
-		drm_syncobj_put(out_sync);
+	for (j = 0; j < nr; j++) {
+		err = lima_gem_prepare_task(file, submits + j, submits, nr);
+		if (err)
+			goto err_out1;
 	}
 
-	dma_fence_put(fence);
+	for (j = 0; j < nr; j++)
+		lima_gem_push_task(submits + j);
+
+	drm_gem_unlock_reservations(objs, nr_objs, &ctx);
+	kvfree(objs);
+
+	for (i = 0; i < nr; i++) {
+		struct lima_submit *submit = submits + i;
+		int k;
+
+		for (k = 0; k < submit->nr_bos; k++)
+			drm_gem_object_put_unlocked(&submit->lbos[k]->base.base);
+
+		if (submit->out_syncobj) {
+			drm_syncobj_replace_fence(submit->out_syncobj,
+						  submit->fence);
+			drm_syncobj_put(submit->out_syncobj);
+		}
+
+		dma_fence_put(submit->fence);
+	}
 
 	return 0;
 
-err_out2:
-	lima_sched_task_fini(submit->task);
 err_out1:
-	drm_gem_unlock_reservations((struct drm_gem_object **)bos,
-				    submit->nr_bos, &ctx);
+	while (--j >= 0)
+		lima_sched_task_fini(submits[j].task);
+	drm_gem_unlock_reservations(objs, nr_objs, &ctx);
 err_out0:
-	for (i = 0; i < submit->nr_bos; i++) {
-		if (!bos[i])
-			break;
-		lima_vm_bo_del(vm, bos[i]);
-		drm_gem_object_put_unlocked(&bos[i]->base.base);
+	while (--i >= 0)
+		lima_gem_put_bos(vm, submits + i);
+	kvfree(objs);
+	return err;
+}
+
+int lima_gem_madvise(struct drm_file *file, u32 handle, u32 madv,
+		     u32 *retained)
+{
+	struct lima_device *ldev = to_lima_dev(file->minor->dev);
+	struct lima_drm_priv *priv = to_lima_drm_priv(file);
+	struct drm_gem_object *obj;
+	struct lima_bo *bo;
+	int err = 0;
+
+	obj = drm_gem_object_lookup(file, handle);
+	if (!obj)
+		return -ENOENT;
+
+	bo = to_lima_bo(obj);
+
+	/* heap BOs manage their pages by hand and are never purged */
+	if (bo->heap_size) {
+		err = -EINVAL;
+		goto out;
 	}
-	if (out_sync)
-		drm_syncobj_put(out_sync);
+
+	mutex_lock(&ldev->shrinker_lock);
+	mutex_lock(&bo->lock);
+
+	/*
+	 * Only BOs used by the caller alone can become purgeable, shared
+	 * buffers are unlikely to ever be marked so anyway.
+	 */
+	if (madv == LIMA_MADV_DONTNEED &&
+	    !lima_vm_bo_is_private(priv->vm, bo)) {
+		err = -EINVAL;
+		goto out_unlock;
+	}
+
+	*retained = drm_gem_shmem_madvise(obj, madv);
+
+	if (*retained) {
+		if (madv == LIMA_MADV_DONTNEED)
+			list_add_tail(&bo->base.madv_list,
+				      &ldev->shrinker_list);
+		else
+			list_del_init(&bo->base.madv_list);
+	}
+
+out_unlock:
+	mutex_unlock(&bo->lock);
+	mutex_unlock(&ldev->shrinker_lock);
+out:
+	drm_gem_object_put_unlocked(obj);
 	return err;
 }
 
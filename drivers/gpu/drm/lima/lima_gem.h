@@ -6,9 +6,17 @@
 
 #include <drm/drm_gem_shmem_helper.h>
 
+struct lima_device;
 struct lima_submit;
 struct lima_vm;
 
+/* a DMA mapped range of heap buffer pages added by one growth step */
+struct lima_heap_chunk {
+	struct list_head list;
+	struct sg_table sgt;
+	u32 pageoff;
+};
+
 struct lima_bo {
 	struct drm_gem_shmem_object base;
 
@@ -16,6 +24,10 @@ struct lima_bo {
 	struct list_head va;
 
 	size_t heap_size;
+	struct list_head heap_chunks;
+
+	/* number of queued or running tasks using this BO */
+	atomic_t gpu_usecount;
 };
 
 static inline struct lima_bo *
@@ -34,13 +46,19 @@ static inline struct dma_resv *lima_bo_resv(struct lima_bo *bo)
 	return bo->base.base.resv;
 }
 
+int lima_heap_grow(struct lima_bo *bo, struct lima_vm *vm, size_t new_size);
 int lima_heap_alloc(struct lima_bo *bo, struct lima_vm *vm);
 struct drm_gem_object *lima_gem_create_object(struct drm_device *dev, size_t size);
 int lima_gem_create_handle(struct drm_device *dev, struct drm_file *file,
 			   u32 size, u32 flags, u32 *handle);
 int lima_gem_get_info(struct drm_file *file, u32 handle, u32 *va, u64 *offset);
-int lima_gem_submit(struct drm_file *file, struct lima_submit *submit);
+int lima_gem_submit(struct drm_file *file, struct lima_submit *submits, int nr);
 int lima_gem_wait(struct drm_file *file, u32 handle, u32 op, s64 timeout_ns);
+int lima_gem_madvise(struct drm_file *file, u32 handle, u32 madv,
+		     u32 *retained);
+
+int lima_gem_shrinker_init(struct lima_device *ldev);
+void lima_gem_shrinker_fini(struct lima_device *ldev);
 
 void lima_set_vma_flags(struct vm_area_struct *vma);
 
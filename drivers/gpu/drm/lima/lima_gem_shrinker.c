@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0 OR MIT
+/* Copyright 2017-2019 Qiang Yu <yuq825@gmail.com> */
+
+#include <linux/list.h>
+
+#include <drm/drm_device.h>
+#include <drm/drm_gem_shmem_helper.h>
+
+#include "lima_device.h"
+#include "lima_gem.h"
+#include "lima_vm.h"
+
+static unsigned long
+lima_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct lima_device *ldev =
+		container_of(shrinker, struct lima_device, shrinker);
+	struct drm_gem_shmem_object *shmem;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&ldev->shrinker_lock))
+		return 0;
+
+	list_for_each_entry(shmem, &ldev->shrinker_list, madv_list) {
+		if (drm_gem_shmem_is_purgeable(shmem))
+			count += shmem->base.size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&ldev->shrinker_lock);
+
+	return count;
+}
+
+static bool lima_gem_purge(struct drm_gem_object *obj)
+{
+	struct drm_gem_shmem_object *shmem = to_drm_gem_shmem_obj(obj);
+	struct lima_bo *bo = to_lima_bo(obj);
+	bool ret = false;
+
+	if (atomic_read(&bo->gpu_usecount))
+		return false;
+
+	if (!mutex_trylock(&bo->lock))
+		return false;
+
+	if (!mutex_trylock(&shmem->pages_lock))
+		goto out;
+
+	/* the VA ranges stay reserved until the BO is closed */
+	lima_vm_bo_unmap_all(bo);
+	drm_gem_shmem_purge_locked(obj);
+	ret = true;
+
+	mutex_unlock(&shmem->pages_lock);
+out:
+	mutex_unlock(&bo->lock);
+	return ret;
+}
+
+static unsigned long
+lima_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct lima_device *ldev =
+		container_of(shrinker, struct lima_device, shrinker);
+	struct drm_gem_shmem_object *shmem, *tmp;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&ldev->shrinker_lock))
+		return SHRINK_STOP;
+
+	list_for_each_entry_safe(shmem, tmp, &ldev->shrinker_list, madv_list) {
+		if (freed >= sc->nr_to_scan)
+			break;
+		if (drm_gem_shmem_is_purgeable(shmem) &&
+		    lima_gem_purge(&shmem->base)) {
+			freed += shmem->base.size >> PAGE_SHIFT;
+			list_del_init(&shmem->madv_list);
+		}
+	}
+
+	mutex_unlock(&ldev->shrinker_lock);
+
+	if (freed > 0)
+		dev_dbg(ldev->dev, "purged %lu bytes\n", freed << PAGE_SHIFT);
+
+	return freed;
+}
+
+int lima_gem_shrinker_init(struct lima_device *ldev)
+{
+	mutex_init(&ldev->shrinker_lock);
+	INIT_LIST_HEAD(&ldev->shrinker_list);
+
+	ldev->shrinker.count_objects = lima_gem_shrinker_count;
+	ldev->shrinker.scan_objects = lima_gem_shrinker_scan;
+	ldev->shrinker.seeks = DEFAULT_SEEKS;
+
+	return register_shrinker(&ldev->shrinker);
+}
+
+void lima_gem_shrinker_fini(struct lima_device *ldev)
+{
+	unregister_shrinker(&ldev->shrinker);
+}
@@ -140,6 +140,15 @@ static void lima_gp_task_run(struct lima_sched_pipe *pipe,
 		if (bo->heap_size &&
 		    lima_vm_get_va(task->vm, bo) ==
 		    f[LIMA_GP_PLBU_ALLOC_START_ADDR >> 2]) {
+			/*
+			 * Start with the size earlier frames ended up with,
+			 * instead of stalling on out of memory interrupts to
+			 * grow the heap again. Failure is not fatal, the
+			 * heap can still grow on demand.
+			 */
+			if (bo->heap_size < task->vm->heap_hwm)
+				lima_heap_grow(bo, task->vm, task->vm->heap_hwm);
+
 			f[LIMA_GP_PLBU_ALLOC_END_ADDR >> 2] =
 				f[LIMA_GP_PLBU_ALLOC_START_ADDR >> 2] +
 				bo->heap_size;
@@ -162,6 +171,13 @@ static void lima_gp_task_run(struct lima_sched_pipe *pipe,
 	for (i = 0; i < LIMA_GP_FRAME_REG_NUM; i++)
 		writel(f[i], ip->iomem + LIMA_GP_VSCL_START_ADDR + i * 4);
 
+	if (task->perfcnt_gen) {
+		gp_write(LIMA_GP_PERF_CNT_0_SRC, task->perfcnt_src[0]);
+		gp_write(LIMA_GP_PERF_CNT_1_SRC, task->perfcnt_src[1]);
+		gp_write(LIMA_GP_PERF_CNT_0_ENABLE, 1);
+		gp_write(LIMA_GP_PERF_CNT_1_ENABLE, 1);
+	}
+
 	gp_write(LIMA_GP_CMD, LIMA_GP_CMD_UPDATE_PLBU_ALLOC);
 	gp_write(LIMA_GP_CMD, cmd);
 }
@@ -194,7 +210,16 @@ static int lima_gp_hard_reset(struct lima_ip *ip)
 
 static void lima_gp_task_fini(struct lima_sched_pipe *pipe)
 {
-	lima_gp_soft_reset_async(pipe->processor[0]);
+	struct lima_ip *ip = pipe->processor[0];
+	struct lima_sched_task *task = pipe->current_task;
+
+	/* read the counters before the soft reset clears them */
+	if (task->perfcnt_gen)
+		lima_perfcnt_add(ip->dev, task, lima_pipe_gp, 0,
+				 gp_read(LIMA_GP_PERF_CNT_0_VALUE),
+				 gp_read(LIMA_GP_PERF_CNT_1_VALUE));
+
+	lima_gp_soft_reset_async(ip);
 }
 
 static void lima_gp_task_error(struct lima_sched_pipe *pipe)
@@ -228,6 +253,9 @@ static int lima_gp_task_recover(struct lima_sched_pipe *pipe)
 		ret = lima_heap_alloc(task->heap, task->vm);
 		if (ret < 0)
 			return ret;
+
+		task->vm->heap_hwm = max(task->vm->heap_hwm,
+					 task->heap->heap_size);
 	}
 
 	gp_write(LIMA_GP_INT_MASK, LIMA_GP_IRQ_MASK_USED);
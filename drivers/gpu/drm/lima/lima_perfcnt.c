@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0 OR MIT
+/* Copyright 2017-2019 Qiang Yu <yuq825@gmail.com> */
+
+#include <linux/string.h>
+
+#include <drm/drm_file.h>
+
+#include "lima_device.h"
+#include "lima_perfcnt.h"
+#include "lima_sched.h"
+
+/*
+ * Each GP and PP core has two counters with a selectable event source.
+ * While a client has them enabled, the counters are set up for every
+ * task of that client and read back when the task is done, so only the
+ * client's own jobs are sampled. Values accumulate until the next dump.
+ */
+
+void lima_perfcnt_init(struct lima_device *ldev)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+
+	mutex_init(&perfcnt->lock);
+	spin_lock_init(&perfcnt->values_lock);
+}
+
+static void lima_perfcnt_reset_values(struct lima_perfcnt *perfcnt)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&perfcnt->values_lock, flags);
+	memset(perfcnt->gp, 0, sizeof(perfcnt->gp));
+	memset(perfcnt->pp, 0, sizeof(perfcnt->pp));
+	spin_unlock_irqrestore(&perfcnt->values_lock, flags);
+}
+
+int lima_perfcnt_enable(struct lima_device *ldev, struct drm_file *file,
+			struct drm_lima_perfcnt_enable *args)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+	int err = 0;
+
+	mutex_lock(&perfcnt->lock);
+
+	if (perfcnt->user && perfcnt->user != file) {
+		err = -EBUSY;
+		goto out;
+	}
+
+	if (!args->enable) {
+		if (perfcnt->user != file)
+			err = -EINVAL;
+		perfcnt->user = NULL;
+		perfcnt->gen = 0;
+		goto out;
+	}
+
+	perfcnt->user = file;
+	if (!++perfcnt->gen)
+		perfcnt->gen = 1;
+	memcpy(perfcnt->src[lima_pipe_gp], args->gp_src,
+	       sizeof(args->gp_src));
+	memcpy(perfcnt->src[lima_pipe_pp], args->pp_src,
+	       sizeof(args->pp_src));
+	lima_perfcnt_reset_values(perfcnt);
+
+out:
+	mutex_unlock(&perfcnt->lock);
+	return err;
+}
+
+int lima_perfcnt_dump(struct lima_device *ldev, struct drm_file *file,
+		      struct drm_lima_perfcnt_dump *args)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+	unsigned long flags;
+	int err = 0;
+
+	mutex_lock(&perfcnt->lock);
+
+	if (perfcnt->user != file) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	spin_lock_irqsave(&perfcnt->values_lock, flags);
+	memcpy(args->gp, perfcnt->gp, sizeof(args->gp));
+	memcpy(args->pp, perfcnt->pp, sizeof(args->pp));
+	memset(perfcnt->gp, 0, sizeof(perfcnt->gp));
+	memset(perfcnt->pp, 0, sizeof(perfcnt->pp));
+	spin_unlock_irqrestore(&perfcnt->values_lock, flags);
+
+out:
+	mutex_unlock(&perfcnt->lock);
+	return err;
+}
+
+void lima_perfcnt_close(struct lima_device *ldev, struct drm_file *file)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user == file) {
+		perfcnt->user = NULL;
+		perfcnt->gen = 0;
+	}
+	mutex_unlock(&perfcnt->lock);
+}
+
+void lima_perfcnt_task_init(struct lima_device *ldev, struct drm_file *file,
+			    struct lima_sched_task *task, int pipe)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user == file) {
+		task->perfcnt_gen = perfcnt->gen;
+		memcpy(task->perfcnt_src, perfcnt->src[pipe],
+		       sizeof(task->perfcnt_src));
+	} else
+		task->perfcnt_gen = 0;
+	mutex_unlock(&perfcnt->lock);
+}
+
+void lima_perfcnt_add(struct lima_device *ldev, struct lima_sched_task *task,
+		      int pipe, int core, u32 val0, u32 val1)
+{
+	struct lima_perfcnt *perfcnt = &ldev->perfcnt;
+	unsigned long flags;
+	u64 *values;
+
+	spin_lock_irqsave(&perfcnt->values_lock, flags);
+
+	/* drop samples of tasks queued before the last enable/disable */
+	if (READ_ONCE(perfcnt->gen) != task->perfcnt_gen)
+		goto out;
+
+	values = pipe == lima_pipe_gp ? perfcnt->gp : perfcnt->pp[core];
+	values[0] += val0;
+	values[1] += val1;
+
+out:
+	spin_unlock_irqrestore(&perfcnt->values_lock, flags);
+}
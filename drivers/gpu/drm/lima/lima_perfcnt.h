@@ -0,0 +1,42 @@
+/* SPDX-License-Identifier: GPL-2.0 OR MIT */
+/* Copyright 2017-2019 Qiang Yu <yuq825@gmail.com> */
+
+#ifndef __LIMA_PERFCNT_H__
+#define __LIMA_PERFCNT_H__
+
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+
+#include <drm/lima_drm.h>
+
+struct drm_file;
+struct lima_device;
+struct lima_sched_task;
+
+struct lima_perfcnt {
+	/* protects user, gen and src */
+	struct mutex lock;
+	struct drm_file *user;
+	/* bumped on every enable, 0 means disabled */
+	u32 gen;
+	u32 src[2][LIMA_PERFCNT_NUM];
+
+	/* protects the accumulated values, updated from irq context */
+	spinlock_t values_lock;
+	u64 gp[LIMA_PERFCNT_NUM];
+	u64 pp[LIMA_PERFCNT_MAX_PP][LIMA_PERFCNT_NUM];
+};
+
+void lima_perfcnt_init(struct lima_device *ldev);
+int lima_perfcnt_enable(struct lima_device *ldev, struct drm_file *file,
+			struct drm_lima_perfcnt_enable *args);
+int lima_perfcnt_dump(struct lima_device *ldev, struct drm_file *file,
+		      struct drm_lima_perfcnt_dump *args);
+void lima_perfcnt_close(struct lima_device *ldev, struct drm_file *file);
+
+void lima_perfcnt_task_init(struct lima_device *ldev, struct drm_file *file,
+			    struct lima_sched_task *task, int pipe);
+void lima_perfcnt_add(struct lima_device *ldev, struct lima_sched_task *task,
+		      int pipe, int core, u32 val0, u32 val1);
+
+#endif
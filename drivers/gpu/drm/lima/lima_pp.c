@@ -50,6 +50,7 @@ static irqreturn_t lima_pp_irq_handler(int irq, void *data)
 		return IRQ_NONE;
 
 	lima_pp_handle_irq(ip, state);
+	lima_ip_busy_end(ip);
 
 	if (atomic_dec_and_test(&pipe->task))
 		lima_sched_pipe_task_done(pipe);
@@ -93,6 +94,8 @@ static irqreturn_t lima_pp_bcast_irq_handler(int irq, void *data)
 				continue;
 		}
 
+		lima_ip_busy_end(ip);
+
 		pipe->done |= (1 << i);
 		if (atomic_dec_and_test(&pipe->task))
 			lima_sched_pipe_task_done(pipe);
@@ -168,6 +171,46 @@ static void lima_pp_write_frame(struct lima_ip *ip, u32 *frame, u32 *wb)
 	}
 }
 
+static void lima_pp_perfcnt_start(struct lima_ip *ip,
+				  struct lima_sched_task *task)
+{
+	if (!task->perfcnt_gen)
+		return;
+
+	pp_write(LIMA_PP_PERF_CNT_0_SRC, task->perfcnt_src[0]);
+	pp_write(LIMA_PP_PERF_CNT_1_SRC, task->perfcnt_src[1]);
+	pp_write(LIMA_PP_PERF_CNT_0_ENABLE, 1);
+	pp_write(LIMA_PP_PERF_CNT_1_ENABLE, 1);
+}
+
+static void lima_pp_perfcnt_collect(struct lima_sched_pipe *pipe,
+				    struct lima_sched_task *task)
+{
+	u32 num_pp;
+	int i;
+
+	if (!task->perfcnt_gen)
+		return;
+
+	if (pipe->bcast_processor) {
+		struct drm_lima_m450_pp_frame *frame = task->frame;
+
+		num_pp = frame->num_pp;
+	} else {
+		struct drm_lima_m400_pp_frame *frame = task->frame;
+
+		num_pp = frame->num_pp;
+	}
+
+	for (i = 0; i < num_pp; i++) {
+		struct lima_ip *ip = pipe->processor[i];
+
+		lima_perfcnt_add(ip->dev, task, lima_pipe_pp, i,
+				 pp_read(LIMA_PP_PERF_CNT_0_VALUE),
+				 pp_read(LIMA_PP_PERF_CNT_1_VALUE));
+	}
+}
+
 static int lima_pp_hard_reset_poll(struct lima_ip *ip)
 {
 	pp_write(LIMA_PP_PERF_CNT_0_LIMIT, 0xC01A0000);
@@ -356,6 +399,9 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 			pp_write(LIMA_PP_STACK, frame->fragment_stack_address[i]);
 			if (!frame->use_dlbu)
 				pp_write(LIMA_PP_FRAME, frame->plbu_array_address[i]);
+
+			lima_pp_perfcnt_start(ip, task);
+			lima_ip_busy_begin(ip);
 		}
 
 		pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
@@ -377,6 +423,8 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 
 			lima_pp_write_frame(ip, frame->frame, frame->wb);
 
+			lima_pp_perfcnt_start(ip, task);
+			lima_ip_busy_begin(ip);
 			pp_write(LIMA_PP_CTRL, LIMA_PP_CTRL_START_RENDERING);
 		}
 	}
@@ -384,6 +432,9 @@ static void lima_pp_task_run(struct lima_sched_pipe *pipe,
 
 static void lima_pp_task_fini(struct lima_sched_pipe *pipe)
 {
+	/* read the counters before the soft reset clears them */
+	lima_pp_perfcnt_collect(pipe, pipe->current_task);
+
 	if (pipe->bcast_processor)
 		lima_pp_soft_reset_async(pipe->bcast_processor);
 	else {
@@ -119,11 +119,17 @@ int lima_sched_task_init(struct lima_sched_task *task,
 	if (!task->bos)
 		return -ENOMEM;
 
-	for (i = 0; i < num_bos; i++)
+	for (i = 0; i < num_bos; i++) {
 		drm_gem_object_get(&bos[i]->base.base);
+		atomic_inc(&bos[i]->gpu_usecount);
+	}
 
 	err = drm_sched_job_init(&task->base, &context->base, vm);
 	if (err) {
+		for (i = 0; i < num_bos; i++) {
+			atomic_dec(&bos[i]->gpu_usecount);
+			drm_gem_object_put_unlocked(&bos[i]->base.base);
+		}
 		kfree(task->bos);
 		return err;
 	}
@@ -150,8 +156,10 @@ void lima_sched_task_fini(struct lima_sched_task *task)
 	xa_destroy(&task->deps);
 
 	if (task->bos) {
-		for (i = 0; i < task->num_bos; i++)
+		for (i = 0; i < task->num_bos; i++) {
+			atomic_dec(&task->bos[i]->gpu_usecount);
 			drm_gem_object_put_unlocked(&task->bos[i]->base.base);
+		}
 		kfree(task->bos);
 	}
 
@@ -195,8 +203,9 @@ static struct dma_fence *lima_sched_dependency(struct drm_sched_job *job,
 	return NULL;
 }
 
-static int lima_pm_busy(struct lima_device *ldev)
+static int lima_pm_busy(struct lima_sched_pipe *pipe)
 {
+	struct lima_device *ldev = pipe->ldev;
 	int ret;
 
 	/* resume GPU if it has been suspended by runtime PM */
@@ -204,13 +213,15 @@ static int lima_pm_busy(struct lima_device *ldev)
 	if (ret < 0)
 		return ret;
 
-	lima_devfreq_record_busy(&ldev->devfreq);
+	lima_devfreq_record_busy(&ldev->devfreq, pipe - ldev->pipe);
 	return 0;
 }
 
-static void lima_pm_idle(struct lima_device *ldev)
+static void lima_pm_idle(struct lima_sched_pipe *pipe)
 {
-	lima_devfreq_record_idle(&ldev->devfreq);
+	struct lima_device *ldev = pipe->ldev;
+
+	lima_devfreq_record_idle(&ldev->devfreq, pipe - ldev->pipe);
 
 	/* GPU can do auto runtime suspend */
 	pm_runtime_mark_last_busy(ldev->dev);
@@ -221,7 +232,6 @@ static struct dma_fence *lima_sched_run_job(struct drm_sched_job *job)
 {
 	struct lima_sched_task *task = to_lima_task(job);
 	struct lima_sched_pipe *pipe = to_lima_pipe(job->sched);
-	struct lima_device *ldev = pipe->ldev;
 	struct lima_fence *fence;
 	struct dma_fence *ret;
 	int i, err;
@@ -234,7 +244,7 @@ static struct dma_fence *lima_sched_run_job(struct drm_sched_job *job)
 	if (!fence)
 		return NULL;
 
-	err = lima_pm_busy(ldev);
+	err = lima_pm_busy(pipe);
 	if (err < 0) {
 		dma_fence_put(&fence->base);
 		return NULL;
@@ -280,6 +290,7 @@ static struct dma_fence *lima_sched_run_job(struct drm_sched_job *job)
 	trace_lima_task_run(task);
 
 	pipe->error = false;
+	task->start = ktime_get();
 	pipe->task_run(pipe, task);
 
 	return task->fence;
@@ -417,7 +428,6 @@ static void lima_sched_timedout_job(struct drm_sched_job *job)
 {
 	struct lima_sched_pipe *pipe = to_lima_pipe(job->sched);
 	struct lima_sched_task *task = to_lima_task(job);
-	struct lima_device *ldev = pipe->ldev;
 
 	if (!pipe->error)
 		DRM_ERROR("lima job timeout\n");
@@ -443,7 +453,7 @@ static void lima_sched_timedout_job(struct drm_sched_job *job)
 	pipe->current_vm = NULL;
 	pipe->current_task = NULL;
 
-	lima_pm_idle(ldev);
+	lima_pm_idle(pipe);
 
 	drm_sched_resubmit_jobs(&pipe->base);
 	drm_sched_start(&pipe->base, true);
@@ -497,14 +507,22 @@ int lima_sched_pipe_init(struct lima_sched_pipe *pipe, const char *name)
 {
 	unsigned int timeout = lima_sched_timeout_ms > 0 ?
 			       lima_sched_timeout_ms : 500;
+	int err;
 
 	pipe->fence_context = dma_fence_context_alloc(1);
 	spin_lock_init(&pipe->fence_lock);
 
 	INIT_WORK(&pipe->recover_work, lima_sched_recover_work);
 
-	return drm_sched_init(&pipe->base, &lima_sched_ops, 1, 0,
-			      msecs_to_jiffies(timeout), name);
+	err = drm_sched_init(&pipe->base, &lima_sched_ops, 1, 0,
+			     msecs_to_jiffies(timeout), name);
+	if (err)
+		return err;
+
+	/* Let idle pipes start tasks straight from the submit ioctl. */
+	pipe->base.direct_submit = true;
+
+	return 0;
 }
 
 void lima_sched_pipe_fini(struct lima_sched_pipe *pipe)
@@ -524,8 +542,12 @@ void lima_sched_pipe_task_done(struct lima_sched_pipe *pipe)
 			drm_sched_fault(&pipe->base);
 	} else {
 		pipe->task_fini(pipe);
+
+		atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), task->start)),
+			     &task->vm->busy_ns[pipe - ldev->pipe]);
+
 		dma_fence_signal(task->fence);
 
-		lima_pm_idle(ldev);
+		lima_pm_idle(pipe);
 	}
 }
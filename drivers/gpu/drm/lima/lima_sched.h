@@ -32,6 +32,13 @@ struct lima_sched_task {
 	bool recoverable;
 	struct lima_bo *heap;
 
+	/* when the task was started on the hardware */
+	ktime_t start;
+
+	/* perfcnt generation this task samples for, 0 if none */
+	u32 perfcnt_gen;
+	u32 perfcnt_src[2];
+
 	/* pipe fence */
 	struct dma_fence *fence;
 };
@@ -73,6 +73,26 @@ static int lima_vm_map_page(struct lima_vm *vm, dma_addr_t pa, u32 va)
 	return 0;
 }
 
+static int lima_vm_map_sgt(struct lima_vm *vm, struct sg_table *sgt, u32 base)
+{
+	struct sg_dma_page_iter sg_iter;
+	int offset = 0, err;
+
+	for_each_sg_dma_page(sgt->sgl, &sg_iter, sgt->nents, 0) {
+		err = lima_vm_map_page(vm, sg_page_iter_dma_address(&sg_iter),
+				       base + offset);
+		if (err) {
+			if (offset)
+				lima_vm_unmap_range(vm, base, base + offset - 1);
+			return err;
+		}
+
+		offset += PAGE_SIZE;
+	}
+
+	return 0;
+}
+
 static struct lima_bo_va *
 lima_vm_bo_find(struct lima_vm *vm, struct lima_bo *bo)
 {
@@ -91,8 +111,8 @@ lima_vm_bo_find(struct lima_vm *vm, struct lima_bo *bo)
 int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create)
 {
 	struct lima_bo_va *bo_va;
-	struct sg_dma_page_iter sg_iter;
-	int offset = 0, err;
+	struct lima_heap_chunk *chunk;
+	int err;
 
 	mutex_lock(&bo->lock);
 
@@ -124,13 +144,23 @@ int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create)
 	if (err)
 		goto err_out1;
 
-	for_each_sg_dma_page(bo->base.sgt->sgl, &sg_iter, bo->base.sgt->nents, 0) {
-		err = lima_vm_map_page(vm, sg_page_iter_dma_address(&sg_iter),
-				       bo_va->node.start + offset);
+	if (!bo->heap_size) {
+		err = lima_vm_map_sgt(vm, bo->base.sgt, bo_va->node.start);
 		if (err)
 			goto err_out2;
+	}
 
-		offset += PAGE_SIZE;
+	/* heap chunks are contiguous and ordered by page offset */
+	list_for_each_entry(chunk, &bo->heap_chunks, list) {
+		u32 base = bo_va->node.start + (chunk->pageoff << PAGE_SHIFT);
+
+		err = lima_vm_map_sgt(vm, &chunk->sgt, base);
+		if (err) {
+			if (chunk->pageoff)
+				lima_vm_unmap_range(vm, bo_va->node.start,
+						    base - 1);
+			goto err_out2;
+		}
 	}
 
 	mutex_unlock(&vm->lock);
@@ -141,8 +171,6 @@ int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create)
 	return 0;
 
 err_out2:
-	if (offset)
-		lima_vm_unmap_range(vm, bo_va->node.start, bo_va->node.start + offset - 1);
 	drm_mm_remove_node(&bo_va->node);
 err_out1:
 	mutex_unlock(&vm->lock);
@@ -182,6 +210,25 @@ void lima_vm_bo_del(struct lima_vm *vm, struct lima_bo *bo)
 	kfree(bo_va);
 }
 
+/* caller must hold bo->lock, used before the BO pages are purged */
+void lima_vm_bo_unmap_all(struct lima_bo *bo)
+{
+	struct lima_bo_va *bo_va;
+
+	list_for_each_entry(bo_va, &bo->va, list) {
+		mutex_lock(&bo_va->vm->lock);
+		lima_vm_unmap_range(bo_va->vm, bo_va->node.start,
+				    bo_va->node.start + bo_va->node.size - 1);
+		mutex_unlock(&bo_va->vm->lock);
+	}
+}
+
+/* caller must hold bo->lock */
+bool lima_vm_bo_is_private(struct lima_vm *vm, struct lima_bo *bo)
+{
+	return list_is_singular(&bo->va) && lima_vm_bo_find(vm, bo);
+}
+
 u32 lima_vm_get_va(struct lima_vm *vm, struct lima_bo *bo)
 {
 	struct lima_bo_va *bo_va;
@@ -280,44 +327,27 @@ void lima_vm_print(struct lima_vm *vm)
 	}
 }
 
-int lima_vm_map_bo(struct lima_vm *vm, struct lima_bo *bo, int pageoff)
+int lima_vm_map_bo(struct lima_vm *vm, struct lima_bo *bo,
+		   struct sg_table *sgt, int pageoff)
 {
 	struct lima_bo_va *bo_va;
-	struct sg_dma_page_iter sg_iter;
-	int offset = 0, err;
-	u32 base;
+	int err;
 
 	mutex_lock(&bo->lock);
 
 	bo_va = lima_vm_bo_find(vm, bo);
 	if (!bo_va) {
 		err = -ENOENT;
-		goto err_out0;
+		goto out;
 	}
 
 	mutex_lock(&vm->lock);
 
-	base = bo_va->node.start + (pageoff << PAGE_SHIFT);
-	for_each_sg_dma_page(bo->base.sgt->sgl, &sg_iter,
-			     bo->base.sgt->nents, pageoff) {
-		err = lima_vm_map_page(vm, sg_page_iter_dma_address(&sg_iter),
-				       base + offset);
-		if (err)
-			goto err_out1;
-
-		offset += PAGE_SIZE;
-	}
-
-	mutex_unlock(&vm->lock);
-
-	mutex_unlock(&bo->lock);
-	return 0;
+	err = lima_vm_map_sgt(vm, sgt,
+			      bo_va->node.start + (pageoff << PAGE_SHIFT));
 
-err_out1:
-	if (offset)
-		lima_vm_unmap_range(vm, base, base + offset - 1);
 	mutex_unlock(&vm->lock);
-err_out0:
+out:
 	mutex_unlock(&bo->lock);
 	return err;
 }
@@ -7,6 +7,8 @@
 #include <drm/drm_mm.h>
 #include <linux/kref.h>
 
+#include "lima_device.h"
+
 #define LIMA_PAGE_SIZE    4096
 #define LIMA_PAGE_MASK    (LIMA_PAGE_SIZE - 1)
 #define LIMA_PAGE_ENT_NUM (LIMA_PAGE_SIZE / sizeof(u32))
@@ -20,6 +22,7 @@
 #define LIMA_VA_RESERVE_END    0x100000000ULL
 
 struct lima_device;
+struct sg_table;
 
 struct lima_vm_page {
 	u32 *cpu;
@@ -36,10 +39,18 @@ struct lima_vm {
 
 	struct lima_vm_page pd;
 	struct lima_vm_page bts[LIMA_VM_NUM_BT];
+
+	/* largest heap size a GP task of this VM needed so far */
+	size_t heap_hwm;
+
+	/* GPU time used by the tasks of this client, shown in fdinfo */
+	atomic64_t busy_ns[lima_pipe_num];
 };
 
 int lima_vm_bo_add(struct lima_vm *vm, struct lima_bo *bo, bool create);
 void lima_vm_bo_del(struct lima_vm *vm, struct lima_bo *bo);
+void lima_vm_bo_unmap_all(struct lima_bo *bo);
+bool lima_vm_bo_is_private(struct lima_vm *vm, struct lima_bo *bo);
 
 u32 lima_vm_get_va(struct lima_vm *vm, struct lima_bo *bo);
 
@@ -59,6 +70,7 @@ static inline void lima_vm_put(struct lima_vm *vm)
 }
 
 void lima_vm_print(struct lima_vm *vm);
-int lima_vm_map_bo(struct lima_vm *vm, struct lima_bo *bo, int pageoff);
+int lima_vm_map_bo(struct lima_vm *vm, struct lima_bo *bo,
+		   struct sg_table *sgt, int pageoff);
 
 #endif
@@ -12,6 +12,7 @@
 #include <linux/bitfield.h>
 #include <linux/soc/amlogic/meson-canvas.h>
 
+#include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_device.h>
 #include <drm/drm_print.h>
@@ -19,15 +20,20 @@
 #include <drm/drm_vblank.h>
 
 #include "meson_crtc.h"
+#include "meson_overlay.h"
 #include "meson_plane.h"
 #include "meson_registers.h"
+#include "meson_vclk.h"
 #include "meson_venc.h"
 #include "meson_viu.h"
 #include "meson_rdma.h"
 #include "meson_vpp.h"
 #include "meson_osd_afbcd.h"
 
-#define MESON_G12A_VIU_OFFSET	0x5ec0
+#define CREATE_TRACE_POINTS
+#include "meson_trace.h"
+
+#define MESON_G12A_VIU_OFFSET	0x17b0
 
 /* CRTC definition */
 
@@ -36,12 +42,15 @@ struct meson_crtc {
 	struct drm_pending_vblank_event *event;
 	struct meson_drm *priv;
 	void (*enable_osd1)(struct meson_drm *priv);
+	void (*enable_osd2)(struct meson_drm *priv);
+	void (*commit_osd_blend)(struct meson_drm *priv);
 	void (*enable_vd1)(struct meson_drm *priv);
 	void (*enable_osd1_afbc)(struct meson_drm *priv);
 	void (*disable_osd1_afbc)(struct meson_drm *priv);
 	unsigned int viu_offset;
 	bool vsync_forced;
 	bool vsync_disabled;
+	bool rdma_pending;
 };
 #define to_meson_crtc(x) container_of(x, struct meson_crtc, base)
 
@@ -158,9 +167,23 @@ static void meson_g12a_crtc_atomic_disable(struct drm_crtc *crtc,
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 
+	priv->viu.osd2_enabled = false;
+	priv->viu.osd2_commit = false;
+	priv->viu.osd_blend_commit = false;
+
 	priv->viu.vd1_enabled = false;
 	priv->viu.vd1_commit = false;
 
+	priv->viu.vd2_enabled = false;
+	priv->viu.vd2_commit = false;
+
+	meson_rdma_stop(priv);
+	meson_crtc->rdma_pending = false;
+
+	spin_lock_irq(&crtc->dev->event_lock);
+	meson_overlay_flip_cancel(priv);
+	spin_unlock_irq(&crtc->dev->event_lock);
+
 	if (crtc->state->event && !crtc->state->active) {
 		spin_lock_irq(&crtc->dev->event_lock);
 		drm_crtc_send_vblank_event(crtc, crtc->state->event);
@@ -183,12 +206,27 @@ static void meson_crtc_atomic_disable(struct drm_crtc *crtc,
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 
+	priv->viu.osd2_enabled = false;
+	priv->viu.osd2_commit = false;
+	priv->viu.osd_blend_commit = false;
+
 	priv->viu.vd1_enabled = false;
 	priv->viu.vd1_commit = false;
 
+	priv->viu.vd2_enabled = false;
+	priv->viu.vd2_commit = false;
+
+	meson_rdma_stop(priv);
+	meson_crtc->rdma_pending = false;
+
+	spin_lock_irq(&crtc->dev->event_lock);
+	meson_overlay_flip_cancel(priv);
+	spin_unlock_irq(&crtc->dev->event_lock);
+
 	/* Disable VPP Postblend */
-	writel_bits_relaxed(VPP_OSD1_POSTBLEND | VPP_VD1_POSTBLEND |
-			    VPP_VD1_PREBLEND | VPP_POSTBLEND_ENABLE, 0,
+	writel_bits_relaxed(VPP_OSD1_POSTBLEND | VPP_OSD2_POSTBLEND |
+			    VPP_VD1_POSTBLEND | VPP_VD1_PREBLEND |
+			    VPP_VD2_POSTBLEND | VPP_POSTBLEND_ENABLE, 0,
 			    priv->io_base + _REG(VPP_MISC));
 
 	if (crtc->state->event && !crtc->state->active) {
@@ -200,470 +238,616 @@ static void meson_crtc_atomic_disable(struct drm_crtc *crtc,
 	}
 }
 
-static void meson_crtc_atomic_begin(struct drm_crtc *crtc,
-				    struct drm_crtc_state *state)
+static void meson_crtc_enable_osd1(struct meson_drm *priv)
 {
-	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
-	unsigned long flags;
+	meson_rdma_writel_bits(priv, VPP_OSD1_POSTBLEND, VPP_OSD1_POSTBLEND,
+			       VPP_MISC);
+}
 
-	if (crtc->state->event) {
-		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
+static void meson_crtc_g12a_enable_osd1_afbc(struct meson_drm *priv)
+{
+	meson_rdma_writel(priv, priv->viu.osd1_blk2_cfg4, VIU_OSD1_BLK2_CFG_W4);
 
-		spin_lock_irqsave(&crtc->dev->event_lock, flags);
-		meson_crtc->event = crtc->state->event;
-		spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
-		crtc->state->event = NULL;
-	}
+	meson_rdma_writel_bits(priv, OSD_MEM_LINEAR_ADDR, OSD_MEM_LINEAR_ADDR,
+			       VIU_OSD1_CTRL_STAT);
+
+	meson_rdma_writel(priv, priv->viu.osd1_blk1_cfg4, VIU_OSD1_BLK1_CFG_W4);
+
+	meson_viu_g12a_enable_osd1_afbc(priv);
+
+	meson_rdma_writel_bits(priv, OSD_MEM_LINEAR_ADDR, OSD_MEM_LINEAR_ADDR,
+			       VIU_OSD1_CTRL_STAT);
+
+	meson_rdma_writel_bits(priv, OSD_MALI_SRC_EN, OSD_MALI_SRC_EN,
+			       VIU_OSD1_BLK0_CFG_W0);
 }
 
-static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
-				    struct drm_crtc_state *old_crtc_state)
+static void meson_g12a_crtc_enable_osd1(struct meson_drm *priv)
 {
-	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
-	struct meson_drm *priv = meson_crtc->priv;
+	meson_rdma_writel_bits(priv, 3 << 8, 3 << 8, OSD1_BLEND_SRC_CTRL);
+}
 
-	priv->viu.osd1_commit = true;
-	priv->viu.vd1_commit = true;
+static void meson_crtc_enable_osd2(struct meson_drm *priv)
+{
+	meson_rdma_writel_bits(priv, VPP_OSD2_POSTBLEND, VPP_OSD2_POSTBLEND,
+			       VPP_MISC);
 }
 
-static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
-	.atomic_begin	= meson_crtc_atomic_begin,
-	.atomic_flush	= meson_crtc_atomic_flush,
-	.atomic_enable	= meson_crtc_atomic_enable,
-	.atomic_disable	= meson_crtc_atomic_disable,
-};
+static void meson_g12a_crtc_enable_osd2(struct meson_drm *priv)
+{
+	/* OSD2 is mixed by the OSD blender, output on the OSD1 path */
+	meson_rdma_writel_bits(priv, 3 << 8, 3 << 8, OSD1_BLEND_SRC_CTRL);
+}
 
-static const struct drm_crtc_helper_funcs meson_g12a_crtc_helper_funcs = {
-	.atomic_begin	= meson_crtc_atomic_begin,
-	.atomic_flush	= meson_crtc_atomic_flush,
-	.atomic_enable	= meson_g12a_crtc_atomic_enable,
-	.atomic_disable	= meson_g12a_crtc_atomic_disable,
-};
+static void meson_crtc_commit_osd_blend(struct meson_drm *priv)
+{
+	u32 misc = 0;
 
-static void meson_crtc_enable_osd1(struct meson_drm *priv)
+	/* The Postblend foreground is either OSD1 or OSD2 */
+	if (priv->viu.osd2_on_top)
+		misc |= VPP_POST_FG_OSD2;
+	if (priv->viu.osd2_premult)
+		misc |= VPP_OSD2_ALPHA_PREMULT;
+
+	meson_rdma_writel_bits(priv, VPP_POST_FG_OSD2 | VPP_OSD2_ALPHA_PREMULT,
+			       misc, VPP_MISC);
+}
+
+static void meson_g12a_crtc_commit_osd_blend(struct meson_drm *priv)
 {
-	writel_bits_relaxed(VPP_OSD1_POSTBLEND, VPP_OSD1_POSTBLEND,
-			    priv->io_base + _REG(VPP_MISC));
+	struct drm_display_mode *mode = &priv->crtc->state->mode;
+	bool osd2_on_top = !priv->viu.osd2_enabled || priv->viu.osd2_on_top;
+	u32 bottom_h, bottom_v, top_h, top_v;
+	u32 ctrl, din_en = 0, premult = BIT(0);
+	u32 blend0_size, blend1_size;
+
+	/*
+	 * DIN0 is bypassed to the bottom layer of Blend2 and DIN3 to its
+	 * top layer, the sources being 1 for OSD1 and 2 for OSD2.
+	 */
+	if (osd2_on_top) {
+		ctrl = VIU_OSD_BLEND_REORDER(0, 1) |
+		       VIU_OSD_BLEND_REORDER(3, 2);
+		if (priv->viu.osd1_enabled)
+			din_en |= BIT(0);
+		if (priv->viu.osd2_enabled)
+			din_en |= BIT(3);
+		if (priv->viu.osd2_premult)
+			premult |= BIT(1);
+		bottom_h = priv->viu.osd_blend_din0_scope_h;
+		bottom_v = priv->viu.osd_blend_din0_scope_v;
+		top_h = priv->viu.osd2_blend_scope_h;
+		top_v = priv->viu.osd2_blend_scope_v;
+	} else {
+		ctrl = VIU_OSD_BLEND_REORDER(0, 2) |
+		       VIU_OSD_BLEND_REORDER(3, 1);
+		if (priv->viu.osd2_enabled)
+			din_en |= BIT(0);
+		if (priv->viu.osd1_enabled)
+			din_en |= BIT(3);
+		bottom_h = priv->viu.osd2_blend_scope_h;
+		bottom_v = priv->viu.osd2_blend_scope_v;
+		top_h = priv->viu.osd_blend_din0_scope_h;
+		top_v = priv->viu.osd_blend_din0_scope_v;
+	}
+
+	/* With both OSDs, the blenders cover the whole screen */
+	if (priv->viu.osd2_enabled) {
+		blend0_size = mode->vdisplay << 16 | mode->hdisplay;
+		blend1_size = blend0_size;
+	} else {
+		blend0_size = priv->viu.osb_blend0_size;
+		blend1_size = priv->viu.osb_blend1_size;
+	}
+
+	meson_rdma_writel(priv, ctrl | VIU_OSD_BLEND_DIN_EN(din_en) |
+			  VIU_OSD_BLEND1_DIN3_BYPASS_TO_DOUT1 |
+			  VIU_OSD_BLEND1_DOUT_BYPASS_TO_BLEND2 |
+			  VIU_OSD_BLEND_DIN0_BYPASS_TO_DOUT0 |
+			  VIU_OSD_BLEND_BLEN2_PREMULT_EN(premult) |
+			  VIU_OSD_BLEND_HOLD_LINES(4),
+			  VIU_OSD_BLEND_CTRL);
+	meson_rdma_writel(priv, bottom_h, VIU_OSD_BLEND_DIN0_SCOPE_H);
+	meson_rdma_writel(priv, bottom_v, VIU_OSD_BLEND_DIN0_SCOPE_V);
+	meson_rdma_writel(priv, top_h, VIU_OSD_BLEND_DIN3_SCOPE_H);
+	meson_rdma_writel(priv, top_v, VIU_OSD_BLEND_DIN3_SCOPE_V);
+	meson_rdma_writel(priv, blend0_size, VIU_OSD_BLEND_BLEND0_SIZE);
+	meson_rdma_writel(priv, blend1_size, VIU_OSD_BLEND_BLEND1_SIZE);
 }
 
-static void meson_crtc_g12a_enable_osd1_afbc(struct meson_drm *priv)
+static void meson_crtc_enable_vd1(struct meson_drm *priv)
 {
-	writel_relaxed(priv->viu.osd1_blk2_cfg4,
-		       priv->io_base + _REG(VIU_OSD1_BLK2_CFG_W4));
+	meson_rdma_writel_bits(priv, VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
+			       VPP_COLOR_MNG_ENABLE,
+			       VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
+			       VPP_COLOR_MNG_ENABLE,
+			       VPP_MISC);
+
+	meson_rdma_writel_bits(priv, VIU_CTRL0_AFBC_TO_VD1,
+			       priv->viu.vd1_afbc ? VIU_CTRL0_AFBC_TO_VD1 : 0,
+			       VIU_MISC_CTRL0);
+}
 
-	writel_bits_relaxed(OSD_MEM_LINEAR_ADDR, OSD_MEM_LINEAR_ADDR,
-			    priv->io_base + _REG(VIU_OSD1_CTRL_STAT));
+static void meson_g12a_crtc_enable_vd1(struct meson_drm *priv)
+{
+	meson_rdma_writel(priv, VD_BLEND_PREBLD_SRC_VD1 |
+			  VD_BLEND_PREBLD_PREMULT_EN |
+			  VD_BLEND_POSTBLD_SRC_VD1 |
+			  VD_BLEND_POSTBLD_PREMULT_EN,
+			  VD1_BLEND_SRC_CTRL);
+
+	meson_rdma_writel(priv, priv->viu.vd1_afbc ?
+			  (VD1_AXI_SEL_AFBC | AFBC_VD1_SEL) : 0,
+			  VD1_AFBCD0_MISC_CTRL);
+}
 
-	writel_relaxed(priv->viu.osd1_blk1_cfg4,
-		       priv->io_base + _REG(VIU_OSD1_BLK1_CFG_W4));
+/* Record the OSD1 registers for the RDMA to replay them on VSYNC */
+static void meson_crtc_commit_osd1(struct meson_crtc *meson_crtc)
+{
+	struct meson_drm *priv = meson_crtc->priv;
 
-	meson_viu_g12a_enable_osd1_afbc(priv);
+	meson_rdma_writel(priv, priv->viu.osd1_ctrl_stat, VIU_OSD1_CTRL_STAT);
+	meson_rdma_writel(priv, priv->viu.osd1_ctrl_stat2, VIU_OSD1_CTRL_STAT2);
+	meson_rdma_writel(priv, priv->viu.osd1_blk0_cfg[0],
+			  VIU_OSD1_BLK0_CFG_W0);
+	meson_rdma_writel(priv, priv->viu.osd1_blk0_cfg[1],
+			  VIU_OSD1_BLK0_CFG_W1);
+	meson_rdma_writel(priv, priv->viu.osd1_blk0_cfg[2],
+			  VIU_OSD1_BLK0_CFG_W2);
+	meson_rdma_writel(priv, priv->viu.osd1_blk0_cfg[3],
+			  VIU_OSD1_BLK0_CFG_W3);
+	meson_rdma_writel(priv, priv->viu.osd1_blk0_cfg[4],
+			  VIU_OSD1_BLK0_CFG_W4);
+
+	if (priv->viu.osd1_afbcd) {
+		if (meson_crtc->enable_osd1_afbc)
+			meson_crtc->enable_osd1_afbc(priv);
+	} else {
+		if (meson_crtc->disable_osd1_afbc)
+			meson_crtc->disable_osd1_afbc(priv);
+		if (priv->afbcd.ops) {
+			priv->afbcd.ops->reset(priv);
+			priv->afbcd.ops->disable(priv);
+		}
+		meson_crtc->vsync_forced = false;
+	}
 
-	writel_bits_relaxed(OSD_MEM_LINEAR_ADDR, OSD_MEM_LINEAR_ADDR,
-			    priv->io_base + _REG(VIU_OSD1_CTRL_STAT));
+	meson_vpp_setup_osd_scaling_filter(priv);
+	meson_rdma_writel(priv, priv->viu.osd_sc_ctrl0, VPP_OSD_SC_CTRL0);
+	meson_rdma_writel(priv, priv->viu.osd_sc_i_wh_m1, VPP_OSD_SCI_WH_M1);
+	meson_rdma_writel(priv, priv->viu.osd_sc_o_h_start_end,
+			  VPP_OSD_SCO_H_START_END);
+	meson_rdma_writel(priv, priv->viu.osd_sc_o_v_start_end,
+			  VPP_OSD_SCO_V_START_END);
+	meson_rdma_writel(priv, priv->viu.osd_sc_v_ini_phase,
+			  VPP_OSD_VSC_INI_PHASE);
+	meson_rdma_writel(priv, priv->viu.osd_sc_v_phase_step,
+			  VPP_OSD_VSC_PHASE_STEP);
+	meson_rdma_writel(priv, priv->viu.osd_sc_h_ini_phase,
+			  VPP_OSD_HSC_INI_PHASE);
+	meson_rdma_writel(priv, priv->viu.osd_sc_h_phase_step,
+			  VPP_OSD_HSC_PHASE_STEP);
+	meson_rdma_writel(priv, priv->viu.osd_sc_h_ctrl0, VPP_OSD_HSC_CTRL0);
+	meson_rdma_writel(priv, priv->viu.osd_sc_v_ctrl0, VPP_OSD_VSC_CTRL0);
+
+	if (!priv->viu.osd1_afbcd)
+		meson_canvas_config(priv->canvas, priv->canvas_id_osd1,
+				    priv->viu.osd1_addr,
+				    priv->viu.osd1_stride,
+				    priv->viu.osd1_height,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR, 0);
+
+	/* Enable OSD1 */
+	if (meson_crtc->enable_osd1)
+		meson_crtc->enable_osd1(priv);
+
+	if (priv->viu.osd1_afbcd) {
+		priv->afbcd.ops->reset(priv);
+		priv->afbcd.ops->setup(priv);
+		priv->afbcd.ops->enable(priv);
+		meson_crtc->vsync_forced = true;
+	}
 
-	writel_bits_relaxed(OSD_MALI_SRC_EN, OSD_MALI_SRC_EN,
-			    priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W0));
+	priv->viu.osd1_commit = false;
 }
 
-static void meson_g12a_crtc_enable_osd1(struct meson_drm *priv)
+/* Record the OSD2 registers for the RDMA to replay them on VSYNC */
+static void meson_crtc_commit_osd2(struct meson_crtc *meson_crtc)
 {
-	writel_relaxed(priv->viu.osd_blend_din0_scope_h,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_DIN0_SCOPE_H));
-	writel_relaxed(priv->viu.osd_blend_din0_scope_v,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_DIN0_SCOPE_V));
-	writel_relaxed(priv->viu.osb_blend0_size,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_BLEND0_SIZE));
-	writel_relaxed(priv->viu.osb_blend1_size,
-		       priv->io_base +
-		       _REG(VIU_OSD_BLEND_BLEND1_SIZE));
-	writel_bits_relaxed(3 << 8, 3 << 8,
-			    priv->io_base + _REG(OSD1_BLEND_SRC_CTRL));
+	struct meson_drm *priv = meson_crtc->priv;
+
+	meson_rdma_writel(priv, priv->viu.osd2_ctrl_stat, VIU_OSD2_CTRL_STAT);
+	meson_rdma_writel(priv, priv->viu.osd2_ctrl_stat2, VIU_OSD2_CTRL_STAT2);
+	meson_rdma_writel(priv, priv->viu.osd2_blk0_cfg[0],
+			  VIU_OSD2_BLK0_CFG_W0);
+	meson_rdma_writel(priv, priv->viu.osd2_blk0_cfg[1],
+			  VIU_OSD2_BLK0_CFG_W1);
+	meson_rdma_writel(priv, priv->viu.osd2_blk0_cfg[2],
+			  VIU_OSD2_BLK0_CFG_W2);
+	meson_rdma_writel(priv, priv->viu.osd2_blk0_cfg[3],
+			  VIU_OSD2_BLK0_CFG_W3);
+	meson_rdma_writel(priv, priv->viu.osd2_blk0_cfg[4],
+			  VIU_OSD2_BLK0_CFG_W4);
+
+	meson_canvas_config(priv->canvas, priv->canvas_id_osd2,
+			    priv->viu.osd2_addr,
+			    priv->viu.osd2_stride,
+			    priv->viu.osd2_height,
+			    MESON_CANVAS_WRAP_NONE,
+			    MESON_CANVAS_BLKMODE_LINEAR, 0);
+
+	/* Enable OSD2 */
+	if (meson_crtc->enable_osd2)
+		meson_crtc->enable_osd2(priv);
+
+	priv->viu.osd2_commit = false;
 }
 
-static void meson_crtc_enable_vd1(struct meson_drm *priv)
+/* Record the VD1 registers for the RDMA to replay them on VSYNC */
+static void meson_crtc_commit_vd1(struct meson_crtc *meson_crtc)
 {
-	writel_bits_relaxed(VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
-			    VPP_COLOR_MNG_ENABLE,
-			    VPP_VD1_PREBLEND | VPP_VD1_POSTBLEND |
-			    VPP_COLOR_MNG_ENABLE,
-			    priv->io_base + _REG(VPP_MISC));
+	struct meson_drm *priv = meson_crtc->priv;
+	u32 viu_offset = meson_crtc->viu_offset;
+
+	if (priv->viu.vd1_afbc) {
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_head_addr,
+				  AFBC_HEAD_BADDR);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_body_addr,
+				  AFBC_BODY_BADDR);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_en, AFBC_ENABLE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_mode, AFBC_MODE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_size_in,
+				  AFBC_SIZE_IN);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_dec_def_color,
+				  AFBC_DEC_DEF_COLOR);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_conv_ctrl,
+				  AFBC_CONV_CTRL);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_size_out,
+				  AFBC_SIZE_OUT);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_vd_cfmt_ctrl,
+				  AFBC_VD_CFMT_CTRL);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_vd_cfmt_w,
+				  AFBC_VD_CFMT_W);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_mif_hor_scope,
+				  AFBC_MIF_HOR_SCOPE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_mif_ver_scope,
+				  AFBC_MIF_VER_SCOPE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_pixel_hor_scope,
+				  AFBC_PIXEL_HOR_SCOPE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_pixel_ver_scope,
+				  AFBC_PIXEL_VER_SCOPE);
+		meson_rdma_writel(priv, priv->viu.vd1_afbc_vd_cfmt_h,
+				  AFBC_VD_CFMT_H);
+	} else {
+		switch (priv->viu.vd1_planes) {
+		case 3:
+			meson_canvas_config(priv->canvas,
+					    priv->canvas_id_vd1_2,
+					    priv->viu.vd1_addr2,
+					    priv->viu.vd1_stride2,
+					    priv->viu.vd1_height2,
+					    MESON_CANVAS_WRAP_NONE,
+					    MESON_CANVAS_BLKMODE_LINEAR,
+					    MESON_CANVAS_ENDIAN_SWAP64);
+		/* fallthrough */
+		case 2:
+			meson_canvas_config(priv->canvas,
+					    priv->canvas_id_vd1_1,
+					    priv->viu.vd1_addr1,
+					    priv->viu.vd1_stride1,
+					    priv->viu.vd1_height1,
+					    MESON_CANVAS_WRAP_NONE,
+					    MESON_CANVAS_BLKMODE_LINEAR,
+					    MESON_CANVAS_ENDIAN_SWAP64);
+		/* fallthrough */
+		case 1:
+			meson_canvas_config(priv->canvas,
+					    priv->canvas_id_vd1_0,
+					    priv->viu.vd1_addr0,
+					    priv->viu.vd1_stride0,
+					    priv->viu.vd1_height0,
+					    MESON_CANVAS_WRAP_NONE,
+					    MESON_CANVAS_BLKMODE_LINEAR,
+					    MESON_CANVAS_ENDIAN_SWAP64);
+		}
+
+		meson_rdma_writel(priv, 0, AFBC_ENABLE);
+	}
+
+	meson_rdma_writel(priv, priv->viu.vd1_if0_gen_reg,
+			  VD1_IF0_GEN_REG + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_gen_reg2,
+			  VD1_IF0_GEN_REG2 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.viu_vd1_fmt_ctrl,
+			  VIU_VD1_FMT_CTRL + viu_offset);
+	meson_rdma_writel(priv, priv->viu.viu_vd1_fmt_w,
+			  VIU_VD1_FMT_W + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_canvas0,
+			  VD1_IF0_CANVAS0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_canvas0,
+			  VD1_IF0_CANVAS1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma_x0,
+			  VD1_IF0_LUMA_X0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma_x0,
+			  VD1_IF0_LUMA_X1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma_y0,
+			  VD1_IF0_LUMA_Y0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma_y0,
+			  VD1_IF0_LUMA_Y1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma_x0,
+			  VD1_IF0_CHROMA_X0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma_x0,
+			  VD1_IF0_CHROMA_X1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma_y0,
+			  VD1_IF0_CHROMA_Y0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma_y0,
+			  VD1_IF0_CHROMA_Y1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_repeat_loop,
+			  VD1_IF0_RPT_LOOP + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma0_rpt_pat,
+			  VD1_IF0_LUMA0_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_luma0_rpt_pat,
+			  VD1_IF0_LUMA1_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma0_rpt_pat,
+			  VD1_IF0_CHROMA0_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_if0_chroma0_rpt_pat,
+			  VD1_IF0_CHROMA1_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, 0, VD1_IF0_LUMA_PSEL + viu_offset);
+	meson_rdma_writel(priv, 0, VD1_IF0_CHROMA_PSEL + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_range_map_y,
+			  VD1_IF0_RANGE_MAP_Y + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_range_map_cb,
+			  VD1_IF0_RANGE_MAP_CB + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd1_range_map_cr,
+			  VD1_IF0_RANGE_MAP_CR + viu_offset);
+	meson_rdma_writel(priv, VPP_VSC_BANK_LENGTH(4) |
+			  VPP_HSC_BANK_LENGTH(4) |
+			  VPP_SC_VD_EN_ENABLE |
+			  VPP_SC_TOP_EN_ENABLE |
+			  VPP_SC_HSC_EN_ENABLE |
+			  VPP_SC_VSC_EN_ENABLE,
+			  VPP_SC_MISC);
+	meson_rdma_writel(priv, priv->viu.vpp_pic_in_height, VPP_PIC_IN_HEIGHT);
+	meson_rdma_writel(priv, priv->viu.vpp_postblend_vd1_h_start_end,
+			  VPP_POSTBLEND_VD1_H_START_END);
+	meson_rdma_writel(priv, priv->viu.vpp_postblend_vd1_v_start_end,
+			  VPP_POSTBLEND_VD1_V_START_END);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_region12_startp,
+			  VPP_HSC_REGION12_STARTP);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_region34_startp,
+			  VPP_HSC_REGION34_STARTP);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_region4_endp,
+			  VPP_HSC_REGION4_ENDP);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_start_phase_step,
+			  VPP_HSC_START_PHASE_STEP);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_region1_phase_slope,
+			  VPP_HSC_REGION1_PHASE_SLOPE);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_region3_phase_slope,
+			  VPP_HSC_REGION3_PHASE_SLOPE);
+	meson_rdma_writel(priv, priv->viu.vpp_line_in_length,
+			  VPP_LINE_IN_LENGTH);
+	meson_rdma_writel(priv, priv->viu.vpp_preblend_h_size,
+			  VPP_PREBLEND_H_SIZE);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_region12_startp,
+			  VPP_VSC_REGION12_STARTP);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_region34_startp,
+			  VPP_VSC_REGION34_STARTP);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_region4_endp,
+			  VPP_VSC_REGION4_ENDP);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_start_phase_step,
+			  VPP_VSC_START_PHASE_STEP);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_ini_phase, VPP_VSC_INI_PHASE);
+	meson_rdma_writel(priv, priv->viu.vpp_vsc_phase_ctrl,
+			  VPP_VSC_PHASE_CTRL);
+	meson_rdma_writel(priv, priv->viu.vpp_hsc_phase_ctrl,
+			  VPP_HSC_PHASE_CTRL);
+	meson_rdma_writel(priv, 0x42, VPP_SCALE_COEF_IDX);
+
+	meson_vpp_setup_vd_matrix(priv, 1, priv->viu.vd1_color_encoding,
+				  priv->viu.vd1_color_range);
+
+	/* Enable VD1 */
+	if (meson_crtc->enable_vd1)
+		meson_crtc->enable_vd1(priv);
 
-	writel_bits_relaxed(VIU_CTRL0_AFBC_TO_VD1,
-			    priv->viu.vd1_afbc ? VIU_CTRL0_AFBC_TO_VD1 : 0,
-			    priv->io_base + _REG(VIU_MISC_CTRL0));
+	priv->viu.vd1_commit = false;
 }
 
-static void meson_g12a_crtc_enable_vd1(struct meson_drm *priv)
+/* Record the VD2 registers for the RDMA to replay them on VSYNC */
+static void meson_crtc_commit_vd2(struct meson_crtc *meson_crtc)
 {
-	writel_relaxed(VD_BLEND_PREBLD_SRC_VD1 |
-		       VD_BLEND_PREBLD_PREMULT_EN |
-		       VD_BLEND_POSTBLD_SRC_VD1 |
-		       VD_BLEND_POSTBLD_PREMULT_EN,
-		       priv->io_base + _REG(VD1_BLEND_SRC_CTRL));
-
-	writel_relaxed(priv->viu.vd1_afbc ?
-		       (VD1_AXI_SEL_AFBC | AFBC_VD1_SEL) : 0,
-		       priv->io_base + _REG(VD1_AFBCD0_MISC_CTRL));
+	struct meson_drm *priv = meson_crtc->priv;
+	u32 viu_offset = meson_crtc->viu_offset;
+
+	switch (priv->viu.vd2_planes) {
+	case 2:
+		meson_canvas_config(priv->canvas,
+				    priv->canvas_id_vd2_1,
+				    priv->viu.vd2_addr1,
+				    priv->viu.vd2_stride1,
+				    priv->viu.vd2_height1,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	/* fallthrough */
+	case 1:
+		meson_canvas_config(priv->canvas,
+				    priv->canvas_id_vd2_0,
+				    priv->viu.vd2_addr0,
+				    priv->viu.vd2_stride0,
+				    priv->viu.vd2_height0,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	}
+
+	meson_rdma_writel(priv, priv->viu.vd2_if0_gen_reg,
+			  VD2_IF0_GEN_REG + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_gen_reg2,
+			  VD2_IF0_GEN_REG2 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.viu_vd2_fmt_ctrl,
+			  VIU_VD2_FMT_CTRL + viu_offset);
+	meson_rdma_writel(priv, priv->viu.viu_vd2_fmt_w,
+			  VIU_VD2_FMT_W + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_canvas0,
+			  VD2_IF0_CANVAS0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_canvas0,
+			  VD2_IF0_CANVAS1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_luma_x0,
+			  VD2_IF0_LUMA_X0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_luma_x0,
+			  VD2_IF0_LUMA_X1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_luma_y0,
+			  VD2_IF0_LUMA_Y0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_luma_y0,
+			  VD2_IF0_LUMA_Y1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_chroma_x0,
+			  VD2_IF0_CHROMA_X0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_chroma_x0,
+			  VD2_IF0_CHROMA_X1 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_chroma_y0,
+			  VD2_IF0_CHROMA_Y0 + viu_offset);
+	meson_rdma_writel(priv, priv->viu.vd2_if0_chroma_y0,
+			  VD2_IF0_CHROMA_Y1 + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_RPT_LOOP + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_LUMA0_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_LUMA1_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_CHROMA0_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_CHROMA1_RPT_PAT + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_LUMA_PSEL + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_CHROMA_PSEL + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_RANGE_MAP_Y + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_RANGE_MAP_CB + viu_offset);
+	meson_rdma_writel(priv, 0, VD2_IF0_RANGE_MAP_CR + viu_offset);
+
+	meson_vpp_setup_vd_matrix(priv, 2, priv->viu.vd2_color_encoding,
+				  priv->viu.vd2_color_range);
+
+	/* Enable VD2 at its position in the postblend */
+	meson_vpp_enable_vd2(priv);
+
+	priv->viu.vd2_commit = false;
 }
 
-void meson_crtc_irq(struct meson_drm *priv)
+static void meson_crtc_atomic_begin(struct drm_crtc *crtc,
+				    struct drm_crtc_state *state)
 {
-	struct meson_crtc *meson_crtc = to_meson_crtc(priv->crtc);
+	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
+
+	/* Plane updates are recorded until the flush */
+	meson_rdma_begin(meson_crtc->priv);
+}
+
+static void meson_crtc_atomic_flush(struct drm_crtc *crtc,
+				    struct drm_crtc_state *old_crtc_state)
+{
+	struct meson_crtc *meson_crtc = to_meson_crtc(crtc);
+	struct meson_drm *priv = meson_crtc->priv;
 	unsigned long flags;
 
-	/* Update the OSD registers */
-	if (priv->viu.osd1_enabled && priv->viu.osd1_commit) {
-		writel_relaxed(priv->viu.osd1_ctrl_stat,
-				priv->io_base + _REG(VIU_OSD1_CTRL_STAT));
-		writel_relaxed(priv->viu.osd1_ctrl_stat2,
-				priv->io_base + _REG(VIU_OSD1_CTRL_STAT2));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[0],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W0));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[1],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W1));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[2],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W2));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[3],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W3));
-		writel_relaxed(priv->viu.osd1_blk0_cfg[4],
-				priv->io_base + _REG(VIU_OSD1_BLK0_CFG_W4));
-
-		if (priv->viu.osd1_afbcd) {
-			if (meson_crtc->enable_osd1_afbc)
-				meson_crtc->enable_osd1_afbc(priv);
-		} else {
-			if (meson_crtc->disable_osd1_afbc)
-				meson_crtc->disable_osd1_afbc(priv);
-			if (priv->afbcd.ops) {
-				priv->afbcd.ops->reset(priv);
-				priv->afbcd.ops->disable(priv);
-			}
-			meson_crtc->vsync_forced = false;
-		}
+	/*
+	 * A 1000/1001 refresh rate switch accepted by the HDMI encoder,
+	 * the timings are unchanged so only the pixel clock is retuned.
+	 */
+	if (crtc->state->active && old_crtc_state->active &&
+	    !drm_atomic_crtc_needs_modeset(crtc->state) &&
+	    crtc->state->mode.clock != old_crtc_state->mode.clock)
+		meson_vclk_vic_retune(priv, crtc->state->mode.clock <
+					    old_crtc_state->mode.clock);
+
+	if (priv->viu.osd1_enabled && priv->viu.osd1_commit)
+		meson_crtc_commit_osd1(meson_crtc);
+
+	if (priv->viu.osd2_enabled && priv->viu.osd2_commit)
+		meson_crtc_commit_osd2(meson_crtc);
+
+	/* Stacking, alpha and sizes of the OSD blending */
+	if (priv->viu.osd_blend_commit) {
+		if (meson_crtc->commit_osd_blend)
+			meson_crtc->commit_osd_blend(priv);
+		priv->viu.osd_blend_commit = false;
+	}
 
-		writel_relaxed(priv->viu.osd_sc_ctrl0,
-				priv->io_base + _REG(VPP_OSD_SC_CTRL0));
-		writel_relaxed(priv->viu.osd_sc_i_wh_m1,
-				priv->io_base + _REG(VPP_OSD_SCI_WH_M1));
-		writel_relaxed(priv->viu.osd_sc_o_h_start_end,
-				priv->io_base + _REG(VPP_OSD_SCO_H_START_END));
-		writel_relaxed(priv->viu.osd_sc_o_v_start_end,
-				priv->io_base + _REG(VPP_OSD_SCO_V_START_END));
-		writel_relaxed(priv->viu.osd_sc_v_ini_phase,
-				priv->io_base + _REG(VPP_OSD_VSC_INI_PHASE));
-		writel_relaxed(priv->viu.osd_sc_v_phase_step,
-				priv->io_base + _REG(VPP_OSD_VSC_PHASE_STEP));
-		writel_relaxed(priv->viu.osd_sc_h_ini_phase,
-				priv->io_base + _REG(VPP_OSD_HSC_INI_PHASE));
-		writel_relaxed(priv->viu.osd_sc_h_phase_step,
-				priv->io_base + _REG(VPP_OSD_HSC_PHASE_STEP));
-		writel_relaxed(priv->viu.osd_sc_h_ctrl0,
-				priv->io_base + _REG(VPP_OSD_HSC_CTRL0));
-		writel_relaxed(priv->viu.osd_sc_v_ctrl0,
-				priv->io_base + _REG(VPP_OSD_VSC_CTRL0));
-
-		if (!priv->viu.osd1_afbcd)
-			meson_canvas_config(priv->canvas, priv->canvas_id_osd1,
-					    priv->viu.osd1_addr,
-					    priv->viu.osd1_stride,
-					    priv->viu.osd1_height,
-					    MESON_CANVAS_WRAP_NONE,
-					    MESON_CANVAS_BLKMODE_LINEAR, 0);
+	if (priv->viu.vd1_enabled && priv->viu.vd1_commit)
+		meson_crtc_commit_vd1(meson_crtc);
 
-		/* Enable OSD1 */
-		if (meson_crtc->enable_osd1)
-			meson_crtc->enable_osd1(priv);
+	if (priv->viu.vd2_enabled && priv->viu.vd2_commit)
+		meson_crtc_commit_vd2(meson_crtc);
 
-		if (priv->viu.osd1_afbcd) {
-			priv->afbcd.ops->reset(priv);
-			priv->afbcd.ops->setup(priv);
-			priv->afbcd.ops->enable(priv);
-			meson_crtc->vsync_forced = true;
-		}
+	if (crtc->state->event)
+		WARN_ON(drm_crtc_vblank_get(crtc) != 0);
 
-		priv->viu.osd1_commit = false;
+	/*
+	 * Arm the RDMA, the recorded registers are applied by the hardware
+	 * on the next VSYNC and the event is only sent once it has run.
+	 * This is done under the event_lock so the vsync IRQ never sees the
+	 * new list completing before it is marked as pending.
+	 */
+	spin_lock_irqsave(&crtc->dev->event_lock, flags);
+	if (meson_rdma_flush(priv))
+		meson_crtc->rdma_pending = true;
+	if (crtc->state->event) {
+		meson_crtc->event = crtc->state->event;
+		crtc->state->event = NULL;
 	}
+	spin_unlock_irqrestore(&crtc->dev->event_lock, flags);
+}
 
-	/* Update the VD1 registers */
-	if (priv->viu.vd1_enabled && priv->viu.vd1_commit) {
-
-		if (priv->viu.vd1_afbc) {
-			writel_relaxed(priv->viu.vd1_afbc_head_addr,
-				       priv->io_base +
-				       _REG(AFBC_HEAD_BADDR));
-			writel_relaxed(priv->viu.vd1_afbc_body_addr,
-				       priv->io_base +
-				       _REG(AFBC_BODY_BADDR));
-			writel_relaxed(priv->viu.vd1_afbc_en,
-				       priv->io_base +
-				       _REG(AFBC_ENABLE));
-			writel_relaxed(priv->viu.vd1_afbc_mode,
-				       priv->io_base +
-				       _REG(AFBC_MODE));
-			writel_relaxed(priv->viu.vd1_afbc_size_in,
-				       priv->io_base +
-				       _REG(AFBC_SIZE_IN));
-			writel_relaxed(priv->viu.vd1_afbc_dec_def_color,
-				       priv->io_base +
-				       _REG(AFBC_DEC_DEF_COLOR));
-			writel_relaxed(priv->viu.vd1_afbc_conv_ctrl,
-				       priv->io_base +
-				       _REG(AFBC_CONV_CTRL));
-			writel_relaxed(priv->viu.vd1_afbc_size_out,
-				       priv->io_base +
-				       _REG(AFBC_SIZE_OUT));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_ctrl,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_CTRL));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_w,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_W));
-			writel_relaxed(priv->viu.vd1_afbc_mif_hor_scope,
-				       priv->io_base +
-				       _REG(AFBC_MIF_HOR_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_mif_ver_scope,
-				       priv->io_base +
-				       _REG(AFBC_MIF_VER_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_pixel_hor_scope,
-				       priv->io_base+
-				       _REG(AFBC_PIXEL_HOR_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_pixel_ver_scope,
-				       priv->io_base +
-				       _REG(AFBC_PIXEL_VER_SCOPE));
-			writel_relaxed(priv->viu.vd1_afbc_vd_cfmt_h,
-				       priv->io_base +
-				       _REG(AFBC_VD_CFMT_H));
-		} else {
-			switch (priv->viu.vd1_planes) {
-			case 3:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_2,
-						    priv->viu.vd1_addr2,
-						    priv->viu.vd1_stride2,
-						    priv->viu.vd1_height2,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			/* fallthrough */
-			case 2:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_1,
-						    priv->viu.vd1_addr1,
-						    priv->viu.vd1_stride1,
-						    priv->viu.vd1_height1,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			/* fallthrough */
-			case 1:
-				meson_canvas_config(priv->canvas,
-						    priv->canvas_id_vd1_0,
-						    priv->viu.vd1_addr0,
-						    priv->viu.vd1_stride0,
-						    priv->viu.vd1_height0,
-						    MESON_CANVAS_WRAP_NONE,
-						    MESON_CANVAS_BLKMODE_LINEAR,
-						    MESON_CANVAS_ENDIAN_SWAP64);
-			}
-
-			writel_relaxed(0, priv->io_base + _REG(AFBC_ENABLE));
-		}
+static const struct drm_crtc_helper_funcs meson_crtc_helper_funcs = {
+	.atomic_begin	= meson_crtc_atomic_begin,
+	.atomic_flush	= meson_crtc_atomic_flush,
+	.atomic_enable	= meson_crtc_atomic_enable,
+	.atomic_disable	= meson_crtc_atomic_disable,
+};
 
-		writel_relaxed(priv->viu.vd1_if0_gen_reg,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_GEN_REG));
-		writel_relaxed(priv->viu.vd1_if0_gen_reg,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_GEN_REG));
-		writel_relaxed(priv->viu.vd1_if0_gen_reg2,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_GEN_REG2));
-		writel_relaxed(priv->viu.viu_vd1_fmt_ctrl,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD1_FMT_CTRL));
-		writel_relaxed(priv->viu.viu_vd1_fmt_ctrl,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD2_FMT_CTRL));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD1_FMT_W));
-		writel_relaxed(priv->viu.viu_vd1_fmt_w,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VIU_VD2_FMT_W));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CANVAS0));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CANVAS1));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CANVAS0));
-		writel_relaxed(priv->viu.vd1_if0_canvas0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CANVAS1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_luma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_luma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_X0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_x0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_X1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_Y0));
-		writel_relaxed(priv->viu.vd1_if0_chroma_y0,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_Y1));
-		writel_relaxed(priv->viu.vd1_if0_repeat_loop,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RPT_LOOP));
-		writel_relaxed(priv->viu.vd1_if0_repeat_loop,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_RPT_LOOP));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_luma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA0_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA1_RPT_PAT));
-		writel_relaxed(priv->viu.vd1_if0_chroma0_rpt_pat,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA1_RPT_PAT));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_LUMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_CHROMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_LUMA_PSEL));
-		writel_relaxed(0, priv->io_base + meson_crtc->viu_offset +
-				_REG(VD2_IF0_CHROMA_PSEL));
-		writel_relaxed(priv->viu.vd1_range_map_y,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_Y));
-		writel_relaxed(priv->viu.vd1_range_map_cb,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_CB));
-		writel_relaxed(priv->viu.vd1_range_map_cr,
-				priv->io_base + meson_crtc->viu_offset +
-				_REG(VD1_IF0_RANGE_MAP_CR));
-		writel_relaxed(VPP_VSC_BANK_LENGTH(4) |
-			       VPP_HSC_BANK_LENGTH(4) |
-			       VPP_SC_VD_EN_ENABLE |
-			       VPP_SC_TOP_EN_ENABLE |
-			       VPP_SC_HSC_EN_ENABLE |
-			       VPP_SC_VSC_EN_ENABLE,
-				priv->io_base + _REG(VPP_SC_MISC));
-		writel_relaxed(priv->viu.vpp_pic_in_height,
-				priv->io_base + _REG(VPP_PIC_IN_HEIGHT));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_h_start_end,
-			priv->io_base + _REG(VPP_POSTBLEND_VD1_H_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_h_start_end,
-			priv->io_base + _REG(VPP_BLEND_VD2_H_START_END));
-		writel_relaxed(priv->viu.vpp_postblend_vd1_v_start_end,
-			priv->io_base + _REG(VPP_POSTBLEND_VD1_V_START_END));
-		writel_relaxed(priv->viu.vpp_blend_vd2_v_start_end,
-			priv->io_base + _REG(VPP_BLEND_VD2_V_START_END));
-		writel_relaxed(priv->viu.vpp_hsc_region12_startp,
-				priv->io_base + _REG(VPP_HSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region34_startp,
-				priv->io_base + _REG(VPP_HSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_hsc_region4_endp,
-				priv->io_base + _REG(VPP_HSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_hsc_start_phase_step,
-				priv->io_base + _REG(VPP_HSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_hsc_region1_phase_slope,
-			priv->io_base + _REG(VPP_HSC_REGION1_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_hsc_region3_phase_slope,
-			priv->io_base + _REG(VPP_HSC_REGION3_PHASE_SLOPE));
-		writel_relaxed(priv->viu.vpp_line_in_length,
-				priv->io_base + _REG(VPP_LINE_IN_LENGTH));
-		writel_relaxed(priv->viu.vpp_preblend_h_size,
-				priv->io_base + _REG(VPP_PREBLEND_H_SIZE));
-		writel_relaxed(priv->viu.vpp_vsc_region12_startp,
-				priv->io_base + _REG(VPP_VSC_REGION12_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region34_startp,
-				priv->io_base + _REG(VPP_VSC_REGION34_STARTP));
-		writel_relaxed(priv->viu.vpp_vsc_region4_endp,
-				priv->io_base + _REG(VPP_VSC_REGION4_ENDP));
-		writel_relaxed(priv->viu.vpp_vsc_start_phase_step,
-				priv->io_base + _REG(VPP_VSC_START_PHASE_STEP));
-		writel_relaxed(priv->viu.vpp_vsc_ini_phase,
-				priv->io_base + _REG(VPP_VSC_INI_PHASE));
-		writel_relaxed(priv->viu.vpp_vsc_phase_ctrl,
-				priv->io_base + _REG(VPP_VSC_PHASE_CTRL));
-		writel_relaxed(priv->viu.vpp_hsc_phase_ctrl,
-				priv->io_base + _REG(VPP_HSC_PHASE_CTRL));
-		writel_relaxed(0x42, priv->io_base + _REG(VPP_SCALE_COEF_IDX));
-
-		/* Enable VD1 */
-		if (meson_crtc->enable_vd1)
-			meson_crtc->enable_vd1(priv);
-
-		priv->viu.vd1_commit = false;
+static const struct drm_crtc_helper_funcs meson_g12a_crtc_helper_funcs = {
+	.atomic_begin	= meson_crtc_atomic_begin,
+	.atomic_flush	= meson_crtc_atomic_flush,
+	.atomic_enable	= meson_g12a_crtc_atomic_enable,
+	.atomic_disable	= meson_g12a_crtc_atomic_disable,
+};
+
+void meson_crtc_irq(struct meson_drm *priv)
+{
+	struct meson_crtc *meson_crtc = to_meson_crtc(priv->crtc);
+	bool pending, done = false;
+	unsigned long flags;
+	u32 latency = 0;
+
+	/* Stop the RDMA once it replayed the last commit on a VSYNC */
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+	priv->stats.vsyncs++;
+	pending = meson_crtc->rdma_pending;
+	if (pending) {
+		done = meson_rdma_done(priv);
+		latency = ktime_us_delta(ktime_get(), priv->stats.flush_time);
+	}
+
+	if (done) {
+		meson_rdma_stop(priv);
+		meson_crtc->rdma_pending = false;
+		priv->stats.latency_us[priv->stats.latency_pos] = latency;
+		priv->stats.latency_pos = (priv->stats.latency_pos + 1) %
+					  MESON_STATS_LATENCIES;
+	} else if (pending && !priv->stats.flush_late) {
+		priv->stats.commits_late++;
+		priv->stats.flush_late = true;
 	}
 
+	trace_meson_crtc_irq(pending, done, latency);
+
+	/* VD1 flips don't wait for the RDMA, they only touch the canvases */
+	meson_overlay_flip_vsync(priv);
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+
 	if (meson_crtc->vsync_disabled)
 		return;
 
 	drm_crtc_handle_vblank(priv->crtc);
 
 	spin_lock_irqsave(&priv->drm->event_lock, flags);
-	if (meson_crtc->event) {
+	if (meson_crtc->event && !meson_crtc->rdma_pending) {
 		drm_crtc_send_vblank_event(priv->crtc, meson_crtc->event);
 		drm_crtc_vblank_put(priv->crtc);
 		meson_crtc->event = NULL;
@@ -694,6 +878,8 @@ int meson_crtc_create(struct meson_drm *priv)
 
 	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
 		meson_crtc->enable_osd1 = meson_g12a_crtc_enable_osd1;
+		meson_crtc->enable_osd2 = meson_g12a_crtc_enable_osd2;
+		meson_crtc->commit_osd_blend = meson_g12a_crtc_commit_osd_blend;
 		meson_crtc->enable_vd1 = meson_g12a_crtc_enable_vd1;
 		meson_crtc->viu_offset = MESON_G12A_VIU_OFFSET;
 		meson_crtc->enable_osd1_afbc =
@@ -703,6 +889,8 @@ int meson_crtc_create(struct meson_drm *priv)
 		drm_crtc_helper_add(crtc, &meson_g12a_crtc_helper_funcs);
 	} else {
 		meson_crtc->enable_osd1 = meson_crtc_enable_osd1;
+		meson_crtc->enable_osd2 = meson_crtc_enable_osd2;
+		meson_crtc->commit_osd_blend = meson_crtc_commit_osd_blend;
 		meson_crtc->enable_vd1 = meson_crtc_enable_vd1;
 		if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXM)) {
 			meson_crtc->enable_osd1_afbc =
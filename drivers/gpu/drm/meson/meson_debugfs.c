@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2016 BayLibre, SAS
+ * Author: Neil Armstrong <narmstrong@baylibre.com>
+ */
+
+#include <linux/seq_file.h>
+
+#include <drm/drm_crtc.h>
+#include <drm/drm_debugfs.h>
+#include <drm/drm_device.h>
+#include <drm/drm_file.h>
+#include <drm/drm_fourcc.h>
+#include <drm/drm_framebuffer.h>
+#include <drm/drm_modeset_lock.h>
+#include <drm/drm_plane.h>
+
+#include "meson_drv.h"
+
+/*
+ * The "scanout_stats" file reports the commit and RDMA counters along with
+ * the last commit to VSYNC latencies, "plane_bandwidth" estimates the DDR
+ * bandwidth each visible plane needs from its source size and format.
+ */
+
+static int meson_debugfs_stats(struct seq_file *m, void *unused)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct meson_drm *priv = dev->dev_private;
+	u32 latency_us[MESON_STATS_LATENCIES];
+	u64 vsyncs, commits, late, dropped;
+	unsigned int pos, i;
+	unsigned long flags;
+
+	spin_lock_irqsave(&dev->event_lock, flags);
+	vsyncs = priv->stats.vsyncs;
+	commits = priv->stats.commits;
+	late = priv->stats.commits_late;
+	dropped = priv->stats.commits_dropped;
+	pos = priv->stats.latency_pos;
+	memcpy(latency_us, priv->stats.latency_us, sizeof(latency_us));
+	spin_unlock_irqrestore(&dev->event_lock, flags);
+
+	seq_printf(m, "vsyncs: %llu\n", vsyncs);
+	seq_printf(m, "commits: %llu\n", commits);
+	seq_printf(m, "commits late: %llu\n", late);
+	seq_printf(m, "commits dropped: %llu\n", dropped);
+	seq_printf(m, "rdma grows: %llu\n", priv->stats.rdma_grows);
+	seq_printf(m, "rdma overflows: %llu\n", priv->stats.rdma_overflows);
+
+	/* Oldest first */
+	seq_puts(m, "commit latencies (us):");
+	for (i = 0 ; i < MESON_STATS_LATENCIES ; ++i)
+		seq_printf(m, " %u",
+			   latency_us[(pos + i) % MESON_STATS_LATENCIES]);
+	seq_puts(m, "\n");
+
+	return 0;
+}
+
+/* Bytes fetched for each frame, compressed buffers are counted unpacked */
+static u64 meson_debugfs_frame_bytes(const struct drm_format_info *info,
+				     unsigned int width, unsigned int height)
+{
+	u64 bytes = 0;
+	unsigned int i;
+
+	/* Amlogic FBC only formats have no cpp, 4:2:0 with 8 or 10 bits */
+	if (info->format == DRM_FORMAT_YUV420_8BIT)
+		return (u64)width * height * 12 / 8;
+	if (info->format == DRM_FORMAT_YUV420_10BIT)
+		return (u64)width * height * 15 / 8;
+
+	for (i = 0 ; i < info->num_planes ; ++i)
+		bytes += (u64)drm_format_info_plane_width(info, width, i) *
+			 drm_format_info_plane_height(info, height, i) *
+			 info->cpp[i];
+
+	return bytes;
+}
+
+static int meson_debugfs_bandwidth(struct seq_file *m, void *unused)
+{
+	struct drm_info_node *node = m->private;
+	struct drm_device *dev = node->minor->dev;
+	struct meson_drm *priv = dev->dev_private;
+	struct drm_format_name_buf format_name;
+	struct drm_plane_state *state;
+	unsigned int width, height;
+	struct drm_plane *plane;
+	u64 bytes, total = 0;
+	int vrefresh;
+
+	drm_modeset_lock_all(dev);
+
+	vrefresh = drm_mode_vrefresh(&priv->crtc->state->mode);
+
+	drm_for_each_plane(plane, dev) {
+		state = plane->state;
+		if (!state->fb || !state->visible) {
+			seq_printf(m, "%s: disabled\n", plane->name);
+			continue;
+		}
+
+		width = drm_rect_width(&state->src) >> 16;
+		height = drm_rect_height(&state->src) >> 16;
+		bytes = meson_debugfs_frame_bytes(state->fb->format,
+						  width, height) * vrefresh;
+		total += bytes;
+
+		seq_printf(m, "%s: %ux%u %s modifier 0x%llx %llu KiB/s\n",
+			   plane->name, width, height,
+			   drm_get_format_name(state->fb->format->format,
+					       &format_name),
+			   state->fb->modifier, bytes >> 10);
+	}
+
+	seq_printf(m, "total: %llu KiB/s at %dHz\n", total >> 10, vrefresh);
+
+	drm_modeset_unlock_all(dev);
+
+	return 0;
+}
+
+static const struct drm_info_list meson_debugfs_list[] = {
+	{ "scanout_stats", meson_debugfs_stats, 0 },
+	{ "plane_bandwidth", meson_debugfs_bandwidth, 0 },
+};
+
+int meson_debugfs_init(struct drm_minor *minor)
+{
+	return drm_debugfs_create_files(meson_debugfs_list,
+					ARRAY_SIZE(meson_debugfs_list),
+					minor->debugfs_root, minor);
+}
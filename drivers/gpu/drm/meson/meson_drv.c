@@ -15,6 +15,7 @@
 #include <linux/platform_device.h>
 #include <linux/soc/amlogic/meson-canvas.h>
 
+#include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_fb_helper.h>
@@ -27,6 +28,7 @@
 
 #include "meson_crtc.h"
 #include "meson_drv.h"
+#include "meson_osd2.h"
 #include "meson_overlay.h"
 #include "meson_plane.h"
 #include "meson_osd_afbcd.h"
@@ -54,8 +56,28 @@
  * - Powering Up HDMI controller and PHY
  */
 
+static int meson_atomic_check(struct drm_device *dev,
+			      struct drm_atomic_state *state)
+{
+	struct meson_drm *priv = dev->dev_private;
+	int ret;
+
+	ret = drm_atomic_helper_check(dev, state);
+	if (ret)
+		return ret;
+
+	/*
+	 * Buffer flips of the video overlay alone skip the commit and are
+	 * applied from the VSYNC IRQ, so they're never held back by the UI.
+	 */
+	if (!state->async_update)
+		state->async_update = !meson_overlay_async_check(priv, state);
+
+	return 0;
+}
+
 static const struct drm_mode_config_funcs meson_mode_config_funcs = {
-	.atomic_check        = drm_atomic_helper_check,
+	.atomic_check        = meson_atomic_check,
 	.atomic_commit       = drm_atomic_helper_commit,
 	.fb_create           = drm_gem_fb_create,
 };
@@ -110,6 +132,10 @@ static struct drm_driver meson_driver = {
 	.gem_free_object_unlocked = drm_gem_cma_free_object,
 	.gem_vm_ops		= &drm_gem_cma_vm_ops,
 
+#ifdef CONFIG_DEBUG_FS
+	.debugfs_init		= meson_debugfs_init,
+#endif
+
 	/* Misc */
 	.fops			= &fops,
 	.name			= DRIVER_NAME,
@@ -184,6 +210,55 @@ static void meson_remove_framebuffers(void)
 	kfree(ap);
 }
 
+/*
+ * Each plane canvas comes in pairs: one is scanned out while the other
+ * is filled for the next commit, since the RDMA cannot write the DMC.
+ */
+static int meson_canvases_alloc(struct meson_drm *priv)
+{
+	u8 *canvas_ids[] = {
+		&priv->canvas_id_osd1, &priv->canvas_id_osd1_scanout,
+		&priv->canvas_id_osd2, &priv->canvas_id_osd2_scanout,
+		&priv->canvas_id_vd1_0, &priv->canvas_id_vd1_0_scanout,
+		&priv->canvas_id_vd1_1, &priv->canvas_id_vd1_1_scanout,
+		&priv->canvas_id_vd1_2, &priv->canvas_id_vd1_2_scanout,
+		&priv->canvas_id_vd2_0, &priv->canvas_id_vd2_0_scanout,
+		&priv->canvas_id_vd2_1, &priv->canvas_id_vd2_1_scanout,
+	};
+	unsigned int i;
+	int ret;
+
+	for (i = 0 ; i < ARRAY_SIZE(canvas_ids) ; ++i) {
+		ret = meson_canvas_alloc(priv->canvas, canvas_ids[i]);
+		if (ret) {
+			while (i--)
+				meson_canvas_free(priv->canvas,
+						  *canvas_ids[i]);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static void meson_canvases_free(struct meson_drm *priv)
+{
+	meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
+	meson_canvas_free(priv->canvas, priv->canvas_id_osd1_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_osd2);
+	meson_canvas_free(priv->canvas, priv->canvas_id_osd2_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_2);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd1_2_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd2_0);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd2_0_scanout);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd2_1);
+	meson_canvas_free(priv->canvas, priv->canvas_id_vd2_1_scanout);
+}
+
 struct meson_drm_soc_attr {
 	struct meson_drm_soc_limits limits;
 	const struct soc_device_attribute *attrs;
@@ -272,27 +347,9 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 		goto free_drm;
 	}
 
-	ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_osd1);
+	ret = meson_canvases_alloc(priv);
 	if (ret)
 		goto free_drm;
-	ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_0);
-	if (ret) {
-		meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-		goto free_drm;
-	}
-	ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_1);
-	if (ret) {
-		meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-		goto free_drm;
-	}
-	ret = meson_canvas_alloc(priv->canvas, &priv->canvas_id_vd1_2);
-	if (ret) {
-		meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1);
-		goto free_drm;
-	}
 
 	priv->vsync_irq = platform_get_irq(pdev, 0);
 
@@ -316,6 +373,7 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	drm->mode_config.max_height = 2160;
 	drm->mode_config.funcs = &meson_mode_config_funcs;
 	drm->mode_config.helper_private	= &meson_mode_config_helpers;
+	drm->mode_config.normalize_zpos = true;
 
 	/* Hardware Initialization */
 
@@ -323,6 +381,12 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	meson_venc_init(priv);
 	meson_vpp_init(priv);
 	meson_viu_init(priv);
+
+	ret = meson_rdma_init(priv);
+	if (ret)
+		goto free_drm;
+	meson_rdma_setup(priv);
+
 	if (priv->afbcd.ops) {
 		ret = priv->afbcd.ops->init(priv);
 		if (ret)
@@ -351,6 +415,14 @@ static int meson_drv_bind_master(struct device *dev, bool has_components)
 	if (ret)
 		goto free_drm;
 
+	ret = meson_overlay_vd2_create(priv);
+	if (ret)
+		goto free_drm;
+
+	ret = meson_osd2_create(priv);
+	if (ret)
+		goto free_drm;
+
 	ret = meson_crtc_create(priv);
 	if (ret)
 		goto free_drm;
@@ -391,17 +463,10 @@ static void meson_drv_unbind(struct device *dev)
 	struct meson_drm *priv = dev_get_drvdata(dev);
 	struct drm_device *drm = priv->drm;
 
-	if (priv->canvas) {
-		meson_canvas_free(priv->canvas, priv->canvas_id_osd1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_0);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_1);
-		meson_canvas_free(priv->canvas, priv->canvas_id_vd1_2);
-	}
+	if (priv->canvas)
+		meson_canvases_free(priv);
 
-	if (priv->afbcd.ops) {
-		priv->afbcd.ops->reset(priv);
-		meson_rdma_free(priv);
-	}
+	meson_rdma_free(priv);
 
 	drm_dev_unregister(drm);
 	drm_irq_uninstall(drm);
@@ -436,6 +501,8 @@ static int __maybe_unused meson_drv_pm_resume(struct device *dev)
 	meson_venc_init(priv);
 	meson_vpp_init(priv);
 	meson_viu_init(priv);
+	meson_rdma_init(priv);
+	meson_rdma_setup(priv);
 	if (priv->afbcd.ops)
 		priv->afbcd.ops->init(priv);
 
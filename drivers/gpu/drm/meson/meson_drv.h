@@ -8,12 +8,16 @@
 #define __MESON_DRV_H
 
 #include <linux/device.h>
+#include <linux/ktime.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
 #include <linux/regmap.h>
 
+#include <drm/drm_color_mgmt.h>
+
 struct drm_crtc;
 struct drm_device;
+struct drm_minor;
 struct drm_plane;
 struct meson_drm;
 struct meson_afbcd_ops;
@@ -30,6 +34,9 @@ struct meson_drm_match_data {
 	struct meson_afbcd_ops *afbcd_ops;
 };
 
+/* Number of commit to VSYNC latencies kept for debugfs */
+#define MESON_STATS_LATENCIES	16
+
 struct meson_drm_soc_limits {
 	unsigned int max_hdmi_phy_freq;
 };
@@ -43,14 +50,27 @@ struct meson_drm {
 
 	struct meson_canvas *canvas;
 	u8 canvas_id_osd1;
+	u8 canvas_id_osd2;
 	u8 canvas_id_vd1_0;
 	u8 canvas_id_vd1_1;
 	u8 canvas_id_vd1_2;
+	u8 canvas_id_vd2_0;
+	u8 canvas_id_vd2_1;
+	/* Scanned out canvases, swapped with the ones above on plane updates */
+	u8 canvas_id_osd1_scanout;
+	u8 canvas_id_osd2_scanout;
+	u8 canvas_id_vd1_0_scanout;
+	u8 canvas_id_vd1_1_scanout;
+	u8 canvas_id_vd1_2_scanout;
+	u8 canvas_id_vd2_0_scanout;
+	u8 canvas_id_vd2_1_scanout;
 
 	struct drm_device *drm;
 	struct drm_crtc *crtc;
 	struct drm_plane *primary_plane;
 	struct drm_plane *overlay_plane;
+	struct drm_plane *osd2_plane;
+	struct drm_plane *vd2_plane;
 
 	const struct meson_drm_soc_limits *limits;
 
@@ -79,15 +99,36 @@ struct meson_drm {
 		uint32_t osd_sc_h_phase_step;
 		uint32_t osd_sc_h_ctrl0;
 		uint32_t osd_sc_v_ctrl0;
+		bool osd_sc_h_upscale;
+		bool osd_sc_v_upscale;
+		bool osd_sc_h_bicubic;
+		bool osd_sc_v_bicubic;
 		uint32_t osd_blend_din0_scope_h;
 		uint32_t osd_blend_din0_scope_v;
 		uint32_t osb_blend0_size;
 		uint32_t osb_blend1_size;
 
+		bool osd_blend_commit;
+
+		bool osd2_enabled;
+		bool osd2_commit;
+		bool osd2_on_top;
+		bool osd2_premult;
+		uint32_t osd2_ctrl_stat;
+		uint32_t osd2_ctrl_stat2;
+		uint32_t osd2_blk0_cfg[5];
+		uint32_t osd2_addr;
+		uint32_t osd2_stride;
+		uint32_t osd2_height;
+		uint32_t osd2_blend_scope_h;
+		uint32_t osd2_blend_scope_v;
+
 		bool vd1_enabled;
 		bool vd1_commit;
 		bool vd1_afbc;
 		unsigned int vd1_planes;
+		enum drm_color_encoding vd1_color_encoding;
+		enum drm_color_range vd1_color_range;
 		uint32_t vd1_if0_gen_reg;
 		uint32_t vd1_if0_luma_x0;
 		uint32_t vd1_if0_luma_y0;
@@ -145,6 +186,28 @@ struct meson_drm {
 		uint32_t vpp_vsc_ini_phase;
 		uint32_t vpp_vsc_phase_ctrl;
 		uint32_t vpp_hsc_phase_ctrl;
+
+		bool vd2_enabled;
+		bool vd2_commit;
+		unsigned int vd2_planes;
+		enum drm_color_encoding vd2_color_encoding;
+		enum drm_color_range vd2_color_range;
+		uint32_t vd2_if0_gen_reg;
+		uint32_t vd2_if0_gen_reg2;
+		uint32_t vd2_if0_canvas0;
+		uint32_t vd2_if0_luma_x0;
+		uint32_t vd2_if0_luma_y0;
+		uint32_t vd2_if0_chroma_x0;
+		uint32_t vd2_if0_chroma_y0;
+		uint32_t viu_vd2_fmt_ctrl;
+		uint32_t viu_vd2_fmt_w;
+		uint32_t vd2_addr0;
+		uint32_t vd2_addr1;
+		uint32_t vd2_stride0;
+		uint32_t vd2_stride1;
+		uint32_t vd2_height0;
+		uint32_t vd2_height1;
+		uint32_t vpp_vd2_hdr_in_size;
 		uint32_t vpp_blend_vd2_h_start_end;
 		uint32_t vpp_blend_vd2_v_start_end;
 	} viu;
@@ -156,12 +219,43 @@ struct meson_drm {
 		bool hdmi_use_enci;
 	} venc;
 
+	/* HDMI VIC clock in use, to retune it to its 1000/1001 variant */
 	struct {
-		dma_addr_t addr_dma;
-		uint32_t *addr;
+		bool vic_valid;
+		bool vic_alternate_clock;
+		unsigned int vic_params;
+		unsigned int hdmi_tx_div;
+		unsigned int venc_div;
+	} vclk;
+
+	struct {
+		/* Ping-pong lists, one recorded while the other one is replayed */
+		dma_addr_t addr_dma[2];
+		uint32_t *addr[2];
+		size_t size[2];
+		unsigned int cur;
 		unsigned int offset;
+		bool recording;
+		bool armed;
 	} rdma;
 
+	/* Scanout statistics, updated under the event_lock but the RDMA ones */
+	struct {
+		u64 vsyncs;
+		u64 commits;
+		/* Commits not replayed on the first VSYNC after their flush */
+		u64 commits_late;
+		/* Commits whose list was replaced before being replayed */
+		u64 commits_dropped;
+		u64 rdma_grows;
+		/* Register writes done by the CPU since the list couldn't grow */
+		u64 rdma_overflows;
+		ktime_t flush_time;
+		bool flush_late;
+		unsigned int latency_pos;
+		u32 latency_us[MESON_STATS_LATENCIES];
+	} stats;
+
 	struct {
 		struct meson_afbcd_ops *ops;
 		u64 modifier;
@@ -175,4 +269,6 @@ static inline int meson_vpu_is_compatible(struct meson_drm *priv,
 	return priv->compat == family;
 }
 
+int meson_debugfs_init(struct drm_minor *minor);
+
 #endif /* __MESON_DRV_H */
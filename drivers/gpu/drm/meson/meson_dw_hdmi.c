@@ -376,10 +376,12 @@ static inline void meson_dw_hdmi_phy_reset(struct meson_dw_hdmi *dw_hdmi)
 	mdelay(2);
 }
 
-static void dw_hdmi_set_vclk(struct meson_dw_hdmi *dw_hdmi,
-			     const struct drm_display_mode *mode)
+/* Returns false for DMT modes, which only use phy_freq and vclk_freq */
+static bool dw_hdmi_get_vclk(struct meson_dw_hdmi *dw_hdmi,
+			     const struct drm_display_mode *mode,
+			     unsigned int *phy, unsigned int *vclk,
+			     unsigned int *venc, unsigned int *hdmi)
 {
-	struct meson_drm *priv = dw_hdmi->priv;
 	int vic = drm_match_cea_mode(mode);
 	unsigned int phy_freq;
 	unsigned int vclk_freq;
@@ -396,9 +398,9 @@ static void dw_hdmi_set_vclk(struct meson_dw_hdmi *dw_hdmi,
 	phy_freq = vclk_freq * 10;
 
 	if (!vic) {
-		meson_vclk_setup(priv, MESON_VCLK_TARGET_DMT, phy_freq,
-				 vclk_freq, vclk_freq, vclk_freq, false);
-		return;
+		*phy = phy_freq;
+		*vclk = *venc = *hdmi = vclk_freq;
+		return false;
 	}
 
 	/* 480i/576i needs global pixel doubling */
@@ -418,6 +420,30 @@ static void dw_hdmi_set_vclk(struct meson_dw_hdmi *dw_hdmi,
 	if (mode->flags & DRM_MODE_FLAG_DBLCLK)
 		venc_freq /= 2;
 
+	*phy = phy_freq;
+	*vclk = vclk_freq;
+	*venc = venc_freq;
+	*hdmi = hdmi_freq;
+
+	return true;
+}
+
+static void dw_hdmi_set_vclk(struct meson_dw_hdmi *dw_hdmi,
+			     const struct drm_display_mode *mode)
+{
+	struct meson_drm *priv = dw_hdmi->priv;
+	unsigned int phy_freq;
+	unsigned int vclk_freq;
+	unsigned int venc_freq;
+	unsigned int hdmi_freq;
+
+	if (!dw_hdmi_get_vclk(dw_hdmi, mode, &phy_freq, &vclk_freq,
+			      &venc_freq, &hdmi_freq)) {
+		meson_vclk_setup(priv, MESON_VCLK_TARGET_DMT, phy_freq,
+				 vclk_freq, vclk_freq, vclk_freq, false);
+		return;
+	}
+
 	DRM_DEBUG_DRIVER("vclk:%d phy=%d venc=%d hdmi=%d enci=%d\n",
 		phy_freq, vclk_freq, venc_freq, hdmi_freq,
 		priv->venc.hdmi_use_enci);
@@ -745,6 +771,49 @@ meson_venc_hdmi_encoder_get_inp_bus_fmts(struct drm_bridge *bridge,
 	return input_fmts;
 }
 
+/*
+ * Switching between a CEA mode and its 1000/1001 variant keeps the exact
+ * same timings, the pixel clock can then be retuned on the fly by the CRTC
+ * flush instead of going through a full disable/enable of the pipeline.
+ */
+static bool meson_venc_hdmi_encoder_can_retune(struct drm_bridge *bridge,
+					struct drm_bridge_state *bridge_state,
+					struct drm_crtc_state *crtc_state)
+{
+	struct meson_dw_hdmi *dw_hdmi = bridge_to_meson_dw_hdmi(bridge);
+	struct drm_atomic_state *state = crtc_state->state;
+	struct drm_bridge_state *old_bridge_state;
+	struct drm_crtc_state *old_crtc_state;
+	unsigned int phy_freq, vclk_freq, venc_freq, hdmi_freq;
+
+	if (!crtc_state->mode_changed || crtc_state->active_changed ||
+	    crtc_state->connectors_changed || !crtc_state->active)
+		return false;
+
+	old_crtc_state = drm_atomic_get_old_crtc_state(state, crtc_state->crtc);
+	if (!old_crtc_state->active ||
+	    old_crtc_state->mode.clock == crtc_state->mode.clock ||
+	    !drm_mode_match(&old_crtc_state->mode, &crtc_state->mode,
+			    DRM_MODE_MATCH_TIMINGS | DRM_MODE_MATCH_FLAGS |
+			    DRM_MODE_MATCH_3D_FLAGS |
+			    DRM_MODE_MATCH_ASPECT_RATIO))
+		return false;
+
+	old_bridge_state = drm_atomic_get_old_bridge_state(state, bridge);
+	if (!old_bridge_state ||
+	    old_bridge_state->output_bus_cfg.format !=
+	    bridge_state->output_bus_cfg.format)
+		return false;
+
+	if (!dw_hdmi_get_vclk(dw_hdmi, &crtc_state->mode, &phy_freq,
+			      &vclk_freq, &venc_freq, &hdmi_freq))
+		return false;
+
+	return meson_vclk_vic_can_retune(dw_hdmi->priv, phy_freq, vclk_freq,
+					 venc_freq, hdmi_freq,
+					 dw_hdmi->priv->venc.hdmi_use_enci);
+}
+
 static int meson_venc_hdmi_encoder_atomic_check(struct drm_bridge *bridge,
 					struct drm_bridge_state *bridge_state,
 					struct drm_crtc_state *crtc_state,
@@ -756,6 +825,15 @@ static int meson_venc_hdmi_encoder_atomic_check(struct drm_bridge *bridge,
 
 	DRM_DEBUG_DRIVER("output_bus_fmt %lx\n", dw_hdmi->output_bus_fmt);
 
+	if (meson_venc_hdmi_encoder_can_retune(bridge, bridge_state,
+					       crtc_state)) {
+		DRM_DEBUG_DRIVER("retune %d -> %d kHz without mode set\n",
+				 drm_atomic_get_old_crtc_state(crtc_state->state,
+					crtc_state->crtc)->mode.clock,
+				 crtc_state->mode.clock);
+		crtc_state->mode_changed = false;
+	}
+
 	return 0;
 }
 
@@ -852,12 +930,39 @@ static int meson_dw_hdmi_reg_write(void *context, unsigned int reg,
 	return 0;
 }
 
+/*
+ * Only the video sampler, video packetizer, frame composer and color space
+ * converter configuration are cached: they only change when written, and
+ * they take most of the accesses of a mode set or an InfoFrame update. The
+ * status, interrupt, self-clearing and I2C/PHY/HDCP/CEC registers and
+ * everything else always go to the hardware.
+ */
+static bool meson_dw_hdmi_volatile_reg(struct device *dev, unsigned int reg)
+{
+	switch (reg) {
+	case 0x0200 ... 0x0207:	/* TX_INVID0 ... TX_BCBDATA1 */
+	case 0x0801 ... 0x0804:	/* VP_PR_CD ... VP_CONF */
+	case 0x1000 ... 0x10b5:	/* FC_INVIDCONF ... FC_DATAUTO2 */
+	case 0x10b7 ... 0x10bf:	/* FC_DATAUTO3 ... FC_RDRB7 */
+	case 0x10e0 ... 0x10e3:	/* FC_PRCONF ... FC_PACKET_TX_EN */
+	case 0x1101:		/* FC_GMD_EN */
+	case 0x1103 ... 0x1120:	/* FC_GMD_CONF ... FC_GMD_PB27 */
+	case 0x1168 ... 0x1184:	/* FC_DRM_HB0 ... FC_DRM_PB26 */
+	case 0x4100 ... 0x4119:	/* CSC_CFG ... CSC_COEF_C4_LSB */
+		return false;
+	default:
+		return true;
+	}
+}
+
 static const struct regmap_config meson_dw_hdmi_regmap_config = {
 	.reg_bits = 32,
 	.val_bits = 8,
 	.reg_read = meson_dw_hdmi_reg_read,
 	.reg_write = meson_dw_hdmi_reg_write,
 	.max_register = 0x10000,
+	.volatile_reg = meson_dw_hdmi_volatile_reg,
+	.cache_type = REGCACHE_RBTREE,
 	.fast_io = true,
 };
 
@@ -1130,6 +1235,10 @@ static int __maybe_unused meson_dw_hdmi_pm_resume(struct device *dev)
 
 	meson_dw_hdmi_init(meson_dw_hdmi);
 
+	/* The controller was reset, forget the cached register values */
+	regcache_drop_region(meson_dw_hdmi->dw_plat_data.regm, 0,
+			     meson_dw_hdmi_regmap_config.max_register);
+
 	dw_hdmi_resume(meson_dw_hdmi->hdmi);
 
 	return 0;
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Copyright (C) 2016 BayLibre, SAS
+ * Author: Neil Armstrong <narmstrong@baylibre.com>
+ * Copyright (C) 2015 Amlogic, Inc. All rights reserved.
+ */
+
+#include <drm/drm_atomic.h>
+#include <drm/drm_atomic_helper.h>
+#include <drm/drm_blend.h>
+#include <drm/drm_device.h>
+#include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_fourcc.h>
+#include <drm/drm_gem_cma_helper.h>
+#include <drm/drm_gem_framebuffer_helper.h>
+#include <drm/drm_plane_helper.h>
+
+#include "meson_osd2.h"
+#include "meson_rdma.h"
+#include "meson_registers.h"
+#include "meson_viu.h"
+
+/*
+ * OSD2 is scanned out as an overlay plane on top or below OSD1, it has no
+ * scaler on its path and can't switch fields on interlaced outputs, so it
+ * is limited to unscaled buffers on progressive modes.
+ */
+
+struct meson_osd2 {
+	struct drm_plane base;
+	struct meson_drm *priv;
+};
+#define to_meson_osd2(x) container_of(x, struct meson_osd2, base)
+
+static int meson_osd2_atomic_check(struct drm_plane *plane,
+				   struct drm_plane_state *state)
+{
+	struct drm_crtc_state *crtc_state;
+	int ret;
+
+	if (!state->crtc)
+		return 0;
+
+	crtc_state = drm_atomic_get_crtc_state(state->state, state->crtc);
+	if (IS_ERR(crtc_state))
+		return PTR_ERR(crtc_state);
+
+	ret = drm_atomic_helper_check_plane_state(state, crtc_state,
+						  DRM_PLANE_HELPER_NO_SCALING,
+						  DRM_PLANE_HELPER_NO_SCALING,
+						  true, true);
+	if (ret)
+		return ret;
+
+	if (state->visible &&
+	    crtc_state->mode.flags & DRM_MODE_FLAG_INTERLACE) {
+		DRM_DEBUG_KMS("OSD2 can't scanout interlaced modes\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Takes a fixed 16.16 number and converts it to integer. */
+static inline int64_t fixed16_to_int(int64_t value)
+{
+	return value >> 16;
+}
+
+static void meson_osd2_atomic_update(struct drm_plane *plane,
+				     struct drm_plane_state *old_state)
+{
+	struct meson_osd2 *meson_osd2 = to_meson_osd2(plane);
+	struct drm_plane_state *state = plane->state;
+	struct drm_rect dest = drm_plane_state_dest(state);
+	struct meson_drm *priv = meson_osd2->priv;
+	struct drm_framebuffer *fb = state->fb;
+	struct drm_gem_cma_object *gem;
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+
+	/* Enable OSD and BLK0 with the plane alpha as global alpha */
+	priv->viu.osd2_ctrl_stat = OSD_ENABLE | OSD_BLK0_ENABLE |
+				   (state->alpha >> 8) << OSD_GLOBAL_ALPHA_SHIFT;
+
+	priv->viu.osd2_ctrl_stat2 = readl(priv->io_base +
+					  _REG(VIU_OSD2_CTRL_STAT2));
+
+	/* Fill the canvas not scanned out, the RDMA switches over on VSYNC */
+	swap(priv->canvas_id_osd2, priv->canvas_id_osd2_scanout);
+
+	/* Set up BLK0 to point to the right canvas */
+	priv->viu.osd2_blk0_cfg[0] = priv->canvas_id_osd2 << OSD_CANVAS_SEL |
+				     OSD_ENDIANNESS_LE;
+
+	/* On GXBB, Use the old non-HDR RGB2YUV converter */
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXBB))
+		priv->viu.osd2_blk0_cfg[0] |= OSD_OUTPUT_COLOR_RGB;
+
+	switch (fb->format->format) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_ARGB8888:
+		priv->viu.osd2_blk0_cfg[0] |= OSD_BLK_MODE_32 |
+					      OSD_COLOR_MATRIX_32_ARGB;
+		break;
+	case DRM_FORMAT_XBGR8888:
+	case DRM_FORMAT_ABGR8888:
+		priv->viu.osd2_blk0_cfg[0] |= OSD_BLK_MODE_32 |
+					      OSD_COLOR_MATRIX_32_ABGR;
+		break;
+	case DRM_FORMAT_RGB888:
+		priv->viu.osd2_blk0_cfg[0] |= OSD_BLK_MODE_24 |
+					      OSD_COLOR_MATRIX_24_RGB;
+		break;
+	case DRM_FORMAT_RGB565:
+		priv->viu.osd2_blk0_cfg[0] |= OSD_BLK_MODE_16 |
+					      OSD_COLOR_MATRIX_16_RGB565;
+		break;
+	}
+
+	/* Ignore the pixel's alpha for XRGB or without pixel blending */
+	if (!fb->format->has_alpha ||
+	    state->pixel_blend_mode == DRM_MODE_BLEND_PIXEL_NONE)
+		priv->viu.osd2_ctrl_stat2 |= OSD_REPLACE_EN;
+	else
+		priv->viu.osd2_ctrl_stat2 &= ~OSD_REPLACE_EN;
+
+	priv->viu.osd2_premult = fb->format->has_alpha &&
+			state->pixel_blend_mode == DRM_MODE_BLEND_PREMULTI;
+
+	/* Planes are normalized over the CRTC, VD1 always being at 0 */
+	priv->viu.osd2_on_top = state->normalized_zpos >
+				priv->primary_plane->state->normalized_zpos;
+
+	/*
+	 * The format of these registers is (x2 << 16 | x1),
+	 * where x2 is exclusive.
+	 * e.g. +30x1920 would be (1919 << 16) | 30
+	 */
+	priv->viu.osd2_blk0_cfg[1] =
+				((fixed16_to_int(state->src.x2) - 1) << 16) |
+				fixed16_to_int(state->src.x1);
+	priv->viu.osd2_blk0_cfg[2] =
+				((fixed16_to_int(state->src.y2) - 1) << 16) |
+				fixed16_to_int(state->src.y1);
+	priv->viu.osd2_blk0_cfg[3] = ((dest.x2 - 1) << 16) | dest.x1;
+	priv->viu.osd2_blk0_cfg[4] = ((dest.y2 - 1) << 16) | dest.y1;
+
+	priv->viu.osd2_blend_scope_h = ((dest.x2 - 1) << 16) | dest.x1;
+	priv->viu.osd2_blend_scope_v = ((dest.y2 - 1) << 16) | dest.y1;
+
+	/* Update Canvas with buffer address */
+	gem = drm_fb_cma_get_gem_obj(fb, 0);
+
+	priv->viu.osd2_addr = gem->paddr;
+	priv->viu.osd2_stride = fb->pitches[0];
+	priv->viu.osd2_height = fb->height;
+
+	priv->viu.osd2_enabled = true;
+	priv->viu.osd2_commit = true;
+	priv->viu.osd_blend_commit = true;
+
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+}
+
+static void meson_osd2_atomic_disable(struct drm_plane *plane,
+				      struct drm_plane_state *old_state)
+{
+	struct meson_osd2 *meson_osd2 = to_meson_osd2(plane);
+	struct meson_drm *priv = meson_osd2->priv;
+
+	/* Disable OSD2, OSD1 shares the OSD blender output on G12A */
+	meson_rdma_writel_bits(priv, OSD_ENABLE, 0, VIU_OSD2_CTRL_STAT);
+
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		if (!priv->viu.osd1_enabled)
+			meson_rdma_writel_bits(priv, VIU_OSD1_POSTBLD_SRC_OSD1,
+					       0, OSD1_BLEND_SRC_CTRL);
+	} else
+		meson_rdma_writel_bits(priv, VPP_OSD2_POSTBLEND, 0, VPP_MISC);
+
+	priv->viu.osd2_enabled = false;
+	priv->viu.osd_blend_commit = true;
+}
+
+static const struct drm_plane_helper_funcs meson_osd2_helper_funcs = {
+	.atomic_check	= meson_osd2_atomic_check,
+	.atomic_disable	= meson_osd2_atomic_disable,
+	.atomic_update	= meson_osd2_atomic_update,
+	.prepare_fb	= drm_gem_fb_prepare_fb,
+};
+
+static const struct drm_plane_funcs meson_osd2_funcs = {
+	.update_plane		= drm_atomic_helper_update_plane,
+	.disable_plane		= drm_atomic_helper_disable_plane,
+	.destroy		= drm_plane_cleanup,
+	.reset			= drm_atomic_helper_plane_reset,
+	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
+	.atomic_destroy_state	= drm_atomic_helper_plane_destroy_state,
+};
+
+static const uint32_t supported_drm_formats[] = {
+	DRM_FORMAT_ARGB8888,
+	DRM_FORMAT_ABGR8888,
+	DRM_FORMAT_XRGB8888,
+	DRM_FORMAT_XBGR8888,
+	DRM_FORMAT_RGB888,
+	DRM_FORMAT_RGB565,
+};
+
+static const uint64_t format_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID,
+};
+
+int meson_osd2_create(struct meson_drm *priv)
+{
+	struct meson_osd2 *meson_osd2;
+	struct drm_plane *plane;
+
+	meson_osd2 = devm_kzalloc(priv->drm->dev, sizeof(*meson_osd2),
+				  GFP_KERNEL);
+	if (!meson_osd2)
+		return -ENOMEM;
+
+	meson_osd2->priv = priv;
+	plane = &meson_osd2->base;
+
+	drm_universal_plane_init(priv->drm, plane, 0xFF,
+				 &meson_osd2_funcs,
+				 supported_drm_formats,
+				 ARRAY_SIZE(supported_drm_formats),
+				 format_modifiers,
+				 DRM_PLANE_TYPE_OVERLAY, "meson_osd2_plane");
+
+	drm_plane_helper_add(plane, &meson_osd2_helper_funcs);
+
+	/* OSD2 stacks over OSD1 by default, both being above VD1 */
+	drm_plane_create_zpos_property(plane, 2, 1, 2);
+	drm_plane_create_alpha_property(plane);
+	drm_plane_create_blend_mode_property(plane,
+					     BIT(DRM_MODE_BLEND_PIXEL_NONE) |
+					     BIT(DRM_MODE_BLEND_PREMULTI) |
+					     BIT(DRM_MODE_BLEND_COVERAGE));
+
+	priv->osd2_plane = plane;
+
+	return 0;
+}
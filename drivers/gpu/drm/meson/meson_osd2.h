@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2016 BayLibre, SAS
+ * Author: Neil Armstrong <narmstrong@baylibre.com>
+ */
+
+#ifndef __MESON_OSD2_H
+#define __MESON_OSD2_H
+
+#include "meson_drv.h"
+
+int meson_osd2_create(struct meson_drm *priv);
+
+#endif /* __MESON_OSD2_H */
@@ -86,26 +86,25 @@ static int meson_gxm_afbcd_init(struct meson_drm *priv)
 
 static int meson_gxm_afbcd_reset(struct meson_drm *priv)
 {
-	writel_relaxed(VIU_SW_RESET_OSD1_AFBCD,
-		       priv->io_base + _REG(VIU_SW_RESET));
-	writel_relaxed(0, priv->io_base + _REG(VIU_SW_RESET));
+	meson_rdma_writel(priv, VIU_SW_RESET_OSD1_AFBCD, VIU_SW_RESET);
+	meson_rdma_writel(priv, 0, VIU_SW_RESET);
 
 	return 0;
 }
 
 static int meson_gxm_afbcd_enable(struct meson_drm *priv)
 {
-	writel_relaxed(FIELD_PREP(OSD1_AFBCD_ID_FIFO_THRD, 0x40) |
-		       OSD1_AFBCD_DEC_ENABLE,
-		       priv->io_base + _REG(OSD1_AFBCD_ENABLE));
+	meson_rdma_writel(priv, FIELD_PREP(OSD1_AFBCD_ID_FIFO_THRD, 0x40) |
+			  OSD1_AFBCD_DEC_ENABLE,
+			  OSD1_AFBCD_ENABLE);
 
 	return 0;
 }
 
 static int meson_gxm_afbcd_disable(struct meson_drm *priv)
 {
-	writel_bits_relaxed(OSD1_AFBCD_DEC_ENABLE, 0,
-			    priv->io_base + _REG(OSD1_AFBCD_ENABLE));
+	meson_rdma_writel_bits(priv, OSD1_AFBCD_DEC_ENABLE, 0,
+			       OSD1_AFBCD_ENABLE);
 
 	return 0;
 }
@@ -125,21 +124,21 @@ static int meson_gxm_afbcd_setup(struct meson_drm *priv)
 	if (priv->afbcd.modifier & AFBC_FORMAT_MOD_SPLIT)
 		mode |= OSD1_AFBCD_HREG_BLOCK_SPLIT;
 
-	writel_relaxed(mode, priv->io_base + _REG(OSD1_AFBCD_MODE));
+	meson_rdma_writel(priv, mode, OSD1_AFBCD_MODE);
 
-	writel_relaxed(FIELD_PREP(OSD1_AFBCD_HREG_VSIZE_IN,
-				  priv->viu.osd1_width) |
-		       FIELD_PREP(OSD1_AFBCD_HREG_HSIZE_IN,
-				  priv->viu.osd1_height),
-		       priv->io_base + _REG(OSD1_AFBCD_SIZE_IN));
+	meson_rdma_writel(priv, FIELD_PREP(OSD1_AFBCD_HREG_VSIZE_IN,
+					   priv->viu.osd1_width) |
+			  FIELD_PREP(OSD1_AFBCD_HREG_HSIZE_IN,
+				     priv->viu.osd1_height),
+			  OSD1_AFBCD_SIZE_IN);
 
-	writel_relaxed(priv->viu.osd1_addr >> 4,
-		       priv->io_base + _REG(OSD1_AFBCD_HDR_PTR));
-	writel_relaxed(priv->viu.osd1_addr >> 4,
-		       priv->io_base + _REG(OSD1_AFBCD_FRAME_PTR));
+	meson_rdma_writel(priv, priv->viu.osd1_addr >> 4,
+			  OSD1_AFBCD_HDR_PTR);
+	meson_rdma_writel(priv, priv->viu.osd1_addr >> 4,
+			  OSD1_AFBCD_FRAME_PTR);
 	/* TOFIX: bits 31:24 are not documented, nor the meaning of 0xe4 */
-	writel_relaxed((0xe4 << 24) | (priv->viu.osd1_addr & 0xffffff),
-		       priv->io_base + _REG(OSD1_AFBCD_CHROMA_PTR));
+	meson_rdma_writel(priv, (0xe4 << 24) | (priv->viu.osd1_addr & 0xffffff),
+			  OSD1_AFBCD_CHROMA_PTR);
 
 	if (priv->viu.osd1_width <= 128)
 		conv_lbuf_len = 32;
@@ -154,18 +153,17 @@ static int meson_gxm_afbcd_setup(struct meson_drm *priv)
 	else
 		conv_lbuf_len = 1024;
 
-	writel_relaxed(conv_lbuf_len,
-		       priv->io_base + _REG(OSD1_AFBCD_CONV_CTRL));
+	meson_rdma_writel(priv, conv_lbuf_len, OSD1_AFBCD_CONV_CTRL);
 
-	writel_relaxed(FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_BGN_H, 0) |
-		       FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_END_H,
-				  priv->viu.osd1_width - 1),
-		       priv->io_base + _REG(OSD1_AFBCD_PIXEL_HSCOPE));
+	meson_rdma_writel(priv, FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_BGN_H, 0) |
+			  FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_END_H,
+				     priv->viu.osd1_width - 1),
+			  OSD1_AFBCD_PIXEL_HSCOPE);
 
-	writel_relaxed(FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_BGN_V, 0) |
-		       FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_END_V,
-				  priv->viu.osd1_height - 1),
-		       priv->io_base + _REG(OSD1_AFBCD_PIXEL_VSCOPE));
+	meson_rdma_writel(priv, FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_BGN_V, 0) |
+			  FIELD_PREP(OSD1_AFBCD_DEC_PIXEL_END_V,
+				     priv->viu.osd1_height - 1),
+			  OSD1_AFBCD_PIXEL_VSCOPE);
 
 	return 0;
 }
@@ -271,14 +269,6 @@ static bool meson_g12a_afbcd_supported_fmt(u64 modifier, uint32_t format)
 
 static int meson_g12a_afbcd_init(struct meson_drm *priv)
 {
-	int ret;
-
-	ret = meson_rdma_init(priv);
-	if (ret)
-		return ret;
-
-	meson_rdma_setup(priv);
-
 	/* Handle AFBC Decoder reset manually */
 	writel_bits_relaxed(MALI_AFBCD_MANUAL_RESET, MALI_AFBCD_MANUAL_RESET,
 			    priv->io_base + _REG(MALI_AFBCD_TOP_CTRL));
@@ -288,40 +278,35 @@ static int meson_g12a_afbcd_init(struct meson_drm *priv)
 
 static int meson_g12a_afbcd_reset(struct meson_drm *priv)
 {
-	meson_rdma_reset(priv);
-
-	meson_rdma_writel_sync(priv, VIU_SW_RESET_G12A_AFBC_ARB |
-			       VIU_SW_RESET_G12A_OSD1_AFBCD,
-			       VIU_SW_RESET);
-	meson_rdma_writel_sync(priv, 0, VIU_SW_RESET);
+	meson_rdma_writel(priv, VIU_SW_RESET_G12A_AFBC_ARB |
+			  VIU_SW_RESET_G12A_OSD1_AFBCD,
+			  VIU_SW_RESET);
+	meson_rdma_writel(priv, 0, VIU_SW_RESET);
 
 	return 0;
 }
 
 static int meson_g12a_afbcd_enable(struct meson_drm *priv)
 {
-	meson_rdma_writel_sync(priv, VPU_MAFBC_IRQ_SURFACES_COMPLETED |
-			       VPU_MAFBC_IRQ_CONFIGURATION_SWAPPED |
-			       VPU_MAFBC_IRQ_DECODE_ERROR |
-			       VPU_MAFBC_IRQ_DETILING_ERROR,
-			       VPU_MAFBC_IRQ_MASK);
-
-	meson_rdma_writel_sync(priv, VPU_MAFBC_S0_ENABLE,
-			       VPU_MAFBC_SURFACE_CFG);
+	meson_rdma_writel(priv, VPU_MAFBC_IRQ_SURFACES_COMPLETED |
+			  VPU_MAFBC_IRQ_CONFIGURATION_SWAPPED |
+			  VPU_MAFBC_IRQ_DECODE_ERROR |
+			  VPU_MAFBC_IRQ_DETILING_ERROR,
+			  VPU_MAFBC_IRQ_MASK);
 
-	meson_rdma_writel_sync(priv, VPU_MAFBC_DIRECT_SWAP,
-			       VPU_MAFBC_COMMAND);
+	meson_rdma_writel(priv, VPU_MAFBC_S0_ENABLE,
+			  VPU_MAFBC_SURFACE_CFG);
 
-	/* This will enable the RDMA replaying the register writes on vsync */
-	meson_rdma_flush(priv);
+	meson_rdma_writel(priv, VPU_MAFBC_DIRECT_SWAP,
+			  VPU_MAFBC_COMMAND);
 
 	return 0;
 }
 
 static int meson_g12a_afbcd_disable(struct meson_drm *priv)
 {
-	writel_bits_relaxed(VPU_MAFBC_S0_ENABLE, 0,
-			    priv->io_base + _REG(VPU_MAFBC_SURFACE_CFG));
+	meson_rdma_writel_bits(priv, VPU_MAFBC_S0_ENABLE, 0,
+			  VPU_MAFBC_SURFACE_CFG);
 
 	return 0;
 }
@@ -344,36 +329,36 @@ static int meson_g12a_afbcd_setup(struct meson_drm *priv)
 		AFBC_FORMAT_MOD_BLOCK_SIZE_32x8)
 		format |= FIELD_PREP(VPU_MAFBC_SUPER_BLOCK_ASPECT, 1);
 
-	meson_rdma_writel_sync(priv, format,
-			       VPU_MAFBC_FORMAT_SPECIFIER_S0);
-
-	meson_rdma_writel_sync(priv, priv->viu.osd1_addr,
-			       VPU_MAFBC_HEADER_BUF_ADDR_LOW_S0);
-	meson_rdma_writel_sync(priv, 0,
-			       VPU_MAFBC_HEADER_BUF_ADDR_HIGH_S0);
-
-	meson_rdma_writel_sync(priv, priv->viu.osd1_width,
-			       VPU_MAFBC_BUFFER_WIDTH_S0);
-	meson_rdma_writel_sync(priv, ALIGN(priv->viu.osd1_height, 32),
-			       VPU_MAFBC_BUFFER_HEIGHT_S0);
-
-	meson_rdma_writel_sync(priv, 0,
-			       VPU_MAFBC_BOUNDING_BOX_X_START_S0);
-	meson_rdma_writel_sync(priv, priv->viu.osd1_width - 1,
-			       VPU_MAFBC_BOUNDING_BOX_X_END_S0);
-	meson_rdma_writel_sync(priv, 0,
-			       VPU_MAFBC_BOUNDING_BOX_Y_START_S0);
-	meson_rdma_writel_sync(priv, priv->viu.osd1_height - 1,
-			       VPU_MAFBC_BOUNDING_BOX_Y_END_S0);
-
-	meson_rdma_writel_sync(priv, MESON_G12A_AFBCD_OUT_ADDR,
-			       VPU_MAFBC_OUTPUT_BUF_ADDR_LOW_S0);
-	meson_rdma_writel_sync(priv, 0,
-			       VPU_MAFBC_OUTPUT_BUF_ADDR_HIGH_S0);
-
-	meson_rdma_writel_sync(priv, priv->viu.osd1_width *
-			       (meson_g12a_afbcd_bpp(priv->afbcd.format) / 8),
-			       VPU_MAFBC_OUTPUT_BUF_STRIDE_S0);
+	meson_rdma_writel(priv, format,
+			  VPU_MAFBC_FORMAT_SPECIFIER_S0);
+
+	meson_rdma_writel(priv, priv->viu.osd1_addr,
+			  VPU_MAFBC_HEADER_BUF_ADDR_LOW_S0);
+	meson_rdma_writel(priv, 0,
+			  VPU_MAFBC_HEADER_BUF_ADDR_HIGH_S0);
+
+	meson_rdma_writel(priv, priv->viu.osd1_width,
+			  VPU_MAFBC_BUFFER_WIDTH_S0);
+	meson_rdma_writel(priv, ALIGN(priv->viu.osd1_height, 32),
+			  VPU_MAFBC_BUFFER_HEIGHT_S0);
+
+	meson_rdma_writel(priv, 0,
+			  VPU_MAFBC_BOUNDING_BOX_X_START_S0);
+	meson_rdma_writel(priv, priv->viu.osd1_width - 1,
+			  VPU_MAFBC_BOUNDING_BOX_X_END_S0);
+	meson_rdma_writel(priv, 0,
+			  VPU_MAFBC_BOUNDING_BOX_Y_START_S0);
+	meson_rdma_writel(priv, priv->viu.osd1_height - 1,
+			  VPU_MAFBC_BOUNDING_BOX_Y_END_S0);
+
+	meson_rdma_writel(priv, MESON_G12A_AFBCD_OUT_ADDR,
+			  VPU_MAFBC_OUTPUT_BUF_ADDR_LOW_S0);
+	meson_rdma_writel(priv, 0,
+			  VPU_MAFBC_OUTPUT_BUF_ADDR_HIGH_S0);
+
+	meson_rdma_writel(priv, priv->viu.osd1_width *
+			  (meson_g12a_afbcd_bpp(priv->afbcd.format) / 8),
+			  VPU_MAFBC_OUTPUT_BUF_STRIDE_S0);
 
 	return 0;
 }
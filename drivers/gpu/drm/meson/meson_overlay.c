@@ -7,6 +7,8 @@
 
 #define DEBUG
 #include <linux/bitfield.h>
+#include <linux/dma-fence.h>
+#include <linux/soc/amlogic/meson-canvas.h>
 
 #include <drm/drm_atomic.h>
 #include <drm/drm_atomic_helper.h>
@@ -15,9 +17,12 @@
 #include <drm/drm_plane_helper.h>
 #include <drm/drm_gem_cma_helper.h>
 #include <drm/drm_fb_cma_helper.h>
+#include <drm/drm_flip_work.h>
 #include <drm/drm_gem_framebuffer_helper.h>
+#include <drm/drm_vblank.h>
 
 #include "meson_overlay.h"
+#include "meson_rdma.h"
 #include "meson_registers.h"
 #include "meson_viu.h"
 #include "meson_vpp.h"
@@ -158,6 +163,21 @@
 struct meson_overlay {
 	struct drm_plane base;
 	struct meson_drm *priv;
+
+	/* Asynchronous flip waiting for its fence and the next VSYNC */
+	bool flip_pending;
+	struct dma_fence *flip_fence;
+	struct drm_pending_vblank_event *flip_event;
+	struct drm_framebuffer *flip_fb;
+	uint32_t flip_addr[3];
+
+	/*
+	 * Framebuffer VD1 reads since the last asynchronous flip, the plane
+	 * state no longer holds it. References are dropped one VSYNC after
+	 * the HW switched away from the buffer.
+	 */
+	struct drm_framebuffer *scanout_fb;
+	struct drm_flip_work unref_work;
 };
 #define to_meson_overlay(x) container_of(x, struct meson_overlay, base)
 
@@ -432,8 +452,6 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 
 	priv->viu.vpp_postblend_vd1_h_start_end = VD_H_START(hsc_startp) |
 						  VD_H_END(hsc_endp);
-	priv->viu.vpp_blend_vd2_h_start_end = VD_H_START(hd_start_lines) |
-					      VD_H_END(hd_end_lines);
 	priv->viu.vpp_hsc_region12_startp = VD_REGION13_END(0) |
 					    VD_REGION24_START(hsc_startp);
 	priv->viu.vpp_hsc_region34_startp =
@@ -450,9 +468,6 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 
 	priv->viu.vpp_postblend_vd1_v_start_end = VD_V_START(vsc_startp) |
 						  VD_V_END(vsc_endp);
-	priv->viu.vpp_blend_vd2_v_start_end =
-				VD2_V_START((vd_end_lines + 1) >> 1) |
-				VD2_V_END(vd_end_lines);
 
 	priv->viu.vpp_vsc_region12_startp = 0;
 	priv->viu.vpp_vsc_region34_startp =
@@ -462,6 +477,275 @@ static void meson_overlay_setup_scaler_params(struct meson_drm *priv,
 	priv->viu.vpp_vsc_start_phase_step = ratio_y << 6;
 }
 
+/*
+ * Video frames flipped alone on VD1 don't go through a full commit: the
+ * new buffer addresses are queued with the plane fence and the VSYNC IRQ
+ * programs them into the scanned out canvases once the fence signaled.
+ * Only the buffers change, so the frame layout must match the current one.
+ */
+static int meson_overlay_atomic_async_check(struct drm_plane *plane,
+					    struct drm_plane_state *state)
+{
+	struct drm_plane_state *old_state = plane->state;
+	struct drm_framebuffer *old_fb = old_state->fb;
+	struct drm_framebuffer *fb = state->fb;
+	unsigned int i;
+
+	if (!fb || !old_fb || !state->visible || !old_state->visible ||
+	    state->crtc != old_state->crtc)
+		return -EINVAL;
+
+	/* The AFBC header and body addresses are programmed by the RDMA */
+	if (fb->modifier != DRM_FORMAT_MOD_LINEAR ||
+	    old_fb->modifier != DRM_FORMAT_MOD_LINEAR)
+		return -EINVAL;
+
+	if (fb->format != old_fb->format ||
+	    fb->width != old_fb->width || fb->height != old_fb->height)
+		return -EINVAL;
+
+	for (i = 0 ; i < fb->format->num_planes ; ++i)
+		if (fb->pitches[i] != old_fb->pitches[i])
+			return -EINVAL;
+
+	if (!drm_rect_equals(&state->src, &old_state->src) ||
+	    !drm_rect_equals(&state->dst, &old_state->dst))
+		return -EINVAL;
+
+	/* The VPP matrix is only reprogrammed by a full commit */
+	if (state->color_encoding != old_state->color_encoding ||
+	    state->color_range != old_state->color_range)
+		return -EINVAL;
+
+	return 0;
+}
+
+static void meson_overlay_unref_worker(struct drm_flip_work *work, void *val)
+{
+	drm_framebuffer_put(val);
+}
+
+/* Called with the event_lock held, when VD1 stops using scanout_fb */
+static void meson_overlay_release_scanout(struct meson_overlay *meson_overlay)
+{
+	if (!meson_overlay->scanout_fb)
+		return;
+
+	drm_flip_work_queue(&meson_overlay->unref_work,
+			    meson_overlay->scanout_fb);
+	meson_overlay->scanout_fb = NULL;
+}
+
+/**
+ * meson_overlay_flip_cancel() - drop the pending asynchronous VD1 flip
+ * @priv: the meson DRM private data
+ *
+ * Called with the event_lock held when the flip has been superseded. The
+ * frame is never shown: its event is only sent on the next vblank, like
+ * for any flip that misses its frame, or right away if the CRTC is off.
+ */
+void meson_overlay_flip_cancel(struct meson_drm *priv)
+{
+	struct meson_overlay *meson_overlay =
+				to_meson_overlay(priv->overlay_plane);
+
+	if (!meson_overlay->flip_pending)
+		return;
+
+	if (meson_overlay->flip_fence) {
+		dma_fence_put(meson_overlay->flip_fence);
+		meson_overlay->flip_fence = NULL;
+	}
+
+	if (meson_overlay->flip_event) {
+		if (!drm_crtc_vblank_get(priv->crtc))
+			drm_crtc_arm_vblank_event(priv->crtc,
+						  meson_overlay->flip_event);
+		else
+			drm_crtc_send_vblank_event(priv->crtc,
+						   meson_overlay->flip_event);
+		meson_overlay->flip_event = NULL;
+	}
+
+	/* Never reached the HW, but only drop it from process context */
+	if (meson_overlay->flip_fb) {
+		drm_flip_work_queue(&meson_overlay->unref_work,
+				    meson_overlay->flip_fb);
+		meson_overlay->flip_fb = NULL;
+	}
+
+	meson_overlay->flip_pending = false;
+}
+
+static void meson_overlay_atomic_async_update(struct drm_plane *plane,
+					      struct drm_plane_state *new_state)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+	struct drm_pending_vblank_event *event = NULL;
+	struct meson_drm *priv = meson_overlay->priv;
+	struct drm_framebuffer *fb = new_state->fb;
+	struct drm_crtc_state *crtc_state;
+	struct drm_gem_cma_object *gem;
+	unsigned long flags;
+	unsigned int i;
+
+	DRM_DEBUG_DRIVER("\n");
+
+	/* The flip event is sent from the VSYNC IRQ once it is applied */
+	crtc_state = drm_atomic_get_new_crtc_state(new_state->state,
+						   new_state->crtc);
+	if (crtc_state) {
+		event = crtc_state->event;
+		crtc_state->event = NULL;
+	}
+
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+
+	/*
+	 * The plane state hands the displayed framebuffer over to the async
+	 * state, which drops it right after this commit: keep it until the
+	 * flip has been applied by the HW.
+	 */
+	if (!meson_overlay->scanout_fb) {
+		meson_overlay->scanout_fb = plane->state->fb;
+		drm_framebuffer_get(meson_overlay->scanout_fb);
+	}
+
+	meson_overlay_flip_cancel(priv);
+
+	swap(plane->state->fb, new_state->fb);
+	drm_framebuffer_get(fb);
+	meson_overlay->flip_fb = fb;
+
+	for (i = 0 ; i < fb->format->num_planes ; ++i) {
+		gem = drm_fb_cma_get_gem_obj(fb, i);
+		meson_overlay->flip_addr[i] = gem->paddr + fb->offsets[i];
+	}
+
+	/* Keep the in-fence, it is checked on each VSYNC until signaled */
+	meson_overlay->flip_fence = new_state->fence;
+	new_state->fence = NULL;
+	meson_overlay->flip_event = event;
+	meson_overlay->flip_pending = true;
+
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+}
+
+/**
+ * meson_overlay_async_check() - check if a commit is a VD1 only flip
+ * @priv: the meson DRM private data
+ * @state: the atomic state to check
+ *
+ * Returns 0 if @state only flips the buffer of the VD1 overlay plane and
+ * can be applied asynchronously, an error code otherwise.
+ */
+int meson_overlay_async_check(struct meson_drm *priv,
+			      struct drm_atomic_state *state)
+{
+	struct drm_plane_state *old_plane_state = NULL;
+	struct drm_plane_state *new_plane_state = NULL;
+	struct drm_crtc_state *crtc_state;
+	struct drm_plane *plane;
+	struct drm_crtc *crtc;
+	int i, n_planes = 0;
+
+	for_each_new_crtc_in_state(state, crtc, crtc_state, i) {
+		if (drm_atomic_crtc_needs_modeset(crtc_state) ||
+		    crtc_state->color_mgmt_changed)
+			return -EINVAL;
+	}
+
+	for_each_oldnew_plane_in_state(state, plane, old_plane_state,
+				       new_plane_state, i) {
+		if (plane != priv->overlay_plane)
+			return -EINVAL;
+		n_planes++;
+	}
+
+	if (n_planes != 1)
+		return -EINVAL;
+
+	/* Don't get overridden by a previous commit still being applied */
+	if (old_plane_state->commit &&
+	    !try_wait_for_completion(&old_plane_state->commit->hw_done))
+		return -EBUSY;
+
+	return meson_overlay_atomic_async_check(priv->overlay_plane,
+						new_plane_state);
+}
+
+/**
+ * meson_overlay_flip_vsync() - apply the pending asynchronous VD1 flip
+ * @priv: the meson DRM private data
+ *
+ * Called from the VSYNC IRQ with the event_lock held, the flip is left
+ * pending until its fence has signaled.
+ */
+void meson_overlay_flip_vsync(struct meson_drm *priv)
+{
+	struct meson_overlay *meson_overlay =
+				to_meson_overlay(priv->overlay_plane);
+
+	/* Release what was queued before the previous VSYNC */
+	drm_flip_work_commit(&meson_overlay->unref_work, system_unbound_wq);
+
+	if (!meson_overlay->flip_pending)
+		return;
+
+	if (meson_overlay->flip_fence) {
+		if (!dma_fence_is_signaled(meson_overlay->flip_fence))
+			return;
+
+		dma_fence_put(meson_overlay->flip_fence);
+		meson_overlay->flip_fence = NULL;
+	}
+
+	switch (priv->viu.vd1_planes) {
+	case 3:
+		priv->viu.vd1_addr2 = meson_overlay->flip_addr[2];
+		meson_canvas_config(priv->canvas, priv->canvas_id_vd1_2,
+				    priv->viu.vd1_addr2,
+				    priv->viu.vd1_stride2,
+				    priv->viu.vd1_height2,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	/* fallthrough */
+	case 2:
+		priv->viu.vd1_addr1 = meson_overlay->flip_addr[1];
+		meson_canvas_config(priv->canvas, priv->canvas_id_vd1_1,
+				    priv->viu.vd1_addr1,
+				    priv->viu.vd1_stride1,
+				    priv->viu.vd1_height1,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	/* fallthrough */
+	case 1:
+		priv->viu.vd1_addr0 = meson_overlay->flip_addr[0];
+		meson_canvas_config(priv->canvas, priv->canvas_id_vd1_0,
+				    priv->viu.vd1_addr0,
+				    priv->viu.vd1_stride0,
+				    priv->viu.vd1_height0,
+				    MESON_CANVAS_WRAP_NONE,
+				    MESON_CANVAS_BLKMODE_LINEAR,
+				    MESON_CANVAS_ENDIAN_SWAP64);
+	}
+
+	/* VD1 moves to the new buffer with this frame */
+	meson_overlay_release_scanout(meson_overlay);
+	meson_overlay->scanout_fb = meson_overlay->flip_fb;
+	meson_overlay->flip_fb = NULL;
+
+	if (meson_overlay->flip_event) {
+		drm_crtc_send_vblank_event(priv->crtc,
+					   meson_overlay->flip_event);
+		meson_overlay->flip_event = NULL;
+	}
+
+	meson_overlay->flip_pending = false;
+}
+
 static void meson_overlay_atomic_update(struct drm_plane *plane,
 					struct drm_plane_state *old_state)
 {
@@ -479,6 +763,15 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 
 	spin_lock_irqsave(&priv->drm->event_lock, flags);
 
+	/* This commit supersedes any asynchronous flip still pending */
+	meson_overlay_flip_cancel(priv);
+	meson_overlay_release_scanout(meson_overlay);
+
+	/* Fill the canvases not scanned out, the RDMA switches over on VSYNC */
+	swap(priv->canvas_id_vd1_0, priv->canvas_id_vd1_0_scanout);
+	swap(priv->canvas_id_vd1_1, priv->canvas_id_vd1_1_scanout);
+	swap(priv->canvas_id_vd1_2, priv->canvas_id_vd1_2_scanout);
+
 	if ((fb->modifier & DRM_FORMAT_MOD_AMLOGIC_FBC(0)) ==
 			    DRM_FORMAT_MOD_AMLOGIC_FBC(0)) {
 		priv->viu.vd1_afbc = true;
@@ -540,6 +833,9 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 	/* Setup scaler params */
 	meson_overlay_setup_scaler_params(priv, plane, interlace_mode);
 
+	priv->viu.vd1_color_encoding = state->color_encoding;
+	priv->viu.vd1_color_range = state->color_range;
+
 	priv->viu.vd1_if0_repeat_loop = 0;
 	priv->viu.vd1_if0_luma0_rpt_pat = interlace_mode ? 8 : 0;
 	priv->viu.vd1_if0_chroma0_rpt_pat = interlace_mode ? 8 : 0;
@@ -707,6 +1003,7 @@ static void meson_overlay_atomic_update(struct drm_plane *plane,
 	}
 
 	priv->viu.vd1_enabled = true;
+	priv->viu.vd1_commit = true;
 
 	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
 
@@ -718,20 +1015,24 @@ static void meson_overlay_atomic_disable(struct drm_plane *plane,
 {
 	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
 	struct meson_drm *priv = meson_overlay->priv;
+	unsigned long flags;
 
 	DRM_DEBUG_DRIVER("\n");
 
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+	meson_overlay_flip_cancel(priv);
+	meson_overlay_release_scanout(meson_overlay);
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+
 	priv->viu.vd1_enabled = false;
 
 	/* Disable VD1 */
 	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
-		writel_relaxed(0, priv->io_base + _REG(VD1_BLEND_SRC_CTRL));
-		writel_relaxed(0, priv->io_base + _REG(VD2_BLEND_SRC_CTRL));
-		writel_relaxed(0, priv->io_base + _REG(VD1_IF0_GEN_REG + 0x17b0));
-		writel_relaxed(0, priv->io_base + _REG(VD2_IF0_GEN_REG + 0x17b0));
+		meson_rdma_writel(priv, 0, VD1_BLEND_SRC_CTRL);
+		meson_rdma_writel(priv, 0, VD1_IF0_GEN_REG + 0x17b0);
 	} else
-		writel_bits_relaxed(VPP_VD1_POSTBLEND | VPP_VD1_PREBLEND, 0,
-				    priv->io_base + _REG(VPP_MISC));
+		meson_rdma_writel_bits(priv, VPP_VD1_POSTBLEND | VPP_VD1_PREBLEND,
+				       0, VPP_MISC);
 
 }
 
@@ -739,6 +1040,8 @@ static const struct drm_plane_helper_funcs meson_overlay_helper_funcs = {
 	.atomic_check	= meson_overlay_atomic_check,
 	.atomic_disable	= meson_overlay_atomic_disable,
 	.atomic_update	= meson_overlay_atomic_update,
+	.atomic_async_check	= meson_overlay_atomic_async_check,
+	.atomic_async_update	= meson_overlay_atomic_async_update,
 	.prepare_fb	= drm_gem_fb_prepare_fb,
 };
 
@@ -759,11 +1062,34 @@ static bool meson_overlay_format_mod_supported(struct drm_plane *plane,
 	return false;
 }
 
+/* YCbCr buffers default to BT.709 limited range, matching the VPP */
+static void meson_overlay_reset(struct drm_plane *plane)
+{
+	drm_atomic_helper_plane_reset(plane);
+
+	if (plane->state) {
+		plane->state->color_encoding = DRM_COLOR_YCBCR_BT709;
+		plane->state->color_range = DRM_COLOR_YCBCR_LIMITED_RANGE;
+	}
+}
+
+static void meson_overlay_destroy(struct drm_plane *plane)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+
+	/* No more VSYNC to release what the last disable queued */
+	drm_flip_work_commit(&meson_overlay->unref_work, system_unbound_wq);
+	flush_work(&meson_overlay->unref_work.worker);
+	drm_flip_work_cleanup(&meson_overlay->unref_work);
+
+	drm_plane_cleanup(plane);
+}
+
 static const struct drm_plane_funcs meson_overlay_funcs = {
 	.update_plane		= drm_atomic_helper_update_plane,
 	.disable_plane		= drm_atomic_helper_disable_plane,
-	.destroy		= drm_plane_cleanup,
-	.reset			= drm_atomic_helper_plane_reset,
+	.destroy		= meson_overlay_destroy,
+	.reset			= meson_overlay_reset,
 	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
 	.atomic_destroy_state	= drm_atomic_helper_plane_destroy_state,
 	.format_mod_supported   = meson_overlay_format_mod_supported,
@@ -782,6 +1108,11 @@ static const uint32_t supported_drm_formats[] = {
 	DRM_FORMAT_YUV420_10BIT, /* Amlogic FBC Only */
 };
 
+/*
+ * The VD1 decoder only handles the Amlogic FBC layouts produced by the video
+ * decoder, the Mali AFBC decoder of GXM/G12A can only feed the OSD planes so
+ * ARM AFBC buffers must be scanned out through OSD1 instead.
+ */
 static const uint64_t format_modifiers[] = {
 	DRM_FORMAT_MOD_AMLOGIC_FBC(DRM_FORMAT_MOD_AMLOGIC_FBC_LAYOUT_SCATTER |
 				   DRM_FORMAT_MOD_AMLOGIC_FBC_MEM_SAVING),
@@ -807,6 +1138,9 @@ int meson_overlay_create(struct meson_drm *priv)
 	meson_overlay->priv = priv;
 	plane = &meson_overlay->base;
 
+	drm_flip_work_init(&meson_overlay->unref_work, "meson_overlay_unref",
+			   meson_overlay_unref_worker);
+
 	drm_universal_plane_init(priv->drm, plane, 0xFF,
 				 &meson_overlay_funcs,
 				 supported_drm_formats,
@@ -816,6 +1150,15 @@ int meson_overlay_create(struct meson_drm *priv)
 
 	drm_plane_helper_add(plane, &meson_overlay_helper_funcs);
 
+	drm_plane_create_color_properties(plane,
+					  BIT(DRM_COLOR_YCBCR_BT601) |
+					  BIT(DRM_COLOR_YCBCR_BT709) |
+					  BIT(DRM_COLOR_YCBCR_BT2020),
+					  BIT(DRM_COLOR_YCBCR_LIMITED_RANGE) |
+					  BIT(DRM_COLOR_YCBCR_FULL_RANGE),
+					  DRM_COLOR_YCBCR_BT709,
+					  DRM_COLOR_YCBCR_LIMITED_RANGE);
+
 	/* For now, VD Overlay plane is always on the back */
 	drm_plane_create_zpos_immutable_property(plane, 0);
 
@@ -825,3 +1168,251 @@ int meson_overlay_create(struct meson_drm *priv)
 
 	return 0;
 }
+
+/*
+ * VD2 is blended in the VPP postblend on top of VD1, but the single video
+ * scaler of the VPP only sits on the VD1 path: VD2 can crop and position
+ * its source, but it is scanned out unscaled on progressive modes only.
+ */
+
+static int meson_overlay_vd2_atomic_check(struct drm_plane *plane,
+					  struct drm_plane_state *state)
+{
+	struct drm_crtc_state *crtc_state;
+	int ret;
+
+	if (!state->crtc)
+		return 0;
+
+	crtc_state = drm_atomic_get_crtc_state(state->state, state->crtc);
+	if (IS_ERR(crtc_state))
+		return PTR_ERR(crtc_state);
+
+	ret = drm_atomic_helper_check_plane_state(state, crtc_state,
+						  DRM_PLANE_HELPER_NO_SCALING,
+						  DRM_PLANE_HELPER_NO_SCALING,
+						  true, true);
+	if (ret)
+		return ret;
+
+	if (state->visible &&
+	    crtc_state->mode.flags & DRM_MODE_FLAG_INTERLACE) {
+		DRM_DEBUG_KMS("VD2 can't scanout interlaced modes\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Crop of the VD2 source and position in the postblend, there's no scaler */
+static void meson_overlay_setup_vd2_window(struct meson_drm *priv,
+					   struct drm_plane_state *state)
+{
+	unsigned int x_start = state->src.x1 >> 16;
+	unsigned int y_start = state->src.y1 >> 16;
+	unsigned int x_end = (state->src.x2 >> 16) - 1;
+	unsigned int y_end = (state->src.y2 >> 16) - 1;
+
+	DRM_DEBUG("vd2 src %d,%d-%d,%d dst " DRM_RECT_FMT "\n",
+		  x_start, y_start, x_end, y_end, DRM_RECT_ARG(&state->dst));
+
+	priv->viu.vd2_if0_luma_x0 = VD_X_START(x_start) | VD_X_END(x_end);
+	priv->viu.vd2_if0_chroma_x0 = VD_X_START(x_start >> 1) |
+				      VD_X_END(x_end >> 1);
+	priv->viu.vd2_if0_luma_y0 = VD_Y_START(y_start) | VD_Y_END(y_end);
+	priv->viu.vd2_if0_chroma_y0 = VD_Y_START(y_start >> 1) |
+				      VD_Y_END(y_end >> 1);
+
+	priv->viu.viu_vd2_fmt_w = VD_H_WIDTH(x_end - x_start + 1) |
+				  VD_V_WIDTH(x_end / 2 - x_start / 2 + 1);
+
+	priv->viu.vpp_vd2_hdr_in_size = (y_end - y_start + 1) << 16 |
+					(x_end - x_start + 1);
+
+	priv->viu.vpp_blend_vd2_h_start_end = VD_H_START(state->dst.x1) |
+					      VD_H_END(state->dst.x2 - 1);
+	priv->viu.vpp_blend_vd2_v_start_end = VD2_V_START(state->dst.y1) |
+					      VD2_V_END(state->dst.y2 - 1);
+}
+
+static void meson_overlay_vd2_atomic_update(struct drm_plane *plane,
+					    struct drm_plane_state *old_state)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+	struct drm_plane_state *state = plane->state;
+	struct drm_framebuffer *fb = state->fb;
+	struct meson_drm *priv = meson_overlay->priv;
+	struct drm_gem_cma_object *gem;
+	unsigned long flags;
+
+	DRM_DEBUG_DRIVER("\n");
+
+	spin_lock_irqsave(&priv->drm->event_lock, flags);
+
+	/* Fill the canvases not scanned out, the RDMA switches over on VSYNC */
+	swap(priv->canvas_id_vd2_0, priv->canvas_id_vd2_0_scanout);
+	swap(priv->canvas_id_vd2_1, priv->canvas_id_vd2_1_scanout);
+
+	priv->viu.vd2_if0_gen_reg = VD_URGENT_CHROMA |
+				    VD_URGENT_LUMA |
+				    VD_HOLD_LINES(9) |
+				    VD_CHRO_RPT_LASTL_CTRL |
+				    VD_ENABLE;
+	priv->viu.vd2_if0_gen_reg2 = 0;
+
+	switch (fb->format->format) {
+	case DRM_FORMAT_YUYV:
+		priv->viu.vd2_if0_gen_reg |= VD_BYTES_PER_PIXEL(1);
+		priv->viu.vd2_if0_canvas0 =
+					CANVAS_ADDR2(priv->canvas_id_vd2_0) |
+					CANVAS_ADDR1(priv->canvas_id_vd2_0) |
+					CANVAS_ADDR0(priv->canvas_id_vd2_0);
+		priv->viu.viu_vd2_fmt_ctrl = VD_HORZ_Y_C_RATIO(1) | /* /2 */
+					     VD_HORZ_FMT_EN |
+					     VD_VERT_RPT_LINE0 |
+					     VD_VERT_INITIAL_PHASE(12) |
+					     VD_VERT_PHASE_STEP(16) | /* /2 */
+					     VD_VERT_FMT_EN;
+		break;
+	case DRM_FORMAT_NV12:
+	case DRM_FORMAT_NV21:
+		priv->viu.vd2_if0_gen_reg |= VD_SEPARATE_EN;
+		priv->viu.vd2_if0_canvas0 =
+					CANVAS_ADDR2(priv->canvas_id_vd2_1) |
+					CANVAS_ADDR1(priv->canvas_id_vd2_1) |
+					CANVAS_ADDR0(priv->canvas_id_vd2_0);
+		if (fb->format->format == DRM_FORMAT_NV12)
+			priv->viu.vd2_if0_gen_reg2 = VD_COLOR_MAP(1);
+		else
+			priv->viu.vd2_if0_gen_reg2 = VD_COLOR_MAP(2);
+		priv->viu.viu_vd2_fmt_ctrl = VD_HORZ_Y_C_RATIO(1) | /* /2 */
+					     VD_HORZ_FMT_EN |
+					     VD_VERT_RPT_LINE0 |
+					     VD_VERT_INITIAL_PHASE(12) |
+					     VD_VERT_PHASE_STEP(8) | /* /4 */
+					     VD_VERT_FMT_EN;
+		break;
+	}
+
+	meson_overlay_setup_vd2_window(priv, state);
+
+	priv->viu.vd2_color_encoding = state->color_encoding;
+	priv->viu.vd2_color_range = state->color_range;
+
+	/* Update Canvas with buffer address */
+	priv->viu.vd2_planes = fb->format->num_planes;
+
+	switch (priv->viu.vd2_planes) {
+	case 2:
+		gem = drm_fb_cma_get_gem_obj(fb, 1);
+		priv->viu.vd2_addr1 = gem->paddr + fb->offsets[1];
+		priv->viu.vd2_stride1 = fb->pitches[1];
+		priv->viu.vd2_height1 =
+			drm_format_info_plane_height(fb->format,
+						     fb->height, 1);
+	/* fallthrough */
+	case 1:
+		gem = drm_fb_cma_get_gem_obj(fb, 0);
+		priv->viu.vd2_addr0 = gem->paddr + fb->offsets[0];
+		priv->viu.vd2_stride0 = fb->pitches[0];
+		priv->viu.vd2_height0 =
+			drm_format_info_plane_height(fb->format,
+						     fb->height, 0);
+	}
+
+	priv->viu.vd2_enabled = true;
+	priv->viu.vd2_commit = true;
+
+	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
+}
+
+static void meson_overlay_vd2_atomic_disable(struct drm_plane *plane,
+					     struct drm_plane_state *old_state)
+{
+	struct meson_overlay *meson_overlay = to_meson_overlay(plane);
+	struct meson_drm *priv = meson_overlay->priv;
+
+	DRM_DEBUG_DRIVER("\n");
+
+	priv->viu.vd2_enabled = false;
+
+	/* Disable VD2 */
+	meson_vpp_disable_vd2(priv);
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A))
+		meson_rdma_writel(priv, 0, VD2_IF0_GEN_REG + 0x17b0);
+}
+
+static const struct drm_plane_helper_funcs meson_overlay_vd2_helper_funcs = {
+	.atomic_check	= meson_overlay_vd2_atomic_check,
+	.atomic_disable	= meson_overlay_vd2_atomic_disable,
+	.atomic_update	= meson_overlay_vd2_atomic_update,
+	.prepare_fb	= drm_gem_fb_prepare_fb,
+};
+
+static const struct drm_plane_funcs meson_overlay_vd2_funcs = {
+	.update_plane		= drm_atomic_helper_update_plane,
+	.disable_plane		= drm_atomic_helper_disable_plane,
+	.destroy		= drm_plane_cleanup,
+	.reset			= meson_overlay_reset,
+	.atomic_duplicate_state = drm_atomic_helper_plane_duplicate_state,
+	.atomic_destroy_state	= drm_atomic_helper_plane_destroy_state,
+};
+
+static const uint32_t supported_vd2_drm_formats[] = {
+	DRM_FORMAT_YUYV,
+	DRM_FORMAT_NV12,
+	DRM_FORMAT_NV21,
+};
+
+static const uint64_t vd2_format_modifiers[] = {
+	DRM_FORMAT_MOD_LINEAR,
+	DRM_FORMAT_MOD_INVALID,
+};
+
+int meson_overlay_vd2_create(struct meson_drm *priv)
+{
+	struct meson_overlay *meson_overlay;
+	struct drm_plane *plane;
+
+	DRM_DEBUG_DRIVER("\n");
+
+	meson_overlay = devm_kzalloc(priv->drm->dev, sizeof(*meson_overlay),
+				     GFP_KERNEL);
+	if (!meson_overlay)
+		return -ENOMEM;
+
+	meson_overlay->priv = priv;
+	plane = &meson_overlay->base;
+
+	drm_universal_plane_init(priv->drm, plane, 0xFF,
+				 &meson_overlay_vd2_funcs,
+				 supported_vd2_drm_formats,
+				 ARRAY_SIZE(supported_vd2_drm_formats),
+				 vd2_format_modifiers,
+				 DRM_PLANE_TYPE_OVERLAY, "meson_vd2_plane");
+
+	drm_plane_helper_add(plane, &meson_overlay_vd2_helper_funcs);
+
+	/* G12A has no matrix on the VD2 path */
+	if (!meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A))
+		drm_plane_create_color_properties(plane,
+					BIT(DRM_COLOR_YCBCR_BT601) |
+					BIT(DRM_COLOR_YCBCR_BT709) |
+					BIT(DRM_COLOR_YCBCR_BT2020),
+					BIT(DRM_COLOR_YCBCR_LIMITED_RANGE) |
+					BIT(DRM_COLOR_YCBCR_FULL_RANGE),
+					DRM_COLOR_YCBCR_BT709,
+					DRM_COLOR_YCBCR_LIMITED_RANGE);
+
+	/*
+	 * VD2 is always blended on top of VD1 and below the OSD planes, the
+	 * zpos normalization orders it after VD1 since it is created later.
+	 */
+	drm_plane_create_zpos_immutable_property(plane, 0);
+
+	priv->vd2_plane = plane;
+
+	DRM_DEBUG_DRIVER("\n");
+
+	return 0;
+}
@@ -10,5 +10,11 @@
 #include "meson_drv.h"
 
 int meson_overlay_create(struct meson_drm *priv);
+int meson_overlay_vd2_create(struct meson_drm *priv);
+
+int meson_overlay_async_check(struct meson_drm *priv,
+			      struct drm_atomic_state *state);
+void meson_overlay_flip_vsync(struct meson_drm *priv);
+void meson_overlay_flip_cancel(struct meson_drm *priv);
 
 #endif /* __MESON_OVERLAY_H */
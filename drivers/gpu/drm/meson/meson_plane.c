@@ -21,6 +21,7 @@
 #include <drm/drm_plane_helper.h>
 
 #include "meson_plane.h"
+#include "meson_rdma.h"
 #include "meson_registers.h"
 #include "meson_viu.h"
 #include "meson_osd_afbcd.h"
@@ -84,7 +85,9 @@ static int meson_plane_atomic_check(struct drm_plane *plane,
 
 	/*
 	 * Only allow :
-	 * - Upscaling up to 5x, vertical and horizontal
+	 * - Upscaling up to 5x, vertical and horizontal, so a framebuffer
+	 *   at a fraction of the mode resolution (e.g. 1080p on a 2160p
+	 *   mode) is scaled by the OSD scaler instead of the GPU
 	 * - Final coordinates must match crtc size
 	 */
 	return drm_atomic_helper_check_plane_state(state, crtc_state,
@@ -169,6 +172,8 @@ static void meson_plane_atomic_update(struct drm_plane *plane,
 	priv->viu.osd1_ctrl_stat2 = readl(priv->io_base +
 					  _REG(VIU_OSD1_CTRL_STAT2));
 
+	/* Fill the canvas not scanned out, the RDMA switches over on VSYNC */
+	swap(priv->canvas_id_osd1, priv->canvas_id_osd1_scanout);
 	canvas_id_osd1 = priv->canvas_id_osd1;
 
 	/* Set up BLK0 to point to the right canvas */
@@ -283,6 +288,9 @@ static void meson_plane_atomic_update(struct drm_plane *plane,
 
 	vf_phase_step = (vf_phase_step << 4);
 
+	priv->viu.osd_sc_h_upscale = src_w < dst_w;
+	priv->viu.osd_sc_v_upscale = src_h < dst_h;
+
 	/* In interlaced mode, scaler is always active */
 	if (src_h != dst_h || src_w != dst_w) {
 		priv->viu.osd_sc_i_wh_m1 = SCI_WH_M1_W(src_w - 1) |
@@ -386,6 +394,8 @@ static void meson_plane_atomic_update(struct drm_plane *plane,
 	}
 
 	priv->viu.osd1_enabled = true;
+	priv->viu.osd1_commit = true;
+	priv->viu.osd_blend_commit = true;
 
 	spin_unlock_irqrestore(&priv->drm->event_lock, flags);
 }
@@ -401,16 +411,17 @@ static void meson_plane_atomic_disable(struct drm_plane *plane,
 		priv->afbcd.ops->disable(priv);
 	}
 
-	/* Disable OSD1 */
-	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A))
-		writel_bits_relaxed(VIU_OSD1_POSTBLD_SRC_OSD1, 0,
-				    priv->io_base + _REG(OSD1_BLEND_SRC_CTRL));
-	else
-		writel_bits_relaxed(VPP_OSD1_POSTBLEND, 0,
-				    priv->io_base + _REG(VPP_MISC));
+	/* Disable OSD1, OSD2 shares the OSD blender output on G12A */
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		if (!priv->viu.osd2_enabled)
+			meson_rdma_writel_bits(priv, VIU_OSD1_POSTBLD_SRC_OSD1,
+					       0, OSD1_BLEND_SRC_CTRL);
+	} else
+		meson_rdma_writel_bits(priv, VPP_OSD1_POSTBLEND, 0, VPP_MISC);
 
 	meson_plane->enabled = false;
 	priv->viu.osd1_enabled = false;
+	priv->viu.osd_blend_commit = true;
 }
 
 static const struct drm_plane_helper_funcs meson_plane_helper_funcs = {
@@ -552,8 +563,8 @@ int meson_plane_create(struct meson_drm *priv)
 
 	drm_plane_helper_add(plane, &meson_plane_helper_funcs);
 
-	/* For now, OSD Primary plane is always on the front */
-	drm_plane_create_zpos_immutable_property(plane, 1);
+	/* OSD Primary plane is above VD1, below or over OSD2 */
+	drm_plane_create_zpos_property(plane, 1, 1, 2);
 
 	priv->primary_plane = plane;
 
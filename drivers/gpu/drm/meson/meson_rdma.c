@@ -10,6 +10,7 @@
 #include "meson_drv.h"
 #include "meson_registers.h"
 #include "meson_rdma.h"
+#include "meson_trace.h"
 
 /*
  * The VPU embeds a "Register DMA" that can write a sequence of registers
@@ -17,23 +18,42 @@
  * event like VSYNC or a line input counter.
  * The initial implementation handles a single channel (over 8), triggered
  * by the VSYNC irq and does not handle the RDMA irq.
+ * The register writes of a commit are recorded between meson_rdma_begin()
+ * and meson_rdma_flush(), outside of a recording they go straight to the
+ * hardware.
+ * Two lists are used in turn so the next commit can be recorded while the
+ * hardware still owns the list armed by the previous one, a list growing
+ * past its size is reallocated since it was not handed to the hardware yet.
  */
 
 #define RDMA_DESC_SIZE	(sizeof(uint32_t) * 2)
 
+/* Register writes recorded by a single plane update, VD1 being the largest */
+#define RDMA_PLANE_SIZE	(128 * RDMA_DESC_SIZE)
+/* Planes updated through the RDMA: OSD1 and VD1 */
+#define RDMA_PLANES	2
+
 int meson_rdma_init(struct meson_drm *priv)
 {
-	if (!priv->rdma.addr) {
-		/* Allocate a PAGE buffer */
-		priv->rdma.addr =
-			dma_alloc_coherent(priv->dev, SZ_4K,
-					   &priv->rdma.addr_dma,
+	unsigned int i;
+
+	for (i = 0 ; i < ARRAY_SIZE(priv->rdma.addr) ; ++i) {
+		if (priv->rdma.addr[i])
+			continue;
+
+		priv->rdma.size[i] = PAGE_ALIGN(RDMA_PLANES * RDMA_PLANE_SIZE);
+		priv->rdma.addr[i] =
+			dma_alloc_coherent(priv->dev, priv->rdma.size[i],
+					   &priv->rdma.addr_dma[i],
 					   GFP_KERNEL);
-		if (!priv->rdma.addr)
+		if (!priv->rdma.addr[i]) {
+			meson_rdma_free(priv);
 			return -ENOMEM;
+		}
 	}
 
 	priv->rdma.offset = 0;
+	priv->rdma.armed = false;
 
 	writel_relaxed(RDMA_CTRL_SW_RESET,
 		       priv->io_base + _REG(RDMA_CTRL));
@@ -47,16 +67,23 @@ int meson_rdma_init(struct meson_drm *priv)
 
 void meson_rdma_free(struct meson_drm *priv)
 {
-	if (!priv->rdma.addr && !priv->rdma.addr_dma)
+	unsigned int i;
+
+	if (!priv->rdma.addr[0] && !priv->rdma.addr[1])
 		return;
 
 	meson_rdma_stop(priv);
 
-	dma_free_coherent(priv->dev, SZ_4K,
-			  priv->rdma.addr, priv->rdma.addr_dma);
+	for (i = 0 ; i < ARRAY_SIZE(priv->rdma.addr) ; ++i) {
+		if (!priv->rdma.addr[i])
+			continue;
+
+		dma_free_coherent(priv->dev, priv->rdma.size[i],
+				  priv->rdma.addr[i], priv->rdma.addr_dma[i]);
 
-	priv->rdma.addr = NULL;
-	priv->rdma.addr_dma = (dma_addr_t)0;
+		priv->rdma.addr[i] = NULL;
+		priv->rdma.addr_dma[i] = (dma_addr_t)0;
+	}
 }
 
 void meson_rdma_setup(struct meson_drm *priv)
@@ -73,56 +100,141 @@ void meson_rdma_stop(struct meson_drm *priv)
 	writel_bits_relaxed(RDMA_IRQ_CLEAR_CHAN1,
 			    RDMA_IRQ_CLEAR_CHAN1,
 			    priv->io_base + _REG(RDMA_CTRL));
+	writel_bits_relaxed(RDMA_IRQ_CLEAR_CHAN1, 0,
+			    priv->io_base + _REG(RDMA_CTRL));
 
 	/* Stop Channel 1 */
 	writel_bits_relaxed(RDMA_ACCESS_TRIGGER_CHAN1,
 			    FIELD_PREP(RDMA_ACCESS_ADDR_INC_CHAN1,
 				       RDMA_ACCESS_TRIGGER_STOP),
 			    priv->io_base + _REG(RDMA_ACCESS_AUTO));
+
+	priv->rdma.armed = false;
 }
 
-void meson_rdma_reset(struct meson_drm *priv)
+/* The list armed by the last flush is left alone, the other one is used */
+void meson_rdma_begin(struct meson_drm *priv)
 {
-	meson_rdma_stop(priv);
-
 	priv->rdma.offset = 0;
+	priv->rdma.recording = true;
 }
 
-static void meson_rdma_writel(struct meson_drm *priv, uint32_t val,
-			      uint32_t reg)
+/* Double the size of the list being recorded, keeping its content */
+static int meson_rdma_grow(struct meson_drm *priv)
 {
-	if (priv->rdma.offset >= (SZ_4K / RDMA_DESC_SIZE)) {
-		dev_warn_once(priv->dev, "%s: overflow\n", __func__);
-		return;
-	}
+	unsigned int cur = priv->rdma.cur;
+	size_t size = priv->rdma.size[cur] * 2;
+	dma_addr_t addr_dma;
+	uint32_t *addr;
 
-	priv->rdma.addr[priv->rdma.offset++] = reg;
-	priv->rdma.addr[priv->rdma.offset++] = val;
+	addr = dma_alloc_coherent(priv->dev, size, &addr_dma, GFP_KERNEL);
+	if (!addr)
+		return -ENOMEM;
+
+	memcpy(addr, priv->rdma.addr[cur],
+	       priv->rdma.offset * sizeof(uint32_t));
+
+	dma_free_coherent(priv->dev, priv->rdma.size[cur],
+			  priv->rdma.addr[cur], priv->rdma.addr_dma[cur]);
+
+	priv->rdma.addr[cur] = addr;
+	priv->rdma.addr_dma[cur] = addr_dma;
+	priv->rdma.size[cur] = size;
+
+	return 0;
 }
 
 /*
- * This will add the register to the RDMA buffer and write it to the
- * hardware at the same time.
+ * While recording, this will only add the register to the RDMA buffer.
  * When meson_rdma_flush is called, the RDMA will replay the register
- * writes in order.
+ * writes in order on the next VSYNC.
+ * If the list can't grow, the write goes to the register right away
+ * rather than being lost.
  */
-void meson_rdma_writel_sync(struct meson_drm *priv, uint32_t val, uint32_t reg)
+void meson_rdma_writel(struct meson_drm *priv, uint32_t val, uint32_t reg)
 {
-	meson_rdma_writel(priv, val, reg);
+	uint32_t *addr;
 
-	writel_relaxed(val, priv->io_base + _REG(reg));
+	if (!priv->rdma.recording) {
+		writel_relaxed(val, priv->io_base + _REG(reg));
+		return;
+	}
+
+	if (priv->rdma.offset * sizeof(uint32_t) + RDMA_DESC_SIZE >
+	    priv->rdma.size[priv->rdma.cur]) {
+		if (meson_rdma_grow(priv)) {
+			dev_warn_once(priv->dev, "%s: overflow\n", __func__);
+			priv->stats.rdma_overflows++;
+			writel_relaxed(val, priv->io_base + _REG(reg));
+			return;
+		}
+		priv->stats.rdma_grows++;
+	}
+
+	addr = priv->rdma.addr[priv->rdma.cur];
+	addr[priv->rdma.offset++] = reg;
+	addr[priv->rdma.offset++] = val;
 }
 
-void meson_rdma_flush(struct meson_drm *priv)
+/* Value the register will hold once the recorded writes are replayed */
+static uint32_t meson_rdma_readl(struct meson_drm *priv, uint32_t reg)
 {
-	meson_rdma_stop(priv);
+	uint32_t *addr = priv->rdma.addr[priv->rdma.cur];
+	unsigned int i;
+
+	for (i = priv->rdma.offset; i; i -= 2)
+		if (addr[i - 2] == reg)
+			return addr[i - 1];
+
+	return readl_relaxed(priv->io_base + _REG(reg));
+}
+
+void meson_rdma_writel_bits(struct meson_drm *priv, uint32_t mask,
+			    uint32_t val, uint32_t reg)
+{
+	uint32_t cur;
+
+	if (!priv->rdma.recording) {
+		writel_bits_relaxed(mask, val, priv->io_base + _REG(reg));
+		return;
+	}
+
+	cur = meson_rdma_readl(priv, reg);
+	meson_rdma_writel(priv, (cur & ~mask) | (val & mask), reg);
+}
+
+/*
+ * Returns true if the RDMA was armed to replay recorded register writes,
+ * the recorded list is then owned by the hardware until the next flush.
+ */
+bool meson_rdma_flush(struct meson_drm *priv)
+{
+	dma_addr_t addr_dma = priv->rdma.addr_dma[priv->rdma.cur];
+	bool dropped = false;
+
+	priv->rdma.recording = false;
+
+	if (!priv->rdma.offset)
+		return false;
+
+	/* Don't retarget a list still waiting for its VSYNC */
+	if (priv->rdma.armed) {
+		dropped = !meson_rdma_done(priv);
+		meson_rdma_stop(priv);
+	}
+
+	trace_meson_rdma_flush(priv->rdma.offset / 2, dropped);
+	if (dropped)
+		priv->stats.commits_dropped++;
+	priv->stats.commits++;
+	priv->stats.flush_time = ktime_get();
+	priv->stats.flush_late = false;
 
 	/* Start of Channel 1 register writes buffer */
-	writel(priv->rdma.addr_dma,
-	       priv->io_base + _REG(RDMA_AHB_START_ADDR_1));
+	writel(addr_dma, priv->io_base + _REG(RDMA_AHB_START_ADDR_1));
 
 	/* Last byte on Channel 1 register writes buffer */
-	writel(priv->rdma.addr_dma + (priv->rdma.offset * RDMA_DESC_SIZE) - 1,
+	writel(addr_dma + (priv->rdma.offset * sizeof(uint32_t)) - 1,
 	       priv->io_base + _REG(RDMA_AHB_END_ADDR_1));
 
 	/* Trigger Channel 1 on VSYNC event */
@@ -131,5 +243,16 @@ void meson_rdma_flush(struct meson_drm *priv)
 				       RDMA_ACCESS_TRIGGER_VSYNC),
 			    priv->io_base + _REG(RDMA_ACCESS_AUTO));
 
+	priv->rdma.armed = true;
+	priv->rdma.cur ^= 1;
 	priv->rdma.offset = 0;
+
+	return true;
+}
+
+/* The channel keeps replaying on each VSYNC until stopped */
+bool meson_rdma_done(struct meson_drm *priv)
+{
+	return readl_relaxed(priv->io_base + _REG(RDMA_STATUS)) &
+	       RDMA_IRQ_STAT_CHAN1;
 }
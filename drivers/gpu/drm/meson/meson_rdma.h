@@ -12,10 +12,13 @@
 int meson_rdma_init(struct meson_drm *priv);
 void meson_rdma_free(struct meson_drm *priv);
 void meson_rdma_setup(struct meson_drm *priv);
-void meson_rdma_reset(struct meson_drm *priv);
 void meson_rdma_stop(struct meson_drm *priv);
 
-void meson_rdma_writel_sync(struct meson_drm *priv, uint32_t val, uint32_t reg);
-void meson_rdma_flush(struct meson_drm *priv);
+void meson_rdma_begin(struct meson_drm *priv);
+void meson_rdma_writel(struct meson_drm *priv, uint32_t val, uint32_t reg);
+void meson_rdma_writel_bits(struct meson_drm *priv, uint32_t mask,
+			    uint32_t val, uint32_t reg);
+bool meson_rdma_flush(struct meson_drm *priv);
+bool meson_rdma_done(struct meson_drm *priv);
 
 #endif /* __MESON_RDMA_H */
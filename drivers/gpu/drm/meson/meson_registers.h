@@ -442,6 +442,8 @@
 #define VPP_PREBLEND_CURRENT_XY 0x1d24
 #define VPP_POSTBLEND_CURRENT_XY 0x1d25
 #define VPP_MISC 0x1d26
+#define		VPP_POST_FG_OSD2                BIT(4)
+#define		VPP_PRE_FG_OSD2                 BIT(5)
 #define		VPP_PREBLEND_ENABLE             BIT(6)
 #define		VPP_POSTBLEND_ENABLE            BIT(7)
 #define		VPP_OSD2_ALPHA_PREMULT          BIT(8)
@@ -492,6 +494,11 @@
 #define VPP_MATRIX_HL_COLOR 0x1d5d
 #define VPP_MATRIX_PROBE_POS 0x1d5e
 #define VPP_MATRIX_CTRL 0x1d5f
+#define		VPP_MATRIX_VD2_EN               BIT(4)
+#define		VPP_MATRIX_VD1_EN               BIT(5)
+#define		VPP_MATRIX_SEL                  GENMASK(9, 8)
+#define		VPP_MATRIX_SEL_VD1              1
+#define		VPP_MATRIX_SEL_VD2              2
 #define VPP_MATRIX_COEF00_01 0x1d60
 #define VPP_MATRIX_COEF02_10 0x1d61
 #define VPP_MATRIX_COEF11_12 0x1d62
@@ -589,6 +596,21 @@
 #define VPP_OSD_SCALE_COEF 0x1dcd
 #define VPP_INT_LINE_NUM 0x1dce
 
+#define VPP_VD1_MATRIX_COEF00_01 0x3290
+#define VPP_VD1_MATRIX_COEF02_10 0x3291
+#define VPP_VD1_MATRIX_COEF11_12 0x3292
+#define VPP_VD1_MATRIX_COEF20_21 0x3293
+#define VPP_VD1_MATRIX_COEF22 0x3294
+#define VPP_VD1_MATRIX_COEF13_14 0x3295
+#define VPP_VD1_MATRIX_COEF23_24 0x3296
+#define VPP_VD1_MATRIX_COEF15_25 0x3297
+#define VPP_VD1_MATRIX_CLIP 0x3298
+#define VPP_VD1_MATRIX_OFFSET0_1 0x3299
+#define VPP_VD1_MATRIX_OFFSET2 0x329a
+#define VPP_VD1_MATRIX_PRE_OFFSET0_1 0x329b
+#define VPP_VD1_MATRIX_PRE_OFFSET2 0x329c
+#define VPP_VD1_MATRIX_EN_CTRL 0x329d
+
 #define VPP_WRAP_OSD1_MATRIX_COEF00_01 0x3d60
 #define VPP_WRAP_OSD1_MATRIX_COEF02_10 0x3d61
 #define VPP_WRAP_OSD1_MATRIX_COEF11_12 0x3d62
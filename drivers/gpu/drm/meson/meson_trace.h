@@ -0,0 +1,50 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM meson_drm
+
+#if !defined(__MESON_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define __MESON_TRACE_H
+
+#include <linux/tracepoint.h>
+
+/* A commit was recorded and armed for the next VSYNC */
+TRACE_EVENT(meson_rdma_flush,
+	TP_PROTO(unsigned int writes, bool dropped),
+	TP_ARGS(writes, dropped),
+	TP_STRUCT__entry(
+		__field(unsigned int, writes)
+		__field(bool, dropped)
+	),
+	TP_fast_assign(
+		__entry->writes = writes;
+		__entry->dropped = dropped;
+	),
+	TP_printk("writes %u dropped %d", __entry->writes, __entry->dropped)
+);
+
+/* VSYNC IRQ, with the state of the commit waiting for the RDMA */
+TRACE_EVENT(meson_crtc_irq,
+	TP_PROTO(bool pending, bool done, u32 latency_us),
+	TP_ARGS(pending, done, latency_us),
+	TP_STRUCT__entry(
+		__field(bool, pending)
+		__field(bool, done)
+		__field(u32, latency_us)
+	),
+	TP_fast_assign(
+		__entry->pending = pending;
+		__entry->done = done;
+		__entry->latency_us = latency_us;
+	),
+	TP_printk("pending %d done %d latency %uus", __entry->pending,
+		  __entry->done, __entry->latency_us)
+);
+
+#endif /* __MESON_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/gpu/drm/meson
+#define TRACE_INCLUDE_FILE meson_trace
+#include <trace/define_trace.h>
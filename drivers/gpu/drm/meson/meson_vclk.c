@@ -805,76 +805,121 @@ meson_vclk_vic_supported_freq(struct meson_drm *priv, unsigned int phy_freq,
 }
 EXPORT_SYMBOL_GPL(meson_vclk_vic_supported_freq);
 
-static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
-			   unsigned int od1, unsigned int od2, unsigned int od3,
-			   unsigned int vid_pll_div, unsigned int vclk_div,
-			   unsigned int hdmi_tx_div, unsigned int venc_div,
-			   bool hdmi_use_enci, bool vic_alternate_clock)
+static void meson_hdmi_pll_vic_params(struct meson_drm *priv,
+				      unsigned int pll_base_freq,
+				      bool vic_alternate_clock,
+				      unsigned int *m, unsigned int *frac)
 {
-	unsigned int m = 0, frac = 0;
-
-	/* Set HDMI-TX sys clock */
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_SEL_MASK, 0);
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_DIV_MASK, 0);
-	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
-			   CTS_HDMI_SYS_EN, CTS_HDMI_SYS_EN);
+	*m = 0;
+	*frac = 0;
 
-	/* Set HDMI PLL rate */
-	if (!od1 && !od2 && !od3) {
-		meson_hdmi_pll_generic_set(priv, pll_base_freq);
-	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXBB)) {
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXBB)) {
 		switch (pll_base_freq) {
 		case 2970000:
-			m = 0x3d;
-			frac = vic_alternate_clock ? 0xd02 : 0xe00;
+			*m = 0x3d;
+			*frac = vic_alternate_clock ? 0xd02 : 0xe00;
 			break;
 		case 4320000:
-			m = vic_alternate_clock ? 0x59 : 0x5a;
-			frac = vic_alternate_clock ? 0xe8f : 0;
+			*m = vic_alternate_clock ? 0x59 : 0x5a;
+			*frac = vic_alternate_clock ? 0xe8f : 0;
 			break;
 		case 5940000:
-			m = 0x7b;
-			frac = vic_alternate_clock ? 0xa05 : 0xc00;
+			*m = 0x7b;
+			*frac = vic_alternate_clock ? 0xa05 : 0xc00;
 			break;
 		}
-
-		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
 	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXM) ||
 		   meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXL)) {
 		switch (pll_base_freq) {
 		case 2970000:
-			m = 0x7b;
-			frac = vic_alternate_clock ? 0x281 : 0x300;
+			*m = 0x7b;
+			*frac = vic_alternate_clock ? 0x281 : 0x300;
 			break;
 		case 4320000:
-			m = vic_alternate_clock ? 0xb3 : 0xb4;
-			frac = vic_alternate_clock ? 0x347 : 0;
+			*m = vic_alternate_clock ? 0xb3 : 0xb4;
+			*frac = vic_alternate_clock ? 0x347 : 0;
 			break;
 		case 5940000:
-			m = 0xf7;
-			frac = vic_alternate_clock ? 0x102 : 0x200;
+			*m = 0xf7;
+			*frac = vic_alternate_clock ? 0x102 : 0x200;
 			break;
 		}
-
-		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
 	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
 		switch (pll_base_freq) {
 		case 2970000:
-			m = 0x7b;
-			frac = vic_alternate_clock ? 0x140b4 : 0x18000;
+			*m = 0x7b;
+			*frac = vic_alternate_clock ? 0x140b4 : 0x18000;
 			break;
 		case 4320000:
-			m = vic_alternate_clock ? 0xb3 : 0xb4;
-			frac = vic_alternate_clock ? 0x1a3ee : 0;
+			*m = vic_alternate_clock ? 0xb3 : 0xb4;
+			*frac = vic_alternate_clock ? 0x1a3ee : 0;
 			break;
 		case 5940000:
-			m = 0xf7;
-			frac = vic_alternate_clock ? 0x8148 : 0x10000;
+			*m = 0xf7;
+			*frac = vic_alternate_clock ? 0x8148 : 0x10000;
 			break;
 		}
+	}
+}
 
+/*
+ * Only update the fractional part of a running and locked HDMI PLL,
+ * the output dividers and the rest of the clock tree are left untouched
+ * so the encoders keep running while the PLL slews to the new rate.
+ */
+static void meson_hdmi_pll_set_frac(struct meson_drm *priv, unsigned int frac)
+{
+	unsigned int val;
+	int ret = 0;
+
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXBB)) {
+		regmap_update_bits(priv->hhi, HHI_HDMI_PLL_CNTL2, 0x4fff,
+				   frac ? 0x00004000 | frac : 0);
+		ret = regmap_read_poll_timeout(priv->hhi, HHI_HDMI_PLL_CNTL,
+					       val, (val & HDMI_PLL_LOCK),
+					       10, 1000);
+	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXM) ||
+		   meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXL)) {
+		regmap_update_bits(priv->hhi, HHI_HDMI_PLL_CNTL2,
+				   HDMI_FRAC_MAX_GXL - 1, frac);
+		ret = regmap_read_poll_timeout(priv->hhi, HHI_HDMI_PLL_CNTL,
+					       val, (val & HDMI_PLL_LOCK),
+					       10, 1000);
+	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		regmap_write(priv->hhi, HHI_HDMI_PLL_CNTL2, frac);
+		ret = regmap_read_poll_timeout(priv->hhi, HHI_HDMI_PLL_CNTL,
+					       val, ((val & HDMI_PLL_LOCK_G12A)
+						     == HDMI_PLL_LOCK_G12A),
+					       10, 1000);
+	}
+
+	if (ret)
+		pr_warn("HDMI PLL didn't relock after frac update 0x%x\n",
+			frac);
+}
+
+static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
+			   unsigned int od1, unsigned int od2, unsigned int od3,
+			   unsigned int vid_pll_div, unsigned int vclk_div,
+			   unsigned int hdmi_tx_div, unsigned int venc_div,
+			   bool hdmi_use_enci, bool vic_alternate_clock)
+{
+	unsigned int m = 0, frac = 0;
+
+	/* Set HDMI-TX sys clock */
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_SEL_MASK, 0);
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_DIV_MASK, 0);
+	regmap_update_bits(priv->hhi, HHI_HDMI_CLK_CNTL,
+			   CTS_HDMI_SYS_EN, CTS_HDMI_SYS_EN);
+
+	/* Set HDMI PLL rate */
+	if (!od1 && !od2 && !od3) {
+		meson_hdmi_pll_generic_set(priv, pll_base_freq);
+	} else {
+		meson_hdmi_pll_vic_params(priv, pll_base_freq,
+					  vic_alternate_clock, &m, &frac);
 		meson_hdmi_pll_set_params(priv, m, frac, od1, od2, od3);
 	}
 
@@ -1024,6 +1069,106 @@ static void meson_vclk_set(struct meson_drm *priv, unsigned int pll_base_freq,
 	regmap_update_bits(priv->hhi, HHI_VID_CLK_CNTL, VCLK_EN, VCLK_EN);
 }
 
+static unsigned int meson_vclk_vic_find_params(unsigned int phy_freq,
+					       unsigned int vclk_freq,
+					       unsigned int dac_freq,
+					       bool hdmi_use_enci,
+					       bool *vic_alternate_clock)
+{
+	unsigned int freq;
+
+	for (freq = 0 ; params[freq].pixel_freq ; ++freq) {
+		if ((phy_freq == params[freq].phy_freq ||
+		     phy_freq == FREQ_1000_1001(params[freq].phy_freq/10)*10) &&
+		    (vclk_freq == params[freq].vclk_freq ||
+		     vclk_freq == FREQ_1000_1001(params[freq].vclk_freq))) {
+			if (vclk_freq != params[freq].vclk_freq)
+				*vic_alternate_clock = true;
+			else
+				*vic_alternate_clock = false;
+
+			if (freq == MESON_VCLK_HDMI_ENCI_54000 &&
+			    !hdmi_use_enci)
+				continue;
+
+			if (freq == MESON_VCLK_HDMI_DDR_54000 &&
+			    hdmi_use_enci)
+				continue;
+
+			if (freq == MESON_VCLK_HDMI_DDR_148500 &&
+			    dac_freq == vclk_freq)
+				continue;
+
+			if (freq == MESON_VCLK_HDMI_148500 &&
+			    dac_freq != vclk_freq)
+				continue;
+			break;
+		}
+	}
+
+	return freq;
+}
+
+/*
+ * Check if switching the running HDMI VIC clock to the requested one only
+ * needs a HDMI PLL fractional update, which is the case when moving between
+ * a VIC clock and its 1000/1001 variant without changing the PLL multiplier.
+ */
+bool meson_vclk_vic_can_retune(struct meson_drm *priv, unsigned int phy_freq,
+			       unsigned int vclk_freq, unsigned int venc_freq,
+			       unsigned int dac_freq, bool hdmi_use_enci)
+{
+	bool vic_alternate_clock = false;
+	unsigned int m, frac, cur_m, cur_frac;
+	unsigned int freq;
+
+	if (!priv->vclk.vic_valid || !dac_freq || !venc_freq)
+		return false;
+
+	freq = meson_vclk_vic_find_params(phy_freq, vclk_freq, dac_freq,
+					  hdmi_use_enci, &vic_alternate_clock);
+	if (freq != priv->vclk.vic_params ||
+	    vic_alternate_clock == priv->vclk.vic_alternate_clock ||
+	    vclk_freq / dac_freq != priv->vclk.hdmi_tx_div ||
+	    vclk_freq / venc_freq != priv->vclk.venc_div)
+		return false;
+
+	meson_hdmi_pll_vic_params(priv, params[freq].pll_freq,
+				  vic_alternate_clock, &m, &frac);
+	meson_hdmi_pll_vic_params(priv, params[freq].pll_freq,
+				  priv->vclk.vic_alternate_clock,
+				  &cur_m, &cur_frac);
+	if (!m || m != cur_m)
+		return false;
+
+	/* The G12A 5.4GHz settings also depend on the frac range */
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A) && m >= 0xf7)
+		return false;
+
+	return true;
+}
+EXPORT_SYMBOL_GPL(meson_vclk_vic_can_retune);
+
+/*
+ * Switch the running HDMI VIC clock to or from its 1000/1001 variant,
+ * only valid once meson_vclk_vic_can_retune() accepted the new clock.
+ */
+void meson_vclk_vic_retune(struct meson_drm *priv, bool vic_alternate_clock)
+{
+	unsigned int m, frac;
+
+	if (!priv->vclk.vic_valid ||
+	    vic_alternate_clock == priv->vclk.vic_alternate_clock)
+		return;
+
+	meson_hdmi_pll_vic_params(priv, params[priv->vclk.vic_params].pll_freq,
+				  vic_alternate_clock, &m, &frac);
+	meson_hdmi_pll_set_frac(priv, frac);
+
+	priv->vclk.vic_alternate_clock = vic_alternate_clock;
+}
+EXPORT_SYMBOL_GPL(meson_vclk_vic_retune);
+
 void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		      unsigned int phy_freq, unsigned int vclk_freq,
 		      unsigned int venc_freq, unsigned int dac_freq,
@@ -1034,6 +1179,9 @@ void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 	unsigned int hdmi_tx_div;
 	unsigned int venc_div;
 
+	/* Only a completed VIC setup can be retuned afterwards */
+	priv->vclk.vic_valid = false;
+
 	if (target == MESON_VCLK_TARGET_CVBS) {
 		meson_venci_cvbs_clock_config(priv);
 		return;
@@ -1068,35 +1216,8 @@ void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		return;
 	}
 
-	for (freq = 0 ; params[freq].pixel_freq ; ++freq) {
-		if ((phy_freq == params[freq].phy_freq ||
-		     phy_freq == FREQ_1000_1001(params[freq].phy_freq/10)*10) &&
-		    (vclk_freq == params[freq].vclk_freq ||
-		     vclk_freq == FREQ_1000_1001(params[freq].vclk_freq))) {
-			if (vclk_freq != params[freq].vclk_freq)
-				vic_alternate_clock = true;
-			else
-				vic_alternate_clock = false;
-
-			if (freq == MESON_VCLK_HDMI_ENCI_54000 &&
-			    !hdmi_use_enci)
-				continue;
-
-			if (freq == MESON_VCLK_HDMI_DDR_54000 &&
-			    hdmi_use_enci)
-				continue;
-
-			if (freq == MESON_VCLK_HDMI_DDR_148500 &&
-			    dac_freq == vclk_freq)
-				continue;
-
-			if (freq == MESON_VCLK_HDMI_148500 &&
-			    dac_freq != vclk_freq)
-				continue;
-			break;
-		}
-	}
-
+	freq = meson_vclk_vic_find_params(phy_freq, vclk_freq, dac_freq,
+					  hdmi_use_enci, &vic_alternate_clock);
 	if (!params[freq].pixel_freq) {
 		pr_err("Fatal Error, invalid HDMI vclk freq %d\n", vclk_freq);
 		return;
@@ -1107,5 +1228,11 @@ void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		       params[freq].pll_od3, params[freq].vid_pll_div,
 		       params[freq].vclk_div, hdmi_tx_div, venc_div,
 		       hdmi_use_enci, vic_alternate_clock);
+
+	priv->vclk.vic_params = freq;
+	priv->vclk.vic_alternate_clock = vic_alternate_clock;
+	priv->vclk.hdmi_tx_div = hdmi_tx_div;
+	priv->vclk.venc_div = venc_div;
+	priv->vclk.vic_valid = true;
 }
 EXPORT_SYMBOL_GPL(meson_vclk_setup);
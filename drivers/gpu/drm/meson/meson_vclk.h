@@ -28,6 +28,11 @@ enum drm_mode_status
 meson_vclk_vic_supported_freq(struct meson_drm *priv, unsigned int phy_freq,
 			      unsigned int vclk_freq);
 
+bool meson_vclk_vic_can_retune(struct meson_drm *priv, unsigned int phy_freq,
+			       unsigned int vclk_freq, unsigned int venc_freq,
+			       unsigned int dac_freq, bool hdmi_use_enci);
+void meson_vclk_vic_retune(struct meson_drm *priv, bool vic_alternate_clock);
+
 void meson_vclk_setup(struct meson_drm *priv, unsigned int target,
 		      unsigned int phy_freq, unsigned int vclk_freq,
 		      unsigned int venc_freq, unsigned int dac_freq,
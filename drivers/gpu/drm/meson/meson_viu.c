@@ -13,6 +13,7 @@
 
 #include "meson_drv.h"
 #include "meson_viu.h"
+#include "meson_rdma.h"
 #include "meson_registers.h"
 
 /**
@@ -25,6 +26,7 @@
  * - RGB conversion to x/cb/cr
  * - Progressive or Interlace buffer scanout
  * - OSD1 Commit on Vsync
+ * - OSD2 RGB scanout as an unscaled overlay plane
  * - HDR OSD matrix for GXL/GXM
  *
  * What is missing :
@@ -36,7 +38,7 @@
  * - Big endian scanout
  * - X/Y reverse scanout
  * - Global alpha setup
- * - OSD2 support, would need interlace switching on vsync
+ * - OSD2 interlace scanout, would need interlace switching on vsync
  * - OSD1 full scaling to support TV overscan
  */
 
@@ -78,32 +80,63 @@ static int eotf_bypass_coeff[EOTF_COEFF_SIZE] = {
 	EOTF_COEFF_RIGHTSHIFT /* right shift */
 };
 
-static void meson_viu_set_g12a_osd1_matrix(struct meson_drm *priv,
-					   int *m, bool csc_on)
+static void meson_viu_set_g12a_osd_matrix(struct meson_drm *priv,
+					  unsigned int osd, int *m, bool csc_on)
 {
-	/* VPP WRAP OSD1 matrix */
+	/* VPP WRAP OSD2 matrix registers follow the OSD1 ones */
+	unsigned int off = osd == 2 ? VPP_WRAP_OSD2_MATRIX_COEF00_01 -
+				      VPP_WRAP_OSD1_MATRIX_COEF00_01 : 0;
+
 	writel(((m[0] & 0xfff) << 16) | (m[1] & 0xfff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_PRE_OFFSET0_1));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_PRE_OFFSET0_1 + off));
 	writel(m[2] & 0xfff,
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_PRE_OFFSET2));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_PRE_OFFSET2 + off));
 	writel(((m[3] & 0x1fff) << 16) | (m[4] & 0x1fff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF00_01));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF00_01 + off));
 	writel(((m[5] & 0x1fff) << 16) | (m[6] & 0x1fff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF02_10));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF02_10 + off));
 	writel(((m[7] & 0x1fff) << 16) | (m[8] & 0x1fff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF11_12));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF11_12 + off));
 	writel(((m[9] & 0x1fff) << 16) | (m[10] & 0x1fff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF20_21));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF20_21 + off));
 	writel((m[11] & 0x1fff) << 16,
-		priv->io_base +	_REG(VPP_WRAP_OSD1_MATRIX_COEF22));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_COEF22 + off));
 
 	writel(((m[18] & 0xfff) << 16) | (m[19] & 0xfff),
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_OFFSET0_1));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_OFFSET0_1 + off));
 	writel(m[20] & 0xfff,
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_OFFSET2));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_OFFSET2 + off));
 
 	writel_bits_relaxed(BIT(0), csc_on ? BIT(0) : 0,
-		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_EN_CTRL));
+		priv->io_base + _REG(VPP_WRAP_OSD1_MATRIX_EN_CTRL + off));
+}
+
+/* OSD2 only has a 3x3 matrix on GXL/GXM */
+static void meson_viu_set_osd2_matrix(struct meson_drm *priv,
+				      int *m, bool csc_on)
+{
+	writel(((m[0] & 0xfff) << 16) | (m[1] & 0xfff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_PRE_OFFSET0_1));
+	writel(m[2] & 0xfff,
+		priv->io_base + _REG(VIU_OSD2_MATRIX_PRE_OFFSET2));
+	writel(((m[3] & 0x1fff) << 16) | (m[4] & 0x1fff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_COEF00_01));
+	writel(((m[5] & 0x1fff) << 16) | (m[6] & 0x1fff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_COEF02_10));
+	writel(((m[7] & 0x1fff) << 16) | (m[8] & 0x1fff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_COEF11_12));
+	writel(((m[9] & 0x1fff) << 16) | (m[10] & 0x1fff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_COEF20_21));
+	writel(m[11] & 0x1fff,
+		priv->io_base + _REG(VIU_OSD2_MATRIX_COEF22));
+
+	writel(((m[18] & 0xfff) << 16) | (m[19] & 0xfff),
+		priv->io_base + _REG(VIU_OSD2_MATRIX_OFFSET0_1));
+	writel(m[20] & 0xfff,
+		priv->io_base + _REG(VIU_OSD2_MATRIX_OFFSET2));
+
+	writel_bits_relaxed(BIT(0), csc_on ? BIT(0) : 0,
+		priv->io_base + _REG(VIU_OSD2_MATRIX_CTRL));
 }
 
 static void meson_viu_set_osd_matrix(struct meson_drm *priv,
@@ -363,9 +396,9 @@ void meson_viu_g12a_enable_osd1_afbc(struct meson_drm *priv)
 	u32 afbc_order = OSD1_MALI_ORDER_ARGB;
 
 	/* Enable Mali AFBC Unpack */
-	writel_bits_relaxed(VIU_OSD1_MALI_UNPACK_EN,
-			    VIU_OSD1_MALI_UNPACK_EN,
-			    priv->io_base + _REG(VIU_OSD1_MALI_UNPACK_CTRL));
+	meson_rdma_writel_bits(priv, VIU_OSD1_MALI_UNPACK_EN,
+			       VIU_OSD1_MALI_UNPACK_EN,
+			       VIU_OSD1_MALI_UNPACK_CTRL);
 
 	switch (priv->afbcd.format) {
 	case DRM_FORMAT_XBGR8888:
@@ -375,40 +408,42 @@ void meson_viu_g12a_enable_osd1_afbc(struct meson_drm *priv)
 	}
 
 	/* Setup RGBA Reordering */
-	writel_bits_relaxed(VIU_OSD1_MALI_AFBCD_A_REORDER |
-			    VIU_OSD1_MALI_AFBCD_B_REORDER |
-			    VIU_OSD1_MALI_AFBCD_G_REORDER |
-			    VIU_OSD1_MALI_AFBCD_R_REORDER,
-			    afbc_order,
-			    priv->io_base + _REG(VIU_OSD1_MALI_UNPACK_CTRL));
+	meson_rdma_writel_bits(priv, VIU_OSD1_MALI_AFBCD_A_REORDER |
+			       VIU_OSD1_MALI_AFBCD_B_REORDER |
+			       VIU_OSD1_MALI_AFBCD_G_REORDER |
+			       VIU_OSD1_MALI_AFBCD_R_REORDER,
+			       afbc_order,
+			       VIU_OSD1_MALI_UNPACK_CTRL);
 
 	/* Select AFBCD path for OSD1 */
-	writel_bits_relaxed(OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD,
-			    OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD,
-			    priv->io_base + _REG(OSD_PATH_MISC_CTRL));
+	meson_rdma_writel_bits(priv, OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD,
+			       OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD,
+			       OSD_PATH_MISC_CTRL);
 }
 
 void meson_viu_g12a_disable_osd1_afbc(struct meson_drm *priv)
 {
 	/* Disable AFBCD path for OSD1 */
-	writel_bits_relaxed(OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD, 0,
-			    priv->io_base + _REG(OSD_PATH_MISC_CTRL));
+	meson_rdma_writel_bits(priv, OSD_PATH_OSD_AXI_SEL_OSD1_AFBCD, 0,
+			       OSD_PATH_MISC_CTRL);
 
 	/* Disable AFBCD unpack */
-	writel_bits_relaxed(VIU_OSD1_MALI_UNPACK_EN, 0,
-			    priv->io_base + _REG(VIU_OSD1_MALI_UNPACK_CTRL));
+	meson_rdma_writel_bits(priv, VIU_OSD1_MALI_UNPACK_EN, 0,
+			       VIU_OSD1_MALI_UNPACK_CTRL);
 }
 
 void meson_viu_gxm_enable_osd1_afbc(struct meson_drm *priv)
 {
-	writel_bits_relaxed(MALI_AFBC_MISC, FIELD_PREP(MALI_AFBC_MISC, 0x90),
-			    priv->io_base + _REG(VIU_MISC_CTRL1));
+	meson_rdma_writel_bits(priv, MALI_AFBC_MISC,
+			       FIELD_PREP(MALI_AFBC_MISC, 0x90),
+			       VIU_MISC_CTRL1);
 }
 
 void meson_viu_gxm_disable_osd1_afbc(struct meson_drm *priv)
 {
-	writel_bits_relaxed(MALI_AFBC_MISC, FIELD_PREP(MALI_AFBC_MISC, 0x00),
-			    priv->io_base + _REG(VIU_MISC_CTRL1));
+	meson_rdma_writel_bits(priv, MALI_AFBC_MISC,
+			       FIELD_PREP(MALI_AFBC_MISC, 0x00),
+			       VIU_MISC_CTRL1);
 }
 
 void meson_viu_init(struct meson_drm *priv)
@@ -423,11 +458,15 @@ void meson_viu_init(struct meson_drm *priv)
 
 	/* On GXL/GXM, Use the 10bit HDR conversion matrix */
 	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXM) ||
-	    meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXL))
+	    meson_vpu_is_compatible(priv, VPU_COMPATIBLE_GXL)) {
 		meson_viu_load_matrix(priv);
-	else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A))
-		meson_viu_set_g12a_osd1_matrix(priv, RGB709_to_YUV709l_coeff,
-					       true);
+		meson_viu_set_osd2_matrix(priv, RGB709_to_YUV709l_coeff, true);
+	} else if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		meson_viu_set_g12a_osd_matrix(priv, 1, RGB709_to_YUV709l_coeff,
+					      true);
+		meson_viu_set_g12a_osd_matrix(priv, 2, RGB709_to_YUV709l_coeff,
+					      true);
+	}
 
 	/* Initialize OSD1 fifo control register */
 	reg = VIU_OSD_DDR_PRIORITY_URGENT |
@@ -499,4 +538,7 @@ void meson_viu_init(struct meson_drm *priv)
 	priv->viu.osd1_enabled = false;
 	priv->viu.osd1_commit = false;
 	priv->viu.osd1_interlace = false;
+
+	priv->viu.osd2_enabled = false;
+	priv->viu.osd2_commit = false;
 }
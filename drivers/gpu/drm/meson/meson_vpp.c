@@ -6,9 +6,13 @@
  * Copyright (C) 2014 Endless Mobile
  */
 
+#include <linux/bitfield.h>
 #include <linux/export.h>
 
+#include <drm/drm_color_mgmt.h>
+
 #include "meson_drv.h"
+#include "meson_rdma.h"
 #include "meson_registers.h"
 #include "meson_vpp.h"
 
@@ -18,8 +22,12 @@
  * VPP Handles all the Post Processing after the Scanout from the VIU
  * We handle the following post processings :
  *
- * - Postblend, Blends the OSD1 only
- *	We exclude OSD2, VS1, VS1 and Preblend output
+ * - Postblend, Blends OSD1 and OSD2 in both orders
+ *	We exclude VS1, VS1 and Preblend output
+ * - Postblend of VD2 on top of VD1 and below the OSD planes, VD2 has no
+ *	scaler in the VPP and is blended at its source size
+ * - VD1/VD2 matrices converting the plane YCbCr encoding and range to the
+ *	BT.709 limited range used by the rest of the pipeline
  * - Vertical OSD Scaler for OSD1 only, we disable vertical scaler and
  *	use it only for interlace scanout
  * - Intermediate FIFO with default Amlogic values
@@ -27,7 +35,6 @@
  * What is missing :
  *
  * - Preblend for video overlay pre-scaling
- * - OSD2 support for cursor framebuffer
  * - Video pre-scaling before postblend
  * - Full Vertical/Horizontal OSD scaling to support TV overscan
  * - HDR conversion
@@ -38,6 +45,206 @@ void meson_vpp_setup_mux(struct meson_drm *priv, unsigned int mux)
 	writel(mux, priv->io_base + _REG(VPU_VIU_VENC_MUX_CTRL));
 }
 
+#define COEFF_NORM(a) ((int)((((a) * 2048.0) + 1) / 2))
+
+/* 10bit YCbCr to YCbCr BT.709 limited range conversion */
+struct meson_vpp_csc {
+	int pre_offset[3];
+	int coef[9];
+	int offset[3];
+};
+
+#define CSC_PRE_OFFSET_LIMITED	{ -64, -512, -512 }
+#define CSC_PRE_OFFSET_FULL	{ 0, -512, -512 }
+#define CSC_OFFSET_709L		{ 64, 512, 512 }
+
+static const struct meson_vpp_csc
+meson_vpp_csc[DRM_COLOR_ENCODING_MAX][DRM_COLOR_RANGE_MAX] = {
+	[DRM_COLOR_YCBCR_BT601] = {
+		[DRM_COLOR_YCBCR_LIMITED_RANGE] = {
+			CSC_PRE_OFFSET_LIMITED, {
+			COEFF_NORM(1.0), COEFF_NORM(-0.115550),
+			COEFF_NORM(-0.207938),
+			COEFF_NORM(0.0), COEFF_NORM(1.018640),
+			COEFF_NORM(0.114618),
+			COEFF_NORM(0.0), COEFF_NORM(0.075049),
+			COEFF_NORM(1.025327),
+			}, CSC_OFFSET_709L,
+		},
+		[DRM_COLOR_YCBCR_FULL_RANGE] = {
+			CSC_PRE_OFFSET_FULL, {
+			COEFF_NORM(0.856305), COEFF_NORM(-0.101205),
+			COEFF_NORM(-0.182123),
+			COEFF_NORM(0.0), COEFF_NORM(0.892181),
+			COEFF_NORM(0.100389),
+			COEFF_NORM(0.0), COEFF_NORM(0.065732),
+			COEFF_NORM(0.898038),
+			}, CSC_OFFSET_709L,
+		},
+	},
+	[DRM_COLOR_YCBCR_BT709] = {
+		/* Limited range is bypassed */
+		[DRM_COLOR_YCBCR_FULL_RANGE] = {
+			CSC_PRE_OFFSET_FULL, {
+			COEFF_NORM(0.856305), COEFF_NORM(0.0), COEFF_NORM(0.0),
+			COEFF_NORM(0.0), COEFF_NORM(0.875855), COEFF_NORM(0.0),
+			COEFF_NORM(0.0), COEFF_NORM(0.0), COEFF_NORM(0.875855),
+			}, CSC_OFFSET_709L,
+		},
+	},
+	[DRM_COLOR_YCBCR_BT2020] = {
+		[DRM_COLOR_YCBCR_LIMITED_RANGE] = {
+			CSC_PRE_OFFSET_LIMITED, {
+			COEFF_NORM(1.0), COEFF_NORM(0.017744),
+			COEFF_NORM(-0.093008),
+			COEFF_NORM(0.0), COEFF_NORM(1.004123),
+			COEFF_NORM(0.051267),
+			COEFF_NORM(0.0), COEFF_NORM(-0.011524),
+			COEFF_NORM(0.996782),
+			}, CSC_OFFSET_709L,
+		},
+		[DRM_COLOR_YCBCR_FULL_RANGE] = {
+			CSC_PRE_OFFSET_FULL, {
+			COEFF_NORM(0.856305), COEFF_NORM(0.015541),
+			COEFF_NORM(-0.081462),
+			COEFF_NORM(0.0), COEFF_NORM(0.879467),
+			COEFF_NORM(0.044903),
+			COEFF_NORM(0.0), COEFF_NORM(-0.010094),
+			COEFF_NORM(0.873037),
+			}, CSC_OFFSET_709L,
+		},
+	},
+};
+
+/* G12A has a dedicated VD1 matrix, laid out like the OSD wrap ones */
+static void meson_vpp_g12a_write_vd1_matrix(struct meson_drm *priv,
+					    const struct meson_vpp_csc *csc)
+{
+	const int *m = csc->coef;
+
+	meson_rdma_writel(priv, ((csc->pre_offset[0] & 0xfff) << 16) |
+			  (csc->pre_offset[1] & 0xfff),
+			  VPP_VD1_MATRIX_PRE_OFFSET0_1);
+	meson_rdma_writel(priv, csc->pre_offset[2] & 0xfff,
+			  VPP_VD1_MATRIX_PRE_OFFSET2);
+	meson_rdma_writel(priv, ((m[0] & 0x1fff) << 16) | (m[1] & 0x1fff),
+			  VPP_VD1_MATRIX_COEF00_01);
+	meson_rdma_writel(priv, ((m[2] & 0x1fff) << 16) | (m[3] & 0x1fff),
+			  VPP_VD1_MATRIX_COEF02_10);
+	meson_rdma_writel(priv, ((m[4] & 0x1fff) << 16) | (m[5] & 0x1fff),
+			  VPP_VD1_MATRIX_COEF11_12);
+	meson_rdma_writel(priv, ((m[6] & 0x1fff) << 16) | (m[7] & 0x1fff),
+			  VPP_VD1_MATRIX_COEF20_21);
+	meson_rdma_writel(priv, m[8] & 0x1fff, VPP_VD1_MATRIX_COEF22);
+	meson_rdma_writel(priv, ((csc->offset[0] & 0xfff) << 16) |
+			  (csc->offset[1] & 0xfff),
+			  VPP_VD1_MATRIX_OFFSET0_1);
+	meson_rdma_writel(priv, csc->offset[2] & 0xfff,
+			  VPP_VD1_MATRIX_OFFSET2);
+}
+
+/* The VD1 and VD2 matrices share their registers, selected in the CTRL */
+static void meson_vpp_write_vd_matrix(struct meson_drm *priv,
+				      unsigned int sel,
+				      const struct meson_vpp_csc *csc)
+{
+	const int *m = csc->coef;
+
+	meson_rdma_writel_bits(priv, VPP_MATRIX_SEL,
+			       FIELD_PREP(VPP_MATRIX_SEL, sel),
+			       VPP_MATRIX_CTRL);
+	meson_rdma_writel(priv, ((csc->pre_offset[0] & 0xfff) << 16) |
+			  (csc->pre_offset[1] & 0xfff),
+			  VPP_MATRIX_PRE_OFFSET0_1);
+	meson_rdma_writel(priv, csc->pre_offset[2] & 0xfff,
+			  VPP_MATRIX_PRE_OFFSET2);
+	meson_rdma_writel(priv, ((m[0] & 0x1fff) << 16) | (m[1] & 0x1fff),
+			  VPP_MATRIX_COEF00_01);
+	meson_rdma_writel(priv, ((m[2] & 0x1fff) << 16) | (m[3] & 0x1fff),
+			  VPP_MATRIX_COEF02_10);
+	meson_rdma_writel(priv, ((m[4] & 0x1fff) << 16) | (m[5] & 0x1fff),
+			  VPP_MATRIX_COEF11_12);
+	meson_rdma_writel(priv, ((m[6] & 0x1fff) << 16) | (m[7] & 0x1fff),
+			  VPP_MATRIX_COEF20_21);
+	meson_rdma_writel(priv, m[8] & 0x1fff, VPP_MATRIX_COEF22);
+	meson_rdma_writel(priv, ((csc->offset[0] & 0xfff) << 16) |
+			  (csc->offset[1] & 0xfff),
+			  VPP_MATRIX_OFFSET0_1);
+	meson_rdma_writel(priv, csc->offset[2] & 0xfff, VPP_MATRIX_OFFSET2);
+}
+
+/**
+ * meson_vpp_setup_vd_matrix() - convert a video plane to BT.709 limited
+ * @priv: the meson DRM private data
+ * @vd: video plane, 1 for VD1 or 2 for VD2
+ * @encoding: YCbCr encoding of the plane buffer
+ * @range: YCbCr range of the plane buffer
+ *
+ * BT.709 limited range buffers bypass the matrix, G12A only has one for VD1.
+ * This is recorded by the RDMA along with the plane registers.
+ */
+void meson_vpp_setup_vd_matrix(struct meson_drm *priv, unsigned int vd,
+			       enum drm_color_encoding encoding,
+			       enum drm_color_range range)
+{
+	const struct meson_vpp_csc *csc = NULL;
+	u32 enable = vd == 2 ? VPP_MATRIX_VD2_EN : VPP_MATRIX_VD1_EN;
+
+	if (encoding != DRM_COLOR_YCBCR_BT709 ||
+	    range != DRM_COLOR_YCBCR_LIMITED_RANGE)
+		csc = &meson_vpp_csc[encoding][range];
+
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		if (vd != 1)
+			return;
+
+		if (csc)
+			meson_vpp_g12a_write_vd1_matrix(priv, csc);
+		meson_rdma_writel(priv, csc ? BIT(0) : 0,
+				  VPP_VD1_MATRIX_EN_CTRL);
+		return;
+	}
+
+	if (csc)
+		meson_vpp_write_vd_matrix(priv, vd == 2 ? VPP_MATRIX_SEL_VD2 :
+					  VPP_MATRIX_SEL_VD1, csc);
+	meson_rdma_writel_bits(priv, enable, csc ? enable : 0,
+			       VPP_MATRIX_CTRL);
+}
+
+/*
+ * Place VD2 in the postblend and enable it, this is recorded by the RDMA
+ * along with the VD2 plane registers when called from a commit.
+ */
+void meson_vpp_enable_vd2(struct meson_drm *priv)
+{
+	meson_rdma_writel(priv, priv->viu.vpp_blend_vd2_h_start_end,
+			  VPP_BLEND_VD2_H_START_END);
+	meson_rdma_writel(priv, priv->viu.vpp_blend_vd2_v_start_end,
+			  VPP_BLEND_VD2_V_START_END);
+
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A)) {
+		meson_rdma_writel(priv, priv->viu.vpp_vd2_hdr_in_size,
+				  VPP_VD2_HDR_IN_SIZE);
+		meson_rdma_writel(priv, VD_BLEND_POSTBLD_SRC_VD2 |
+				  VD_BLEND_POSTBLD_PREMULT_EN,
+				  VD2_BLEND_SRC_CTRL);
+	} else
+		meson_rdma_writel_bits(priv,
+				       VPP_VD2_POSTBLEND | VPP_VD2_PREBLEND,
+				       VPP_VD2_POSTBLEND, VPP_MISC);
+}
+
+void meson_vpp_disable_vd2(struct meson_drm *priv)
+{
+	if (meson_vpu_is_compatible(priv, VPU_COMPATIBLE_G12A))
+		meson_rdma_writel(priv, 0, VD2_BLEND_SRC_CTRL);
+	else
+		meson_rdma_writel_bits(priv,
+				       VPP_VD2_POSTBLEND | VPP_VD2_PREBLEND,
+				       0, VPP_MISC);
+}
+
 static unsigned int vpp_filter_coefs_4point_bspline[] = {
 	0x15561500, 0x14561600, 0x13561700, 0x12561800,
 	0x11551a00, 0x11541b00, 0x10541c00, 0x0f541d00,
@@ -56,11 +263,10 @@ static void meson_vpp_write_scaling_filter_coefs(struct meson_drm *priv,
 {
 	int i;
 
-	writel_relaxed(is_horizontal ? VPP_SCALE_HORIZONTAL_COEF : 0,
-			priv->io_base + _REG(VPP_OSD_SCALE_COEF_IDX));
+	meson_rdma_writel(priv, is_horizontal ? VPP_SCALE_HORIZONTAL_COEF : 0,
+			  VPP_OSD_SCALE_COEF_IDX);
 	for (i = 0; i < 33; i++)
-		writel_relaxed(coefs[i],
-				priv->io_base + _REG(VPP_OSD_SCALE_COEF));
+		meson_rdma_writel(priv, coefs[i], VPP_OSD_SCALE_COEF);
 }
 
 static const uint32_t vpp_filter_coefs_bicubic[] = {
@@ -88,6 +294,33 @@ static void meson_vpp_write_vd_scaling_filter_coefs(struct meson_drm *priv,
 				priv->io_base + _REG(VPP_SCALE_COEF));
 }
 
+/*
+ * The 4 point bspline loaded at init is soft, which suits the interlace
+ * field scaling, but it visibly blurs a UI rendered at a lower resolution
+ * and upscaled to the mode, so upscaling switches to the bicubic filter.
+ * The coefficients are recorded like the scaler setup they go with.
+ */
+void meson_vpp_setup_osd_scaling_filter(struct meson_drm *priv)
+{
+	if (priv->viu.osd_sc_h_upscale != priv->viu.osd_sc_h_bicubic) {
+		meson_vpp_write_scaling_filter_coefs(priv,
+				priv->viu.osd_sc_h_upscale ?
+					vpp_filter_coefs_bicubic :
+					vpp_filter_coefs_4point_bspline,
+				true);
+		priv->viu.osd_sc_h_bicubic = priv->viu.osd_sc_h_upscale;
+	}
+
+	if (priv->viu.osd_sc_v_upscale != priv->viu.osd_sc_v_bicubic) {
+		meson_vpp_write_scaling_filter_coefs(priv,
+				priv->viu.osd_sc_v_upscale ?
+					vpp_filter_coefs_bicubic :
+					vpp_filter_coefs_4point_bspline,
+				false);
+		priv->viu.osd_sc_v_bicubic = priv->viu.osd_sc_v_upscale;
+	}
+}
+
 void meson_vpp_init(struct meson_drm *priv)
 {
 	/* set dummy data default YUV black */
@@ -154,6 +387,8 @@ void meson_vpp_init(struct meson_drm *priv)
 				vpp_filter_coefs_4point_bspline, false);
 	meson_vpp_write_scaling_filter_coefs(priv,
 				vpp_filter_coefs_4point_bspline, true);
+	priv->viu.osd_sc_h_bicubic = false;
+	priv->viu.osd_sc_v_bicubic = false;
 
 	/* Write the VD proper filter coefficients. */
 	meson_vpp_write_vd_scaling_filter_coefs(priv, vpp_filter_coefs_bicubic,
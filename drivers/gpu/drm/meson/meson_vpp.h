@@ -9,6 +9,8 @@
 #ifndef __MESON_VPP_H
 #define __MESON_VPP_H
 
+#include <drm/drm_color_mgmt.h>
+
 struct drm_rect;
 struct meson_drm;
 
@@ -19,10 +21,18 @@ struct meson_drm;
 
 void meson_vpp_setup_mux(struct meson_drm *priv, unsigned int mux);
 
+void meson_vpp_setup_vd_matrix(struct meson_drm *priv, unsigned int vd,
+			       enum drm_color_encoding encoding,
+			       enum drm_color_range range);
+void meson_vpp_enable_vd2(struct meson_drm *priv);
+void meson_vpp_disable_vd2(struct meson_drm *priv);
+
 void meson_vpp_setup_interlace_vscaler_osd1(struct meson_drm *priv,
 					    struct drm_rect *input);
 void meson_vpp_disable_interlace_vscaler_osd1(struct meson_drm *priv);
 
+void meson_vpp_setup_osd_scaling_filter(struct meson_drm *priv);
+
 void meson_vpp_init(struct meson_drm *priv);
 
 #endif /* __MESON_VPP_H */
@@ -123,6 +123,10 @@ struct panfrost_mmu {
 	int as;
 	atomic_t as_count;
 	struct list_head list;
+
+	/* page table updates not flushed yet, protected by as_lock */
+	u64 flush_start;
+	u64 flush_end;
 };
 
 struct panfrost_file_priv {
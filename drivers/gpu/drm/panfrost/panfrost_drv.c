@@ -8,6 +8,7 @@
 #include <linux/pagemap.h>
 #include <linux/pm_runtime.h>
 #include <drm/panfrost_drm.h>
+#include <drm/drm_auth.h>
 #include <drm/drm_drv.h>
 #include <drm/drm_ioctl.h>
 #include <drm/drm_syncobj.h>
@@ -382,6 +383,38 @@ static int panfrost_ioctl_get_bo_offset(struct drm_device *dev, void *data,
 	return 0;
 }
 
+static int panfrost_ioctl_set_priority(struct drm_device *dev, void *data,
+				       struct drm_file *file_priv)
+{
+	struct panfrost_file_priv *priv = file_priv->driver_priv;
+	struct drm_panfrost_set_priority *args = data;
+	enum drm_sched_priority priority;
+
+	if (args->pad)
+		return -EINVAL;
+
+	switch (args->priority) {
+	case PANFROST_PRIORITY_LOW:
+		priority = DRM_SCHED_PRIORITY_LOW;
+		break;
+	case PANFROST_PRIORITY_NORMAL:
+		priority = DRM_SCHED_PRIORITY_NORMAL;
+		break;
+	case PANFROST_PRIORITY_HIGH:
+		/* don't let any client starve the others */
+		if (!capable(CAP_SYS_NICE) && !drm_is_current_master(file_priv))
+			return -EACCES;
+		priority = DRM_SCHED_PRIORITY_HIGH_SW;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	panfrost_job_set_priority(priv, priority);
+
+	return 0;
+}
+
 static int panfrost_ioctl_madvise(struct drm_device *dev, void *data,
 				  struct drm_file *file_priv)
 {
@@ -540,6 +573,8 @@ static const struct drm_ioctl_desc panfrost_drm_driver_ioctls[] = {
 	PANFROST_IOCTL(PERFCNT_ENABLE,	perfcnt_enable,	DRM_RENDER_ALLOW),
 	PANFROST_IOCTL(PERFCNT_DUMP,	perfcnt_dump,	DRM_RENDER_ALLOW),
 	PANFROST_IOCTL(MADVISE,		madvise,	DRM_RENDER_ALLOW),
+	PANFROST_IOCTL(SET_PRIORITY,	set_priority,	DRM_RENDER_ALLOW),
+	PANFROST_IOCTL(PERFCNT_STREAM,	perfcnt_stream,	DRM_RENDER_ALLOW),
 };
 
 DEFINE_DRM_GEM_FOPS(panfrost_drm_driver_fops);
@@ -548,6 +583,8 @@ DEFINE_DRM_GEM_FOPS(panfrost_drm_driver_fops);
  * Panfrost driver version:
  * - 1.0 - initial interface
  * - 1.1 - adds HEAP and NOEXEC flags for CREATE_BO
+ * - 1.2 - adds SET_PRIORITY ioctl
+ * - 1.3 - adds PERFCNT_STREAM ioctl
  */
 static struct drm_driver panfrost_drm_driver = {
 	.driver_features	= DRIVER_RENDER | DRIVER_GEM | DRIVER_SYNCOBJ,
@@ -560,7 +597,7 @@ static struct drm_driver panfrost_drm_driver = {
 	.desc			= "panfrost DRM",
 	.date			= "20180908",
 	.major			= 1,
-	.minor			= 1,
+	.minor			= 3,
 
 	.gem_create_object	= panfrost_gem_create_object,
 	.prime_handle_to_fd	= drm_gem_prime_handle_to_fd,
@@ -525,6 +525,9 @@ int panfrost_job_init(struct panfrost_device *pfdev)
 			dev_err(pfdev->dev, "Failed to create scheduler: %d.", ret);
 			goto err_sched;
 		}
+
+		/* panfrost_job_run() is fine with the ioctl context. */
+		js->queue[j].sched.direct_submit = true;
 	}
 
 	panfrost_job_enable_interrupts(pfdev);
@@ -576,6 +579,16 @@ void panfrost_job_close(struct panfrost_file_priv *panfrost_priv)
 		drm_sched_entity_destroy(&panfrost_priv->sched_entity[i]);
 }
 
+void panfrost_job_set_priority(struct panfrost_file_priv *panfrost_priv,
+			       enum drm_sched_priority priority)
+{
+	int i;
+
+	for (i = 0; i < NUM_JOB_SLOTS; i++)
+		drm_sched_entity_set_priority(&panfrost_priv->sched_entity[i],
+					      priority);
+}
+
 int panfrost_job_is_idle(struct panfrost_device *pfdev)
 {
 	struct panfrost_job_slot *js = pfdev->js;
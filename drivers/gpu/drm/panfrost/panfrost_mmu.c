@@ -51,27 +51,31 @@ static int write_cmd(struct panfrost_device *pfdev, u32 as_nr, u32 cmd)
 	return status;
 }
 
+/* smallest region the MMU can lock, 32KiB */
+#define AS_LOCK_REGION_MIN_WIDTH	15
+
 static void lock_region(struct panfrost_device *pfdev, u32 as_nr,
 			u64 iova, size_t size)
 {
 	u8 region_width;
-	u64 region = iova & PAGE_MASK;
+	u64 region;
+	u64 region_end = iova + size;
+
+	if (!size)
+		return;
+
 	/*
-	 * fls returns:
-	 * 1 .. 32
-	 *
-	 * 10 + fls(num_pages)
-	 * results in the range (11 .. 42)
+	 * The locked region is a naturally aligned power of 2 block, encoded
+	 * as its log2 minus 1. The highest bit that differs between the first
+	 * and the last address gives the smallest such block covering the
+	 * whole range, which matters once several mappings get merged into a
+	 * single flush.
 	 */
+	region_width = max(fls64(iova ^ (region_end - 1)),
+			   AS_LOCK_REGION_MIN_WIDTH) - 1;
 
-	size = round_up(size, PAGE_SIZE);
-
-	region_width = 10 + fls(size >> PAGE_SHIFT);
-	if ((size >> PAGE_SHIFT) != (1ul << (region_width - 11))) {
-		/* not pow2, so must go up to the next pow2 */
-		region_width += 1;
-	}
-	region |= region_width;
+	/* the low bits of the address are ignored by the hardware */
+	region = (iova & GENMASK_ULL(63, region_width)) | region_width;
 
 	/* Lock the region that needs to be updated */
 	mmu_write(pfdev, AS_LOCKADDR_LO(as_nr), region & 0xFFFFFFFFUL);
@@ -142,6 +146,18 @@ static void panfrost_mmu_disable(struct panfrost_device *pfdev, u32 as_nr)
 	write_cmd(pfdev, as_nr, AS_COMMAND_UPDATE);
 }
 
+static void panfrost_mmu_flush_pending_locked(struct panfrost_device *pfdev,
+					      struct panfrost_mmu *mmu)
+{
+	if (mmu->flush_end > mmu->flush_start)
+		mmu_hw_do_operation_locked(pfdev, mmu->as, mmu->flush_start,
+					   mmu->flush_end - mmu->flush_start,
+					   AS_COMMAND_FLUSH_PT);
+
+	mmu->flush_start = 0;
+	mmu->flush_end = 0;
+}
+
 u32 panfrost_mmu_as_get(struct panfrost_device *pfdev, struct panfrost_mmu *mmu)
 {
 	int as;
@@ -159,6 +175,7 @@ u32 panfrost_mmu_as_get(struct panfrost_device *pfdev, struct panfrost_mmu *mmu)
 		WARN_ON(en >= (NUM_JOB_SLOTS + 1));
 
 		list_move(&mmu->list, &pfdev->as_lru_list);
+		panfrost_mmu_flush_pending_locked(pfdev, mmu);
 		goto out;
 	}
 
@@ -188,6 +205,9 @@ u32 panfrost_mmu_as_get(struct panfrost_device *pfdev, struct panfrost_mmu *mmu)
 
 	dev_dbg(pfdev->dev, "Assigned AS%d to mmu %p, alloc_mask=%lx", as, mmu, pfdev->as_alloc_mask);
 
+	/* enabling the AS flushes everything anyway */
+	mmu->flush_start = 0;
+	mmu->flush_end = 0;
 	panfrost_mmu_enable(pfdev, mmu);
 
 out:
@@ -211,6 +231,8 @@ void panfrost_mmu_reset(struct panfrost_device *pfdev)
 
 	list_for_each_entry_safe(mmu, mmu_tmp, &pfdev->as_lru_list, list) {
 		mmu->as = -1;
+		mmu->flush_start = 0;
+		mmu->flush_end = 0;
 		atomic_set(&mmu->as_count, 0);
 		list_del_init(&mmu->list);
 	}
@@ -245,8 +267,34 @@ static void panfrost_mmu_flush_range(struct panfrost_device *pfdev,
 	pm_runtime_put_sync_autosuspend(pfdev->dev);
 }
 
-static int mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
-		      u64 iova, int prot, struct sg_table *sgt)
+/*
+ * A new mapping can only be used by jobs submitted after it was created,
+ * so instead of locking and flushing the page table caches for every BO,
+ * the updated ranges are merged and flushed once when the address space
+ * is next taken for a job (or for perfcnt).
+ */
+static void panfrost_mmu_defer_flush(struct panfrost_device *pfdev,
+				     struct panfrost_mmu *mmu,
+				     u64 iova, size_t size)
+{
+	spin_lock(&pfdev->as_lock);
+
+	/* without an AS the page tables are flushed when one is assigned */
+	if (mmu->as >= 0) {
+		if (mmu->flush_end > mmu->flush_start) {
+			mmu->flush_start = min(mmu->flush_start, iova);
+			mmu->flush_end = max(mmu->flush_end, iova + size);
+		} else {
+			mmu->flush_start = iova;
+			mmu->flush_end = iova + size;
+		}
+	}
+
+	spin_unlock(&pfdev->as_lock);
+}
+
+static size_t mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
+			 u64 iova, int prot, struct sg_table *sgt)
 {
 	unsigned int count;
 	struct scatterlist *sgl;
@@ -269,9 +317,7 @@ static int mmu_map_sg(struct panfrost_device *pfdev, struct panfrost_mmu *mmu,
 		}
 	}
 
-	panfrost_mmu_flush_range(pfdev, mmu, start_iova, iova - start_iova);
-
-	return 0;
+	return iova - start_iova;
 }
 
 int panfrost_mmu_map(struct panfrost_gem_mapping *mapping)
@@ -281,6 +327,8 @@ int panfrost_mmu_map(struct panfrost_gem_mapping *mapping)
 	struct panfrost_device *pfdev = to_panfrost_device(obj->dev);
 	struct sg_table *sgt;
 	int prot = IOMMU_READ | IOMMU_WRITE;
+	u64 iova = mapping->mmnode.start << PAGE_SHIFT;
+	size_t size;
 
 	if (WARN_ON(mapping->active))
 		return 0;
@@ -292,8 +340,8 @@ int panfrost_mmu_map(struct panfrost_gem_mapping *mapping)
 	if (WARN_ON(IS_ERR(sgt)))
 		return PTR_ERR(sgt);
 
-	mmu_map_sg(pfdev, mapping->mmu, mapping->mmnode.start << PAGE_SHIFT,
-		   prot, sgt);
+	size = mmu_map_sg(pfdev, mapping->mmu, iova, prot, sgt);
+	panfrost_mmu_defer_flush(pfdev, mapping->mmu, iova, size);
 	mapping->active = true;
 
 	return 0;
@@ -308,6 +356,7 @@ void panfrost_mmu_unmap(struct panfrost_gem_mapping *mapping)
 	u64 iova = mapping->mmnode.start << PAGE_SHIFT;
 	size_t len = mapping->mmnode.size << PAGE_SHIFT;
 	size_t unmapped_len = 0;
+	u64 flush_start = 0, flush_end = 0;
 
 	if (WARN_ON(!mapping->active))
 		return;
@@ -322,13 +371,23 @@ void panfrost_mmu_unmap(struct panfrost_gem_mapping *mapping)
 		if (ops->iova_to_phys(ops, iova)) {
 			unmapped_page = ops->unmap(ops, iova, pgsize, NULL);
 			WARN_ON(unmapped_page != pgsize);
+
+			/*
+			 * The io-pgtable walk callbacks don't touch the GPU;
+			 * the span actually unmapped is invalidated at once
+			 * below, so heap BOs only flush what was faulted in.
+			 */
+			if (!flush_end)
+				flush_start = iova;
+			flush_end = iova + pgsize;
 		}
 		iova += pgsize;
 		unmapped_len += pgsize;
 	}
 
-	panfrost_mmu_flush_range(pfdev, mapping->mmu,
-				 mapping->mmnode.start << PAGE_SHIFT, len);
+	if (flush_end)
+		panfrost_mmu_flush_range(pfdev, mapping->mmu, flush_start,
+					 flush_end - flush_start);
 	mapping->active = false;
 }
 
@@ -524,6 +583,8 @@ static int panfrost_mmu_map_fault_addr(struct panfrost_device *pfdev, int as,
 
 	mmu_map_sg(pfdev, bomapping->mmu, addr,
 		   IOMMU_WRITE | IOMMU_READ | IOMMU_NOEXEC, sgt);
+	/* the faulting job is waiting for these pages, flush right away */
+	panfrost_mmu_flush_range(pfdev, bomapping->mmu, addr, SZ_2M);
 
 	bomapping->active = true;
 
@@ -1,14 +1,20 @@
 // SPDX-License-Identifier: GPL-2.0
 /* Copyright 2019 Collabora Ltd */
 
+#include <drm/drm_drv.h>
 #include <drm/drm_file.h>
 #include <drm/drm_gem_shmem_helper.h>
 #include <drm/panfrost_drm.h>
+#include <linux/anon_inodes.h>
 #include <linux/completion.h>
+#include <linux/file.h>
 #include <linux/iopoll.h>
+#include <linux/poll.h>
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
 
 #include "panfrost_device.h"
 #include "panfrost_features.h"
@@ -24,6 +30,13 @@
 #define BLOCKS_PER_COREGROUP		8
 #define V4_SHADERS_PER_COREGROUP	4
 
+/*
+ * Number of dump slots in the perfcnt BO. Manual dumps always use slot 0,
+ * periodic sampling cycles through all of them.
+ */
+#define PERFCNT_RING_SLOTS		16
+#define PERFCNT_MAX_PERIOD_MS		10000
+
 struct panfrost_perfcnt {
 	struct panfrost_gem_mapping *mapping;
 	size_t bosize;
@@ -31,6 +44,20 @@ struct panfrost_perfcnt {
 	struct panfrost_file_priv *user;
 	struct mutex lock;
 	struct completion dump_comp;
+
+	/*
+	 * Periodic sampling state, protected by lock. head and tail are
+	 * free-running slot counters, the ring is full when they are
+	 * PERFCNT_RING_SLOTS apart.
+	 */
+	struct file *stream;
+	struct delayed_work sample_work;
+	unsigned long period;
+	u32 head;
+	u32 tail;
+	u32 lost;
+	u64 timestamps[PERFCNT_RING_SLOTS];
+	wait_queue_head_t stream_wq;
 };
 
 void panfrost_perfcnt_clean_cache_done(struct panfrost_device *pfdev)
@@ -43,13 +70,15 @@ void panfrost_perfcnt_sample_done(struct panfrost_device *pfdev)
 	gpu_write(pfdev, GPU_CMD, GPU_CMD_CLEAN_CACHES);
 }
 
-static int panfrost_perfcnt_dump_locked(struct panfrost_device *pfdev)
+static int panfrost_perfcnt_dump_locked(struct panfrost_device *pfdev,
+					unsigned int slot)
 {
 	u64 gpuva;
 	int ret;
 
 	reinit_completion(&pfdev->perfcnt->dump_comp);
 	gpuva = pfdev->perfcnt->mapping->mmnode.start << PAGE_SHIFT;
+	gpuva += slot * pfdev->perfcnt->bosize;
 	gpu_write(pfdev, GPU_PERFCNT_BASE_LO, gpuva);
 	gpu_write(pfdev, GPU_PERFCNT_BASE_HI, gpuva >> 32);
 	gpu_write(pfdev, GPU_INT_CLEAR,
@@ -66,6 +95,162 @@ static int panfrost_perfcnt_dump_locked(struct panfrost_device *pfdev)
 	return ret;
 }
 
+static void panfrost_perfcnt_stream_stop_locked(struct panfrost_perfcnt *perfcnt)
+{
+	if (!perfcnt->stream)
+		return;
+
+	/*
+	 * A sample work already running will see stream == NULL once it gets
+	 * the lock and bail out without re-arming itself.
+	 */
+	WRITE_ONCE(perfcnt->stream, NULL);
+	cancel_delayed_work(&perfcnt->sample_work);
+	wake_up_interruptible_all(&perfcnt->stream_wq);
+}
+
+static void panfrost_perfcnt_sample_work(struct work_struct *work)
+{
+	struct panfrost_perfcnt *perfcnt =
+		container_of(to_delayed_work(work), struct panfrost_perfcnt,
+			     sample_work);
+	struct panfrost_device *pfdev;
+	unsigned int slot;
+
+	mutex_lock(&perfcnt->lock);
+	if (!perfcnt->stream)
+		goto out;
+
+	pfdev = perfcnt->user->pfdev;
+
+	/* Never let the GPU overwrite a sample userspace hasn't read yet. */
+	if (perfcnt->head - perfcnt->tail == PERFCNT_RING_SLOTS) {
+		perfcnt->lost++;
+	} else {
+		slot = perfcnt->head % PERFCNT_RING_SLOTS;
+		if (!panfrost_perfcnt_dump_locked(pfdev, slot)) {
+			perfcnt->timestamps[slot] = ktime_get_ns();
+			WRITE_ONCE(perfcnt->head, perfcnt->head + 1);
+			wake_up_interruptible(&perfcnt->stream_wq);
+		} else {
+			perfcnt->lost++;
+		}
+	}
+
+	schedule_delayed_work(&perfcnt->sample_work, perfcnt->period);
+out:
+	mutex_unlock(&perfcnt->lock);
+}
+
+static bool panfrost_perfcnt_stream_ready(struct panfrost_perfcnt *perfcnt,
+					  struct file *file)
+{
+	return READ_ONCE(perfcnt->stream) != file ||
+	       READ_ONCE(perfcnt->head) != READ_ONCE(perfcnt->tail);
+}
+
+static ssize_t panfrost_perfcnt_stream_read(struct file *file,
+					    char __user *buf, size_t count,
+					    loff_t *ppos)
+{
+	struct panfrost_device *pfdev = file->private_data;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct drm_panfrost_perfcnt_sample hdr = {};
+	size_t sample_size = sizeof(hdr) + perfcnt->bosize;
+	ssize_t done = 0;
+	unsigned int slot;
+	int ret;
+
+	if (count < sample_size)
+		return -EINVAL;
+
+	mutex_lock(&perfcnt->lock);
+	while (perfcnt->stream == file && perfcnt->head == perfcnt->tail) {
+		mutex_unlock(&perfcnt->lock);
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		ret = wait_event_interruptible(perfcnt->stream_wq,
+				panfrost_perfcnt_stream_ready(perfcnt, file));
+		if (ret)
+			return ret;
+
+		mutex_lock(&perfcnt->lock);
+	}
+
+	/* Sampling was stopped because perfcnt got disabled: EOF. */
+	if (perfcnt->stream != file)
+		goto out;
+
+	while (count >= sample_size && perfcnt->tail != perfcnt->head) {
+		slot = perfcnt->tail % PERFCNT_RING_SLOTS;
+		hdr.timestamp = perfcnt->timestamps[slot];
+		hdr.size = perfcnt->bosize;
+		hdr.lost = perfcnt->lost;
+
+		if (copy_to_user(buf + done, &hdr, sizeof(hdr)) ||
+		    copy_to_user(buf + done + sizeof(hdr),
+				 perfcnt->buf + slot * perfcnt->bosize,
+				 perfcnt->bosize)) {
+			if (!done)
+				done = -EFAULT;
+			break;
+		}
+
+		perfcnt->lost = 0;
+		WRITE_ONCE(perfcnt->tail, perfcnt->tail + 1);
+		done += sample_size;
+		count -= sample_size;
+	}
+
+out:
+	mutex_unlock(&perfcnt->lock);
+
+	return done;
+}
+
+static __poll_t panfrost_perfcnt_stream_poll(struct file *file,
+					     struct poll_table_struct *wait)
+{
+	struct panfrost_device *pfdev = file->private_data;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	__poll_t mask = 0;
+
+	poll_wait(file, &perfcnt->stream_wq, wait);
+
+	if (READ_ONCE(perfcnt->stream) != file)
+		mask |= EPOLLHUP;
+	else if (READ_ONCE(perfcnt->head) != READ_ONCE(perfcnt->tail))
+		mask |= EPOLLIN | EPOLLRDNORM;
+
+	return mask;
+}
+
+static int panfrost_perfcnt_stream_release(struct inode *inode,
+					   struct file *file)
+{
+	struct panfrost_device *pfdev = file->private_data;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->stream == file)
+		panfrost_perfcnt_stream_stop_locked(perfcnt);
+	mutex_unlock(&perfcnt->lock);
+
+	drm_dev_put(pfdev->ddev);
+
+	return 0;
+}
+
+static const struct file_operations panfrost_perfcnt_stream_fops = {
+	.owner		= THIS_MODULE,
+	.read		= panfrost_perfcnt_stream_read,
+	.poll		= panfrost_perfcnt_stream_poll,
+	.release	= panfrost_perfcnt_stream_release,
+	.llseek		= no_llseek,
+};
+
 static int panfrost_perfcnt_enable_locked(struct panfrost_device *pfdev,
 					  struct drm_file *file_priv,
 					  unsigned int counterset)
@@ -85,7 +270,8 @@ static int panfrost_perfcnt_enable_locked(struct panfrost_device *pfdev,
 	if (ret < 0)
 		return ret;
 
-	bo = drm_gem_shmem_create(pfdev->ddev, perfcnt->bosize);
+	bo = drm_gem_shmem_create(pfdev->ddev,
+				  perfcnt->bosize * PERFCNT_RING_SLOTS);
 	if (IS_ERR(bo))
 		return PTR_ERR(bo);
 
@@ -180,6 +366,8 @@ static int panfrost_perfcnt_disable_locked(struct panfrost_device *pfdev,
 	if (user != perfcnt->user)
 		return -EINVAL;
 
+	panfrost_perfcnt_stream_stop_locked(perfcnt);
+
 	gpu_write(pfdev, GPU_PRFCNT_JM_EN, 0x0);
 	gpu_write(pfdev, GPU_PRFCNT_SHADER_EN, 0x0);
 	gpu_write(pfdev, GPU_PRFCNT_MMU_L2_EN, 0x0);
@@ -246,7 +434,13 @@ int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 		goto out;
 	}
 
-	ret = panfrost_perfcnt_dump_locked(pfdev);
+	/* Slot 0 belongs to the ring while periodic sampling is active. */
+	if (perfcnt->stream) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = panfrost_perfcnt_dump_locked(pfdev, 0);
 	if (ret)
 		goto out;
 
@@ -259,6 +453,71 @@ int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 	return ret;
 }
 
+int panfrost_ioctl_perfcnt_stream(struct drm_device *dev, void *data,
+				  struct drm_file *file_priv)
+{
+	struct panfrost_device *pfdev = dev->dev_private;
+	struct panfrost_perfcnt *perfcnt = pfdev->perfcnt;
+	struct drm_panfrost_perfcnt_stream *req = data;
+	struct file *file;
+	int ret, fd;
+
+	ret = panfrost_unstable_ioctl_check();
+	if (ret)
+		return ret;
+
+	if (req->flags || req->pad || !req->period_ms ||
+	    req->period_ms > PERFCNT_MAX_PERIOD_MS)
+		return -EINVAL;
+
+	mutex_lock(&perfcnt->lock);
+	if (perfcnt->user != file_priv->driver_priv) {
+		ret = -EINVAL;
+		goto err_unlock;
+	}
+
+	if (perfcnt->stream) {
+		ret = -EBUSY;
+		goto err_unlock;
+	}
+
+	fd = get_unused_fd_flags(O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		ret = fd;
+		goto err_unlock;
+	}
+
+	file = anon_inode_getfile("[panfrost_perfcnt]",
+				  &panfrost_perfcnt_stream_fops, pfdev,
+				  O_RDONLY);
+	if (IS_ERR(file)) {
+		ret = PTR_ERR(file);
+		goto err_put_fd;
+	}
+
+	/* Dropped by the stream file release. */
+	drm_dev_get(dev);
+
+	perfcnt->head = 0;
+	perfcnt->tail = 0;
+	perfcnt->lost = 0;
+	perfcnt->period = msecs_to_jiffies(req->period_ms);
+	WRITE_ONCE(perfcnt->stream, file);
+	schedule_delayed_work(&perfcnt->sample_work, perfcnt->period);
+	mutex_unlock(&perfcnt->lock);
+
+	fd_install(fd, file);
+	req->fd = fd;
+
+	return 0;
+
+err_put_fd:
+	put_unused_fd(fd);
+err_unlock:
+	mutex_unlock(&perfcnt->lock);
+	return ret;
+}
+
 void panfrost_perfcnt_close(struct drm_file *file_priv)
 {
 	struct panfrost_file_priv *pfile = file_priv->driver_priv;
@@ -325,6 +584,8 @@ int panfrost_perfcnt_init(struct panfrost_device *pfdev)
 
 	init_completion(&perfcnt->dump_comp);
 	mutex_init(&perfcnt->lock);
+	INIT_DELAYED_WORK(&perfcnt->sample_work, panfrost_perfcnt_sample_work);
+	init_waitqueue_head(&perfcnt->stream_wq);
 	pfdev->perfcnt = perfcnt;
 
 	return 0;
@@ -332,6 +593,8 @@ int panfrost_perfcnt_init(struct panfrost_device *pfdev)
 
 void panfrost_perfcnt_fini(struct panfrost_device *pfdev)
 {
+	cancel_delayed_work_sync(&pfdev->perfcnt->sample_work);
+
 	/* Disable everything before leaving. */
 	gpu_write(pfdev, GPU_PERFCNT_CFG,
 		  GPU_PERFCNT_CFG_MODE(GPU_PERFCNT_CFG_MODE_OFF));
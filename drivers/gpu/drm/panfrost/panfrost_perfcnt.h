@@ -14,5 +14,7 @@ int panfrost_ioctl_perfcnt_enable(struct drm_device *dev, void *data,
 				  struct drm_file *file_priv);
 int panfrost_ioctl_perfcnt_dump(struct drm_device *dev, void *data,
 				struct drm_file *file_priv);
+int panfrost_ioctl_perfcnt_stream(struct drm_device *dev, void *data,
+				  struct drm_file *file_priv);
 
 #endif
@@ -502,6 +502,10 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job,
 		}
 		drm_sched_rq_add_entity(entity->rq, entity);
 		spin_unlock(&entity->rq_lock);
+
+		if (drm_sched_direct_submit(entity))
+			return;
+
 		drm_sched_wakeup(entity->rq->sched);
 	}
 }
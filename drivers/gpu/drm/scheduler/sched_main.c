@@ -376,6 +376,11 @@ void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad)
 {
 	struct drm_sched_job *s_job, *tmp;
 
+	/* Keep drm_sched_direct_submit() away until drm_sched_start(). */
+	mutex_lock(&sched->run_lock);
+	sched->direct_blocked = true;
+	mutex_unlock(&sched->run_lock);
+
 	kthread_park(sched->thread);
 
 	/*
@@ -487,6 +492,10 @@ void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery)
 	}
 
 	kthread_unpark(sched->thread);
+
+	mutex_lock(&sched->run_lock);
+	sched->direct_blocked = false;
+	mutex_unlock(&sched->run_lock);
 }
 EXPORT_SYMBOL(drm_sched_start);
 
@@ -734,6 +743,93 @@ drm_sched_pick_best(struct drm_gpu_scheduler **sched_list,
 }
 EXPORT_SYMBOL(drm_sched_pick_best);
 
+/**
+ * drm_sched_run_job - hand a job over to the hardware
+ *
+ * @sched: scheduler instance
+ * @entity: entity the job was popped from
+ * @sched_job: job to run
+ *
+ * Must be called with @sched->run_lock held.
+ */
+static void drm_sched_run_job(struct drm_gpu_scheduler *sched,
+			      struct drm_sched_entity *entity,
+			      struct drm_sched_job *sched_job)
+{
+	struct drm_sched_fence *s_fence = sched_job->s_fence;
+	struct dma_fence *fence;
+	int r;
+
+	atomic_inc(&sched->hw_rq_count);
+	drm_sched_job_begin(sched_job);
+
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	drm_sched_fence_scheduled(s_fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		s_fence->parent = dma_fence_get(fence);
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_process_job);
+		if (r == -ENOENT)
+			drm_sched_process_job(fence, &sched_job->cb);
+		else if (r)
+			DRM_ERROR("fence add callback failed (%d)\n",
+				  r);
+		dma_fence_put(fence);
+	} else {
+		if (IS_ERR(fence))
+			dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
+
+		drm_sched_process_job(NULL, &sched_job->cb);
+	}
+
+	wake_up(&sched->job_scheduled);
+}
+
+/**
+ * drm_sched_direct_submit - run a just pushed job from the caller's context
+ *
+ * @entity: entity the job was pushed to
+ *
+ * When the scheduler opted in with @direct_submit and the pushed job is the
+ * only one known to it, the ring is idle and there is nobody to be fair
+ * to, so run the job right away instead of waking up the scheduler thread.
+ * Jobs with unsignaled dependencies are left to the thread, which gets
+ * woken up by the dependency callback as usual.
+ *
+ * Returns true if the job was handed to the hardware, false otherwise.
+ */
+bool drm_sched_direct_submit(struct drm_sched_entity *entity)
+{
+	struct drm_gpu_scheduler *sched = entity->rq->sched;
+	struct drm_sched_job *sched_job;
+	bool ret = false;
+
+	if (!sched->direct_submit || !sched->ready ||
+	    atomic_read(&sched->num_jobs) != 1)
+		return false;
+
+	/* The scheduler thread is busy, let it pick the job up. */
+	if (!mutex_trylock(&sched->run_lock))
+		return false;
+
+	if (sched->direct_blocked || atomic_read(&sched->num_jobs) != 1 ||
+	    !drm_sched_ready(sched))
+		goto out;
+
+	sched_job = drm_sched_entity_pop_job(entity);
+	if (!sched_job)
+		goto out;
+
+	drm_sched_run_job(sched, entity, sched_job);
+	ret = true;
+out:
+	mutex_unlock(&sched->run_lock);
+
+	return ret;
+}
+
 /**
  * drm_sched_blocked - check if the scheduler is blocked
  *
@@ -762,15 +858,12 @@ static int drm_sched_main(void *param)
 {
 	struct sched_param sparam = {.sched_priority = 1};
 	struct drm_gpu_scheduler *sched = (struct drm_gpu_scheduler *)param;
-	int r;
 
 	sched_setscheduler(current, SCHED_FIFO, &sparam);
 
 	while (!kthread_should_stop()) {
 		struct drm_sched_entity *entity = NULL;
-		struct drm_sched_fence *s_fence;
 		struct drm_sched_job *sched_job;
-		struct dma_fence *fence;
 		struct drm_sched_job *cleanup_job = NULL;
 
 		wait_event_interruptible(sched->wake_up_worker,
@@ -788,40 +881,18 @@ static int drm_sched_main(void *param)
 		if (!entity)
 			continue;
 
+		/*
+		 * Serialize against drm_sched_direct_submit(), which may have
+		 * popped the job from under us already.
+		 */
+		mutex_lock(&sched->run_lock);
 		sched_job = drm_sched_entity_pop_job(entity);
 
 		complete(&entity->entity_idle);
 
-		if (!sched_job)
-			continue;
-
-		s_fence = sched_job->s_fence;
-
-		atomic_inc(&sched->hw_rq_count);
-		drm_sched_job_begin(sched_job);
-
-		trace_drm_run_job(sched_job, entity);
-		fence = sched->ops->run_job(sched_job);
-		drm_sched_fence_scheduled(s_fence);
-
-		if (!IS_ERR_OR_NULL(fence)) {
-			s_fence->parent = dma_fence_get(fence);
-			r = dma_fence_add_callback(fence, &sched_job->cb,
-						   drm_sched_process_job);
-			if (r == -ENOENT)
-				drm_sched_process_job(fence, &sched_job->cb);
-			else if (r)
-				DRM_ERROR("fence add callback failed (%d)\n",
-					  r);
-			dma_fence_put(fence);
-		} else {
-			if (IS_ERR(fence))
-				dma_fence_set_error(&s_fence->finished, PTR_ERR(fence));
-
-			drm_sched_process_job(NULL, &sched_job->cb);
-		}
-
-		wake_up(&sched->job_scheduled);
+		if (sched_job)
+			drm_sched_run_job(sched, entity, sched_job);
+		mutex_unlock(&sched->run_lock);
 	}
 	return 0;
 }
@@ -858,6 +929,7 @@ int drm_sched_init(struct drm_gpu_scheduler *sched,
 	init_waitqueue_head(&sched->job_scheduled);
 	INIT_LIST_HEAD(&sched->ring_mirror_list);
 	spin_lock_init(&sched->job_list_lock);
+	mutex_init(&sched->run_lock);
 	atomic_set(&sched->hw_rq_count, 0);
 	INIT_DELAYED_WORK(&sched->work_tdr, drm_sched_job_timedout);
 	atomic_set(&sched->num_jobs, 0);
@@ -101,7 +101,7 @@ static struct hid_field *hid_register_field(struct hid_report *report, unsigned
 
 	field = kzalloc((sizeof(struct hid_field) +
 			 usages * sizeof(struct hid_usage) +
-			 values * sizeof(unsigned)), GFP_KERNEL);
+			 2 * values * sizeof(unsigned)), GFP_KERNEL);
 	if (!field)
 		return NULL;
 
@@ -109,6 +109,7 @@ static struct hid_field *hid_register_field(struct hid_report *report, unsigned
 	report->field[field->index] = field;
 	field->usage = (struct hid_usage *)(field + 1);
 	field->value = (s32 *)(field->usage + usages);
+	field->new_value = (s32 *)(field->value + values);
 	field->report = report;
 
 	return field;
@@ -250,6 +251,27 @@ static int hid_add_usage(struct hid_parser *parser, unsigned usage, u8 size)
 	return 0;
 }
 
+/*
+ * Pick the cheapest way hid_input_field() can read this field's values.
+ */
+
+static unsigned hid_field_extract_type(const struct hid_field *field)
+{
+	if (field->report_offset % 8)
+		return HID_EXTRACT_GENERIC;
+
+	switch (field->report_size) {
+	case 8:
+		return HID_EXTRACT_8;
+	case 16:
+		return HID_EXTRACT_16;
+	case 32:
+		return HID_EXTRACT_32;
+	default:
+		return HID_EXTRACT_GENERIC;
+	}
+}
+
 /*
  * Register a new field for this report.
  */
@@ -332,6 +354,7 @@ static int hid_add_field(struct hid_parser *parser, unsigned report_type, unsign
 	field->physical_maximum = parser->global.physical_maximum;
 	field->unit_exponent = parser->global.unit_exponent;
 	field->unit = parser->global.unit;
+	field->extract = hid_field_extract_type(field);
 
 	return 0;
 }
@@ -1514,6 +1537,47 @@ static void hid_process_event(struct hid_device *hid, struct hid_field *field,
 		hid->hiddev_hid_event(hid, field, usage, value);
 }
 
+/*
+ * Read all values of a field into field->new_value.
+ */
+
+static void hid_input_fetch_field(struct hid_device *hid,
+				  struct hid_field *field, __u8 *data)
+{
+	unsigned n;
+	unsigned count = field->report_count;
+	unsigned offset = field->report_offset;
+	unsigned size = field->report_size;
+	bool is_signed = field->logical_minimum < 0;
+	__s32 *value = field->new_value;
+	__u8 *p = data + offset / 8;
+
+	switch (field->extract) {
+	case HID_EXTRACT_8:
+		for (n = 0; n < count; n++)
+			value[n] = is_signed ? (s8)p[n] : p[n];
+		break;
+	case HID_EXTRACT_16:
+		for (n = 0; n < count; n++, p += 2)
+			value[n] = is_signed ? (s16)get_unaligned_le16(p) :
+					       get_unaligned_le16(p);
+		break;
+	case HID_EXTRACT_32:
+		for (n = 0; n < count; n++, p += 4)
+			value[n] = get_unaligned_le32(p);
+		break;
+	default:
+		for (n = 0; n < count; n++)
+			value[n] = is_signed ?
+				snto32(hid_field_extract(hid, data,
+							 offset + n * size,
+							 size), size) :
+				hid_field_extract(hid, data, offset + n * size,
+						  size);
+		break;
+	}
+}
+
 /*
  * Analyse a received field, and fetch the data from it. The field
  * content is stored for next report processing (we do differential
@@ -1525,38 +1589,29 @@ static void hid_input_field(struct hid_device *hid, struct hid_field *field,
 {
 	unsigned n;
 	unsigned count = field->report_count;
-	unsigned offset = field->report_offset;
-	unsigned size = field->report_size;
 	__s32 min = field->logical_minimum;
 	__s32 max = field->logical_maximum;
-	__s32 *value;
+	__s32 *value = field->new_value;
 
-	value = kmalloc_array(count, sizeof(__s32), GFP_ATOMIC);
-	if (!value)
-		return;
+	hid_input_fetch_field(hid, field, data);
 
-	for (n = 0; n < count; n++) {
-
-		value[n] = min < 0 ?
-			snto32(hid_field_extract(hid, data, offset + n * size,
-			       size), size) :
-			hid_field_extract(hid, data, offset + n * size, size);
+	if (HID_MAIN_ITEM_VARIABLE & field->flags) {
+		for (n = 0; n < count; n++)
+			hid_process_event(hid, field, &field->usage[n],
+					  value[n], interrupt);
+		goto out;
+	}
 
-		/* Ignore report if ErrorRollOver */
-		if (!(field->flags & HID_MAIN_ITEM_VARIABLE) &&
-		    value[n] >= min && value[n] <= max &&
+	/* Ignore report if ErrorRollOver */
+	for (n = 0; n < count; n++) {
+		if (value[n] >= min && value[n] <= max &&
 		    value[n] - min < field->maxusage &&
 		    field->usage[value[n] - min].hid == HID_UP_KEYBOARD + 1)
-			goto exit;
+			return;
 	}
 
 	for (n = 0; n < count; n++) {
 
-		if (HID_MAIN_ITEM_VARIABLE & field->flags) {
-			hid_process_event(hid, field, &field->usage[n], value[n], interrupt);
-			continue;
-		}
-
 		if (field->value[n] >= min && field->value[n] <= max
 			&& field->value[n] - min < field->maxusage
 			&& field->usage[field->value[n] - min].hid
@@ -1570,9 +1625,8 @@ static void hid_input_field(struct hid_device *hid, struct hid_field *field,
 				hid_process_event(hid, field, &field->usage[value[n] - min], 1, interrupt);
 	}
 
+out:
 	memcpy(field->value, value, count * sizeof(__s32));
-exit:
-	kfree(value);
 }
 
 /*
@@ -40,6 +40,10 @@
 
 #define I2C_TIMEOUT_MS		500
 
+/* The token list holds 16 tokens, and the data registers 8 bytes */
+#define MESON_I2C_MAX_TOKENS	16
+#define MESON_I2C_MAX_DATA	8
+
 enum {
 	TOKEN_END = 0,
 	TOKEN_START,
@@ -192,7 +196,11 @@ static void meson_i2c_prepare_xfer(struct meson_i2c *i2c)
 	bool write = !(i2c->msg->flags & I2C_M_RD);
 	int i;
 
-	i2c->count = min(i2c->msg->len - i2c->pos, 8);
+	i2c->count = min(i2c->msg->len - i2c->pos, MESON_I2C_MAX_DATA);
+
+	/* Leave room in the list for what is already there, and the STOP */
+	i2c->count = min(i2c->count,
+			 MESON_I2C_MAX_TOKENS - 1 - i2c->num_tokens);
 
 	for (i = 0; i < i2c->count - 1; i++)
 		meson_i2c_add_token(i2c, TOKEN_DATA);
@@ -285,8 +293,36 @@ static void meson_i2c_do_start(struct meson_i2c *i2c, struct i2c_msg *msg)
 	meson_i2c_add_token(i2c, token);
 }
 
+/*
+ * A short write followed by a read from the same device, the usual
+ * register read, is queued as a single token list: the write data, the
+ * repeated START and the first bytes of the read fit in one go, saving
+ * an interrupt round trip per access.
+ */
+static bool meson_i2c_can_combine(struct i2c_msg *wmsg, struct i2c_msg *rmsg)
+{
+	u16 flags = I2C_M_NOSTART | I2C_M_IGNORE_NAK | I2C_M_RECV_LEN;
+
+	return !(wmsg->flags & (I2C_M_RD | flags)) &&
+	       (rmsg->flags & I2C_M_RD) && !(rmsg->flags & flags) &&
+	       wmsg->addr == rmsg->addr &&
+	       wmsg->len <= MESON_I2C_MAX_DATA;
+}
+
+static void meson_i2c_queue_write(struct meson_i2c *i2c, struct i2c_msg *wmsg)
+{
+	int i;
+
+	meson_i2c_do_start(i2c, wmsg);
+
+	for (i = 0; i < wmsg->len; i++)
+		meson_i2c_add_token(i2c, TOKEN_DATA);
+
+	meson_i2c_put_data(i2c, wmsg->buf, wmsg->len);
+}
+
 static int meson_i2c_xfer_msg(struct meson_i2c *i2c, struct i2c_msg *msg,
-			      int last, bool atomic)
+			      struct i2c_msg *wmsg, int last, bool atomic)
 {
 	unsigned long time_left, flags;
 	int ret = 0;
@@ -303,6 +339,9 @@ static int meson_i2c_xfer_msg(struct meson_i2c *i2c, struct i2c_msg *msg,
 	flags = (msg->flags & I2C_M_IGNORE_NAK) ? REG_CTRL_ACK_IGNORE : 0;
 	meson_i2c_set_mask(i2c, REG_CTRL, REG_CTRL_ACK_IGNORE, flags);
 
+	if (wmsg)
+		meson_i2c_queue_write(i2c, wmsg);
+
 	if (!(msg->flags & I2C_M_NOSTART))
 		meson_i2c_do_start(i2c, msg);
 
@@ -355,12 +394,18 @@ static int meson_i2c_xfer_messages(struct i2c_adapter *adap,
 				   struct i2c_msg *msgs, int num, bool atomic)
 {
 	struct meson_i2c *i2c = adap->algo_data;
+	struct i2c_msg *wmsg;
 	int i, ret = 0;
 
 	clk_enable(i2c->clk);
 
 	for (i = 0; i < num; i++) {
-		ret = meson_i2c_xfer_msg(i2c, msgs + i, i == num - 1, atomic);
+		wmsg = NULL;
+		if (i + 1 < num && meson_i2c_can_combine(msgs + i, msgs + i + 1))
+			wmsg = msgs + i++;
+
+		ret = meson_i2c_xfer_msg(i2c, msgs + i, wmsg, i == num - 1,
+					 atomic);
 		if (ret)
 			break;
 	}
@@ -11,6 +11,10 @@
 #include <linux/delay.h>
 #include <linux/io.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/buffer.h>
+#include <linux/iio/trigger.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/module.h>
 #include <linux/nvmem-consumer.h>
 #include <linux/interrupt.h>
@@ -160,6 +164,8 @@
 	#define MESON_SAR_ADC_REG13_12BIT_CALIBRATION_MASK	GENMASK(13, 8)
 
 #define MESON_SAR_ADC_MAX_FIFO_SIZE				32
+#define MESON_SAR_ADC_NUM_CHANNELS				8
+#define MESON_SAR_ADC_FIFO_WATERMARK				16
 #define MESON_SAR_ADC_TIMEOUT					100 /* ms */
 #define MESON_SAR_ADC_VOLTAGE_AND_TEMP_CHANNEL			6
 #define MESON_SAR_ADC_TEMP_OFFSET				27
@@ -186,6 +192,13 @@
 	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_CALIBBIAS) |	\
 				BIT(IIO_CHAN_INFO_CALIBSCALE),		\
 	.datasheet_name = "SAR_ADC_CH"#_chan,				\
+	.scan_index = _chan,						\
+	.scan_type = {							\
+		.sign = 'u',						\
+		.realbits = 12,						\
+		.storagebits = 16,					\
+		.endianness = IIO_CPU,					\
+	},								\
 }
 
 #define MESON_SAR_ADC_TEMP_CHAN(_chan) {				\
@@ -199,6 +212,7 @@
 	.info_mask_shared_by_all = BIT(IIO_CHAN_INFO_CALIBBIAS) |	\
 				BIT(IIO_CHAN_INFO_CALIBSCALE),		\
 	.datasheet_name = "TEMP_SENSOR",				\
+	.scan_index = -1,						\
 }
 
 static const struct iio_chan_spec meson_sar_adc_iio_channels[] = {
@@ -282,6 +296,14 @@ struct meson_sar_adc_priv {
 	bool					temperature_sensor_calibrated;
 	u8					temperature_sensor_coefficient;
 	u16					temperature_sensor_adc_val;
+	struct iio_trigger			*trig;
+	u8					scan_chan[MESON_SAR_ADC_NUM_CHANNELS];
+	unsigned int				scan_len;
+	unsigned int				scan_pos;
+	struct {
+		u16				data[MESON_SAR_ADC_NUM_CHANNELS];
+		s64				ts __aligned(8);
+	} scan;
 };
 
 static const struct regmap_config meson_sar_adc_regmap_config_gxbb = {
@@ -289,6 +311,7 @@ static const struct regmap_config meson_sar_adc_regmap_config_gxbb = {
 	.val_bits = 32,
 	.reg_stride = 4,
 	.max_register = MESON_SAR_ADC_REG13,
+	.use_relaxed_mmio = true,
 };
 
 static const struct regmap_config meson_sar_adc_regmap_config_meson8 = {
@@ -296,6 +319,7 @@ static const struct regmap_config meson_sar_adc_regmap_config_meson8 = {
 	.val_bits = 32,
 	.reg_stride = 4,
 	.max_register = MESON_SAR_ADC_DELTA_10,
+	.use_relaxed_mmio = true,
 };
 
 static unsigned int meson_sar_adc_get_fifo_count(struct iio_dev *indio_dev)
@@ -487,13 +511,11 @@ static void meson_sar_adc_stop_sample_engine(struct iio_dev *indio_dev)
 			   MESON_SAR_ADC_REG0_SAMPLE_ENGINE_ENABLE, 0);
 }
 
-static int meson_sar_adc_lock(struct iio_dev *indio_dev)
+static int meson_sar_adc_bl30_lock(struct iio_dev *indio_dev)
 {
 	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
 	int val, timeout = 10000;
 
-	mutex_lock(&indio_dev->mlock);
-
 	if (priv->param->has_bl30_integration) {
 		/* prevent BL30 from using the SAR ADC while we are using it */
 		regmap_update_bits(priv->regmap, MESON_SAR_ADC_DELAY,
@@ -509,16 +531,14 @@ static int meson_sar_adc_lock(struct iio_dev *indio_dev)
 			regmap_read(priv->regmap, MESON_SAR_ADC_DELAY, &val);
 		} while (val & MESON_SAR_ADC_DELAY_BL30_BUSY && timeout--);
 
-		if (timeout < 0) {
-			mutex_unlock(&indio_dev->mlock);
+		if (timeout < 0)
 			return -ETIMEDOUT;
-		}
 	}
 
 	return 0;
 }
 
-static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
+static void meson_sar_adc_bl30_unlock(struct iio_dev *indio_dev)
 {
 	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
 
@@ -526,6 +546,24 @@ static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
 		/* allow BL30 to use the SAR ADC again */
 		regmap_update_bits(priv->regmap, MESON_SAR_ADC_DELAY,
 				MESON_SAR_ADC_DELAY_KERNEL_BUSY, 0);
+}
+
+static int meson_sar_adc_lock(struct iio_dev *indio_dev)
+{
+	int ret;
+
+	mutex_lock(&indio_dev->mlock);
+
+	ret = meson_sar_adc_bl30_lock(indio_dev);
+	if (ret)
+		mutex_unlock(&indio_dev->mlock);
+
+	return ret;
+}
+
+static void meson_sar_adc_unlock(struct iio_dev *indio_dev)
+{
+	meson_sar_adc_bl30_unlock(indio_dev);
 
 	mutex_unlock(&indio_dev->mlock);
 }
@@ -559,6 +597,12 @@ static int meson_sar_adc_get_sample(struct iio_dev *indio_dev,
 	if (ret)
 		return ret;
 
+	/* the sample engine is owned by the buffer while it is enabled */
+	if (iio_buffer_enabled(indio_dev)) {
+		meson_sar_adc_unlock(indio_dev);
+		return -EBUSY;
+	}
+
 	/* clear the FIFO to make sure we're not reading old values */
 	meson_sar_adc_clear_fifo(indio_dev);
 
@@ -582,6 +626,183 @@ static int meson_sar_adc_get_sample(struct iio_dev *indio_dev,
 	return IIO_VAL_INT;
 }
 
+static int meson_sar_adc_enable_scan(struct iio_dev *indio_dev)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	unsigned int bit, i = 0;
+	u32 regval;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		const struct iio_chan_spec *chan = &indio_dev->channels[bit];
+
+		if (chan->type != IIO_VOLTAGE)
+			continue;
+
+		meson_sar_adc_set_averaging(indio_dev, chan, NO_AVERAGING,
+					    ONE_SAMPLE);
+
+		regval = FIELD_PREP(MESON_SAR_ADC_CHAN_LIST_ENTRY_MASK(i),
+				    chan->address);
+		regmap_update_bits(priv->regmap, MESON_SAR_ADC_CHAN_LIST,
+				   MESON_SAR_ADC_CHAN_LIST_ENTRY_MASK(i), regval);
+
+		/* channel 6 must sample the input, not the temperature sensor */
+		if (chan->address == MESON_SAR_ADC_VOLTAGE_AND_TEMP_CHANNEL)
+			regmap_update_bits(priv->regmap,
+					   MESON_SAR_ADC_DELTA_10,
+					   MESON_SAR_ADC_DELTA_10_TEMP_SEL, 0);
+
+		priv->scan_chan[i++] = chan->address;
+	}
+
+	/* a timestamp alone gives the sample engine nothing to do */
+	if (!i)
+		return -EINVAL;
+
+	priv->scan_len = i;
+	priv->scan_pos = 0;
+
+	regval = FIELD_PREP(MESON_SAR_ADC_CHAN_LIST_MAX_INDEX_MASK, i - 1);
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_CHAN_LIST,
+			   MESON_SAR_ADC_CHAN_LIST_MAX_INDEX_MASK, regval);
+
+	/* only interrupt once a few complete rounds are in the FIFO */
+	regval = FIELD_PREP(MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK,
+			    rounddown(MESON_SAR_ADC_FIFO_WATERMARK, i));
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, regval);
+
+	return 0;
+}
+
+static int meson_sar_adc_buffer_postenable(struct iio_dev *indio_dev)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	int ret;
+
+	ret = iio_triggered_buffer_postenable(indio_dev);
+	if (ret)
+		return ret;
+
+	/* iio core already holds mlock here, only grab the BL30 lock */
+	ret = meson_sar_adc_bl30_lock(indio_dev);
+	if (ret) {
+		iio_triggered_buffer_predisable(indio_dev);
+		return ret;
+	}
+
+	meson_sar_adc_clear_fifo(indio_dev);
+
+	ret = meson_sar_adc_enable_scan(indio_dev);
+	if (ret) {
+		meson_sar_adc_bl30_unlock(indio_dev);
+		iio_triggered_buffer_predisable(indio_dev);
+		return ret;
+	}
+
+	/* let the sample engine loop over the channel list on its own */
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN);
+
+	meson_sar_adc_start_sample_engine(indio_dev);
+
+	return 0;
+}
+
+static int meson_sar_adc_buffer_predisable(struct iio_dev *indio_dev)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	u32 regval;
+	int ret;
+
+	/* waits for a running trigger handler to finish */
+	ret = iio_triggered_buffer_predisable(indio_dev);
+
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_CONTINUOUS_EN, 0);
+
+	meson_sar_adc_stop_sample_engine(indio_dev);
+
+	meson_sar_adc_clear_fifo(indio_dev);
+
+	/* restore the single conversion setup used by read_raw */
+	regval = FIELD_PREP(MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, 1);
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_FIFO_CNT_IRQ_MASK, regval);
+
+	meson_sar_adc_bl30_unlock(indio_dev);
+
+	return ret;
+}
+
+static const struct iio_buffer_setup_ops meson_sar_adc_buffer_setup_ops = {
+	.postenable = meson_sar_adc_buffer_postenable,
+	.predisable = meson_sar_adc_buffer_predisable,
+};
+
+static irqreturn_t meson_sar_adc_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+	unsigned int count, fifo_chan, fifo_val;
+	u32 regval;
+
+	count = meson_sar_adc_get_fifo_count(indio_dev);
+
+	while (count--) {
+		regmap_read(priv->regmap, MESON_SAR_ADC_FIFO_RD, &regval);
+		fifo_chan = FIELD_GET(MESON_SAR_ADC_FIFO_RD_CHAN_ID_MASK,
+				      regval);
+
+		/*
+		 * samples arrive in channel list order. if we ever get out of
+		 * step (FIFO overrun) drop entries until the next round starts.
+		 */
+		if (fifo_chan != priv->scan_chan[priv->scan_pos])
+			priv->scan_pos = 0;
+		if (fifo_chan != priv->scan_chan[priv->scan_pos])
+			continue;
+
+		fifo_val = FIELD_GET(MESON_SAR_ADC_FIFO_RD_SAMPLE_VALUE_MASK,
+				     regval);
+		fifo_val &= GENMASK(priv->param->resolution - 1, 0);
+		priv->scan.data[priv->scan_pos++] =
+			meson_sar_adc_calib_val(indio_dev, fifo_val);
+
+		if (priv->scan_pos == priv->scan_len) {
+			iio_push_to_buffers_with_timestamp(indio_dev,
+							   &priv->scan,
+							   pf->timestamp);
+			priv->scan_pos = 0;
+		}
+	}
+
+	/* the hard IRQ handler masked the FIFO IRQ until we drained it */
+	regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+			   MESON_SAR_ADC_REG0_FIFO_IRQ_EN,
+			   MESON_SAR_ADC_REG0_FIFO_IRQ_EN);
+
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
+static const struct iio_trigger_ops meson_sar_adc_trigger_ops = {
+	.validate_device = iio_trigger_validate_own_device,
+};
+
+static int meson_sar_adc_validate_trigger(struct iio_dev *indio_dev,
+					  struct iio_trigger *trig)
+{
+	struct meson_sar_adc_priv *priv = iio_priv(indio_dev);
+
+	/* sampling is paced by the hardware, no other trigger makes sense */
+	return priv->trig == trig ? 0 : -EINVAL;
+}
+
 static int meson_sar_adc_iio_info_read_raw(struct iio_dev *indio_dev,
 					   const struct iio_chan_spec *chan,
 					   int *val, int *val2, long mask)
@@ -1021,6 +1242,14 @@ static irqreturn_t meson_sar_adc_irq(int irq, void *data)
 	if (cnt < threshold)
 		return IRQ_NONE;
 
+	if (iio_buffer_enabled(indio_dev)) {
+		/* the FIFO is drained by the trigger handler */
+		regmap_update_bits(priv->regmap, MESON_SAR_ADC_REG0,
+				   MESON_SAR_ADC_REG0_FIFO_IRQ_EN, 0);
+		iio_trigger_poll(priv->trig);
+		return IRQ_HANDLED;
+	}
+
 	complete(&priv->done);
 
 	return IRQ_HANDLED;
@@ -1069,6 +1298,7 @@ static int meson_sar_adc_calib(struct iio_dev *indio_dev)
 
 static const struct iio_info meson_sar_adc_iio_info = {
 	.read_raw = meson_sar_adc_iio_info_read_raw,
+	.validate_trigger = meson_sar_adc_validate_trigger,
 };
 
 static const struct meson_sar_adc_param meson_sar_adc_meson8_param = {
@@ -1222,6 +1452,21 @@ static int meson_sar_adc_probe(struct platform_device *pdev)
 	if (IS_ERR(priv->regmap))
 		return PTR_ERR(priv->regmap);
 
+	priv->trig = devm_iio_trigger_alloc(&pdev->dev, "%s-dev%d",
+					    indio_dev->name, indio_dev->id);
+	if (!priv->trig)
+		return -ENOMEM;
+
+	priv->trig->dev.parent = &pdev->dev;
+	priv->trig->ops = &meson_sar_adc_trigger_ops;
+	iio_trigger_set_drvdata(priv->trig, indio_dev);
+
+	ret = devm_iio_trigger_register(&pdev->dev, priv->trig);
+	if (ret)
+		return ret;
+
+	indio_dev->trig = iio_trigger_get(priv->trig);
+
 	irq = irq_of_parse_and_map(pdev->dev.of_node, 0);
 	if (!irq)
 		return -EINVAL;
@@ -1294,6 +1539,13 @@ static int meson_sar_adc_probe(struct platform_device *pdev)
 			ARRAY_SIZE(meson_sar_adc_iio_channels);
 	}
 
+	ret = devm_iio_triggered_buffer_setup(&pdev->dev, indio_dev,
+					      &iio_pollfunc_store_time,
+					      meson_sar_adc_trigger_handler,
+					      &meson_sar_adc_buffer_setup_ops);
+	if (ret)
+		return ret;
+
 	ret = meson_sar_adc_init(indio_dev);
 	if (ret)
 		goto err;
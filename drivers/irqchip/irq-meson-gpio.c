@@ -138,6 +138,7 @@ struct meson_gpio_irq_controller {
 	void __iomem *base;
 	u32 channel_irqs[NUM_CHANNEL];
 	DECLARE_BITMAP(channel_map, NUM_CHANNEL);
+	DECLARE_BITMAP(channel_edge_both, NUM_CHANNEL);
 	spinlock_t lock;
 };
 
@@ -157,6 +158,20 @@ static void meson_gpio_irq_update_bits(struct meson_gpio_irq_controller *ctl,
 	spin_unlock_irqrestore(&ctl->lock, flags);
 }
 
+static void meson_gpio_irq_toggle_bits(struct meson_gpio_irq_controller *ctl,
+				       unsigned int reg, u32 mask)
+{
+	unsigned long flags;
+	u32 tmp;
+
+	spin_lock_irqsave(&ctl->lock, flags);
+
+	tmp = readl_relaxed(ctl->base + reg);
+	writel_relaxed(tmp ^ mask, ctl->base + reg);
+
+	spin_unlock_irqrestore(&ctl->lock, flags);
+}
+
 static void meson_gpio_irq_init_dummy(struct meson_gpio_irq_controller *ctl)
 {
 }
@@ -253,6 +268,7 @@ meson_gpio_irq_release_channel(struct meson_gpio_irq_controller *ctl,
 	unsigned int idx;
 
 	idx = meson_gpio_irq_get_channel_idx(ctl, channel_hwirq);
+	clear_bit(idx, ctl->channel_edge_both);
 	clear_bit(idx, ctl->channel_map);
 }
 
@@ -280,11 +296,21 @@ static int meson_gpio_irq_type_setup(struct meson_gpio_irq_controller *ctl,
 	 * New controller support EDGE_BOTH trigger. This setting takes
 	 * precedence over the other edge/polarity settings
 	 */
-	if (type == IRQ_TYPE_EDGE_BOTH) {
-		if (!params->support_edge_both)
-			return -EINVAL;
+	clear_bit(idx, ctl->channel_edge_both);
 
+	if (type == IRQ_TYPE_EDGE_BOTH && params->support_edge_both) {
 		val |= REG_BOTH_EDGE(params, idx);
+	} else if (type == IRQ_TYPE_EDGE_BOTH) {
+		/*
+		 * Older controllers can only detect one edge at a time.
+		 * Start on the rising edge and invert the polarity every
+		 * time the interrupt fires, see meson_gpio_irq_eoi(). If the
+		 * pad starts high, the first falling edge is lost. Edges
+		 * closer together than the interrupt latency can also be
+		 * lost, so this is only suitable for low rate sources.
+		 */
+		set_bit(idx, ctl->channel_edge_both);
+		val |= REG_EDGE_POL_EDGE(params, idx);
 	} else {
 		if (type & (IRQ_TYPE_EDGE_RISING | IRQ_TYPE_EDGE_FALLING))
 			val |= REG_EDGE_POL_EDGE(params, idx);
@@ -331,11 +357,27 @@ static int meson_gpio_irq_set_type(struct irq_data *data, unsigned int type)
 					meson_gpio_irq_type_output(type));
 }
 
+static void meson_gpio_irq_eoi(struct irq_data *data)
+{
+	struct meson_gpio_irq_controller *ctl = data->domain->host_data;
+	u32 *channel_hwirq = irq_data_get_irq_chip_data(data);
+	unsigned int idx;
+
+	idx = meson_gpio_irq_get_channel_idx(ctl, channel_hwirq);
+
+	/* wait for the opposite edge next, before the GIC can fire again */
+	if (test_bit(idx, ctl->channel_edge_both))
+		meson_gpio_irq_toggle_bits(ctl, REG_EDGE_POL,
+					   REG_EDGE_POL_LOW(ctl->params, idx));
+
+	irq_chip_eoi_parent(data);
+}
+
 static struct irq_chip meson_gpio_irq_chip = {
 	.name			= "meson-gpio-irqchip",
 	.irq_mask		= irq_chip_mask_parent,
 	.irq_unmask		= irq_chip_unmask_parent,
-	.irq_eoi		= irq_chip_eoi_parent,
+	.irq_eoi		= meson_gpio_irq_eoi,
 	.irq_set_type		= meson_gpio_irq_set_type,
 	.irq_retrigger		= irq_chip_retrigger_hierarchy,
 #ifdef CONFIG_SMP
@@ -689,9 +689,20 @@ static int btree_split_beneath(struct shadow_spine *s, uint64_t key)
 	return 0;
 }
 
+static void update_limit(struct btree_node *n, int index, uint64_t *limit)
+{
+	if (index + 1 < (int) le32_to_cpu(n->header.nr_entries))
+		*limit = min(*limit, le64_to_cpu(n->keys[index + 1]));
+}
+
+/*
+ * If @limit is given, it is lowered to the lowest key of the subtrees to the
+ * right of the path taken, ie. every key in [key, *limit) belongs in the
+ * same leaf.  Initialise it to U64_MAX.
+ */
 static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			    struct dm_btree_value_type *vt,
-			    uint64_t key, unsigned *index)
+			    uint64_t key, unsigned *index, uint64_t *limit)
 {
 	int r, i = *index, top = 1;
 	struct btree_node *node;
@@ -726,6 +737,14 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 
 			if (r < 0)
 				return r;
+
+			/* a split sibling adds a boundary to the parent */
+			if (!top && limit) {
+				struct btree_node *pn =
+					dm_block_data(shadow_parent(s));
+
+				update_limit(pn, lower_bound(pn, key), limit);
+			}
 		}
 
 		node = dm_block_data(shadow_current(s));
@@ -741,6 +760,9 @@ static int btree_insert_raw(struct shadow_spine *s, dm_block_t root,
 			i = 0;
 		}
 
+		if (limit)
+			update_limit(node, i, limit);
+
 		root = value64(node, i);
 		top = 0;
 	}
@@ -759,27 +781,32 @@ static bool need_insert(struct btree_node *node, uint64_t *keys,
 		(le64_to_cpu(node->keys[index]) != keys[level]));
 }
 
-static int insert(struct dm_btree_info *info, dm_block_t root,
-		  uint64_t *keys, void *value, dm_block_t *new_root,
-		  int *inserted)
-		  __dm_written_to_disk(value)
+/*
+ * Walks the upper levels of a multi-level tree down to the root of the
+ * bottom level tree for @keys, creating missing subtrees on the way.
+ * @index is left at the entry of the spine's current node that has to be
+ * patched up when the bottom level root is shadowed.
+ */
+static int insert_upper_levels(struct shadow_spine *spine,
+			       struct dm_btree_info *info, dm_block_t root,
+			       uint64_t *keys, dm_block_t *bottom_root,
+			       unsigned *index_p)
 {
 	int r;
-	unsigned level, index = -1, last_level = info->levels - 1;
+	unsigned level, index = -1;
 	dm_block_t block = root;
-	struct shadow_spine spine;
 	struct btree_node *n;
 	struct dm_btree_value_type le64_type;
 
 	init_le64_type(info->tm, &le64_type);
-	init_shadow_spine(&spine, info);
 
 	for (level = 0; level < (info->levels - 1); level++) {
-		r = btree_insert_raw(&spine, block, &le64_type, keys[level], &index);
+		r = btree_insert_raw(spine, block, &le64_type, keys[level],
+				     &index, NULL);
 		if (r < 0)
-			goto bad;
+			return r;
 
-		n = dm_block_data(shadow_current(&spine));
+		n = dm_block_data(shadow_current(spine));
 
 		if (need_insert(n, keys, level, index)) {
 			dm_block_t new_tree;
@@ -787,7 +814,7 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 
 			r = dm_btree_empty(info, &new_tree);
 			if (r < 0)
-				goto bad;
+				return r;
 
 			new_le = cpu_to_le64(new_tree);
 			__dm_bless_for_disk(&new_le);
@@ -795,19 +822,28 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 			r = insert_at(sizeof(uint64_t), n, index,
 				      keys[level], &new_le);
 			if (r)
-				goto bad;
+				return r;
 		}
 
-		if (level < last_level)
-			block = value64(n, index);
+		block = value64(n, index);
 	}
 
-	r = btree_insert_raw(&spine, block, &info->value_type,
-			     keys[level], &index);
-	if (r < 0)
-		goto bad;
+	*bottom_root = block;
+	*index_p = index;
+	return 0;
+}
 
-	n = dm_block_data(shadow_current(&spine));
+/*
+ * Inserts the value at @index of the leaf @n, or overwrites the value
+ * already stored there for the same key.
+ */
+static int insert_into_leaf(struct dm_btree_info *info, struct btree_node *n,
+			    unsigned index, uint64_t *keys, void *value,
+			    int *inserted)
+			    __dm_written_to_disk(value)
+{
+	unsigned level = info->levels - 1;
+	int r;
 
 	if (need_insert(n, keys, level, index)) {
 		if (inserted)
@@ -816,7 +852,7 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 		r = insert_at(info->value_type.size, n, index,
 			      keys[level], value);
 		if (r)
-			goto bad_unblessed;
+			return r;
 	} else {
 		if (inserted)
 			*inserted = 0;
@@ -834,6 +870,37 @@ static int insert(struct dm_btree_info *info, dm_block_t root,
 			    value, info->value_type.size);
 	}
 
+	return 0;
+}
+
+static int insert(struct dm_btree_info *info, dm_block_t root,
+		  uint64_t *keys, void *value, dm_block_t *new_root,
+		  int *inserted)
+		  __dm_written_to_disk(value)
+{
+	int r;
+	unsigned level = info->levels - 1, index;
+	dm_block_t block;
+	struct shadow_spine spine;
+	struct btree_node *n;
+
+	init_shadow_spine(&spine, info);
+
+	r = insert_upper_levels(&spine, info, root, keys, &block, &index);
+	if (r < 0)
+		goto bad;
+
+	r = btree_insert_raw(&spine, block, &info->value_type,
+			     keys[level], &index, NULL);
+	if (r < 0)
+		goto bad;
+
+	n = dm_block_data(shadow_current(&spine));
+
+	r = insert_into_leaf(info, n, index, keys, value, inserted);
+	if (r)
+		goto bad_unblessed;
+
 	*new_root = shadow_root(&spine);
 	exit_shadow_spine(&spine);
 
@@ -863,6 +930,78 @@ int dm_btree_insert_notify(struct dm_btree_info *info, dm_block_t root,
 }
 EXPORT_SYMBOL_GPL(dm_btree_insert_notify);
 
+int dm_btree_insert_leaves(struct dm_btree_info *info, dm_block_t root,
+			   uint64_t *keys, uint64_t *leaf_keys, void *values,
+			   unsigned count, dm_block_t *new_root,
+			   unsigned *nr_inserted)
+{
+	int r = 0, inserted;
+	unsigned level = info->levels - 1, index, done = 0;
+	size_t value_size = info->value_type.size;
+	struct shadow_spine spine;
+	struct btree_node *n;
+	dm_block_t block;
+	uint64_t limit;
+
+	if (nr_inserted)
+		*nr_inserted = 0;
+
+	/*
+	 * Each pass goes down the spine once, then keeps filling the leaf it
+	 * reached for as long as the following keys belong in it.
+	 */
+	while (done < count) {
+		init_shadow_spine(&spine, info);
+
+		r = insert_upper_levels(&spine, info, root, keys, &block,
+					&index);
+		if (r < 0)
+			goto bad;
+
+		keys[level] = leaf_keys[done];
+		limit = U64_MAX;
+		r = btree_insert_raw(&spine, block, &info->value_type,
+				     keys[level], &index, &limit);
+		if (r < 0)
+			goto bad;
+
+		n = dm_block_data(shadow_current(&spine));
+
+		for (;;) {
+			r = insert_into_leaf(info, n, index, keys,
+					     values + done * value_size,
+					     &inserted);
+			if (r)
+				goto bad;
+
+			if (nr_inserted)
+				*nr_inserted += inserted;
+
+			if (++done == count ||
+			    leaf_keys[done] <= keys[level] ||
+			    leaf_keys[done] >= limit ||
+			    n->header.nr_entries == n->header.max_entries)
+				break;
+
+			keys[level] = leaf_keys[done];
+			index = lower_bound(n, keys[level]);
+			if (need_insert(n, keys, level, index))
+				index++;
+		}
+
+		root = shadow_root(&spine);
+		exit_shadow_spine(&spine);
+	}
+
+	*new_root = root;
+	return 0;
+
+bad:
+	exit_shadow_spine(&spine);
+	return r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_insert_leaves);
+
 /*----------------------------------------------------------------*/
 
 static int find_key(struct ro_spine *s, dm_block_t block, bool find_highest,
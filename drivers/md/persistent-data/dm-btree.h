@@ -133,6 +133,19 @@ int dm_btree_insert_notify(struct dm_btree_info *info, dm_block_t root,
 			   int *inserted)
 			   __dm_written_to_disk(value);
 
+/*
+ * Inserts (or overwrites) 'count' values at once in the bottom level tree
+ * selected by 'keys', whose final key is replaced with each of 'leaf_keys'
+ * in turn.  'values' holds the 'count' values back to back.  Much cheaper
+ * than separate inserts if 'leaf_keys' is sorted in ascending order, since
+ * each leaf is reached once and all its keys are inserted in one go.
+ * 'nr_inserted' is set to the number of keys that weren't present yet.
+ */
+int dm_btree_insert_leaves(struct dm_btree_info *info, dm_block_t root,
+			   uint64_t *keys, uint64_t *leaf_keys, void *values,
+			   unsigned count, dm_block_t *new_root,
+			   unsigned *nr_inserted);
+
 /*
  * Remove a key if present.  This doesn't remove empty sub trees.  Normally
  * subtrees represent a separate entity, like a snapshot map, so this is
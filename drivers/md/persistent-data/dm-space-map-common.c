@@ -7,8 +7,10 @@
 #include "dm-space-map-common.h"
 #include "dm-transaction-manager.h"
 
+#include <linux/bitmap.h>
 #include <linux/bitops.h>
 #include <linux/device-mapper.h>
+#include <linux/mm.h>
 
 #define DM_MSG_PREFIX "space map common"
 
@@ -188,6 +190,75 @@ static int sm_find_free(void *addr, unsigned begin, unsigned end,
 
 /*----------------------------------------------------------------*/
 
+static int resize_nonfull_bitmaps(struct ll_disk *ll, dm_block_t nr_indexes)
+{
+	unsigned long *bits;
+
+	if (nr_indexes <= ll->nr_nonfull_bits)
+		return 0;
+
+	bits = kvcalloc(BITS_TO_LONGS(nr_indexes), sizeof(*bits), GFP_KERNEL);
+	if (!bits)
+		return -ENOMEM;
+
+	if (ll->nonfull_bitmaps) {
+		bitmap_copy(bits, ll->nonfull_bitmaps, ll->nr_nonfull_bits);
+		kvfree(ll->nonfull_bitmaps);
+	}
+
+	ll->nonfull_bitmaps = bits;
+	ll->nr_nonfull_bits = nr_indexes;
+
+	return 0;
+}
+
+/*
+ * All index updates go through here, to keep the summary in step.
+ */
+static int ll_save_ie(struct ll_disk *ll, dm_block_t index,
+		      struct disk_index_entry *ie)
+{
+	bool nonfull = le32_to_cpu(ie->nr_free) != 0;
+	int r;
+
+	r = ll->save_ie(ll, index, ie);
+	if (r < 0)
+		return r;
+
+	if (nonfull)
+		__set_bit(index, ll->nonfull_bitmaps);
+	else
+		__clear_bit(index, ll->nonfull_bitmaps);
+
+	return r;
+}
+
+/*
+ * Builds the summary of an existing space map from its index entries.
+ */
+static int init_nonfull_bitmaps(struct ll_disk *ll)
+{
+	int r;
+	dm_block_t i, nr_indexes;
+	struct disk_index_entry ie_disk;
+
+	nr_indexes = dm_sector_div_up(ll->nr_blocks, ll->entries_per_block);
+	r = resize_nonfull_bitmaps(ll, nr_indexes);
+	if (r)
+		return r;
+
+	for (i = 0; i < nr_indexes; i++) {
+		r = ll->load_ie(ll, i, &ie_disk);
+		if (r < 0)
+			return r;
+
+		if (le32_to_cpu(ie_disk.nr_free))
+			__set_bit(i, ll->nonfull_bitmaps);
+	}
+
+	return 0;
+}
+
 static int sm_ll_init(struct ll_disk *ll, struct dm_transaction_manager *tm)
 {
 	memset(ll, 0, sizeof(struct ll_disk));
@@ -247,6 +318,10 @@ int sm_ll_extend(struct ll_disk *ll, dm_block_t extra_blocks)
 		return -EINVAL;
 	}
 
+	r = resize_nonfull_bitmaps(ll, nr_indexes);
+	if (r)
+		return r;
+
 	/*
 	 * We need to set this before the dm_tm_new_block() call below.
 	 */
@@ -266,7 +341,7 @@ int sm_ll_extend(struct ll_disk *ll, dm_block_t extra_blocks)
 		idx.nr_free = cpu_to_le32(ll->entries_per_block);
 		idx.none_free_before = 0;
 
-		r = ll->save_ie(ll, i, &idx);
+		r = ll_save_ie(ll, i, &idx);
 		if (r < 0)
 			return r;
 	}
@@ -344,6 +419,19 @@ int sm_ll_find_free_block(struct ll_disk *ll, dm_block_t begin,
 		struct dm_block *blk;
 		unsigned position;
 		uint32_t bit_end;
+		dm_block_t next;
+
+		/*
+		 * Jump straight to the next bitmap with free entries,
+		 * without touching the index or bitmaps of full ones.
+		 */
+		next = find_next_bit(ll->nonfull_bitmaps, index_end, i);
+		if (next >= index_end)
+			break;
+		if (next != i) {
+			i = next;
+			begin = 0;
+		}
 
 		r = ll->load_ie(ll, i, &ie_disk);
 		if (r < 0)
@@ -492,7 +580,7 @@ static int sm_ll_mutate(struct ll_disk *ll, dm_block_t b,
 	} else
 		*ev = SM_NONE;
 
-	return ll->save_ie(ll, index, &ie_disk);
+	return ll_save_ie(ll, index, &ie_disk);
 }
 
 static int set_ref_count(void *context, uint32_t old, uint32_t *new)
@@ -547,6 +635,13 @@ int sm_ll_commit(struct ll_disk *ll)
 	return r;
 }
 
+void sm_ll_destroy(struct ll_disk *ll)
+{
+	kvfree(ll->nonfull_bitmaps);
+	ll->nonfull_bitmaps = NULL;
+	ll->nr_nonfull_bits = 0;
+}
+
 /*----------------------------------------------------------------*/
 
 static int metadata_ll_load_ie(struct ll_disk *ll, dm_block_t index,
@@ -680,7 +775,11 @@ int sm_ll_open_metadata(struct ll_disk *ll, struct dm_transaction_manager *tm,
 	ll->bitmap_root = le64_to_cpu(smr.bitmap_root);
 	ll->ref_count_root = le64_to_cpu(smr.ref_count_root);
 
-	return ll->open_index(ll);
+	r = ll->open_index(ll);
+	if (r)
+		return r;
+
+	return init_nonfull_bitmaps(ll);
 }
 
 /*----------------------------------------------------------------*/
@@ -776,7 +875,11 @@ int sm_ll_open_disk(struct ll_disk *ll, struct dm_transaction_manager *tm,
 	ll->bitmap_root = le64_to_cpu(smr->bitmap_root);
 	ll->ref_count_root = le64_to_cpu(smr->ref_count_root);
 
-	return ll->open_index(ll);
+	r = ll->open_index(ll);
+	if (r)
+		return r;
+
+	return init_nonfull_bitmaps(ll);
 }
 
 /*----------------------------------------------------------------*/
@@ -79,6 +79,13 @@ struct ll_disk {
 	max_index_entries_fn max_entries;
 	commit_fn commit;
 	bool bitmap_index_changed:1;
+
+	/*
+	 * In-core summary of the index, one bit per bitmap block that still
+	 * has free entries.  Only maintained for the ll_disk being updated.
+	 */
+	unsigned long *nonfull_bitmaps;
+	dm_block_t nr_nonfull_bits;
 };
 
 struct disk_sm_root {
@@ -115,6 +122,7 @@ int sm_ll_insert(struct ll_disk *ll, dm_block_t b, uint32_t ref_count, enum allo
 int sm_ll_inc(struct ll_disk *ll, dm_block_t b, enum allocation_event *ev);
 int sm_ll_dec(struct ll_disk *ll, dm_block_t b, enum allocation_event *ev);
 int sm_ll_commit(struct ll_disk *ll);
+void sm_ll_destroy(struct ll_disk *ll);
 
 int sm_ll_new_metadata(struct ll_disk *ll, struct dm_transaction_manager *tm);
 int sm_ll_open_metadata(struct ll_disk *ll, struct dm_transaction_manager *tm,
@@ -35,6 +35,7 @@ static void sm_disk_destroy(struct dm_space_map *sm)
 {
 	struct sm_disk *smd = container_of(sm, struct sm_disk, sm);
 
+	sm_ll_destroy(&smd->ll);
 	kfree(smd);
 }
 
@@ -282,6 +283,7 @@ struct dm_space_map *dm_sm_disk_create(struct dm_transaction_manager *tm,
 	return &smd->sm;
 
 bad:
+	sm_ll_destroy(&smd->ll);
 	kfree(smd);
 	return ERR_PTR(r);
 }
@@ -312,6 +314,7 @@ struct dm_space_map *dm_sm_disk_open(struct dm_transaction_manager *tm,
 	return &smd->sm;
 
 bad:
+	sm_ll_destroy(&smd->ll);
 	kfree(smd);
 	return ERR_PTR(r);
 }
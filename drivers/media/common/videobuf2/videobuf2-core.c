@@ -23,6 +23,7 @@
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/shrinker.h>
 #include <linux/freezer.h>
 #include <linux/kthread.h>
 
@@ -137,6 +138,9 @@ module_param(debug, int, 0644);
 	(vb)->cnt_ ## op++;						\
 })
 
+/* memory handed out or taken back instead of the memop */
+#define count_memop(vb, op)	((vb)->cnt_mem_ ## op++)
+
 #else
 
 #define call_memop(vb, op, args...)					\
@@ -171,6 +175,8 @@ module_param(debug, int, 0644);
 			(vb)->vb2_queue->ops->op(args);			\
 	} while (0)
 
+#define count_memop(vb, op)	do { } while (0)
+
 #endif
 
 #define call_bufop(q, op, args...)					\
@@ -190,6 +196,218 @@ module_param(debug, int, 0644);
 static void __vb2_queue_cancel(struct vb2_queue *q);
 static void __enqueue_in_driver(struct vb2_buffer *vb);
 
+/*
+ * Buffer pool: MMAP plane memory released by a queue is kept, most recently
+ * freed first, and handed out again to an allocation with exactly the same
+ * parameters instead of going back to the allocator.
+ */
+struct vb2_buf_pool {
+	struct mutex		lock;
+	struct list_head	entries;
+	unsigned long		bytes;
+	unsigned long		max_bytes;
+	struct shrinker		shrinker;
+};
+
+struct vb2_buf_pool_entry {
+	struct list_head		list;
+	const struct vb2_mem_ops	*mem_ops;
+	void				*mem_priv;
+	struct device			*dev;
+	unsigned long			attrs;
+	unsigned long			size;
+	enum dma_data_direction		dma_dir;
+	gfp_t				gfp_flags;
+};
+
+/*
+ * __vb2_buf_pool_trim() - move the oldest entries to @list until the pool
+ * holds at most @max_bytes, returns the number of pages moved
+ */
+static unsigned long __vb2_buf_pool_trim(struct vb2_buf_pool *pool,
+					 unsigned long max_bytes,
+					 struct list_head *list)
+{
+	struct vb2_buf_pool_entry *e, *tmp;
+	unsigned long pages = 0;
+
+	list_for_each_entry_safe_reverse(e, tmp, &pool->entries, list) {
+		if (pool->bytes <= max_bytes)
+			break;
+		list_move(&e->list, list);
+		pool->bytes -= e->size;
+		pages += e->size >> PAGE_SHIFT;
+	}
+	return pages;
+}
+
+static void __vb2_buf_pool_release(struct list_head *list)
+{
+	struct vb2_buf_pool_entry *e, *tmp;
+
+	list_for_each_entry_safe(e, tmp, list, list) {
+		e->mem_ops->put(e->mem_priv);
+		kfree(e);
+	}
+}
+
+static unsigned long vb2_buf_pool_count(struct shrinker *shrinker,
+					struct shrink_control *sc)
+{
+	struct vb2_buf_pool *pool = container_of(shrinker, struct vb2_buf_pool,
+						 shrinker);
+
+	return READ_ONCE(pool->bytes) >> PAGE_SHIFT ? : SHRINK_EMPTY;
+}
+
+static unsigned long vb2_buf_pool_scan(struct shrinker *shrinker,
+				       struct shrink_control *sc)
+{
+	struct vb2_buf_pool *pool = container_of(shrinker, struct vb2_buf_pool,
+						 shrinker);
+	unsigned long target, freed;
+	LIST_HEAD(list);
+
+	if (!mutex_trylock(&pool->lock))
+		return SHRINK_STOP;
+	target = sc->nr_to_scan << PAGE_SHIFT;
+	target = pool->bytes > target ? pool->bytes - target : 0;
+	freed = __vb2_buf_pool_trim(pool, target, &list);
+	mutex_unlock(&pool->lock);
+
+	__vb2_buf_pool_release(&list);
+	return freed;
+}
+
+struct vb2_buf_pool *vb2_buf_pool_create(unsigned long max_bytes)
+{
+	struct vb2_buf_pool *pool;
+	int ret;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->entries);
+	pool->max_bytes = max_bytes;
+	pool->shrinker.count_objects = vb2_buf_pool_count;
+	pool->shrinker.scan_objects = vb2_buf_pool_scan;
+	pool->shrinker.seeks = DEFAULT_SEEKS;
+	ret = register_shrinker(&pool->shrinker);
+	if (ret) {
+		kfree(pool);
+		return ERR_PTR(ret);
+	}
+	return pool;
+}
+EXPORT_SYMBOL_GPL(vb2_buf_pool_create);
+
+void vb2_buf_pool_destroy(struct vb2_buf_pool *pool)
+{
+	LIST_HEAD(list);
+
+	if (!pool)
+		return;
+
+	unregister_shrinker(&pool->shrinker);
+	mutex_lock(&pool->lock);
+	__vb2_buf_pool_trim(pool, 0, &list);
+	mutex_unlock(&pool->lock);
+	__vb2_buf_pool_release(&list);
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(vb2_buf_pool_destroy);
+
+/*
+ * __vb2_buf_pool_get() - take memory matching the plane allocation
+ * parameters out of the pool
+ */
+static void *__vb2_buf_pool_get(struct vb2_queue *q, struct device *dev,
+				unsigned long attrs, unsigned long size)
+{
+	struct vb2_buf_pool *pool = q->buf_pool;
+	struct vb2_buf_pool_entry *e;
+	void *mem_priv = NULL;
+
+	mutex_lock(&pool->lock);
+	list_for_each_entry(e, &pool->entries, list) {
+		if (e->mem_ops == q->mem_ops && e->dev == dev &&
+		    e->attrs == attrs && e->size == size &&
+		    e->dma_dir == q->dma_dir && e->gfp_flags == q->gfp_flags) {
+			list_del(&e->list);
+			pool->bytes -= e->size;
+			mem_priv = e->mem_priv;
+			kfree(e);
+			break;
+		}
+	}
+	mutex_unlock(&pool->lock);
+
+	if (mem_priv) {
+		/*
+		 * Don't leak the previous contents to the new user, and leave
+		 * no dirty cache lines behind to be written back over data
+		 * the device produces later.
+		 */
+		memset(q->mem_ops->vaddr(mem_priv), 0, size);
+		if (q->mem_ops->prepare)
+			q->mem_ops->prepare(mem_priv);
+	}
+	return mem_priv;
+}
+
+/*
+ * __vb2_buf_pool_put() - try to keep plane memory in the pool rather than
+ * freeing it, returns true if the pool took it over
+ */
+static bool __vb2_buf_pool_put(struct vb2_buffer *vb, unsigned int plane,
+			       struct device *dev, unsigned long attrs)
+{
+	struct vb2_queue *q = vb->vb2_queue;
+	struct vb2_buf_pool *pool = q->buf_pool;
+	void *mem_priv = vb->planes[plane].mem_priv;
+	unsigned long size = PAGE_ALIGN(vb->planes[plane].length);
+	struct vb2_buf_pool_entry *e;
+	LIST_HEAD(list);
+
+	/* still mapped or exported, or no way to clear it on reuse */
+	if (!q->mem_ops->num_users || q->mem_ops->num_users(mem_priv) > 1 ||
+	    !q->mem_ops->vaddr || !q->mem_ops->vaddr(mem_priv) ||
+	    size > pool->max_bytes)
+		return false;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return false;
+
+	e->mem_ops = q->mem_ops;
+	e->mem_priv = mem_priv;
+	e->dev = dev;
+	e->attrs = attrs;
+	e->size = size;
+	e->dma_dir = q->dma_dir;
+	e->gfp_flags = q->gfp_flags;
+
+	mutex_lock(&pool->lock);
+	list_add(&e->list, &pool->entries);
+	pool->bytes += size;
+	__vb2_buf_pool_trim(pool, pool->max_bytes, &list);
+	mutex_unlock(&pool->lock);
+
+	__vb2_buf_pool_release(&list);
+	return true;
+}
+
+/*
+ * __vb2_buf_mem_attrs() - DMA attributes the plane memory is allocated with
+ */
+static unsigned long __vb2_buf_mem_attrs(struct vb2_queue *q)
+{
+	return q->dma_attrs |
+		(q->non_coherent_mem ? DMA_ATTR_NON_CONSISTENT : 0);
+}
+
 /*
  * __vb2_buf_mem_alloc() - allocate video memory for the given buffer
  */
@@ -208,13 +426,25 @@ static int __vb2_buf_mem_alloc(struct vb2_buffer *vb)
 		/* Memops alloc requires size to be page aligned. */
 		unsigned long size = PAGE_ALIGN(vb->planes[plane].length);
 
+		struct device *dev = q->alloc_devs[plane] ? : q->dev;
+		unsigned long attrs = __vb2_buf_mem_attrs(q);
+
 		/* Did it wrap around? */
 		if (size < vb->planes[plane].length)
 			goto free;
 
-		mem_priv = call_ptr_memop(vb, alloc,
-				q->alloc_devs[plane] ? : q->dev,
-				q->dma_attrs, size, q->dma_dir, q->gfp_flags);
+		mem_priv = q->buf_pool ?
+			__vb2_buf_pool_get(q, dev, attrs, size) : NULL;
+		if (mem_priv) {
+			vb->planes[plane].mem_priv = mem_priv;
+			count_memop(vb, alloc);
+			dprintk(3, "reused pooled memory for plane %d of buffer %d\n",
+				plane, vb->index);
+			continue;
+		}
+
+		mem_priv = call_ptr_memop(vb, alloc, dev, attrs, size,
+					  q->dma_dir, q->gfp_flags);
 		if (IS_ERR_OR_NULL(mem_priv)) {
 			if (mem_priv)
 				ret = PTR_ERR(mem_priv);
@@ -241,15 +471,61 @@ static int __vb2_buf_mem_alloc(struct vb2_buffer *vb)
  */
 static void __vb2_buf_mem_free(struct vb2_buffer *vb)
 {
+	struct vb2_queue *q = vb->vb2_queue;
 	unsigned int plane;
 
 	for (plane = 0; plane < vb->num_planes; ++plane) {
+		if (q->buf_pool &&
+		    __vb2_buf_pool_put(vb, plane,
+				       q->alloc_devs[plane] ? : q->dev,
+				       __vb2_buf_mem_attrs(q))) {
+			vb->planes[plane].mem_priv = NULL;
+			count_memop(vb, put);
+			dprintk(3, "pooled plane %d of buffer %d\n", plane,
+				vb->index);
+			continue;
+		}
 		call_void_memop(vb, put, vb->planes[plane].mem_priv);
 		vb->planes[plane].mem_priv = NULL;
 		dprintk(3, "freed plane %d of buffer %d\n", plane, vb->index);
 	}
 }
 
+/*
+ * __vb2_buf_mem_prepare() - hand the buffer memory over to the device,
+ * unless userspace told us the CPU did not write to it
+ */
+static void __vb2_buf_mem_prepare(struct vb2_buffer *vb)
+{
+	unsigned int plane;
+
+	if (!vb->skip_cache_sync_on_prepare) {
+		for (plane = 0; plane < vb->num_planes; ++plane)
+			call_void_memop(vb, prepare,
+					vb->planes[plane].mem_priv);
+	}
+	vb->synced = 1;
+}
+
+/*
+ * __vb2_buf_mem_finish() - hand the buffer memory back to the CPU, unless
+ * userspace told us it is not going to read it
+ */
+static void __vb2_buf_mem_finish(struct vb2_buffer *vb)
+{
+	unsigned int plane;
+
+	if (!vb->synced)
+		return;
+
+	if (!vb->skip_cache_sync_on_finish) {
+		for (plane = 0; plane < vb->num_planes; ++plane)
+			call_void_memop(vb, finish,
+					vb->planes[plane].mem_priv);
+	}
+	vb->synced = 0;
+}
+
 /*
  * __vb2_buf_userptr_put() - release userspace memory associated with
  * a USERPTR buffer
@@ -922,7 +1198,6 @@ void vb2_buffer_done(struct vb2_buffer *vb, enum vb2_buffer_state state)
 {
 	struct vb2_queue *q = vb->vb2_queue;
 	unsigned long flags;
-	unsigned int plane;
 
 	if (WARN_ON(vb->state != VB2_BUF_STATE_ACTIVE))
 		return;
@@ -942,12 +1217,8 @@ void vb2_buffer_done(struct vb2_buffer *vb, enum vb2_buffer_state state)
 	dprintk(4, "done processing on buffer %d, state: %d\n",
 			vb->index, state);
 
-	if (state != VB2_BUF_STATE_QUEUED) {
-		/* sync buffers */
-		for (plane = 0; plane < vb->num_planes; ++plane)
-			call_void_memop(vb, finish, vb->planes[plane].mem_priv);
-		vb->synced = 0;
-	}
+	if (state != VB2_BUF_STATE_QUEUED)
+		__vb2_buf_mem_finish(vb);
 
 	spin_lock_irqsave(&q->done_lock, flags);
 	if (state == VB2_BUF_STATE_QUEUED) {
@@ -1272,7 +1543,6 @@ static int __buf_prepare(struct vb2_buffer *vb)
 {
 	struct vb2_queue *q = vb->vb2_queue;
 	enum vb2_buffer_state orig_state = vb->state;
-	unsigned int plane;
 	int ret;
 
 	if (q->error) {
@@ -1316,11 +1586,7 @@ static int __buf_prepare(struct vb2_buffer *vb)
 		return ret;
 	}
 
-	/* sync buffers */
-	for (plane = 0; plane < vb->num_planes; ++plane)
-		call_void_memop(vb, prepare, vb->planes[plane].mem_priv);
-
-	vb->synced = 1;
+	__vb2_buf_mem_prepare(vb);
 	vb->prepared = 1;
 	vb->state = orig_state;
 
@@ -1940,14 +2206,7 @@ static void __vb2_queue_cancel(struct vb2_queue *q)
 				call_void_vb_qop(vb, buf_request_complete, vb);
 		}
 
-		if (vb->synced) {
-			unsigned int plane;
-
-			for (plane = 0; plane < vb->num_planes; ++plane)
-				call_void_memop(vb, finish,
-						vb->planes[plane].mem_priv);
-			vb->synced = 0;
-		}
+		__vb2_buf_mem_finish(vb);
 
 		if (vb->prepared) {
 			call_void_vb_qop(vb, buf_finish, vb);
@@ -37,6 +37,9 @@ struct vb2_dc_buf {
 	struct vb2_vmarea_handler	handler;
 	refcount_t			refcount;
 	struct sg_table			*sgt_base;
+	/* cacheable memory from dma_alloc_pages(), synced by prepare/finish */
+	struct page			*page;
+	bool				non_coherent_mem;
 
 	/* DMABUF related */
 	struct dma_buf_attachment	*db_attach;
@@ -95,6 +98,12 @@ static void vb2_dc_prepare(void *buf_priv)
 	struct vb2_dc_buf *buf = buf_priv;
 	struct sg_table *sgt = buf->dma_sgt;
 
+	if (buf->non_coherent_mem) {
+		dma_sync_single_for_device(buf->dev, buf->dma_addr, buf->size,
+					   buf->dma_dir);
+		return;
+	}
+
 	/* DMABUF exporter will flush the cache for us */
 	if (!sgt || buf->db_attach)
 		return;
@@ -108,6 +117,12 @@ static void vb2_dc_finish(void *buf_priv)
 	struct vb2_dc_buf *buf = buf_priv;
 	struct sg_table *sgt = buf->dma_sgt;
 
+	if (buf->non_coherent_mem) {
+		dma_sync_single_for_cpu(buf->dev, buf->dma_addr, buf->size,
+					buf->dma_dir);
+		return;
+	}
+
 	/* DMABUF exporter will flush the cache for us */
 	if (!sgt || buf->db_attach)
 		return;
@@ -130,8 +145,12 @@ static void vb2_dc_put(void *buf_priv)
 		sg_free_table(buf->sgt_base);
 		kfree(buf->sgt_base);
 	}
-	dma_free_attrs(buf->dev, buf->size, buf->cookie, buf->dma_addr,
-		       buf->attrs);
+	if (buf->non_coherent_mem)
+		dma_free_pages(buf->dev, buf->size, buf->page, buf->dma_addr,
+			       buf->dma_dir);
+	else
+		dma_free_attrs(buf->dev, buf->size, buf->cookie, buf->dma_addr,
+			       buf->attrs);
 	put_device(buf->dev);
 	kfree(buf);
 }
@@ -149,18 +168,37 @@ static void *vb2_dc_alloc(struct device *dev, unsigned long attrs,
 	if (!buf)
 		return ERR_PTR(-ENOMEM);
 
+	if (attrs & DMA_ATTR_NON_CONSISTENT) {
+		/*
+		 * Not all platforms honour DMA_ATTR_NON_CONSISTENT, so ask for
+		 * cacheable pages explicitly and fall back to coherent memory
+		 * when the device cannot use them.
+		 */
+		buf->page = dma_alloc_pages(dev, size, &buf->dma_addr, dma_dir,
+					    GFP_KERNEL | gfp_flags);
+		attrs &= ~DMA_ATTR_NON_CONSISTENT;
+	}
+
 	if (attrs)
 		buf->attrs = attrs;
-	buf->cookie = dma_alloc_attrs(dev, size, &buf->dma_addr,
-					GFP_KERNEL | gfp_flags, buf->attrs);
-	if (!buf->cookie) {
-		dev_err(dev, "dma_alloc_coherent of size %ld failed\n", size);
-		kfree(buf);
-		return ERR_PTR(-ENOMEM);
-	}
+	if (buf->page) {
+		buf->non_coherent_mem = true;
+		buf->vaddr = page_address(buf->page);
+		buf->cookie = buf->vaddr;
+	} else {
+		buf->cookie = dma_alloc_attrs(dev, size, &buf->dma_addr,
+					      GFP_KERNEL | gfp_flags,
+					      buf->attrs);
+		if (!buf->cookie) {
+			dev_err(dev, "dma_alloc_coherent of size %ld failed\n",
+				size);
+			kfree(buf);
+			return ERR_PTR(-ENOMEM);
+		}
 
-	if ((buf->attrs & DMA_ATTR_NO_KERNEL_MAPPING) == 0)
-		buf->vaddr = buf->cookie;
+		if ((buf->attrs & DMA_ATTR_NO_KERNEL_MAPPING) == 0)
+			buf->vaddr = buf->cookie;
+	}
 
 	/* Prevent the device from being released while the buffer is used */
 	buf->dev = get_device(dev);
@@ -186,8 +224,14 @@ static int vb2_dc_mmap(void *buf_priv, struct vm_area_struct *vma)
 		return -EINVAL;
 	}
 
-	ret = dma_mmap_attrs(buf->dev, vma, buf->cookie,
-		buf->dma_addr, buf->size, buf->attrs);
+	if (buf->non_coherent_mem)
+		ret = remap_pfn_range(vma, vma->vm_start,
+				      page_to_pfn(buf->page),
+				      vma->vm_end - vma->vm_start,
+				      vma->vm_page_prot);
+	else
+		ret = dma_mmap_attrs(buf->dev, vma, buf->cookie,
+			buf->dma_addr, buf->size, buf->attrs);
 
 	if (ret) {
 		pr_err("Remapping memory failed, error: %d\n", ret);
@@ -269,9 +313,10 @@ static void vb2_dc_dmabuf_ops_detach(struct dma_buf *dbuf,
 	if (attach->dma_dir != DMA_NONE)
 		/*
 		 * Cache sync can be skipped here, as the vb2_dc memory is
-		 * allocated from device coherent memory, which means the
-		 * memory locations do not require any explicit cache
-		 * maintenance prior or after being used by the device.
+		 * either allocated from device coherent memory, which means
+		 * the memory locations do not require any explicit cache
+		 * maintenance prior or after being used by the device, or
+		 * cacheable memory that is synced in begin/end_cpu_access.
 		 */
 		dma_unmap_sg_attrs(db_attach->dev, sgt->sgl, sgt->orig_nents,
 				   attach->dma_dir, DMA_ATTR_SKIP_CPU_SYNC);
@@ -335,6 +380,28 @@ static void vb2_dc_dmabuf_ops_release(struct dma_buf *dbuf)
 	vb2_dc_put(dbuf->priv);
 }
 
+static int vb2_dc_dmabuf_ops_begin_cpu_access(struct dma_buf *dbuf,
+	enum dma_data_direction direction)
+{
+	struct vb2_dc_buf *buf = dbuf->priv;
+
+	if (buf->non_coherent_mem)
+		dma_sync_single_for_cpu(buf->dev, buf->dma_addr, buf->size,
+					buf->dma_dir);
+	return 0;
+}
+
+static int vb2_dc_dmabuf_ops_end_cpu_access(struct dma_buf *dbuf,
+	enum dma_data_direction direction)
+{
+	struct vb2_dc_buf *buf = dbuf->priv;
+
+	if (buf->non_coherent_mem)
+		dma_sync_single_for_device(buf->dev, buf->dma_addr, buf->size,
+					   buf->dma_dir);
+	return 0;
+}
+
 static void *vb2_dc_dmabuf_ops_vmap(struct dma_buf *dbuf)
 {
 	struct vb2_dc_buf *buf = dbuf->priv;
@@ -353,6 +420,8 @@ static const struct dma_buf_ops vb2_dc_dmabuf_ops = {
 	.detach = vb2_dc_dmabuf_ops_detach,
 	.map_dma_buf = vb2_dc_dmabuf_ops_map,
 	.unmap_dma_buf = vb2_dc_dmabuf_ops_unmap,
+	.begin_cpu_access = vb2_dc_dmabuf_ops_begin_cpu_access,
+	.end_cpu_access = vb2_dc_dmabuf_ops_end_cpu_access,
 	.vmap = vb2_dc_dmabuf_ops_vmap,
 	.mmap = vb2_dc_dmabuf_ops_mmap,
 	.release = vb2_dc_dmabuf_ops_release,
@@ -369,8 +438,16 @@ static struct sg_table *vb2_dc_get_base_sgt(struct vb2_dc_buf *buf)
 		return NULL;
 	}
 
-	ret = dma_get_sgtable_attrs(buf->dev, sgt, buf->cookie, buf->dma_addr,
-		buf->size, buf->attrs);
+	if (buf->non_coherent_mem) {
+		ret = sg_alloc_table(sgt, 1, GFP_KERNEL);
+		if (!ret)
+			sg_set_page(sgt->sgl, buf->page, PAGE_ALIGN(buf->size),
+				    0);
+	} else {
+		ret = dma_get_sgtable_attrs(buf->dev, sgt, buf->cookie,
+					    buf->dma_addr, buf->size,
+					    buf->attrs);
+	}
 	if (ret < 0) {
 		dev_err(buf->dev, "failed to get scatterlist from DMA API\n");
 		kfree(sgt);
@@ -337,6 +337,28 @@ static int vb2_fill_vb2_v4l2_buffer(struct vb2_buffer *vb, struct v4l2_buffer *b
 	return 0;
 }
 
+/*
+ * Cache hints are only honoured for MMAP buffers of queues that opted in,
+ * anything else gets the full cache maintenance.
+ */
+static void set_buffer_cache_hints(struct vb2_queue *q,
+				   struct vb2_buffer *vb,
+				   struct v4l2_buffer *b)
+{
+	if (!q->allow_cache_hints || q->memory != VB2_MEMORY_MMAP) {
+		b->flags &= ~(V4L2_BUF_FLAG_NO_CACHE_INVALIDATE |
+			      V4L2_BUF_FLAG_NO_CACHE_CLEAN);
+		vb->skip_cache_sync_on_prepare = 0;
+		vb->skip_cache_sync_on_finish = 0;
+		return;
+	}
+
+	vb->skip_cache_sync_on_prepare =
+		!!(b->flags & V4L2_BUF_FLAG_NO_CACHE_CLEAN);
+	vb->skip_cache_sync_on_finish =
+		!!(b->flags & V4L2_BUF_FLAG_NO_CACHE_INVALIDATE);
+}
+
 static int vb2_queue_or_prepare_buf(struct vb2_queue *q, struct media_device *mdev,
 				    struct v4l2_buffer *b, bool is_prepare,
 				    struct media_request **p_req)
@@ -387,6 +409,7 @@ static int vb2_queue_or_prepare_buf(struct vb2_queue *q, struct media_device *md
 		ret = vb2_fill_vb2_v4l2_buffer(vb, b);
 		if (ret)
 			return ret;
+		set_buffer_cache_hints(q, vb, b);
 	}
 
 	if (is_prepare)
@@ -662,6 +685,8 @@ static void fill_buf_caps(struct vb2_queue *q, u32 *caps)
 		*caps |= V4L2_BUF_CAP_SUPPORTS_DMABUF;
 	if (q->subsystem_flags & VB2_V4L2_FL_SUPPORTS_M2M_HOLD_CAPTURE_BUF)
 		*caps |= V4L2_BUF_CAP_SUPPORTS_M2M_HOLD_CAPTURE_BUF;
+	if (q->allow_cache_hints && (q->io_modes & VB2_MMAP))
+		*caps |= V4L2_BUF_CAP_SUPPORTS_MMAP_CACHE_HINTS;
 #ifdef CONFIG_MEDIA_CONTROLLER_REQUEST_API
 	if (q->supports_requests)
 		*caps |= V4L2_BUF_CAP_SUPPORTS_REQUESTS;
@@ -22,6 +22,8 @@
 #include <linux/reset.h>
 #include <linux/slab.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
+#include <linux/ktime.h>
 #include <media/cec.h>
 #include <media/cec-notifier.h>
 #include <linux/clk-provider.h>
@@ -184,6 +186,22 @@ struct meson_ao_cec_g12a_device {
 	struct clk			*oscin;
 	struct clk			*core;
 	const struct meson_ao_cec_g12a_data *data;
+
+	/* Message being transmitted, retried from the IRQ thread */
+	u8				tx_msg[CEC_MAX_MSG_SIZE];
+	u8				tx_len;
+	u8				tx_attempts;
+	u8				tx_arb_lost_cnt;
+	u8				tx_nack_cnt;
+	u8				tx_error_cnt;
+	ktime_t				tx_start;
+
+	/* Transmit statistics, shown in the adapter debugfs status */
+	u64				tx_msgs;
+	u64				tx_retries;
+	u64				tx_latency_sum_us;
+	u32				tx_latency_max_us;
+	u32				tx_latency_last_us;
 };
 
 static const struct regmap_config meson_ao_cec_g12a_regmap_conf = {
@@ -449,6 +467,73 @@ static void meson_ao_cec_g12a_irq_rx(struct meson_ao_cec_g12a_device *ao_cec)
 	cec_received_msg(ao_cec->adap, &ao_cec->rx_msg);
 }
 
+static int meson_ao_cec_g12a_send(struct meson_ao_cec_g12a_device *ao_cec,
+				  unsigned int type)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < ao_cec->tx_len; i++)
+		ret |= regmap_write(ao_cec->regmap_cec, CECB_TX_DATA00 + i,
+				    ao_cec->tx_msg[i]);
+
+	ret |= regmap_write(ao_cec->regmap_cec, CECB_TX_CNT, ao_cec->tx_len);
+	if (ret)
+		return -EIO;
+
+	return regmap_update_bits(ao_cec->regmap_cec, CECB_CTRL,
+				  CECB_CTRL_SEND |
+				  CECB_CTRL_TYPE,
+				  CECB_CTRL_SEND |
+				  FIELD_PREP(CECB_CTRL_TYPE, type));
+}
+
+/*
+ * Failed attempts are retried right away from here, the controller then
+ * waits for the signal free time of the frame type on its own, and only
+ * the final status is reported so the CEC framework doesn't need to be
+ * scheduled again between attempts.
+ */
+static void meson_ao_cec_g12a_irq_tx(struct meson_ao_cec_g12a_device *ao_cec,
+				     u8 status)
+{
+	unsigned int type = CECB_CTRL_TYPE_RETRY;
+	u32 latency;
+
+	switch (status) {
+	case CEC_TX_STATUS_ARB_LOST:
+		ao_cec->tx_arb_lost_cnt++;
+		/* We never got on the bus, wait as a new initiator */
+		type = CECB_CTRL_TYPE_NEW;
+		break;
+	case CEC_TX_STATUS_NACK:
+		ao_cec->tx_nack_cnt++;
+		break;
+	case CEC_TX_STATUS_ERROR:
+		ao_cec->tx_error_cnt++;
+		break;
+	}
+
+	if (status != CEC_TX_STATUS_OK && --ao_cec->tx_attempts) {
+		ao_cec->tx_retries++;
+		if (!meson_ao_cec_g12a_send(ao_cec, type))
+			return;
+	}
+
+	latency = ktime_us_delta(ktime_get(), ao_cec->tx_start);
+	ao_cec->tx_msgs++;
+	ao_cec->tx_latency_sum_us += latency;
+	ao_cec->tx_latency_last_us = latency;
+	if (latency > ao_cec->tx_latency_max_us)
+		ao_cec->tx_latency_max_us = latency;
+
+	if (status != CEC_TX_STATUS_OK)
+		status |= CEC_TX_STATUS_MAX_RETRIES;
+
+	cec_transmit_done(ao_cec->adap, status, ao_cec->tx_arb_lost_cnt,
+			  ao_cec->tx_nack_cnt, 0, ao_cec->tx_error_cnt);
+}
+
 static irqreturn_t meson_ao_cec_g12a_irq(int irq, void *data)
 {
 	struct meson_ao_cec_g12a_device *ao_cec = data;
@@ -470,24 +555,24 @@ static irqreturn_t meson_ao_cec_g12a_irq_thread(int irq, void *data)
 	regmap_write(ao_cec->regmap, CECB_INTR_CLR_REG, stat);
 
 	if (stat & CECB_INTR_DONE)
-		cec_transmit_attempt_done(ao_cec->adap, CEC_TX_STATUS_OK);
+		meson_ao_cec_g12a_irq_tx(ao_cec, CEC_TX_STATUS_OK);
 
 	if (stat & CECB_INTR_EOM)
 		meson_ao_cec_g12a_irq_rx(ao_cec);
 
 	if (stat & CECB_INTR_NACK)
-		cec_transmit_attempt_done(ao_cec->adap, CEC_TX_STATUS_NACK);
+		meson_ao_cec_g12a_irq_tx(ao_cec, CEC_TX_STATUS_NACK);
 
 	if (stat & CECB_INTR_ARB_LOSS) {
 		regmap_write(ao_cec->regmap_cec, CECB_TX_CNT, 0);
 		regmap_update_bits(ao_cec->regmap_cec, CECB_CTRL,
 				   CECB_CTRL_SEND | CECB_CTRL_TYPE, 0);
-		cec_transmit_attempt_done(ao_cec->adap, CEC_TX_STATUS_ARB_LOST);
+		meson_ao_cec_g12a_irq_tx(ao_cec, CEC_TX_STATUS_ARB_LOST);
 	}
 
 	/* Initiator reports an error on the CEC bus */
 	if (stat & CECB_INTR_INITIATOR_ERR)
-		cec_transmit_attempt_done(ao_cec->adap, CEC_TX_STATUS_ERROR);
+		meson_ao_cec_g12a_irq_tx(ao_cec, CEC_TX_STATUS_ERROR);
 
 	/* Follower reports a receive error, just reset RX buffer */
 	if (stat & CECB_INTR_FOLLOWER_ERR)
@@ -533,7 +618,6 @@ static int meson_ao_cec_g12a_transmit(struct cec_adapter *adap, u8 attempts,
 	unsigned int type;
 	int ret = 0;
 	u32 val;
-	int i;
 
 	/* Check if RX is in progress */
 	ret = regmap_read(ao_cec->regmap_cec, CECB_LOCK_BUF, &val);
@@ -562,21 +646,32 @@ static int meson_ao_cec_g12a_transmit(struct cec_adapter *adap, u8 attempts,
 		break;
 	}
 
-	for (i = 0; i < msg->len; i++)
-		ret |= regmap_write(ao_cec->regmap_cec, CECB_TX_DATA00 + i,
-				    msg->msg[i]);
+	memcpy(ao_cec->tx_msg, msg->msg, msg->len);
+	ao_cec->tx_len = msg->len;
+	ao_cec->tx_attempts = max_t(u8, attempts, 1);
+	ao_cec->tx_arb_lost_cnt = 0;
+	ao_cec->tx_nack_cnt = 0;
+	ao_cec->tx_error_cnt = 0;
+	ao_cec->tx_start = ktime_get();
 
-	ret |= regmap_write(ao_cec->regmap_cec, CECB_TX_CNT, msg->len);
-	if (ret)
-		return -EIO;
+	return meson_ao_cec_g12a_send(ao_cec, type);
+}
 
-	ret = regmap_update_bits(ao_cec->regmap_cec, CECB_CTRL,
-				 CECB_CTRL_SEND |
-				 CECB_CTRL_TYPE,
-				 CECB_CTRL_SEND |
-				 FIELD_PREP(CECB_CTRL_TYPE, type));
+static void meson_ao_cec_g12a_adap_status(struct cec_adapter *adap,
+					  struct seq_file *file)
+{
+	struct meson_ao_cec_g12a_device *ao_cec = adap->priv;
 
-	return ret;
+	seq_printf(file, "tx messages: %llu\n", ao_cec->tx_msgs);
+	seq_printf(file, "tx retries: %llu\n", ao_cec->tx_retries);
+	if (!ao_cec->tx_msgs)
+		return;
+	seq_printf(file, "tx latency last: %u usecs\n",
+		   ao_cec->tx_latency_last_us);
+	seq_printf(file, "tx latency avg: %llu usecs\n",
+		   div64_u64(ao_cec->tx_latency_sum_us, ao_cec->tx_msgs));
+	seq_printf(file, "tx latency max: %u usecs\n",
+		   ao_cec->tx_latency_max_us);
 }
 
 static int meson_ao_cec_g12a_adap_enable(struct cec_adapter *adap, bool enable)
@@ -627,6 +722,7 @@ static const struct cec_adap_ops meson_ao_cec_g12a_ops = {
 	.adap_enable = meson_ao_cec_g12a_adap_enable,
 	.adap_log_addr = meson_ao_cec_g12a_set_log_addr,
 	.adap_transmit = meson_ao_cec_g12a_transmit,
+	.adap_status = meson_ao_cec_g12a_adap_status,
 };
 
 static int meson_ao_cec_g12a_probe(struct platform_device *pdev)
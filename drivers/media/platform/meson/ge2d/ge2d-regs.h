@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Amlogic Meson GE2D 2D graphics engine register definitions
+ */
+
+#ifndef __GE2D_REGS__
+#define __GE2D_REGS__
+
+/* Registers are 32bit wide, word addressed in the vendor documentation */
+#define GE2D_REG(x)			((x) << 2)
+
+#define GE2D_GEN_CTRL0			GE2D_REG(0x00)
+#define GE2D_DST_BYPASS_EN		BIT(0)
+#define GE2D_SRC2_BYPASS_EN		BIT(1)
+#define GE2D_SRC1_DUAL_EN		BIT(2)
+#define GE2D_SRC1_BYPASS_EN		BIT(3)
+
+#define GE2D_GEN_CTRL1			GE2D_REG(0x01)
+#define GE2D_SOFT_RST			BIT(31)
+#define GE2D_DST_WRITE_RESP		BIT(30)
+#define GE2D_INTERRUPT_CTRL		GENMASK(25, 24)
+#define GE2D_INTERRUPT_ON_DONE		0x2
+
+#define GE2D_GEN_CTRL2			GE2D_REG(0x02)
+#define GE2D_DST_LITTLE_ENDIAN		BIT(23)
+#define GE2D_DST_COLOR_MAP		GENMASK(22, 19)
+#define GE2D_DST_FORMAT			GENMASK(17, 16)
+#define GE2D_SRC2_LITTLE_ENDIAN		BIT(15)
+#define GE2D_SRC2_COLOR_MAP		GENMASK(14, 11)
+#define GE2D_SRC2_FORMAT		GENMASK(9, 8)
+#define GE2D_SRC1_LITTLE_ENDIAN		BIT(7)
+#define GE2D_SRC1_COLOR_MAP		GENMASK(6, 3)
+#define GE2D_SRC1_FORMAT		GENMASK(1, 0)
+
+#define GE2D_FORMAT_8BIT		0
+#define GE2D_FORMAT_16BIT		1
+#define GE2D_FORMAT_24BIT		2
+#define GE2D_FORMAT_32BIT		3
+
+#define GE2D_COLOR_MAP_YUV422		0
+#define GE2D_COLOR_MAP_RGB565		4
+#define GE2D_COLOR_MAP_RGB888		0
+#define GE2D_COLOR_MAP_BGR888		5
+#define GE2D_COLOR_MAP_RGBA8888		0
+#define GE2D_COLOR_MAP_ARGB8888		1
+#define GE2D_COLOR_MAP_ABGR8888		2
+#define GE2D_COLOR_MAP_BGRA8888		3
+
+#define GE2D_CMD_CTRL			GE2D_REG(0x03)
+#define GE2D_DST_XY_SWAP		BIT(10)
+#define GE2D_DST_X_REV			BIT(9)
+#define GE2D_DST_Y_REV			BIT(8)
+#define GE2D_CBUS_CMD_WR		BIT(0)
+
+#define GE2D_STATUS0			GE2D_REG(0x04)
+#define GE2D_GE2D_BUSY			BIT(0)
+
+#define GE2D_STATUS1			GE2D_REG(0x05)
+
+#define GE2D_SRC1_DEF_COLOR		GE2D_REG(0x06)
+
+/* Start/end pairs share one register for all the rectangles below */
+#define GE2D_START			GENMASK(28, 16)
+#define GE2D_END			GENMASK(12, 0)
+
+#define GE2D_SRC1_CLIPX_START_END	GE2D_REG(0x07)
+#define GE2D_SRC1_CLIPY_START_END	GE2D_REG(0x08)
+
+#define GE2D_SRC1_CANVAS		GE2D_REG(0x09)
+#define GE2D_SRC1_X_CANVAS		GENMASK(31, 24)
+
+#define GE2D_SRC1_X_START_END		GE2D_REG(0x0a)
+#define GE2D_SRC1_Y_START_END		GE2D_REG(0x0b)
+
+#define GE2D_SRC1_FMT_CTRL		GE2D_REG(0x0e)
+#define GE2D_SRC1_X_YC_RATIO		BIT(10)
+#define GE2D_SRC1_Y_YC_RATIO		BIT(9)
+
+#define GE2D_DST_CLIPX_START_END	GE2D_REG(0x14)
+#define GE2D_DST_CLIPY_START_END	GE2D_REG(0x15)
+#define GE2D_DST_X_START_END		GE2D_REG(0x16)
+#define GE2D_DST_Y_START_END		GE2D_REG(0x17)
+
+#define GE2D_SRC2_DST_CANVAS		GE2D_REG(0x18)
+#define GE2D_SRC2_CANVAS		GENMASK(15, 8)
+#define GE2D_DST_CANVAS			GENMASK(7, 0)
+
+/* Scaler steps are 5.24 fixed point input pixels per output pixel */
+#define GE2D_VSC_START_PHASE_STEP	GE2D_REG(0x19)
+#define GE2D_VSC_INI_CTRL		GE2D_REG(0x1b)
+#define GE2D_HSC_START_PHASE_STEP	GE2D_REG(0x1c)
+#define GE2D_HSC_INI_CTRL		GE2D_REG(0x1e)
+#define GE2D_SC_STEP			GENMASK(28, 0)
+#define GE2D_SC_STEP_SHIFT		24
+
+#define GE2D_SC_MISC_CTRL		GE2D_REG(0x20)
+#define GE2D_SC_HSC_EN			BIT(1)
+#define GE2D_SC_VSC_EN			BIT(0)
+
+/* Coefficients are 13bit signed 2.10 fixed point, offsets 9bit signed */
+#define GE2D_MATRIX_PRE_OFFSET		GE2D_REG(0x25)
+#define GE2D_MATRIX_COEF00_01		GE2D_REG(0x26)
+#define GE2D_MATRIX_COEF02_10		GE2D_REG(0x27)
+#define GE2D_MATRIX_COEF11_12		GE2D_REG(0x28)
+#define GE2D_MATRIX_COEF20_21		GE2D_REG(0x29)
+#define GE2D_MATRIX_COEF22_CTRL		GE2D_REG(0x2a)
+#define GE2D_MATRIX_OFFSET		GE2D_REG(0x2b)
+#define GE2D_MATRIX_COEF_A		GENMASK(28, 16)
+#define GE2D_MATRIX_COEF_B		GENMASK(12, 0)
+#define GE2D_MATRIX_OFFSET_0		GENMASK(28, 20)
+#define GE2D_MATRIX_OFFSET_1		GENMASK(18, 10)
+#define GE2D_MATRIX_OFFSET_2		GENMASK(8, 0)
+#define GE2D_MATRIX_SAT_EN		BIT(7)
+#define GE2D_MATRIX_EN			BIT(0)
+
+#define GE2D_ALU_OP_CTRL		GE2D_REG(0x2c)
+#define GE2D_COLOR_BLEND_MODE		GENMASK(26, 24)
+#define GE2D_COLOR_SRC_FACTOR		GENMASK(23, 20)
+#define GE2D_COLOR_LOGIC_OP		GENMASK(19, 16)
+#define GE2D_ALPHA_BLEND_MODE		GENMASK(10, 8)
+#define GE2D_ALPHA_SRC_FACTOR		GENMASK(7, 4)
+#define GE2D_ALPHA_LOGIC_OP		GENMASK(3, 0)
+
+#define GE2D_OPERATION_LOGIC		5
+#define GE2D_LOGIC_OP_COPY		1
+#define GE2D_LOGIC_OP_SET		2
+
+#define GE2D_ALU_CONST_COLOR		GE2D_REG(0x2d)
+#define GE2D_ALU_CONST_ALPHA		GENMASK(7, 0)
+
+#endif /* __GE2D_REGS__ */
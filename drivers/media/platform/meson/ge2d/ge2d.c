@@ -0,0 +1,1174 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Driver for the Amlogic Meson GE2D 2D graphics engine
+ *
+ * The engine reads one source rectangle through a canvas, optionally
+ * converts it from YUV to RGB, scales it, rotates/flips it and writes
+ * the result into a rectangle of the destination canvas.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/clk.h>
+#include <linux/delay.h>
+#include <linux/interrupt.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/of.h>
+#include <linux/platform_device.h>
+#include <linux/pm_runtime.h>
+#include <linux/regmap.h>
+#include <linux/reset.h>
+#include <linux/slab.h>
+#include <linux/soc/amlogic/meson-canvas.h>
+
+#include <media/v4l2-ctrls.h>
+#include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
+#include <media/v4l2-ioctl.h>
+#include <media/v4l2-mem2mem.h>
+#include <media/v4l2-rect.h>
+#include <media/videobuf2-dma-contig.h>
+#include <media/videobuf2-v4l2.h>
+
+#include "ge2d-regs.h"
+
+#define GE2D_NAME	"meson-ge2d"
+
+#define DEFAULT_WIDTH	640
+#define DEFAULT_HEIGHT	480
+
+#define MIN_SIZE	8
+#define MAX_SIZE	8191
+
+/* Canvas strides are programmed in units of 8 bytes, keep lines aligned */
+#define STRIDE_ALIGN	32
+
+struct ge2d_fmt {
+	u32 fourcc;
+	bool alpha;
+	bool yuv;
+	bool le;
+	unsigned int depth;
+	unsigned int hw_fmt;
+	unsigned int hw_map;
+};
+
+struct ge2d_frame {
+	struct v4l2_pix_format pix_fmt;
+	/* crop rectangle on the output queue, compose on the capture queue */
+	struct v4l2_rect rect;
+	const struct ge2d_fmt *fmt;
+};
+
+struct meson_ge2d;
+
+struct ge2d_ctx {
+	struct v4l2_fh fh;
+	struct meson_ge2d *ge2d;
+	struct ge2d_frame in;
+	struct ge2d_frame out;
+	struct v4l2_ctrl_handler ctrl_handler;
+
+	unsigned long sequence_out, sequence_cap;
+
+	/* colorimetry of the output queue, reported on both queues */
+	enum v4l2_colorspace colorspace;
+	enum v4l2_ycbcr_encoding ycbcr_enc;
+	enum v4l2_xfer_func xfer_func;
+	enum v4l2_quantization quant;
+
+	/* control values, protected by ge2d->ctrl_lock */
+	bool hflip;
+	bool vflip;
+	u32 rotate;
+	u8 alpha;
+};
+
+struct meson_ge2d {
+	struct v4l2_device v4l2_dev;
+	struct v4l2_m2m_dev *m2m_dev;
+	struct video_device *vfd;
+
+	struct device *dev;
+	struct regmap *map;
+	struct clk *clk;
+	struct reset_control *rst;
+
+	struct meson_canvas *canvas;
+	u8 canvas_src;
+	u8 canvas_dst;
+
+	/* serializes the ioctls and the vb2 queues */
+	struct mutex mutex;
+	spinlock_t ctrl_lock;
+
+	struct ge2d_ctx *curr;
+};
+
+static const struct ge2d_fmt formats[] = {
+	{
+		.fourcc = V4L2_PIX_FMT_ABGR32,
+		.alpha = true,
+		.le = true,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_ARGB8888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_XBGR32,
+		.le = true,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_ARGB8888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_ARGB32,
+		.alpha = true,
+		.le = true,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_BGRA8888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_XRGB32,
+		.le = true,
+		.depth = 32,
+		.hw_fmt = GE2D_FORMAT_32BIT,
+		.hw_map = GE2D_COLOR_MAP_BGRA8888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RGB24,
+		.le = true,
+		.depth = 24,
+		.hw_fmt = GE2D_FORMAT_24BIT,
+		.hw_map = GE2D_COLOR_MAP_BGR888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_BGR24,
+		.le = true,
+		.depth = 24,
+		.hw_fmt = GE2D_FORMAT_24BIT,
+		.hw_map = GE2D_COLOR_MAP_RGB888,
+	},
+	{
+		.fourcc = V4L2_PIX_FMT_RGB565,
+		.le = true,
+		.depth = 16,
+		.hw_fmt = GE2D_FORMAT_16BIT,
+		.hw_map = GE2D_COLOR_MAP_RGB565,
+	},
+	/* YUV is only accepted as a source, the matrix converts it to RGB */
+	{
+		.fourcc = V4L2_PIX_FMT_YUYV,
+		.yuv = true,
+		.le = true,
+		.depth = 16,
+		.hw_fmt = GE2D_FORMAT_16BIT,
+		.hw_map = GE2D_COLOR_MAP_YUV422,
+	},
+};
+
+#define NUM_FORMATS ARRAY_SIZE(formats)
+
+struct ge2d_csc {
+	int pre_offset[3];
+	int coef[3][3];
+};
+
+/* Limited range YCbCr to full range RGB, coefficients in 2.10 format */
+static const struct ge2d_csc ge2d_csc_bt601 = {
+	.pre_offset = { -16, -128, -128 },
+	.coef = {
+		{ 1192,    0, 1634 },
+		{ 1192, -401, -832 },
+		{ 1192, 2066,    0 },
+	},
+};
+
+static const struct ge2d_csc ge2d_csc_bt709 = {
+	.pre_offset = { -16, -128, -128 },
+	.coef = {
+		{ 1192,    0, 1836 },
+		{ 1192, -218, -546 },
+		{ 1192, 2163,    0 },
+	},
+};
+
+static const struct ge2d_fmt *find_fmt(u32 pixelformat, enum v4l2_buf_type type)
+{
+	unsigned int i;
+
+	for (i = 0; i < NUM_FORMATS; i++) {
+		if (formats[i].fourcc != pixelformat)
+			continue;
+		if (formats[i].yuv && !V4L2_TYPE_IS_OUTPUT(type))
+			return NULL;
+		return &formats[i];
+	}
+
+	return NULL;
+}
+
+static struct ge2d_frame *get_frame(struct ge2d_ctx *ctx,
+				    enum v4l2_buf_type type)
+{
+	switch (type) {
+	case V4L2_BUF_TYPE_VIDEO_OUTPUT:
+		return &ctx->in;
+	case V4L2_BUF_TYPE_VIDEO_CAPTURE:
+		return &ctx->out;
+	default:
+		return ERR_PTR(-EINVAL);
+	}
+}
+
+static inline u32 ge2d_start_end(unsigned int start, unsigned int len)
+{
+	return FIELD_PREP(GE2D_START, start) |
+	       FIELD_PREP(GE2D_END, start + len - 1);
+}
+
+static u32 ge2d_scale_step(unsigned int in, unsigned int out)
+{
+	return FIELD_PREP(GE2D_SC_STEP,
+			  div_u64((u64)in << GE2D_SC_STEP_SHIFT, out));
+}
+
+static void ge2d_hw_setup_csc(struct meson_ge2d *ge2d, struct ge2d_ctx *ctx)
+{
+	const struct ge2d_csc *csc;
+	const int (*c)[3];
+
+	if (!ctx->in.fmt->yuv) {
+		regmap_write(ge2d->map, GE2D_MATRIX_COEF22_CTRL, 0);
+		return;
+	}
+
+	if (ctx->ycbcr_enc == V4L2_YCBCR_ENC_709)
+		csc = &ge2d_csc_bt709;
+	else
+		csc = &ge2d_csc_bt601;
+	c = csc->coef;
+
+	regmap_write(ge2d->map, GE2D_MATRIX_PRE_OFFSET,
+		     FIELD_PREP(GE2D_MATRIX_OFFSET_0, csc->pre_offset[0]) |
+		     FIELD_PREP(GE2D_MATRIX_OFFSET_1, csc->pre_offset[1]) |
+		     FIELD_PREP(GE2D_MATRIX_OFFSET_2, csc->pre_offset[2]));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF00_01,
+		     FIELD_PREP(GE2D_MATRIX_COEF_A, c[0][0]) |
+		     FIELD_PREP(GE2D_MATRIX_COEF_B, c[0][1]));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF02_10,
+		     FIELD_PREP(GE2D_MATRIX_COEF_A, c[0][2]) |
+		     FIELD_PREP(GE2D_MATRIX_COEF_B, c[1][0]));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF11_12,
+		     FIELD_PREP(GE2D_MATRIX_COEF_A, c[1][1]) |
+		     FIELD_PREP(GE2D_MATRIX_COEF_B, c[1][2]));
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF20_21,
+		     FIELD_PREP(GE2D_MATRIX_COEF_A, c[2][0]) |
+		     FIELD_PREP(GE2D_MATRIX_COEF_B, c[2][1]));
+	regmap_write(ge2d->map, GE2D_MATRIX_OFFSET, 0);
+	regmap_write(ge2d->map, GE2D_MATRIX_COEF22_CTRL,
+		     FIELD_PREP(GE2D_MATRIX_COEF_A, c[2][2]) |
+		     GE2D_MATRIX_SAT_EN | GE2D_MATRIX_EN);
+}
+
+static void ge2d_hw_start(struct meson_ge2d *ge2d, struct ge2d_ctx *ctx,
+			  struct vb2_v4l2_buffer *src,
+			  struct vb2_v4l2_buffer *dst)
+{
+	const struct v4l2_rect *in = &ctx->in.rect;
+	const struct v4l2_rect *out = &ctx->out.rect;
+	unsigned int out_w, out_h;
+	bool hflip, vflip, xy_swap, x_rev, y_rev;
+	u32 rotate, cmd = 0, sc_ctrl = 0;
+	unsigned long flags;
+	u8 alpha;
+
+	spin_lock_irqsave(&ge2d->ctrl_lock, flags);
+	hflip = ctx->hflip;
+	vflip = ctx->vflip;
+	rotate = ctx->rotate;
+	alpha = ctx->alpha;
+	spin_unlock_irqrestore(&ge2d->ctrl_lock, flags);
+
+	/*
+	 * Rotations are a transpose followed by a mirror of the destination.
+	 * The flips apply to the source, so they exchange axes when the
+	 * image is transposed.
+	 */
+	xy_swap = rotate == 90 || rotate == 270;
+	x_rev = rotate == 90 || rotate == 180;
+	y_rev = rotate == 180 || rotate == 270;
+	if (xy_swap) {
+		x_rev ^= vflip;
+		y_rev ^= hflip;
+	} else {
+		x_rev ^= hflip;
+		y_rev ^= vflip;
+	}
+
+	if (xy_swap)
+		cmd |= GE2D_DST_XY_SWAP;
+	if (x_rev)
+		cmd |= GE2D_DST_X_REV;
+	if (y_rev)
+		cmd |= GE2D_DST_Y_REV;
+
+	/* The scaler works in source orientation */
+	out_w = xy_swap ? out->height : out->width;
+	out_h = xy_swap ? out->width : out->height;
+
+	meson_canvas_config(ge2d->canvas, ge2d->canvas_src,
+			    vb2_dma_contig_plane_dma_addr(&src->vb2_buf, 0),
+			    ctx->in.pix_fmt.bytesperline,
+			    ctx->in.pix_fmt.height,
+			    MESON_CANVAS_WRAP_NONE,
+			    MESON_CANVAS_BLKMODE_LINEAR, 0);
+	meson_canvas_config(ge2d->canvas, ge2d->canvas_dst,
+			    vb2_dma_contig_plane_dma_addr(&dst->vb2_buf, 0),
+			    ctx->out.pix_fmt.bytesperline,
+			    ctx->out.pix_fmt.height,
+			    MESON_CANVAS_WRAP_NONE,
+			    MESON_CANVAS_BLKMODE_LINEAR, 0);
+
+	regmap_write(ge2d->map, GE2D_GEN_CTRL0, 0);
+	regmap_write(ge2d->map, GE2D_GEN_CTRL2,
+		     FIELD_PREP(GE2D_SRC1_FORMAT, ctx->in.fmt->hw_fmt) |
+		     FIELD_PREP(GE2D_SRC1_COLOR_MAP, ctx->in.fmt->hw_map) |
+		     (ctx->in.fmt->le ? GE2D_SRC1_LITTLE_ENDIAN : 0) |
+		     FIELD_PREP(GE2D_SRC2_FORMAT, ctx->out.fmt->hw_fmt) |
+		     FIELD_PREP(GE2D_SRC2_COLOR_MAP, ctx->out.fmt->hw_map) |
+		     (ctx->out.fmt->le ? GE2D_SRC2_LITTLE_ENDIAN : 0) |
+		     FIELD_PREP(GE2D_DST_FORMAT, ctx->out.fmt->hw_fmt) |
+		     FIELD_PREP(GE2D_DST_COLOR_MAP, ctx->out.fmt->hw_map) |
+		     (ctx->out.fmt->le ? GE2D_DST_LITTLE_ENDIAN : 0));
+	regmap_write(ge2d->map, GE2D_SRC1_FMT_CTRL,
+		     ctx->in.fmt->yuv ? GE2D_SRC1_X_YC_RATIO : 0);
+
+	regmap_write(ge2d->map, GE2D_SRC1_CANVAS,
+		     FIELD_PREP(GE2D_SRC1_X_CANVAS, ge2d->canvas_src));
+	regmap_write(ge2d->map, GE2D_SRC2_DST_CANVAS,
+		     FIELD_PREP(GE2D_SRC2_CANVAS, ge2d->canvas_dst) |
+		     FIELD_PREP(GE2D_DST_CANVAS, ge2d->canvas_dst));
+
+	regmap_write(ge2d->map, GE2D_SRC1_CLIPX_START_END,
+		     ge2d_start_end(in->left, in->width));
+	regmap_write(ge2d->map, GE2D_SRC1_CLIPY_START_END,
+		     ge2d_start_end(in->top, in->height));
+	regmap_write(ge2d->map, GE2D_SRC1_X_START_END,
+		     ge2d_start_end(in->left, in->width));
+	regmap_write(ge2d->map, GE2D_SRC1_Y_START_END,
+		     ge2d_start_end(in->top, in->height));
+
+	regmap_write(ge2d->map, GE2D_DST_CLIPX_START_END,
+		     ge2d_start_end(out->left, out->width));
+	regmap_write(ge2d->map, GE2D_DST_CLIPY_START_END,
+		     ge2d_start_end(out->top, out->height));
+	regmap_write(ge2d->map, GE2D_DST_X_START_END,
+		     ge2d_start_end(out->left, out->width));
+	regmap_write(ge2d->map, GE2D_DST_Y_START_END,
+		     ge2d_start_end(out->top, out->height));
+
+	if (in->width != out_w) {
+		regmap_write(ge2d->map, GE2D_HSC_START_PHASE_STEP,
+			     ge2d_scale_step(in->width, out_w));
+		regmap_write(ge2d->map, GE2D_HSC_INI_CTRL, 0);
+		sc_ctrl |= GE2D_SC_HSC_EN;
+	}
+	if (in->height != out_h) {
+		regmap_write(ge2d->map, GE2D_VSC_START_PHASE_STEP,
+			     ge2d_scale_step(in->height, out_h));
+		regmap_write(ge2d->map, GE2D_VSC_INI_CTRL, 0);
+		sc_ctrl |= GE2D_SC_VSC_EN;
+	}
+	regmap_write(ge2d->map, GE2D_SC_MISC_CTRL, sc_ctrl);
+
+	ge2d_hw_setup_csc(ge2d, ctx);
+
+	/* Copy the colors, take alpha from the control if the source has none */
+	regmap_write(ge2d->map, GE2D_ALU_CONST_COLOR,
+		     FIELD_PREP(GE2D_ALU_CONST_ALPHA, alpha));
+	regmap_write(ge2d->map, GE2D_ALU_OP_CTRL,
+		     FIELD_PREP(GE2D_COLOR_BLEND_MODE, GE2D_OPERATION_LOGIC) |
+		     FIELD_PREP(GE2D_COLOR_LOGIC_OP, GE2D_LOGIC_OP_COPY) |
+		     FIELD_PREP(GE2D_ALPHA_BLEND_MODE, GE2D_OPERATION_LOGIC) |
+		     FIELD_PREP(GE2D_ALPHA_LOGIC_OP,
+				ctx->in.fmt->alpha ? GE2D_LOGIC_OP_COPY :
+						     GE2D_LOGIC_OP_SET));
+
+	regmap_write(ge2d->map, GE2D_CMD_CTRL, cmd | GE2D_CBUS_CMD_WR);
+}
+
+static void device_run(void *priv)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct meson_ge2d *ge2d = ctx->ge2d;
+	struct vb2_v4l2_buffer *src, *dst;
+
+	src = v4l2_m2m_next_src_buf(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_next_dst_buf(ctx->fh.m2m_ctx);
+
+	ge2d->curr = ctx;
+
+	ge2d_hw_start(ge2d, ctx, src, dst);
+}
+
+static irqreturn_t ge2d_isr(int irq, void *priv)
+{
+	struct meson_ge2d *ge2d = priv;
+	struct vb2_v4l2_buffer *src, *dst;
+	struct ge2d_ctx *ctx;
+	u32 status;
+
+	regmap_read(ge2d->map, GE2D_STATUS0, &status);
+	if (status & GE2D_GE2D_BUSY)
+		return IRQ_NONE;
+
+	ctx = ge2d->curr;
+	if (WARN_ON(!ctx))
+		return IRQ_NONE;
+
+	ge2d->curr = NULL;
+
+	src = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+	dst = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+
+	src->sequence = ctx->sequence_out++;
+	dst->sequence = ctx->sequence_cap++;
+	v4l2_m2m_buf_copy_metadata(src, dst, true);
+
+	v4l2_m2m_buf_done(src, VB2_BUF_STATE_DONE);
+	v4l2_m2m_buf_done(dst, VB2_BUF_STATE_DONE);
+	v4l2_m2m_job_finish(ge2d->m2m_dev, ctx->fh.m2m_ctx);
+
+	return IRQ_HANDLED;
+}
+
+static const struct v4l2_m2m_ops ge2d_m2m_ops = {
+	.device_run = device_run,
+};
+
+static int ge2d_queue_setup(struct vb2_queue *vq,
+			    unsigned int *nbuffers, unsigned int *nplanes,
+			    unsigned int sizes[], struct device *alloc_devs[])
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+	struct ge2d_frame *f = get_frame(ctx, vq->type);
+
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	if (*nplanes)
+		return sizes[0] < f->pix_fmt.sizeimage ? -EINVAL : 0;
+
+	sizes[0] = f->pix_fmt.sizeimage;
+	*nplanes = 1;
+
+	return 0;
+}
+
+static int ge2d_buf_out_validate(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+
+	vbuf->field = V4L2_FIELD_NONE;
+
+	return 0;
+}
+
+static int ge2d_buf_prepare(struct vb2_buffer *vb)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+	struct ge2d_frame *f = get_frame(ctx, vb->vb2_queue->type);
+
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	if (vb2_plane_size(vb, 0) < f->pix_fmt.sizeimage)
+		return -EINVAL;
+
+	vb2_set_plane_payload(vb, 0, f->pix_fmt.sizeimage);
+
+	return 0;
+}
+
+static void ge2d_buf_queue(struct vb2_buffer *vb)
+{
+	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vb->vb2_queue);
+
+	v4l2_m2m_buf_queue(ctx->fh.m2m_ctx, vbuf);
+}
+
+static void ge2d_return_buffers(struct vb2_queue *vq,
+				enum vb2_buffer_state state)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+	struct vb2_v4l2_buffer *vbuf;
+
+	for (;;) {
+		if (V4L2_TYPE_IS_OUTPUT(vq->type))
+			vbuf = v4l2_m2m_src_buf_remove(ctx->fh.m2m_ctx);
+		else
+			vbuf = v4l2_m2m_dst_buf_remove(ctx->fh.m2m_ctx);
+		if (!vbuf)
+			break;
+		v4l2_m2m_buf_done(vbuf, state);
+	}
+}
+
+static int ge2d_start_streaming(struct vb2_queue *vq, unsigned int count)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+	struct meson_ge2d *ge2d = ctx->ge2d;
+	int ret;
+
+	ret = pm_runtime_get_sync(ge2d->dev);
+	if (ret < 0) {
+		pm_runtime_put_noidle(ge2d->dev);
+		ge2d_return_buffers(vq, VB2_BUF_STATE_QUEUED);
+		return ret;
+	}
+
+	if (V4L2_TYPE_IS_OUTPUT(vq->type))
+		ctx->sequence_out = 0;
+	else
+		ctx->sequence_cap = 0;
+
+	return 0;
+}
+
+static void ge2d_stop_streaming(struct vb2_queue *vq)
+{
+	struct ge2d_ctx *ctx = vb2_get_drv_priv(vq);
+
+	ge2d_return_buffers(vq, VB2_BUF_STATE_ERROR);
+	pm_runtime_put(ctx->ge2d->dev);
+}
+
+static const struct vb2_ops ge2d_qops = {
+	.queue_setup = ge2d_queue_setup,
+	.buf_out_validate = ge2d_buf_out_validate,
+	.buf_prepare = ge2d_buf_prepare,
+	.buf_queue = ge2d_buf_queue,
+	.start_streaming = ge2d_start_streaming,
+	.stop_streaming = ge2d_stop_streaming,
+	.wait_prepare = vb2_ops_wait_prepare,
+	.wait_finish = vb2_ops_wait_finish,
+};
+
+static int queue_init(void *priv, struct vb2_queue *src_vq,
+		      struct vb2_queue *dst_vq)
+{
+	struct ge2d_ctx *ctx = priv;
+	int ret;
+
+	src_vq->type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+	src_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	src_vq->drv_priv = ctx;
+	src_vq->ops = &ge2d_qops;
+	src_vq->mem_ops = &vb2_dma_contig_memops;
+	src_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	src_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	src_vq->lock = &ctx->ge2d->mutex;
+	src_vq->dev = ctx->ge2d->v4l2_dev.dev;
+
+	ret = vb2_queue_init(src_vq);
+	if (ret)
+		return ret;
+
+	dst_vq->type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	dst_vq->io_modes = VB2_MMAP | VB2_DMABUF;
+	dst_vq->drv_priv = ctx;
+	dst_vq->ops = &ge2d_qops;
+	dst_vq->mem_ops = &vb2_dma_contig_memops;
+	dst_vq->buf_struct_size = sizeof(struct v4l2_m2m_buffer);
+	dst_vq->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_COPY;
+	dst_vq->lock = &ctx->ge2d->mutex;
+	dst_vq->dev = ctx->ge2d->v4l2_dev.dev;
+
+	return vb2_queue_init(dst_vq);
+}
+
+static int vidioc_querycap(struct file *file, void *priv,
+			   struct v4l2_capability *cap)
+{
+	strscpy(cap->driver, GE2D_NAME, sizeof(cap->driver));
+	strscpy(cap->card, GE2D_NAME, sizeof(cap->card));
+	strscpy(cap->bus_info, "platform:" GE2D_NAME, sizeof(cap->bus_info));
+
+	return 0;
+}
+
+static int vidioc_enum_fmt(struct file *file, void *priv,
+			   struct v4l2_fmtdesc *f)
+{
+	unsigned int i, n = 0;
+
+	for (i = 0; i < NUM_FORMATS; i++) {
+		if (formats[i].yuv && !V4L2_TYPE_IS_OUTPUT(f->type))
+			continue;
+		if (n++ == f->index) {
+			f->pixelformat = formats[i].fourcc;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int vidioc_g_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct ge2d_frame *frm;
+
+	frm = get_frame(ctx, f->type);
+	if (IS_ERR(frm))
+		return PTR_ERR(frm);
+
+	f->fmt.pix = frm->pix_fmt;
+	f->fmt.pix.colorspace = ctx->colorspace;
+	f->fmt.pix.ycbcr_enc = ctx->ycbcr_enc;
+	f->fmt.pix.xfer_func = ctx->xfer_func;
+	f->fmt.pix.quantization = ctx->quant;
+
+	return 0;
+}
+
+static void ge2d_fill_fmt(struct v4l2_pix_format *pix,
+			  const struct ge2d_fmt *fmt)
+{
+	pix->pixelformat = fmt->fourcc;
+	pix->field = V4L2_FIELD_NONE;
+
+	pix->width = clamp_t(u32, pix->width, MIN_SIZE, MAX_SIZE);
+	pix->height = clamp_t(u32, pix->height, MIN_SIZE, MAX_SIZE);
+	if (fmt->yuv)
+		pix->width = ALIGN(pix->width, 2);
+
+	pix->bytesperline = ALIGN(pix->width * fmt->depth / 8, STRIDE_ALIGN);
+	pix->sizeimage = pix->bytesperline * pix->height;
+}
+
+static int vidioc_try_fmt(struct file *file, void *priv,
+			  struct v4l2_format *f)
+{
+	struct ge2d_ctx *ctx = priv;
+	const struct ge2d_fmt *fmt;
+
+	fmt = find_fmt(f->fmt.pix.pixelformat, f->type);
+	if (!fmt)
+		fmt = &formats[0];
+
+	ge2d_fill_fmt(&f->fmt.pix, fmt);
+
+	if (V4L2_TYPE_IS_OUTPUT(f->type)) {
+		if (f->fmt.pix.colorspace == V4L2_COLORSPACE_DEFAULT)
+			f->fmt.pix.colorspace = fmt->yuv ?
+						V4L2_COLORSPACE_SMPTE170M :
+						V4L2_COLORSPACE_SRGB;
+	} else {
+		/* The capture side follows the output colorimetry */
+		f->fmt.pix.colorspace = ctx->colorspace;
+		f->fmt.pix.ycbcr_enc = ctx->ycbcr_enc;
+		f->fmt.pix.xfer_func = ctx->xfer_func;
+		f->fmt.pix.quantization = ctx->quant;
+	}
+
+	return 0;
+}
+
+static int vidioc_s_fmt(struct file *file, void *priv, struct v4l2_format *f)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct meson_ge2d *ge2d = ctx->ge2d;
+	struct vb2_queue *vq;
+	struct ge2d_frame *frm;
+	int ret;
+
+	ret = vidioc_try_fmt(file, priv, f);
+	if (ret)
+		return ret;
+
+	vq = v4l2_m2m_get_vq(ctx->fh.m2m_ctx, f->type);
+	if (vb2_is_busy(vq)) {
+		v4l2_err(&ge2d->v4l2_dev, "queue (%d) busy\n", f->type);
+		return -EBUSY;
+	}
+
+	frm = get_frame(ctx, f->type);
+	if (IS_ERR(frm))
+		return PTR_ERR(frm);
+
+	frm->pix_fmt = f->fmt.pix;
+	frm->fmt = find_fmt(f->fmt.pix.pixelformat, f->type);
+
+	/* Reset crop/compose to the whole frame */
+	frm->rect.left = 0;
+	frm->rect.top = 0;
+	frm->rect.width = frm->pix_fmt.width;
+	frm->rect.height = frm->pix_fmt.height;
+
+	if (V4L2_TYPE_IS_OUTPUT(f->type)) {
+		ctx->colorspace = f->fmt.pix.colorspace;
+		ctx->ycbcr_enc = f->fmt.pix.ycbcr_enc;
+		ctx->xfer_func = f->fmt.pix.xfer_func;
+		ctx->quant = f->fmt.pix.quantization;
+	}
+
+	return 0;
+}
+
+static int vidioc_g_selection(struct file *file, void *priv,
+			      struct v4l2_selection *s)
+{
+	struct ge2d_ctx *ctx = priv;
+	struct ge2d_frame *f;
+
+	f = get_frame(ctx, s->type);
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	switch (s->target) {
+	case V4L2_SEL_TGT_CROP:
+		if (s->type != V4L2_BUF_TYPE_VIDEO_OUTPUT)
+			return -EINVAL;
+		s->r = f->rect;
+		return 0;
+	case V4L2_SEL_TGT_COMPOSE:
+		if (s->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
+			return -EINVAL;
+		s->r = f->rect;
+		return 0;
+	case V4L2_SEL_TGT_CROP_DEFAULT:
+	case V4L2_SEL_TGT_CROP_BOUNDS:
+		if (s->type != V4L2_BUF_TYPE_VIDEO_OUTPUT)
+			return -EINVAL;
+		break;
+	case V4L2_SEL_TGT_COMPOSE_DEFAULT:
+	case V4L2_SEL_TGT_COMPOSE_BOUNDS:
+		if (s->type != V4L2_BUF_TYPE_VIDEO_CAPTURE)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	s->r.left = 0;
+	s->r.top = 0;
+	s->r.width = f->pix_fmt.width;
+	s->r.height = f->pix_fmt.height;
+
+	return 0;
+}
+
+static int vidioc_s_selection(struct file *file, void *priv,
+			      struct v4l2_selection *s)
+{
+	struct ge2d_ctx *ctx = priv;
+	const struct v4l2_rect min = { 0, 0, MIN_SIZE, MIN_SIZE };
+	struct v4l2_rect bounds = { 0, 0 };
+	struct ge2d_frame *f;
+
+	f = get_frame(ctx, s->type);
+	if (IS_ERR(f))
+		return PTR_ERR(f);
+
+	if ((s->type == V4L2_BUF_TYPE_VIDEO_OUTPUT &&
+	     s->target != V4L2_SEL_TGT_CROP) ||
+	    (s->type == V4L2_BUF_TYPE_VIDEO_CAPTURE &&
+	     s->target != V4L2_SEL_TGT_COMPOSE))
+		return -EINVAL;
+
+	bounds.width = f->pix_fmt.width;
+	bounds.height = f->pix_fmt.height;
+
+	/* YUYV carries one chroma sample per pixel pair */
+	if (f->fmt->yuv) {
+		s->r.left = round_down(s->r.left, 2);
+		s->r.width = round_down(s->r.width, 2);
+	}
+
+	v4l2_rect_set_min_size(&s->r, &min);
+	v4l2_rect_map_inside(&s->r, &bounds);
+
+	f->rect = s->r;
+
+	return 0;
+}
+
+static const struct v4l2_ioctl_ops ge2d_ioctl_ops = {
+	.vidioc_querycap = vidioc_querycap,
+
+	.vidioc_enum_fmt_vid_cap = vidioc_enum_fmt,
+	.vidioc_g_fmt_vid_cap = vidioc_g_fmt,
+	.vidioc_try_fmt_vid_cap = vidioc_try_fmt,
+	.vidioc_s_fmt_vid_cap = vidioc_s_fmt,
+
+	.vidioc_enum_fmt_vid_out = vidioc_enum_fmt,
+	.vidioc_g_fmt_vid_out = vidioc_g_fmt,
+	.vidioc_try_fmt_vid_out = vidioc_try_fmt,
+	.vidioc_s_fmt_vid_out = vidioc_s_fmt,
+
+	.vidioc_reqbufs = v4l2_m2m_ioctl_reqbufs,
+	.vidioc_querybuf = v4l2_m2m_ioctl_querybuf,
+	.vidioc_qbuf = v4l2_m2m_ioctl_qbuf,
+	.vidioc_dqbuf = v4l2_m2m_ioctl_dqbuf,
+	.vidioc_prepare_buf = v4l2_m2m_ioctl_prepare_buf,
+	.vidioc_create_bufs = v4l2_m2m_ioctl_create_bufs,
+	.vidioc_expbuf = v4l2_m2m_ioctl_expbuf,
+
+	.vidioc_streamon = v4l2_m2m_ioctl_streamon,
+	.vidioc_streamoff = v4l2_m2m_ioctl_streamoff,
+
+	.vidioc_g_selection = vidioc_g_selection,
+	.vidioc_s_selection = vidioc_s_selection,
+
+	.vidioc_subscribe_event = v4l2_ctrl_subscribe_event,
+	.vidioc_unsubscribe_event = v4l2_event_unsubscribe,
+};
+
+static int ge2d_s_ctrl(struct v4l2_ctrl *ctrl)
+{
+	struct ge2d_ctx *ctx = container_of(ctrl->handler, struct ge2d_ctx,
+					    ctrl_handler);
+	unsigned long flags;
+
+	spin_lock_irqsave(&ctx->ge2d->ctrl_lock, flags);
+	switch (ctrl->id) {
+	case V4L2_CID_HFLIP:
+		ctx->hflip = ctrl->val;
+		break;
+	case V4L2_CID_VFLIP:
+		ctx->vflip = ctrl->val;
+		break;
+	case V4L2_CID_ROTATE:
+		ctx->rotate = ctrl->val;
+		break;
+	case V4L2_CID_ALPHA_COMPONENT:
+		ctx->alpha = ctrl->val;
+		break;
+	}
+	spin_unlock_irqrestore(&ctx->ge2d->ctrl_lock, flags);
+
+	return 0;
+}
+
+static const struct v4l2_ctrl_ops ge2d_ctrl_ops = {
+	.s_ctrl = ge2d_s_ctrl,
+};
+
+static int ge2d_setup_ctrls(struct ge2d_ctx *ctx)
+{
+	struct v4l2_ctrl_handler *hdl = &ctx->ctrl_handler;
+
+	v4l2_ctrl_handler_init(hdl, 4);
+
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_HFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_VFLIP, 0, 1, 1, 0);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_ROTATE, 0, 270, 90, 0);
+	v4l2_ctrl_new_std(hdl, &ge2d_ctrl_ops, V4L2_CID_ALPHA_COMPONENT,
+			  0, 255, 1, 255);
+
+	if (hdl->error) {
+		int err = hdl->error;
+
+		v4l2_ctrl_handler_free(hdl);
+		return err;
+	}
+
+	return v4l2_ctrl_handler_setup(hdl);
+}
+
+static void ge2d_init_frame(struct ge2d_frame *frm)
+{
+	frm->fmt = &formats[0];
+	frm->pix_fmt.width = DEFAULT_WIDTH;
+	frm->pix_fmt.height = DEFAULT_HEIGHT;
+	ge2d_fill_fmt(&frm->pix_fmt, frm->fmt);
+
+	frm->rect.left = 0;
+	frm->rect.top = 0;
+	frm->rect.width = DEFAULT_WIDTH;
+	frm->rect.height = DEFAULT_HEIGHT;
+}
+
+static int ge2d_open(struct file *file)
+{
+	struct meson_ge2d *ge2d = video_drvdata(file);
+	struct ge2d_ctx *ctx;
+	int ret;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+	ctx->ge2d = ge2d;
+
+	ge2d_init_frame(&ctx->in);
+	ge2d_init_frame(&ctx->out);
+	ctx->colorspace = V4L2_COLORSPACE_SRGB;
+
+	if (mutex_lock_interruptible(&ge2d->mutex)) {
+		kfree(ctx);
+		return -ERESTARTSYS;
+	}
+
+	ctx->fh.m2m_ctx = v4l2_m2m_ctx_init(ge2d->m2m_dev, ctx, &queue_init);
+	if (IS_ERR(ctx->fh.m2m_ctx)) {
+		ret = PTR_ERR(ctx->fh.m2m_ctx);
+		goto err_unlock;
+	}
+
+	ret = ge2d_setup_ctrls(ctx);
+	if (ret)
+		goto err_release_m2m;
+
+	v4l2_fh_init(&ctx->fh, video_devdata(file));
+	ctx->fh.ctrl_handler = &ctx->ctrl_handler;
+	file->private_data = &ctx->fh;
+	v4l2_fh_add(&ctx->fh);
+
+	mutex_unlock(&ge2d->mutex);
+
+	return 0;
+
+err_release_m2m:
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+err_unlock:
+	mutex_unlock(&ge2d->mutex);
+	kfree(ctx);
+
+	return ret;
+}
+
+static int ge2d_release(struct file *file)
+{
+	struct ge2d_ctx *ctx = container_of(file->private_data,
+					    struct ge2d_ctx, fh);
+	struct meson_ge2d *ge2d = ctx->ge2d;
+
+	mutex_lock(&ge2d->mutex);
+
+	v4l2_m2m_ctx_release(ctx->fh.m2m_ctx);
+	v4l2_ctrl_handler_free(&ctx->ctrl_handler);
+	v4l2_fh_del(&ctx->fh);
+	v4l2_fh_exit(&ctx->fh);
+	kfree(ctx);
+
+	mutex_unlock(&ge2d->mutex);
+
+	return 0;
+}
+
+static const struct v4l2_file_operations ge2d_fops = {
+	.owner = THIS_MODULE,
+	.open = ge2d_open,
+	.release = ge2d_release,
+	.poll = v4l2_m2m_fop_poll,
+	.unlocked_ioctl = video_ioctl2,
+	.mmap = v4l2_m2m_fop_mmap,
+};
+
+static const struct video_device ge2d_videodev = {
+	.name = GE2D_NAME,
+	.fops = &ge2d_fops,
+	.ioctl_ops = &ge2d_ioctl_ops,
+	.minor = -1,
+	.release = video_device_release,
+	.vfl_dir = VFL_DIR_M2M,
+	.device_caps = V4L2_CAP_VIDEO_M2M | V4L2_CAP_STREAMING,
+};
+
+static const struct regmap_config meson_ge2d_regmap_conf = {
+	.reg_bits = 8,
+	.val_bits = 32,
+	.reg_stride = 4,
+	.max_register = GE2D_ALU_CONST_COLOR,
+};
+
+static int ge2d_probe(struct platform_device *pdev)
+{
+	struct meson_ge2d *ge2d;
+	struct video_device *vfd;
+	void __iomem *regs;
+	int ret, irq;
+
+	ge2d = devm_kzalloc(&pdev->dev, sizeof(*ge2d), GFP_KERNEL);
+	if (!ge2d)
+		return -ENOMEM;
+
+	ge2d->dev = &pdev->dev;
+	mutex_init(&ge2d->mutex);
+	spin_lock_init(&ge2d->ctrl_lock);
+
+	regs = devm_platform_ioremap_resource(pdev, 0);
+	if (IS_ERR(regs))
+		return PTR_ERR(regs);
+
+	ge2d->map = devm_regmap_init_mmio(ge2d->dev, regs,
+					  &meson_ge2d_regmap_conf);
+	if (IS_ERR(ge2d->map))
+		return PTR_ERR(ge2d->map);
+
+	irq = platform_get_irq(pdev, 0);
+	if (irq < 0)
+		return irq;
+
+	ret = devm_request_irq(ge2d->dev, irq, ge2d_isr, 0,
+			       dev_name(ge2d->dev), ge2d);
+	if (ret < 0) {
+		dev_err(ge2d->dev, "failed to request irq\n");
+		return ret;
+	}
+
+	ge2d->rst = devm_reset_control_get_exclusive(ge2d->dev, NULL);
+	if (IS_ERR(ge2d->rst)) {
+		dev_err(ge2d->dev, "failed to get reset\n");
+		return PTR_ERR(ge2d->rst);
+	}
+
+	ge2d->clk = devm_clk_get(ge2d->dev, NULL);
+	if (IS_ERR(ge2d->clk)) {
+		dev_err(ge2d->dev, "failed to get clock\n");
+		return PTR_ERR(ge2d->clk);
+	}
+
+	ge2d->canvas = meson_canvas_get(ge2d->dev);
+	if (IS_ERR(ge2d->canvas))
+		return PTR_ERR(ge2d->canvas);
+
+	ret = meson_canvas_alloc(ge2d->canvas, &ge2d->canvas_src);
+	if (ret)
+		return ret;
+
+	ret = meson_canvas_alloc(ge2d->canvas, &ge2d->canvas_dst);
+	if (ret)
+		goto err_free_canvas_src;
+
+	ret = v4l2_device_register(ge2d->dev, &ge2d->v4l2_dev);
+	if (ret)
+		goto err_free_canvas_dst;
+
+	vfd = video_device_alloc();
+	if (!vfd) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to allocate video device\n");
+		ret = -ENOMEM;
+		goto err_unreg_v4l2_dev;
+	}
+
+	*vfd = ge2d_videodev;
+	vfd->lock = &ge2d->mutex;
+	vfd->v4l2_dev = &ge2d->v4l2_dev;
+	video_set_drvdata(vfd, ge2d);
+	ge2d->vfd = vfd;
+
+	platform_set_drvdata(pdev, ge2d);
+
+	ge2d->m2m_dev = v4l2_m2m_init(&ge2d_m2m_ops);
+	if (IS_ERR(ge2d->m2m_dev)) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to init mem2mem device\n");
+		ret = PTR_ERR(ge2d->m2m_dev);
+		goto err_rel_vdev;
+	}
+
+	pm_runtime_enable(ge2d->dev);
+
+	ret = video_register_device(vfd, VFL_TYPE_VIDEO, -1);
+	if (ret) {
+		v4l2_err(&ge2d->v4l2_dev, "Failed to register video device\n");
+		goto err_m2m_release;
+	}
+
+	v4l2_info(&ge2d->v4l2_dev, "Registered %s as /dev/%s\n",
+		  vfd->name, video_device_node_name(vfd));
+
+	return 0;
+
+err_m2m_release:
+	pm_runtime_disable(ge2d->dev);
+	v4l2_m2m_release(ge2d->m2m_dev);
+err_rel_vdev:
+	video_device_release(vfd);
+err_unreg_v4l2_dev:
+	v4l2_device_unregister(&ge2d->v4l2_dev);
+err_free_canvas_dst:
+	meson_canvas_free(ge2d->canvas, ge2d->canvas_dst);
+err_free_canvas_src:
+	meson_canvas_free(ge2d->canvas, ge2d->canvas_src);
+
+	return ret;
+}
+
+static int ge2d_remove(struct platform_device *pdev)
+{
+	struct meson_ge2d *ge2d = platform_get_drvdata(pdev);
+
+	video_unregister_device(ge2d->vfd);
+	v4l2_m2m_release(ge2d->m2m_dev);
+	v4l2_device_unregister(&ge2d->v4l2_dev);
+	pm_runtime_disable(ge2d->dev);
+
+	meson_canvas_free(ge2d->canvas, ge2d->canvas_dst);
+	meson_canvas_free(ge2d->canvas, ge2d->canvas_src);
+
+	return 0;
+}
+
+static int __maybe_unused ge2d_runtime_suspend(struct device *dev)
+{
+	struct meson_ge2d *ge2d = dev_get_drvdata(dev);
+
+	reset_control_assert(ge2d->rst);
+	clk_disable_unprepare(ge2d->clk);
+
+	return 0;
+}
+
+static int __maybe_unused ge2d_runtime_resume(struct device *dev)
+{
+	struct meson_ge2d *ge2d = dev_get_drvdata(dev);
+	int ret;
+
+	ret = clk_prepare_enable(ge2d->clk);
+	if (ret) {
+		dev_err(dev, "failed to enable clock: %d\n", ret);
+		return ret;
+	}
+
+	reset_control_deassert(ge2d->rst);
+	udelay(1);
+
+	/* Raise the interrupt once a command completes */
+	regmap_write(ge2d->map, GE2D_GEN_CTRL1,
+		     FIELD_PREP(GE2D_INTERRUPT_CTRL, GE2D_INTERRUPT_ON_DONE));
+
+	return 0;
+}
+
+static const struct dev_pm_ops ge2d_pm_ops = {
+	SET_RUNTIME_PM_OPS(ge2d_runtime_suspend, ge2d_runtime_resume, NULL)
+};
+
+static const struct of_device_id meson_ge2d_match[] = {
+	{
+		.compatible = "amlogic,axg-ge2d",
+	},
+	{},
+};
+
+MODULE_DEVICE_TABLE(of, meson_ge2d_match);
+
+static struct platform_driver ge2d_drv = {
+	.probe = ge2d_probe,
+	.remove = ge2d_remove,
+	.driver = {
+		.name = GE2D_NAME,
+		.pm = &ge2d_pm_ops,
+		.of_match_table = meson_ge2d_match,
+	},
+};
+
+module_platform_driver(ge2d_drv);
+
+MODULE_DESCRIPTION("Amlogic Meson GE2D 2D graphics engine");
+MODULE_LICENSE("GPL");
@@ -31,6 +31,13 @@
 /* only available on Meson 8b and newer */
 #define IR_DEC_REG2		0x20
 
+/* the max/min fields of the timing registers are in MESON_TRATE units */
+#define LDR_MAX_MASK		GENMASK(28, 16)
+#define LDR_MIN_MASK		GENMASK(12, 0)
+#define BIT_MAX_MASK		GENMASK(25, 16)
+#define BIT_MIN_MASK		GENMASK(9, 0)
+
+#define REG0_FRAME_TIME_MAX_MASK	GENMASK(24, 12)
 #define REG0_RATE_MASK		GENMASK(11, 0)
 
 #define DECODE_MODE_NEC		0x0
@@ -45,6 +52,7 @@
 #define REG2_MODE_SHIFT		0
 
 #define REG1_TIME_IV_MASK	GENMASK(28, 16)
+#define REG1_FRAME_LEN_MASK	GENMASK(13, 8)
 
 #define REG1_IRQSEL_MASK	GENMASK(3, 2)
 #define REG1_IRQSEL_NEC_MODE	0
@@ -55,14 +63,53 @@
 #define REG1_RESET		BIT(0)
 #define REG1_ENABLE		BIT(15)
 
+#define STATUS_BIT_1_ENABLE	BIT(30)
+#define STATUS_BIT_1_MAX_MASK	GENMASK(29, 20)
+#define STATUS_BIT_1_MIN_MASK	GENMASK(19, 10)
 #define STATUS_IR_DEC_IN	BIT(8)
+#define STATUS_FRAME_REPEAT	BIT(0)
 
 #define MESON_TRATE		10	/* us */
 
+/* NEC timings, with +/- 10% tolerance, in MESON_TRATE units */
+#define NEC_TIME(_us, _pct)	((_us) * (100 + (_pct)) / 100 / MESON_TRATE)
+#define NEC_LDR_ACTIVE_US	9000
+#define NEC_LDR_IDLE_US		4500
+#define NEC_LDR_REPEAT_US	2250
+#define NEC_BIT_0_US		1125	/* pulse + space */
+#define NEC_BIT_1_US		2250	/* pulse + space */
+#define NEC_FRAME_TIME_MAX_US	80000
+#define NEC_FRAME_BITS		32
+
+/* protocols the hardware decodes itself, everything else is raw */
+#define MESON_IR_HW_PROTOCOLS	(RC_PROTO_BIT_NEC | RC_PROTO_BIT_NECX | \
+				 RC_PROTO_BIT_NEC32)
+
+/*
+ * NEC decoding reprograms the timings the bootloader relies on for
+ * wakeup, these fields are saved at probe and restored at shutdown.
+ */
+static const struct {
+	unsigned int	reg;
+	u32		mask;
+} meson_ir_boot_fields[] = {
+	{ IR_DEC_LDR_ACTIVE,	LDR_MAX_MASK | LDR_MIN_MASK },
+	{ IR_DEC_LDR_IDLE,	LDR_MAX_MASK | LDR_MIN_MASK },
+	{ IR_DEC_LDR_REPEAT,	BIT_MAX_MASK | BIT_MIN_MASK },
+	{ IR_DEC_BIT_0,		BIT_MAX_MASK | BIT_MIN_MASK },
+	{ IR_DEC_REG0,		REG0_FRAME_TIME_MAX_MASK },
+	{ IR_DEC_STATUS,	STATUS_BIT_1_ENABLE | STATUS_BIT_1_MAX_MASK |
+				STATUS_BIT_1_MIN_MASK },
+	{ IR_DEC_REG1,		REG1_FRAME_LEN_MASK },
+};
+
 struct meson_ir {
 	void __iomem	*reg;
 	struct rc_dev	*rc;
 	spinlock_t	lock;
+	bool		mode_in_reg1;
+	bool		hw_decode;
+	u32		boot_fields[ARRAY_SIZE(meson_ir_boot_fields)];
 };
 
 static void meson_ir_set_mask(struct meson_ir *ir, unsigned int reg,
@@ -76,6 +123,116 @@ static void meson_ir_set_mask(struct meson_ir *ir, unsigned int reg,
 	writel(data, ir->reg + reg);
 }
 
+static void meson_ir_set_mode(struct meson_ir *ir, u32 mode)
+{
+	if (ir->mode_in_reg1)
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
+				  FIELD_PREP(REG1_MODE_MASK, mode));
+	else
+		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
+				  FIELD_PREP(REG2_MODE_MASK, mode));
+}
+
+static void meson_ir_set_timing(struct meson_ir *ir, unsigned int reg,
+				u32 max_mask, u32 min_mask, unsigned int us)
+{
+	meson_ir_set_mask(ir, reg, max_mask | min_mask,
+			  FIELD_PREP(max_mask, NEC_TIME(us, 10)) |
+			  FIELD_PREP(min_mask, NEC_TIME(us, -10)));
+}
+
+/* Must be called with ir->lock held */
+static void meson_ir_config(struct meson_ir *ir)
+{
+	/* Disable and reset the decoder while it is reconfigured */
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_ENABLE, 0);
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, REG1_RESET);
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, 0);
+
+	/* Set rate */
+	meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK, MESON_TRATE - 1);
+
+	if (ir->hw_decode) {
+		/* NEC hardware decoding, one IRQ per frame or repeat */
+		meson_ir_set_mode(ir, DECODE_MODE_NEC);
+
+		meson_ir_set_timing(ir, IR_DEC_LDR_ACTIVE, LDR_MAX_MASK,
+				    LDR_MIN_MASK, NEC_LDR_ACTIVE_US);
+		meson_ir_set_timing(ir, IR_DEC_LDR_IDLE, LDR_MAX_MASK,
+				    LDR_MIN_MASK, NEC_LDR_IDLE_US);
+		meson_ir_set_timing(ir, IR_DEC_LDR_REPEAT, BIT_MAX_MASK,
+				    BIT_MIN_MASK, NEC_LDR_REPEAT_US);
+		meson_ir_set_timing(ir, IR_DEC_BIT_0, BIT_MAX_MASK,
+				    BIT_MIN_MASK, NEC_BIT_0_US);
+		meson_ir_set_timing(ir, IR_DEC_STATUS, STATUS_BIT_1_MAX_MASK,
+				    STATUS_BIT_1_MIN_MASK, NEC_BIT_1_US);
+		meson_ir_set_mask(ir, IR_DEC_STATUS, STATUS_BIT_1_ENABLE,
+				  STATUS_BIT_1_ENABLE);
+
+		meson_ir_set_mask(ir, IR_DEC_REG0, REG0_FRAME_TIME_MAX_MASK,
+				  FIELD_PREP(REG0_FRAME_TIME_MAX_MASK,
+					     NEC_FRAME_TIME_MAX_US /
+					     MESON_TRATE));
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_FRAME_LEN_MASK,
+				  FIELD_PREP(REG1_FRAME_LEN_MASK,
+					     NEC_FRAME_BITS - 1));
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
+				  FIELD_PREP(REG1_IRQSEL_MASK,
+					     REG1_IRQSEL_NEC_MODE));
+	} else {
+		/* Set general operation mode (= raw/software decoding) */
+		meson_ir_set_mode(ir, DECODE_MODE_RAW);
+
+		/* IRQ on rising and falling edges */
+		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
+				  FIELD_PREP(REG1_IRQSEL_MASK,
+					     REG1_IRQSEL_RISE_FALL));
+	}
+
+	/* Enable the decoder */
+	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_ENABLE, REG1_ENABLE);
+}
+
+static int meson_ir_change_protocol(struct rc_dev *rc, u64 *rc_proto)
+{
+	struct meson_ir *ir = rc->priv;
+	unsigned long flags;
+	bool hw_decode;
+
+	/*
+	 * Only let the hardware decode if nothing but NEC is wanted, any
+	 * other protocol needs the raw edges for the software decoders.
+	 */
+	hw_decode = *rc_proto && !(*rc_proto & ~MESON_IR_HW_PROTOCOLS);
+
+	spin_lock_irqsave(&ir->lock, flags);
+	if (hw_decode != ir->hw_decode) {
+		ir->hw_decode = hw_decode;
+		meson_ir_config(ir);
+	}
+	spin_unlock_irqrestore(&ir->lock, flags);
+
+	return 0;
+}
+
+static void meson_ir_nec_irq(struct meson_ir *ir)
+{
+	enum rc_proto proto;
+	u32 status, frame, scancode;
+
+	status = readl_relaxed(ir->reg + IR_DEC_STATUS);
+	if (status & STATUS_FRAME_REPEAT) {
+		rc_repeat(ir->rc);
+		return;
+	}
+
+	/* the frame is received LSB first: address, ~address, cmd, ~cmd */
+	frame = readl_relaxed(ir->reg + IR_DEC_FRAME);
+	scancode = ir_nec_bytes_to_scancode(frame, frame >> 8, frame >> 16,
+					    frame >> 24, &proto);
+	rc_keydown(ir->rc, proto, scancode, 0);
+}
+
 static irqreturn_t meson_ir_irq(int irqno, void *dev_id)
 {
 	struct meson_ir *ir = dev_id;
@@ -84,6 +241,12 @@ static irqreturn_t meson_ir_irq(int irqno, void *dev_id)
 
 	spin_lock(&ir->lock);
 
+	if (ir->hw_decode) {
+		meson_ir_nec_irq(ir);
+		spin_unlock(&ir->lock);
+		return IRQ_HANDLED;
+	}
+
 	duration = readl_relaxed(ir->reg + IR_DEC_REG1);
 	duration = FIELD_GET(REG1_TIME_IV_MASK, duration);
 	rawir.duration = US_TO_NS(duration * MESON_TRATE);
@@ -105,7 +268,8 @@ static int meson_ir_probe(struct platform_device *pdev)
 	struct resource *res;
 	const char *map_name;
 	struct meson_ir *ir;
-	int irq, ret;
+	unsigned long flags;
+	int irq, ret, i;
 
 	ir = devm_kzalloc(dev, sizeof(struct meson_ir), GFP_KERNEL);
 	if (!ir)
@@ -138,8 +302,14 @@ static int meson_ir_probe(struct platform_device *pdev)
 	ir->rc->timeout = IR_DEFAULT_TIMEOUT;
 	ir->rc->max_timeout = 10 * IR_DEFAULT_TIMEOUT;
 	ir->rc->driver_name = DRIVER_NAME;
+	ir->rc->change_protocol = meson_ir_change_protocol;
 
+	ir->mode_in_reg1 = of_device_is_compatible(node, "amlogic,meson6-ir");
 	spin_lock_init(&ir->lock);
+
+	for (i = 0; i < ARRAY_SIZE(meson_ir_boot_fields); i++)
+		ir->boot_fields[i] = readl(ir->reg +
+					   meson_ir_boot_fields[i].reg);
 	platform_set_drvdata(pdev, ir);
 
 	ret = devm_rc_register_device(dev, ir->rc);
@@ -154,25 +324,9 @@ static int meson_ir_probe(struct platform_device *pdev)
 		return ret;
 	}
 
-	/* Reset the decoder */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, REG1_RESET);
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_RESET, 0);
-
-	/* Set general operation mode (= raw/software decoding) */
-	if (of_device_is_compatible(node, "amlogic,meson6-ir"))
-		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
-				  FIELD_PREP(REG1_MODE_MASK, DECODE_MODE_RAW));
-	else
-		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
-				  FIELD_PREP(REG2_MODE_MASK, DECODE_MODE_RAW));
-
-	/* Set rate */
-	meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK, MESON_TRATE - 1);
-	/* IRQ on rising and falling edges */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_IRQSEL_MASK,
-			  FIELD_PREP(REG1_IRQSEL_MASK, REG1_IRQSEL_RISE_FALL));
-	/* Enable the decoder */
-	meson_ir_set_mask(ir, IR_DEC_REG1, REG1_ENABLE, REG1_ENABLE);
+	spin_lock_irqsave(&ir->lock, flags);
+	meson_ir_config(ir);
+	spin_unlock_irqrestore(&ir->lock, flags);
 
 	dev_info(dev, "receiver initialized\n");
 
@@ -194,10 +348,9 @@ static int meson_ir_remove(struct platform_device *pdev)
 
 static void meson_ir_shutdown(struct platform_device *pdev)
 {
-	struct device *dev = &pdev->dev;
-	struct device_node *node = dev->of_node;
 	struct meson_ir *ir = platform_get_drvdata(pdev);
 	unsigned long flags;
+	int i;
 
 	spin_lock_irqsave(&ir->lock, flags);
 
@@ -205,12 +358,12 @@ static void meson_ir_shutdown(struct platform_device *pdev)
 	 * Set operation mode to NEC/hardware decoding to give
 	 * bootloader a chance to power the system back on
 	 */
-	if (of_device_is_compatible(node, "amlogic,meson6-ir"))
-		meson_ir_set_mask(ir, IR_DEC_REG1, REG1_MODE_MASK,
-				  DECODE_MODE_NEC << REG1_MODE_SHIFT);
-	else
-		meson_ir_set_mask(ir, IR_DEC_REG2, REG2_MODE_MASK,
-				  DECODE_MODE_NEC << REG2_MODE_SHIFT);
+	meson_ir_set_mode(ir, DECODE_MODE_NEC);
+
+	for (i = 0; i < ARRAY_SIZE(meson_ir_boot_fields); i++)
+		meson_ir_set_mask(ir, meson_ir_boot_fields[i].reg,
+				  meson_ir_boot_fields[i].mask,
+				  ir->boot_fields[i]);
 
 	/* Set rate to default value */
 	meson_ir_set_mask(ir, IR_DEC_REG0, REG0_RATE_MASK, 0x13);
@@ -237,6 +237,27 @@ void *v4l2_m2m_get_curr_priv(struct v4l2_m2m_dev *m2m_dev)
 }
 EXPORT_SYMBOL(v4l2_m2m_get_curr_priv);
 
+/*
+ * v4l2_m2m_fill_batch() - move the ready buffers of a context to its batch
+ */
+static void v4l2_m2m_fill_batch(struct v4l2_m2m_ctx *m2m_ctx)
+{
+	struct v4l2_m2m_batch *batch = &m2m_ctx->batch;
+	unsigned int max = clamp_t(unsigned int, m2m_ctx->max_batch, 1,
+				   V4L2_M2M_MAX_BATCH);
+	struct vb2_v4l2_buffer *vbuf;
+
+	batch->num_src = 0;
+	while (batch->num_src < max &&
+	       (vbuf = v4l2_m2m_src_buf_remove(m2m_ctx)))
+		batch->src[batch->num_src++] = vbuf;
+
+	batch->num_dst = 0;
+	while (batch->num_dst < max &&
+	       (vbuf = v4l2_m2m_dst_buf_remove(m2m_ctx)))
+		batch->dst[batch->num_dst++] = vbuf;
+}
+
 /**
  * v4l2_m2m_try_run() - select next job to perform and run it if possible
  * @m2m_dev: per-device context
@@ -269,7 +290,17 @@ static void v4l2_m2m_try_run(struct v4l2_m2m_dev *m2m_dev)
 	spin_unlock_irqrestore(&m2m_dev->job_spinlock, flags);
 
 	dprintk("Running job on m2m_ctx: %p\n", m2m_dev->curr_ctx);
-	m2m_dev->m2m_ops->device_run(m2m_dev->curr_ctx->priv);
+	if (m2m_dev->m2m_ops->device_run_batch) {
+		struct v4l2_m2m_ctx *m2m_ctx = m2m_dev->curr_ctx;
+
+		v4l2_m2m_fill_batch(m2m_ctx);
+		dprintk("Batch of %u src and %u dst buffers\n",
+			m2m_ctx->batch.num_src, m2m_ctx->batch.num_dst);
+		m2m_dev->m2m_ops->device_run_batch(m2m_ctx->priv,
+						   &m2m_ctx->batch);
+	} else {
+		m2m_dev->m2m_ops->device_run(m2m_dev->curr_ctx->priv);
+	}
 }
 
 /*
@@ -1107,7 +1138,8 @@ struct v4l2_m2m_dev *v4l2_m2m_init(const struct v4l2_m2m_ops *m2m_ops)
 {
 	struct v4l2_m2m_dev *m2m_dev;
 
-	if (!m2m_ops || WARN_ON(!m2m_ops->device_run))
+	if (!m2m_ops ||
+	    WARN_ON(!m2m_ops->device_run && !m2m_ops->device_run_batch))
 		return ERR_PTR(-EINVAL);
 
 	m2m_dev = kzalloc(sizeof *m2m_dev, GFP_KERNEL);
@@ -1144,6 +1176,7 @@ struct v4l2_m2m_ctx *v4l2_m2m_ctx_init(struct v4l2_m2m_dev *m2m_dev,
 
 	m2m_ctx->priv = drv_priv;
 	m2m_ctx->m2m_dev = m2m_dev;
+	m2m_ctx->max_batch = 1;
 	init_waitqueue_head(&m2m_ctx->finished);
 
 	out_q_ctx = &m2m_ctx->out_q_ctx;
@@ -1149,7 +1149,20 @@ static void mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 	struct mmc_card *card = md->queue.card;
 	int ret = 0;
 
+	/*
+	 * Nothing was written since the last flush, which covered everything
+	 * completed before it. This drops the back to back flushes that
+	 * journaling filesystems and fsync() heavy workloads tend to issue.
+	 */
+	if (!mq->use_cqe && !mq->cache_dirty) {
+		blk_mq_end_request(req, BLK_STS_OK);
+		return;
+	}
+
+	mq->cache_dirty = false;
 	ret = mmc_flush_cache(card);
+	if (ret)
+		mq->cache_dirty = true;
 	blk_mq_end_request(req, ret ? BLK_STS_IOERR : BLK_STS_OK);
 }
 
@@ -1974,6 +1987,42 @@ static void mmc_blk_mq_dec_in_flight(struct mmc_queue *mq, struct request *req)
 		mmc_put_card(mq->card, &mq->ctx);
 }
 
+/*
+ * Complete the requests of a packed write one by one. The card does report
+ * which entry failed, but a failed packed write is simply retried as
+ * individual writes instead.
+ */
+static void mmc_blk_packed_complete(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
+	struct mmc_data *data = &mqrq->brq.data;
+	struct request *prq, *tmp;
+	LIST_HEAD(list);
+	bool ok;
+
+	ok = data->bytes_xfered == data->blocks * data->blksz;
+	list_splice_init(&mqrq->packed_list, &list);
+
+	list_for_each_entry_safe(prq, tmp, &list, queuelist) {
+		struct mmc_queue_req *pmqrq = req_to_mmc_queue_req(prq);
+
+		list_del_init(&prq->queuelist);
+		if (ok) {
+			pmqrq->brq.data.bytes_xfered = blk_rq_bytes(prq);
+		} else {
+			pmqrq->brq.data.bytes_xfered = 0;
+			pmqrq->no_pack = true;
+		}
+
+		if (mq->in_recovery)
+			mmc_blk_mq_complete_rq(mq, prq);
+		else
+			blk_mq_complete_request(prq);
+
+		mmc_blk_mq_dec_in_flight(mq, prq);
+	}
+}
+
 static void mmc_blk_mq_post_req(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
@@ -1982,6 +2031,11 @@ static void mmc_blk_mq_post_req(struct mmc_queue *mq, struct request *req)
 
 	mmc_post_req(host, mrq, 0);
 
+	if (!list_empty(&mqrq->packed_list)) {
+		mmc_blk_packed_complete(mq, req);
+		return;
+	}
+
 	/*
 	 * Block layer timeouts race with completions which means the normal
 	 * completion path cannot be used during recovery.
@@ -2138,16 +2192,13 @@ static int mmc_blk_rw_wait(struct mmc_queue *mq, struct request **prev_req)
 	return err;
 }
 
-static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
-				  struct request *req)
+static int mmc_blk_mq_start_rw_rq(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	struct mmc_host *host = mq->card->host;
 	struct request *prev_req = NULL;
 	int err = 0;
 
-	mmc_blk_rw_rq_prep(mqrq, mq->card, 0, mq);
-
 	mqrq->brq.mrq.done = mmc_blk_mq_req_done;
 
 	mmc_pre_req(host, &mqrq->brq.mrq);
@@ -2177,6 +2228,326 @@ static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
 	return err;
 }
 
+/*
+ * Packed writes (eMMC 4.5) send several writes to unrelated addresses as a
+ * single CMD23/CMD25 transfer, preceded by a header block listing the
+ * address and length of each of them. This spares the small writes the
+ * per-command overhead and lets the card program them together.
+ *
+ * Writes are only gathered while another request is using the bus, so
+ * that a lone write is never delayed. The first one is held back by
+ * mmc_blk_packed_open(), the following ones join it from ->queue_rq()
+ * through mmc_blk_packed_add(), and mmc_blk_packed_work() issues them once
+ * the bus is free.
+ */
+struct mmc_packed {
+	struct mmc_queue	*mq;
+	struct list_head	list;		/* requests waiting to be issued */
+	unsigned int		nr_entries;
+	unsigned int		max_entries;
+	unsigned int		blocks;
+	unsigned int		nr_segs;
+	__le32			*hdr;
+	struct scatterlist	*sg;
+	struct work_struct	work;
+};
+
+#define MMC_PACKED_VERSION	0x01
+#define MMC_PACKED_WRITE	0x02
+#define MMC_PACKED_HDR_SIZE	512
+#define MMC_PACKED_MAX_ENTRIES	(MMC_PACKED_HDR_SIZE / 8 - 1)
+
+static bool mmc_blk_packable(struct mmc_queue *mq, struct request *req)
+{
+	/* Reliable writes and data tags are set per command */
+	return mq->packed && req_op(req) == REQ_OP_WRITE &&
+	       !(req->cmd_flags & (REQ_FUA | REQ_META)) &&
+	       !req_to_mmc_queue_req(req)->no_pack;
+}
+
+/* Must be called with mq->lock held */
+static bool mmc_blk_packed_fits(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_packed *packed = mq->packed;
+	struct mmc_host *host = mq->card->host;
+	unsigned int blocks = packed->blocks + blk_rq_sectors(req) + 1;
+
+	return packed->nr_entries < packed->max_entries &&
+	       blocks <= host->max_blk_count &&
+	       blocks << 9 <= host->max_req_size &&
+	       packed->nr_segs + req->nr_phys_segments + 1 <= host->max_segs;
+}
+
+static void __mmc_blk_packed_add(struct mmc_packed *packed,
+				 struct request *req)
+{
+	list_add_tail(&req->queuelist, &packed->list);
+	packed->nr_entries++;
+	packed->blocks += blk_rq_sectors(req);
+	packed->nr_segs += req->nr_phys_segments;
+}
+
+bool mmc_blk_packed_add(struct mmc_queue *mq, struct request *req)
+{
+	bool added = false;
+
+	if (!mmc_blk_packable(mq, req))
+		return false;
+
+	spin_lock_irq(&mq->lock);
+	if (mq->packed->nr_entries && !mq->recovery_needed &&
+	    mmc_blk_packed_fits(mq, req)) {
+		/* Start it before mmc_blk_packed_work() can complete it */
+		blk_mq_start_request(req);
+		__mmc_blk_packed_add(mq->packed, req);
+		mq->in_flight[MMC_ISSUE_ASYNC] += 1;
+		added = true;
+	}
+	spin_unlock_irq(&mq->lock);
+
+	return added;
+}
+
+static bool mmc_blk_packed_open(struct mmc_queue *mq, struct request *req)
+{
+	struct mmc_packed *packed = mq->packed;
+	bool opened = false;
+
+	if (!mmc_blk_packable(mq, req))
+		return false;
+
+	spin_lock_irq(&mq->lock);
+	if (mq->rw_wait && !packed->nr_entries && !mq->recovery_needed &&
+	    mmc_blk_packed_fits(mq, req)) {
+		__mmc_blk_packed_add(packed, req);
+		opened = true;
+	}
+	spin_unlock_irq(&mq->lock);
+
+	if (opened)
+		queue_work(mq->card->complete_wq, &packed->work);
+
+	return opened;
+}
+
+static void mmc_blk_packed_prep(struct mmc_queue *mq,
+				struct mmc_queue_req *mqrq,
+				unsigned int nr_entries, unsigned int blocks)
+{
+	struct mmc_packed *packed = mq->packed;
+	struct mmc_card *card = mq->card;
+	struct mmc_blk_request *brq = &mqrq->brq;
+	struct request *req = mmc_queue_req_to_req(mqrq);
+	struct scatterlist *sg = packed->sg;
+	__le32 *hdr = packed->hdr;
+	unsigned int sg_len = 1, i = 1;
+	struct request *prq;
+
+	memset(brq, 0, sizeof(struct mmc_blk_request));
+	memset(hdr, 0, MMC_PACKED_HDR_SIZE);
+
+	hdr[0] = cpu_to_le32((nr_entries << 16) | (MMC_PACKED_WRITE << 8) |
+			     MMC_PACKED_VERSION);
+
+	sg_init_table(sg, card->host->max_segs);
+	sg_set_buf(sg, hdr, MMC_PACKED_HDR_SIZE);
+
+	list_for_each_entry(prq, &mqrq->packed_list, queuelist) {
+		hdr[i * 2] = cpu_to_le32(blk_rq_sectors(prq));
+		hdr[i * 2 + 1] = cpu_to_le32(mmc_card_blockaddr(card) ?
+					     blk_rq_pos(prq) :
+					     blk_rq_pos(prq) << 9);
+		i++;
+
+		sg_unmark_end(&sg[sg_len - 1]);
+		sg_len += blk_rq_map_sg(mq->queue, prq, &sg[sg_len]);
+	}
+
+	brq->mrq.cmd = &brq->cmd;
+	brq->mrq.sbc = &brq->sbc;
+	brq->mrq.stop = &brq->stop;
+	brq->mrq.data = &brq->data;
+	brq->mrq.tag = req->tag;
+
+	brq->sbc.opcode = MMC_SET_BLOCK_COUNT;
+	brq->sbc.arg = MMC_CMD23_ARG_PACKED | (blocks + 1);
+	brq->sbc.flags = MMC_RSP_R1 | MMC_CMD_AC;
+
+	brq->cmd.opcode = MMC_WRITE_MULTIPLE_BLOCK;
+	brq->cmd.arg = blk_rq_pos(req);
+	if (!mmc_card_blockaddr(card))
+		brq->cmd.arg <<= 9;
+	brq->cmd.flags = MMC_RSP_SPI_R1 | MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	brq->stop.opcode = MMC_STOP_TRANSMISSION;
+	brq->stop.flags = MMC_RSP_SPI_R1B | MMC_RSP_R1B | MMC_CMD_AC;
+
+	brq->data.flags = MMC_DATA_WRITE;
+	brq->data.blksz = 512;
+	brq->data.blocks = blocks + 1;
+	brq->data.blk_addr = blk_rq_pos(req);
+	brq->data.sg = sg;
+	brq->data.sg_len = sg_len;
+	mmc_set_data_timeout(&brq->data, card);
+}
+
+static void mmc_blk_packed_abort(struct mmc_queue *mq, struct list_head *list,
+				 int err)
+{
+	struct request *prq, *tmp;
+
+	list_for_each_entry_safe(prq, tmp, list, queuelist) {
+		list_del_init(&prq->queuelist);
+		/* -EBUSY means recovery is pending, try again after it */
+		if (err == -EBUSY)
+			blk_mq_requeue_request(prq, true);
+		else
+			blk_mq_end_request(prq, BLK_STS_IOERR);
+		mmc_blk_mq_dec_in_flight(mq, prq);
+	}
+}
+
+static bool mmc_blk_packed_claim(struct mmc_queue *mq)
+{
+	bool claimed = false;
+
+	spin_lock_irq(&mq->lock);
+	if (!mq->busy) {
+		mq->busy = true;
+		claimed = true;
+	}
+	spin_unlock_irq(&mq->lock);
+
+	return claimed;
+}
+
+static void mmc_blk_packed_work(struct work_struct *work)
+{
+	struct mmc_packed *packed = container_of(work, struct mmc_packed, work);
+	struct mmc_queue *mq = packed->mq;
+	struct mmc_blk_data *md = mq->blkdata;
+	unsigned int nr_entries, blocks;
+	struct mmc_queue_req *mqrq;
+	struct request *req;
+	LIST_HEAD(list);
+	int err;
+
+	wait_event(mq->wait, mmc_blk_packed_claim(mq));
+
+	/* More writes keep joining until the bus is free */
+	err = mmc_blk_part_switch(mq->card, md->part_type);
+	if (!err)
+		err = mmc_blk_rw_wait(mq, NULL);
+
+	spin_lock_irq(&mq->lock);
+	list_splice_init(&packed->list, &list);
+	nr_entries = packed->nr_entries;
+	blocks = packed->blocks;
+	packed->nr_entries = 0;
+	packed->blocks = 0;
+	packed->nr_segs = 0;
+	spin_unlock_irq(&mq->lock);
+
+	if (list_empty(&list))
+		goto out;
+
+	if (err) {
+		mmc_blk_packed_abort(mq, &list, err);
+		goto out;
+	}
+
+	req = list_first_entry(&list, struct request, queuelist);
+	mqrq = req_to_mmc_queue_req(req);
+	if (nr_entries == 1) {
+		list_del_init(&req->queuelist);
+		mmc_blk_rw_rq_prep(mqrq, mq->card, 0, mq);
+	} else {
+		list_splice_init(&list, &mqrq->packed_list);
+		mmc_blk_packed_prep(mq, mqrq, nr_entries, blocks);
+	}
+
+	mq->cache_dirty = true;
+	err = mmc_blk_mq_start_rw_rq(mq, req);
+	if (err) {
+		if (nr_entries == 1)
+			list_add(&req->queuelist, &list);
+		else
+			list_splice_init(&mqrq->packed_list, &list);
+		mmc_blk_packed_abort(mq, &list, err);
+	}
+
+out:
+	spin_lock_irq(&mq->lock);
+	mq->busy = false;
+	spin_unlock_irq(&mq->lock);
+
+	blk_mq_run_hw_queues(mq->queue, true);
+}
+
+static void mmc_blk_packed_init(struct mmc_blk_data *md)
+{
+	struct mmc_card *card = md->queue.card;
+	struct mmc_host *host = card->host;
+	struct mmc_packed *packed;
+
+	if (!(host->caps2 & MMC_CAP2_PACKED_WR) || !mmc_card_mmc(card) ||
+	    card->ext_csd.max_packed_writes < 2 || md->queue.use_cqe ||
+	    !(md->flags & MMC_BLK_CMD23) || mmc_large_sector(card) ||
+	    card->quirks & MMC_QUIRK_BLK_NO_CMD23 || host->max_segs < 3)
+		return;
+
+	packed = kzalloc(sizeof(*packed), GFP_KERNEL);
+	if (!packed)
+		return;
+
+	packed->hdr = kzalloc(MMC_PACKED_HDR_SIZE, GFP_KERNEL);
+	packed->sg = kmalloc_array(host->max_segs, sizeof(*packed->sg),
+				   GFP_KERNEL);
+	if (!packed->hdr || !packed->sg) {
+		kfree(packed->sg);
+		kfree(packed->hdr);
+		kfree(packed);
+		return;
+	}
+
+	packed->mq = &md->queue;
+	packed->max_entries = min_t(unsigned int,
+				    card->ext_csd.max_packed_writes,
+				    MMC_PACKED_MAX_ENTRIES);
+	INIT_LIST_HEAD(&packed->list);
+	INIT_WORK(&packed->work, mmc_blk_packed_work);
+	md->queue.packed = packed;
+}
+
+static void mmc_blk_packed_exit(struct mmc_blk_data *md)
+{
+	struct mmc_packed *packed = md->queue.packed;
+
+	if (!packed)
+		return;
+
+	cancel_work_sync(&packed->work);
+	md->queue.packed = NULL;
+	kfree(packed->sg);
+	kfree(packed->hdr);
+	kfree(packed);
+}
+
+static int mmc_blk_mq_issue_rw_rq(struct mmc_queue *mq,
+				  struct request *req)
+{
+	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
+
+	if (mmc_blk_packed_open(mq, req))
+		return 0;
+
+	mmc_blk_rw_rq_prep(mqrq, mq->card, 0, mq);
+	if (rq_data_dir(req) == WRITE)
+		mq->cache_dirty = true;
+
+	return mmc_blk_mq_start_rw_rq(mq, req);
+}
+
 static int mmc_blk_wait_for_idle(struct mmc_queue *mq, struct mmc_host *host)
 {
 	if (mq->use_cqe)
@@ -2201,6 +2572,8 @@ enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req)
 		ret = mmc_blk_wait_for_idle(mq, host);
 		if (ret)
 			return MMC_REQ_BUSY;
+		if (req_op(req) != REQ_OP_FLUSH)
+			mq->cache_dirty = true;
 		switch (req_op(req)) {
 		case REQ_OP_DRV_IN:
 		case REQ_OP_DRV_OUT:
@@ -2365,6 +2738,8 @@ static struct mmc_blk_data *mmc_blk_alloc_req(struct mmc_card *card,
 		blk_queue_write_cache(md->queue.queue, true, true);
 	}
 
+	mmc_blk_packed_init(md);
+
 	return md;
 
  err_putdisk:
@@ -2640,6 +3015,7 @@ static void mmc_blk_remove_req(struct mmc_blk_data *md)
 			del_gendisk(md->disk);
 		}
 		mmc_cleanup_queue(&md->queue);
+		mmc_blk_packed_exit(md);
 		mmc_blk_put(md);
 	}
 }
@@ -235,6 +235,13 @@ void mmc_add_host_debugfs(struct mmc_host *host)
 	debugfs_create_file("clock", S_IRUSR | S_IWUSR, root, host,
 			    &mmc_clock_fops);
 
+	debugfs_create_u64("xfer_direct", S_IRUSR, root,
+			   &host->xfer_stats[MMC_XFER_DIRECT]);
+	debugfs_create_u64("xfer_partial_bounce", S_IRUSR, root,
+			   &host->xfer_stats[MMC_XFER_PARTIAL_BOUNCE]);
+	debugfs_create_u64("xfer_bounce", S_IRUSR, root,
+			   &host->xfer_stats[MMC_XFER_BOUNCE]);
+
 #ifdef CONFIG_FAIL_MMC_REQUEST
 	if (fail_request)
 		setup_fault_attr(&fail_default_attr, fail_request);
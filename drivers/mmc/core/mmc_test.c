@@ -104,6 +104,34 @@ struct mmc_test_transfer_result {
 	unsigned int iops;
 };
 
+/**
+ * struct mmc_test_sweep_result - results of one point of a sweep.
+ * @link: double-linked list
+ * @write: transfer direction
+ * @size: size of one transfer (in bytes)
+ * @sg_len: number of scatterlist entries of one transfer
+ * @offset: offset of the scatterlist entries into their pages
+ * @depth: number of requests that were kept in flight
+ * @count: number of transfers
+ * @ts: time values of the transfers
+ * @rate: calculated transfer rate
+ * @iops: I/O operations per second (times 100)
+ * @paths: number of transfers accounted to each host data path
+ */
+struct mmc_test_sweep_result {
+	struct list_head link;
+	bool write;
+	unsigned int size;
+	unsigned int sg_len;
+	unsigned int offset;
+	unsigned int depth;
+	unsigned int count;
+	struct timespec64 ts;
+	unsigned int rate;
+	unsigned int iops;
+	u64 paths[MMC_XFER_NR_PATHS];
+};
+
 /**
  * struct mmc_test_general_result - results for tests.
  * @link: double-linked list
@@ -111,6 +139,7 @@ struct mmc_test_transfer_result {
  * @testcase: number of test case
  * @result: result of test run
  * @tr_lst: transfer measurements if any as mmc_test_transfer_result
+ * @sweep_lst: sweep measurements if any as mmc_test_sweep_result
  */
 struct mmc_test_general_result {
 	struct list_head link;
@@ -118,6 +147,7 @@ struct mmc_test_general_result {
 	int testcase;
 	int result;
 	struct list_head tr_lst;
+	struct list_head sweep_lst;
 };
 
 /**
@@ -2334,6 +2364,197 @@ static int mmc_test_profile_sglen_r_nonblock_perf(struct mmc_test_card *test)
 	return mmc_test_rw_multiple_sg_len(test, &test_data);
 }
 
+/*
+ * Performance sweeps. Every combination of transfer size, number of
+ * scatterlist entries, entry alignment and request depth is timed
+ * separately, together with the data path the host driver accounted the
+ * transfers to, e.g. to tell in place DMA from bounce buffering. Points
+ * the host cannot do are skipped. The results can be read from the
+ * "sweep" file in debugfs, one comma separated line per point.
+ */
+static const unsigned int mmc_test_sweep_sizes[] = {
+	512, 4096, 64 * 1024, 512 * 1024,
+};
+
+static const unsigned int mmc_test_sweep_sg_lens[] = {
+	1, 4, 16, 64,
+};
+
+static const unsigned int mmc_test_sweep_offsets[] = {
+	0, 1, 4,
+};
+
+#define TEST_SWEEP_MAX_DEPTH	2
+#define TEST_SWEEP_BYTES	(8 * 1024 * 1024)
+
+static void mmc_test_get_xfer_stats(struct mmc_host *host, u64 *paths)
+{
+#ifdef CONFIG_DEBUG_FS
+	memcpy(paths, host->xfer_stats, sizeof(host->xfer_stats));
+#else
+	memset(paths, 0, sizeof(u64) * MMC_XFER_NR_PATHS);
+#endif
+}
+
+/*
+ * Map sz bytes as sg_len equally sized entries starting offset bytes into
+ * the pages of the test area memory.
+ */
+static int mmc_test_sweep_map(struct mmc_test_card *test, unsigned int sz,
+			      unsigned int sg_len, unsigned int offset,
+			      struct scatterlist *sglist)
+{
+	struct mmc_test_area *t = &test->area;
+	unsigned int seg_sz = sz / sg_len;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	if (sz > t->max_tfr || sg_len > t->max_segs || seg_sz < 512 ||
+	    seg_sz % 512 || seg_sz > t->max_seg_sz)
+		return -EINVAL;
+
+	sg_init_table(sglist, sg_len);
+	for_each_sg(sglist, sg, sg_len, i) {
+		struct mmc_test_pages *p = &t->mem->arr[i % t->mem->cnt];
+
+		if (offset + seg_sz > PAGE_SIZE << p->order)
+			return -EINVAL;
+		sg_set_page(sg, p->page, seg_sz, offset);
+	}
+
+	return 0;
+}
+
+static void mmc_test_save_sweep_result(struct mmc_test_card *test,
+				       struct mmc_test_sweep_result *res)
+{
+	struct mmc_test_sweep_result *sr;
+
+	if (!test->gr)
+		return;
+
+	sr = kmemdup(res, sizeof(*res), GFP_KERNEL);
+	if (!sr)
+		return;
+
+	list_add_tail(&sr->link, &test->gr->sweep_lst);
+}
+
+static int mmc_test_sweep_point(struct mmc_test_card *test, int write,
+				unsigned int sz, unsigned int sg_len,
+				unsigned int offset, unsigned int depth)
+{
+	struct mmc_test_area *t = &test->area;
+	struct mmc_host *host = test->card->host;
+	struct mmc_test_sweep_result res = {
+		.write = write,
+		.size = sz,
+		.sg_len = sg_len,
+		.offset = offset,
+		.depth = depth,
+	};
+	unsigned int dev_addr = t->dev_addr;
+	u64 paths[MMC_XFER_NR_PATHS];
+	struct timespec64 ts1, ts2;
+	int ret = 0;
+	int i;
+
+	if (mmc_test_sweep_map(test, sz, sg_len, offset, t->sg))
+		return 0;
+	if (depth > 1 &&
+	    mmc_test_sweep_map(test, sz, sg_len, offset, t->sg_areq))
+		return 0;
+
+	t->sg_len = sg_len;
+	t->blocks = sz >> 9;
+
+	res.count = clamp_t(unsigned int, TEST_SWEEP_BYTES / sz, 16, 1024);
+	res.count = min_t(unsigned long, res.count, t->max_sz / sz);
+
+	mmc_test_get_xfer_stats(host, paths);
+	ktime_get_ts64(&ts1);
+
+	if (depth > 1) {
+		ret = mmc_test_nonblock_transfer(test, dev_addr, write,
+						 res.count);
+	} else {
+		for (i = 0; i < res.count && ret == 0; i++) {
+			ret = mmc_test_area_transfer(test, dev_addr, write);
+			dev_addr += t->blocks;
+		}
+	}
+	if (ret)
+		return ret;
+
+	ktime_get_ts64(&ts2);
+	mmc_test_get_xfer_stats(host, res.paths);
+	for (i = 0; i < MMC_XFER_NR_PATHS; i++)
+		res.paths[i] -= paths[i];
+
+	res.ts = timespec64_sub(ts2, ts1);
+	res.rate = mmc_test_rate((u64)sz * res.count, &res.ts);
+	res.iops = mmc_test_rate(res.count * 100, &res.ts);
+
+	pr_info("%s: Sweep %s of %u x %u bytes, sg_len %u, offset %u, depth %u: "
+		"%u KiB/s, %u.%02u IOPS, paths %llu/%llu/%llu\n",
+		mmc_hostname(host), write ? "write" : "read", res.count, sz,
+		sg_len, offset, depth, res.rate / 1024, res.iops / 100,
+		res.iops % 100, res.paths[MMC_XFER_DIRECT],
+		res.paths[MMC_XFER_PARTIAL_BOUNCE],
+		res.paths[MMC_XFER_BOUNCE]);
+
+	mmc_test_save_sweep_result(test, &res);
+
+	return 0;
+}
+
+static int mmc_test_sweep_sg(struct mmc_test_card *test, int write,
+			     unsigned int sz, unsigned int sg_len)
+{
+	unsigned int off, depth;
+	int ret;
+
+	for (off = 0; off < ARRAY_SIZE(mmc_test_sweep_offsets); off++) {
+		for (depth = 1; depth <= TEST_SWEEP_MAX_DEPTH; depth++) {
+			ret = mmc_test_sweep_point(test, write, sz, sg_len,
+						   mmc_test_sweep_offsets[off],
+						   depth);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int mmc_test_sweep(struct mmc_test_card *test, int write)
+{
+	unsigned int sz, sg;
+	int ret;
+
+	for (sz = 0; sz < ARRAY_SIZE(mmc_test_sweep_sizes); sz++) {
+		for (sg = 0; sg < ARRAY_SIZE(mmc_test_sweep_sg_lens); sg++) {
+			ret = mmc_test_sweep_sg(test, write,
+						mmc_test_sweep_sizes[sz],
+						mmc_test_sweep_sg_lens[sg]);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int mmc_test_sweep_write_perf(struct mmc_test_card *test)
+{
+	return mmc_test_sweep(test, 1);
+}
+
+static int mmc_test_sweep_read_perf(struct mmc_test_card *test)
+{
+	return mmc_test_sweep(test, 0);
+}
+
 /*
  * eMMC hardware reset.
  */
@@ -2942,6 +3163,20 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.run = mmc_test_cmds_during_write_cmd23_nonblock,
 		.cleanup = mmc_test_area_cleanup,
 	},
+
+	{
+		.name = "Write performance sweep of size, sg_len, alignment and depth",
+		.prepare = mmc_test_area_prepare,
+		.run = mmc_test_sweep_write_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Read performance sweep of size, sg_len, alignment and depth",
+		.prepare = mmc_test_area_prepare_fill,
+		.run = mmc_test_sweep_read_perf,
+		.cleanup = mmc_test_area_cleanup,
+	},
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -2980,6 +3215,7 @@ static void mmc_test_run(struct mmc_test_card *test, int testcase)
 		gr = kzalloc(sizeof(*gr), GFP_KERNEL);
 		if (gr) {
 			INIT_LIST_HEAD(&gr->tr_lst);
+			INIT_LIST_HEAD(&gr->sweep_lst);
 
 			/* Assign data what we know already */
 			gr->card = test->card;
@@ -3046,6 +3282,7 @@ static void mmc_test_free_result(struct mmc_card *card)
 
 	list_for_each_entry_safe(gr, grs, &mmc_test_result, link) {
 		struct mmc_test_transfer_result *tr, *trs;
+		struct mmc_test_sweep_result *sr, *srs;
 
 		if (card && gr->card != card)
 			continue;
@@ -3055,6 +3292,11 @@ static void mmc_test_free_result(struct mmc_card *card)
 			kfree(tr);
 		}
 
+		list_for_each_entry_safe(sr, srs, &gr->sweep_lst, link) {
+			list_del(&sr->link);
+			kfree(sr);
+		}
+
 		list_del(&gr->link);
 		kfree(gr);
 	}
@@ -3171,6 +3413,42 @@ static int mtf_testlist_show(struct seq_file *sf, void *data)
 
 DEFINE_SHOW_ATTRIBUTE(mtf_testlist);
 
+static int mtf_sweep_show(struct seq_file *sf, void *data)
+{
+	struct mmc_card *card = (struct mmc_card *)sf->private;
+	struct mmc_test_general_result *gr;
+
+	mutex_lock(&mmc_test_lock);
+
+	seq_puts(sf, "test,dir,size,sg_len,offset,depth,count,time_ns,rate,iops,"
+		 "direct,partial_bounce,bounce\n");
+
+	list_for_each_entry(gr, &mmc_test_result, link) {
+		struct mmc_test_sweep_result *sr;
+
+		if (gr->card != card)
+			continue;
+
+		list_for_each_entry(sr, &gr->sweep_lst, link) {
+			seq_printf(sf, "%d,%s,%u,%u,%u,%u,%u,%llu,%u,%u.%02u,"
+				   "%llu,%llu,%llu\n",
+				   gr->testcase + 1, sr->write ? "write" : "read",
+				   sr->size, sr->sg_len, sr->offset, sr->depth,
+				   sr->count, timespec64_to_ns(&sr->ts),
+				   sr->rate, sr->iops / 100, sr->iops % 100,
+				   sr->paths[MMC_XFER_DIRECT],
+				   sr->paths[MMC_XFER_PARTIAL_BOUNCE],
+				   sr->paths[MMC_XFER_BOUNCE]);
+		}
+	}
+
+	mutex_unlock(&mmc_test_lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(mtf_sweep);
+
 static void mmc_test_free_dbgfs_file(struct mmc_card *card)
 {
 	struct mmc_test_dbgfs_file *df, *dfs;
@@ -3226,6 +3504,11 @@ static int mmc_test_register_dbgfs_file(struct mmc_card *card)
 	if (ret)
 		goto err;
 
+	ret = __mmc_test_register_dbgfs_file(card, "sweep", S_IRUGO,
+		&mtf_sweep_fops);
+	if (ret)
+		goto err;
+
 err:
 	mutex_unlock(&mmc_test_lock);
 
@@ -218,6 +218,8 @@ static int __mmc_init_request(struct mmc_queue *mq, struct request *req,
 	if (!mq_rq->sg)
 		return -ENOMEM;
 
+	INIT_LIST_HEAD(&mq_rq->packed_list);
+
 	return 0;
 }
 
@@ -263,6 +265,16 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	issue_type = mmc_issue_type(mq, req);
 
+	if (!(req->rq_flags & RQF_DONTPREP)) {
+		req_to_mmc_queue_req(req)->retries = 0;
+		req_to_mmc_queue_req(req)->no_pack = false;
+		req->rq_flags |= RQF_DONTPREP;
+	}
+
+	/* Writes can join a packed write waiting for the bus */
+	if (issue_type == MMC_ISSUE_ASYNC && mmc_blk_packed_add(mq, req))
+		return BLK_STS_OK;
+
 	spin_lock_irq(&mq->lock);
 
 	if (mq->recovery_needed || mq->busy) {
@@ -309,11 +321,6 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 
 	spin_unlock_irq(&mq->lock);
 
-	if (!(req->rq_flags & RQF_DONTPREP)) {
-		req_to_mmc_queue_req(req)->retries = 0;
-		req->rq_flags |= RQF_DONTPREP;
-	}
-
 	if (get_card)
 		mmc_get_card(card, &mq->ctx);
 
@@ -353,6 +360,10 @@ static blk_status_t mmc_mq_queue_rq(struct blk_mq_hw_ctx *hctx,
 		WRITE_ONCE(mq->busy, false);
 	}
 
+	/* A packed write may be waiting for the queue to be free */
+	if (mq->packed)
+		wake_up(&mq->wait);
+
 	return ret;
 }
 
@@ -364,6 +375,38 @@ static const struct blk_mq_ops mmc_mq_ops = {
 	.timeout	= mmc_mq_timed_out,
 };
 
+/*
+ * Let the host narrow the queue limits to the requests it can DMA in place,
+ * so that the block layer splits and bounces requests up front instead of
+ * the host falling back to copying them.
+ */
+static void mmc_queue_setup_dma_limits(struct mmc_queue *mq,
+				       struct mmc_host *host,
+				       unsigned block_size)
+{
+	struct mmc_dma_limits limits = {
+		.alignment		= queue_dma_alignment(mq->queue),
+		.seg_boundary_mask	= queue_segment_boundary(mq->queue),
+		.max_seg_size		= host->max_seg_size,
+		.max_segs		= mmc_get_max_segments(host),
+	};
+
+	if (host->ops->get_dma_limits)
+		host->ops->get_dma_limits(host, &limits);
+
+	blk_queue_max_segments(mq->queue, limits.max_segs);
+	blk_queue_dma_alignment(mq->queue, limits.alignment);
+	blk_queue_segment_boundary(mq->queue, limits.seg_boundary_mask);
+	/*
+	 * After blk_queue_can_use_dma_map_merging() was called with succeed,
+	 * since it calls blk_queue_virt_boundary(), the mmc should not call
+	 * both blk_queue_max_segment_size().
+	 */
+	if (!host->can_dma_map_merge)
+		blk_queue_max_segment_size(mq->queue,
+			round_down(limits.max_seg_size, block_size));
+}
+
 static void mmc_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 {
 	struct mmc_host *host = card->host;
@@ -382,20 +425,12 @@ static void mmc_setup_queue(struct mmc_queue *mq, struct mmc_card *card)
 		WARN(!blk_queue_can_use_dma_map_merging(mq->queue,
 							mmc_dev(host)),
 		     "merging was advertised but not possible");
-	blk_queue_max_segments(mq->queue, mmc_get_max_segments(host));
 
 	if (mmc_card_mmc(card))
 		block_size = card->ext_csd.data_sector_size;
 
 	blk_queue_logical_block_size(mq->queue, block_size);
-	/*
-	 * After blk_queue_can_use_dma_map_merging() was called with succeed,
-	 * since it calls blk_queue_virt_boundary(), the mmc should not call
-	 * both blk_queue_max_segment_size().
-	 */
-	if (!host->can_dma_map_merge)
-		blk_queue_max_segment_size(mq->queue,
-			round_down(host->max_seg_size, block_size));
+	mmc_queue_setup_dma_limits(mq, host, block_size);
 
 	dma_set_max_seg_size(mmc_dev(host), queue_max_segment_size(mq->queue));
 
@@ -429,6 +464,7 @@ int mmc_init_queue(struct mmc_queue *mq, struct mmc_card *card)
 
 	mq->card = card;
 	mq->use_cqe = host->cqe_enabled;
+	mq->cache_dirty = true;
 	
 	spin_lock_init(&mq->lock);
 
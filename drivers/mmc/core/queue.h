@@ -69,8 +69,12 @@ struct mmc_queue_req {
 	void			*drv_op_data;
 	unsigned int		ioc_count;
 	int			retries;
+	struct list_head	packed_list;	/* requests of a packed write */
+	bool			no_pack;	/* retry outside of packed writes */
 };
 
+struct mmc_packed;
+
 struct mmc_queue {
 	struct mmc_card		*card;
 	struct mmc_ctx		ctx;
@@ -88,12 +92,14 @@ struct mmc_queue {
 	bool			in_recovery;
 	bool			rw_wait;
 	bool			waiting;
+	bool			cache_dirty;	/* written since the last flush */
 	struct work_struct	recovery_work;
 	wait_queue_head_t	wait;
 	struct request		*recovery_req;
 	struct request		*complete_req;
 	struct mutex		complete_lock;
 	struct work_struct	complete_work;
+	struct mmc_packed	*packed;	/* NULL without packed writes */
 };
 
 extern int mmc_init_queue(struct mmc_queue *, struct mmc_card *);
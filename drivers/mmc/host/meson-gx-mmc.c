@@ -14,6 +14,7 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/ioport.h>
+#include <linux/slab.h>
 #include <linux/dma-mapping.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
@@ -61,6 +62,8 @@
 #define SD_EMMC_V3_ADJUST 0xc
 
 #define SD_EMMC_CALOUT 0x10
+#define SD_EMMC_V3_INTF3 0x38
+#define   INTF3_DS_SHT_M_MASK GENMASK(17, 12)
 #define SD_EMMC_START 0x40
 #define   START_DESC_INIT BIT(0)
 #define   START_DESC_BUSY BIT(1)
@@ -128,6 +131,7 @@
 
 #define SD_EMMC_PRE_REQ_DONE BIT(0)
 #define SD_EMMC_DESC_CHAIN_MODE BIT(1)
+#define SD_EMMC_DESC_BOUNCE BIT(2)
 
 #define MUX_CLK_NUM_PARENTS 2
 
@@ -136,6 +140,8 @@ struct meson_mmc_data {
 	unsigned int rx_delay_mask;
 	unsigned int always_on;
 	unsigned int adjust;
+	unsigned int intf3;
+	bool hs400;
 };
 
 struct sd_emmc_desc {
@@ -165,6 +171,7 @@ struct meson_host {
 
 	unsigned int bounce_buf_size;
 	void *bounce_buf;
+	void __iomem *bounce_iomem_buf;
 	dma_addr_t bounce_dma_addr;
 	struct sd_emmc_desc *descs;
 	dma_addr_t descs_dma_addr;
@@ -220,14 +227,19 @@ static struct mmc_command *meson_mmc_get_next_command(struct mmc_command *cmd)
 		return NULL;
 }
 
+static inline bool meson_mmc_sg_unaligned(const struct scatterlist *sg)
+{
+	return sg->offset & 7;
+}
+
 static void meson_mmc_get_transfer_mode(struct mmc_host *mmc,
 					struct mmc_request *mrq)
 {
 	struct meson_host *host = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
 	struct scatterlist *sg;
+	unsigned int bounce_len = 0;
 	int i;
-	bool use_desc_chain_mode = true;
 
 	/*
 	 * When Controller DMA cannot directly access DDR memory, disable
@@ -238,24 +250,32 @@ static void meson_mmc_get_transfer_mode(struct mmc_host *mmc,
 		return;
 
 	/*
-	 * Broken SDIO with AP6255-based WiFi on Khadas VIM Pro has been
-	 * reported. For some strange reason this occurs in descriptor
-	 * chain mode only. So let's fall back to bounce buffer mode
-	 * for command SD_IO_RW_EXTENDED.
+	 * In block mode the descriptor length is a block count, so a buffer
+	 * that is not a whole number of blocks cannot be chained. This is
+	 * what broke SDIO gloms with AP6255-based WiFi on Khadas VIM Pro,
+	 * such lists still go through the bounce buffer.
 	 */
-	if (mrq->cmd->opcode == SD_IO_RW_EXTENDED)
-		return;
+	if (data->blocks > 1) {
+		for_each_sg(data->sg, sg, data->sg_len, i)
+			if (sg->length % data->blksz)
+				return;
+	}
 
+	/*
+	 * The descriptors need 8 byte aligned buffers. Unaligned entries
+	 * get their own slot in the bounce buffer while the rest of the
+	 * list is still transferred in place, as long as all the slots fit.
+	 */
 	for_each_sg(data->sg, sg, data->sg_len, i)
-		/* check for 8 byte alignment */
-		if (sg->offset & 7) {
-			WARN_ONCE(1, "unaligned scatterlist buffer\n");
-			use_desc_chain_mode = false;
-			break;
-		}
+		if (meson_mmc_sg_unaligned(sg))
+			bounce_len += ALIGN(sg->length, 8);
 
-	if (use_desc_chain_mode)
-		data->host_cookie |= SD_EMMC_DESC_CHAIN_MODE;
+	if (bounce_len > host->bounce_buf_size)
+		return;
+
+	data->host_cookie |= SD_EMMC_DESC_CHAIN_MODE;
+	if (bounce_len)
+		data->host_cookie |= SD_EMMC_DESC_BOUNCE;
 }
 
 static inline bool meson_mmc_desc_chain_mode(const struct mmc_data *data)
@@ -263,12 +283,23 @@ static inline bool meson_mmc_desc_chain_mode(const struct mmc_data *data)
 	return data->host_cookie & SD_EMMC_DESC_CHAIN_MODE;
 }
 
+static inline bool meson_mmc_desc_bounce(const struct mmc_data *data)
+{
+	return data->host_cookie & SD_EMMC_DESC_BOUNCE;
+}
+
 static inline bool meson_mmc_bounce_buf_read(const struct mmc_data *data)
 {
 	return data && data->flags & MMC_DATA_READ &&
 	       !meson_mmc_desc_chain_mode(data);
 }
 
+static inline bool meson_mmc_desc_bounce_read(const struct mmc_data *data)
+{
+	return data && data->flags & MMC_DATA_READ &&
+	       meson_mmc_desc_bounce(data);
+}
+
 static void meson_mmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct mmc_data *data = mrq->data;
@@ -286,6 +317,18 @@ static void meson_mmc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
                                    mmc_get_dma_dir(data));
 	if (!data->sg_count)
 		dev_err(mmc_dev(mmc), "dma_map_sg failed");
+
+	/*
+	 * The bounce slots are matched to the scatterlist entries one by
+	 * one, which no longer holds if the mapping merged some of them.
+	 */
+	if (meson_mmc_desc_bounce(data) && data->sg_count != data->sg_len) {
+		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+			     mmc_get_dma_dir(data));
+		data->sg_count = 0;
+		data->host_cookie &= ~(SD_EMMC_DESC_CHAIN_MODE |
+				       SD_EMMC_DESC_BOUNCE);
+	}
 }
 
 static void meson_mmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
@@ -293,9 +336,11 @@ static void meson_mmc_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
 {
 	struct mmc_data *data = mrq->data;
 
-	if (data && meson_mmc_desc_chain_mode(data) && data->sg_count)
+	if (data && meson_mmc_desc_chain_mode(data) && data->sg_count) {
 		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
 			     mmc_get_dma_dir(data));
+		data->sg_count = 0;
+	}
 }
 
 /*
@@ -551,6 +596,7 @@ static int meson_mmc_prepare_ios_clock(struct meson_host *host,
 	switch (ios->timing) {
 	case MMC_TIMING_MMC_DDR52:
 	case MMC_TIMING_UHS_DDR50:
+	case MMC_TIMING_MMC_HS400:
 		ddr = true;
 		break;
 
@@ -565,6 +611,8 @@ static int meson_mmc_prepare_ios_clock(struct meson_host *host,
 static void meson_mmc_check_resampling(struct meson_host *host,
 				       struct mmc_ios *ios)
 {
+	unsigned int val;
+
 	switch (ios->timing) {
 	case MMC_TIMING_LEGACY:
 	case MMC_TIMING_MMC_HS:
@@ -573,6 +621,100 @@ static void meson_mmc_check_resampling(struct meson_host *host,
 		meson_mmc_disable_resampling(host);
 		break;
 	}
+
+	/*
+	 * In HS400, read data is latched on the data strobe driven by the
+	 * card while the command response still relies on the resampling
+	 * delay found while tuning in HS200. The switch to HS400 goes
+	 * through HS timing, which turned resampling off, so turn it back on.
+	 */
+	val = readl(host->regs + host->data->adjust);
+	if (ios->timing == MMC_TIMING_MMC_HS400)
+		val |= ADJUST_DS_EN | ADJUST_ADJ_EN;
+	else
+		val &= ~ADJUST_DS_EN;
+	writel(val, host->regs + host->data->adjust);
+}
+
+static int meson_mmc_send_ext_csd(struct mmc_host *mmc, void *buf)
+{
+	struct mmc_request mrq = {};
+	struct mmc_command cmd = {};
+	struct mmc_data data = {};
+	struct scatterlist sg;
+
+	cmd.opcode = MMC_SEND_EXT_CSD;
+	cmd.flags = MMC_RSP_R1 | MMC_CMD_ADTC;
+
+	data.blksz = 512;
+	data.blocks = 1;
+	data.flags = MMC_DATA_READ;
+	data.sg = &sg;
+	data.sg_len = 1;
+	data.timeout_ns = 100 * NSEC_PER_MSEC;
+	sg_init_one(&sg, buf, 512);
+
+	mrq.cmd = &cmd;
+	mrq.data = &data;
+	mmc_wait_for_req(mmc, &mrq);
+
+	return cmd.error ?: data.error;
+}
+
+static void meson_mmc_set_ds_delay(struct meson_host *host, unsigned int dly)
+{
+	unsigned int val = readl(host->regs + host->data->intf3);
+
+	val &= ~INTF3_DS_SHT_M_MASK;
+	val |= FIELD_PREP(INTF3_DS_SHT_M_MASK, dly);
+	writel(val, host->regs + host->data->intf3);
+}
+
+/*
+ * The tuning block cannot be requested in HS400, so the data strobe delay
+ * line is tuned by reading the EXT_CSD register at each delay and keeping
+ * the middle of the widest window of error free reads.
+ */
+static void meson_mmc_hs400_complete(struct mmc_host *mmc)
+{
+	struct meson_host *host = mmc_priv(mmc);
+	unsigned int max_dly = FIELD_MAX(INTF3_DS_SHT_M_MASK) + 1;
+	unsigned int dly, start = 0, len = 0, best_start = 0, best_len = 0;
+	void *buf;
+
+	buf = kmalloc(512, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (dly = 0; dly < max_dly; dly++) {
+		meson_mmc_set_ds_delay(host, dly);
+
+		if (meson_mmc_send_ext_csd(mmc, buf)) {
+			len = 0;
+			continue;
+		}
+
+		if (!len++)
+			start = dly;
+
+		if (len > best_len) {
+			best_start = start;
+			best_len = len;
+		}
+	}
+
+	kfree(buf);
+
+	if (!best_len) {
+		dev_warn(host->dev, "no working data strobe delay found\n");
+		meson_mmc_set_ds_delay(host, 0);
+		return;
+	}
+
+	dly = best_start + best_len / 2;
+	meson_mmc_set_ds_delay(host, dly);
+	dev_dbg(host->dev, "data strobe delay: %u (window %u-%u)\n", dly,
+		best_start, best_start + best_len - 1);
 }
 
 static void meson_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
@@ -637,6 +779,10 @@ static void meson_mmc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 	val = readl(host->regs + SD_EMMC_CFG);
 	val &= ~CFG_BUS_WIDTH_MASK;
 	val |= FIELD_PREP(CFG_BUS_WIDTH_MASK, bus_width);
+	if (ios->timing == MMC_TIMING_MMC_HS400)
+		val |= CFG_CHK_DS;
+	else
+		val &= ~CFG_CHK_DS;
 	writel(val, host->regs + SD_EMMC_CFG);
 
 	meson_mmc_check_resampling(host, ios);
@@ -698,15 +844,58 @@ static void meson_mmc_set_response_bits(struct mmc_command *cmd, u32 *cmd_cfg)
 	}
 }
 
-static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg)
+/*
+ * In descriptor chain mode, CMD23 is queued in front of the data
+ * descriptors so the controller issues SET_BLOCK_COUNT and the transfer
+ * back to back, without an interrupt and a trip through the irq thread
+ * in between. The controller only latches the response of the last
+ * command of the chain, so CMD23's own R1 is not reported; an error on
+ * it stops the chain and is reported on the data command instead.
+ */
+static bool meson_mmc_chain_sbc(struct mmc_command *cmd)
+{
+	struct mmc_data *data = cmd->mrq->data;
+
+	return cmd->opcode == MMC_SET_BLOCK_COUNT && data &&
+	       meson_mmc_desc_chain_mode(data);
+}
+
+static void meson_mmc_desc_chain_sbc(struct sd_emmc_desc *desc,
+				     struct mmc_command *sbc)
+{
+	u32 cmd_cfg = 0;
+
+	cmd_cfg |= FIELD_PREP(CMD_CFG_CMD_INDEX_MASK, sbc->opcode);
+	cmd_cfg |= CMD_CFG_OWNER;  /* owned by CPU */
+	cmd_cfg |= CMD_CFG_ERROR; /* stop in case of error */
+	cmd_cfg |= FIELD_PREP(CMD_CFG_TIMEOUT_MASK,
+			      ilog2(SD_EMMC_CMD_TIMEOUT));
+	meson_mmc_set_response_bits(sbc, &cmd_cfg);
+
+	desc->cmd_cfg = cmd_cfg;
+	desc->cmd_arg = sbc->arg;
+	desc->cmd_resp = 0;
+	desc->cmd_data = 0;
+
+	sbc->error = 0;
+}
+
+static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg,
+					  struct mmc_command *sbc)
 {
 	struct meson_host *host = mmc_priv(mmc);
 	struct sd_emmc_desc *desc = host->descs;
 	struct mmc_data *data = host->cmd->data;
+	unsigned int skip = 0, slot = 0;
 	struct scatterlist *sg;
 	u32 start;
 	int i;
 
+	if (sbc) {
+		meson_mmc_desc_chain_sbc(desc, sbc);
+		desc++;
+	}
+
 	if (data->flags & MMC_DATA_WRITE)
 		cmd_cfg |= CMD_CFG_DATA_WR;
 
@@ -728,6 +917,16 @@ static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg)
 		desc[i].cmd_arg = host->cmd->arg;
 		desc[i].cmd_resp = 0;
 		desc[i].cmd_data = sg_dma_address(sg);
+
+		if (meson_mmc_sg_unaligned(sg)) {
+			if (data->flags & MMC_DATA_WRITE)
+				sg_pcopy_to_buffer(data->sg, data->sg_len,
+						   host->bounce_buf + slot,
+						   sg->length, skip);
+			desc[i].cmd_data = host->bounce_dma_addr + slot;
+			slot += ALIGN(sg->length, 8);
+		}
+		skip += sg->length;
 	}
 	desc[data->sg_count - 1].cmd_cfg |= CMD_CFG_END_OF_CHAIN;
 
@@ -736,17 +935,72 @@ static void meson_mmc_desc_chain_transfer(struct mmc_host *mmc, u32 cmd_cfg)
 	writel(start, host->regs + SD_EMMC_START);
 }
 
+/*
+ * Copy between the scatterlist and the bounce buffer. With the
+ * dram_access_quirk the bounce buffer is the controller SRAM, which is
+ * mapped as device memory and must only be accessed through the io
+ * accessors, as memcpy() may issue unaligned or exclusive accesses.
+ */
+static void meson_mmc_copy_buffer(struct meson_host *host,
+				  struct mmc_data *data,
+				  size_t buflen, bool to_buffer)
+{
+	unsigned int sg_flags = SG_MITER_ATOMIC;
+	struct sg_mapping_iter miter;
+	unsigned int offset = 0;
+
+	if (to_buffer)
+		sg_flags |= SG_MITER_FROM_SG;
+	else
+		sg_flags |= SG_MITER_TO_SG;
+
+	sg_miter_start(&miter, data->sg, data->sg_len, sg_flags);
+
+	while (offset < buflen && sg_miter_next(&miter)) {
+		unsigned int len = min_t(size_t, miter.length,
+					 buflen - offset);
+
+		if (host->dram_access_quirk) {
+			if (to_buffer)
+				memcpy_toio(host->bounce_iomem_buf + offset,
+					    miter.addr, len);
+			else
+				memcpy_fromio(miter.addr,
+					      host->bounce_iomem_buf + offset,
+					      len);
+		} else {
+			if (to_buffer)
+				memcpy(host->bounce_buf + offset,
+				       miter.addr, len);
+			else
+				memcpy(miter.addr,
+				       host->bounce_buf + offset, len);
+		}
+
+		offset += len;
+	}
+
+	sg_miter_stop(&miter);
+}
+
 static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 {
 	struct meson_host *host = mmc_priv(mmc);
-	struct mmc_data *data = cmd->data;
+	struct mmc_command *sbc = NULL;
+	struct mmc_data *data;
 	u32 cmd_cfg = 0, cmd_data = 0;
 	unsigned int xfer_bytes = 0;
 
 	/* Setup descriptors */
 	dma_rmb();
 
+	if (meson_mmc_chain_sbc(cmd)) {
+		sbc = cmd;
+		cmd = cmd->mrq->cmd;
+	}
+
 	host->cmd = cmd;
+	data = cmd->data;
 
 	cmd_cfg |= FIELD_PREP(CMD_CFG_CMD_INDEX_MASK, cmd->opcode);
 	cmd_cfg |= CMD_CFG_OWNER;  /* owned by CPU */
@@ -762,7 +1016,11 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 				      ilog2(meson_mmc_get_timeout_msecs(data)));
 
 		if (meson_mmc_desc_chain_mode(data)) {
-			meson_mmc_desc_chain_transfer(mmc, cmd_cfg);
+			if (meson_mmc_desc_bounce(data))
+				mmc_count_xfer(mmc, MMC_XFER_PARTIAL_BOUNCE);
+			else
+				mmc_count_xfer(mmc, MMC_XFER_DIRECT);
+			meson_mmc_desc_chain_transfer(mmc, cmd_cfg, sbc);
 			return;
 		}
 
@@ -775,12 +1033,12 @@ static void meson_mmc_start_cmd(struct mmc_host *mmc, struct mmc_command *cmd)
 			cmd_cfg |= FIELD_PREP(CMD_CFG_LENGTH_MASK, data->blksz);
 		}
 
+		mmc_count_xfer(mmc, MMC_XFER_BOUNCE);
 		xfer_bytes = data->blksz * data->blocks;
 		if (data->flags & MMC_DATA_WRITE) {
 			cmd_cfg |= CMD_CFG_DATA_WR;
 			WARN_ON(xfer_bytes > host->bounce_buf_size);
-			sg_copy_to_buffer(data->sg, data->sg_len,
-					  host->bounce_buf, xfer_bytes);
+			meson_mmc_copy_buffer(host, data, xfer_bytes, true);
 			dma_wmb();
 		}
 
@@ -837,6 +1095,24 @@ static void meson_mmc_read_resp(struct mmc_host *mmc, struct mmc_command *cmd)
 	}
 }
 
+static void meson_mmc_desc_bounce_copy(struct meson_host *host,
+				       struct mmc_data *data)
+{
+	unsigned int skip = 0, slot = 0;
+	struct scatterlist *sg;
+	int i;
+
+	for_each_sg(data->sg, sg, data->sg_len, i) {
+		if (meson_mmc_sg_unaligned(sg)) {
+			sg_pcopy_from_buffer(data->sg, data->sg_len,
+					     host->bounce_buf + slot,
+					     sg->length, skip);
+			slot += ALIGN(sg->length, 8);
+		}
+		skip += sg->length;
+	}
+}
+
 static irqreturn_t meson_mmc_irq(int irq, void *dev_id)
 {
 	struct meson_host *host = dev_id;
@@ -890,6 +1166,7 @@ static irqreturn_t meson_mmc_irq(int irq, void *dev_id)
 		if (data && !cmd->error)
 			data->bytes_xfered = data->blksz * data->blocks;
 		if (meson_mmc_bounce_buf_read(data) ||
+		    meson_mmc_desc_bounce_read(data) ||
 		    meson_mmc_get_next_command(cmd))
 			ret = IRQ_WAKE_THREAD;
 		else
@@ -949,8 +1226,13 @@ static irqreturn_t meson_mmc_irq_thread(int irq, void *dev_id)
 	if (meson_mmc_bounce_buf_read(data)) {
 		xfer_bytes = data->blksz * data->blocks;
 		WARN_ON(xfer_bytes > host->bounce_buf_size);
-		sg_copy_from_buffer(data->sg, data->sg_len,
-				    host->bounce_buf, xfer_bytes);
+		meson_mmc_copy_buffer(host, data, xfer_bytes, false);
+	}
+
+	if (meson_mmc_desc_bounce_read(data)) {
+		/* Hand the buffers back to the CPU before filling them */
+		meson_mmc_post_req(host->mmc, cmd->mrq, 0);
+		meson_mmc_desc_bounce_copy(host, data);
 	}
 
 	next_cmd = meson_mmc_get_next_command(cmd);
@@ -1023,6 +1305,24 @@ static int meson_mmc_voltage_switch(struct mmc_host *mmc, struct mmc_ios *ios)
 	return -EINVAL;
 }
 
+/*
+ * Chain mode needs 8 byte aligned buffers and, for multi-block transfers,
+ * segments made of whole blocks, see meson_mmc_get_transfer_mode(). The
+ * latter is already guaranteed by the queue rounding max_seg_size down to
+ * the block size.
+ */
+static void meson_mmc_get_dma_limits(struct mmc_host *mmc,
+				     struct mmc_dma_limits *limits)
+{
+	struct meson_host *host = mmc_priv(mmc);
+
+	if (host->dram_access_quirk)
+		return;
+
+	limits->alignment = 7;
+	limits->seg_boundary_mask = DMA_BIT_MASK(32);
+}
+
 static const struct mmc_host_ops meson_mmc_ops = {
 	.request	= meson_mmc_request,
 	.set_ios	= meson_mmc_set_ios,
@@ -1030,8 +1330,10 @@ static const struct mmc_host_ops meson_mmc_ops = {
 	.pre_req	= meson_mmc_pre_req,
 	.post_req	= meson_mmc_post_req,
 	.execute_tuning = meson_mmc_resampling_tuning,
+	.hs400_complete	= meson_mmc_hs400_complete,
 	.card_busy	= meson_mmc_card_busy,
 	.start_signal_voltage_switch = meson_mmc_voltage_switch,
+	.get_dma_limits	= meson_mmc_get_dma_limits,
 };
 
 static int meson_mmc_probe(struct platform_device *pdev)
@@ -1143,25 +1445,30 @@ static int meson_mmc_probe(struct platform_device *pdev)
 
 	mmc->caps |= MMC_CAP_CMD23;
 	if (host->dram_access_quirk) {
-		/* Limit to the available sram memory */
-		//mmc->max_segs = SD_EMMC_SRAM_DATA_BUF_LEN / mmc->max_blk_size;
-		//mmc->max_blk_count = mmc->max_segs;
-		mmc->max_segs = 1;
-		mmc->max_blk_count = 2;
+		/*
+		 * Limit to the available sram memory. The scatterlist is
+		 * gathered into the SRAM by the CPU, so it may have as
+		 * many entries as there are blocks.
+		 */
+		mmc->max_blk_count = SD_EMMC_SRAM_DATA_BUF_LEN /
+				     mmc->max_blk_size;
+		mmc->max_segs = mmc->max_blk_count;
 	} else {
 		mmc->max_blk_count = CMD_CFG_LENGTH_MASK;
+		/* Keep one descriptor for the chained CMD23 */
 		mmc->max_segs = SD_EMMC_DESC_BUF_LEN /
-				sizeof(struct sd_emmc_desc);
+				sizeof(struct sd_emmc_desc) - 1;
+		mmc->caps2 |= MMC_CAP2_SG_BLOCK_ALIGN | MMC_CAP2_PACKED_WR;
 	}
 	mmc->max_req_size = mmc->max_blk_count * mmc->max_blk_size;
 	mmc->max_seg_size = mmc->max_req_size;
 
 	/*
-	 * At the moment, we don't know how to reliably enable HS400.
-	 * From the different datasheets, it is not even clear if this mode
-	 * is officially supported by any of the SoCs
+	 * HS400 needs the data strobe delay line, which is only known to
+	 * work on the SoCs flagged in their match data.
 	 */
-	mmc->caps2 &= ~MMC_CAP2_HS400;
+	if (!host->data->hs400)
+		mmc->caps2 &= ~MMC_CAP2_HS400;
 
 	if (host->dram_access_quirk) {
 		/*
@@ -1171,7 +1478,7 @@ static int meson_mmc_probe(struct platform_device *pdev)
 		 * instead of the DDR memory
 		 */
 		host->bounce_buf_size = SD_EMMC_SRAM_DATA_BUF_LEN;
-		host->bounce_buf = host->regs + SD_EMMC_SRAM_DATA_BUF_OFF;
+		host->bounce_iomem_buf = host->regs + SD_EMMC_SRAM_DATA_BUF_OFF;
 		host->bounce_dma_addr = res->start + SD_EMMC_SRAM_DATA_BUF_OFF;
 	} else {
 		/* data bounce buffer */
@@ -1196,7 +1503,6 @@ static int meson_mmc_probe(struct platform_device *pdev)
 
 	mmc->ops = &meson_mmc_ops;
 	mmc_add_host(mmc);
-
 	return 0;
 
 err_bounce_buf:
@@ -1252,12 +1558,22 @@ static const struct meson_mmc_data meson_axg_data = {
 	.adjust		= SD_EMMC_V3_ADJUST,
 };
 
+static const struct meson_mmc_data meson_g12a_data = {
+	.tx_delay_mask	= CLK_V3_TX_DELAY_MASK,
+	.rx_delay_mask	= CLK_V3_RX_DELAY_MASK,
+	.always_on	= CLK_V3_ALWAYS_ON,
+	.adjust		= SD_EMMC_V3_ADJUST,
+	.intf3		= SD_EMMC_V3_INTF3,
+	.hs400		= true,
+};
+
 static const struct of_device_id meson_mmc_of_match[] = {
 	{ .compatible = "amlogic,meson-gx-mmc",		.data = &meson_gx_data },
 	{ .compatible = "amlogic,meson-gxbb-mmc", 	.data = &meson_gx_data },
 	{ .compatible = "amlogic,meson-gxl-mmc",	.data = &meson_gx_data },
 	{ .compatible = "amlogic,meson-gxm-mmc",	.data = &meson_gx_data },
 	{ .compatible = "amlogic,meson-axg-mmc",	.data = &meson_axg_data },
+	{ .compatible = "amlogic,meson-g12a-mmc",	.data = &meson_g12a_data },
 	{}
 };
 MODULE_DEVICE_TABLE(of, meson_mmc_of_match);
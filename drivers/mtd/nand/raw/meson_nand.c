@@ -19,7 +19,6 @@
 #include <linux/iopoll.h>
 #include <linux/of.h>
 #include <linux/of_device.h>
-#include <linux/sched/task_stack.h>
 
 #define NFC_REG_CMD		0x00
 #define NFC_CMD_IDLE		(0xc << 14)
@@ -104,6 +103,9 @@
 
 #define PER_INFO_BYTE		8
 
+/* bounce buffer for the exec_op() data cycles */
+#define NFC_OP_BUF_LEN		512
+
 struct meson_nfc_nand_chip {
 	struct list_head node;
 	struct nand_chip nand;
@@ -117,6 +119,8 @@ struct meson_nfc_nand_chip {
 	u32 bch_mode;
 	u8 *data_buf;
 	__le64 *info_buf;
+	dma_addr_t data_dma;
+	dma_addr_t info_dma;
 	u32 nsels;
 	u8 sels[];
 };
@@ -170,8 +174,8 @@ struct meson_nfc {
 		struct nand_rw_cmd rw;
 	} cmdfifo;
 
-	dma_addr_t daddr;
-	dma_addr_t iaddr;
+	u8 *op_buf;
+	dma_addr_t op_dma;
 
 	unsigned long assigned_cs;
 };
@@ -187,6 +191,11 @@ enum {
 
 #define MESON_ECC_DATA(b, s)	{ .bch = (b),	.strength = (s)}
 
+static unsigned int poll_threshold_us = 50;
+module_param(poll_threshold_us, uint, 0644);
+MODULE_PARM_DESC(poll_threshold_us,
+		 "time to poll the command FIFO before sleeping on the R/B interrupt");
+
 static struct meson_nand_ecc meson_ecc[] = {
 	MESON_ECC_DATA(NFC_ECC_BCH8_1K, 8),
 	MESON_ECC_DATA(NFC_ECC_BCH24_1K, 24),
@@ -305,12 +314,54 @@ static void meson_nfc_drain_cmd(struct meson_nfc *nfc)
 	meson_nfc_cmd_idle(nfc, 0);
 }
 
+/*
+ * Queue a R/B command raising the R/B interrupt and sleep until it
+ * fires. As the commands are executed in order, this also tells when
+ * everything queued before it has been executed.
+ */
+static int meson_nfc_wait_rb_irq(struct meson_nfc *nfc, int timeout_ms)
+{
+	u32 cmd, cfg;
+
+	cfg = readl(nfc->reg_base + NFC_REG_CFG);
+	cfg |= NFC_RB_IRQ_EN;
+	writel(cfg, nfc->reg_base + NFC_REG_CFG);
+
+	reinit_completion(&nfc->completion);
+
+	/* use the max erase time as the maximum clock for waiting R/B */
+	cmd = NFC_CMD_RB | NFC_CMD_RB_INT
+		| nfc->param.chip_select | nfc->timing.tbers_max;
+	writel(cmd, nfc->reg_base + NFC_REG_CMD);
+
+	return wait_for_completion_timeout(&nfc->completion,
+					   msecs_to_jiffies(timeout_ms));
+}
+
 static int meson_nfc_wait_cmd_finish(struct meson_nfc *nfc,
 				     unsigned int timeout_ms)
 {
 	u32 cmd_size = 0;
 	int ret;
 
+	/* short waits, e.g. a few bytes of data cycles, are polled for */
+	cmd_size = readl_relaxed(nfc->reg_base + NFC_REG_CMD);
+	if (!NFC_CMD_GET_SIZE(cmd_size))
+		return 0;
+
+	if (poll_threshold_us) {
+		ret = readl_relaxed_poll_timeout(nfc->reg_base + NFC_REG_CMD,
+						 cmd_size,
+						 !NFC_CMD_GET_SIZE(cmd_size),
+						 10, poll_threshold_us);
+		if (!ret)
+			return 0;
+	}
+
+	/* the rest, like page DMAs, sleep until the FIFO got through */
+	if (!meson_nfc_wait_rb_irq(nfc, timeout_ms))
+		dev_warn(nfc->dev, "no R/B interrupt while draining CMD FIFO\n");
+
 	/* wait cmd fifo is empty */
 	ret = readl_relaxed_poll_timeout(nfc->reg_base + NFC_REG_CMD, cmd_size,
 					 !NFC_CMD_GET_SIZE(cmd_size),
@@ -389,26 +440,13 @@ static void meson_nfc_set_data_oob(struct nand_chip *nand,
 
 static int meson_nfc_queue_rb(struct meson_nfc *nfc, int timeout_ms)
 {
-	u32 cmd, cfg;
 	int ret = 0;
 
 	meson_nfc_cmd_idle(nfc, nfc->timing.twb);
 	meson_nfc_drain_cmd(nfc);
 	meson_nfc_wait_cmd_finish(nfc, CMD_FIFO_EMPTY_TIMEOUT);
 
-	cfg = readl(nfc->reg_base + NFC_REG_CFG);
-	cfg |= NFC_RB_IRQ_EN;
-	writel(cfg, nfc->reg_base + NFC_REG_CFG);
-
-	reinit_completion(&nfc->completion);
-
-	/* use the max erase time as the maximum clock for waiting R/B */
-	cmd = NFC_CMD_RB | NFC_CMD_RB_INT
-		| nfc->param.chip_select | nfc->timing.tbers_max;
-	writel(cmd, nfc->reg_base + NFC_REG_CMD);
-
-	ret = wait_for_completion_timeout(&nfc->completion,
-					  msecs_to_jiffies(timeout_ms));
+	ret = meson_nfc_wait_rb_irq(nfc, timeout_ms);
 	if (ret == 0)
 		ret = -1;
 
@@ -470,104 +508,112 @@ static int meson_nfc_ecc_correct(struct nand_chip *nand, u32 *bitflips,
 	return ret;
 }
 
-static int meson_nfc_dma_buffer_setup(struct nand_chip *nand, void *databuf,
-				      int datalen, void *infobuf, int infolen,
-				      enum dma_data_direction dir)
+static void meson_nfc_set_dma_addr(struct meson_nfc *nfc, dma_addr_t daddr,
+				   dma_addr_t iaddr)
 {
-	struct meson_nfc *nfc = nand_get_controller_data(nand);
 	u32 cmd;
-	int ret = 0;
 
-	nfc->daddr = dma_map_single(nfc->dev, databuf, datalen, dir);
-	ret = dma_mapping_error(nfc->dev, nfc->daddr);
-	if (ret) {
-		dev_err(nfc->dev, "DMA mapping error\n");
-		return ret;
-	}
-	cmd = GENCMDDADDRL(NFC_CMD_ADL, nfc->daddr);
+	cmd = GENCMDDADDRL(NFC_CMD_ADL, daddr);
 	writel(cmd, nfc->reg_base + NFC_REG_CMD);
 
-	cmd = GENCMDDADDRH(NFC_CMD_ADH, nfc->daddr);
+	cmd = GENCMDDADDRH(NFC_CMD_ADH, daddr);
 	writel(cmd, nfc->reg_base + NFC_REG_CMD);
 
-	if (infobuf) {
-		nfc->iaddr = dma_map_single(nfc->dev, infobuf, infolen, dir);
-		ret = dma_mapping_error(nfc->dev, nfc->iaddr);
-		if (ret) {
-			dev_err(nfc->dev, "DMA mapping error\n");
-			dma_unmap_single(nfc->dev,
-					 nfc->daddr, datalen, dir);
-			return ret;
-		}
-		cmd = GENCMDIADDRL(NFC_CMD_AIL, nfc->iaddr);
-		writel(cmd, nfc->reg_base + NFC_REG_CMD);
+	cmd = GENCMDIADDRL(NFC_CMD_AIL, iaddr);
+	writel(cmd, nfc->reg_base + NFC_REG_CMD);
 
-		cmd = GENCMDIADDRH(NFC_CMD_AIH, nfc->iaddr);
-		writel(cmd, nfc->reg_base + NFC_REG_CMD);
-	}
+	cmd = GENCMDIADDRH(NFC_CMD_AIH, iaddr);
+	writel(cmd, nfc->reg_base + NFC_REG_CMD);
+}
 
-	return ret;
+/*
+ * The page and info buffers stay mapped for the lifetime of the chip,
+ * only their ownership is handed over around each page access.
+ */
+static void meson_nfc_dma_buffer_setup(struct nand_chip *nand,
+				       int datalen, int infolen,
+				       enum dma_data_direction dir)
+{
+	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
+	struct meson_nfc *nfc = nand_get_controller_data(nand);
+
+	dma_sync_single_for_device(nfc->dev, meson_chip->data_dma,
+				   datalen, dir);
+	dma_sync_single_for_device(nfc->dev, meson_chip->info_dma,
+				   infolen, dir);
+
+	meson_nfc_set_dma_addr(nfc, meson_chip->data_dma,
+			       meson_chip->info_dma);
 }
 
 static void meson_nfc_dma_buffer_release(struct nand_chip *nand,
-					 int infolen, int datalen,
+					 int datalen, int infolen,
 					 enum dma_data_direction dir)
 {
+	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
 
-	dma_unmap_single(nfc->dev, nfc->daddr, datalen, dir);
-	if (infolen)
-		dma_unmap_single(nfc->dev, nfc->iaddr, infolen, dir);
+	dma_sync_single_for_cpu(nfc->dev, meson_chip->data_dma,
+				datalen, dir);
+	dma_sync_single_for_cpu(nfc->dev, meson_chip->info_dma,
+				infolen, dir);
 }
 
-static int meson_nfc_read_buf(struct nand_chip *nand, u8 *buf, int len)
+/*
+ * The exec_op() data cycles (ID, status, parameter pages...) are short
+ * and go through the controller's coherent op buffer instead of being
+ * mapped every time.
+ */
+static void meson_nfc_read_buf(struct nand_chip *nand, u8 *buf, int len)
 {
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
-	int ret = 0;
+	int chunk;
 	u32 cmd;
-	u8 *info;
-
-	info = kzalloc(PER_INFO_BYTE, GFP_KERNEL);
-	if (!info)
-		return -ENOMEM;
 
-	ret = meson_nfc_dma_buffer_setup(nand, buf, len, info,
-					 PER_INFO_BYTE, DMA_FROM_DEVICE);
-	if (ret)
-		goto out;
+	while (len) {
+		chunk = min(len, NFC_OP_BUF_LEN);
 
-	cmd = NFC_CMD_N2M | (len & GENMASK(5, 0));
-	writel(cmd, nfc->reg_base + NFC_REG_CMD);
+		meson_nfc_set_dma_addr(nfc, nfc->op_dma,
+				       nfc->op_dma + NFC_OP_BUF_LEN);
 
-	meson_nfc_drain_cmd(nfc);
-	meson_nfc_wait_cmd_finish(nfc, 1000);
-	meson_nfc_dma_buffer_release(nand, len, PER_INFO_BYTE, DMA_FROM_DEVICE);
+		cmd = NFC_CMD_N2M | (chunk & GENMASK(5, 0));
+		writel(cmd, nfc->reg_base + NFC_REG_CMD);
 
-out:
-	kfree(info);
+		meson_nfc_drain_cmd(nfc);
+		meson_nfc_wait_cmd_finish(nfc, 1000);
 
-	return ret;
+		memcpy(buf, nfc->op_buf, chunk);
+		buf += chunk;
+		len -= chunk;
+	}
 }
 
-static int meson_nfc_write_buf(struct nand_chip *nand, u8 *buf, int len)
+static void meson_nfc_write_buf(struct nand_chip *nand, const u8 *buf,
+				int len)
 {
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
-	int ret = 0;
+	int chunk;
 	u32 cmd;
 
-	ret = meson_nfc_dma_buffer_setup(nand, buf, len, NULL,
-					 0, DMA_TO_DEVICE);
-	if (ret)
-		return ret;
+	while (len) {
+		chunk = min(len, NFC_OP_BUF_LEN);
 
-	cmd = NFC_CMD_M2N | (len & GENMASK(5, 0));
-	writel(cmd, nfc->reg_base + NFC_REG_CMD);
+		memcpy(nfc->op_buf, buf, chunk);
+		/* ensure the data is written before kicking the dma */
+		wmb();
 
-	meson_nfc_drain_cmd(nfc);
-	meson_nfc_wait_cmd_finish(nfc, 1000);
-	meson_nfc_dma_buffer_release(nand, len, 0, DMA_TO_DEVICE);
+		meson_nfc_set_dma_addr(nfc, nfc->op_dma,
+				       nfc->op_dma + NFC_OP_BUF_LEN);
 
-	return ret;
+		cmd = NFC_CMD_M2N | (chunk & GENMASK(5, 0));
+		writel(cmd, nfc->reg_base + NFC_REG_CMD);
+
+		meson_nfc_drain_cmd(nfc);
+		meson_nfc_wait_cmd_finish(nfc, 1000);
+
+		buf += chunk;
+		len -= chunk;
+	}
 }
 
 static int meson_nfc_rw_cmd_prepare_and_execute(struct nand_chip *nand,
@@ -629,7 +675,6 @@ static int meson_nfc_write_page_sub(struct nand_chip *nand,
 	struct mtd_info *mtd = nand_to_mtd(nand);
 	const struct nand_sdr_timings *sdr =
 		nand_get_sdr_timings(&nand->data_interface);
-	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
 	int data_len, info_len;
 	u32 cmd;
@@ -644,11 +689,7 @@ static int meson_nfc_write_page_sub(struct nand_chip *nand,
 	if (ret)
 		return ret;
 
-	ret = meson_nfc_dma_buffer_setup(nand, meson_chip->data_buf,
-					 data_len, meson_chip->info_buf,
-					 info_len, DMA_TO_DEVICE);
-	if (ret)
-		return ret;
+	meson_nfc_dma_buffer_setup(nand, data_len, info_len, DMA_TO_DEVICE);
 
 	if (nand->options & NAND_NEED_SCRAMBLING) {
 		meson_nfc_cmd_seed(nfc, page);
@@ -702,12 +743,23 @@ static void meson_nfc_check_ecc_pages_valid(struct meson_nfc *nfc,
 
 	neccpages = raw ? 1 : nand->ecc.steps;
 	info = &meson_chip->info_buf[neccpages - 1];
-	do {
-		usleep_range(10, 15);
+
+	/*
+	 * The data DMA is already complete at this point and the info of
+	 * the last ECC page usually is as well, so only back off when it
+	 * isn't.
+	 */
+	for (;;) {
 		/* info is updated by nfc dma engine*/
-		smp_rmb();
+		dma_sync_single_for_cpu(nfc->dev, meson_chip->info_dma,
+					neccpages * PER_INFO_BYTE,
+					DMA_FROM_DEVICE);
 		ret = *info & ECC_COMPLETE;
-	} while (!ret);
+		if (ret)
+			break;
+
+		usleep_range(10, 15);
+	}
 }
 
 static int meson_nfc_read_page_sub(struct nand_chip *nand,
@@ -715,7 +767,6 @@ static int meson_nfc_read_page_sub(struct nand_chip *nand,
 {
 	struct mtd_info *mtd = nand_to_mtd(nand);
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
-	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
 	int data_len, info_len;
 	int ret;
 
@@ -728,11 +779,7 @@ static int meson_nfc_read_page_sub(struct nand_chip *nand,
 	if (ret)
 		return ret;
 
-	ret = meson_nfc_dma_buffer_setup(nand, meson_chip->data_buf,
-					 data_len, meson_chip->info_buf,
-					 info_len, DMA_FROM_DEVICE);
-	if (ret)
-		return ret;
+	meson_nfc_dma_buffer_setup(nand, data_len, info_len, DMA_FROM_DEVICE);
 
 	if (nand->options & NAND_NEED_SCRAMBLING) {
 		meson_nfc_cmd_seed(nfc, page);
@@ -830,72 +877,12 @@ static int meson_nfc_read_oob(struct nand_chip *nand, int page)
 	return meson_nfc_read_page_hwecc(nand, NULL, 1, page);
 }
 
-static bool meson_nfc_is_buffer_dma_safe(const void *buffer)
-{
-	if (virt_addr_valid(buffer) && (!object_is_on_stack(buffer)))
-		return true;
-	return false;
-}
-
-static void *
-meson_nand_op_get_dma_safe_input_buf(const struct nand_op_instr *instr)
-{
-	if (WARN_ON(instr->type != NAND_OP_DATA_IN_INSTR))
-		return NULL;
-
-	if (meson_nfc_is_buffer_dma_safe(instr->ctx.data.buf.in))
-		return instr->ctx.data.buf.in;
-
-	return kzalloc(instr->ctx.data.len, GFP_KERNEL);
-}
-
-static void
-meson_nand_op_put_dma_safe_input_buf(const struct nand_op_instr *instr,
-				     void *buf)
-{
-	if (WARN_ON(instr->type != NAND_OP_DATA_IN_INSTR) ||
-	    WARN_ON(!buf))
-		return;
-
-	if (buf == instr->ctx.data.buf.in)
-		return;
-
-	memcpy(instr->ctx.data.buf.in, buf, instr->ctx.data.len);
-	kfree(buf);
-}
-
-static void *
-meson_nand_op_get_dma_safe_output_buf(const struct nand_op_instr *instr)
-{
-	if (WARN_ON(instr->type != NAND_OP_DATA_OUT_INSTR))
-		return NULL;
-
-	if (meson_nfc_is_buffer_dma_safe(instr->ctx.data.buf.out))
-		return (void *)instr->ctx.data.buf.out;
-
-	return kmemdup(instr->ctx.data.buf.out,
-		       instr->ctx.data.len, GFP_KERNEL);
-}
-
-static void
-meson_nand_op_put_dma_safe_output_buf(const struct nand_op_instr *instr,
-				      const void *buf)
-{
-	if (WARN_ON(instr->type != NAND_OP_DATA_OUT_INSTR) ||
-	    WARN_ON(!buf))
-		return;
-
-	if (buf != instr->ctx.data.buf.out)
-		kfree(buf);
-}
-
 static int meson_nfc_exec_op(struct nand_chip *nand,
 			     const struct nand_operation *op, bool check_only)
 {
 	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
 	struct meson_nfc *nfc = nand_get_controller_data(nand);
 	const struct nand_op_instr *instr = NULL;
-	void *buf;
 	u32 op_id, delay_idle, cmd;
 	int i;
 
@@ -923,19 +910,13 @@ static int meson_nfc_exec_op(struct nand_chip *nand,
 			break;
 
 		case NAND_OP_DATA_IN_INSTR:
-			buf = meson_nand_op_get_dma_safe_input_buf(instr);
-			if (!buf)
-				return -ENOMEM;
-			meson_nfc_read_buf(nand, buf, instr->ctx.data.len);
-			meson_nand_op_put_dma_safe_input_buf(instr, buf);
+			meson_nfc_read_buf(nand, instr->ctx.data.buf.in,
+					   instr->ctx.data.len);
 			break;
 
 		case NAND_OP_DATA_OUT_INSTR:
-			buf = meson_nand_op_get_dma_safe_output_buf(instr);
-			if (!buf)
-				return -ENOMEM;
-			meson_nfc_write_buf(nand, buf, instr->ctx.data.len);
-			meson_nand_op_put_dma_safe_output_buf(instr, buf);
+			meson_nfc_write_buf(nand, instr->ctx.data.buf.out,
+					    instr->ctx.data.len);
 			break;
 
 		case NAND_OP_WAITRDY_INSTR:
@@ -1063,8 +1044,14 @@ static void meson_nfc_disable_clk(struct meson_nfc *nfc)
 
 static void meson_nfc_free_buffer(struct nand_chip *nand)
 {
+	struct mtd_info *mtd = nand_to_mtd(nand);
 	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
+	struct meson_nfc *nfc = nand_get_controller_data(nand);
 
+	dma_unmap_single(nfc->dev, meson_chip->info_dma,
+			 nand->ecc.steps * PER_INFO_BYTE, DMA_BIDIRECTIONAL);
+	dma_unmap_single(nfc->dev, meson_chip->data_dma,
+			 mtd->writesize + mtd->oobsize, DMA_BIDIRECTIONAL);
 	kfree(meson_chip->info_buf);
 	kfree(meson_chip->data_buf);
 }
@@ -1073,7 +1060,9 @@ static int meson_chip_buffer_init(struct nand_chip *nand)
 {
 	struct mtd_info *mtd = nand_to_mtd(nand);
 	struct meson_nfc_nand_chip *meson_chip = to_meson_nand(nand);
+	struct meson_nfc *nfc = nand_get_controller_data(nand);
 	u32 page_bytes, info_bytes, nsectors;
+	int ret;
 
 	nsectors = mtd->writesize / nand->ecc.size;
 
@@ -1086,11 +1075,32 @@ static int meson_chip_buffer_init(struct nand_chip *nand)
 
 	meson_chip->info_buf = kmalloc(info_bytes, GFP_KERNEL);
 	if (!meson_chip->info_buf) {
-		kfree(meson_chip->data_buf);
-		return -ENOMEM;
+		ret = -ENOMEM;
+		goto err_free_data;
 	}
 
+	meson_chip->data_dma = dma_map_single(nfc->dev, meson_chip->data_buf,
+					      page_bytes, DMA_BIDIRECTIONAL);
+	ret = dma_mapping_error(nfc->dev, meson_chip->data_dma);
+	if (ret)
+		goto err_free_info;
+
+	meson_chip->info_dma = dma_map_single(nfc->dev, meson_chip->info_buf,
+					      info_bytes, DMA_BIDIRECTIONAL);
+	ret = dma_mapping_error(nfc->dev, meson_chip->info_dma);
+	if (ret)
+		goto err_unmap_data;
+
 	return 0;
+
+err_unmap_data:
+	dma_unmap_single(nfc->dev, meson_chip->data_dma, page_bytes,
+			 DMA_BIDIRECTIONAL);
+err_free_info:
+	kfree(meson_chip->info_buf);
+err_free_data:
+	kfree(meson_chip->data_buf);
+	return ret;
 }
 
 static
@@ -1422,6 +1432,13 @@ static int meson_nfc_probe(struct platform_device *pdev)
 		goto err_clk;
 	}
 
+	nfc->op_buf = dmam_alloc_coherent(dev, NFC_OP_BUF_LEN + PER_INFO_BYTE,
+					  &nfc->op_dma, GFP_KERNEL);
+	if (!nfc->op_buf) {
+		ret = -ENOMEM;
+		goto err_clk;
+	}
+
 	platform_set_drvdata(pdev, nfc);
 
 	ret = meson_nfc_nand_chips_init(dev, nfc);
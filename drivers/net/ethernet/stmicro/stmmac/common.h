@@ -114,6 +114,11 @@ struct stmmac_extra_stats {
 	unsigned long irq_rx_path_in_lpi_mode_n;
 	unsigned long irq_rx_path_exit_lpi_mode_n;
 	unsigned long phy_eee_wakeup_error_n;
+	unsigned long tx_lpi_short_n;
+	unsigned long tx_lpi_residency_ms;
+	unsigned long tx_lpi_entry_delay_ms;
+	unsigned long tx_lpi_wake_latency_us;
+	unsigned long tx_lpi_wake_latency_max_us;
 	/* Extended RDES status */
 	unsigned long ip_hdr_err;
 	unsigned long ip_payload_err;
@@ -175,6 +180,10 @@ struct stmmac_extra_stats {
 	/* TSO */
 	unsigned long tx_tso_frames;
 	unsigned long tx_tso_nfrags;
+	/* RGMII delay calibration */
+	unsigned long rgmii_delay_step;
+	unsigned long rgmii_delay_window;
+	unsigned long rgmii_delay_calib_n;
 };
 
 /* Safety Feature statistics exposed by ethtool */
@@ -34,6 +34,7 @@
 
 #define PRG_ETH0_TXDLY_SHIFT		5
 #define PRG_ETH0_TXDLY_MASK		GENMASK(6, 5)
+#define PRG_ETH0_TXDLY_STEPS		4
 
 /* divider for the result of m250_sel */
 #define PRG_ETH0_CLK_M250_DIV_SHIFT	7
@@ -240,6 +241,21 @@ static int meson_axg_set_phy_mode(struct meson8b_dwmac *dwmac)
 	return 0;
 }
 
+static int meson8b_set_rgmii_delay(void *priv, unsigned int step)
+{
+	struct meson8b_dwmac *dwmac = priv;
+
+	if (step >= PRG_ETH0_TXDLY_STEPS)
+		return -EINVAL;
+
+	/* one step is a quarter of the 125MHz RGMII TX clock cycle (2ns) */
+	dwmac->tx_delay_ns = step << 1;
+	meson8b_dwmac_mask_bits(dwmac, PRG_ETH0, PRG_ETH0_TXDLY_MASK,
+				step << PRG_ETH0_TXDLY_SHIFT);
+
+	return 0;
+}
+
 static int meson8b_init_prg_eth(struct meson8b_dwmac *dwmac)
 {
 	int ret;
@@ -353,11 +369,21 @@ static int meson8b_dwmac_probe(struct platform_device *pdev)
 		goto err_remove_config_dt;
 	}
 
-	/* use 2ns as fallback since this value was previously hardcoded */
+	/* use 2ns as fallback since this value was previously hardcoded,
+	 * and calibrate it at link-up when the MAC generates the TX delay
+	 */
 	if (of_property_read_u32(pdev->dev.of_node, "amlogic,tx-delay-ns",
-				 &dwmac->tx_delay_ns))
+				 &dwmac->tx_delay_ns)) {
 		dwmac->tx_delay_ns = 2;
 
+		if (dwmac->phy_mode == PHY_INTERFACE_MODE_RGMII ||
+		    dwmac->phy_mode == PHY_INTERFACE_MODE_RGMII_RXID) {
+			plat_dat->set_rgmii_delay = meson8b_set_rgmii_delay;
+			plat_dat->rgmii_delay_steps = PRG_ETH0_TXDLY_STEPS;
+			plat_dat->rgmii_delay_default = dwmac->tx_delay_ns >> 1;
+		}
+	}
+
 	ret = meson8b_init_rgmii_tx_clk(dwmac);
 	if (ret)
 		goto err_remove_config_dt;
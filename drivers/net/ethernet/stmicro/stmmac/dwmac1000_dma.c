@@ -254,9 +254,9 @@ static void dwmac1000_get_hw_feature(void __iomem *ioaddr,
 	dma_cap->enh_desc = (hw_cap & DMA_HW_FEAT_ENHDESSEL) >> 24;
 }
 
-static void dwmac1000_rx_watchdog(void __iomem *ioaddr, u32 riwt,
-				  u32 number_chan)
+static void dwmac1000_rx_watchdog(void __iomem *ioaddr, u32 riwt, u32 chan)
 {
+	/* Single DMA channel, one watchdog */
 	writel(riwt, ioaddr + DMA_RX_WATCHDOG);
 }
 
@@ -13,6 +13,7 @@
 #define DRV_MODULE_VERSION	"Jan_2016"
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/if_vlan.h>
 #include <linux/stmmac.h>
 #include <linux/phylink.h>
@@ -22,6 +23,7 @@
 #include <linux/net_tstamp.h>
 #include <linux/reset.h>
 #include <net/page_pool.h>
+#include <net/xdp.h>
 
 struct stmmac_resources {
 	void __iomem *addr;
@@ -31,12 +33,19 @@ struct stmmac_resources {
 	int irq;
 };
 
+enum stmmac_txbuf_type {
+	STMMAC_TXBUF_T_SKB,
+	STMMAC_TXBUF_T_XDP_TX,
+	STMMAC_TXBUF_T_XDP_NDO,
+};
+
 struct stmmac_tx_info {
 	dma_addr_t buf;
 	bool map_as_page;
 	unsigned len;
 	bool last_segment;
 	bool is_jumbo;
+	enum stmmac_txbuf_type buf_type;
 };
 
 #define STMMAC_TBS_AVAIL	BIT(0)
@@ -53,6 +62,10 @@ struct stmmac_tx_queue {
 	struct dma_edesc *dma_entx;
 	struct dma_desc *dma_tx;
 	struct sk_buff **tx_skbuff;
+	struct xdp_frame **xdpf;
+	/* Per entry segment headers for the software TSO path */
+	char *tso_hdrs;
+	dma_addr_t tso_hdrs_dma;
 	struct stmmac_tx_info *tx_skbuff_dma;
 	unsigned int cur_tx;
 	unsigned int dirty_tx;
@@ -61,11 +74,16 @@ struct stmmac_tx_queue {
 	u32 mss;
 };
 
+/* Headroom and buffer size used when skbs are built around RX pages */
+#define STMMAC_RX_HEADROOM	NET_SKB_PAD
+#define STMMAC_RX_HALF_PAGE	(PAGE_SIZE / 2)
+
 struct stmmac_rx_buffer {
 	struct page *page;
 	struct page *sec_page;
 	dma_addr_t addr;
 	dma_addr_t sec_addr;
+	unsigned int page_offset;
 };
 
 struct stmmac_rx_queue {
@@ -87,6 +105,7 @@ struct stmmac_rx_queue {
 		unsigned int len;
 		unsigned int error;
 	} state;
+	struct xdp_rxq_info xdp_rxq;
 };
 
 struct stmmac_channel {
@@ -95,6 +114,15 @@ struct stmmac_channel {
 	struct stmmac_priv *priv_data;
 	spinlock_t lock;
 	u32 index;
+	/* Threaded NAPI */
+	struct task_struct *napi_thread;
+	unsigned long napi_pending;
+	/* RX adaptive moderation */
+	struct dim rx_dim;
+	u16 rx_dim_events;
+	u64 rx_dim_packets;
+	u64 rx_dim_bytes;
+	u32 rx_riwt;
 };
 
 struct stmmac_tc_entry {
@@ -144,6 +172,29 @@ struct stmmac_flow_entry {
 	int is_l4;
 };
 
+/* Loopback benchmark results, one entry per TX queue; latencies in ns */
+struct stmmac_bench_result {
+	u32 frame_size;
+	u32 sent;
+	u32 received;
+	u64 duration_ns;
+	u32 lat_min;
+	u32 lat_p50;
+	u32 lat_p90;
+	u32 lat_p99;
+	u32 lat_p999;
+	u32 lat_max;
+};
+
+struct stmmac_bench {
+	u32 frame_size;
+	u32 frames;
+	u32 depth;
+	u32 queue;
+	bool phy_lb;
+	struct stmmac_bench_result res[MTL_MAX_TX_QUEUES];
+};
+
 struct stmmac_priv {
 	/* Frequently used values are kept adjacent for cache effect */
 	u32 tx_coal_frames;
@@ -154,12 +205,15 @@ struct stmmac_priv {
 	int hwts_tx_en;
 	bool tx_path_in_lpi_mode;
 	bool tso;
+	bool sw_tso;
 	int sph;
 	u32 sarc_type;
 
 	unsigned int dma_buf_sz;
 	unsigned int rx_copybreak;
+	bool rx_build_skb;
 	u32 rx_riwt;
+	bool rx_dim_enabled;
 	int hwts_rx_en;
 
 	void __iomem *ioaddr;
@@ -203,6 +257,10 @@ struct stmmac_priv {
 	int eee_enabled;
 	int eee_active;
 	int tx_lpi_timer;
+	unsigned int eee_lpi_delay;
+	ktime_t eee_lpi_entry;
+	ktime_t eee_lpi_wake;
+	u64 eee_lpi_residency_us;
 	unsigned int mode;
 	unsigned int chain_mode;
 	int extend_desc;
@@ -222,6 +280,7 @@ struct stmmac_priv {
 
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *dbgfs_dir;
+	struct stmmac_bench bench;
 #endif
 
 	unsigned long state;
@@ -240,6 +299,9 @@ struct stmmac_priv {
 
 	/* Receive Side Scaling */
 	struct stmmac_rss rss;
+
+	/* XDP BPF Program */
+	struct bpf_prog *xdp_prog;
 };
 
 enum stmmac_state {
@@ -247,12 +309,31 @@ enum stmmac_state {
 	STMMAC_RESET_REQUESTED,
 	STMMAC_RESETING,
 	STMMAC_SERVICE_SCHED,
+	STMMAC_DELAY_CALIB_REQUESTED,
+	STMMAC_DELAY_CALIB_DONE,
 };
 
+static inline bool stmmac_xdp_is_enabled(struct stmmac_priv *priv)
+{
+	return !!priv->xdp_prog;
+}
+
+static inline unsigned int stmmac_rx_offset(struct stmmac_priv *priv)
+{
+	if (stmmac_xdp_is_enabled(priv))
+		return XDP_PACKET_HEADROOM;
+	if (priv->rx_build_skb)
+		return STMMAC_RX_HEADROOM;
+
+	return 0;
+}
+
 int stmmac_mdio_unregister(struct net_device *ndev);
 int stmmac_mdio_register(struct net_device *ndev);
 int stmmac_mdio_reset(struct mii_bus *mii);
 void stmmac_set_ethtool_ops(struct net_device *netdev);
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv);
+u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv);
 
 void stmmac_ptp_register(struct stmmac_priv *priv);
 void stmmac_ptp_unregister(struct stmmac_priv *priv);
@@ -270,6 +351,9 @@ void stmmac_selftest_run(struct net_device *dev,
 			 struct ethtool_test *etest, u64 *buf);
 void stmmac_selftest_get_strings(struct stmmac_priv *priv, u8 *data);
 int stmmac_selftest_get_count(struct stmmac_priv *priv);
+int stmmac_selftest_rgmii_delay(struct stmmac_priv *priv);
+int stmmac_selftest_bench(struct stmmac_priv *priv,
+			  struct stmmac_bench *bench);
 #else
 static inline void stmmac_selftest_run(struct net_device *dev,
 				       struct ethtool_test *etest, u64 *buf)
@@ -285,6 +369,15 @@ static inline int stmmac_selftest_get_count(struct stmmac_priv *priv)
 {
 	return -EOPNOTSUPP;
 }
+static inline int stmmac_selftest_rgmii_delay(struct stmmac_priv *priv)
+{
+	return -EOPNOTSUPP;
+}
+static inline int stmmac_selftest_bench(struct stmmac_priv *priv,
+					struct stmmac_bench *bench)
+{
+	return -EOPNOTSUPP;
+}
 #endif /* CONFIG_STMMAC_SELFTESTS */
 
 #endif /* __STMMAC_H__ */
@@ -100,6 +100,11 @@ static const struct stmmac_stats stmmac_gstrings_stats[] = {
 	STMMAC_STAT(irq_rx_path_in_lpi_mode_n),
 	STMMAC_STAT(irq_rx_path_exit_lpi_mode_n),
 	STMMAC_STAT(phy_eee_wakeup_error_n),
+	STMMAC_STAT(tx_lpi_short_n),
+	STMMAC_STAT(tx_lpi_residency_ms),
+	STMMAC_STAT(tx_lpi_entry_delay_ms),
+	STMMAC_STAT(tx_lpi_wake_latency_us),
+	STMMAC_STAT(tx_lpi_wake_latency_max_us),
 	/* Extended RDES status */
 	STMMAC_STAT(ip_hdr_err),
 	STMMAC_STAT(ip_payload_err),
@@ -158,6 +163,10 @@ static const struct stmmac_stats stmmac_gstrings_stats[] = {
 	/* TSO */
 	STMMAC_STAT(tx_tso_frames),
 	STMMAC_STAT(tx_tso_nfrags),
+	/* RGMII delay calibration */
+	STMMAC_STAT(rgmii_delay_step),
+	STMMAC_STAT(rgmii_delay_window),
+	STMMAC_STAT(rgmii_delay_calib_n),
 };
 #define STMMAC_STATS_LEN ARRAY_SIZE(stmmac_gstrings_stats)
 
@@ -683,7 +692,7 @@ static int stmmac_ethtool_op_set_eee(struct net_device *dev,
 	return 0;
 }
 
-static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -696,7 +705,7 @@ static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 	return (usec * (clk / 1000000)) / 256;
 }
 
-static u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv)
+u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -718,8 +727,15 @@ static int stmmac_get_coalesce(struct net_device *dev,
 	ec->tx_max_coalesced_frames = priv->tx_coal_frames;
 
 	if (priv->use_riwt) {
+		u32 riwt = priv->rx_riwt;
+
+		/* With adaptive moderation report what channel 0 runs with */
+		if (priv->rx_dim_enabled)
+			riwt = priv->channel[0].rx_riwt;
+
 		ec->rx_max_coalesced_frames = priv->rx_coal_frames;
-		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt, priv);
+		ec->rx_coalesce_usecs = stmmac_riwt2usec(riwt, priv);
+		ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
 	}
 
 	return 0;
@@ -731,6 +747,10 @@ static int stmmac_set_coalesce(struct net_device *dev,
 	struct stmmac_priv *priv = netdev_priv(dev);
 	u32 rx_cnt = priv->plat->rx_queues_to_use;
 	unsigned int rx_riwt;
+	u32 chan;
+
+	if (ec->use_adaptive_rx_coalesce && !priv->use_riwt)
+		return -EOPNOTSUPP;
 
 	if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
 		rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
@@ -739,7 +759,17 @@ static int stmmac_set_coalesce(struct net_device *dev,
 			return -EINVAL;
 
 		priv->rx_riwt = rx_riwt;
-		stmmac_rx_watchdog(priv, priv->ioaddr, priv->rx_riwt, rx_cnt);
+	}
+
+	priv->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
+
+	/* The adaptive algorithm owns the watchdogs while it is enabled */
+	if (priv->use_riwt && !priv->rx_dim_enabled) {
+		for (chan = 0; chan < rx_cnt; chan++) {
+			priv->channel[chan].rx_riwt = priv->rx_riwt;
+			stmmac_rx_watchdog(priv, priv->ioaddr, priv->rx_riwt,
+					   chan);
+		}
 	}
 
 	if ((ec->tx_coalesce_usecs == 0) &&
@@ -901,7 +931,8 @@ static int stmmac_set_tunable(struct net_device *dev,
 
 static const struct ethtool_ops stmmac_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.begin = stmmac_check_if_running,
 	.get_drvinfo = stmmac_ethtool_getdrvinfo,
 	.get_msglevel = stmmac_ethtool_getmsglevel,
@@ -17,6 +17,7 @@
 #include <linux/clk.h>
 #include <linux/kernel.h>
 #include <linux/interrupt.h>
+#include <linux/kthread.h>
 #include <linux/ip.h>
 #include <linux/tcp.h>
 #include <linux/skbuff.h>
@@ -37,7 +38,10 @@
 #include <linux/net_tstamp.h>
 #include <linux/phylink.h>
 #include <linux/udp.h>
+#include <linux/bpf_trace.h>
+#include <linux/filter.h>
 #include <net/pkt_cls.h>
+#include <net/tso.h>
 #include "stmmac_ptp.h"
 #include "stmmac.h"
 #include <linux/reset.h>
@@ -49,6 +53,11 @@
 #define	STMMAC_ALIGN(x)		ALIGN(ALIGN(x, SMP_CACHE_BYTES), 16)
 #define	TSO_MAX_BUFF_SIZE	(SZ_16K - 1)
 
+/* Software TSO: one header plus at least one data descriptor per segment */
+#define STMMAC_SW_TSO_MAX_SEGS	48
+#define STMMAC_SW_TSO_MAX_DESCS	(STMMAC_SW_TSO_MAX_SEGS * 2 + \
+				 MAX_SKB_FRAGS + 1)
+
 /* Module parameters */
 #define TX_TIMEO	5000
 static int watchdog = TX_TIMEO;
@@ -66,6 +75,14 @@ MODULE_PARM_DESC(phyaddr, "Physical device address");
 #define STMMAC_TX_THRESH	(DMA_TX_SIZE / 4)
 #define STMMAC_RX_THRESH	(DMA_RX_SIZE / 4)
 
+#define STMMAC_XDP_PASS		0
+#define STMMAC_XDP_CONSUMED	BIT(0)
+#define STMMAC_XDP_TX		BIT(1)
+#define STMMAC_XDP_REDIRECT	BIT(2)
+
+/* Frames must fit in a single RX buffer behind XDP_PACKET_HEADROOM */
+#define STMMAC_XDP_MAX_MTU	ETH_DATA_LEN
+
 static int flow_ctrl = FLOW_AUTO;
 module_param(flow_ctrl, int, 0644);
 MODULE_PARM_DESC(flow_ctrl, "Flow control ability [on/off]");
@@ -96,6 +113,11 @@ module_param(eee_timer, int, 0644);
 MODULE_PARM_DESC(eee_timer, "LPI tx expiration time in msec");
 #define STMMAC_LPI_T(x) (jiffies + msecs_to_jiffies(x))
 
+/* LPI periods shorter than this cost more in sleep/wake transitions than
+ * they save, so they make the driver wait longer before entering LPI again.
+ */
+#define STMMAC_LPI_BREAKEVEN_US	1000
+
 /* By default the driver will use the ring mode to manage tx and rx descriptors,
  * but allow user to force to use the chain instead of the ring
  */
@@ -103,6 +125,17 @@ static unsigned int chain_mode;
 module_param(chain_mode, int, 0444);
 MODULE_PARM_DESC(chain_mode, "To use chain instead of ring mode");
 
+/* NAPI normally runs in softirq on the CPU taking the interrupt. Threaded
+ * mode moves each channel's RX/TX polling to its own kthread, which can be
+ * placed on any CPU with sched_setaffinity().
+ */
+static bool napi_threaded;
+module_param(napi_threaded, bool, 0444);
+MODULE_PARM_DESC(napi_threaded, "Run NAPI polling in per channel kthreads");
+
+#define STMMAC_NAPI_RX		0
+#define STMMAC_NAPI_TX		1
+
 static irqreturn_t stmmac_interrupt(int irq, void *dev_id);
 
 #ifdef CONFIG_DEBUG_FS
@@ -202,6 +235,100 @@ static void stmmac_start_all_queues(struct stmmac_priv *priv)
 		netif_tx_start_queue(netdev_get_tx_queue(priv->dev, queue));
 }
 
+static void stmmac_napi_thread_poll(struct stmmac_channel *ch,
+				    struct napi_struct *napi, int bit)
+{
+	if (!test_and_clear_bit(bit, &ch->napi_pending))
+		return;
+
+	/* Budget exhausted: NAPI stays scheduled and is ours to poll again */
+	if (napi->poll(napi, napi->weight) >= napi->weight)
+		set_bit(bit, &ch->napi_pending);
+}
+
+static int stmmac_napi_thread(void *data)
+{
+	struct stmmac_channel *ch = data;
+
+	for (;;) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (kthread_should_stop())
+			break;
+		if (!READ_ONCE(ch->napi_pending)) {
+			schedule();
+			continue;
+		}
+		__set_current_state(TASK_RUNNING);
+
+		local_bh_disable();
+		stmmac_napi_thread_poll(ch, &ch->rx_napi, STMMAC_NAPI_RX);
+		stmmac_napi_thread_poll(ch, &ch->tx_napi, STMMAC_NAPI_TX);
+		local_bh_enable();
+
+		cond_resched();
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return 0;
+}
+
+/**
+ * stmmac_napi_threads_stop - stop the NAPI kthreads
+ * @priv: driver private structure
+ * Description: NAPI must have been disabled already, so that no poll is
+ * pending anymore.
+ */
+static void stmmac_napi_threads_stop(struct stmmac_priv *priv)
+{
+	u32 queue;
+
+	for (queue = 0; queue < STMMAC_CH_MAX; queue++) {
+		struct stmmac_channel *ch = &priv->channel[queue];
+
+		if (ch->napi_thread) {
+			kthread_stop(ch->napi_thread);
+			ch->napi_thread = NULL;
+		}
+	}
+}
+
+/**
+ * stmmac_napi_threads_start - start one NAPI kthread per channel
+ * @priv: driver private structure
+ */
+static int stmmac_napi_threads_start(struct stmmac_priv *priv)
+{
+	u32 rx_queues_cnt = priv->plat->rx_queues_to_use;
+	u32 tx_queues_cnt = priv->plat->tx_queues_to_use;
+	u32 maxq = max(rx_queues_cnt, tx_queues_cnt);
+	u32 queue;
+
+	for (queue = 0; queue < maxq; queue++) {
+		struct stmmac_channel *ch = &priv->channel[queue];
+		struct task_struct *thread;
+
+		ch->napi_pending = 0;
+		thread = kthread_run(stmmac_napi_thread, ch, "stmmac-%s-%u",
+				     priv->dev->name, queue);
+		if (IS_ERR(thread)) {
+			stmmac_napi_threads_stop(priv);
+			return PTR_ERR(thread);
+		}
+
+		ch->napi_thread = thread;
+	}
+
+	return 0;
+}
+
+static int stmmac_napi_weight(u32 budget)
+{
+	if (!budget || budget > NAPI_POLL_WEIGHT)
+		return NAPI_POLL_WEIGHT;
+
+	return budget;
+}
+
 static void stmmac_service_event_schedule(struct stmmac_priv *priv)
 {
 	if (!test_bit(STMMAC_DOWN, &priv->state) &&
@@ -345,6 +472,71 @@ static void stmmac_enable_eee_mode(struct stmmac_priv *priv)
 				priv->plat->en_tx_lpi_clockgating);
 }
 
+/**
+ * stmmac_eee_adapt_delay - tune the LPI entry delay on LPI exit
+ * @priv: driver private structure
+ * Description: LPI is entered as soon as the TX queues drain while the
+ * entry delay is zero. Each time the TX path is woken up after sleeping
+ * for less than the break-even time, or for less than the current delay,
+ * the delay is doubled (up to eee_timer) so that bursty traffic does not
+ * keep bouncing the link in and out of LPI. Long sleeps halve it again.
+ */
+static void stmmac_eee_adapt_delay(struct stmmac_priv *priv)
+{
+	unsigned int delay = priv->eee_lpi_delay;
+	ktime_t now = ktime_get();
+	u64 residency;
+
+	if (!priv->eee_lpi_entry)
+		return;
+
+	residency = ktime_us_delta(now, priv->eee_lpi_entry);
+	priv->eee_lpi_entry = 0;
+	priv->eee_lpi_wake = now;
+
+	priv->eee_lpi_residency_us += residency;
+	priv->xstats.tx_lpi_residency_ms =
+		div_u64(priv->eee_lpi_residency_us, USEC_PER_MSEC);
+
+	if (residency < max_t(u64, STMMAC_LPI_BREAKEVEN_US,
+			      (u64)delay * USEC_PER_MSEC)) {
+		priv->xstats.tx_lpi_short_n++;
+		delay = delay ? min(delay * 2, (unsigned int)eee_timer) : 1;
+	} else if (residency >= (u64)delay * 4 * USEC_PER_MSEC) {
+		delay /= 2;
+	}
+
+	priv->eee_lpi_delay = delay;
+	priv->xstats.tx_lpi_entry_delay_ms = delay;
+}
+
+/**
+ * stmmac_eee_lpi_irq - account for the TX path LPI transitions
+ * @priv: driver private structure
+ * @status: core interrupt status
+ */
+static void stmmac_eee_lpi_irq(struct stmmac_priv *priv, int status)
+{
+	if (status & CORE_IRQ_TX_PATH_IN_LPI_MODE) {
+		priv->tx_path_in_lpi_mode = true;
+		priv->eee_lpi_entry = ktime_get();
+	}
+
+	if (status & CORE_IRQ_TX_PATH_EXIT_LPI_MODE) {
+		priv->tx_path_in_lpi_mode = false;
+
+		if (priv->eee_lpi_wake) {
+			unsigned long lat;
+
+			lat = ktime_us_delta(ktime_get(), priv->eee_lpi_wake);
+			priv->eee_lpi_wake = 0;
+			priv->xstats.tx_lpi_wake_latency_us = lat;
+			if (lat > priv->xstats.tx_lpi_wake_latency_max_us)
+				priv->xstats.tx_lpi_wake_latency_max_us = lat;
+		}
+	}
+}
+
 /**
  * stmmac_disable_eee_mode - disable and exit from LPI mode
  * @priv: driver private structure
@@ -356,6 +548,8 @@ void stmmac_disable_eee_mode(struct stmmac_priv *priv)
 	stmmac_reset_eee_mode(priv, priv->hw);
 	del_timer_sync(&priv->eee_ctrl_timer);
 	priv->tx_path_in_lpi_mode = false;
+
+	stmmac_eee_adapt_delay(priv);
 }
 
 /**
@@ -410,6 +604,10 @@ bool stmmac_eee_init(struct stmmac_priv *priv)
 	}
 
 	if (priv->eee_active && !priv->eee_enabled) {
+		priv->eee_lpi_delay = 0;
+		priv->eee_lpi_entry = 0;
+		priv->eee_lpi_wake = 0;
+		priv->xstats.tx_lpi_entry_delay_ms = 0;
 		timer_setup(&priv->eee_ctrl_timer, stmmac_eee_ctrl_timer, 0);
 		mod_timer(&priv->eee_ctrl_timer, STMMAC_LPI_T(eee_timer));
 		stmmac_set_eee_timer(priv, priv->hw, STMMAC_DEFAULT_LIT_LS,
@@ -1012,6 +1210,16 @@ static void stmmac_mac_link_up(struct phylink_config *config,
 	if (priv->plat->fix_mac_speed)
 		priv->plat->fix_mac_speed(priv->plat->bsp_priv, speed);
 
+	/* Calibrate the RGMII delay once per open at the fastest speed,
+	 * which is the one with the tightest timing budget.
+	 */
+	if (priv->plat->set_rgmii_delay && speed == SPEED_1000 &&
+	    phy_interface_mode_is_rgmii(interface) &&
+	    !test_bit(STMMAC_DELAY_CALIB_DONE, &priv->state)) {
+		set_bit(STMMAC_DELAY_CALIB_REQUESTED, &priv->state);
+		stmmac_service_event_schedule(priv);
+	}
+
 	if (!duplex)
 		ctrl &= ~priv->hw->link.duplex;
 	else
@@ -1179,6 +1387,25 @@ static void stmmac_display_rings(struct stmmac_priv *priv)
 	stmmac_display_tx_rings(priv);
 }
 
+/**
+ * stmmac_rx_build_skb_capable - check if skbs can be built around RX pages
+ * @priv: driver private structure
+ * Description: a frame, the headroom and the skb_shared_info all have to
+ * fit in half a page, so that both halves of an RX page can be used in turn.
+ */
+static bool stmmac_rx_build_skb_capable(struct stmmac_priv *priv)
+{
+	unsigned int size;
+
+	if (PAGE_SIZE >= 8192 || priv->sph || stmmac_xdp_is_enabled(priv))
+		return false;
+
+	size = SKB_DATA_ALIGN(STMMAC_RX_HEADROOM + priv->dma_buf_sz) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	return size <= STMMAC_RX_HALF_PAGE;
+}
+
 static int stmmac_set_bfsize(int mtu, int bufsize)
 {
 	int ret = bufsize;
@@ -1291,6 +1518,7 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
 	buf->page = page_pool_dev_alloc_pages(rx_q->page_pool);
 	if (!buf->page)
 		return -ENOMEM;
+	buf->page_offset = 0;
 
 	if (priv->sph) {
 		buf->sec_page = page_pool_dev_alloc_pages(rx_q->page_pool);
@@ -1303,7 +1531,7 @@ static int stmmac_init_rx_buffers(struct stmmac_priv *priv, struct dma_desc *p,
 		buf->sec_page = NULL;
 	}
 
-	buf->addr = page_pool_get_dma_addr(buf->page);
+	buf->addr = page_pool_get_dma_addr(buf->page) + stmmac_rx_offset(priv);
 	stmmac_set_desc_addr(priv, p, buf->addr);
 	if (priv->dma_buf_sz == BUF_SIZE_16KiB)
 		stmmac_init_desc3(priv, p);
@@ -1341,7 +1569,8 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv, u32 queue, int i)
 {
 	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
 
-	if (tx_q->tx_skbuff_dma[i].buf) {
+	if (tx_q->tx_skbuff_dma[i].buf &&
+	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_XDP_TX) {
 		if (tx_q->tx_skbuff_dma[i].map_as_page)
 			dma_unmap_page(priv->device,
 				       tx_q->tx_skbuff_dma[i].buf,
@@ -1354,12 +1583,20 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv, u32 queue, int i)
 					 DMA_TO_DEVICE);
 	}
 
+	if (tx_q->xdpf[i]) {
+		xdp_return_frame(tx_q->xdpf[i]);
+		tx_q->xdpf[i] = NULL;
+		tx_q->tx_skbuff_dma[i].buf = 0;
+	}
+
 	if (tx_q->tx_skbuff[i]) {
 		dev_kfree_skb_any(tx_q->tx_skbuff[i]);
 		tx_q->tx_skbuff[i] = NULL;
 		tx_q->tx_skbuff_dma[i].buf = 0;
 		tx_q->tx_skbuff_dma[i].map_as_page = false;
 	}
+
+	tx_q->tx_skbuff_dma[i].buf_type = STMMAC_TXBUF_T_SKB;
 }
 
 /**
@@ -1575,6 +1812,8 @@ static void free_dma_rx_desc_resources(struct stmmac_priv *priv)
 					  rx_q->dma_erx, rx_q->dma_rx_phy);
 
 		kfree(rx_q->buf_pool);
+		if (xdp_rxq_info_is_reg(&rx_q->xdp_rxq))
+			xdp_rxq_info_unreg(&rx_q->xdp_rxq);
 		if (rx_q->page_pool)
 			page_pool_destroy(rx_q->page_pool);
 	}
@@ -1613,8 +1852,15 @@ static void free_dma_tx_desc_resources(struct stmmac_priv *priv)
 
 		dma_free_coherent(priv->device, size, addr, tx_q->dma_tx_phy);
 
+		if (tx_q->tso_hdrs)
+			dma_free_coherent(priv->device,
+					  DMA_TX_SIZE * TSO_HEADER_SIZE,
+					  tx_q->tso_hdrs, tx_q->tso_hdrs_dma);
+		tx_q->tso_hdrs = NULL;
+
 		kfree(tx_q->tx_skbuff_dma);
 		kfree(tx_q->tx_skbuff);
+		kfree(tx_q->xdpf);
 	}
 }
 
@@ -1643,11 +1889,14 @@ static int alloc_dma_rx_desc_resources(struct stmmac_priv *priv)
 
 		pp_params.flags = PP_FLAG_DMA_MAP;
 		pp_params.pool_size = DMA_RX_SIZE;
-		num_pages = DIV_ROUND_UP(priv->dma_buf_sz, PAGE_SIZE);
+		num_pages = DIV_ROUND_UP(priv->dma_buf_sz + stmmac_rx_offset(priv),
+					 PAGE_SIZE);
 		pp_params.order = ilog2(num_pages);
 		pp_params.nid = dev_to_node(priv->device);
 		pp_params.dev = priv->device;
-		pp_params.dma_dir = DMA_FROM_DEVICE;
+		/* XDP_TX sends the frame straight from the RX page */
+		pp_params.dma_dir = stmmac_xdp_is_enabled(priv) ?
+				    DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
 
 		rx_q->page_pool = page_pool_create(&pp_params);
 		if (IS_ERR(rx_q->page_pool)) {
@@ -1677,6 +1926,22 @@ static int alloc_dma_rx_desc_resources(struct stmmac_priv *priv)
 			if (!rx_q->dma_rx)
 				goto err_dma;
 		}
+
+		ret = xdp_rxq_info_reg(&rx_q->xdp_rxq, priv->dev, queue);
+		if (ret < 0)
+			goto err_dma;
+		rx_q->xdp_rxq.napi_id = priv->channel[queue].rx_napi.napi_id;
+
+		ret = xdp_rxq_info_reg_mem_model(&rx_q->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 rx_q->page_pool);
+		if (ret) {
+			netdev_err(priv->dev,
+				   "Failed to register XDP memory model\n");
+			goto err_dma;
+		}
+
+		ret = -ENOMEM;
 	}
 
 	return 0;
@@ -1722,6 +1987,11 @@ static int alloc_dma_tx_desc_resources(struct stmmac_priv *priv)
 		if (!tx_q->tx_skbuff)
 			goto err_dma;
 
+		tx_q->xdpf = kcalloc(DMA_TX_SIZE, sizeof(struct xdp_frame *),
+				     GFP_KERNEL);
+		if (!tx_q->xdpf)
+			goto err_dma;
+
 		if (priv->extend_desc)
 			size = sizeof(struct dma_extended_desc);
 		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
@@ -1742,6 +2012,15 @@ static int alloc_dma_tx_desc_resources(struct stmmac_priv *priv)
 			tx_q->dma_entx = addr;
 		else
 			tx_q->dma_tx = addr;
+
+		if (priv->sw_tso) {
+			tx_q->tso_hdrs = dma_alloc_coherent(priv->device,
+						DMA_TX_SIZE * TSO_HEADER_SIZE,
+						&tx_q->tso_hdrs_dma,
+						GFP_KERNEL);
+			if (!tx_q->tso_hdrs)
+				goto err_dma;
+		}
 	}
 
 	return 0;
@@ -1778,11 +2057,13 @@ static int alloc_dma_desc_resources(struct stmmac_priv *priv)
  */
 static void free_dma_desc_resources(struct stmmac_priv *priv)
 {
+	/* Release the DMA TX socket buffers first, pending XDP_TX frames
+	 * still hold pages of the RX page pools.
+	 */
+	free_dma_tx_desc_resources(priv);
+
 	/* Release the DMA RX socket buffers */
 	free_dma_rx_desc_resources(priv);
-
-	/* Release the DMA TX socket buffers */
-	free_dma_tx_desc_resources(priv);
 }
 
 /**
@@ -2009,7 +2290,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 			stmmac_get_tx_hwtstamp(priv, p, skb);
 		}
 
-		if (likely(tx_q->tx_skbuff_dma[entry].buf)) {
+		if (likely(tx_q->tx_skbuff_dma[entry].buf &&
+			   tx_q->tx_skbuff_dma[entry].buf_type !=
+			   STMMAC_TXBUF_T_XDP_TX)) {
 			if (tx_q->tx_skbuff_dma[entry].map_as_page)
 				dma_unmap_page(priv->device,
 					       tx_q->tx_skbuff_dma[entry].buf,
@@ -2037,6 +2320,15 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 			tx_q->tx_skbuff[entry] = NULL;
 		}
 
+		if (tx_q->xdpf[entry]) {
+			xdp_return_frame(tx_q->xdpf[entry]);
+			tx_q->xdpf[entry] = NULL;
+			tx_q->tx_skbuff_dma[entry].buf = 0;
+			tx_q->tx_skbuff_dma[entry].len = 0;
+		}
+
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+
 		stmmac_release_tx_desc(priv, p, priv->mode);
 
 		entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
@@ -2056,8 +2348,14 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	}
 
 	if ((priv->eee_enabled) && (!priv->tx_path_in_lpi_mode)) {
-		stmmac_enable_eee_mode(priv);
-		mod_timer(&priv->eee_ctrl_timer, STMMAC_LPI_T(eee_timer));
+		if (!priv->eee_lpi_delay) {
+			stmmac_enable_eee_mode(priv);
+			mod_timer(&priv->eee_ctrl_timer,
+				  STMMAC_LPI_T(eee_timer));
+		} else {
+			mod_timer(&priv->eee_ctrl_timer,
+				  STMMAC_LPI_T(priv->eee_lpi_delay));
+		}
 	}
 
 	/* We still have pending packets, let's call for a new scheduling */
@@ -2144,6 +2442,17 @@ static bool stmmac_safety_feat_interrupt(struct stmmac_priv *priv)
 	return false;
 }
 
+static void stmmac_napi_schedule(struct stmmac_channel *ch,
+				 struct napi_struct *napi, int bit)
+{
+	if (ch->napi_thread) {
+		set_bit(bit, &ch->napi_pending);
+		wake_up_process(ch->napi_thread);
+	} else {
+		__napi_schedule(napi);
+	}
+}
+
 static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan)
 {
 	int status = stmmac_dma_interrupt_status(priv, priv->ioaddr,
@@ -2156,7 +2465,7 @@ static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan)
 			spin_lock_irqsave(&ch->lock, flags);
 			stmmac_disable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 			spin_unlock_irqrestore(&ch->lock, flags);
-			__napi_schedule_irqoff(&ch->rx_napi);
+			stmmac_napi_schedule(ch, &ch->rx_napi, STMMAC_NAPI_RX);
 		}
 	}
 
@@ -2165,7 +2474,7 @@ static int stmmac_napi_check(struct stmmac_priv *priv, u32 chan)
 			spin_lock_irqsave(&ch->lock, flags);
 			stmmac_disable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 			spin_unlock_irqrestore(&ch->lock, flags);
-			__napi_schedule_irqoff(&ch->tx_napi);
+			stmmac_napi_schedule(ch, &ch->tx_napi, STMMAC_NAPI_TX);
 		}
 	}
 
@@ -2368,7 +2677,7 @@ static void stmmac_tx_timer(struct timer_list *t)
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_disable_dma_irq(priv, priv->ioaddr, ch->index, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
-		__napi_schedule(&ch->tx_napi);
+		stmmac_napi_schedule(ch, &ch->tx_napi, STMMAC_NAPI_TX);
 	}
 }
 
@@ -2696,7 +3005,11 @@ static int stmmac_hw_setup(struct net_device *dev, bool init_ptp)
 		if (!priv->rx_riwt)
 			priv->rx_riwt = DEF_DMA_RIWT;
 
-		ret = stmmac_rx_watchdog(priv, priv->ioaddr, priv->rx_riwt, rx_cnt);
+		for (chan = 0; chan < rx_cnt; chan++) {
+			priv->channel[chan].rx_riwt = priv->rx_riwt;
+			stmmac_rx_watchdog(priv, priv->ioaddr, priv->rx_riwt,
+					   chan);
+		}
 	}
 
 	if (priv->hw->pcs)
@@ -2773,6 +3086,7 @@ static int stmmac_open(struct net_device *dev)
 	/* Extra statistics */
 	memset(&priv->xstats, 0, sizeof(struct stmmac_extra_stats));
 	priv->xstats.threshold = tc;
+	clear_bit(STMMAC_DELAY_CALIB_DONE, &priv->state);
 
 	bfsize = stmmac_set_16kib_bfsize(priv, dev->mtu);
 	if (bfsize < 0)
@@ -2785,6 +3099,7 @@ static int stmmac_open(struct net_device *dev)
 	buf_sz = bfsize;
 
 	priv->rx_copybreak = STMMAC_RX_COPYBREAK;
+	priv->rx_build_skb = stmmac_rx_build_skb_capable(priv);
 
 	/* Earlier check for TBS */
 	for (chan = 0; chan < priv->plat->tx_queues_to_use; chan++) {
@@ -2818,8 +3133,25 @@ static int stmmac_open(struct net_device *dev)
 
 	stmmac_init_coalesce(priv);
 
+	for (chan = 0; chan < priv->plat->rx_queues_to_use; chan++) {
+		struct dim *dim = &priv->channel[chan].rx_dim;
+
+		dim->mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		dim->state = DIM_START_MEASURE;
+	}
+
 	phylink_start(priv->phylink);
 
+	if (napi_threaded) {
+		ret = stmmac_napi_threads_start(priv);
+		if (ret) {
+			netdev_err(priv->dev,
+				   "%s: Cannot start NAPI threads (error: %d)\n",
+				   __func__, ret);
+			goto irq_error;
+		}
+	}
+
 	/* Request the IRQ lines */
 	ret = request_irq(dev->irq, stmmac_interrupt,
 			  IRQF_SHARED, dev->name, dev);
@@ -2870,6 +3202,8 @@ static int stmmac_open(struct net_device *dev)
 	for (chan = 0; chan < priv->plat->tx_queues_to_use; chan++)
 		del_timer_sync(&priv->tx_queue[chan].txtimer);
 
+	stmmac_napi_threads_stop(priv);
+
 	stmmac_hw_teardown(dev);
 init_error:
 	free_dma_desc_resources(priv);
@@ -2903,6 +3237,11 @@ static int stmmac_release(struct net_device *dev)
 	for (chan = 0; chan < priv->plat->tx_queues_to_use; chan++)
 		del_timer_sync(&priv->tx_queue[chan].txtimer);
 
+	for (chan = 0; chan < priv->plat->rx_queues_to_use; chan++)
+		cancel_work_sync(&priv->channel[chan].rx_dim.work);
+
+	stmmac_napi_threads_stop(priv);
+
 	/* Free the IRQ lines */
 	free_irq(dev->irq, dev);
 	if (priv->wol_irq != dev->irq)
@@ -3272,44 +3611,32 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 }
 
 /**
- *  stmmac_xmit - Tx entry point of the driver
+ *  stmmac_sw_tso_xmit - Tx entry point of the driver for TSO emulation
  *  @skb : the socket buffer
  *  @dev : device pointer
- *  Description : this is the tx entry point of the driver.
- *  It programs the chain or the ring and supports oversized frames
- *  and SG feature.
+ *  Description : used on cores without TSO support. Each segment gets its
+ *  own headers, built with net/tso in a coherent buffer attached to the
+ *  descriptor entry, followed by descriptors pointing straight into the skb
+ *  linear part and frags, so the payload is never copied and only one skb
+ *  goes through the stack. IP and TCP checksums are left to the TX COE.
  */
-static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
+static netdev_tx_t stmmac_sw_tso_xmit(struct sk_buff *skb,
+				      struct net_device *dev)
 {
-	unsigned int first_entry, tx_packets, enh_desc;
+	int hdr_len = skb_transport_offset(skb) + tcp_hdrlen(skb);
+	unsigned int first_entry, last_entry, entry, tx_packets = 0;
 	struct stmmac_priv *priv = netdev_priv(dev);
-	unsigned int nopaged_len = skb_headlen(skb);
-	int i, csum_insertion = 0, is_jumbo = 0;
 	u32 queue = skb_get_queue_mapping(skb);
-	int nfrags = skb_shinfo(skb)->nr_frags;
-	int gso = skb_shinfo(skb)->gso_type;
-	struct dma_edesc *tbs_desc = NULL;
-	int entry, desc_size, first_tx;
-	struct dma_desc *desc, *first;
+	struct dma_desc *desc, *first = NULL;
+	int total_len = skb->len - hdr_len;
 	struct stmmac_tx_queue *tx_q;
-	bool has_vlan, set_ic;
-	dma_addr_t des;
+	int desc_size, i;
+	struct tso_t tso;
+	bool set_ic;
 
 	tx_q = &priv->tx_queue[queue];
-	first_tx = tx_q->cur_tx;
-
-	if (priv->tx_path_in_lpi_mode)
-		stmmac_disable_eee_mode(priv);
-
-	/* Manage oversized TCP frames for GMAC4 device */
-	if (skb_is_gso(skb) && priv->tso) {
-		if (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6))
-			return stmmac_tso_xmit(skb, dev);
-		if (priv->plat->has_gmac4 && (gso & SKB_GSO_UDP_L4))
-			return stmmac_tso_xmit(skb, dev);
-	}
 
-	if (unlikely(stmmac_tx_avail(priv, queue) < nfrags + 1)) {
+	if (unlikely(stmmac_tx_avail(priv, queue) < tso_count_descs(skb))) {
 		if (!netif_tx_queue_stopped(netdev_get_tx_queue(dev, queue))) {
 			netif_tx_stop_queue(netdev_get_tx_queue(priv->dev,
 								queue));
@@ -3321,85 +3648,83 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		return NETDEV_TX_BUSY;
 	}
 
-	/* Check if VLAN can be inserted by HW */
-	has_vlan = stmmac_vlan_insert(priv, skb, tx_q);
-
-	entry = tx_q->cur_tx;
-	first_entry = entry;
+	first_entry = tx_q->cur_tx;
+	last_entry = first_entry;
+	entry = first_entry;
 	WARN_ON(tx_q->tx_skbuff[first_entry]);
 
-	csum_insertion = (skb->ip_summed == CHECKSUM_PARTIAL);
-
-	if (likely(priv->extend_desc))
-		desc = (struct dma_desc *)(tx_q->dma_etx + entry);
-	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
-		desc = &tx_q->dma_entx[entry].basic;
-	else
-		desc = tx_q->dma_tx + entry;
-
-	first = desc;
-
-	if (has_vlan)
-		stmmac_set_desc_vlan(priv, first, STMMAC_VLAN_INSERT);
-
-	enh_desc = priv->plat->enh_desc;
-	/* To program the descriptors according to the size of the frame */
-	if (enh_desc)
-		is_jumbo = stmmac_is_jumbo_frm(priv, skb->len, enh_desc);
+	tso_start(skb, &tso);
 
-	if (unlikely(is_jumbo)) {
-		entry = stmmac_jumbo_frm(priv, tx_q, skb, csum_insertion);
-		if (unlikely(entry < 0) && (entry != -EINVAL))
-			goto dma_map_err;
-	}
+	while (total_len > 0) {
+		int data_left = min_t(int, skb_shinfo(skb)->gso_size,
+				      total_len);
+		int seg_len = hdr_len + data_left;
+		char *hdr = tx_q->tso_hdrs + entry * TSO_HEADER_SIZE;
 
-	for (i = 0; i < nfrags; i++) {
-		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
-		int len = skb_frag_size(frag);
-		bool last_segment = (i == (nfrags - 1));
+		total_len -= data_left;
 
-		entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
-		WARN_ON(tx_q->tx_skbuff[entry]);
+		/* Segment headers, nothing to unmap on completion */
+		tso_build_hdr(skb, hdr, &tso, data_left, total_len == 0);
 
 		if (likely(priv->extend_desc))
 			desc = (struct dma_desc *)(tx_q->dma_etx + entry);
-		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
-			desc = &tx_q->dma_entx[entry].basic;
 		else
 			desc = tx_q->dma_tx + entry;
 
-		des = skb_frag_dma_map(priv->device, frag, 0, len,
-				       DMA_TO_DEVICE);
-		if (dma_mapping_error(priv->device, des))
-			goto dma_map_err; /* should reuse desc w/o issues */
+		tx_q->tx_skbuff_dma[entry].buf = 0;
+		tx_q->tx_skbuff_dma[entry].len = hdr_len;
+		tx_q->tx_skbuff_dma[entry].last_segment = false;
 
-		tx_q->tx_skbuff_dma[entry].buf = des;
+		stmmac_set_desc_addr(priv, desc, tx_q->tso_hdrs_dma +
+				     entry * TSO_HEADER_SIZE);
+		/* The very first descriptor is handed over last */
+		stmmac_prepare_tx_desc(priv, desc, 1, hdr_len, 1, priv->mode,
+				       first != NULL, false, seg_len);
+		if (!first)
+			first = desc;
 
-		stmmac_set_desc_addr(priv, desc, des);
+		while (data_left > 0) {
+			int size = min_t(int, tso.size, data_left);
+			dma_addr_t des;
 
-		tx_q->tx_skbuff_dma[entry].map_as_page = true;
-		tx_q->tx_skbuff_dma[entry].len = len;
-		tx_q->tx_skbuff_dma[entry].last_segment = last_segment;
+			entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
 
-		/* Prepare the descriptor and set the own bit too */
-		stmmac_prepare_tx_desc(priv, desc, 0, len, csum_insertion,
-				priv->mode, 1, last_segment, skb->len);
+			if (likely(priv->extend_desc))
+				desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+			else
+				desc = tx_q->dma_tx + entry;
+
+			des = dma_map_single(priv->device, tso.data, size,
+					     DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, des))
+				goto dma_map_err;
+
+			data_left -= size;
+
+			tx_q->tx_skbuff_dma[entry].buf = des;
+			tx_q->tx_skbuff_dma[entry].map_as_page = false;
+			tx_q->tx_skbuff_dma[entry].len = size;
+			tx_q->tx_skbuff_dma[entry].last_segment = !data_left;
+
+			stmmac_set_desc_addr(priv, desc, des);
+			stmmac_prepare_tx_desc(priv, desc, 0, size, 1,
+					       priv->mode, 1, !data_left,
+					       seg_len);
+
+			tso_build_data(skb, &tso, size);
+		}
+
+		tx_packets++;
+		last_entry = entry;
+		entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
 	}
 
 	/* Only the last descriptor gets to point to the skb. */
-	tx_q->tx_skbuff[entry] = skb;
+	tx_q->tx_skbuff[last_entry] = skb;
 
-	/* According to the coalesce parameter the IC bit for the latest
-	 * segment is reset and the timer re-started to clean the tx status.
-	 * This approach takes care about the fragments: desc is the first
-	 * element in case of no SG.
-	 */
-	tx_packets = (entry + 1) - first_tx;
 	tx_q->tx_count_frames += tx_packets;
 
-	if ((skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) && priv->hwts_tx_en)
-		set_ic = true;
-	else if (!priv->tx_coal_frames)
+	if (!priv->tx_coal_frames)
 		set_ic = false;
 	else if (tx_packets > priv->tx_coal_frames)
 		set_ic = true;
@@ -3410,21 +3735,235 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	if (set_ic) {
 		if (likely(priv->extend_desc))
-			desc = &tx_q->dma_etx[entry].basic;
-		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
-			desc = &tx_q->dma_entx[entry].basic;
+			desc = &tx_q->dma_etx[last_entry].basic;
 		else
-			desc = &tx_q->dma_tx[entry];
+			desc = &tx_q->dma_tx[last_entry];
 
 		tx_q->tx_count_frames = 0;
 		stmmac_set_tx_ic(priv, desc);
 		priv->xstats.tx_set_ic_bit++;
 	}
 
-	/* We've used all descriptors we need for this skb, however,
-	 * advance cur_tx so that it references a fresh descriptor.
-	 * ndo_start_xmit will fill this descriptor the next time it's
-	 * called and stmmac_tx_clean may clean up to this descriptor.
+	tx_q->cur_tx = entry;
+
+	if (unlikely(stmmac_tx_avail(priv, queue) <= STMMAC_SW_TSO_MAX_DESCS)) {
+		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
+			  __func__);
+		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+	}
+
+	dev->stats.tx_bytes += skb->len + (tx_packets - 1) * hdr_len;
+	priv->xstats.tx_tso_frames++;
+	priv->xstats.tx_tso_nfrags += tx_packets;
+
+	skb_tx_timestamp(skb);
+
+	stmmac_set_tx_owner(priv, first);
+
+	/* The own bit must be the latest setting done when prepare the
+	 * descriptor and then barrier is needed to make sure that
+	 * all is coherent before granting the DMA engine.
+	 */
+	wmb();
+
+	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
+
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+	if (likely(priv->extend_desc))
+		desc_size = sizeof(struct dma_extended_desc);
+	else
+		desc_size = sizeof(struct dma_desc);
+
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
+	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+	stmmac_tx_timer_arm(priv, queue);
+
+	return NETDEV_TX_OK;
+
+dma_map_err:
+	netdev_err(priv->dev, "Tx DMA map failed\n");
+
+	/* Give back everything prepared so far, none of it was handed over */
+	for (i = first_entry; i != entry; i = STMMAC_GET_ENTRY(i, DMA_TX_SIZE)) {
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + i);
+		else
+			desc = tx_q->dma_tx + i;
+
+		if (tx_q->tx_skbuff_dma[i].buf)
+			dma_unmap_single(priv->device,
+					 tx_q->tx_skbuff_dma[i].buf,
+					 tx_q->tx_skbuff_dma[i].len,
+					 DMA_TO_DEVICE);
+		tx_q->tx_skbuff_dma[i].buf = 0;
+		tx_q->tx_skbuff_dma[i].len = 0;
+		tx_q->tx_skbuff_dma[i].last_segment = false;
+		stmmac_release_tx_desc(priv, desc, priv->mode);
+	}
+
+	dev_kfree_skb(skb);
+	priv->dev->stats.tx_dropped++;
+	return NETDEV_TX_OK;
+}
+
+/**
+ *  stmmac_xmit - Tx entry point of the driver
+ *  @skb : the socket buffer
+ *  @dev : device pointer
+ *  Description : this is the tx entry point of the driver.
+ *  It programs the chain or the ring and supports oversized frames
+ *  and SG feature.
+ */
+static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	unsigned int first_entry, tx_packets, enh_desc;
+	struct stmmac_priv *priv = netdev_priv(dev);
+	unsigned int nopaged_len = skb_headlen(skb);
+	int i, csum_insertion = 0, is_jumbo = 0;
+	u32 queue = skb_get_queue_mapping(skb);
+	int nfrags = skb_shinfo(skb)->nr_frags;
+	int gso = skb_shinfo(skb)->gso_type;
+	struct dma_edesc *tbs_desc = NULL;
+	int entry, desc_size, first_tx;
+	struct dma_desc *desc, *first;
+	struct stmmac_tx_queue *tx_q;
+	bool has_vlan, set_ic;
+	dma_addr_t des;
+
+	tx_q = &priv->tx_queue[queue];
+	first_tx = tx_q->cur_tx;
+
+	if (priv->tx_path_in_lpi_mode)
+		stmmac_disable_eee_mode(priv);
+
+	/* Manage oversized TCP frames for GMAC4 device */
+	if (skb_is_gso(skb) && priv->tso) {
+		if (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6))
+			return stmmac_tso_xmit(skb, dev);
+		if (priv->plat->has_gmac4 && (gso & SKB_GSO_UDP_L4))
+			return stmmac_tso_xmit(skb, dev);
+	}
+
+	if (skb_is_gso(skb) && priv->sw_tso)
+		return stmmac_sw_tso_xmit(skb, dev);
+
+	if (unlikely(stmmac_tx_avail(priv, queue) < nfrags + 1)) {
+		if (!netif_tx_queue_stopped(netdev_get_tx_queue(dev, queue))) {
+			netif_tx_stop_queue(netdev_get_tx_queue(priv->dev,
+								queue));
+			/* This is a hard error, log it. */
+			netdev_err(priv->dev,
+				   "%s: Tx Ring full when queue awake\n",
+				   __func__);
+		}
+		return NETDEV_TX_BUSY;
+	}
+
+	/* Check if VLAN can be inserted by HW */
+	has_vlan = stmmac_vlan_insert(priv, skb, tx_q);
+
+	entry = tx_q->cur_tx;
+	first_entry = entry;
+	WARN_ON(tx_q->tx_skbuff[first_entry]);
+
+	csum_insertion = (skb->ip_summed == CHECKSUM_PARTIAL);
+
+	if (likely(priv->extend_desc))
+		desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		desc = &tx_q->dma_entx[entry].basic;
+	else
+		desc = tx_q->dma_tx + entry;
+
+	first = desc;
+
+	if (has_vlan)
+		stmmac_set_desc_vlan(priv, first, STMMAC_VLAN_INSERT);
+
+	enh_desc = priv->plat->enh_desc;
+	/* To program the descriptors according to the size of the frame */
+	if (enh_desc)
+		is_jumbo = stmmac_is_jumbo_frm(priv, skb->len, enh_desc);
+
+	if (unlikely(is_jumbo)) {
+		entry = stmmac_jumbo_frm(priv, tx_q, skb, csum_insertion);
+		if (unlikely(entry < 0) && (entry != -EINVAL))
+			goto dma_map_err;
+	}
+
+	for (i = 0; i < nfrags; i++) {
+		const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+		int len = skb_frag_size(frag);
+		bool last_segment = (i == (nfrags - 1));
+
+		entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
+		WARN_ON(tx_q->tx_skbuff[entry]);
+
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			desc = &tx_q->dma_entx[entry].basic;
+		else
+			desc = tx_q->dma_tx + entry;
+
+		des = skb_frag_dma_map(priv->device, frag, 0, len,
+				       DMA_TO_DEVICE);
+		if (dma_mapping_error(priv->device, des))
+			goto dma_map_err; /* should reuse desc w/o issues */
+
+		tx_q->tx_skbuff_dma[entry].buf = des;
+
+		stmmac_set_desc_addr(priv, desc, des);
+
+		tx_q->tx_skbuff_dma[entry].map_as_page = true;
+		tx_q->tx_skbuff_dma[entry].len = len;
+		tx_q->tx_skbuff_dma[entry].last_segment = last_segment;
+
+		/* Prepare the descriptor and set the own bit too */
+		stmmac_prepare_tx_desc(priv, desc, 0, len, csum_insertion,
+				priv->mode, 1, last_segment, skb->len);
+	}
+
+	/* Only the last descriptor gets to point to the skb. */
+	tx_q->tx_skbuff[entry] = skb;
+
+	/* According to the coalesce parameter the IC bit for the latest
+	 * segment is reset and the timer re-started to clean the tx status.
+	 * This approach takes care about the fragments: desc is the first
+	 * element in case of no SG.
+	 */
+	tx_packets = (entry + 1) - first_tx;
+	tx_q->tx_count_frames += tx_packets;
+
+	if ((skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) && priv->hwts_tx_en)
+		set_ic = true;
+	else if (!priv->tx_coal_frames)
+		set_ic = false;
+	else if (tx_packets > priv->tx_coal_frames)
+		set_ic = true;
+	else if ((tx_q->tx_count_frames % priv->tx_coal_frames) < tx_packets)
+		set_ic = true;
+	else
+		set_ic = false;
+
+	if (set_ic) {
+		if (likely(priv->extend_desc))
+			desc = &tx_q->dma_etx[entry].basic;
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			desc = &tx_q->dma_entx[entry].basic;
+		else
+			desc = &tx_q->dma_tx[entry];
+
+		tx_q->tx_count_frames = 0;
+		stmmac_set_tx_ic(priv, desc);
+		priv->xstats.tx_set_ic_bit++;
+	}
+
+	/* We've used all descriptors we need for this skb, however,
+	 * advance cur_tx so that it references a fresh descriptor.
+	 * ndo_start_xmit will fill this descriptor the next time it's
+	 * called and stmmac_tx_clean may clean up to this descriptor.
 	 */
 	entry = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
 	tx_q->cur_tx = entry;
@@ -3439,7 +3978,8 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 		print_pkt(skb->data, skb->len);
 	}
 
-	if (unlikely(stmmac_tx_avail(priv, queue) <= (MAX_SKB_FRAGS + 1))) {
+	if (unlikely(stmmac_tx_avail(priv, queue) <= (priv->sw_tso ?
+		     STMMAC_SW_TSO_MAX_DESCS : MAX_SKB_FRAGS + 1))) {
 		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
 			  __func__);
 		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
@@ -3564,9 +4104,14 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 {
 	struct stmmac_rx_queue *rx_q = &priv->rx_queue[queue];
 	int len, dirty = stmmac_rx_dirty(priv, queue);
+	unsigned int offset = stmmac_rx_offset(priv);
 	unsigned int entry = rx_q->dirty_rx;
 
-	len = DIV_ROUND_UP(priv->dma_buf_sz, PAGE_SIZE) * PAGE_SIZE;
+	if (priv->rx_build_skb)
+		len = STMMAC_RX_HALF_PAGE;
+	else
+		len = DIV_ROUND_UP(priv->dma_buf_sz + offset, PAGE_SIZE) *
+		      PAGE_SIZE;
 
 	while (dirty-- > 0) {
 		struct stmmac_rx_buffer *buf = &rx_q->buf_pool[entry];
@@ -3582,6 +4127,7 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 			buf->page = page_pool_dev_alloc_pages(rx_q->page_pool);
 			if (!buf->page)
 				break;
+			buf->page_offset = 0;
 		}
 
 		if (priv->sph && !buf->sec_page) {
@@ -3595,13 +4141,14 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 						   len, DMA_FROM_DEVICE);
 		}
 
-		buf->addr = page_pool_get_dma_addr(buf->page);
+		buf->addr = page_pool_get_dma_addr(buf->page) +
+			    buf->page_offset + offset;
 
 		/* Sync whole allocation to device. This will invalidate old
 		 * data.
 		 */
-		dma_sync_single_for_device(priv->device, buf->addr, len,
-					   DMA_FROM_DEVICE);
+		dma_sync_single_for_device(priv->device, buf->addr,
+					   len - offset, DMA_FROM_DEVICE);
 
 		stmmac_set_desc_addr(priv, p, buf->addr);
 		stmmac_set_desc_sec_addr(priv, p, buf->sec_addr);
@@ -3677,6 +4224,239 @@ static unsigned int stmmac_rx_buf2_len(struct stmmac_priv *priv,
 	return plen - len;
 }
 
+static int stmmac_xdp_get_tx_queue(struct stmmac_priv *priv, int cpu)
+{
+	if (unlikely(cpu < 0))
+		cpu = 0;
+
+	return cpu % priv->plat->tx_queues_to_use;
+}
+
+/**
+ * stmmac_xdp_xmit_xdpf - queue one XDP frame on a TX ring
+ * @priv: driver private structure
+ * @queue: TX queue index
+ * @xdpf: frame to transmit
+ * @dma_map: true for frames coming from ndo_xdp_xmit, which have to be
+ * mapped; false for XDP_TX, where the frame still sits in our own RX page.
+ * Description: the caller holds the netdev TX queue lock and kicks the DMA
+ * with stmmac_xdp_flush_tx() once it is done queueing.
+ */
+static int stmmac_xdp_xmit_xdpf(struct stmmac_priv *priv, u32 queue,
+				struct xdp_frame *xdpf, bool dma_map)
+{
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+	unsigned int entry = tx_q->cur_tx;
+	struct dma_desc *tx_desc;
+	dma_addr_t dma_addr;
+	bool set_ic;
+
+	/* Leave room for the regular transmit path */
+	if (stmmac_tx_avail(priv, queue) < STMMAC_TX_THRESH)
+		return STMMAC_XDP_CONSUMED;
+
+	if (likely(priv->extend_desc))
+		tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		tx_desc = &tx_q->dma_entx[entry].basic;
+	else
+		tx_desc = tx_q->dma_tx + entry;
+
+	if (dma_map) {
+		dma_addr = dma_map_single(priv->device, xdpf->data,
+					  xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(priv->device, dma_addr))
+			return STMMAC_XDP_CONSUMED;
+
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_NDO;
+	} else {
+		struct page *page = virt_to_page(xdpf->data);
+
+		dma_addr = page_pool_get_dma_addr(page) + sizeof(*xdpf) +
+			   xdpf->headroom;
+		dma_sync_single_for_device(priv->device, dma_addr,
+					   xdpf->len, DMA_BIDIRECTIONAL);
+
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_TX;
+	}
+
+	tx_q->tx_skbuff_dma[entry].buf = dma_addr;
+	tx_q->tx_skbuff_dma[entry].map_as_page = false;
+	tx_q->tx_skbuff_dma[entry].len = xdpf->len;
+	tx_q->tx_skbuff_dma[entry].last_segment = true;
+	tx_q->tx_skbuff_dma[entry].is_jumbo = false;
+
+	tx_q->xdpf[entry] = xdpf;
+
+	stmmac_set_desc_addr(priv, tx_desc, dma_addr);
+	stmmac_prepare_tx_desc(priv, tx_desc, 1, xdpf->len, 0, priv->mode,
+			       1, true, xdpf->len);
+
+	tx_q->tx_count_frames++;
+
+	if (!priv->tx_coal_frames)
+		set_ic = false;
+	else if (tx_q->tx_count_frames % priv->tx_coal_frames == 0)
+		set_ic = true;
+	else
+		set_ic = false;
+
+	if (set_ic) {
+		tx_q->tx_count_frames = 0;
+		stmmac_set_tx_ic(priv, tx_desc);
+		priv->xstats.tx_set_ic_bit++;
+	}
+
+	priv->dev->stats.tx_bytes += xdpf->len;
+
+	tx_q->cur_tx = STMMAC_GET_ENTRY(entry, DMA_TX_SIZE);
+
+	return STMMAC_XDP_TX;
+}
+
+static void stmmac_xdp_flush_tx(struct stmmac_priv *priv, u32 queue)
+{
+	struct stmmac_tx_queue *tx_q = &priv->tx_queue[queue];
+	int desc_size;
+
+	/* Descriptors must be visible to the DMA before it is kicked */
+	wmb();
+
+	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+	if (likely(priv->extend_desc))
+		desc_size = sizeof(struct dma_extended_desc);
+	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+		desc_size = sizeof(struct dma_edesc);
+	else
+		desc_size = sizeof(struct dma_desc);
+
+	tx_q->tx_tail_addr = tx_q->dma_tx_phy + (tx_q->cur_tx * desc_size);
+	stmmac_set_tx_tail_ptr(priv, priv->ioaddr, tx_q->tx_tail_addr, queue);
+	stmmac_tx_timer_arm(priv, queue);
+}
+
+static int stmmac_xdp_xmit_back(struct stmmac_priv *priv,
+				struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = convert_to_xdp_frame(xdp);
+	int cpu = smp_processor_id();
+	struct netdev_queue *nq;
+	int queue;
+	int res;
+
+	if (unlikely(!xdpf))
+		return STMMAC_XDP_CONSUMED;
+
+	queue = stmmac_xdp_get_tx_queue(priv, cpu);
+	nq = netdev_get_tx_queue(priv->dev, queue);
+
+	__netif_tx_lock(nq, cpu);
+	/* Avoids TX time-out as we are sharing with slow path */
+	nq->trans_start = jiffies;
+	res = stmmac_xdp_xmit_xdpf(priv, queue, xdpf, false);
+	__netif_tx_unlock(nq);
+
+	return res;
+}
+
+static int stmmac_xdp_run_prog(struct stmmac_priv *priv,
+			       struct bpf_prog *prog,
+			       struct xdp_buff *xdp)
+{
+	u32 act;
+	int res;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		res = STMMAC_XDP_PASS;
+		break;
+	case XDP_TX:
+		res = stmmac_xdp_xmit_back(priv, xdp);
+		if (res == STMMAC_XDP_CONSUMED)
+			trace_xdp_exception(priv->dev, prog, act);
+		break;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(priv->dev, xdp, prog) < 0) {
+			trace_xdp_exception(priv->dev, prog, act);
+			res = STMMAC_XDP_CONSUMED;
+		} else {
+			res = STMMAC_XDP_REDIRECT;
+		}
+		break;
+	default:
+		bpf_warn_invalid_xdp_action(act);
+		/* fall through */
+	case XDP_ABORTED:
+		trace_xdp_exception(priv->dev, prog, act);
+		/* fall through */
+	case XDP_DROP:
+		res = STMMAC_XDP_CONSUMED;
+		break;
+	}
+
+	return res;
+}
+
+static void stmmac_finalize_xdp_rx(struct stmmac_priv *priv, int xdp_status)
+{
+	int cpu = smp_processor_id();
+	int queue;
+
+	if (xdp_status & STMMAC_XDP_TX) {
+		struct netdev_queue *nq;
+
+		queue = stmmac_xdp_get_tx_queue(priv, cpu);
+		nq = netdev_get_tx_queue(priv->dev, queue);
+
+		__netif_tx_lock(nq, cpu);
+		stmmac_xdp_flush_tx(priv, queue);
+		__netif_tx_unlock(nq);
+	}
+
+	if (xdp_status & STMMAC_XDP_REDIRECT)
+		xdp_do_flush();
+}
+
+/**
+ * stmmac_rx_build_skb - build an skb around a received buffer
+ * @priv: driver private structure
+ * @rx_q: RX queue the buffer belongs to
+ * @buf: RX buffer holding a complete frame
+ * @len: frame length
+ * Description: the skb takes the half page the frame was received in. The
+ * page itself stays in the ring and the next frame lands in its other half,
+ * unless the stack still holds an skb there, in which case the page is
+ * released from the pool and a new one gets allocated on refill.
+ */
+static struct sk_buff *stmmac_rx_build_skb(struct stmmac_priv *priv,
+					   struct stmmac_rx_queue *rx_q,
+					   struct stmmac_rx_buffer *buf,
+					   unsigned int len)
+{
+	struct page *page = buf->page;
+	struct sk_buff *skb;
+
+	skb = build_skb(page_address(page) + buf->page_offset,
+			STMMAC_RX_HALF_PAGE);
+	if (unlikely(!skb))
+		return NULL;
+
+	skb_reserve(skb, STMMAC_RX_HEADROOM);
+	skb_put(skb, len);
+
+	if (likely(page_ref_count(page) == 1 && !page_is_pfmemalloc(page))) {
+		page_ref_inc(page);
+		buf->page_offset ^= STMMAC_RX_HALF_PAGE;
+	} else {
+		page_pool_release_page(rx_q->page_pool, page);
+		buf->page = NULL;
+	}
+
+	return skb;
+}
+
 /**
  * stmmac_rx - manage the receive process
  * @priv: driver private structure
@@ -3691,8 +4471,12 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	struct stmmac_channel *ch = &priv->channel[queue];
 	unsigned int count = 0, error = 0, len = 0;
 	int status = 0, coe = priv->hw->rx_csum;
+	unsigned int offset = stmmac_rx_offset(priv);
 	unsigned int next_entry = rx_q->cur_rx;
 	struct sk_buff *skb = NULL;
+	unsigned int rx_bytes = 0;
+	struct bpf_prog *prog;
+	int xdp_status = 0;
 
 	if (netif_msg_rx_status(priv)) {
 		void *rx_head;
@@ -3705,6 +4489,10 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 
 		stmmac_display_ring(priv, rx_head, DMA_RX_SIZE, true);
 	}
+
+	rcu_read_lock();
+	prog = READ_ONCE(priv->xdp_prog);
+
 	while (count < limit) {
 		unsigned int buf1_len = 0, buf2_len = 0;
 		enum pkt_hash_types hash_type;
@@ -3775,9 +4563,18 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			continue;
 		}
 
+		/* The program only ever sees single buffer frames, anything
+		 * spanning several descriptors is dropped while it is attached.
+		 */
+		if (unlikely(prog && (status & rx_not_ls))) {
+			priv->dev->stats.rx_dropped++;
+			error = 1;
+			goto read_again;
+		}
+
 		/* Buffer is good. Go on. */
 
-		prefetch(page_address(buf->page));
+		prefetch(page_address(buf->page) + buf->page_offset + offset);
 		if (buf->sec_page)
 			prefetch(page_address(buf->sec_page));
 
@@ -3805,6 +4602,59 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 		}
 
 		if (!skb) {
+			void *data = page_address(buf->page) + buf->page_offset +
+				     offset;
+
+			dma_sync_single_for_cpu(priv->device, buf->addr,
+						buf1_len, DMA_FROM_DEVICE);
+
+			if (prog) {
+				struct xdp_buff xdp;
+				int xdp_res;
+
+				xdp.data_hard_start = page_address(buf->page);
+				xdp.data = data;
+				xdp_set_data_meta_invalid(&xdp);
+				xdp.data_end = data + buf1_len;
+				xdp.rxq = &rx_q->xdp_rxq;
+
+				xdp_res = stmmac_xdp_run_prog(priv, prog, &xdp);
+				if (xdp_res) {
+					if (xdp_res & STMMAC_XDP_CONSUMED) {
+						page_pool_recycle_direct(rx_q->page_pool,
+									 buf->page);
+						priv->dev->stats.rx_dropped++;
+					} else {
+						priv->dev->stats.rx_packets++;
+						priv->dev->stats.rx_bytes +=
+							xdp.data_end - xdp.data;
+						rx_bytes += xdp.data_end - xdp.data;
+					}
+
+					/* TX and REDIRECT now own the page */
+					buf->page = NULL;
+					xdp_status |= xdp_res;
+					count++;
+					continue;
+				}
+
+				/* The program may have moved the packet */
+				data = xdp.data;
+				buf1_len = xdp.data_end - xdp.data;
+				len = buf1_len;
+			}
+
+			/* Single buffer frames need neither copy nor new page */
+			if (priv->rx_build_skb && !(status & rx_not_ls)) {
+				skb = stmmac_rx_build_skb(priv, rx_q, buf,
+							  buf1_len);
+				if (!skb) {
+					priv->dev->stats.rx_dropped++;
+					count++;
+				}
+				goto drain_data;
+			}
+
 			skb = napi_alloc_skb(&ch->rx_napi, buf1_len);
 			if (!skb) {
 				priv->dev->stats.rx_dropped++;
@@ -3812,10 +4662,7 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 				goto drain_data;
 			}
 
-			dma_sync_single_for_cpu(priv->device, buf->addr,
-						buf1_len, DMA_FROM_DEVICE);
-			skb_copy_to_linear_data(skb, page_address(buf->page),
-						buf1_len);
+			skb_copy_to_linear_data(skb, data, buf1_len);
 			skb_put(skb, buf1_len);
 
 			/* Data payload copied into SKB, page ready for recycle */
@@ -3825,8 +4672,8 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			dma_sync_single_for_cpu(priv->device, buf->addr,
 						buf1_len, DMA_FROM_DEVICE);
 			skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags,
-					buf->page, 0, buf1_len,
-					priv->dma_buf_sz);
+					buf->page, buf->page_offset + offset,
+					buf1_len, priv->dma_buf_sz);
 
 			/* Data payload appended into SKB */
 			page_pool_release_page(rx_q->page_pool, buf->page);
@@ -3871,9 +4718,15 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 
 		priv->dev->stats.rx_packets++;
 		priv->dev->stats.rx_bytes += len;
+		rx_bytes += len;
 		count++;
 	}
 
+	if (xdp_status)
+		stmmac_finalize_xdp_rx(priv, xdp_status);
+
+	rcu_read_unlock();
+
 	if (status & rx_not_ls || skb) {
 		rx_q->state_saved = true;
 		rx_q->state.skb = skb;
@@ -3884,10 +4737,40 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	stmmac_rx_refill(priv, queue);
 
 	priv->xstats.rx_pkt_n += count;
+	ch->rx_dim_packets += count;
+	ch->rx_dim_bytes += rx_bytes;
 
 	return count;
 }
 
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, rx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+	u32 riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	riwt = clamp_t(u32, stmmac_usec2riwt(moder.usec, priv),
+		       MIN_DMA_RIWT, MAX_DMA_RIWT);
+
+	ch->rx_riwt = riwt;
+	stmmac_rx_watchdog(priv, priv->ioaddr, riwt, ch->index);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+static void stmmac_rx_dim_update(struct stmmac_channel *ch)
+{
+	struct dim_sample sample = {};
+
+	dim_update_sample(ch->rx_dim_events, ch->rx_dim_packets,
+			  ch->rx_dim_bytes, &sample);
+	net_dim(&ch->rx_dim, sample);
+}
+
 static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct stmmac_channel *ch =
@@ -3897,11 +4780,15 @@ static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 	int work_done;
 
 	priv->xstats.napi_poll++;
+	ch->rx_dim_events++;
 
 	work_done = stmmac_rx(priv, budget, chan);
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		if (priv->rx_dim_enabled)
+			stmmac_rx_dim_update(ch);
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -3991,6 +4878,11 @@ static int stmmac_change_mtu(struct net_device *dev, int new_mtu)
 		return -EBUSY;
 	}
 
+	if (stmmac_xdp_is_enabled(priv) && new_mtu > STMMAC_XDP_MAX_MTU) {
+		netdev_err(priv->dev, "MTU too large for XDP\n");
+		return -EINVAL;
+	}
+
 	new_mtu = STMMAC_ALIGN(new_mtu);
 
 	/* If condition true, FIFO is too small or MTU too large */
@@ -4099,10 +4991,7 @@ static irqreturn_t stmmac_interrupt(int irq, void *dev_id)
 
 		if (unlikely(status)) {
 			/* For LPI we need to save the tx status */
-			if (status & CORE_IRQ_TX_PATH_IN_LPI_MODE)
-				priv->tx_path_in_lpi_mode = true;
-			if (status & CORE_IRQ_TX_PATH_EXIT_LPI_MODE)
-				priv->tx_path_in_lpi_mode = false;
+			stmmac_eee_lpi_irq(priv, status);
 		}
 
 		for (queue = 0; queue < queues_count; queue++) {
@@ -4232,6 +5121,22 @@ static int stmmac_setup_tc(struct net_device *ndev, enum tc_setup_type type,
 	}
 }
 
+static netdev_features_t stmmac_features_check(struct sk_buff *skb,
+						struct net_device *dev,
+						netdev_features_t features)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	features = vlan_features_check(skb, features);
+
+	/* Segment headers must fit in one software TSO header slot */
+	if (priv->sw_tso && skb_is_gso(skb) &&
+	    skb_transport_offset(skb) + tcp_hdrlen(skb) > TSO_HEADER_SIZE)
+		features &= ~NETIF_F_GSO_MASK;
+
+	return features;
+}
+
 static u16 stmmac_select_queue(struct net_device *dev, struct sk_buff *skb,
 			       struct net_device *sb_dev)
 {
@@ -4441,6 +5346,115 @@ static int stmmac_dma_cap_show(struct seq_file *seq, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(stmmac_dma_cap);
 
+#if IS_ENABLED(CONFIG_STMMAC_SELFTESTS)
+static int stmmac_bench_show(struct seq_file *seq, void *v)
+{
+	struct net_device *dev = seq->private;
+	struct stmmac_priv *priv = netdev_priv(dev);
+	struct stmmac_bench *bench = &priv->bench;
+	u32 queue;
+
+	rtnl_lock();
+	seq_printf(seq, "loopback %s\n", bench->phy_lb ? "phy" : "mac");
+	seq_puts(seq, "queue  size     sent     recv       pps    Mbps"
+		 "  min_ns  p50_ns  p90_ns  p99_ns p999_ns  max_ns\n");
+
+	for (queue = 0; queue < MTL_MAX_TX_QUEUES; queue++) {
+		struct stmmac_bench_result *res = &bench->res[queue];
+		u64 pps = 0, mbps = 0;
+
+		if (!res->sent)
+			continue;
+
+		if (res->duration_ns) {
+			pps = div64_u64((u64)res->received * NSEC_PER_SEC,
+					res->duration_ns);
+			mbps = div64_u64((u64)res->received * res->frame_size *
+					 8 * 1000, res->duration_ns);
+		}
+
+		seq_printf(seq,
+			   "%5u %5u %8u %8u %9llu %7llu %7u %7u %7u %7u %7u %7u\n",
+			   queue, res->frame_size, res->sent, res->received,
+			   pps, mbps, res->lat_min, res->lat_p50, res->lat_p90,
+			   res->lat_p99, res->lat_p999, res->lat_max);
+	}
+	rtnl_unlock();
+
+	return 0;
+}
+
+static int stmmac_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, stmmac_bench_show, inode->i_private);
+}
+
+/* Writing "mac" or "phy" runs the benchmark in that loopback mode */
+static ssize_t stmmac_bench_write(struct file *file, const char __user *ubuf,
+				  size_t count, loff_t *ppos)
+{
+	struct seq_file *seq = file->private_data;
+	struct net_device *dev = seq->private;
+	struct stmmac_priv *priv = netdev_priv(dev);
+	char buf[8];
+	int ret;
+
+	if (!count || count >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, count))
+		return -EFAULT;
+	buf[count] = '\0';
+
+	rtnl_lock();
+	if (sysfs_streq(buf, "mac")) {
+		priv->bench.phy_lb = false;
+	} else if (sysfs_streq(buf, "phy")) {
+		priv->bench.phy_lb = true;
+	} else {
+		rtnl_unlock();
+		return -EINVAL;
+	}
+
+	ret = stmmac_selftest_bench(priv, &priv->bench);
+	rtnl_unlock();
+
+	return ret ? ret : count;
+}
+
+static const struct file_operations stmmac_bench_fops = {
+	.owner = THIS_MODULE,
+	.open = stmmac_bench_open,
+	.read = seq_read,
+	.write = stmmac_bench_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static void stmmac_init_bench_fs(struct net_device *dev)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	struct stmmac_bench *bench = &priv->bench;
+	struct dentry *dir;
+
+	bench->frame_size = ETH_FRAME_LEN;
+	bench->frames = 10000;
+	bench->depth = 32;
+	/* Anything past the last TX queue means all of them */
+	bench->queue = U32_MAX;
+
+	dir = debugfs_create_dir("benchmark", priv->dbgfs_dir);
+	debugfs_create_u32("frame_size", 0600, dir, &bench->frame_size);
+	debugfs_create_u32("frames", 0600, dir, &bench->frames);
+	debugfs_create_u32("depth", 0600, dir, &bench->depth);
+	debugfs_create_u32("queue", 0600, dir, &bench->queue);
+	debugfs_create_file("run", 0600, dir, dev, &stmmac_bench_fops);
+}
+#else
+static void stmmac_init_bench_fs(struct net_device *dev)
+{
+}
+#endif /* CONFIG_STMMAC_SELFTESTS */
+
 /* Use network device events to rename debugfs file entries.
  */
 static int stmmac_device_event(struct notifier_block *unused,
@@ -4486,6 +5500,9 @@ static void stmmac_init_fs(struct net_device *dev)
 	debugfs_create_file("dma_cap", 0444, priv->dbgfs_dir, dev,
 			    &stmmac_dma_cap_fops);
 
+	/* Loopback throughput and latency benchmark */
+	stmmac_init_bench_fs(dev);
+
 	rtnl_unlock();
 }
 
@@ -4591,6 +5608,95 @@ static int stmmac_vlan_rx_kill_vid(struct net_device *ndev, __be16 proto, u16 vi
 	return stmmac_vlan_update(priv, is_double);
 }
 
+static int stmmac_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			    struct netlink_ext_ack *extack)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+	bool need_update;
+	int ret = 0;
+
+	if (prog && priv->sph) {
+		NL_SET_ERR_MSG_MOD(extack, "XDP is not supported with Split Header");
+		return -EOPNOTSUPP;
+	}
+
+	if (prog && dev->mtu > STMMAC_XDP_MAX_MTU) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* RX buffer headroom and page pool DMA direction depend on whether
+	 * a program is attached, so the rings have to be rebuilt.
+	 */
+	need_update = stmmac_xdp_is_enabled(priv) != !!prog;
+	if (running && need_update)
+		stmmac_release(dev);
+
+	old_prog = xchg(&priv->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && need_update)
+		ret = stmmac_open(dev);
+
+	return ret;
+}
+
+static int stmmac_bpf(struct net_device *dev, struct netdev_bpf *bpf)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return stmmac_xdp_setup(dev, bpf->prog, bpf->extack);
+	case XDP_QUERY_PROG:
+		bpf->prog_id = priv->xdp_prog ? priv->xdp_prog->aux->id : 0;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int stmmac_xdp_xmit(struct net_device *dev, int num_frames,
+			   struct xdp_frame **frames, u32 flags)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	int cpu = smp_processor_id();
+	struct netdev_queue *nq;
+	int i, drops = 0;
+	int queue;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	queue = stmmac_xdp_get_tx_queue(priv, cpu);
+	nq = netdev_get_tx_queue(dev, queue);
+
+	__netif_tx_lock(nq, cpu);
+	/* Avoids TX time-out as we are sharing with slow path */
+	nq->trans_start = jiffies;
+
+	for (i = 0; i < num_frames; i++) {
+		if (stmmac_xdp_xmit_xdpf(priv, queue, frames[i], true) !=
+		    STMMAC_XDP_TX) {
+			xdp_return_frame_rx_napi(frames[i]);
+			drops++;
+		}
+	}
+
+	if (flags & XDP_XMIT_FLUSH)
+		stmmac_xdp_flush_tx(priv, queue);
+
+	__netif_tx_unlock(nq);
+
+	return num_frames - drops;
+}
+
 static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_open = stmmac_open,
 	.ndo_start_xmit = stmmac_xmit,
@@ -4602,6 +5708,7 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_tx_timeout = stmmac_tx_timeout,
 	.ndo_do_ioctl = stmmac_ioctl,
 	.ndo_setup_tc = stmmac_setup_tc,
+	.ndo_features_check = stmmac_features_check,
 	.ndo_select_queue = stmmac_select_queue,
 #ifdef CONFIG_NET_POLL_CONTROLLER
 	.ndo_poll_controller = stmmac_poll_controller,
@@ -4609,6 +5716,8 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_set_mac_address = stmmac_set_mac_address,
 	.ndo_vlan_rx_add_vid = stmmac_vlan_rx_add_vid,
 	.ndo_vlan_rx_kill_vid = stmmac_vlan_rx_kill_vid,
+	.ndo_bpf = stmmac_bpf,
+	.ndo_xdp_xmit = stmmac_xdp_xmit,
 };
 
 static void stmmac_reset_subtask(struct stmmac_priv *priv)
@@ -4633,12 +5742,43 @@ static void stmmac_reset_subtask(struct stmmac_priv *priv)
 	rtnl_unlock();
 }
 
+static void stmmac_delay_calib_subtask(struct stmmac_priv *priv)
+{
+	int ret;
+
+	if (!test_and_clear_bit(STMMAC_DELAY_CALIB_REQUESTED, &priv->state))
+		return;
+	if (test_bit(STMMAC_DOWN, &priv->state))
+		return;
+
+	rtnl_lock();
+	/* The loopback runs toggle the link, don't come back here for it */
+	if (!netif_running(priv->dev) ||
+	    test_and_set_bit(STMMAC_DELAY_CALIB_DONE, &priv->state))
+		goto unlock;
+
+	ret = stmmac_selftest_rgmii_delay(priv);
+	if (ret < 0) {
+		netdev_warn(priv->dev,
+			    "RGMII delay calibration failed (%d), using default\n",
+			    ret);
+		priv->plat->set_rgmii_delay(priv->plat->bsp_priv,
+					    priv->plat->rgmii_delay_default);
+		priv->xstats.rgmii_delay_step = priv->plat->rgmii_delay_default;
+		priv->xstats.rgmii_delay_window = 0;
+	}
+
+unlock:
+	rtnl_unlock();
+}
+
 static void stmmac_service_task(struct work_struct *work)
 {
 	struct stmmac_priv *priv = container_of(work, struct stmmac_priv,
 			service_task);
 
 	stmmac_reset_subtask(priv);
+	stmmac_delay_calib_subtask(priv);
 	clear_bit(STMMAC_SERVICE_SCHED, &priv->state);
 }
 
@@ -4734,6 +5874,7 @@ static int stmmac_hw_init(struct stmmac_priv *priv)
 	if (((priv->synopsys_id >= DWMAC_CORE_3_50) ||
 	    (priv->plat->has_xgmac)) && (!priv->plat->riwt_off)) {
 		priv->use_riwt = 1;
+		priv->rx_dim_enabled = true;
 		dev_info(priv->device,
 			 "Enable RX Mitigation via HW Watchdog Timer\n");
 	}
@@ -4757,7 +5898,7 @@ int stmmac_dvr_probe(struct device *device,
 {
 	struct net_device *ndev = NULL;
 	struct stmmac_priv *priv;
-	u32 queue, rxq, maxq;
+	u32 queue, rxq, maxq, weight;
 	int i, ret = 0;
 
 	ndev = devm_alloc_etherdev_mqs(device, sizeof(struct stmmac_priv),
@@ -4841,6 +5982,13 @@ int stmmac_dvr_probe(struct device *device,
 			ndev->hw_features |= NETIF_F_GSO_UDP_L4;
 		priv->tso = true;
 		dev_info(priv->device, "TSO feature enabled\n");
+	} else if (priv->plat->tx_coe && !priv->plat->has_gmac4 &&
+		   !priv->plat->has_xgmac) {
+		/* Older cores: segment in the driver, checksums by the COE */
+		ndev->hw_features |= NETIF_F_TSO | NETIF_F_TSO6;
+		ndev->gso_max_segs = STMMAC_SW_TSO_MAX_SEGS;
+		priv->sw_tso = true;
+		dev_info(priv->device, "Software TSO enabled\n");
 	}
 
 	if (priv->dma_cap.sphen) {
@@ -4932,13 +6080,16 @@ int stmmac_dvr_probe(struct device *device,
 		ch->index = queue;
 
 		if (queue < priv->plat->rx_queues_to_use) {
+			weight = priv->plat->rx_queues_cfg[queue].napi_budget;
 			netif_napi_add(ndev, &ch->rx_napi, stmmac_napi_poll_rx,
-				       NAPI_POLL_WEIGHT);
+				       stmmac_napi_weight(weight));
+			INIT_WORK(&ch->rx_dim.work, stmmac_rx_dim_work);
 		}
 		if (queue < priv->plat->tx_queues_to_use) {
+			weight = priv->plat->tx_queues_cfg[queue].napi_budget;
 			netif_tx_napi_add(ndev, &ch->tx_napi,
 					  stmmac_napi_poll_tx,
-					  NAPI_POLL_WEIGHT);
+					  stmmac_napi_weight(weight));
 		}
 	}
 
@@ -196,6 +196,10 @@ static int stmmac_mtl_setup(struct platform_device *pdev,
 			plat->rx_queues_cfg[queue].use_prio = true;
 		}
 
+		/* Optional NAPI budget, the driver default is used if unset */
+		of_property_read_u32(q_node, "snps,napi-budget",
+				     &plat->rx_queues_cfg[queue].napi_budget);
+
 		/* RX queue specific packet type routing */
 		if (of_property_read_bool(q_node, "snps,route-avcp"))
 			plat->rx_queues_cfg[queue].pkt_route = PACKET_AVCPQ;
@@ -245,6 +249,9 @@ static int stmmac_mtl_setup(struct platform_device *pdev,
 					 &plat->tx_queues_cfg[queue].weight))
 			plat->tx_queues_cfg[queue].weight = 0x10 + queue;
 
+		of_property_read_u32(q_node, "snps,napi-budget",
+				     &plat->tx_queues_cfg[queue].napi_budget);
+
 		if (of_property_read_bool(q_node, "snps,dcb-algorithm")) {
 			plat->tx_queues_cfg[queue].mode_to_use = MTL_QUEUE_DCB;
 		} else if (of_property_read_bool(q_node,
@@ -12,6 +12,8 @@
 #include <linux/ethtool.h>
 #include <linux/ip.h>
 #include <linux/phy.h>
+#include <linux/random.h>
+#include <linux/sort.h>
 #include <linux/udp.h>
 #include <net/pkt_cls.h>
 #include <net/pkt_sched.h>
@@ -2040,6 +2042,344 @@ void stmmac_selftest_get_strings(struct stmmac_priv *priv, u8 *data)
 	}
 }
 
+#define STMMAC_DELAY_CALIB_PKTS	8
+#define STMMAC_DELAY_CALIB_SIZE	1024
+
+static int stmmac_test_rgmii_delay_step(struct stmmac_priv *priv,
+					unsigned int step)
+{
+	struct stmmac_packet_attrs attr = { };
+	int i, ret;
+
+	ret = priv->plat->set_rgmii_delay(priv->plat->bsp_priv, step);
+	if (ret)
+		return ret;
+
+	ret = phy_loopback(priv->dev->phydev, true);
+	if (ret)
+		return ret;
+
+	/* Let the new clock settle before judging it */
+	msleep(20);
+
+	attr.dst = priv->dev->dev_addr;
+	attr.size = STMMAC_DELAY_CALIB_SIZE;
+
+	for (i = 0; i < STMMAC_DELAY_CALIB_PKTS; i++) {
+		ret = __stmmac_test_loopback(priv, &attr);
+		if (ret)
+			break;
+	}
+
+	phy_loopback(priv->dev->phydev, false);
+	return ret;
+}
+
+/**
+ * stmmac_selftest_rgmii_delay - calibrate the RGMII delay line
+ * @priv: driver private structure
+ * Description: sweeps every delay step offered by the glue layer, checks
+ * each of them with a burst of PHY loopback frames and programs the center
+ * of the widest window of working steps. Must be called with rtnl held and
+ * a valid link. Returns the selected step or a negative error code.
+ */
+int stmmac_selftest_rgmii_delay(struct stmmac_priv *priv)
+{
+	unsigned int steps = min_t(unsigned int, priv->plat->rgmii_delay_steps,
+				   BITS_PER_LONG);
+	unsigned int step, start = 0, best = 0, best_len = 0, len = 0;
+	unsigned long pass = 0;
+	int ret;
+
+	if (!priv->dev->phydev || !steps)
+		return -EOPNOTSUPP;
+	if (!netif_carrier_ok(priv->dev))
+		return -ENOLINK;
+
+	/* Wait for queues drain */
+	msleep(200);
+
+	for (step = 0; step < steps; step++) {
+		ret = stmmac_test_rgmii_delay_step(priv, step);
+		if (ret == -EOPNOTSUPP)
+			return ret;
+		if (!ret)
+			__set_bit(step, &pass);
+	}
+
+	for (step = 0; step < steps; step++) {
+		if (!test_bit(step, &pass)) {
+			len = 0;
+			continue;
+		}
+
+		if (!len++)
+			start = step;
+		if (len > best_len) {
+			best_len = len;
+			best = start;
+		}
+	}
+
+	priv->xstats.rgmii_delay_calib_n++;
+
+	if (!best_len)
+		return -EIO;
+
+	step = best + (best_len - 1) / 2;
+	ret = priv->plat->set_rgmii_delay(priv->plat->bsp_priv, step);
+	if (ret)
+		return ret;
+
+	priv->xstats.rgmii_delay_step = step;
+	priv->xstats.rgmii_delay_window = best_len;
+
+	netdev_info(priv->dev,
+		    "RGMII delay calibrated: step %u, window %u/%u (map 0x%lx)\n",
+		    step, best_len, steps, pass);
+
+	return step;
+}
+
+#define STMMAC_BENCH_PORT	9
+#define STMMAC_BENCH_MAX_FRAMES	(1 << 20)
+
+struct stmmac_bench_hdr {
+	u32 cookie;
+	u32 seq;
+	u64 tx_ns;
+} __packed;
+
+#define STMMAC_BENCH_HDR_OFF	(sizeof(struct iphdr) + sizeof(struct udphdr) + \
+				 sizeof(struct stmmachdr))
+#define STMMAC_BENCH_MIN_SIZE	(ETH_HLEN + STMMAC_BENCH_HDR_OFF + \
+				 sizeof(struct stmmac_bench_hdr))
+
+struct stmmac_bench_ctx {
+	struct packet_type pt;
+	wait_queue_head_t wq;
+	atomic_t received;
+	u32 cookie;
+	u32 frame_size;
+	u32 frames;
+	u32 depth;
+	u32 *lat;
+	u64 last_ns;
+};
+
+static int stmmac_bench_rcv(struct sk_buff *skb, struct net_device *ndev,
+			    struct packet_type *pt,
+			    struct net_device *orig_ndev)
+{
+	struct stmmac_bench_ctx *ctx = pt->af_packet_priv;
+	struct stmmac_bench_hdr _bhdr, *bhdr;
+	struct udphdr _uhdr, *uhdr;
+	struct iphdr _ihdr, *ihdr;
+	u64 now = ktime_get_ns();
+	int n;
+
+	ihdr = skb_header_pointer(skb, 0, sizeof(_ihdr), &_ihdr);
+	if (!ihdr || ihdr->ihl != 5 || ihdr->protocol != IPPROTO_UDP)
+		goto out;
+	uhdr = skb_header_pointer(skb, sizeof(*ihdr), sizeof(_uhdr), &_uhdr);
+	if (!uhdr || uhdr->dest != htons(STMMAC_BENCH_PORT))
+		goto out;
+	bhdr = skb_header_pointer(skb, STMMAC_BENCH_HDR_OFF, sizeof(_bhdr),
+				  &_bhdr);
+	if (!bhdr || bhdr->cookie != ctx->cookie)
+		goto out;
+
+	n = atomic_inc_return(&ctx->received) - 1;
+	if (n < ctx->frames)
+		ctx->lat[n] = min_t(u64, now - bhdr->tx_ns, U32_MAX);
+	WRITE_ONCE(ctx->last_ns, now);
+	wake_up(&ctx->wq);
+out:
+	kfree_skb(skb);
+	return 0;
+}
+
+static int stmmac_bench_cmp(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static u32 stmmac_bench_pct(const u32 *lat, u32 n, u32 permille)
+{
+	return lat[min_t(u32, div_u64((u64)n * permille, 1000), n - 1)];
+}
+
+static int stmmac_bench_queue(struct stmmac_priv *priv,
+			      struct stmmac_bench_ctx *ctx,
+			      struct stmmac_bench_result *res, u16 queue)
+{
+	struct stmmac_packet_attrs attr = { };
+	struct stmmac_bench_hdr *bhdr;
+	unsigned long deadline;
+	struct sk_buff *skb;
+	int ret = 0;
+	u64 start;
+	u32 n;
+
+	attr.dst = priv->dev->dev_addr;
+	attr.sport = queue;
+	attr.dport = STMMAC_BENCH_PORT;
+	attr.size = sizeof(*bhdr);
+	attr.max_size = ctx->frame_size;
+	attr.queue_mapping = queue;
+
+	/* Frames still in flight from a previous queue must not count */
+	ctx->cookie = prandom_u32();
+	atomic_set(&ctx->received, 0);
+	ctx->last_ns = 0;
+	res->frame_size = ctx->frame_size;
+
+	dev_add_pack(&ctx->pt);
+
+	start = ktime_get_ns();
+	deadline = jiffies + STMMAC_LB_TIMEOUT;
+
+	while (res->sent < ctx->frames) {
+		/* Keep at most depth frames between TX and RX */
+		if (!wait_event_timeout(ctx->wq,
+					atomic_read(&ctx->received) + ctx->depth >
+					res->sent, STMMAC_LB_TIMEOUT)) {
+			ret = -ETIMEDOUT;
+			break;
+		}
+
+		skb = stmmac_test_get_udp_skb(priv, &attr);
+		if (!skb) {
+			ret = -ENOMEM;
+			break;
+		}
+
+		bhdr = (void *)skb_network_header(skb) + STMMAC_BENCH_HDR_OFF;
+		bhdr->cookie = ctx->cookie;
+		bhdr->seq = res->sent;
+		bhdr->tx_ns = ktime_get_ns();
+
+		ret = dev_direct_xmit(skb, queue);
+		if (ret == NETDEV_TX_BUSY) {
+			/* TX ring is full, give the cleanup a chance */
+			ret = 0;
+			if (time_after(jiffies, deadline)) {
+				ret = -ETIMEDOUT;
+				break;
+			}
+			usleep_range(10, 20);
+			continue;
+		} else if (ret) {
+			ret = -EIO;
+			break;
+		}
+
+		res->sent++;
+		deadline = jiffies + STMMAC_LB_TIMEOUT;
+	}
+
+	/* Anything not back by now is accounted as lost */
+	wait_event_timeout(ctx->wq, atomic_read(&ctx->received) >= res->sent,
+			   STMMAC_LB_TIMEOUT);
+	dev_remove_pack(&ctx->pt);
+
+	n = min_t(u32, atomic_read(&ctx->received), ctx->frames);
+	res->received = n;
+	if (!n)
+		return ret;
+
+	res->duration_ns = ctx->last_ns - start;
+	sort(ctx->lat, n, sizeof(*ctx->lat), stmmac_bench_cmp, NULL);
+	res->lat_min = ctx->lat[0];
+	res->lat_p50 = stmmac_bench_pct(ctx->lat, n, 500);
+	res->lat_p90 = stmmac_bench_pct(ctx->lat, n, 900);
+	res->lat_p99 = stmmac_bench_pct(ctx->lat, n, 990);
+	res->lat_p999 = stmmac_bench_pct(ctx->lat, n, 999);
+	res->lat_max = ctx->lat[n - 1];
+
+	return ret;
+}
+
+/**
+ * stmmac_selftest_bench - loopback throughput and latency benchmark
+ * @priv: driver private structure
+ * @bench: run parameters, the per queue results are stored back into it
+ * Description: streams @bench->frames UDP frames of @bench->frame_size bytes
+ * through MAC or PHY loopback on every TX queue in turn (or only on
+ * @bench->queue if it is a valid queue index), keeping at most @bench->depth
+ * frames in flight, and records packet rate and TX to RX latency
+ * percentiles. Must be called with rtnl held and a valid link.
+ */
+int stmmac_selftest_bench(struct stmmac_priv *priv,
+			  struct stmmac_bench *bench)
+{
+	u32 queue, first = 0, last = priv->plat->tx_queues_to_use - 1;
+	struct net_device *dev = priv->dev;
+	struct stmmac_bench_ctx *ctx;
+	int ret;
+
+	if (!netif_running(dev) || !netif_carrier_ok(dev))
+		return -ENOLINK;
+	if (bench->phy_lb && !dev->phydev)
+		return -EOPNOTSUPP;
+	if (!bench->frames || bench->frames > STMMAC_BENCH_MAX_FRAMES ||
+	    !bench->depth || bench->depth > min(DMA_TX_SIZE, DMA_RX_SIZE) ||
+	    bench->frame_size > dev->mtu + ETH_HLEN)
+		return -EINVAL;
+
+	if (bench->queue <= last)
+		first = last = bench->queue;
+
+	ctx = kzalloc(sizeof(*ctx), GFP_KERNEL);
+	if (!ctx)
+		return -ENOMEM;
+
+	ctx->frame_size = max_t(u32, bench->frame_size, STMMAC_BENCH_MIN_SIZE);
+	ctx->frames = bench->frames;
+	ctx->depth = bench->depth;
+	ctx->lat = kvmalloc_array(ctx->frames, sizeof(*ctx->lat), GFP_KERNEL);
+	if (!ctx->lat) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	init_waitqueue_head(&ctx->wq);
+	ctx->pt.type = htons(ETH_P_IP);
+	ctx->pt.func = stmmac_bench_rcv;
+	ctx->pt.dev = dev;
+	ctx->pt.af_packet_priv = ctx;
+
+	memset(bench->res, 0, sizeof(bench->res));
+
+	/* Wait for queues drain */
+	msleep(200);
+
+	if (bench->phy_lb)
+		ret = phy_loopback(dev->phydev, true);
+	else
+		ret = stmmac_set_mac_loopback(priv, priv->ioaddr, true);
+	if (ret)
+		goto out_free;
+
+	for (queue = first; queue <= last; queue++) {
+		ret = stmmac_bench_queue(priv, ctx, &bench->res[queue], queue);
+		if (ret)
+			break;
+	}
+
+	if (bench->phy_lb)
+		phy_loopback(dev->phydev, false);
+	else
+		stmmac_set_mac_loopback(priv, priv->ioaddr, false);
+
+out_free:
+	kvfree(ctx->lat);
+	kfree(ctx);
+	return ret;
+}
+
 int stmmac_selftest_get_count(struct stmmac_priv *priv)
 {
 	return ARRAY_SIZE(stmmac_selftests);
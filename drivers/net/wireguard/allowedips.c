@@ -6,6 +6,8 @@
 #include "allowedips.h"
 #include "peer.h"
 
+#include <linux/hash.h>
+
 static void swap_endian(u8 *dst, const u8 *src, u8 bits)
 {
 	if (bits == 32) {
@@ -164,29 +166,79 @@ static struct allowedips_node *find_node(struct allowedips_node *trie, u8 bits,
 	return found;
 }
 
+static struct allowedips_cache_entry *
+cache_entry(struct allowedips_cache *cache, u8 bits, const void *be_ip)
+{
+	u32 hash;
+
+	if (bits == 32)
+		hash = *(const u32 *)be_ip;
+	else
+		hash = ((const u32 *)be_ip)[0] ^ ((const u32 *)be_ip)[1] ^
+		       ((const u32 *)be_ip)[2] ^ ((const u32 *)be_ip)[3];
+	return &cache->entries[hash_32(hash, ilog2(ALLOWEDIPS_CACHE_SIZE))];
+}
+
 /* Returns a strong reference to a peer */
-static struct wg_peer *lookup(struct allowedips_node __rcu *root, u8 bits,
+static struct wg_peer *lookup(struct allowedips *table,
+			      struct allowedips_node __rcu *root, u8 bits,
 			      const void *be_ip)
 {
 	/* Aligned so it can be passed to fls/fls64 */
 	u8 ip[16] __aligned(__alignof(u64));
+	struct allowedips_cache_entry *entry = NULL;
 	struct allowedips_node *node;
 	struct wg_peer *peer = NULL;
-
-	swap_endian(ip, be_ip, bits);
+	u64 gen;
 
 	rcu_read_lock_bh();
+	/* Read before walking the trie, so that an entry filled in from a
+	 * trie that is being changed is already stale once the change is
+	 * done.
+	 */
+	gen = atomic64_read_acquire(&table->cache_gen);
+	if (table->cache) {
+		struct allowedips_cache *cache = this_cpu_ptr(table->cache);
+
+		entry = cache_entry(cache, bits, be_ip);
+		if (entry->gen == gen && entry->bits == bits &&
+		    !memcmp(entry->ip, be_ip, bits / 8U)) {
+			peer = wg_peer_get_maybe_zero(entry->peer);
+			if (peer) {
+				++cache->hits;
+				goto out;
+			}
+		}
+		++cache->misses;
+	}
+
+	swap_endian(ip, be_ip, bits);
 retry:
 	node = find_node(rcu_dereference_bh(root), bits, ip);
 	if (node) {
 		peer = wg_peer_get_maybe_zero(rcu_dereference_bh(node->peer));
 		if (!peer)
 			goto retry;
+		if (entry) {
+			entry->gen = gen;
+			entry->peer = peer;
+			entry->bits = bits;
+			memcpy(entry->ip, be_ip, bits / 8U);
+		}
 	}
+out:
 	rcu_read_unlock_bh();
 	return peer;
 }
 
+/* Invalidates the lookup caches, to be called after each change of the
+ * tries, with the peers that were removed still not freed.
+ */
+static void cache_invalidate(struct allowedips *table)
+{
+	atomic64_inc_return_release(&table->cache_gen);
+}
+
 static bool node_placement(struct allowedips_node __rcu *trie, const u8 *key,
 			   u8 cidr, u8 bits, struct allowedips_node **rnode,
 			   struct mutex *lock)
@@ -285,6 +337,36 @@ void wg_allowedips_init(struct allowedips *table)
 {
 	table->root4 = table->root6 = NULL;
 	table->seq = 1;
+	table->cache = NULL;
+	atomic64_set(&table->cache_gen, 1);
+}
+
+int wg_allowedips_cache_init(struct allowedips *table)
+{
+	table->cache = alloc_percpu(struct allowedips_cache);
+	return table->cache ? 0 : -ENOMEM;
+}
+
+void wg_allowedips_cache_uninit(struct allowedips *table)
+{
+	free_percpu(table->cache);
+	table->cache = NULL;
+}
+
+void wg_allowedips_cache_stats(struct allowedips *table, u64 *hits,
+			       u64 *misses)
+{
+	int cpu;
+
+	*hits = *misses = 0;
+	if (!table->cache)
+		return;
+	for_each_possible_cpu(cpu) {
+		struct allowedips_cache *cache = per_cpu_ptr(table->cache, cpu);
+
+		*hits += READ_ONCE(cache->hits);
+		*misses += READ_ONCE(cache->misses);
+	}
 }
 
 void wg_allowedips_free(struct allowedips *table, struct mutex *lock)
@@ -294,6 +376,7 @@ void wg_allowedips_free(struct allowedips *table, struct mutex *lock)
 	++table->seq;
 	RCU_INIT_POINTER(table->root4, NULL);
 	RCU_INIT_POINTER(table->root6, NULL);
+	cache_invalidate(table);
 	if (rcu_access_pointer(old4)) {
 		struct allowedips_node *node = rcu_dereference_protected(old4,
 							lockdep_is_held(lock));
@@ -315,10 +398,13 @@ int wg_allowedips_insert_v4(struct allowedips *table, const struct in_addr *ip,
 {
 	/* Aligned so it can be passed to fls */
 	u8 key[4] __aligned(__alignof(u32));
+	int ret;
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 32);
-	return add(&table->root4, 32, key, cidr, peer, lock);
+	ret = add(&table->root4, 32, key, cidr, peer, lock);
+	cache_invalidate(table);
+	return ret;
 }
 
 int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
@@ -326,10 +412,13 @@ int wg_allowedips_insert_v6(struct allowedips *table, const struct in6_addr *ip,
 {
 	/* Aligned so it can be passed to fls64 */
 	u8 key[16] __aligned(__alignof(u64));
+	int ret;
 
 	++table->seq;
 	swap_endian(key, (const u8 *)ip, 128);
-	return add(&table->root6, 128, key, cidr, peer, lock);
+	ret = add(&table->root6, 128, key, cidr, peer, lock);
+	cache_invalidate(table);
+	return ret;
 }
 
 void wg_allowedips_remove_by_peer(struct allowedips *table,
@@ -338,6 +427,7 @@ void wg_allowedips_remove_by_peer(struct allowedips *table,
 	++table->seq;
 	walk_remove_by_peer(&table->root4, peer, lock);
 	walk_remove_by_peer(&table->root6, peer, lock);
+	cache_invalidate(table);
 }
 
 int wg_allowedips_read_node(struct allowedips_node *node, u8 ip[16], u8 *cidr)
@@ -357,9 +447,10 @@ struct wg_peer *wg_allowedips_lookup_dst(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->daddr);
+		return lookup(table, table->root4, 32, &ip_hdr(skb)->daddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->daddr);
+		return lookup(table, table->root6, 128,
+			      &ipv6_hdr(skb)->daddr);
 	return NULL;
 }
 
@@ -368,9 +459,10 @@ struct wg_peer *wg_allowedips_lookup_src(struct allowedips *table,
 					 struct sk_buff *skb)
 {
 	if (skb->protocol == htons(ETH_P_IP))
-		return lookup(table->root4, 32, &ip_hdr(skb)->saddr);
+		return lookup(table, table->root4, 32, &ip_hdr(skb)->saddr);
 	else if (skb->protocol == htons(ETH_P_IPV6))
-		return lookup(table->root6, 128, &ipv6_hdr(skb)->saddr);
+		return lookup(table, table->root6, 128,
+			      &ipv6_hdr(skb)->saddr);
 	return NULL;
 }
 
@@ -29,13 +29,36 @@ struct allowedips_node {
 	};
 };
 
+/* Small direct mapped cache of recent lookups, one per CPU. Entries are
+ * only valid for the generation of the table they were looked up in.
+ */
+enum { ALLOWEDIPS_CACHE_SIZE = 64 };
+
+struct allowedips_cache_entry {
+	u64 gen;
+	struct wg_peer *peer;
+	u8 ip[16] __aligned(__alignof(u64));
+	u8 bits;
+};
+
+struct allowedips_cache {
+	struct allowedips_cache_entry entries[ALLOWEDIPS_CACHE_SIZE];
+	u64 hits, misses;
+};
+
 struct allowedips {
 	struct allowedips_node __rcu *root4;
 	struct allowedips_node __rcu *root6;
 	u64 seq;
+	struct allowedips_cache __percpu *cache;
+	atomic64_t cache_gen;
 };
 
 void wg_allowedips_init(struct allowedips *table);
+int wg_allowedips_cache_init(struct allowedips *table);
+void wg_allowedips_cache_uninit(struct allowedips *table);
+void wg_allowedips_cache_stats(struct allowedips *table, u64 *hits,
+			       u64 *misses);
 void wg_allowedips_free(struct allowedips *table, struct mutex *mutex);
 int wg_allowedips_insert_v4(struct allowedips *table, const struct in_addr *ip,
 			    u8 cidr, struct wg_peer *peer, struct mutex *lock);
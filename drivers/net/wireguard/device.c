@@ -240,6 +240,7 @@ static void wg_destruct(struct net_device *dev)
 	skb_queue_purge(&wg->incoming_handshakes);
 	free_percpu(dev->tstats);
 	free_percpu(wg->incoming_handshakes_worker);
+	wg_allowedips_cache_uninit(&wg->peer_allowedips);
 	if (wg->have_creating_net_ref)
 		put_net(wg->creating_net);
 	kvfree(wg->index_hashtable);
@@ -314,11 +315,14 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	if (!dev->tstats)
 		goto err_free_index_hashtable;
 
+	if (wg_allowedips_cache_init(&wg->peer_allowedips))
+		goto err_free_tstats;
+
 	wg->incoming_handshakes_worker =
 		wg_packet_percpu_multicore_worker_alloc(
 				wg_packet_handshake_receive_worker, wg);
 	if (!wg->incoming_handshakes_worker)
-		goto err_free_tstats;
+		goto err_free_allowedips_cache;
 
 	wg->handshake_receive_wq = alloc_workqueue("wg-kex-%s",
 			WQ_CPU_INTENSIVE | WQ_FREEZABLE, 0, dev->name);
@@ -377,6 +381,8 @@ static int wg_newlink(struct net *src_net, struct net_device *dev,
 	destroy_workqueue(wg->handshake_receive_wq);
 err_free_incoming_handshakes:
 	free_percpu(wg->incoming_handshakes_worker);
+err_free_allowedips_cache:
+	wg_allowedips_cache_uninit(&wg->peer_allowedips);
 err_free_tstats:
 	free_percpu(dev->tstats);
 err_free_index_hashtable:
@@ -27,7 +27,9 @@ static const struct nla_policy device_policy[WGDEVICE_A_MAX + 1] = {
 	[WGDEVICE_A_FLAGS]		= { .type = NLA_U32 },
 	[WGDEVICE_A_LISTEN_PORT]	= { .type = NLA_U16 },
 	[WGDEVICE_A_FWMARK]		= { .type = NLA_U32 },
-	[WGDEVICE_A_PEERS]		= { .type = NLA_NESTED }
+	[WGDEVICE_A_PEERS]		= { .type = NLA_NESTED },
+	[WGDEVICE_A_ALLOWEDIPS_CACHE_HITS] = { .type = NLA_U64 },
+	[WGDEVICE_A_ALLOWEDIPS_CACHE_MISSES] = { .type = NLA_U64 }
 };
 
 static const struct nla_policy peer_policy[WGPEER_A_MAX + 1] = {
@@ -229,11 +231,19 @@ static int wg_get_device_dump(struct sk_buff *skb, struct netlink_callback *cb)
 	genl_dump_check_consistent(cb, hdr);
 
 	if (!ctx->next_peer) {
+		u64 cache_hits, cache_misses;
+
+		wg_allowedips_cache_stats(&wg->peer_allowedips, &cache_hits,
+					  &cache_misses);
 		if (nla_put_u16(skb, WGDEVICE_A_LISTEN_PORT,
 				wg->incoming_port) ||
 		    nla_put_u32(skb, WGDEVICE_A_FWMARK, wg->fwmark) ||
 		    nla_put_u32(skb, WGDEVICE_A_IFINDEX, wg->dev->ifindex) ||
-		    nla_put_string(skb, WGDEVICE_A_IFNAME, wg->dev->name))
+		    nla_put_string(skb, WGDEVICE_A_IFNAME, wg->dev->name) ||
+		    nla_put_u64_64bit(skb, WGDEVICE_A_ALLOWEDIPS_CACHE_HITS,
+				      cache_hits, WGDEVICE_A_UNSPEC) ||
+		    nla_put_u64_64bit(skb, WGDEVICE_A_ALLOWEDIPS_CACHE_MISSES,
+				      cache_misses, WGDEVICE_A_UNSPEC))
 			goto out;
 
 		down_read(&wg->static_identity.lock);
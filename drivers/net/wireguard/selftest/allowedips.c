@@ -398,7 +398,7 @@ static __init bool randomized_test(void)
 
 	for (i = 0; i < NUM_QUERIES; ++i) {
 		prandom_bytes(ip, 4);
-		if (lookup(t.root4, 32, ip) !=
+		if (lookup(&t, t.root4, 32, ip) !=
 		    horrible_allowedips_lookup_v4(&h, (struct in_addr *)ip)) {
 			pr_err("allowedips random self-test: FAIL\n");
 			goto free;
@@ -407,7 +407,7 @@ static __init bool randomized_test(void)
 
 	for (i = 0; i < NUM_QUERIES; ++i) {
 		prandom_bytes(ip, 16);
-		if (lookup(t.root6, 128, ip) !=
+		if (lookup(&t, t.root6, 128, ip) !=
 		    horrible_allowedips_lookup_v6(&h, (struct in6_addr *)ip)) {
 			pr_err("allowedips random self-test: FAIL\n");
 			goto free;
@@ -477,13 +477,15 @@ static __init struct wg_peer *init_peer(void)
 	} while (0)
 
 #define test(version, mem, ipa, ipb, ipc, ipd) do {                          \
-		bool _s = lookup(t.root##version, (version) == 4 ? 32 : 128, \
+		bool _s = lookup(&t, t.root##version,                        \
+				 (version) == 4 ? 32 : 128,                  \
 				 ip##version(ipa, ipb, ipc, ipd)) == (mem);  \
 		maybe_fail();                                                \
 	} while (0)
 
 #define test_negative(version, mem, ipa, ipb, ipc, ipd) do {                 \
-		bool _s = lookup(t.root##version, (version) == 4 ? 32 : 128, \
+		bool _s = lookup(&t, t.root##version,                        \
+				 (version) == 4 ? 32 : 128,                  \
 				 ip##version(ipa, ipb, ipc, ipd)) != (mem);  \
 		maybe_fail();                                                \
 	} while (0)
@@ -239,6 +239,50 @@ void wg_packet_send_keepalive(struct wg_peer *peer)
 	wg_packet_send_staged_packets(peer);
 }
 
+/* Largest UDP payload of a batch, so that it fits the IP length fields */
+#define WG_GSO_MAX_SIZE (GSO_MAX_SIZE - SKB_HEADER_LEN)
+
+/* Packets of a bulk flow are all padded to the same length. Chain runs of
+ * such packets on the first one's frag_list and send them as one UDP GSO
+ * skb, so that routing, netfilter and the qdisc are walked once per run.
+ * GSO cuts the run back into the original packets, in software or in the
+ * NIC.
+ */
+static void wg_packet_gso_batch(struct sk_buff *head)
+{
+	struct sk_buff **tail = &skb_shinfo(head)->frag_list;
+	unsigned int mss = head->len, segs = 1;
+	struct sk_buff *skb;
+
+	if (skb_is_nonlinear(head))
+		return;
+
+	while ((skb = head->next) && segs < UDP_MAX_SEGMENTS &&
+	       skb->len == mss && !skb_is_nonlinear(skb) &&
+	       PACKET_CB(skb)->ds == PACKET_CB(head)->ds &&
+	       head->len + mss <= WG_GSO_MAX_SIZE) {
+		head->next = skb->next;
+		skb_mark_not_on_list(skb);
+		*tail = skb;
+		tail = &skb->next;
+		head->len += mss;
+		head->data_len += mss;
+		head->truesize += skb->truesize;
+		++segs;
+	}
+
+	if (segs == 1)
+		return;
+
+	skb_shinfo(head)->gso_size = mss;
+	skb_shinfo(head)->gso_type = SKB_GSO_UDP_L4;
+	skb_shinfo(head)->gso_segs = segs;
+	/* The UDP header is pushed right in front of the message. */
+	head->ip_summed = CHECKSUM_PARTIAL;
+	head->csum_start = skb_headroom(head) - sizeof(struct udphdr);
+	head->csum_offset = offsetof(struct udphdr, check);
+}
+
 static void wg_packet_create_data_done(struct sk_buff *first,
 				       struct wg_peer *peer)
 {
@@ -247,8 +291,11 @@ static void wg_packet_create_data_done(struct sk_buff *first,
 
 	wg_timers_any_authenticated_packet_traversal(peer);
 	wg_timers_any_authenticated_packet_sent(peer);
-	skb_list_walk_safe(first, skb, next) {
+	for (skb = first; skb; skb = next) {
 		is_keepalive = skb->len == message_data_len(0);
+		if (!is_keepalive)
+			wg_packet_gso_batch(skb);
+		next = skb->next;
 		if (likely(!wg_socket_send_skb_to_peer(peer, skb,
 				PACKET_CB(skb)->ds) && !is_keepalive))
 			data_sent = true;
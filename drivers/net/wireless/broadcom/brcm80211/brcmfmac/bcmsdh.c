@@ -749,6 +749,7 @@ void brcmf_sdiod_sgtable_alloc(struct brcmf_sdio_dev *sdiodev)
 	struct sdio_func *func;
 	struct mmc_host *host;
 	uint max_blocks;
+	uint txglomsz;
 	uint nents;
 	int err;
 
@@ -765,11 +766,17 @@ void brcmf_sdiod_sgtable_alloc(struct brcmf_sdio_dev *sdiodev)
 	if (!sdiodev->sg_support)
 		return;
 
-	nents = max_t(uint, BRCMF_DEFAULT_RXGLOM_SIZE,
-		      sdiodev->settings->bus.sdio.txglomsz);
-	nents += (nents >> 4) + 1;
+	/* A tx frame may take a second entry for its tail padding, keep a
+	 * full glom within one request of the host.
+	 */
+	txglomsz = min_t(uint, sdiodev->settings->bus.sdio.txglomsz,
+			 sdiodev->max_segment_count / 2);
+	if (txglomsz < sdiodev->settings->bus.sdio.txglomsz)
+		brcmf_dbg(SDIO, "txglomsz limited to %u by host\n", txglomsz);
 
-	WARN_ON(nents > sdiodev->max_segment_count);
+	nents = max_t(uint, BRCMF_DEFAULT_RXGLOM_SIZE, 2 * txglomsz);
+	nents += (nents >> 4) + 1;
+	nents = min_t(uint, nents, sdiodev->max_segment_count);
 
 	brcmf_dbg(TRACE, "nents=%d\n", nents);
 	err = sg_alloc_table(&sdiodev->sgtable, nents, GFP_KERNEL);
@@ -778,7 +785,7 @@ void brcmf_sdiod_sgtable_alloc(struct brcmf_sdio_dev *sdiodev)
 		sdiodev->sg_support = false;
 	}
 
-	sdiodev->txglomsz = sdiodev->settings->bus.sdio.txglomsz;
+	sdiodev->txglomsz = txglomsz;
 }
 
 #ifdef CONFIG_PM_SLEEP
@@ -61,6 +61,10 @@ struct brcmf_bus_dcmd {
  * @get_ramsize: obtain size of device memory.
  * @get_memdump: obtain device memory dump in provided buffer.
  * @get_fwname: obtain firmware name.
+ * @txburst_start: announce that a series of @txdata calls follows, so the
+ *	bus may hold off sending until @txburst_end. Returns how many frames
+ *	the bus can combine into one transfer, 0 for no limit (optional).
+ * @txburst_end: send what was queued since @txburst_start (optional).
  *
  * This structure provides an abstract interface towards the
  * bus specific driver. For control messages to common driver
@@ -81,6 +85,8 @@ struct brcmf_bus_ops {
 			  unsigned char *fw_name);
 	void (*debugfs_create)(struct device *dev);
 	int (*reset)(struct device *dev);
+	uint (*txburst_start)(struct device *dev);
+	void (*txburst_end)(struct device *dev);
 };
 
 
@@ -244,6 +250,20 @@ int brcmf_bus_reset(struct brcmf_bus *bus)
 	return bus->ops->reset(bus->dev);
 }
 
+static inline uint brcmf_bus_txburst_start(struct brcmf_bus *bus)
+{
+	if (!bus->ops->txburst_start)
+		return 0;
+
+	return bus->ops->txburst_start(bus->dev);
+}
+
+static inline void brcmf_bus_txburst_end(struct brcmf_bus *bus)
+{
+	if (bus->ops->txburst_end)
+		bus->ops->txburst_end(bus->dev);
+}
+
 /*
  * interface functions from common layer
  */
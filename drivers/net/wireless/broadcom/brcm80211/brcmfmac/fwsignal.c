@@ -458,6 +458,9 @@ struct brcmf_fws_macdesc_table {
 	struct brcmf_fws_mac_descriptor other;
 };
 
+/* tx burst sizes are counted in power of two buckets: 1, 2-3, ... 16+ */
+#define BRCMF_FWS_TX_BURST_HIST		5
+
 struct brcmf_fws_stats {
 	u32 tlv_parse_failed;
 	u32 tlv_invalid_type;
@@ -484,6 +487,9 @@ struct brcmf_fws_stats {
 	u32 txs_host_tossed;
 	u32 bus_flow_block;
 	u32 fws_flow_block;
+	u32 tx_bursts;
+	u32 tx_burst_hist[BRCMF_FWS_TX_BURST_HIST];
+	u32 tx_burst_largest;
 };
 
 struct brcmf_fws_info {
@@ -510,6 +516,8 @@ struct brcmf_fws_info {
 	bool creditmap_received;
 	u8 mode;
 	bool avoid_queueing;
+	uint burst_max;
+	u32 burst_pkts;
 };
 
 /*
@@ -2199,6 +2207,38 @@ void brcmf_fws_del_interface(struct brcmf_if *ifp)
 	brcmf_fws_unlock(fws);
 }
 
+static void brcmf_fws_txburst_begin(struct brcmf_fws_info *fws)
+{
+	fws->burst_max = brcmf_bus_txburst_start(fws->drvr->bus_if);
+	fws->burst_pkts = 0;
+}
+
+static void brcmf_fws_txburst_end(struct brcmf_fws_info *fws)
+{
+	struct brcmf_fws_stats *stats = &fws->stats;
+	u32 pkts = fws->burst_pkts;
+	int bucket;
+
+	brcmf_bus_txburst_end(fws->drvr->bus_if);
+	if (!pkts)
+		return;
+
+	bucket = min_t(int, fls(pkts), BRCMF_FWS_TX_BURST_HIST) - 1;
+	stats->tx_bursts++;
+	stats->tx_burst_hist[bucket]++;
+	if (pkts > stats->tx_burst_largest)
+		stats->tx_burst_largest = pkts;
+}
+
+/* Close the burst once the bus holds as many frames as it can combine */
+static void brcmf_fws_txburst_add(struct brcmf_fws_info *fws)
+{
+	if (++fws->burst_pkts == fws->burst_max) {
+		brcmf_fws_txburst_end(fws);
+		brcmf_fws_txburst_begin(fws);
+	}
+}
+
 static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 {
 	struct brcmf_fws_info *fws;
@@ -2213,6 +2253,7 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 	drvr = fws->drvr;
 
 	brcmf_fws_lock(fws);
+	brcmf_fws_txburst_begin(fws);
 	for (fifo = BRCMF_FWS_FIFO_BCMC; fifo >= 0 && !fws->bus_flow_blocked;
 	     fifo--) {
 		if (!brcmf_fws_fc_active(fws)) {
@@ -2231,6 +2272,8 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 					brcmf_txfinalize(brcmf_get_ifp(drvr,
 								       ifidx),
 							 skb, false);
+				else
+					brcmf_fws_txburst_add(fws);
 				if (fws->bus_flow_blocked)
 					break;
 			}
@@ -2245,6 +2288,7 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 			fws->fifo_credit[fifo]--;
 			if (brcmf_fws_commit_skb(fws, fifo, skb))
 				break;
+			brcmf_fws_txburst_add(fws);
 			if (fws->bus_flow_blocked)
 				break;
 		}
@@ -2259,11 +2303,13 @@ static void brcmf_fws_dequeue_worker(struct work_struct *worker)
 				}
 				if (brcmf_fws_commit_skb(fws, fifo, skb))
 					break;
+				brcmf_fws_txburst_add(fws);
 				if (fws->bus_flow_blocked)
 					break;
 			}
 		}
 	}
+	brcmf_fws_txburst_end(fws);
 	brcmf_fws_unlock(fws);
 }
 
@@ -2295,6 +2341,9 @@ static int brcmf_debugfs_fws_stats_read(struct seq_file *seq, void *data)
 		   "txs_host_tossed:   %u\n"
 		   "bus_flow_block:    %u\n"
 		   "fws_flow_block:    %u\n"
+		   "tx_bursts:         %u\n"
+		   "tx_burst_largest:  %u\n"
+		   "tx_burst_sizes:    1:%u 2-3:%u 4-7:%u 8-15:%u 16+:%u\n"
 		   "send_pkts:         BK:%u BE:%u VO:%u VI:%u BCMC:%u\n"
 		   "requested_sent:    BK:%u BE:%u VO:%u VI:%u BCMC:%u\n",
 		   fwstats->header_pulls,
@@ -2318,6 +2367,11 @@ static int brcmf_debugfs_fws_stats_read(struct seq_file *seq, void *data)
 		   fwstats->txs_host_tossed,
 		   fwstats->bus_flow_block,
 		   fwstats->fws_flow_block,
+		   fwstats->tx_bursts,
+		   fwstats->tx_burst_largest,
+		   fwstats->tx_burst_hist[0], fwstats->tx_burst_hist[1],
+		   fwstats->tx_burst_hist[2], fwstats->tx_burst_hist[3],
+		   fwstats->tx_burst_hist[4],
 		   fwstats->send_pkts[0], fwstats->send_pkts[1],
 		   fwstats->send_pkts[2], fwstats->send_pkts[3],
 		   fwstats->send_pkts[4],
@@ -16,6 +16,7 @@
 #include <linux/mmc/sdio_ids.h>
 #include <linux/mmc/sdio_func.h>
 #include <linux/mmc/card.h>
+#include <linux/mmc/host.h>
 #include <linux/semaphore.h>
 #include <linux/firmware.h>
 #include <linux/module.h>
@@ -519,6 +520,7 @@ struct brcmf_sdio {
 
 	u8 tx_hdrlen;		/* sdio bus header length for tx packet */
 	bool txglom;		/* host tx glomming enable flag */
+	bool txburst;		/* dpc is kicked at the end of a tx burst */
 	u16 head_align;		/* buffer pointer alignment */
 	u16 sgentry_align;	/* scatter-gather buffer alignment */
 };
@@ -2804,10 +2806,32 @@ static int brcmf_sdio_bus_txdata(struct device *dev, struct sk_buff *pkt)
 		qcount[prec] = pktq_plen(&bus->txq, prec);
 #endif
 
-	brcmf_sdio_trigger_dpc(bus);
+	if (!READ_ONCE(bus->txburst))
+		brcmf_sdio_trigger_dpc(bus);
 	return ret;
 }
 
+/* Let frames pile up in txq so the dpc can send them as one glom */
+static uint brcmf_sdio_bus_txburst_start(struct device *dev)
+{
+	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
+	struct brcmf_sdio_dev *sdiodev = bus_if->bus_priv.sdio;
+	struct brcmf_sdio *bus = sdiodev->bus;
+
+	WRITE_ONCE(bus->txburst, true);
+	return bus->txglom ? sdiodev->txglomsz : 1;
+}
+
+static void brcmf_sdio_bus_txburst_end(struct device *dev)
+{
+	struct brcmf_bus *bus_if = dev_get_drvdata(dev);
+	struct brcmf_sdio *bus = bus_if->bus_priv.sdio->bus;
+
+	WRITE_ONCE(bus->txburst, false);
+	if (pktq_len(&bus->txq))
+		brcmf_sdio_trigger_dpc(bus);
+}
+
 #ifdef DEBUG
 #define CONSOLE_LINE_MAX	192
 
@@ -3512,9 +3536,7 @@ static int brcmf_sdio_bus_preinit(struct device *dev)
 					   sizeof(u32));
 	} else {
 		/* otherwise, set txglomalign */
-		value = sdiodev->settings->bus.sdio.sd_sgentry_align;
-		/* SDIO ADMA requires at least 32 bit alignment */
-		value = max_t(u32, value, ALIGNMENT);
+		value = bus->sgentry_align;
 		err = brcmf_iovar_data_set(dev, "bus:txglomalign", &value,
 					   sizeof(u32));
 	}
@@ -3963,6 +3985,10 @@ brcmf_sdio_probe_attach(struct brcmf_sdio *bus)
 	if (sdiodev->settings->bus.sdio.sd_sgentry_align > ALIGNMENT)
 		bus->sgentry_align =
 				sdiodev->settings->bus.sdio.sd_sgentry_align;
+	/* hosts that only chain whole blocks would otherwise bounce gloms */
+	if (sdiodev->func2->card->host->caps2 & MMC_CAP2_SG_BLOCK_ALIGN)
+		bus->sgentry_align = max_t(u16, bus->sgentry_align,
+					   sdiodev->func2->cur_blksize);
 
 	/* allocate scatter-gather table. sg support
 	 * will be disabled upon allocation failure.
@@ -4110,7 +4136,9 @@ static const struct brcmf_bus_ops brcmf_sdio_bus_ops = {
 	.get_ramsize = brcmf_sdio_bus_get_ramsize,
 	.get_memdump = brcmf_sdio_bus_get_memdump,
 	.get_fwname = brcmf_sdio_get_fwname,
-	.debugfs_create = brcmf_sdio_debugfs_create
+	.debugfs_create = brcmf_sdio_debugfs_create,
+	.txburst_start = brcmf_sdio_bus_txburst_start,
+	.txburst_end = brcmf_sdio_bus_txburst_end
 };
 
 #define BRCMF_SDIO_FW_CODE	0
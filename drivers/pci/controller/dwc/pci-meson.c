@@ -7,6 +7,7 @@
  */
 
 #include <linux/clk.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/gpio/consumer.h>
 #include <linux/of_device.h>
@@ -29,6 +30,12 @@
 #define LINK_CAPABLE_MASK		GENMASK(21, 16)
 #define LINK_CAPABLE_X1			BIT(16)
 
+#define PCIE_ACK_F_ASPM_CTRL_OFF	(PLR_OFFSET + 0x0c)
+#define L1_ENTRANCE_LAT_SHIFT		27
+#define L1_ENTRANCE_LAT_MASK		GENMASK(29, 27)
+#define L1_ENTRANCE_LAT_MAX		6
+#define ENTER_ASPM			BIT(30)
+
 #define PCIE_GEN2_CTRL_OFF		(PLR_OFFSET + 0x10c)
 #define NUM_OF_LANES_MASK		GENMASK(12, 8)
 #define NUM_OF_LANES_X1			BIT(8)
@@ -62,10 +69,26 @@
 #define PCIE_CFG_STATUS17		0x44
 #define PM_CURRENT_STATE(x)		(((x) >> 7) & 0x1)
 
+/* DWC RAS DES vendor specific capability, event counters */
+#define DWC_VSEC_ID_RAS_DES		0x2
+#define RAS_DES_EVENT_CNTR_CTRL		0x8
+#define RAS_DES_EVENT_CNTR_DATA		0xc
+#define EVENT_COUNTER_ALL_CLEAR		0x3
+#define EVENT_COUNTER_ENABLE_ALL	0x7
+#define EVENT_COUNTER_ENABLE_SHIFT	2
+#define EVENT_COUNTER_EVENT_SEL_MASK	GENMASK(7, 0)
+#define EVENT_COUNTER_EVENT_SEL_SHIFT	16
+#define EVENT_COUNTER_EVENT_L1		0x5
+#define EVENT_COUNTER_EVENT_L1_1	0x7
+#define EVENT_COUNTER_EVENT_L1_2	0x8
+#define EVENT_COUNTER_GROUP_SEL_SHIFT	24
+#define EVENT_COUNTER_GROUP_5		0x5
+
 #define WAIT_LINKUP_TIMEOUT		4000
 #define PORT_CLK_RATE			100000000UL
 #define MAX_PAYLOAD_SIZE		256
 #define MAX_READ_REQ_SIZE		256
+#define ASPM_L1_ENTRANCE_LAT_US		8
 #define PCIE_RESET_DELAY		500
 #define PCIE_SHARED_RESET		1
 #define PCIE_NORMAL_RESET		0
@@ -100,6 +123,9 @@ struct meson_pcie {
 	struct meson_pcie_rc_reset mrst;
 	struct gpio_desc *reset_gpio;
 	struct phy *phy;
+	u32 aspm_l1_enter_lat;
+	u16 ras_des_cap;
+	struct dentry *debugfs;
 };
 
 static struct reset_control *meson_pcie_get_reset(struct meson_pcie *mp,
@@ -457,6 +483,61 @@ static int meson_pcie_link_up(struct dw_pcie *pci)
 	return 0;
 }
 
+static void meson_pcie_set_l1_entrance_lat(struct meson_pcie *mp)
+{
+	u32 val;
+
+	/*
+	 * The link only goes to L1 once it has been idle for the entrance
+	 * latency, so bursts of I/O are served from L0. L1.1/L1.2 are then
+	 * entered from L1 as allowed by the ASPM policy.
+	 */
+	val = meson_elb_readl(mp, PCIE_ACK_F_ASPM_CTRL_OFF);
+	val &= ~L1_ENTRANCE_LAT_MASK;
+	val |= mp->aspm_l1_enter_lat << L1_ENTRANCE_LAT_SHIFT;
+	val |= ENTER_ASPM;
+	meson_elb_writel(mp, val, PCIE_ACK_F_ASPM_CTRL_OFF);
+}
+
+static u16 meson_pcie_find_ras_des(struct meson_pcie *mp)
+{
+	struct dw_pcie *pci = &mp->pci;
+	int ttl = (PCI_CFG_SPACE_EXP_SIZE - PCI_CFG_SPACE_SIZE) / 8;
+	u16 pos = PCI_CFG_SPACE_SIZE;
+	u32 header;
+
+	while (pos >= PCI_CFG_SPACE_SIZE && ttl--) {
+		header = dw_pcie_readl_dbi(pci, pos);
+		if (!header)
+			break;
+
+		if (PCI_EXT_CAP_ID(header) == PCI_EXT_CAP_ID_VNDR &&
+		    PCI_VNDR_HEADER_ID(dw_pcie_readl_dbi(pci, pos +
+				       PCI_VNDR_HEADER)) == DWC_VSEC_ID_RAS_DES)
+			return pos;
+
+		pos = PCI_EXT_CAP_NEXT(header);
+	}
+
+	return 0;
+}
+
+static void meson_pcie_init_aspm(struct meson_pcie *mp)
+{
+	u32 val;
+
+	meson_pcie_set_l1_entrance_lat(mp);
+
+	mp->ras_des_cap = meson_pcie_find_ras_des(mp);
+	if (!mp->ras_des_cap)
+		return;
+
+	/* Enable the L1 and L1 substates entry counters */
+	val = EVENT_COUNTER_ENABLE_ALL << EVENT_COUNTER_ENABLE_SHIFT;
+	val |= EVENT_COUNTER_GROUP_5 << EVENT_COUNTER_GROUP_SEL_SHIFT;
+	meson_elb_writel(mp, val, mp->ras_des_cap + RAS_DES_EVENT_CNTR_CTRL);
+}
+
 static int meson_pcie_host_init(struct pcie_port *pp)
 {
 	struct dw_pcie *pci = to_dw_pcie_from_pp(pp);
@@ -467,15 +548,81 @@ static int meson_pcie_host_init(struct pcie_port *pp)
 	if (ret)
 		return ret;
 
+	meson_pcie_init_aspm(mp);
+
 	meson_pcie_enable_interrupts(mp);
 
 	return 0;
 }
 
+static int meson_pcie_find_mpss(struct pci_dev *dev, void *data)
+{
+	u8 *mpss = data;
+
+	if (pci_is_pcie(dev))
+		*mpss = min_t(u8, *mpss, dev->pcie_mpss);
+
+	return 0;
+}
+
+static int meson_pcie_set_mps(struct pci_dev *dev, void *data)
+{
+	int mps = *(int *)data;
+
+	if (!pci_is_pcie(dev))
+		return 0;
+
+	if (pcie_set_mps(dev, mps))
+		pci_warn(dev, "failed to set MPS to %d\n", mps);
+
+	/* Let endpoints read at least a full payload per request */
+	if (pci_pcie_type(dev) == PCI_EXP_TYPE_ENDPOINT &&
+	    pcie_get_readrq(dev) < mps)
+		pcie_set_readrq(dev, mps);
+
+	return 0;
+}
+
+static void meson_pcie_scan_bus(struct pcie_port *pp)
+{
+	struct pci_bus *child;
+
+	/*
+	 * The host init only programs a safe default payload size for the
+	 * root port. Now that the devices are known, use the largest payload
+	 * supported by every device of each hierarchy.
+	 */
+	list_for_each_entry(child, &pp->root_bus->children, node) {
+		struct pci_dev *bridge = child->self;
+		u8 mpss;
+		int mps;
+
+		if (!bridge || !pci_is_pcie(bridge))
+			continue;
+
+		mpss = bridge->pcie_mpss;
+		pci_walk_bus(child, meson_pcie_find_mpss, &mpss);
+		mps = 128 << mpss;
+
+		meson_pcie_set_mps(bridge, &mps);
+		pci_walk_bus(child, meson_pcie_set_mps, &mps);
+
+		pci_info(bridge, "Max Payload Size set to %d\n",
+			 pcie_get_mps(bridge));
+	}
+}
+
+static void meson_pcie_set_num_vectors(struct pcie_port *pp)
+{
+	pp->num_vectors = MAX_MSI_IRQS;
+}
+
 static const struct dw_pcie_host_ops meson_pcie_host_ops = {
 	.rd_own_conf = meson_pcie_rd_own_conf,
 	.wr_own_conf = meson_pcie_wr_own_conf,
 	.host_init = meson_pcie_host_init,
+	.scan_bus = meson_pcie_scan_bus,
+	.set_num_vectors = meson_pcie_set_num_vectors,
 };
 
 static int meson_add_pcie_port(struct meson_pcie *mp,
@@ -510,11 +657,102 @@ static const struct dw_pcie_ops dw_pcie_ops = {
 	.link_up = meson_pcie_link_up,
 };
 
+#if defined(CONFIG_DEBUG_FS)
+static u32 meson_pcie_event_counter(struct meson_pcie *mp, u32 event)
+{
+	u32 reg = mp->ras_des_cap + RAS_DES_EVENT_CNTR_CTRL;
+	u32 val;
+
+	val = meson_elb_readl(mp, reg);
+	val &= ~(EVENT_COUNTER_EVENT_SEL_MASK << EVENT_COUNTER_EVENT_SEL_SHIFT);
+	val |= EVENT_COUNTER_GROUP_5 << EVENT_COUNTER_GROUP_SEL_SHIFT;
+	val |= event << EVENT_COUNTER_EVENT_SEL_SHIFT;
+	val |= EVENT_COUNTER_ENABLE_ALL << EVENT_COUNTER_ENABLE_SHIFT;
+	meson_elb_writel(mp, val, reg);
+
+	return meson_elb_readl(mp, mp->ras_des_cap + RAS_DES_EVENT_CNTR_DATA);
+}
+
+static int meson_pcie_aspm_state_cnt(struct seq_file *s, void *data)
+{
+	struct meson_pcie *mp = dev_get_drvdata(s->private);
+	u32 state12 = meson_cfg_readl(mp, PCIE_CFG_STATUS12);
+	u32 val;
+
+	seq_printf(s, "LTSSM state : 0x%02x\n", (state12 >> 10) & 0x1f);
+	seq_printf(s, "L1 entrance latency : %u us\n",
+		   1 << mp->aspm_l1_enter_lat);
+
+	if (!mp->ras_des_cap) {
+		seq_puts(s, "Event counters not supported\n");
+		return 0;
+	}
+
+	/* Every L1 entry is paid back with one exit latency */
+	seq_printf(s, "Link L1 entry count : %u\n",
+		   meson_pcie_event_counter(mp, EVENT_COUNTER_EVENT_L1));
+	seq_printf(s, "Link L1.1 entry count : %u\n",
+		   meson_pcie_event_counter(mp, EVENT_COUNTER_EVENT_L1_1));
+	seq_printf(s, "Link L1.2 entry count : %u\n",
+		   meson_pcie_event_counter(mp, EVENT_COUNTER_EVENT_L1_2));
+
+	/* Clear all counters */
+	meson_elb_writel(mp, EVENT_COUNTER_ALL_CLEAR,
+			 mp->ras_des_cap + RAS_DES_EVENT_CNTR_CTRL);
+
+	/* Re-enable counting */
+	val = EVENT_COUNTER_ENABLE_ALL << EVENT_COUNTER_ENABLE_SHIFT;
+	val |= EVENT_COUNTER_GROUP_5 << EVENT_COUNTER_GROUP_SEL_SHIFT;
+	meson_elb_writel(mp, val, mp->ras_des_cap + RAS_DES_EVENT_CNTR_CTRL);
+
+	return 0;
+}
+
+static int meson_pcie_l1_lat_get(void *data, u64 *val)
+{
+	struct meson_pcie *mp = data;
+
+	*val = 1 << mp->aspm_l1_enter_lat;
+
+	return 0;
+}
+
+static int meson_pcie_l1_lat_set(void *data, u64 val)
+{
+	struct meson_pcie *mp = data;
+
+	if (!val)
+		return -EINVAL;
+
+	mp->aspm_l1_enter_lat = min_t(u32, ilog2(val), L1_ENTRANCE_LAT_MAX);
+	meson_pcie_set_l1_entrance_lat(mp);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(meson_pcie_l1_lat_fops, meson_pcie_l1_lat_get,
+			 meson_pcie_l1_lat_set, "%llu\n");
+
+static void meson_pcie_init_debugfs(struct meson_pcie *mp)
+{
+	struct device *dev = mp->pci.dev;
+
+	mp->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+
+	debugfs_create_devm_seqfile(dev, "aspm_state_cnt", mp->debugfs,
+				    meson_pcie_aspm_state_cnt);
+	debugfs_create_file_unsafe("aspm_l1_entrance_latency_us", 0600,
+				   mp->debugfs, mp, &meson_pcie_l1_lat_fops);
+}
+#else
+static inline void meson_pcie_init_debugfs(struct meson_pcie *mp) { }
+#endif
+
 static int meson_pcie_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct dw_pcie *pci;
 	struct meson_pcie *mp;
+	u32 val;
 	int ret;
 
 	mp = devm_kzalloc(dev, sizeof(*mp), GFP_KERNEL);
@@ -567,6 +805,13 @@ static int meson_pcie_probe(struct platform_device *pdev)
 		goto err_phy;
 	}
 
+	/* idle time before the link may enter L1, 1us to 64us */
+	if (of_property_read_u32(dev->of_node,
+				 "amlogic,aspm-l1-entrance-latency-us", &val) ||
+	    !val)
+		val = ASPM_L1_ENTRANCE_LAT_US;
+	mp->aspm_l1_enter_lat = min_t(u32, ilog2(val), L1_ENTRANCE_LAT_MAX);
+
 	platform_set_drvdata(pdev, mp);
 
 	ret = meson_add_pcie_port(mp, pdev);
@@ -575,6 +820,8 @@ static int meson_pcie_probe(struct platform_device *pdev)
 		goto err_phy;
 	}
 
+	meson_pcie_init_debugfs(mp);
+
 	return 0;
 
 err_phy:
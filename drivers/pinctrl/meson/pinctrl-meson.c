@@ -583,6 +583,77 @@ static int meson_gpio_get(struct gpio_chip *chip, unsigned gpio)
 	return !!(val & BIT(bit));
 }
 
+/*
+ * The pins of a bank are contiguous bits of a single register, so
+ * gather the pins of each bank into a register mask and access the
+ * bank with one regmap operation.
+ */
+static u32 meson_gpio_bank_mask(struct meson_bank *bank,
+				const unsigned long *bits)
+{
+	u32 mask = 0;
+	unsigned int pin;
+
+	for (pin = bank->first; pin <= bank->last; pin++)
+		if (test_bit(pin, bits))
+			mask |= BIT(pin - bank->first);
+
+	return mask;
+}
+
+static int meson_gpio_get_multiple(struct gpio_chip *chip,
+				   unsigned long *mask, unsigned long *bits)
+{
+	struct meson_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int i, pin, reg, bit, val;
+	struct meson_bank *bank;
+	u32 bank_mask;
+	int ret;
+
+	for (i = 0; i < pc->data->num_banks; i++) {
+		bank = &pc->data->banks[i];
+
+		bank_mask = meson_gpio_bank_mask(bank, mask);
+		if (!bank_mask)
+			continue;
+
+		meson_calc_reg_and_bit(bank, bank->first, REG_IN, &reg, &bit);
+		ret = regmap_read(pc->reg_gpio, reg, &val);
+		if (ret)
+			return ret;
+
+		val >>= bit;
+		for (pin = bank->first; pin <= bank->last; pin++)
+			if (bank_mask & BIT(pin - bank->first))
+				__assign_bit(pin, bits,
+					     val & BIT(pin - bank->first));
+	}
+
+	return 0;
+}
+
+static void meson_gpio_set_multiple(struct gpio_chip *chip,
+				    unsigned long *mask, unsigned long *bits)
+{
+	struct meson_pinctrl *pc = gpiochip_get_data(chip);
+	unsigned int i, reg, bit;
+	struct meson_bank *bank;
+	u32 bank_mask;
+
+	for (i = 0; i < pc->data->num_banks; i++) {
+		bank = &pc->data->banks[i];
+
+		bank_mask = meson_gpio_bank_mask(bank, mask);
+		if (!bank_mask)
+			continue;
+
+		meson_calc_reg_and_bit(bank, bank->first, REG_OUT, &reg, &bit);
+		regmap_update_bits(pc->reg_gpio, reg, bank_mask << bit,
+				   (meson_gpio_bank_mask(bank, bits) &
+				    bank_mask) << bit);
+	}
+}
+
 static int meson_gpiolib_register(struct meson_pinctrl *pc)
 {
 	int ret;
@@ -595,6 +666,8 @@ static int meson_gpiolib_register(struct meson_pinctrl *pc)
 	pc->chip.direction_output = meson_gpio_direction_output;
 	pc->chip.get = meson_gpio_get;
 	pc->chip.set = meson_gpio_set;
+	pc->chip.get_multiple = meson_gpio_get_multiple;
+	pc->chip.set_multiple = meson_gpio_set_multiple;
 	pc->chip.base = -1;
 	pc->chip.ngpio = pc->data->num_pins;
 	pc->chip.can_sleep = false;
@@ -615,6 +688,8 @@ static struct regmap_config meson_regmap_config = {
 	.reg_bits = 32,
 	.val_bits = 32,
 	.reg_stride = 4,
+	/* No DMA is involved, accesses only need to be ordered between them */
+	.use_relaxed_mmio = true,
 };
 
 static struct regmap *meson_map_resource(struct meson_pinctrl *pc,
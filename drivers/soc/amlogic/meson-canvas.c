@@ -5,6 +5,8 @@
  * Copyright (C) 2014 Endless Mobile
  */
 
+#include <linux/bitmap.h>
+#include <linux/debugfs.h>
 #include <linux/kernel.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
@@ -13,6 +15,8 @@
 #include <linux/of_address.h>
 #include <linux/of_platform.h>
 #include <linux/io.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
 
 #define NUM_CANVAS 256
 
@@ -34,8 +38,24 @@ struct meson_canvas {
 	struct device *dev;
 	void __iomem *reg_base;
 	spinlock_t lock; /* canvas device lock */
-	u8 used[NUM_CANVAS];
+	DECLARE_BITMAP(used, NUM_CANVAS);
+	unsigned int num_used;
+	unsigned int num_reserved;
+	unsigned int max_used;
+	unsigned int alloc_failures;
 	bool supports_endianness;
+	struct dentry *debugfs;
+};
+
+/*
+ * A pool reserves canvases for a consumer, without picking them yet. The
+ * part of the reservation which is not allocated is accounted in
+ * num_reserved and is not available to the other consumers.
+ */
+struct meson_canvas_pool {
+	struct meson_canvas *canvas;
+	unsigned int size;
+	unsigned int used;
 };
 
 static void canvas_write(struct meson_canvas *canvas, u32 reg, u32 val)
@@ -79,43 +99,64 @@ struct meson_canvas *meson_canvas_get(struct device *dev)
 }
 EXPORT_SYMBOL_GPL(meson_canvas_get);
 
-int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
-			u32 addr, u32 stride, u32 height,
-			unsigned int wrap,
-			unsigned int blkmode,
-			unsigned int endian)
+static int meson_canvas_check(struct meson_canvas *canvas,
+			      const struct meson_canvas_cfg *cfg)
 {
-	unsigned long flags;
-
-	if (endian && !canvas->supports_endianness) {
+	if (cfg->endian && !canvas->supports_endianness) {
 		dev_err(canvas->dev,
 			"Endianness is not supported on this SoC\n");
 		return -EINVAL;
 	}
 
-	spin_lock_irqsave(&canvas->lock, flags);
-	if (!canvas->used[canvas_index]) {
+	if (!test_bit(cfg->index, canvas->used)) {
 		dev_err(canvas->dev,
 			"Trying to setup non allocated canvas %u\n",
-			canvas_index);
-		spin_unlock_irqrestore(&canvas->lock, flags);
+			cfg->index);
 		return -EINVAL;
 	}
 
+	return 0;
+}
+
+/* Must be called with the canvas lock held */
+static void meson_canvas_write_lut(struct meson_canvas *canvas,
+				   const struct meson_canvas_cfg *cfg)
+{
 	canvas_write(canvas, DMC_CAV_LUT_DATAL,
-		     ((addr + 7) >> 3) |
-		     (((stride + 7) >> 3) << CANVAS_WIDTH_LBIT));
+		     ((cfg->addr + 7) >> 3) |
+		     (((cfg->stride + 7) >> 3) << CANVAS_WIDTH_LBIT));
 
 	canvas_write(canvas, DMC_CAV_LUT_DATAH,
-		     ((((stride + 7) >> 3) >> CANVAS_WIDTH_LWID) <<
+		     ((((cfg->stride + 7) >> 3) >> CANVAS_WIDTH_LWID) <<
 						CANVAS_WIDTH_HBIT) |
-		     (height << CANVAS_HEIGHT_BIT) |
-		     (wrap << CANVAS_WRAP_BIT) |
-		     (blkmode << CANVAS_BLKMODE_BIT) |
-		     (endian << CANVAS_ENDIAN_BIT));
+		     (cfg->height << CANVAS_HEIGHT_BIT) |
+		     (cfg->wrap << CANVAS_WRAP_BIT) |
+		     (cfg->blkmode << CANVAS_BLKMODE_BIT) |
+		     (cfg->endian << CANVAS_ENDIAN_BIT));
 
 	canvas_write(canvas, DMC_CAV_LUT_ADDR,
-		     CANVAS_LUT_WR_EN | canvas_index);
+		     CANVAS_LUT_WR_EN | cfg->index);
+}
+
+int meson_canvas_config_batch(struct meson_canvas *canvas,
+			      const struct meson_canvas_cfg *cfg,
+			      unsigned int num)
+{
+	unsigned long flags;
+	unsigned int i;
+	int ret;
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	for (i = 0; i < num; i++) {
+		ret = meson_canvas_check(canvas, &cfg[i]);
+		if (ret) {
+			spin_unlock_irqrestore(&canvas->lock, flags);
+			return ret;
+		}
+	}
+
+	for (i = 0; i < num; i++)
+		meson_canvas_write_lut(canvas, &cfg[i]);
 
 	/* Force a read-back to make sure everything is flushed. */
 	canvas_read(canvas, DMC_CAV_LUT_DATAH);
@@ -123,46 +164,214 @@ int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
 
 	return 0;
 }
+EXPORT_SYMBOL_GPL(meson_canvas_config_batch);
+
+int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
+			u32 addr, u32 stride, u32 height,
+			unsigned int wrap,
+			unsigned int blkmode,
+			unsigned int endian)
+{
+	struct meson_canvas_cfg cfg = {
+		.index = canvas_index,
+		.addr = addr,
+		.stride = stride,
+		.height = height,
+		.wrap = wrap,
+		.blkmode = blkmode,
+		.endian = endian,
+	};
+
+	return meson_canvas_config_batch(canvas, &cfg, 1);
+}
 EXPORT_SYMBOL_GPL(meson_canvas_config);
 
-int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index)
+static unsigned int meson_canvas_available(struct meson_canvas *canvas)
+{
+	return NUM_CANVAS - canvas->num_used - canvas->num_reserved;
+}
+
+/* Must be called with the canvas lock held */
+static void __meson_canvas_alloc_n(struct meson_canvas *canvas,
+				   u8 *canvas_index, unsigned int num)
+{
+	unsigned int i, idx;
+
+	for (i = 0, idx = 0; i < num; i++) {
+		idx = find_next_zero_bit(canvas->used, NUM_CANVAS, idx);
+		set_bit(idx, canvas->used);
+		canvas_index[i] = idx;
+	}
+
+	canvas->num_used += num;
+	canvas->max_used = max(canvas->max_used, canvas->num_used);
+}
+
+int meson_canvas_alloc_n(struct meson_canvas *canvas, u8 *canvas_index,
+			 unsigned int num)
 {
-	int i;
 	unsigned long flags;
 
 	spin_lock_irqsave(&canvas->lock, flags);
-	for (i = 0; i < NUM_CANVAS; ++i) {
-		if (!canvas->used[i]) {
-			canvas->used[i] = 1;
-			spin_unlock_irqrestore(&canvas->lock, flags);
-			*canvas_index = i;
-			return 0;
-		}
+	if (num > meson_canvas_available(canvas)) {
+		canvas->alloc_failures++;
+		spin_unlock_irqrestore(&canvas->lock, flags);
+		dev_err(canvas->dev, "No more canvas available\n");
+		return -ENODEV;
 	}
+
+	__meson_canvas_alloc_n(canvas, canvas_index, num);
 	spin_unlock_irqrestore(&canvas->lock, flags);
 
-	dev_err(canvas->dev, "No more canvas available\n");
-	return -ENODEV;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(meson_canvas_alloc_n);
+
+int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index)
+{
+	return meson_canvas_alloc_n(canvas, canvas_index, 1);
 }
 EXPORT_SYMBOL_GPL(meson_canvas_alloc);
 
+/* Must be called with the canvas lock held */
+static int __meson_canvas_free(struct meson_canvas *canvas, u8 canvas_index)
+{
+	if (!test_bit(canvas_index, canvas->used)) {
+		dev_err(canvas->dev,
+			"Trying to free unused canvas %u\n", canvas_index);
+		return -EINVAL;
+	}
+	clear_bit(canvas_index, canvas->used);
+	canvas->num_used--;
+
+	return 0;
+}
+
 int meson_canvas_free(struct meson_canvas *canvas, u8 canvas_index)
 {
 	unsigned long flags;
+	int ret;
 
 	spin_lock_irqsave(&canvas->lock, flags);
-	if (!canvas->used[canvas_index]) {
-		dev_err(canvas->dev,
-			"Trying to free unused canvas %u\n", canvas_index);
+	ret = __meson_canvas_free(canvas, canvas_index);
+	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(meson_canvas_free);
+
+struct meson_canvas_pool *meson_canvas_pool_create(struct meson_canvas *canvas,
+						   unsigned int size)
+{
+	struct meson_canvas_pool *pool;
+	unsigned long flags;
+
+	pool = kzalloc(sizeof(*pool), GFP_KERNEL);
+	if (!pool)
+		return ERR_PTR(-ENOMEM);
+
+	pool->canvas = canvas;
+	pool->size = size;
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	if (size > meson_canvas_available(canvas)) {
+		canvas->alloc_failures++;
 		spin_unlock_irqrestore(&canvas->lock, flags);
-		return -EINVAL;
+		kfree(pool);
+		return ERR_PTR(-ENOSPC);
+	}
+
+	canvas->num_reserved += size;
+	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	return pool;
+}
+EXPORT_SYMBOL_GPL(meson_canvas_pool_create);
+
+void meson_canvas_pool_destroy(struct meson_canvas_pool *pool)
+{
+	struct meson_canvas *canvas;
+	unsigned long flags;
+
+	if (IS_ERR_OR_NULL(pool))
+		return;
+
+	canvas = pool->canvas;
+	WARN(pool->used, "destroying a pool with %u canvas in use\n",
+	     pool->used);
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	canvas->num_reserved -= pool->size - pool->used;
+	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(meson_canvas_pool_destroy);
+
+int meson_canvas_pool_alloc_n(struct meson_canvas_pool *pool, u8 *canvas_index,
+			      unsigned int num)
+{
+	struct meson_canvas *canvas = pool->canvas;
+	unsigned long flags;
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	if (num > pool->size - pool->used) {
+		spin_unlock_irqrestore(&canvas->lock, flags);
+		dev_err(canvas->dev, "Canvas pool exhausted\n");
+		return -ENOSPC;
 	}
-	canvas->used[canvas_index] = 0;
+
+	/* The reserved canvases are necessarily free */
+	__meson_canvas_alloc_n(canvas, canvas_index, num);
+	canvas->num_reserved -= num;
+	pool->used += num;
 	spin_unlock_irqrestore(&canvas->lock, flags);
 
 	return 0;
 }
-EXPORT_SYMBOL_GPL(meson_canvas_free);
+EXPORT_SYMBOL_GPL(meson_canvas_pool_alloc_n);
+
+int meson_canvas_pool_free(struct meson_canvas_pool *pool, u8 canvas_index)
+{
+	struct meson_canvas *canvas = pool->canvas;
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	ret = __meson_canvas_free(canvas, canvas_index);
+	if (!ret) {
+		/* Give the canvas back to the reservation */
+		canvas->num_reserved++;
+		pool->used--;
+	}
+	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(meson_canvas_pool_free);
+
+static int meson_canvas_usage_show(struct seq_file *s, void *data)
+{
+	struct meson_canvas *canvas = s->private;
+	unsigned int used, reserved, max_used, failures;
+	unsigned long flags;
+
+	spin_lock_irqsave(&canvas->lock, flags);
+	used = canvas->num_used;
+	reserved = canvas->num_reserved;
+	max_used = canvas->max_used;
+	failures = canvas->alloc_failures;
+	spin_unlock_irqrestore(&canvas->lock, flags);
+
+	seq_printf(s, "total:\t\t%u\n", NUM_CANVAS);
+	seq_printf(s, "used:\t\t%u\n", used);
+	seq_printf(s, "reserved:\t%u\n", reserved);
+	seq_printf(s, "max used:\t%u\n", max_used);
+	seq_printf(s, "failures:\t%u\n", failures);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(meson_canvas_usage);
 
 static int meson_canvas_probe(struct platform_device *pdev)
 {
@@ -185,6 +394,19 @@ static int meson_canvas_probe(struct platform_device *pdev)
 	spin_lock_init(&canvas->lock);
 	dev_set_drvdata(dev, canvas);
 
+	canvas->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("usage", 0444, canvas->debugfs, canvas,
+			    &meson_canvas_usage_fops);
+
+	return 0;
+}
+
+static int meson_canvas_remove(struct platform_device *pdev)
+{
+	struct meson_canvas *canvas = platform_get_drvdata(pdev);
+
+	debugfs_remove_recursive(canvas->debugfs);
+
 	return 0;
 }
 
@@ -199,6 +421,7 @@ MODULE_DEVICE_TABLE(of, canvas_dt_match);
 
 static struct platform_driver meson_canvas_driver = {
 	.probe = meson_canvas_probe,
+	.remove = meson_canvas_remove,
 	.driver = {
 		.name = "amlogic-canvas",
 		.of_match_table = canvas_dt_match,
@@ -10,6 +10,7 @@
 #include <linux/seq_file.h>
 #include <linux/debugfs.h>
 #include <linux/regmap.h>
+#include <linux/workqueue.h>
 
 static DEFINE_MUTEX(measure_lock);
 
@@ -34,15 +35,28 @@ static DEFINE_MUTEX(measure_lock);
 
 #define CLK_MSR_MAX		128
 
+struct meson_msr_stats {
+	unsigned int count;
+	unsigned int errors;
+	int min;
+	int max;
+	u64 sum;
+};
+
 struct meson_msr_id {
 	struct meson_msr *priv;
 	unsigned int id;
 	const char *name;
+	bool sampled;
+	struct meson_msr_stats stats;
 };
 
 struct meson_msr {
 	struct regmap *regmap;
 	struct meson_msr_id msr_table[CLK_MSR_MAX];
+	struct delayed_work sample_work;
+	struct mutex sample_lock;
+	u32 sample_period_ms;
 };
 
 #define CLK_MSR_ID(__id, __name) \
@@ -594,6 +608,104 @@ static int clk_msr_summary_show(struct seq_file *s, void *data)
 }
 DEFINE_SHOW_ATTRIBUTE(clk_msr_summary);
 
+static void clk_msr_sample_work(struct work_struct *work)
+{
+	struct meson_msr *priv = container_of(to_delayed_work(work),
+					      struct meson_msr, sample_work);
+	unsigned int precision;
+	int val, i;
+
+	for (i = 0 ; i < CLK_MSR_MAX ; ++i) {
+		struct meson_msr_id *clk_msr_id = &priv->msr_table[i];
+		struct meson_msr_stats *stats = &clk_msr_id->stats;
+
+		if (!clk_msr_id->name || !clk_msr_id->sampled)
+			continue;
+
+		val = meson_measure_best_id(clk_msr_id, &precision);
+
+		mutex_lock(&priv->sample_lock);
+		if (val < 0) {
+			stats->errors++;
+		} else {
+			if (!stats->count || val < stats->min)
+				stats->min = val;
+			if (!stats->count || val > stats->max)
+				stats->max = val;
+			stats->sum += val;
+			stats->count++;
+		}
+		mutex_unlock(&priv->sample_lock);
+	}
+
+	if (READ_ONCE(priv->sample_period_ms))
+		schedule_delayed_work(&priv->sample_work,
+				      msecs_to_jiffies(priv->sample_period_ms));
+}
+
+/*
+ * Report the statistics gathered by the sampler since the last read, then
+ * start a new window
+ */
+static int clk_msr_sample_summary_show(struct seq_file *s, void *data)
+{
+	struct meson_msr *priv = s->private;
+	int i;
+
+	seq_puts(s, "  clock                      min         avg         max");
+	seq_puts(s, "  samples errors\n");
+	seq_puts(s, "-------------------------------------------------------");
+	seq_puts(s, "----------------\n");
+
+	mutex_lock(&priv->sample_lock);
+	for (i = 0 ; i < CLK_MSR_MAX ; ++i) {
+		struct meson_msr_stats *stats = &priv->msr_table[i].stats;
+
+		if (!priv->msr_table[i].name || !priv->msr_table[i].sampled)
+			continue;
+
+		seq_printf(s, " %-20s %10d  %10llu  %10d  %7u %6u\n",
+			   priv->msr_table[i].name, stats->min,
+			   stats->count ? div_u64(stats->sum, stats->count) : 0,
+			   stats->max, stats->count, stats->errors);
+
+		memset(stats, 0, sizeof(*stats));
+	}
+	mutex_unlock(&priv->sample_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(clk_msr_sample_summary);
+
+static int clk_msr_sample_period_get(void *data, u64 *val)
+{
+	struct meson_msr *priv = data;
+
+	*val = priv->sample_period_ms;
+
+	return 0;
+}
+
+static int clk_msr_sample_period_set(void *data, u64 val)
+{
+	struct meson_msr *priv = data;
+
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	/* A zero period stops the sampler */
+	WRITE_ONCE(priv->sample_period_ms, val);
+	cancel_delayed_work_sync(&priv->sample_work);
+
+	if (val)
+		schedule_delayed_work(&priv->sample_work,
+				      msecs_to_jiffies(val));
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(clk_msr_sample_period_fops, clk_msr_sample_period_get,
+			 clk_msr_sample_period_set, "%llu\n");
+
 static const struct regmap_config meson_clk_msr_regmap_config = {
 	.reg_bits = 32,
 	.val_bits = 32,
@@ -606,7 +718,7 @@ static int meson_msr_probe(struct platform_device *pdev)
 	const struct meson_msr_id *match_data;
 	struct meson_msr *priv;
 	struct resource *res;
-	struct dentry *root, *clks;
+	struct dentry *root, *clks, *sampled;
 	void __iomem *base;
 	int i;
 
@@ -622,6 +734,8 @@ static int meson_msr_probe(struct platform_device *pdev)
 	}
 
 	memcpy(priv->msr_table, match_data, sizeof(priv->msr_table));
+	mutex_init(&priv->sample_lock);
+	INIT_DELAYED_WORK(&priv->sample_work, clk_msr_sample_work);
 
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
 	base = devm_ioremap_resource(&pdev->dev, res);
@@ -637,9 +751,14 @@ static int meson_msr_probe(struct platform_device *pdev)
 
 	root = debugfs_create_dir("meson-clk-msr", NULL);
 	clks = debugfs_create_dir("clks", root);
+	sampled = debugfs_create_dir("sampled", root);
 
 	debugfs_create_file("measure_summary", 0444, root,
 			    priv->msr_table, &clk_msr_summary_fops);
+	debugfs_create_file("sample_summary", 0444, root,
+			    priv, &clk_msr_sample_summary_fops);
+	debugfs_create_file_unsafe("sample_period_ms", 0644, root,
+				   priv, &clk_msr_sample_period_fops);
 
 	for (i = 0 ; i < CLK_MSR_MAX ; ++i) {
 		if (!priv->msr_table[i].name)
@@ -649,6 +768,8 @@ static int meson_msr_probe(struct platform_device *pdev)
 
 		debugfs_create_file(priv->msr_table[i].name, 0444, clks,
 				    &priv->msr_table[i], &clk_msr_fops);
+		debugfs_create_bool(priv->msr_table[i].name, 0644, sampled,
+				    &priv->msr_table[i].sampled);
 	}
 
 	return 0;
@@ -14,6 +14,9 @@
 #include <linux/reset-controller.h>
 #include <linux/reset.h>
 #include <linux/clk.h>
+#include <linux/debugfs.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 #include <dt-bindings/power/meson8-power.h>
 #include <dt-bindings/power/meson-g12a-power.h>
 #include <dt-bindings/power/meson-gxbb-power.h>
@@ -285,6 +288,11 @@ struct meson_ee_pwrc_domain {
 	int num_clks;
 	struct reset_control *rstc;
 	int num_rstc;
+	/* Transition times, in ns */
+	s64 on_time;
+	s64 on_time_max;
+	s64 off_time;
+	s64 off_time_max;
 };
 
 struct meson_ee_pwrc {
@@ -292,6 +300,7 @@ struct meson_ee_pwrc {
 	struct regmap *regmap_hhi;
 	struct meson_ee_pwrc_domain *domains;
 	struct genpd_onecell_data xlate;
+	struct dentry *debugfs;
 };
 
 static bool pwrc_ee_get_power(struct meson_ee_pwrc_domain *pwrc_domain)
@@ -304,10 +313,8 @@ static bool pwrc_ee_get_power(struct meson_ee_pwrc_domain *pwrc_domain)
 	return (reg & pwrc_domain->desc.top_pd->sleep_mask);
 }
 
-static int meson_ee_pwrc_off(struct generic_pm_domain *domain)
+static int __meson_ee_pwrc_off(struct meson_ee_pwrc_domain *pwrc_domain)
 {
-	struct meson_ee_pwrc_domain *pwrc_domain =
-		container_of(domain, struct meson_ee_pwrc_domain, base);
 	int i;
 
 	if (pwrc_domain->desc.top_pd)
@@ -340,10 +347,24 @@ static int meson_ee_pwrc_off(struct generic_pm_domain *domain)
 	return 0;
 }
 
-static int meson_ee_pwrc_on(struct generic_pm_domain *domain)
+static int meson_ee_pwrc_off(struct generic_pm_domain *domain)
 {
 	struct meson_ee_pwrc_domain *pwrc_domain =
 		container_of(domain, struct meson_ee_pwrc_domain, base);
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = __meson_ee_pwrc_off(pwrc_domain);
+
+	pwrc_domain->off_time = ktime_to_ns(ktime_sub(ktime_get(), start));
+	pwrc_domain->off_time_max = max(pwrc_domain->off_time_max,
+					pwrc_domain->off_time);
+
+	return ret;
+}
+
+static int __meson_ee_pwrc_on(struct meson_ee_pwrc_domain *pwrc_domain)
+{
 	int i, ret;
 
 	if (pwrc_domain->desc.top_pd)
@@ -376,6 +397,44 @@ static int meson_ee_pwrc_on(struct generic_pm_domain *domain)
 				       pwrc_domain->clks);
 }
 
+static int meson_ee_pwrc_on(struct generic_pm_domain *domain)
+{
+	struct meson_ee_pwrc_domain *pwrc_domain =
+		container_of(domain, struct meson_ee_pwrc_domain, base);
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = __meson_ee_pwrc_on(pwrc_domain);
+
+	pwrc_domain->on_time = ktime_to_ns(ktime_sub(ktime_get(), start));
+	pwrc_domain->on_time_max = max(pwrc_domain->on_time_max,
+				       pwrc_domain->on_time);
+
+	return ret;
+}
+
+static int meson_ee_pwrc_stats_show(struct seq_file *s, void *data)
+{
+	struct meson_ee_pwrc *pwrc = s->private;
+	int i;
+
+	seq_puts(s, "domain      on (us)  on max (us)  off (us)  off max (us)\n");
+
+	for (i = 0 ; i < pwrc->xlate.num_domains ; ++i) {
+		struct meson_ee_pwrc_domain *dom = &pwrc->domains[i];
+
+		seq_printf(s, "%-10s %8lld  %11lld  %8lld  %12lld\n",
+			   dom->desc.name,
+			   div_s64(dom->on_time, NSEC_PER_USEC),
+			   div_s64(dom->on_time_max, NSEC_PER_USEC),
+			   div_s64(dom->off_time, NSEC_PER_USEC),
+			   div_s64(dom->off_time_max, NSEC_PER_USEC));
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(meson_ee_pwrc_stats);
+
 static int meson_ee_pwrc_init_domain(struct platform_device *pdev,
 				     struct meson_ee_pwrc *pwrc,
 				     struct meson_ee_pwrc_domain *dom)
@@ -506,6 +565,10 @@ static int meson_ee_pwrc_probe(struct platform_device *pdev)
 		pwrc->xlate.domains[i] = &dom->base;
 	}
 
+	pwrc->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("power_stats", 0444, pwrc->debugfs, pwrc,
+			    &meson_ee_pwrc_stats_fops);
+
 	return of_genpd_add_provider_onecell(pdev->dev.of_node, &pwrc->xlate);
 }
 
@@ -11,6 +11,7 @@
 #include <linux/clk.h>
 #include <linux/clk-provider.h>
 #include <linux/device.h>
+#include <linux/dma-mapping.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -18,15 +19,20 @@
 #include <linux/of_device.h>
 #include <linux/platform_device.h>
 #include <linux/spi/spi.h>
+#include <linux/spi/spi-mem.h>
 #include <linux/types.h>
 #include <linux/interrupt.h>
 #include <linux/reset.h>
+#include <asm/unaligned.h>
 
 /*
  * The Meson SPICC controller could support DMA based transfers, but is not
  * implemented by the vendor code, and while having the registers documentation
  * it has never worked on the GXL Hardware.
- * The PIO mode is the only mode implemented, and due to badly designed HW :
+ * On AXG and later, the DMA engine is used for long transfers of 8bit words.
+ * It transfers 64bit FIFO entries, so the data is sent as big endian 64bit
+ * words through a small bounce buffer, one SPI burst at a time.
+ * Otherwise, the PIO mode is used, and due to badly designed HW :
  * - all transfers are cutted in 16 words burst because the FIFO hangs on
  *   TX underflow, and there is no TX "Half-Empty" interrupt, so we go by
  *   FIFO max size chunk only
@@ -37,6 +43,12 @@
 
 #define SPICC_MAX_BURST	128
 
+/* DMA transfers are made of 64bit words, in DMA bursts of 8 words */
+#define SPICC_DMA_WORD_SIZE	8
+#define SPICC_DMA_BURST		8
+#define SPICC_DMA_BUF_LEN	(SPICC_MAX_BURST * SPICC_DMA_WORD_SIZE)
+#define SPICC_DMA_MIN_LEN	256
+
 /* Register Map */
 #define SPICC_RXDATA	0x00
 
@@ -148,6 +160,7 @@ struct meson_spicc_data {
 	bool				has_oen;
 	bool				has_enhance_clk_div;
 	bool				has_pclk;
+	bool				has_dma;
 };
 
 struct meson_spicc_device {
@@ -166,6 +179,12 @@ struct meson_spicc_device {
 	unsigned long			tx_remain;
 	unsigned long			rx_remain;
 	unsigned long			xfer_remain;
+	bool				using_dma;
+	unsigned int			dma_len;
+	void				*tx_dma_buf;
+	void				*rx_dma_buf;
+	dma_addr_t			tx_dma;
+	dma_addr_t			rx_dma;
 };
 
 static void meson_spicc_oen_enable(struct meson_spicc_device *spicc)
@@ -266,12 +285,105 @@ static inline void meson_spicc_setup_burst(struct meson_spicc_device *spicc)
 	meson_spicc_tx(spicc);
 }
 
+static bool meson_spicc_can_dma(struct meson_spicc_device *spicc,
+				struct spi_transfer *xfer)
+{
+	if (!spicc->data->has_dma)
+		return false;
+
+	/* Short transfers are cheaper in PIO than through the bounce buffer */
+	if (xfer->len < SPICC_DMA_MIN_LEN)
+		return false;
+
+	return xfer->bits_per_word == 8 &&
+	       !(xfer->len % (SPICC_DMA_WORD_SIZE * SPICC_DMA_BURST));
+}
+
+static void meson_spicc_setup_dma_burst(struct meson_spicc_device *spicc)
+{
+	unsigned int len = min_t(unsigned long, spicc->xfer_remain,
+				 SPICC_DMA_BUF_LEN);
+	unsigned int words = len / SPICC_DMA_WORD_SIZE;
+	u64 *buf = spicc->tx_dma_buf;
+	unsigned int i;
+	u32 conf;
+
+	/* The first byte on the wire is the MSB of the 64bit word */
+	for (i = 0; i < words; i++) {
+		buf[i] = get_unaligned_be64(spicc->tx_buf);
+		spicc->tx_buf += SPICC_DMA_WORD_SIZE;
+	}
+
+	spicc->dma_len = len;
+	spicc->xfer_remain -= len;
+
+	writel_relaxed(spicc->tx_dma, spicc->base + SPICC_DRADDR);
+	writel_relaxed(spicc->rx_dma, spicc->base + SPICC_DWADDR);
+
+	/* Setup burst length */
+	writel_bits_relaxed(SPICC_BURSTLENGTH_MASK,
+			FIELD_PREP(SPICC_BURSTLENGTH_MASK, words - 1),
+			spicc->base + SPICC_CONREG);
+
+	conf = SPICC_DMA_ENABLE | SPICC_DMA_URGENT;
+	conf |= FIELD_PREP(SPICC_TXFIFO_THRESHOLD_MASK,
+			   spicc->data->fifo_size + 1 - SPICC_DMA_BURST);
+	conf |= FIELD_PREP(SPICC_RXFIFO_THRESHOLD_MASK, SPICC_DMA_BURST - 1);
+	conf |= FIELD_PREP(SPICC_READ_BURST_MASK, SPICC_DMA_BURST - 1);
+	conf |= FIELD_PREP(SPICC_WRITE_BURST_MASK, SPICC_DMA_BURST - 1);
+	conf |= FIELD_PREP(SPICC_DMA_BURSTNUM_MASK,
+			   words / SPICC_DMA_BURST - 1);
+
+	/* Make sure the bounce buffer is written before kicking the DMA */
+	wmb();
+	writel_relaxed(conf, spicc->base + SPICC_DMAREG);
+}
+
+static void meson_spicc_dma_rx(struct meson_spicc_device *spicc)
+{
+	unsigned int words = spicc->dma_len / SPICC_DMA_WORD_SIZE;
+	u64 *buf = spicc->rx_dma_buf;
+	unsigned int i;
+
+	for (i = 0; i < words; i++) {
+		put_unaligned_be64(buf[i], spicc->rx_buf);
+		spicc->rx_buf += SPICC_DMA_WORD_SIZE;
+	}
+}
+
+static irqreturn_t meson_spicc_dma_irq(struct meson_spicc_device *spicc)
+{
+	/* Copy the received words out of the bounce buffer */
+	meson_spicc_dma_rx(spicc);
+
+	if (!spicc->xfer_remain) {
+		/* Disable DMA and all IRQs */
+		writel_relaxed(0, spicc->base + SPICC_DMAREG);
+		writel(0, spicc->base + SPICC_INTREG);
+
+		spi_finalize_current_transfer(spicc->master);
+
+		return IRQ_HANDLED;
+	}
+
+	/* Setup burst */
+	meson_spicc_setup_dma_burst(spicc);
+
+	/* Start burst */
+	writel_bits_relaxed(SPICC_XCH, SPICC_XCH, spicc->base + SPICC_CONREG);
+
+	return IRQ_HANDLED;
+}
+
 static irqreturn_t meson_spicc_irq(int irq, void *data)
 {
 	struct meson_spicc_device *spicc = (void *) data;
 
 	writel_bits_relaxed(SPICC_TC, SPICC_TC, spicc->base + SPICC_STATREG);
 
+	if (spicc->using_dma)
+		return meson_spicc_dma_irq(spicc);
+
 	/* Empty RX FIFO */
 	meson_spicc_rx(spicc);
 
@@ -394,9 +506,14 @@ static int meson_spicc_transfer_one(struct spi_master *master,
 	spicc->rx_buf = (u8 *)xfer->rx_buf;
 	spicc->xfer_remain = xfer->len;
 
+	spicc->using_dma = meson_spicc_can_dma(spicc, xfer);
+
 	/* Pre-calculate word size */
-	spicc->bytes_per_word =
-	   DIV_ROUND_UP(spicc->xfer->bits_per_word, 8);
+	if (spicc->using_dma)
+		spicc->bytes_per_word = SPICC_DMA_WORD_SIZE;
+	else
+		spicc->bytes_per_word =
+		   DIV_ROUND_UP(spicc->xfer->bits_per_word, 8);
 
 	if (xfer->len % spicc->bytes_per_word)
 		return -EINVAL;
@@ -407,7 +524,10 @@ static int meson_spicc_transfer_one(struct spi_master *master,
 	meson_spicc_reset_fifo(spicc);
 
 	/* Setup burst */
-	meson_spicc_setup_burst(spicc);
+	if (spicc->using_dma)
+		meson_spicc_setup_dma_burst(spicc);
+	else
+		meson_spicc_setup_burst(spicc);
 
 	/* Start burst */
 	writel_bits_relaxed(SPICC_XCH, SPICC_XCH, spicc->base + SPICC_CONREG);
@@ -475,6 +595,52 @@ static int meson_spicc_prepare_message(struct spi_master *master,
 	return 0;
 }
 
+/*
+ * The controller has a single data line, and spi-mem operations go through
+ * the regular transfer path. The only thing worth doing is splitting the
+ * long reads and writes so the bulk of the data is a whole number of DMA
+ * bursts, leaving the tail in a separate, short operation.
+ */
+static int meson_spicc_mem_adjust_op_size(struct spi_mem *mem,
+					  struct spi_mem_op *op)
+{
+	struct meson_spicc_device *spicc =
+		spi_master_get_devdata(mem->spi->master);
+	unsigned int len;
+
+	if (!spicc->data->has_dma || op->data.nbytes < SPICC_DMA_MIN_LEN)
+		return 0;
+
+	len = ALIGN_DOWN(op->data.nbytes,
+			 SPICC_DMA_WORD_SIZE * SPICC_DMA_BURST);
+	op->data.nbytes = len;
+
+	return 0;
+}
+
+static bool meson_spicc_mem_supports_op(struct spi_mem *mem,
+					const struct spi_mem_op *op)
+{
+	if (op->cmd.buswidth > 1 || op->addr.buswidth > 1 ||
+	    op->dummy.buswidth > 1 || op->data.buswidth > 1)
+		return false;
+
+	return spi_mem_default_supports_op(mem, op);
+}
+
+static int meson_spicc_mem_exec_op(struct spi_mem *mem,
+				   const struct spi_mem_op *op)
+{
+	/* Let the core build the message for the regular transfer path */
+	return -ENOTSUPP;
+}
+
+static const struct spi_controller_mem_ops meson_spicc_mem_ops = {
+	.adjust_op_size = meson_spicc_mem_adjust_op_size,
+	.supports_op = meson_spicc_mem_supports_op,
+	.exec_op = meson_spicc_mem_exec_op,
+};
+
 static int meson_spicc_unprepare_transfer(struct spi_master *master)
 {
 	struct meson_spicc_device *spicc = spi_master_get_devdata(master);
@@ -730,6 +896,22 @@ static int meson_spicc_probe(struct platform_device *pdev)
 		goto out_master;
 	}
 
+	if (spicc->data->has_dma) {
+		spicc->tx_dma_buf = dmam_alloc_coherent(&pdev->dev,
+							SPICC_DMA_BUF_LEN,
+							&spicc->tx_dma,
+							GFP_KERNEL);
+		spicc->rx_dma_buf = dmam_alloc_coherent(&pdev->dev,
+							SPICC_DMA_BUF_LEN,
+							&spicc->rx_dma,
+							GFP_KERNEL);
+		if (!spicc->tx_dma_buf || !spicc->rx_dma_buf) {
+			dev_err(&pdev->dev, "DMA buffer allocation failed\n");
+			ret = -ENOMEM;
+			goto out_clk;
+		}
+	}
+
 	device_reset_optional(&pdev->dev);
 
 	master->num_chipselect = 4;
@@ -747,6 +929,7 @@ static int meson_spicc_probe(struct platform_device *pdev)
 	master->prepare_message = meson_spicc_prepare_message;
 	master->unprepare_transfer_hardware = meson_spicc_unprepare_transfer;
 	master->transfer_one = meson_spicc_transfer_one;
+	master->mem_ops = &meson_spicc_mem_ops;
 	master->use_gpio_descriptors = true;
 
 	meson_spicc_oen_enable(spicc);
@@ -800,6 +983,7 @@ static const struct meson_spicc_data meson_spicc_axg_data = {
 	.fifo_size		= 16,
 	.has_oen		= true,
 	.has_enhance_clk_div	= true,
+	.has_dma		= true,
 };
 
 static const struct meson_spicc_data meson_spicc_g12a_data = {
@@ -809,6 +993,7 @@ static const struct meson_spicc_data meson_spicc_g12a_data = {
 	.has_oen		= true,
 	.has_enhance_clk_div	= true,
 	.has_pclk		= true,
+	.has_dma		= true,
 };
 
 static const struct of_device_id meson_spicc_of_match[] = {
@@ -116,19 +116,16 @@ static void meson_spifc_drain_buffer(struct meson_spifc *spifc, u8 *buf,
 				     int len)
 {
 	u32 data;
-	int i = 0;
+	int i = len & ~3;
 
-	while (i < len) {
-		regmap_read(spifc->regmap, REG_C0 + i, &data);
+	/* whole words in one go, rather than a regmap access each */
+	if (i)
+		regmap_bulk_read(spifc->regmap, REG_C0, buf, i / 4);
+	buf += i;
 
-		if (len - i >= 4) {
-			*((u32 *)buf) = data;
-			buf += 4;
-		} else {
-			memcpy(buf, &data, len - i);
-			break;
-		}
-		i += 4;
+	if (i < len) {
+		regmap_read(spifc->regmap, REG_C0 + i, &data);
+		memcpy(buf, &data, len - i);
 	}
 }
 
@@ -142,18 +139,15 @@ static void meson_spifc_fill_buffer(struct meson_spifc *spifc, const u8 *buf,
 				    int len)
 {
 	u32 data;
-	int i = 0;
+	int i = len & ~3;
 
-	while (i < len) {
-		if (len - i >= 4)
-			data = *(u32 *)buf;
-		else
-			memcpy(&data, buf, len - i);
+	if (i)
+		regmap_bulk_write(spifc->regmap, REG_C0, buf, i / 4);
+	buf += i;
 
+	if (i < len) {
+		memcpy(&data, buf, len - i);
 		regmap_write(spifc->regmap, REG_C0 + i, data);
-
-		buf += 4;
-		i += 4;
 	}
 }
 
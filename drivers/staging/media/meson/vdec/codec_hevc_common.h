@@ -32,20 +32,26 @@ struct codec_hevc_common {
 /* Returns 1 if we must use framebuffer compression */
 static inline int codec_hevc_use_fbc(u32 pixfmt, int is_10bit)
 {
-	/* TOFIX: Handle Amlogic Compressed buffer for 8bit also */
-	return is_10bit;
+	return is_10bit || pixfmt == V4L2_PIX_FMT_AM21C;
 }
 
 /* Returns 1 if we are decoding 10-bit but outputting 8-bit NV12 */
 static inline int codec_hevc_use_downsample(u32 pixfmt, int is_10bit)
 {
-	return is_10bit;
+	return is_10bit && pixfmt == V4L2_PIX_FMT_NV12M;
 }
 
-/* Returns 1 if we are decoding using the IOMMU */
+/*
+ * Returns 1 if we are decoding using the IOMMU
+ *
+ * AM21C CAPTURE buffers are scanned out as is by the display, which expects
+ * the basic layout with the headers right after the body, so the decoder
+ * only uses its scatter layout for internal reference buffers.
+ */
 static inline int codec_hevc_use_mmu(u32 revision, u32 pixfmt, int is_10bit)
 {
 	return revision >= VDEC_REVISION_G12A &&
+	       pixfmt == V4L2_PIX_FMT_NV12M &&
 	       codec_hevc_use_fbc(pixfmt, is_10bit);
 }
 
@@ -36,10 +36,23 @@
 #define PICINFO_PROG		0x00008000
 #define PICINFO_TOP_FIRST	0x00002000
 
+/* Decoder registers the firmware does not keep in its scratch registers */
+static const u32 codec_mpeg12_ctx_regs[] = {
+	MPEG1_2_REG, PSCALE_CTRL, PIC_HEAD_INFO, M4_CONTROL_REG,
+};
+
 struct codec_mpeg12 {
 	/* Buffer for the MPEG1/2 Workspace */
 	void	  *workspace_vaddr;
 	dma_addr_t workspace_paddr;
+
+	/* Saved codec_mpeg12_ctx_regs while the session is switched out */
+	u32 ctx_regs[ARRAY_SIZE(codec_mpeg12_ctx_regs)];
+
+	/* Set while the firmware is held on the first frame of a new size */
+	unsigned int res_changed;
+	/* Firmware buffer index of that frame */
+	u32 held_idx;
 };
 
 static const u8 eos_sequence[SZ_1K] = { 0x00, 0x00, 0x01, 0xB7 };
@@ -127,6 +140,113 @@ static int codec_mpeg12_stop(struct amvdec_session *sess)
 	return 0;
 }
 
+static int codec_mpeg12_save(struct amvdec_session *sess)
+{
+	struct codec_mpeg12 *mpeg12 = sess->priv;
+	struct amvdec_core *core = sess->core;
+	int i;
+
+	/*
+	 * Wait for the host to pick up the last decoded frame, unless the
+	 * firmware is held until CAPTURE gets reconfigured
+	 */
+	if (amvdec_read_dos(core, MREG_BUFFEROUT) && !mpeg12->res_changed)
+		return -EAGAIN;
+
+	for (i = 0; i < ARRAY_SIZE(codec_mpeg12_ctx_regs); ++i)
+		mpeg12->ctx_regs[i] = amvdec_read_dos(core,
+						      codec_mpeg12_ctx_regs[i]);
+
+	return 0;
+}
+
+static int codec_mpeg12_restore(struct amvdec_session *sess)
+{
+	struct codec_mpeg12 *mpeg12 = sess->priv;
+	struct amvdec_core *core = sess->core;
+	int i;
+
+	amvdec_write_dos(core, POWER_CTL_VLD, BIT(4));
+	for (i = 0; i < ARRAY_SIZE(codec_mpeg12_ctx_regs); ++i)
+		amvdec_write_dos(core, codec_mpeg12_ctx_regs[i],
+				 mpeg12->ctx_regs[i]);
+
+	return 0;
+}
+
+/*
+ * Called once CAPTURE was reconfigured for the new resolution. The firmware
+ * keeps running, only the canvases need to be remapped.
+ */
+static void codec_mpeg12_resume(struct amvdec_session *sess)
+{
+	struct codec_mpeg12 *mpeg12 = sess->priv;
+	struct amvdec_core *core = sess->core;
+
+	if (amvdec_set_canvases(sess, (u32[]){ AV_SCRATCH_0, 0 },
+				(u32[]){ 8, 0 })) {
+		amvdec_abort(sess);
+		return;
+	}
+
+	amvdec_write_dos(core, MREG_CMD, (sess->width << 16) | sess->height);
+
+	if (!mpeg12->res_changed)
+		return;
+
+	/*
+	 * The frame that revealed the new size was decoded in a buffer laid
+	 * out for the old one: give it back to the firmware and let it go on.
+	 */
+	mpeg12->res_changed = 0;
+	if (codec_mpeg12_can_recycle(core))
+		codec_mpeg12_recycle(core, mpeg12->held_idx);
+	amvdec_write_dos(core, MREG_BUFFEROUT, 0);
+}
+
+/*
+ * The firmware gives no notice of sequence header changes, so a resolution
+ * change is only seen on the first frame decoded at the new size. Hold the
+ * firmware on it until CAPTURE is reconfigured.
+ */
+static bool codec_mpeg12_src_change(struct amvdec_session *sess,
+				    u32 buffer_index)
+{
+	struct codec_mpeg12 *mpeg12 = sess->priv;
+	struct amvdec_core *core = sess->core;
+	struct vb2_v4l2_buffer *vbuf;
+	u32 width = amvdec_read_dos(core, MREG_PIC_WIDTH);
+	u32 height = amvdec_read_dos(core, MREG_PIC_HEIGHT);
+
+	if (!width || !height ||
+	    (width == sess->width && height == sess->height))
+		return false;
+
+	if (width > sess->fmt_out->max_width ||
+	    height > sess->fmt_out->max_height) {
+		dev_err(core->dev, "Unsupported video size: %ux%u\n",
+			width, height);
+		amvdec_abort(sess);
+		return true;
+	}
+
+	mpeg12->res_changed = 1;
+	mpeg12->held_idx = buffer_index;
+	amvdec_src_change(sess, width, height, sess->fmt_out->min_buffers);
+
+	/* All earlier frames are out, signal the end of the old sequence */
+	vbuf = v4l2_m2m_dst_buf_remove(sess->m2m_ctx);
+	if (vbuf) {
+		vbuf->vb2_buf.planes[0].bytesused = 0;
+		vbuf->flags |= V4L2_BUF_FLAG_LAST;
+		vbuf->sequence = sess->sequence_cap;
+		sess->sequence_cap = 0;
+		v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_DONE);
+	}
+
+	return true;
+}
+
 static void codec_mpeg12_update_dar(struct amvdec_session *sess)
 {
 	struct amvdec_core *core = sess->core;
@@ -152,6 +272,7 @@ static void codec_mpeg12_update_dar(struct amvdec_session *sess)
 
 static irqreturn_t codec_mpeg12_threaded_isr(struct amvdec_session *sess)
 {
+	struct codec_mpeg12 *mpeg12 = sess->priv;
 	struct amvdec_core *core = sess->core;
 	u32 reg;
 	u32 pic_info;
@@ -169,7 +290,7 @@ static irqreturn_t codec_mpeg12_threaded_isr(struct amvdec_session *sess)
 	}
 
 	reg = amvdec_read_dos(core, MREG_BUFFEROUT);
-	if (!reg)
+	if (!reg || mpeg12->res_changed)
 		return IRQ_HANDLED;
 
 	/* Unclear what this means */
@@ -184,8 +305,11 @@ static irqreturn_t codec_mpeg12_threaded_isr(struct amvdec_session *sess)
 			V4L2_FIELD_INTERLACED_TB :
 			V4L2_FIELD_INTERLACED_BT;
 
-	codec_mpeg12_update_dar(sess);
 	buffer_index = ((reg & 0xf) - 1) & 7;
+	if (codec_mpeg12_src_change(sess, buffer_index))
+		return IRQ_HANDLED;
+
+	codec_mpeg12_update_dar(sess);
 	offset = amvdec_read_dos(core, MREG_FRAME_OFFSET);
 	amvdec_dst_buf_done_idx(sess, buffer_index, offset, field);
 
@@ -207,4 +331,7 @@ struct amvdec_codec_ops codec_mpeg12_ops = {
 	.can_recycle = codec_mpeg12_can_recycle,
 	.recycle = codec_mpeg12_recycle,
 	.eos_sequence = codec_mpeg12_eos_sequence,
+	.save = codec_mpeg12_save,
+	.restore = codec_mpeg12_restore,
+	.resume = codec_mpeg12_resume,
 };
@@ -478,6 +478,9 @@ struct codec_vp9 {
 
 	struct vp9_frame *cur_frame;
 	struct vp9_frame *prev_frame;
+
+	/* Decoding is paused until a CAPTURE buffer is queued */
+	bool waiting_dst;
 };
 
 static int div_r32(s64 m, int n)
@@ -956,7 +959,8 @@ static void codec_vp9_set_sao(struct amvdec_session *sess,
 		val &= ~0x3;
 		if (!codec_hevc_use_fbc(sess->pixfmt_cap, vp9->is_10bit))
 			val |= BIT(0); /* disable cm compression */
-		/* TOFIX: Handle Amlogic Framebuffer compression */
+		if (sess->pixfmt_cap != V4L2_PIX_FMT_NV12M)
+			val |= BIT(1); /* disable double write */
 	}
 
 	amvdec_write_dos(core, HEVC_SAO_CTRL1, val);
@@ -1215,15 +1219,14 @@ static struct vp9_frame *codec_vp9_get_new_frame(struct amvdec_session *sess)
 	struct vb2_v4l2_buffer *vbuf;
 	struct vp9_frame *new_frame;
 
-	new_frame = kzalloc(sizeof(*new_frame), GFP_KERNEL);
-	if (!new_frame)
-		return NULL;
-
 	vbuf = get_free_vbuf(sess);
-	if (!vbuf) {
-		dev_err(sess->core->dev, "No dst buffer available\n");
-		kfree(new_frame);
-		return NULL;
+	if (!vbuf)
+		return ERR_PTR(-EAGAIN);
+
+	new_frame = kzalloc(sizeof(*new_frame), GFP_KERNEL);
+	if (!new_frame) {
+		v4l2_m2m_buf_queue(sess->m2m_ctx, vbuf);
+		return ERR_PTR(-ENOMEM);
 	}
 
 	new_frame->vbuf = vbuf;
@@ -1267,22 +1270,13 @@ static void codec_vp9_rm_noshow_frame(struct amvdec_session *sess)
 	}
 }
 
-static void codec_vp9_process_frame(struct amvdec_session *sess)
+static void codec_vp9_decode_frame(struct amvdec_session *sess)
 {
 	struct amvdec_core *core = sess->core;
 	struct codec_vp9 *vp9 = sess->priv;
 	union rpm_param *param = &vp9->rpm_param;
 	int intra_only;
 
-	if (!param->p.show_frame)
-		codec_vp9_rm_noshow_frame(sess);
-
-	vp9->cur_frame = codec_vp9_get_new_frame(sess);
-	if (!vp9->cur_frame) {
-		amvdec_abort(sess);
-		return;
-	}
-
 	pr_debug("frame %d: type: %08X; show_exist: %u; show: %u, intra_only: %u\n",
 		 vp9->cur_frame->index,
 		 param->p.frame_type, param->p.show_existing_frame,
@@ -1321,6 +1315,58 @@ static void codec_vp9_process_frame(struct amvdec_session *sess)
 	amvdec_write_dos(core, VP9_DEC_STATUS_REG, VP9_10B_DECODE_SLICE);
 }
 
+/*
+ * Get a CAPTURE buffer for the new frame and start decoding it.
+ * If none is available, decoding is paused until one is queued.
+ */
+static int codec_vp9_start_frame(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	struct vp9_frame *new_frame;
+
+	new_frame = codec_vp9_get_new_frame(sess);
+	if (IS_ERR(new_frame)) {
+		vp9->cur_frame = NULL;
+		if (PTR_ERR(new_frame) != -EAGAIN)
+			return PTR_ERR(new_frame);
+
+		dev_dbg(sess->core->dev, "No dst buffer available, pausing\n");
+		vp9->waiting_dst = true;
+		return 0;
+	}
+
+	vp9->waiting_dst = false;
+	vp9->cur_frame = new_frame;
+	codec_vp9_decode_frame(sess);
+
+	return 0;
+}
+
+static void codec_vp9_process_frame(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+	union rpm_param *param = &vp9->rpm_param;
+
+	if (!param->p.show_frame)
+		codec_vp9_rm_noshow_frame(sess);
+
+	if (codec_vp9_start_frame(sess))
+		amvdec_abort(sess);
+}
+
+static void codec_vp9_dst_buf_queued(struct amvdec_session *sess)
+{
+	struct codec_vp9 *vp9 = sess->priv;
+
+	if (!vp9)
+		return;
+
+	mutex_lock(&vp9->lock);
+	if (vp9->waiting_dst && codec_vp9_start_frame(sess))
+		amvdec_abort(sess);
+	mutex_unlock(&vp9->lock);
+}
+
 static void codec_vp9_process_lf(struct codec_vp9 *vp9)
 {
 	union rpm_param *param = &vp9->rpm_param;
@@ -2182,4 +2228,5 @@ struct amvdec_codec_ops codec_vp9_ops = {
 	.num_pending_bufs = codec_vp9_num_pending_bufs,
 	.drain = codec_vp9_flush_output,
 	.resume = codec_vp9_resume,
+	.dst_buf_queued = codec_vp9_dst_buf_queued,
 };
@@ -20,6 +20,7 @@
 #include "dos_regs.h"
 #include "esparser.h"
 #include "vdec_helpers.h"
+#include "vdec_trace.h"
 
 /* PARSER REGS (CBUS) */
 #define PARSER_CONTROL 0x00
@@ -54,13 +55,57 @@
 #define SEARCH_PATTERN_LEN	512
 #define VP9_HEADER_SIZE		16
 
-static DECLARE_WAIT_QUEUE_HEAD(wq);
-static int search_done;
+/* Time allowed to the ESPARSER for parsing a single packet */
+#define ESPARSER_TIMEOUT	(HZ / 5)
+
+/*
+ * Finish the submission in flight for sess, returning its src buffer with
+ * the given state, and try to queue the next src buffer.
+ */
+static void esparser_complete(struct amvdec_session *sess,
+			      enum vb2_buffer_state state)
+{
+	struct vb2_v4l2_buffer *vbuf = xchg(&sess->esparser_vbuf, NULL);
+
+	if (vbuf) {
+		if (state == VB2_BUF_STATE_DONE)
+			atomic_inc(&sess->esparser_queued_bufs);
+		else
+			amvdec_remove_ts(sess, vbuf->vb2_buf.timestamp);
+		trace_amvdec_es_done(sess, vbuf->vb2_buf.timestamp,
+				     state == VB2_BUF_STATE_DONE ?
+				     vb2_get_plane_payload(&vbuf->vb2_buf, 0) :
+				     0);
+		v4l2_m2m_buf_done(vbuf, state);
+	}
+
+	complete(&sess->esparser_done);
+	schedule_work(&sess->esparser_queue_work);
+}
+
+/* Detach and return the session owning the submission in flight, if any */
+static struct amvdec_session *
+esparser_take_inflight(struct amvdec_core *core, struct amvdec_session *sess)
+{
+	struct amvdec_session *cur;
+	unsigned long flags;
+
+	spin_lock_irqsave(&core->esparser_lock, flags);
+	cur = core->esparser_sess;
+	if (sess && cur != sess)
+		cur = NULL;
+	if (cur)
+		core->esparser_sess = NULL;
+	spin_unlock_irqrestore(&core->esparser_lock, flags);
+
+	return cur;
+}
 
 static irqreturn_t esparser_isr(int irq, void *dev)
 {
 	int int_status;
 	struct amvdec_core *core = dev;
+	struct amvdec_session *sess;
 
 	int_status = amvdec_read_parser(core, PARSER_INT_STATUS);
 	amvdec_write_parser(core, PARSER_INT_STATUS, int_status);
@@ -68,13 +113,55 @@ static irqreturn_t esparser_isr(int irq, void *dev)
 	if (int_status & PARSER_INTSTAT_SC_FOUND) {
 		amvdec_write_parser(core, PFIFO_RD_PTR, 0);
 		amvdec_write_parser(core, PFIFO_WR_PTR, 0);
-		search_done = 1;
-		wake_up_interruptible(&wq);
+
+		sess = esparser_take_inflight(core, NULL);
+		if (sess) {
+			cancel_delayed_work(&sess->esparser_timeout_work);
+			esparser_complete(sess, VB2_BUF_STATE_DONE);
+		}
 	}
 
 	return IRQ_HANDLED;
 }
 
+void esparser_timeout(struct work_struct *work)
+{
+	struct amvdec_session *sess =
+		container_of(work, struct amvdec_session,
+			     esparser_timeout_work.work);
+	struct amvdec_core *core = sess->core;
+
+	if (!esparser_take_inflight(core, sess))
+		return;
+
+	dev_warn(core->dev, "esparser: input parsing error\n");
+	amvdec_write_parser(core, PARSER_FETCH_CMD, 0);
+	esparser_complete(sess, VB2_BUF_STATE_ERROR);
+}
+
+void esparser_cancel(struct amvdec_session *sess)
+{
+	cancel_delayed_work_sync(&sess->esparser_timeout_work);
+
+	if (!esparser_take_inflight(sess->core, sess))
+		return;
+
+	amvdec_write_parser(sess->core, PARSER_FETCH_CMD, 0);
+	esparser_complete(sess, VB2_BUF_STATE_ERROR);
+}
+
+void esparser_save(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+
+	/* The timeout work bounds the wait for the submission in flight */
+	while (READ_ONCE(core->esparser_sess) == sess)
+		wait_for_completion_timeout(&sess->esparser_done,
+					    ESPARSER_TIMEOUT);
+
+	sess->esparser_wp = amvdec_read_parser(core, PARSER_VIDEO_WP);
+}
+
 /*
  * VP9 frame headers need to be appended by a 16-byte long
  * Amlogic custom header
@@ -213,9 +300,29 @@ static u32 esparser_pad_start_code(struct amvdec_core *core,
 	return pad_size;
 }
 
+/*
+ * Start parsing a packet on behalf of sess. This does not wait for the
+ * parsing to be done: the ESPARSER ISR completes it, or the timeout work
+ * if the start code is never found.
+ */
 static int
-esparser_write_data(struct amvdec_core *core, dma_addr_t addr, u32 size)
+esparser_write_data(struct amvdec_session *sess, dma_addr_t addr, u32 size)
 {
+	struct amvdec_core *core = sess->core;
+	unsigned long flags;
+
+	spin_lock_irqsave(&core->esparser_lock, flags);
+	/* Only the session owning the vdec may write to its VIFIFO */
+	if (core->esparser_sess || core->cur_sess != sess) {
+		spin_unlock_irqrestore(&core->esparser_lock, flags);
+		return -EBUSY;
+	}
+	core->esparser_sess = sess;
+	reinit_completion(&sess->esparser_done);
+	spin_unlock_irqrestore(&core->esparser_lock, flags);
+
+	schedule_delayed_work(&sess->esparser_timeout_work, ESPARSER_TIMEOUT);
+
 	amvdec_write_parser(core, PFIFO_RD_PTR, 0);
 	amvdec_write_parser(core, PFIFO_WR_PTR, 0);
 	amvdec_write_parser(core, PARSER_CONTROL,
@@ -229,8 +336,7 @@ esparser_write_data(struct amvdec_core *core, dma_addr_t addr, u32 size)
 			    (7 << FETCH_ENDIAN_BIT) |
 			    (size + SEARCH_PATTERN_LEN));
 
-	search_done = 0;
-	return wait_event_interruptible_timeout(wq, search_done, (HZ / 5));
+	return 0;
 }
 
 static u32 esparser_vififo_get_free_space(struct amvdec_session *sess)
@@ -253,9 +359,9 @@ static u32 esparser_vififo_get_free_space(struct amvdec_session *sess)
 	return sess->vififo_size - vififo_usage;
 }
 
-int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len)
+int esparser_queue_eos(struct amvdec_session *sess, const u8 *data, u32 len)
 {
-	struct device *dev = core->dev;
+	struct device *dev = sess->core->dev;
 	void *eos_vaddr;
 	dma_addr_t eos_paddr;
 	int ret;
@@ -266,7 +372,16 @@ int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len)
 		return -ENOMEM;
 
 	memcpy(eos_vaddr, data, len);
-	ret = esparser_write_data(core, eos_paddr, len);
+
+	/* Let a src buffer still being parsed go first */
+	while ((ret = esparser_write_data(sess, eos_paddr, len)) == -EBUSY)
+		wait_for_completion_timeout(&sess->esparser_done,
+					    ESPARSER_TIMEOUT);
+
+	/* Completed by either the ISR or the timeout work */
+	if (!ret)
+		wait_for_completion(&sess->esparser_done);
+
 	dma_free_coherent(dev, len + SEARCH_PATTERN_LEN,
 			  eos_vaddr, eos_paddr);
 
@@ -301,20 +416,22 @@ esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
 	u32 offset;
 	u32 pad_size;
 
+	/* Switched out sessions wait for their next time slice */
+	if (READ_ONCE(core->cur_sess) != sess)
+		return -EAGAIN;
+
+	/* The ISR will queue the next buffer once the parser is idle */
+	if (READ_ONCE(core->esparser_sess))
+		return -EAGAIN;
+
 	if (codec_ops->num_pending_bufs) {
 		num_dst_bufs = codec_ops->num_pending_bufs(sess);
 		num_dst_bufs += v4l2_m2m_num_dst_bufs_ready(sess->m2m_ctx);
 		/*
-		 * When max ref frame is held by VP9, this should be -= 4
-		 * to prevent a shortage of CAPTURE buffers on the decoder side.
-		 * For the future, a good enhancement of the way this is handled
-		 * could be to notify new capture buffers to the decoding
-		 * modules, so that they could pause when there is no capture
-		 * buffer available and resume on this notification.
+		 * Codecs holding references pause when no CAPTURE buffer is
+		 * available and resume when notified of a new one through
+		 * dst_buf_queued, so no reserve needs to be kept here.
 		 */
-		if (sess->fmt_out->pixfmt == V4L2_PIX_FMT_VP9)
-			num_dst_bufs -= 4;
-
 		if (esparser_vififo_get_free_space(sess) < payload_size ||
 		    atomic_read(&sess->esparser_queued_bufs) >= num_dst_bufs)
 			return -EAGAIN;
@@ -347,21 +464,20 @@ esparser_queue(struct amvdec_session *sess, struct vb2_v4l2_buffer *vbuf)
 	}
 
 	pad_size = esparser_pad_start_code(core, vb, payload_size);
-	ret = esparser_write_data(core, phy, payload_size + pad_size);
-
-	if (ret <= 0) {
-		dev_warn(core->dev, "esparser: input parsing error\n");
+	sess->esparser_vbuf = vbuf;
+	ret = esparser_write_data(sess, phy, payload_size + pad_size);
+	if (ret) {
+		sess->esparser_vbuf = NULL;
 		amvdec_remove_ts(sess, vb->timestamp);
 		v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_ERROR);
-		amvdec_write_parser(core, PARSER_FETCH_CMD, 0);
 
 		return 0;
 	}
 
-	atomic_inc(&sess->esparser_queued_bufs);
-	v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_DONE);
+	trace_amvdec_es_write(sess, vb->timestamp, payload_size);
 
-	return 0;
+	/* Only one packet can be parsed at a time */
+	return -EINPROGRESS;
 }
 
 void esparser_queue_all_src(struct work_struct *work)
@@ -411,6 +527,9 @@ int esparser_power_up(struct amvdec_session *sess)
 	amvdec_write_parser(core, PARSER_VIDEO_START_PTR, sess->vififo_paddr);
 	amvdec_write_parser(core, PARSER_VIDEO_END_PTR,
 			    sess->vififo_paddr + sess->vififo_size - 8);
+	/* Resume writing where the session left off if it was switched out */
+	if (sess->esparser_wp)
+		amvdec_write_parser(core, PARSER_VIDEO_WP, sess->esparser_wp);
 	amvdec_write_parser(core, PARSER_ES_CONTROL,
 			    amvdec_read_parser(core, PARSER_ES_CONTROL) & ~1);
 
@@ -434,6 +553,8 @@ int esparser_init(struct platform_device *pdev, struct amvdec_core *core)
 	if (irq < 0)
 		return irq;
 
+	spin_lock_init(&core->esparser_lock);
+
 	ret = devm_request_irq(dev, irq, esparser_isr, IRQF_SHARED,
 			       "esparserirq", core);
 	if (ret) {
@@ -17,9 +17,31 @@ int esparser_power_up(struct amvdec_session *sess);
 /**
  * esparser_queue_eos() - write End Of Stream sequence to the ESPARSER
  *
- * @core vdec core struct
+ * @sess current session
  */
-int esparser_queue_eos(struct amvdec_core *core, const u8 *data, u32 len);
+int esparser_queue_eos(struct amvdec_session *sess, const u8 *data, u32 len);
+
+/**
+ * esparser_timeout() - work handler that gives up on a src buffer the
+ * ESPARSER could not parse in time
+ */
+void esparser_timeout(struct work_struct *work);
+
+/**
+ * esparser_cancel() - return the src buffer still being parsed for the
+ * session, if any
+ *
+ * @sess current session
+ */
+void esparser_cancel(struct amvdec_session *sess);
+
+/**
+ * esparser_save() - wait for the src buffer being parsed for the session, if
+ * any, and save the VIFIFO write pointer before switching it out
+ *
+ * @sess current session
+ */
+void esparser_save(struct amvdec_session *sess);
 
 /**
  * esparser_queue_all_src() - work handler that writes as many src buffers
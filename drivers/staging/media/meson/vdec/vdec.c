@@ -13,6 +13,8 @@
 #include <linux/slab.h>
 #include <linux/interrupt.h>
 #include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/dma-contiguous.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-event.h>
 #include <media/v4l2-ctrls.h>
@@ -23,6 +25,8 @@
 #include "vdec.h"
 #include "esparser.h"
 #include "vdec_helpers.h"
+#include "vdec_fw.h"
+#include "vdec_trace.h"
 
 struct dummy_buf {
 	struct vb2_v4l2_buffer vb;
@@ -32,6 +36,26 @@ struct dummy_buf {
 /* 16 MiB for parsed bitstream swap exchange */
 #define SIZE_VIFIFO SZ_16M
 
+static unsigned int sched_slice_ms;
+module_param(sched_slice_ms, uint, 0644);
+MODULE_PARM_DESC(sched_slice_ms,
+		 "Decoding time slice of sessions sharing the vdec in ms, 0 to give it to one session only");
+
+static bool cached_capture;
+module_param(cached_capture, bool, 0444);
+MODULE_PARM_DESC(cached_capture,
+		 "Allocate cacheable capture buffers, for clients that read decoded frames with the CPU");
+
+static unsigned int capture_pool_mb;
+module_param(capture_pool_mb, uint, 0444);
+MODULE_PARM_DESC(capture_pool_mb,
+		 "Keep up to this many MiB of freed capture buffers for reuse by the next stream, 0 to disable");
+
+static unsigned int cma_evacuate_mb;
+module_param(cma_evacuate_mb, uint, 0644);
+MODULE_PARM_DESC(cma_evacuate_mb,
+		 "Clear this many MiB of the CMA area out in the background when the device is opened, 0 to disable");
+
 static u32 get_output_size(u32 width, u32 height)
 {
 	return ALIGN(width * height, SZ_64K);
@@ -58,9 +82,12 @@ static int vdec_recycle_thread(void *data)
 	struct amvdec_buffer *tmp, *n;
 
 	while (!kthread_should_stop()) {
+		mutex_lock(&core->sched_lock);
 		mutex_lock(&sess->bufs_recycle_lock);
 		list_for_each_entry_safe(tmp, n, &sess->bufs_recycle, list) {
-			if (!codec_ops->can_recycle(core))
+			/* Switched out sessions recycle on their next slice */
+			if (core->cur_sess != sess ||
+			    !codec_ops->can_recycle(core))
 				break;
 
 			codec_ops->recycle(core, tmp->vb->index);
@@ -68,6 +95,7 @@ static int vdec_recycle_thread(void *data)
 			kfree(tmp);
 		}
 		mutex_unlock(&sess->bufs_recycle_lock);
+		mutex_unlock(&core->sched_lock);
 
 		usleep_range(5000, 10000);
 	}
@@ -88,7 +116,10 @@ static int vdec_poweron(struct amvdec_session *sess)
 	if (ret)
 		goto disable_dos_parser;
 
-	ret = vdec_ops->start(sess);
+	if (sess->ctx_saved)
+		ret = vdec_ops->restore(sess);
+	else
+		ret = vdec_ops->start(sess);
 	if (ret)
 		goto disable_dos;
 
@@ -127,6 +158,271 @@ static void vdec_poweroff(struct amvdec_session *sess)
 	clk_disable_unprepare(sess->core->dos_parser_clk);
 }
 
+static void
+vdec_set_cur_sess(struct amvdec_core *core, struct amvdec_session *sess)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&core->esparser_lock, flags);
+	core->cur_sess = sess;
+	spin_unlock_irqrestore(&core->esparser_lock, flags);
+}
+
+static bool vdec_can_share(struct amvdec_session *sess)
+{
+	const struct amvdec_format *fmt = sess->fmt_out;
+
+	return sched_slice_ms && fmt->vdec_ops->save && fmt->codec_ops->save;
+}
+
+/* Sessions may only share the vdec if all of them can be switched out */
+static bool vdec_sched_can_join(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct amvdec_session *first;
+	bool ret = true;
+
+	mutex_lock(&core->sched_lock);
+	if (list_empty(&sess->sched_node) && !list_empty(&core->sched_list)) {
+		first = list_first_entry(&core->sched_list,
+					 struct amvdec_session, sched_node);
+		ret = vdec_can_share(sess) && vdec_can_share(first);
+	}
+	mutex_unlock(&core->sched_lock);
+
+	return ret;
+}
+
+static void
+vdec_sched_account(struct amvdec_core *core, struct amvdec_session *sess)
+{
+	ktime_t now = ktime_get();
+
+	sess->decode_time = ktime_add(sess->decode_time,
+				      ktime_sub(now, core->slice_start));
+	core->slice_start = now;
+}
+
+static bool vdec_sess_has_work(struct amvdec_session *sess)
+{
+	return v4l2_m2m_num_src_bufs_ready(sess->m2m_ctx) ||
+	       atomic_read(&sess->esparser_queued_bufs);
+}
+
+/* Find the next session with data to decode, in round-robin order */
+static struct amvdec_session *vdec_sched_next(struct amvdec_core *core)
+{
+	struct amvdec_session *cur = core->cur_sess;
+	struct amvdec_session *sess;
+
+	sess = list_prepare_entry(cur, &core->sched_list, sched_node);
+	list_for_each_entry_continue(sess, &core->sched_list, sched_node) {
+		if (vdec_sess_has_work(sess))
+			return sess;
+	}
+
+	list_for_each_entry(sess, &core->sched_list, sched_node) {
+		if (sess == cur)
+			break;
+
+		if (vdec_sess_has_work(sess))
+			return sess;
+	}
+
+	return NULL;
+}
+
+/*
+ * Called with sess->lock held, so the esparser queue work of the session
+ * is not in the middle of a submission and will bail out on its next run
+ * once cur_sess no longer points to it.
+ */
+static int vdec_sched_save(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct amvdec_ops *vdec_ops = sess->fmt_out->vdec_ops;
+	int ret;
+
+	lockdep_assert_held(&sess->lock);
+
+	/* Stop feeding the VIFIFO and let the last src buffer land in it */
+	vdec_set_cur_sess(core, NULL);
+	esparser_save(sess);
+
+	ret = vdec_ops->save(sess);
+	if (ret) {
+		vdec_set_cur_sess(core, sess);
+		schedule_work(&sess->esparser_queue_work);
+		return ret;
+	}
+
+	clk_disable_unprepare(core->dos_clk);
+	clk_disable_unprepare(core->dos_parser_clk);
+
+	vdec_sched_account(core, sess);
+	sess->ctx_saved = 1;
+
+	return 0;
+}
+
+static int vdec_sched_restore(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int ret;
+
+	ret = vdec_poweron(sess);
+	if (ret)
+		return ret;
+
+	core->slice_start = ktime_get();
+	sess->nr_switches++;
+	vdec_set_cur_sess(core, sess);
+
+	/* CAPTURE was reconfigured while the session was switched out */
+	if (sess->resume_pending) {
+		sess->resume_pending = 0;
+		sess->fmt_out->codec_ops->resume(sess);
+	}
+
+	schedule_work(&sess->esparser_queue_work);
+
+	return 0;
+}
+
+static void vdec_sched_work(struct work_struct *work)
+{
+	struct amvdec_core *core =
+		container_of(work, struct amvdec_core, sched_work);
+	struct amvdec_session *cur, *next;
+	int ret;
+
+	mutex_lock(&core->sched_lock);
+	cur = core->cur_sess;
+
+	/* Let the current session run until it idles or its slice expires */
+	if (cur && vdec_sess_has_work(cur) &&
+	    ktime_ms_delta(ktime_get(), core->slice_start) < sched_slice_ms)
+		goto unlock;
+
+	next = vdec_sched_next(core);
+	if (!next)
+		goto unlock;
+
+	/*
+	 * sess->lock is taken before sched_lock on the ioctl side (STREAMOFF
+	 * ends up in vdec_sched_remove()), so only try it here. Whoever holds
+	 * it will kick the scheduler again, or we retry on the next frame.
+	 */
+	if (cur && !mutex_trylock(&cur->lock)) {
+		schedule_work(&core->sched_work);
+		goto unlock;
+	}
+
+	disable_irq(core->irq);
+	if (cur) {
+		/* -EAGAIN means the firmware is mid-frame, retry later */
+		ret = vdec_sched_save(cur);
+		mutex_unlock(&cur->lock);
+		if (ret)
+			goto enable_irq;
+	}
+
+	ret = vdec_sched_restore(next);
+	if (ret) {
+		dev_err(core->dev, "Failed to switch sessions: %d\n", ret);
+		amvdec_abort(next);
+	}
+
+enable_irq:
+	enable_irq(core->irq);
+unlock:
+	mutex_unlock(&core->sched_lock);
+}
+
+void amvdec_sched_frame_done(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+
+	if (READ_ONCE(core->sched_count) < 2)
+		return;
+
+	if (vdec_sess_has_work(sess) &&
+	    ktime_ms_delta(ktime_get(), core->slice_start) < sched_slice_ms)
+		return;
+
+	schedule_work(&core->sched_work);
+}
+EXPORT_SYMBOL_GPL(amvdec_sched_frame_done);
+
+/* Start decoding right away if the vdec is free, else wait for a slice */
+static int vdec_sched_add(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	int ret = 0;
+
+	mutex_lock(&core->sched_lock);
+	sess->ctx_saved = 0;
+	sess->resume_pending = 0;
+	sess->decode_time = 0;
+	sess->nr_switches = 0;
+
+	if (!core->cur_sess) {
+		ret = vdec_poweron(sess);
+		if (ret)
+			goto unlock;
+
+		core->slice_start = ktime_get();
+		sess->nr_switches++;
+		vdec_set_cur_sess(core, sess);
+	}
+
+	list_add_tail(&sess->sched_node, &core->sched_list);
+	core->sched_count++;
+
+unlock:
+	mutex_unlock(&core->sched_lock);
+	return ret;
+}
+
+/* The codec can only be reconfigured while its session owns the vdec */
+static void vdec_sched_resume(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+
+	mutex_lock(&core->sched_lock);
+	if (core->cur_sess == sess)
+		sess->fmt_out->codec_ops->resume(sess);
+	else
+		sess->resume_pending = 1;
+	mutex_unlock(&core->sched_lock);
+}
+
+static void vdec_sched_remove(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+	bool others;
+
+	mutex_lock(&core->sched_lock);
+	if (core->cur_sess == sess) {
+		vdec_poweroff(sess);
+		vdec_sched_account(core, sess);
+		vdec_set_cur_sess(core, NULL);
+	} else if (sess->priv) {
+		/* Switched out, only the codec state is left to free */
+		codec_ops->stop(sess);
+	}
+
+	list_del_init(&sess->sched_node);
+	core->sched_count--;
+	others = !list_empty(&core->sched_list);
+	mutex_unlock(&core->sched_lock);
+
+	/* Hand the vdec over to the next session */
+	if (others)
+		schedule_work(&core->sched_work);
+}
+
 static void
 vdec_queue_recycle(struct amvdec_session *sess, struct vb2_buffer *vb)
 {
@@ -215,6 +511,12 @@ static int vdec_queue_setup(struct vb2_queue *q, unsigned int *num_buffers,
 				    sizes[2] < output_size / 4)
 					return -EINVAL;
 				break;
+			case V4L2_PIX_FMT_AM21C:
+				if (*num_planes != 1 ||
+				    sizes[0] < amvdec_am21c_size(sess->width,
+								 sess->height))
+					return -EINVAL;
+				break;
 			default:
 				return -EINVAL;
 			}
@@ -244,6 +546,10 @@ static int vdec_queue_setup(struct vb2_queue *q, unsigned int *num_buffers,
 			sizes[2] = output_size / 4;
 			*num_planes = 3;
 			break;
+		case V4L2_PIX_FMT_AM21C:
+			sizes[0] = amvdec_am21c_size(sess->width, sess->height);
+			*num_planes = 1;
+			break;
 		default:
 			return -EINVAL;
 		}
@@ -262,6 +568,7 @@ static void vdec_vb2_buf_queue(struct vb2_buffer *vb)
 {
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 	struct amvdec_session *sess = vb2_get_drv_priv(vb->vb2_queue);
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
 	struct v4l2_m2m_ctx *m2m_ctx = sess->m2m_ctx;
 
 	v4l2_m2m_buf_queue(m2m_ctx, vbuf);
@@ -270,22 +577,30 @@ static void vdec_vb2_buf_queue(struct vb2_buffer *vb)
 		return;
 
 	if (sess->streamon_cap &&
-	    vb->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE &&
-	    vdec_codec_needs_recycle(sess))
-		vdec_queue_recycle(sess, vb);
+	    vb->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
+		if (vdec_codec_needs_recycle(sess))
+			vdec_queue_recycle(sess, vb);
+
+		if (codec_ops->dst_buf_queued &&
+		    sess->status == STATUS_RUNNING)
+			codec_ops->dst_buf_queued(sess);
+	}
 
 	schedule_work(&sess->esparser_queue_work);
+
+	/* Switched out sessions may take over an idle vdec */
+	if (sess->core->cur_sess != sess)
+		schedule_work(&sess->core->sched_work);
 }
 
 static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 {
 	struct amvdec_session *sess = vb2_get_drv_priv(q);
-	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
 	struct amvdec_core *core = sess->core;
 	struct vb2_v4l2_buffer *buf;
 	int ret;
 
-	if (core->cur_sess && core->cur_sess != sess) {
+	if (!vdec_sched_can_join(sess)) {
 		ret = -EBUSY;
 		goto bufs_done;
 	}
@@ -301,7 +616,7 @@ static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 	if (sess->status == STATUS_NEEDS_RESUME &&
 	    q->type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE &&
 	    sess->changed_format) {
-		codec_ops->resume(sess);
+		vdec_sched_resume(sess);
 		sess->status = STATUS_RUNNING;
 		return 0;
 	}
@@ -327,12 +642,23 @@ static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 	sess->wrap_count = 0;
 	sess->pixelaspect.numerator = 1;
 	sess->pixelaspect.denominator = 1;
+	sess->esparser_wp = 0;
 	atomic_set(&sess->esparser_queued_bufs, 0);
 	v4l2_ctrl_s_ctrl(sess->ctrl_min_buf_capture, 1);
 
-	ret = vdec_poweron(sess);
+	/*
+	 * Reserve the canvases now if the CAPTURE buffers are already known,
+	 * so a lack of canvases is reported here instead of mid-stream
+	 */
+	if (sess->streamon_cap) {
+		ret = amvdec_reserve_canvases(sess, sess->num_dst_bufs);
+		if (ret)
+			goto vififo_free;
+	}
+
+	ret = vdec_sched_add(sess);
 	if (ret)
-		goto vififo_free;
+		goto canvases_release;
 
 	sess->sequence_cap = 0;
 	sess->sequence_out = 0;
@@ -341,10 +667,13 @@ static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 						   "vdec_recycle");
 
 	sess->status = STATUS_INIT;
-	core->cur_sess = sess;
 	schedule_work(&sess->esparser_queue_work);
+	if (core->cur_sess != sess)
+		schedule_work(&core->sched_work);
 	return 0;
 
+canvases_release:
+	amvdec_release_canvases(sess);
 vififo_free:
 	dma_free_coherent(sess->core->dev, sess->vififo_size,
 			  sess->vififo_vaddr, sess->vififo_paddr);
@@ -362,24 +691,16 @@ static int vdec_start_streaming(struct vb2_queue *q, unsigned int count)
 	return ret;
 }
 
-static void vdec_free_canvas(struct amvdec_session *sess)
-{
-	int i;
-
-	for (i = 0; i < sess->canvas_num; ++i)
-		meson_canvas_free(sess->core->canvas, sess->canvas_alloc[i]);
-
-	sess->canvas_num = 0;
-}
-
 static void vdec_reset_timestamps(struct amvdec_session *sess)
 {
-	struct amvdec_timestamp *tmp, *n;
-
-	list_for_each_entry_safe(tmp, n, &sess->timestamps, list) {
-		list_del(&tmp->list);
-		kfree(tmp);
-	}
+	unsigned long flags;
+
+	spin_lock_irqsave(&sess->ts_spinlock, flags);
+	memset(sess->ts_ring, 0, sizeof(sess->ts_ring));
+	sess->ts_head = 0;
+	sess->ts_tail = 0;
+	sess->ts_count = 0;
+	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 }
 
 static void vdec_reset_bufs_recycle(struct amvdec_session *sess)
@@ -396,7 +717,6 @@ static void vdec_stop_streaming(struct vb2_queue *q)
 {
 	struct amvdec_session *sess = vb2_get_drv_priv(q);
 	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	struct amvdec_core *core = sess->core;
 	struct vb2_v4l2_buffer *buf;
 
 	if (sess->status == STATUS_RUNNING ||
@@ -406,19 +726,20 @@ static void vdec_stop_streaming(struct vb2_queue *q)
 		if (vdec_codec_needs_recycle(sess))
 			kthread_stop(sess->recycle_thread);
 
-		vdec_poweroff(sess);
-		vdec_free_canvas(sess);
+		esparser_cancel(sess);
+		vdec_sched_remove(sess);
+		amvdec_release_canvases(sess);
 		dma_free_coherent(sess->core->dev, sess->vififo_size,
 				  sess->vififo_vaddr, sess->vififo_paddr);
 		vdec_reset_timestamps(sess);
 		vdec_reset_bufs_recycle(sess);
 		kfree(sess->priv);
 		sess->priv = NULL;
-		core->cur_sess = NULL;
 		sess->status = STATUS_STOPPED;
 	}
 
 	if (q->type == V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE) {
+		esparser_cancel(sess);
 		while ((buf = v4l2_m2m_src_buf_remove(sess->m2m_ctx)))
 			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_ERROR);
 
@@ -431,15 +752,98 @@ static void vdec_stop_streaming(struct vb2_queue *q)
 		while ((buf = v4l2_m2m_dst_buf_remove(sess->m2m_ctx)))
 			v4l2_m2m_buf_done(buf, VB2_BUF_STATE_ERROR);
 
+		/* The dmabufs may be re-imported elsewhere on restart */
+		memset(sess->dst_paddr, 0, sizeof(sess->dst_paddr));
 		sess->streamon_cap = 0;
 	}
 }
 
+static u32 vdec_dst_plane_size(struct amvdec_session *sess, unsigned int plane)
+{
+	u32 output_size = amvdec_get_output_size(sess);
+
+	if (sess->pixfmt_cap == V4L2_PIX_FMT_AM21C)
+		return amvdec_am21c_size(sess->width, sess->height);
+
+	if (!plane)
+		return output_size;
+
+	if (sess->pixfmt_cap == V4L2_PIX_FMT_NV12M)
+		return output_size / 2;
+
+	return output_size / 4;
+}
+
+/*
+ * Imported CAPTURE buffers are written to directly by the HW, through the
+ * canvases and the HEVC AXI tables. Each plane must be big enough for the
+ * current format and suitably aligned. The plane addresses are programmed
+ * once when decoding starts, so a buffer index can't be backed by another
+ * dmabuf until the CAPTURE queue is stopped.
+ */
+static int vdec_dst_buf_prepare_dmabuf(struct amvdec_session *sess,
+				       struct vb2_buffer *vb)
+{
+	struct device *dev = sess->core->dev;
+	bool latched = sess->streamon_cap &&
+		       (sess->status == STATUS_INIT ||
+			sess->status == STATUS_RUNNING);
+	dma_addr_t paddr[MAX_DST_PLANES];
+	unsigned int i, j;
+
+	if (WARN_ON(vb->num_planes > MAX_DST_PLANES))
+		return -EINVAL;
+
+	for (i = 0; i < vb->num_planes; ++i) {
+		paddr[i] = vb2_dma_contig_plane_dma_addr(vb, i);
+
+		if (vb2_plane_size(vb, i) < vdec_dst_plane_size(sess, i)) {
+			dev_dbg(dev, "buf %u: plane %u too small (%lu)\n",
+				vb->index, i, vb2_plane_size(vb, i));
+			return -EINVAL;
+		}
+
+		if (!IS_ALIGNED(paddr[i], DST_PLANE_ALIGN)) {
+			dev_dbg(dev, "buf %u: plane %u at %pad is misaligned\n",
+				vb->index, i, &paddr[i]);
+			return -EINVAL;
+		}
+
+		/* All the planes are written concurrently */
+		for (j = 0; j < i; ++j) {
+			if (paddr[i] < paddr[j] + vb2_plane_size(vb, j) &&
+			    paddr[j] < paddr[i] + vb2_plane_size(vb, i)) {
+				dev_dbg(dev, "buf %u: planes %u and %u overlap\n",
+					vb->index, j, i);
+				return -EINVAL;
+			}
+		}
+
+		if (latched && sess->dst_paddr[vb->index][i] &&
+		    sess->dst_paddr[vb->index][i] != paddr[i]) {
+			dev_dbg(dev, "buf %u: dmabuf changed while streaming\n",
+				vb->index);
+			return -EINVAL;
+		}
+	}
+
+	for (i = 0; i < vb->num_planes; ++i)
+		sess->dst_paddr[vb->index][i] = paddr[i];
+
+	return 0;
+}
+
 static int vdec_vb2_buf_prepare(struct vb2_buffer *vb)
 {
+	struct amvdec_session *sess = vb2_get_drv_priv(vb->vb2_queue);
 	struct vb2_v4l2_buffer *vbuf = to_vb2_v4l2_buffer(vb);
 
 	vbuf->field = V4L2_FIELD_NONE;
+
+	if (vb->memory == VB2_MEMORY_DMABUF &&
+	    !V4L2_TYPE_IS_OUTPUT(vb->vb2_queue->type))
+		return vdec_dst_buf_prepare_dmabuf(sess, vb);
+
 	return 0;
 }
 
@@ -548,6 +952,12 @@ vdec_try_fmt_common(struct amvdec_session *sess, u32 size,
 			pfmt[2].sizeimage = output_size / 2;
 			pfmt[2].bytesperline = ALIGN(pixmp->width, 32) / 2;
 			pixmp->num_planes = 3;
+		} else if (pixmp->pixelformat == V4L2_PIX_FMT_AM21C) {
+			/* Compressed body and headers in a single plane */
+			pfmt[0].sizeimage = amvdec_am21c_size(pixmp->width,
+							      pixmp->height);
+			pfmt[0].bytesperline = 0;
+			pixmp->num_planes = 1;
 		}
 	}
 
@@ -750,7 +1160,7 @@ vdec_decoder_cmd(struct file *file, void *fh, struct v4l2_decoder_cmd *cmd)
 		u32 len;
 		const u8 *data = codec_ops->eos_sequence(&len);
 
-		esparser_queue_eos(sess->core, data, len);
+		esparser_queue_eos(sess, data, len);
 		vdec_wait_inactive(sess);
 	}
 
@@ -841,6 +1251,11 @@ static int m2m_queue_init(void *priv, struct vb2_queue *src_vq,
 	dst_vq->min_buffers_needed = 1;
 	dst_vq->dev = sess->core->dev;
 	dst_vq->lock = &sess->lock;
+	dst_vq->buf_pool = sess->core->buf_pool;
+	if (cached_capture) {
+		dst_vq->non_coherent_mem = 1;
+		dst_vq->allow_cache_hints = 1;
+	}
 	ret = vb2_queue_init(dst_vq);
 	if (ret) {
 		vb2_queue_release(src_vq);
@@ -913,9 +1328,11 @@ static int vdec_open(struct file *file)
 	sess->pixelaspect.denominator = 1;
 	sess->src_buffer_size = SZ_1M;
 
-	INIT_LIST_HEAD(&sess->timestamps);
 	INIT_LIST_HEAD(&sess->bufs_recycle);
+	INIT_LIST_HEAD(&sess->sched_node);
 	INIT_WORK(&sess->esparser_queue_work, esparser_queue_all_src);
+	INIT_DELAYED_WORK(&sess->esparser_timeout_work, esparser_timeout);
+	init_completion(&sess->esparser_done);
 	mutex_init(&sess->lock);
 	mutex_init(&sess->bufs_recycle_lock);
 	spin_lock_init(&sess->ts_spinlock);
@@ -926,6 +1343,10 @@ static int vdec_open(struct file *file)
 	sess->fh.m2m_ctx = sess->m2m_ctx;
 	file->private_data = &sess->fh;
 
+	/* capture buffers come at REQBUFS, move pages out of their way until then */
+	if (cma_evacuate_mb)
+		dma_contiguous_evacuate(dev, (size_t)cma_evacuate_mb * SZ_1M);
+
 	return 0;
 
 err_m2m_release:
@@ -968,6 +1389,7 @@ static irqreturn_t vdec_isr(int irq, void *data)
 	struct amvdec_session *sess = core->cur_sess;
 
 	sess->last_irq_jiffies = get_jiffies_64();
+	trace_amvdec_isr(sess);
 
 	return sess->fmt_out->codec_ops->isr(sess);
 }
@@ -977,9 +1399,37 @@ static irqreturn_t vdec_threaded_isr(int irq, void *data)
 	struct amvdec_core *core = data;
 	struct amvdec_session *sess = core->cur_sess;
 
+	trace_amvdec_threaded_isr(sess);
+
 	return sess->fmt_out->codec_ops->threaded_isr(sess);
 }
 
+static int vdec_sessions_show(struct seq_file *s, void *data)
+{
+	struct amvdec_core *core = s->private;
+	struct amvdec_session *sess;
+	ktime_t decode_time;
+
+	mutex_lock(&core->sched_lock);
+	list_for_each_entry(sess, &core->sched_list, sched_node) {
+		decode_time = sess->decode_time;
+		if (sess == core->cur_sess)
+			decode_time = ktime_add(decode_time,
+						ktime_sub(ktime_get(),
+							  core->slice_start));
+
+		seq_printf(s, "%4.4s%s: %lld ms, %u switches, %u frames\n",
+			   (char *)&sess->fmt_out->pixfmt,
+			   sess == core->cur_sess ? " (running)" : "",
+			   ktime_to_ms(decode_time), sess->nr_switches,
+			   sess->sequence_cap);
+	}
+	mutex_unlock(&core->sched_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vdec_sessions);
+
 static const struct of_device_id vdec_dt_match[] = {
 	{ .compatible = "amlogic,gxbb-vdec",
 	  .data = &vdec_platform_gxbb },
@@ -1074,6 +1524,12 @@ static int vdec_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	core->irq = irq;
+	INIT_LIST_HEAD(&core->sched_list);
+	INIT_WORK(&core->sched_work, vdec_sched_work);
+	mutex_init(&core->sched_lock);
+	amvdec_fw_cache_init(core);
+
 	ret = esparser_init(pdev, core);
 	if (ret)
 		return ret;
@@ -1105,15 +1561,30 @@ static int vdec_probe(struct platform_device *pdev)
 
 	video_set_drvdata(vdev, core);
 
+	if (capture_pool_mb) {
+		core->buf_pool = vb2_buf_pool_create((unsigned long)
+						     capture_pool_mb * SZ_1M);
+		if (IS_ERR(core->buf_pool)) {
+			dev_warn(dev, "Couldn't create capture buffer pool\n");
+			core->buf_pool = NULL;
+		}
+	}
+
 	ret = video_register_device(vdev, VFL_TYPE_VIDEO, -1);
 	if (ret) {
 		dev_err(dev, "Failed registering video device\n");
 		goto err_vdev_release;
 	}
 
+	core->debugfs = debugfs_create_dir("meson-vdec", NULL);
+	debugfs_create_file("sessions", 0444, core->debugfs, core,
+			    &vdec_sessions_fops);
+	amvdec_fw_cache_debugfs_init(core);
+
 	return 0;
 
 err_vdev_release:
+	vb2_buf_pool_destroy(core->buf_pool);
 	video_device_release(vdev);
 	return ret;
 }
@@ -1122,7 +1593,11 @@ static int vdec_remove(struct platform_device *pdev)
 {
 	struct amvdec_core *core = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(core->debugfs);
 	video_unregister_device(core->vdev_dec);
+	cancel_work_sync(&core->sched_work);
+	amvdec_fw_cache_release(core);
+	vb2_buf_pool_destroy(core->buf_pool);
 
 	return 0;
 }
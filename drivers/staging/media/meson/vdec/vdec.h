@@ -8,6 +8,7 @@
 #define __MESON_VDEC_CORE_H_
 
 #include <linux/irqreturn.h>
+#include <linux/ktime.h>
 #include <linux/regmap.h>
 #include <linux/list.h>
 #include <media/videobuf2-v4l2.h>
@@ -20,28 +21,44 @@
 /* 32 buffers in 3-plane YUV420 */
 #define MAX_CANVAS (32 * 3)
 
+/* vdec registers saved while a session is switched out */
+#define MAX_CTX_REGS 32
+
+/* At most 3 planes (YUV420M) per CAPTURE buffer */
+#define MAX_DST_PLANES 3
+
+/*
+ * Canvases store addresses in 8-byte units and the HEVC AXI tables in 32-byte
+ * units; imported CAPTURE planes are required to be page aligned so that both
+ * are always satisfied.
+ */
+#define DST_PLANE_ALIGN PAGE_SIZE
+
 struct amvdec_buffer {
 	struct list_head list;
 	struct vb2_buffer *vb;
 };
 
+/* Pending src timestamps per session, must be a power of 2 */
+#define AMVDEC_TS_RING_SIZE 128
+
 /**
  * struct amvdec_timestamp - stores a src timestamp along with a VIFIFO offset
  *
- * @list: used to make lists out of this struct
  * @tc: timecode from the v4l2 buffer
  * @ts: timestamp from the VB2 buffer
  * @offset: offset in the VIFIFO where the associated packet was written
  * @flags: flags from the v4l2 buffer
  * @used_count: times this timestamp was checked for a match with a dst buffer
+ * @pending: whether this ring slot still holds an unmatched timestamp
  */
 struct amvdec_timestamp {
-	struct list_head list;
 	struct v4l2_timecode tc;
 	u64 ts;
 	u32 offset;
 	u32 flags;
 	u32 used_count;
+	bool pending;
 };
 
 struct amvdec_session;
@@ -61,9 +78,24 @@ struct amvdec_session;
  * @vdec_1_clk: VDEC_1 clock
  * @vdec_hevc_clk: VDEC_HEVC clock
  * @esparser_reset: RESET for the PARSER
+ * @esparser_sess: session owning the ESPARSER submission in flight
+ * @esparser_lock: lock for esparser_sess, also held to change cur_sess
  * @vdec_dec: video device for the decoder
  * @v4l2_dev: v4l2 device
  * @cur_sess: current decoding session
+ * @irq: vdec IRQ
+ * @sched_list: streaming sessions sharing the vdec, in round-robin order
+ * @sched_count: number of sessions in sched_list
+ * @sched_work: work struct switching the vdec to the next session
+ * @sched_lock: lock for cur_sess changes and sched_list
+ * @slice_start: time at which cur_sess was given the vdec
+ * @debugfs: debugfs directory of the decoder
+ * @fw_cache: firmware images kept resident, most recently used first
+ * @fw_lock: lock for fw_cache and the firmware statistics
+ * @fw_cache_size: total size of the images in fw_cache
+ * @fw_hits: number of firmware loads served from fw_cache
+ * @fw_misses: number of firmware loads that went through the loader
+ * @fw_load_time: total time spent in the firmware loader
  */
 struct amvdec_core {
 	void __iomem *dos_base;
@@ -83,12 +115,32 @@ struct amvdec_core {
 	struct clk *vdec_hevcf_clk;
 
 	struct reset_control *esparser_reset;
+	struct amvdec_session *esparser_sess;
+	spinlock_t esparser_lock; /* esparser_sess & cur_sess lock */
 
 	struct video_device *vdev_dec;
 	struct v4l2_device v4l2_dev;
 
 	struct amvdec_session *cur_sess;
 	struct mutex lock; /* video device lock */
+
+	int irq;
+	struct list_head sched_list;
+	unsigned int sched_count;
+	struct work_struct sched_work;
+	struct mutex sched_lock; /* cur_sess & sched_list lock */
+	ktime_t slice_start;
+
+	struct dentry *debugfs;
+
+	struct list_head fw_cache;
+	struct mutex fw_lock; /* fw_cache lock */
+	size_t fw_cache_size;
+	unsigned int fw_hits;
+	unsigned int fw_misses;
+	ktime_t fw_load_time;
+
+	struct vb2_buf_pool *buf_pool;
 };
 
 /**
@@ -100,12 +152,18 @@ struct amvdec_core {
  * @vififo_level: mandatory call to get the current amount of data
  *		  in the VIFIFO
  * @use_offsets: mandatory call. Returns 1 if the VDEC supports vififo offsets
+ * @save: optional call to save the session state and power the vdec off,
+ *	  letting another session use it. Must go in pair with @restore
+ * @restore: optional call to power the vdec on and restore the session state
+ *	     saved with @save
  */
 struct amvdec_ops {
 	int (*start)(struct amvdec_session *sess);
 	int (*stop)(struct amvdec_session *sess);
 	void (*conf_esparser)(struct amvdec_session *sess);
 	u32 (*vififo_level)(struct amvdec_session *sess);
+	int (*save)(struct amvdec_session *sess);
+	int (*restore)(struct amvdec_session *sess);
 };
 
 /**
@@ -120,8 +178,15 @@ struct amvdec_ops {
  * @recycle: optional call to tell the codec to recycle a dst buffer. Must go
  *	     in pair with @can_recycle
  * @drain: optional call if the codec has a custom way of draining
+ * @resume: optional call to resume decoding after a resolution change
+ * @dst_buf_queued: optional call to notify the codec that a new dst buffer
+ *		    was queued, letting it resume if it was waiting for one
  * @eos_sequence: optional call to get an end sequence to send to esparser
  *		  for flush. Mutually exclusive with @drain.
+ * @save: optional call to save the codec state before the session is
+ *	  switched out. Returns -EAGAIN if the firmware is in the middle of
+ *	  a frame. Must go in pair with @restore
+ * @restore: optional call to restore the codec state saved with @save
  * @isr: mandatory call when the ISR triggers
  * @threaded_isr: mandatory call for the threaded ISR
  */
@@ -135,7 +200,10 @@ struct amvdec_codec_ops {
 	void (*recycle)(struct amvdec_core *core, u32 buf_idx);
 	void (*drain)(struct amvdec_session *sess);
 	void (*resume)(struct amvdec_session *sess);
+	void (*dst_buf_queued)(struct amvdec_session *sess);
 	const u8 * (*eos_sequence)(u32 *len);
+	int (*save)(struct amvdec_session *sess);
+	int (*restore)(struct amvdec_session *sess);
 	irqreturn_t (*isr)(struct amvdec_session *sess);
 	irqreturn_t (*threaded_isr)(struct amvdec_session *sess);
 };
@@ -197,12 +265,18 @@ enum amvdec_status {
  * @pixelaspect: Pixel Aspect Ratio reported by the decoder
  * @esparser_queued_bufs: number of buffers currently queued into ESPARSER
  * @esparser_queue_work: work struct for the ESPARSER to process src buffers
+ * @esparser_timeout_work: work struct for ESPARSER submission timeouts
+ * @esparser_done: completed each time an ESPARSER submission finishes
+ * @esparser_vbuf: src buffer being parsed by the ESPARSER
+ * @esparser_wp: ESPARSER write pointer saved while switched out
  * @streamon_cap: stream on flag for capture queue
  * @streamon_out: stream on flag for output queue
  * @sequence_cap: capture sequence counter
  * @should_stop: flag set if userspace signaled EOS via command
  *		 or empty buffer
  * @keyframe_found: flag set once a keyframe has been parsed
+ * @canvas_pool: canvases reserved for the session
+ * @canvas_reserved: size of the canvas reservation
  * @canvas_alloc: array of all the canvas IDs allocated
  * @canvas_num: number of canvas IDs allocated
  * @vififo_vaddr: virtual address for the VIFIFO
@@ -211,10 +285,21 @@ enum amvdec_status {
  * @bufs_recycle: list of buffers that need to be recycled
  * @bufs_recycle_lock: lock for the bufs_recycle list
  * @recycle_thread: task struct for the recycling thread
- * @timestamps: chronological list of src timestamps
- * @ts_spinlock: spinlock for the timestamps list
+ * @ts_ring: chronological ring of src timestamps, ordered by VIFIFO offset
+ * @ts_head: position of the oldest pending timestamp in ts_ring
+ * @ts_tail: position where the next timestamp is added in ts_ring
+ * @ts_count: number of pending timestamps in ts_ring
+ * @ts_spinlock: spinlock for the timestamps ring
  * @last_irq_jiffies: tracks last time the vdec triggered an IRQ
  * @status: current decoding status
+ * @dst_paddr: plane addresses of each CAPTURE buffer, as programmed in the HW
+ * @sched_node: entry in the core's sched_list
+ * @ctx_regs: vdec registers saved while switched out
+ * @ctx_saved: flag set once the session state was saved by a switch
+ * @resume_pending: flag set when CAPTURE was reconfigured after a source
+ *		    change while the session was switched out
+ * @decode_time: total time the session was given the vdec
+ * @nr_switches: number of times the session was switched in
  * @priv: codec private data
  */
 struct amvdec_session {
@@ -242,6 +327,10 @@ struct amvdec_session {
 
 	atomic_t esparser_queued_bufs;
 	struct work_struct esparser_queue_work;
+	struct delayed_work esparser_timeout_work;
+	struct completion esparser_done;
+	struct vb2_v4l2_buffer *esparser_vbuf;
+	u32 esparser_wp;
 
 	unsigned int streamon_cap, streamon_out;
 	unsigned int sequence_cap, sequence_out;
@@ -250,6 +339,8 @@ struct amvdec_session {
 	unsigned int num_dst_bufs;
 	unsigned int changed_format;
 
+	struct meson_canvas_pool *canvas_pool;
+	u32 canvas_reserved;
 	u8 canvas_alloc[MAX_CANVAS];
 	u32 canvas_num;
 
@@ -261,8 +352,11 @@ struct amvdec_session {
 	struct mutex bufs_recycle_lock; /* bufs_recycle list lock */
 	struct task_struct *recycle_thread;
 
-	struct list_head timestamps;
-	spinlock_t ts_spinlock; /* timestamp list lock */
+	struct amvdec_timestamp ts_ring[AMVDEC_TS_RING_SIZE];
+	u32 ts_head;
+	u32 ts_tail;
+	u32 ts_count;
+	spinlock_t ts_spinlock; /* timestamp ring lock */
 
 	u64 last_irq_jiffies;
 	u32 last_offset;
@@ -270,9 +364,29 @@ struct amvdec_session {
 	u32 fw_idx_to_vb2_idx[32];
 
 	enum amvdec_status status;
+
+	dma_addr_t dst_paddr[VIDEO_MAX_FRAME][MAX_DST_PLANES];
+
+	struct list_head sched_node;
+	u32 ctx_regs[MAX_CTX_REGS];
+	unsigned int ctx_saved;
+	unsigned int resume_pending;
+	ktime_t decode_time;
+	unsigned int nr_switches;
+
 	void *priv;
 };
 
 u32 amvdec_get_output_size(struct amvdec_session *sess);
 
+/**
+ * amvdec_sched_frame_done() - notify the scheduler that a frame was decoded
+ *
+ * Sessions sharing the vdec are only switched at frame boundaries, once the
+ * current one used up its time slice.
+ *
+ * @sess: session that decoded the frame
+ */
+void amvdec_sched_frame_done(struct amvdec_session *sess);
+
 #endif
@@ -7,10 +7,10 @@
  * MPEG 1/2/4, H.263, H.264, MJPEG, VC1
  */
 
-#include <linux/firmware.h>
 #include <linux/clk.h>
 
 #include "vdec_1.h"
+#include "vdec_fw.h"
 #include "vdec_helpers.h"
 #include "dos_regs.h"
 
@@ -20,47 +20,27 @@
 	#define GEN_PWR_VDEC_1 (BIT(3) | BIT(2))
 	#define GEN_PWR_VDEC_1_SM1 (BIT(1))
 
-#define MC_SIZE			(4096 * 4)
-
 static int
 vdec_1_load_firmware(struct amvdec_session *sess, const char *fwname)
 {
-	const struct firmware *fw;
 	struct amvdec_core *core = sess->core;
 	struct device *dev = core->dev_dec;
 	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
-	static void *mc_addr;
-	static dma_addr_t mc_addr_map;
-	int ret;
+	struct amvdec_fw *fw;
+	int ret = 0;
 	u32 i = 1000;
 
-	ret = request_firmware(&fw, fwname, dev);
-	if (ret < 0)
+	fw = amvdec_fw_get(core, fwname);
+	if (IS_ERR(fw))
 		return -EINVAL;
 
-	if (fw->size < MC_SIZE) {
-		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
-			fw->size, MC_SIZE);
-		ret = -EINVAL;
-		goto release_firmware;
-	}
-
-	mc_addr = dma_alloc_coherent(core->dev, MC_SIZE,
-				     &mc_addr_map, GFP_KERNEL);
-	if (!mc_addr) {
-		ret = -ENOMEM;
-		goto release_firmware;
-	}
-
-	memcpy(mc_addr, fw->data, MC_SIZE);
-
 	amvdec_write_dos(core, MPSR, 0);
 	amvdec_write_dos(core, CPSR, 0);
 
 	amvdec_clear_dos_bits(core, MDEC_PIC_DC_CTRL, BIT(31));
 
-	amvdec_write_dos(core, IMEM_DMA_ADR, mc_addr_map);
-	amvdec_write_dos(core, IMEM_DMA_COUNT, MC_SIZE / 4);
+	amvdec_write_dos(core, IMEM_DMA_ADR, fw->mc_paddr);
+	amvdec_write_dos(core, IMEM_DMA_COUNT, AMVDEC_FW_MC_SIZE / 4);
 	amvdec_write_dos(core, IMEM_DMA_CTRL, (0x8000 | (7 << 16)));
 
 	while (--i && amvdec_read_dos(core, IMEM_DMA_CTRL) & 0x8000);
@@ -68,18 +48,15 @@ vdec_1_load_firmware(struct amvdec_session *sess, const char *fwname)
 	if (i == 0) {
 		dev_err(dev, "Firmware load fail (DMA hang?)\n");
 		ret = -EINVAL;
-		goto free_mc;
+		goto put_fw;
 	}
 
 	if (codec_ops->load_extended_firmware)
-		ret = codec_ops->load_extended_firmware(sess,
-							fw->data + MC_SIZE,
-							fw->size - MC_SIZE);
-
-free_mc:
-	dma_free_coherent(core->dev, MC_SIZE, mc_addr, mc_addr_map);
-release_firmware:
-	release_firmware(fw);
+		ret = codec_ops->load_extended_firmware(sess, fw->ext_data,
+							fw->ext_size);
+
+put_fw:
+	amvdec_fw_put(core, fw);
 	return ret;
 }
 
@@ -129,10 +106,9 @@ static u32 vdec_1_vififo_level(struct amvdec_session *sess)
 	return amvdec_read_dos(core, VLD_MEM_VIFIFO_LEVEL);
 }
 
-static int vdec_1_stop(struct amvdec_session *sess)
+static void vdec_1_power_off(struct amvdec_session *sess)
 {
 	struct amvdec_core *core = sess->core;
-	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
 
 	amvdec_write_dos(core, MPSR, 0);
 	amvdec_write_dos(core, CPSR, 0);
@@ -159,18 +135,12 @@ static int vdec_1_stop(struct amvdec_session *sess)
 				   GEN_PWR_VDEC_1, GEN_PWR_VDEC_1);
 
 	clk_disable_unprepare(core->vdec_1_clk);
-
-	if (sess->priv)
-		codec_ops->stop(sess);
-
-	return 0;
 }
 
-static int vdec_1_start(struct amvdec_session *sess)
+static int vdec_1_power_on(struct amvdec_session *sess)
 {
 	int ret;
 	struct amvdec_core *core = sess->core;
-	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
 
 	/* Configure the vdec clk to the maximum available */
 	clk_set_rate(core->vdec_1_clk, 666666666);
@@ -209,13 +179,12 @@ static int vdec_1_start(struct amvdec_session *sess)
 
 	vdec_1_stbuf_power_up(sess);
 
-	ret = vdec_1_load_firmware(sess, sess->fmt_out->firmware_path);
-	if (ret)
-		goto stop;
+	return 0;
+}
 
-	ret = codec_ops->start(sess);
-	if (ret)
-		goto stop;
+static void vdec_1_run(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
 
 	/* Enable IRQ */
 	amvdec_write_dos(core, ASSIST_MBOX1_CLR_REG, 1);
@@ -231,6 +200,38 @@ static int vdec_1_start(struct amvdec_session *sess)
 	amvdec_write_dos(core, MPSR, 1);
 	/* Let the firmware settle */
 	usleep_range(10, 20);
+}
+
+static int vdec_1_stop(struct amvdec_session *sess)
+{
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+
+	vdec_1_power_off(sess);
+
+	if (sess->priv)
+		codec_ops->stop(sess);
+
+	return 0;
+}
+
+static int vdec_1_start(struct amvdec_session *sess)
+{
+	int ret;
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+
+	ret = vdec_1_power_on(sess);
+	if (ret)
+		return ret;
+
+	ret = vdec_1_load_firmware(sess, sess->fmt_out->firmware_path);
+	if (ret)
+		goto stop;
+
+	ret = codec_ops->start(sess);
+	if (ret)
+		goto stop;
+
+	vdec_1_run(sess);
 
 	return 0;
 
@@ -239,9 +240,80 @@ static int vdec_1_start(struct amvdec_session *sess)
 	return ret;
 }
 
+/*
+ * The firmware keeps its state in the scratch registers and in the codec
+ * workspace, which stays allocated while the session is switched out.
+ */
+static int vdec_1_save(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+	u32 *regs = sess->ctx_regs;
+	u32 reg;
+	int ret;
+
+	/* Halt the firmware processor before sampling its state */
+	amvdec_write_dos(core, MPSR, 0);
+
+	ret = codec_ops->save(sess);
+	if (ret) {
+		amvdec_write_dos(core, MPSR, 1);
+		return ret;
+	}
+
+	for (reg = AV_SCRATCH_0; reg <= AV_SCRATCH_L; reg += 4)
+		*regs++ = amvdec_read_dos(core, reg);
+
+	*regs++ = amvdec_read_dos(core, VLD_MEM_VIFIFO_CURR_PTR);
+	*regs++ = amvdec_read_dos(core, VLD_MEM_VIFIFO_WP);
+	*regs++ = amvdec_read_dos(core, VLD_MEM_VIFIFO_WRAP_COUNT);
+
+	vdec_1_power_off(sess);
+
+	return 0;
+}
+
+static int vdec_1_restore(struct amvdec_session *sess)
+{
+	struct amvdec_core *core = sess->core;
+	struct amvdec_codec_ops *codec_ops = sess->fmt_out->codec_ops;
+	u32 *regs = sess->ctx_regs;
+	u32 reg;
+	int ret;
+
+	ret = vdec_1_power_on(sess);
+	if (ret)
+		return ret;
+
+	ret = vdec_1_load_firmware(sess, sess->fmt_out->firmware_path);
+	if (ret)
+		goto power_off;
+
+	for (reg = AV_SCRATCH_0; reg <= AV_SCRATCH_L; reg += 4)
+		amvdec_write_dos(core, reg, *regs++);
+
+	amvdec_write_dos(core, VLD_MEM_VIFIFO_CURR_PTR, *regs++);
+	amvdec_write_dos(core, VLD_MEM_VIFIFO_WP, *regs++);
+	amvdec_write_dos(core, VLD_MEM_VIFIFO_WRAP_COUNT, *regs++);
+
+	ret = codec_ops->restore(sess);
+	if (ret)
+		goto power_off;
+
+	vdec_1_run(sess);
+
+	return 0;
+
+power_off:
+	vdec_1_power_off(sess);
+	return ret;
+}
+
 struct amvdec_ops vdec_1_ops = {
 	.start = vdec_1_start,
 	.stop = vdec_1_stop,
 	.conf_esparser = vdec_1_conf_esparser,
 	.vififo_level = vdec_1_vififo_level,
+	.save = vdec_1_save,
+	.restore = vdec_1_restore,
 };
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Firmware images are kept resident so that sessions opened in quick
+ * succession don't go through the firmware loader every time.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/dma-mapping.h>
+#include <linux/firmware.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+
+#include "vdec_fw.h"
+
+static unsigned int fw_cache_kb = 512;
+module_param(fw_cache_kb, uint, 0644);
+MODULE_PARM_DESC(fw_cache_kb,
+		 "Memory kept for unused firmware images in KiB, 0 to disable the cache");
+
+static size_t amvdec_fw_size(struct amvdec_fw *fw)
+{
+	return AMVDEC_FW_MC_SIZE + fw->ext_size;
+}
+
+static void amvdec_fw_free(struct amvdec_core *core, struct amvdec_fw *fw)
+{
+	core->fw_cache_size -= amvdec_fw_size(fw);
+	list_del(&fw->list);
+	dma_free_coherent(core->dev, AMVDEC_FW_MC_SIZE, fw->mc_vaddr,
+			  fw->mc_paddr);
+	kfree(fw->ext_data);
+	kfree_const(fw->name);
+	kfree(fw);
+}
+
+/* Evict unused images, least recently used first, to fit in the cap */
+static void amvdec_fw_cache_trim(struct amvdec_core *core)
+{
+	size_t max_size = (size_t)READ_ONCE(fw_cache_kb) * SZ_1K;
+	struct amvdec_fw *fw, *n;
+
+	list_for_each_entry_safe_reverse(fw, n, &core->fw_cache, list) {
+		if (core->fw_cache_size <= max_size)
+			break;
+
+		if (!fw->users)
+			amvdec_fw_free(core, fw);
+	}
+}
+
+static struct amvdec_fw *amvdec_fw_load(struct amvdec_core *core,
+					const char *name)
+{
+	struct device *dev = core->dev_dec;
+	const struct firmware *blob;
+	struct amvdec_fw *fw;
+	int ret;
+
+	ret = request_firmware(&blob, name, dev);
+	if (ret < 0) {
+		dev_err(dev, "Unable to request firmware %s\n", name);
+		return ERR_PTR(ret);
+	}
+
+	if (blob->size < AMVDEC_FW_MC_SIZE) {
+		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
+			blob->size, AMVDEC_FW_MC_SIZE);
+		ret = -EINVAL;
+		goto release_firmware;
+	}
+
+	fw = kzalloc(sizeof(*fw), GFP_KERNEL);
+	if (!fw) {
+		ret = -ENOMEM;
+		goto release_firmware;
+	}
+
+	fw->name = kstrdup_const(name, GFP_KERNEL);
+	if (!fw->name) {
+		ret = -ENOMEM;
+		goto free_fw;
+	}
+
+	fw->mc_vaddr = dma_alloc_coherent(core->dev, AMVDEC_FW_MC_SIZE,
+					  &fw->mc_paddr, GFP_KERNEL);
+	if (!fw->mc_vaddr) {
+		ret = -ENOMEM;
+		goto free_name;
+	}
+
+	memcpy(fw->mc_vaddr, blob->data, AMVDEC_FW_MC_SIZE);
+
+	fw->ext_size = blob->size - AMVDEC_FW_MC_SIZE;
+	if (fw->ext_size) {
+		fw->ext_data = kmemdup(blob->data + AMVDEC_FW_MC_SIZE,
+				       fw->ext_size, GFP_KERNEL);
+		if (!fw->ext_data) {
+			ret = -ENOMEM;
+			goto free_mc;
+		}
+	}
+
+	release_firmware(blob);
+	return fw;
+
+free_mc:
+	dma_free_coherent(core->dev, AMVDEC_FW_MC_SIZE, fw->mc_vaddr,
+			  fw->mc_paddr);
+free_name:
+	kfree_const(fw->name);
+free_fw:
+	kfree(fw);
+release_firmware:
+	release_firmware(blob);
+	return ERR_PTR(ret);
+}
+
+struct amvdec_fw *amvdec_fw_get(struct amvdec_core *core, const char *name)
+{
+	struct amvdec_fw *fw;
+	ktime_t start;
+
+	mutex_lock(&core->fw_lock);
+	list_for_each_entry(fw, &core->fw_cache, list) {
+		if (!strcmp(fw->name, name)) {
+			list_move(&fw->list, &core->fw_cache);
+			core->fw_hits++;
+			goto found;
+		}
+	}
+
+	start = ktime_get();
+	fw = amvdec_fw_load(core, name);
+	if (IS_ERR(fw))
+		goto unlock;
+
+	core->fw_misses++;
+	core->fw_load_time = ktime_add(core->fw_load_time,
+				       ktime_sub(ktime_get(), start));
+	core->fw_cache_size += amvdec_fw_size(fw);
+	list_add(&fw->list, &core->fw_cache);
+
+found:
+	fw->users++;
+unlock:
+	mutex_unlock(&core->fw_lock);
+
+	return fw;
+}
+
+void amvdec_fw_put(struct amvdec_core *core, struct amvdec_fw *fw)
+{
+	mutex_lock(&core->fw_lock);
+	fw->users--;
+	amvdec_fw_cache_trim(core);
+	mutex_unlock(&core->fw_lock);
+}
+
+static int amvdec_fw_cache_show(struct seq_file *s, void *data)
+{
+	struct amvdec_core *core = s->private;
+	struct amvdec_fw *fw;
+	u64 load_us = 0;
+
+	mutex_lock(&core->fw_lock);
+	if (core->fw_misses)
+		load_us = div_u64(ktime_to_us(core->fw_load_time),
+				  core->fw_misses);
+
+	seq_printf(s, "hits: %u\nmisses: %u\navg load: %llu us\n",
+		   core->fw_hits, core->fw_misses, load_us);
+	seq_printf(s, "size: %zu / %u KiB\n", core->fw_cache_size / SZ_1K,
+		   READ_ONCE(fw_cache_kb));
+	list_for_each_entry(fw, &core->fw_cache, list)
+		seq_printf(s, "%s: %zu bytes, %u users\n", fw->name,
+			   amvdec_fw_size(fw), fw->users);
+	mutex_unlock(&core->fw_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(amvdec_fw_cache);
+
+void amvdec_fw_cache_init(struct amvdec_core *core)
+{
+	INIT_LIST_HEAD(&core->fw_cache);
+	mutex_init(&core->fw_lock);
+}
+
+void amvdec_fw_cache_debugfs_init(struct amvdec_core *core)
+{
+	debugfs_create_file("firmware", 0444, core->debugfs, core,
+			    &amvdec_fw_cache_fops);
+}
+
+void amvdec_fw_cache_release(struct amvdec_core *core)
+{
+	struct amvdec_fw *fw, *n;
+
+	mutex_lock(&core->fw_lock);
+	list_for_each_entry_safe(fw, n, &core->fw_cache, list)
+		amvdec_fw_free(core, fw);
+	mutex_unlock(&core->fw_lock);
+}
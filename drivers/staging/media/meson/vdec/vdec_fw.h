@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#ifndef __MESON_VDEC_VDEC_FW_H_
+#define __MESON_VDEC_VDEC_FW_H_
+
+#include "vdec.h"
+
+/* Size of the microcode uploaded to the vdec processors */
+#define AMVDEC_FW_MC_SIZE	(4096 * 4)
+
+/**
+ * struct amvdec_fw - firmware image kept resident across sessions
+ *
+ * @list: entry in the core's fw_cache, most recently used first
+ * @name: firmware file name
+ * @mc_vaddr: DMA-ready copy of the microcode
+ * @mc_paddr: DMA address of mc_vaddr
+ * @ext_data: firmware data following the microcode
+ * @ext_size: size of ext_data
+ * @users: number of loads currently using this image
+ */
+struct amvdec_fw {
+	struct list_head list;
+	const char *name;
+	void *mc_vaddr;
+	dma_addr_t mc_paddr;
+	void *ext_data;
+	size_t ext_size;
+	unsigned int users;
+};
+
+/**
+ * amvdec_fw_get() - get a firmware image, from the cache if possible
+ *
+ * @core: vdec core
+ * @name: firmware file name
+ *
+ * Must go in pair with amvdec_fw_put()
+ */
+struct amvdec_fw *amvdec_fw_get(struct amvdec_core *core, const char *name);
+
+/**
+ * amvdec_fw_put() - release a firmware image got with amvdec_fw_get()
+ *
+ * @core: vdec core
+ * @fw: firmware image
+ */
+void amvdec_fw_put(struct amvdec_core *core, struct amvdec_fw *fw);
+
+void amvdec_fw_cache_init(struct amvdec_core *core);
+void amvdec_fw_cache_debugfs_init(struct amvdec_core *core);
+void amvdec_fw_cache_release(struct amvdec_core *core);
+
+#endif
@@ -11,6 +11,9 @@
 
 #include "vdec_helpers.h"
 
+#define CREATE_TRACE_POINTS
+#include "vdec_trace.h"
+
 #define NUM_CANVAS_NV12 2
 #define NUM_CANVAS_YUV420 3
 
@@ -77,58 +80,67 @@ u32 amvdec_am21c_size(u32 width, u32 height)
 }
 EXPORT_SYMBOL_GPL(amvdec_am21c_size);
 
-static int canvas_alloc(struct amvdec_session *sess, u8 *canvas_id)
+static int canvas_alloc(struct amvdec_session *sess, u8 *canvas_id,
+			unsigned int num)
 {
 	int ret;
 
-	if (sess->canvas_num >= MAX_CANVAS) {
+	if (sess->canvas_num + num > MAX_CANVAS) {
 		dev_err(sess->core->dev, "Reached max number of canvas\n");
 		return -ENOMEM;
 	}
 
-	ret = meson_canvas_alloc(sess->core->canvas, canvas_id);
+	ret = meson_canvas_pool_alloc_n(sess->canvas_pool, canvas_id, num);
 	if (ret)
 		return ret;
 
-	sess->canvas_alloc[sess->canvas_num++] = *canvas_id;
+	memcpy(&sess->canvas_alloc[sess->canvas_num], canvas_id, num);
+	sess->canvas_num += num;
 	return 0;
 }
 
+static void canvas_cfg_init(struct meson_canvas_cfg *cfg, u8 index,
+			    dma_addr_t addr, u32 stride, u32 height)
+{
+	cfg->index = index;
+	cfg->addr = addr;
+	cfg->stride = stride;
+	cfg->height = height;
+	cfg->wrap = MESON_CANVAS_WRAP_NONE;
+	cfg->blkmode = MESON_CANVAS_BLKMODE_LINEAR;
+	cfg->endian = MESON_CANVAS_ENDIAN_SWAP64;
+}
+
 static int set_canvas_yuv420m(struct amvdec_session *sess,
 			      struct vb2_buffer *vb, u32 width,
 			      u32 height, u32 reg)
 {
 	struct amvdec_core *core = sess->core;
 	u8 canvas_id[NUM_CANVAS_YUV420]; /* Y U V */
-	dma_addr_t buf_paddr[NUM_CANVAS_YUV420]; /* Y U V */
-	int ret, i;
-
-	for (i = 0; i < NUM_CANVAS_YUV420; ++i) {
-		ret = canvas_alloc(sess, &canvas_id[i]);
-		if (ret)
-			return ret;
+	struct meson_canvas_cfg cfg[NUM_CANVAS_YUV420];
+	int ret;
 
-		buf_paddr[i] =
-		    vb2_dma_contig_plane_dma_addr(vb, i);
-	}
+	ret = canvas_alloc(sess, canvas_id, NUM_CANVAS_YUV420);
+	if (ret)
+		return ret;
 
 	/* Y plane */
-	meson_canvas_config(core->canvas, canvas_id[0], buf_paddr[0],
-			    width, height, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	canvas_cfg_init(&cfg[0], canvas_id[0],
+			vb2_dma_contig_plane_dma_addr(vb, 0), width, height);
 
 	/* U plane */
-	meson_canvas_config(core->canvas, canvas_id[1], buf_paddr[1],
-			    width / 2, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	canvas_cfg_init(&cfg[1], canvas_id[1],
+			vb2_dma_contig_plane_dma_addr(vb, 1),
+			width / 2, height / 2);
 
 	/* V plane */
-	meson_canvas_config(core->canvas, canvas_id[2], buf_paddr[2],
-			    width / 2, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	canvas_cfg_init(&cfg[2], canvas_id[2],
+			vb2_dma_contig_plane_dma_addr(vb, 2),
+			width / 2, height / 2);
+
+	ret = meson_canvas_config_batch(core->canvas, cfg, NUM_CANVAS_YUV420);
+	if (ret)
+		return ret;
 
 	amvdec_write_dos(core, reg,
 			 ((canvas_id[2]) << 16) |
@@ -144,29 +156,25 @@ static int set_canvas_nv12m(struct amvdec_session *sess,
 {
 	struct amvdec_core *core = sess->core;
 	u8 canvas_id[NUM_CANVAS_NV12]; /* Y U/V */
-	dma_addr_t buf_paddr[NUM_CANVAS_NV12]; /* Y U/V */
-	int ret, i;
-
-	for (i = 0; i < NUM_CANVAS_NV12; ++i) {
-		ret = canvas_alloc(sess, &canvas_id[i]);
-		if (ret)
-			return ret;
+	struct meson_canvas_cfg cfg[NUM_CANVAS_NV12];
+	int ret;
 
-		buf_paddr[i] =
-		    vb2_dma_contig_plane_dma_addr(vb, i);
-	}
+	ret = canvas_alloc(sess, canvas_id, NUM_CANVAS_NV12);
+	if (ret)
+		return ret;
 
 	/* Y plane */
-	meson_canvas_config(core->canvas, canvas_id[0], buf_paddr[0],
-			    width, height, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	canvas_cfg_init(&cfg[0], canvas_id[0],
+			vb2_dma_contig_plane_dma_addr(vb, 0), width, height);
 
 	/* U/V plane */
-	meson_canvas_config(core->canvas, canvas_id[1], buf_paddr[1],
-			    width, height / 2, MESON_CANVAS_WRAP_NONE,
-			    MESON_CANVAS_BLKMODE_LINEAR,
-			    MESON_CANVAS_ENDIAN_SWAP64);
+	canvas_cfg_init(&cfg[1], canvas_id[1],
+			vb2_dma_contig_plane_dma_addr(vb, 1),
+			width, height / 2);
+
+	ret = meson_canvas_config_batch(core->canvas, cfg, NUM_CANVAS_NV12);
+	if (ret)
+		return ret;
 
 	amvdec_write_dos(core, reg,
 			 ((canvas_id[1]) << 16) |
@@ -176,6 +184,75 @@ static int set_canvas_nv12m(struct amvdec_session *sess,
 	return 0;
 }
 
+void amvdec_free_canvases(struct amvdec_session *sess)
+{
+	int i;
+
+	for (i = 0; i < sess->canvas_num; ++i)
+		meson_canvas_pool_free(sess->canvas_pool,
+				       sess->canvas_alloc[i]);
+
+	sess->canvas_num = 0;
+}
+EXPORT_SYMBOL_GPL(amvdec_free_canvases);
+
+static unsigned int amvdec_canvas_per_buf(u32 pixfmt)
+{
+	switch (pixfmt) {
+	case V4L2_PIX_FMT_NV12M:
+		return NUM_CANVAS_NV12;
+	case V4L2_PIX_FMT_YUV420M:
+		return NUM_CANVAS_YUV420;
+	default:
+		return 0;
+	}
+}
+
+int amvdec_reserve_canvases(struct amvdec_session *sess,
+			    unsigned int num_bufs)
+{
+	unsigned int num = num_bufs * amvdec_canvas_per_buf(sess->pixfmt_cap);
+	struct meson_canvas_pool *pool;
+
+	if (num > MAX_CANVAS) {
+		dev_err(sess->core->dev, "Reached max number of canvas\n");
+		return -ENOMEM;
+	}
+
+	/* Nothing to do if the current reservation is big enough */
+	if (sess->canvas_pool && num <= sess->canvas_reserved)
+		return 0;
+
+	/* The reservation can only be replaced while it is unused */
+	if (sess->canvas_num)
+		return -EBUSY;
+
+	meson_canvas_pool_destroy(sess->canvas_pool);
+	sess->canvas_pool = NULL;
+	sess->canvas_reserved = 0;
+
+	pool = meson_canvas_pool_create(sess->core->canvas, num);
+	if (IS_ERR(pool)) {
+		dev_err(sess->core->dev, "Failed to reserve %u canvas\n", num);
+		return PTR_ERR(pool);
+	}
+
+	sess->canvas_pool = pool;
+	sess->canvas_reserved = num;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(amvdec_reserve_canvases);
+
+void amvdec_release_canvases(struct amvdec_session *sess)
+{
+	amvdec_free_canvases(sess);
+	meson_canvas_pool_destroy(sess->canvas_pool);
+	sess->canvas_pool = NULL;
+	sess->canvas_reserved = 0;
+}
+EXPORT_SYMBOL_GPL(amvdec_release_canvases);
+
 int amvdec_set_canvases(struct amvdec_session *sess,
 			u32 reg_base[], u32 reg_num[])
 {
@@ -189,6 +266,14 @@ int amvdec_set_canvases(struct amvdec_session *sess,
 	int i = 0;
 	int ret;
 
+	/* CAPTURE may have been reallocated after a source change */
+	amvdec_free_canvases(sess);
+
+	ret = amvdec_reserve_canvases(sess,
+				      v4l2_m2m_num_dst_bufs_ready(sess->m2m_ctx));
+	if (ret)
+		return ret;
+
 	v4l2_m2m_for_each_dst_buf(sess->m2m_ctx, buf) {
 		if (!reg_base[reg_base_cur])
 			return -EINVAL;
@@ -227,20 +312,56 @@ int amvdec_set_canvases(struct amvdec_session *sess,
 }
 EXPORT_SYMBOL_GPL(amvdec_set_canvases);
 
+static struct amvdec_timestamp *amvdec_ts_at(struct amvdec_session *sess,
+					     u32 pos)
+{
+	return &sess->ts_ring[pos & (AMVDEC_TS_RING_SIZE - 1)];
+}
+
+/* Release a ring slot and shrink the ring over released slots at its ends */
+static void amvdec_ts_release(struct amvdec_session *sess,
+			      struct amvdec_timestamp *ts)
+{
+	ts->pending = false;
+	sess->ts_count--;
+
+	while (sess->ts_head != sess->ts_tail &&
+	       !amvdec_ts_at(sess, sess->ts_head)->pending)
+		sess->ts_head++;
+
+	while (sess->ts_tail != sess->ts_head &&
+	       !amvdec_ts_at(sess, sess->ts_tail - 1)->pending)
+		sess->ts_tail--;
+}
+
 void amvdec_add_ts(struct amvdec_session *sess, u64 ts,
 		   struct v4l2_timecode tc, u32 offset, u32 vbuf_flags)
 {
 	struct amvdec_timestamp *new_ts;
 	unsigned long flags;
 
-	new_ts = kzalloc(sizeof(*new_ts), GFP_KERNEL);
+	spin_lock_irqsave(&sess->ts_spinlock, flags);
+	/* Ring full: the oldest timestamp is very unlikely to ever match */
+	if (sess->ts_tail - sess->ts_head == AMVDEC_TS_RING_SIZE) {
+		struct amvdec_timestamp *old_ts =
+				amvdec_ts_at(sess, sess->ts_head);
+
+		dev_warn_ratelimited(sess->core->dev_dec,
+				     "Timestamp ring full, dropping %llu\n",
+				     old_ts->ts);
+		trace_amvdec_ts_drop(sess, old_ts->ts, old_ts->offset);
+		amvdec_ts_release(sess, old_ts);
+	}
+
+	new_ts = amvdec_ts_at(sess, sess->ts_tail++);
 	new_ts->ts = ts;
 	new_ts->tc = tc;
 	new_ts->offset = offset;
 	new_ts->flags = vbuf_flags;
-
-	spin_lock_irqsave(&sess->ts_spinlock, flags);
-	list_add_tail(&new_ts->list, &sess->timestamps);
+	new_ts->used_count = 0;
+	new_ts->pending = true;
+	sess->ts_count++;
+	trace_amvdec_ts_add(sess, ts, offset);
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 }
 EXPORT_SYMBOL_GPL(amvdec_add_ts);
@@ -249,12 +370,15 @@ void amvdec_remove_ts(struct amvdec_session *sess, u64 ts)
 {
 	struct amvdec_timestamp *tmp;
 	unsigned long flags;
+	u32 pos;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
-	list_for_each_entry(tmp, &sess->timestamps, list) {
-		if (tmp->ts == ts) {
-			list_del(&tmp->list);
-			kfree(tmp);
+	/* The timestamp to remove is usually the last one added */
+	for (pos = sess->ts_tail; pos != sess->ts_head; pos--) {
+		tmp = amvdec_ts_at(sess, pos - 1);
+		if (tmp->pending && tmp->ts == ts) {
+			trace_amvdec_ts_drop(sess, tmp->ts, tmp->offset);
+			amvdec_ts_release(sess, tmp);
 			goto unlock;
 		}
 	}
@@ -284,6 +408,10 @@ static void dst_buf_done(struct amvdec_session *sess,
 		vbuf->vb2_buf.planes[1].bytesused = output_size / 4;
 		vbuf->vb2_buf.planes[2].bytesused = output_size / 4;
 		break;
+	case V4L2_PIX_FMT_AM21C:
+		vbuf->vb2_buf.planes[0].bytesused =
+			amvdec_am21c_size(sess->width, sess->height);
+		break;
 	}
 
 	vbuf->vb2_buf.timestamp = timestamp;
@@ -321,14 +449,13 @@ void amvdec_dst_buf_done(struct amvdec_session *sess,
 {
 	struct device *dev = sess->core->dev_dec;
 	struct amvdec_timestamp *tmp;
-	struct list_head *timestamps = &sess->timestamps;
 	struct v4l2_timecode timecode;
 	u64 timestamp;
 	u32 vbuf_flags;
 	unsigned long flags;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
-	if (list_empty(timestamps)) {
+	if (!sess->ts_count) {
 		dev_err(dev, "Buffer %u done but list is empty\n",
 			vbuf->vb2_buf.index);
 
@@ -337,16 +464,18 @@ void amvdec_dst_buf_done(struct amvdec_session *sess,
 		return;
 	}
 
-	tmp = list_first_entry(timestamps, struct amvdec_timestamp, list);
+	/* The head slot is always pending */
+	tmp = amvdec_ts_at(sess, sess->ts_head);
 	timestamp = tmp->ts;
 	timecode = tmp->tc;
 	vbuf_flags = tmp->flags;
-	list_del(&tmp->list);
-	kfree(tmp);
+	amvdec_ts_release(sess, tmp);
+	trace_amvdec_ts_done(sess, timestamp, tmp->offset);
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 
 	dst_buf_done(sess, vbuf, field, timestamp, timecode, vbuf_flags);
 	atomic_dec(&sess->esparser_queued_bufs);
+	amvdec_sched_frame_done(sess);
 }
 EXPORT_SYMBOL_GPL(amvdec_dst_buf_done);
 
@@ -356,29 +485,46 @@ void amvdec_dst_buf_done_offset(struct amvdec_session *sess,
 {
 	struct device *dev = sess->core->dev_dec;
 	struct amvdec_timestamp *match = NULL;
-	struct amvdec_timestamp *tmp, *n;
+	struct amvdec_timestamp *tmp;
 	struct v4l2_timecode timecode = { 0 };
 	u64 timestamp = 0;
 	u32 vbuf_flags = 0;
 	unsigned long flags;
+	u32 lo, hi, pos;
 
 	spin_lock_irqsave(&sess->ts_spinlock, flags);
 
-	/* Look for our vififo offset to get the corresponding timestamp. */
-	list_for_each_entry_safe(tmp, n, &sess->timestamps, list) {
-		if (tmp->offset > offset) {
-			/*
-			 * Delete any record that remained unused for 32 match
-			 * checks
-			 */
-			if (tmp->used_count++ >= 32) {
-				list_del(&tmp->list);
-				kfree(tmp);
-			}
+	/*
+	 * Look for our vififo offset to get the corresponding timestamp.
+	 * Offsets only grow along the ring, released slots included, so
+	 * bisect for the first record written past our offset.
+	 */
+	lo = sess->ts_head;
+	hi = sess->ts_tail;
+	while (lo != hi) {
+		pos = lo + (hi - lo) / 2;
+		if ((s32)(amvdec_ts_at(sess, pos)->offset - offset) > 0)
+			hi = pos;
+		else
+			lo = pos + 1;
+	}
+
+	/* Our match is the last pending record before it */
+	for (pos = lo; pos != sess->ts_head; pos--) {
+		tmp = amvdec_ts_at(sess, pos - 1);
+		if (tmp->pending) {
+			match = tmp;
 			break;
 		}
+	}
 
-		match = tmp;
+	/* Delete any record that remained unused for 32 match checks */
+	if (lo != sess->ts_tail) {
+		tmp = amvdec_ts_at(sess, lo);
+		if (tmp->pending && tmp->used_count++ >= 32) {
+			trace_amvdec_ts_drop(sess, tmp->ts, tmp->offset);
+			amvdec_ts_release(sess, tmp);
+		}
 	}
 
 	if (!match) {
@@ -388,14 +534,15 @@ void amvdec_dst_buf_done_offset(struct amvdec_session *sess,
 		timestamp = match->ts;
 		timecode = match->tc;
 		vbuf_flags = match->flags;
-		list_del(&match->list);
-		kfree(match);
+		amvdec_ts_release(sess, match);
+		trace_amvdec_ts_done(sess, timestamp, match->offset);
 	}
 	spin_unlock_irqrestore(&sess->ts_spinlock, flags);
 
 	dst_buf_done(sess, vbuf, field, timestamp, timecode, vbuf_flags);
 	if (match)
 		atomic_dec(&sess->esparser_queued_bufs);
+	amvdec_sched_frame_done(sess);
 }
 EXPORT_SYMBOL_GPL(amvdec_dst_buf_done_offset);
 
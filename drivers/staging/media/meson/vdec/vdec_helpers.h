@@ -19,6 +19,33 @@
 int amvdec_set_canvases(struct amvdec_session *sess,
 			u32 reg_base[], u32 reg_num[]);
 
+/**
+ * amvdec_free_canvases() - Release all the canvases of a session
+ *
+ * @sess: current session
+ */
+void amvdec_free_canvases(struct amvdec_session *sess);
+
+/**
+ * amvdec_reserve_canvases() - Reserve the canvases a session needs
+ *
+ * Make sure the canvases for @num_bufs CAPTURE buffers stay available to
+ * the session, so running out of canvases is detected before decoding
+ * starts and not in the middle of a stream.
+ *
+ * @sess: current session
+ * @num_bufs: number of CAPTURE buffers
+ */
+int amvdec_reserve_canvases(struct amvdec_session *sess,
+			    unsigned int num_bufs);
+
+/**
+ * amvdec_release_canvases() - Free the canvases and release the reservation
+ *
+ * @sess: current session
+ */
+void amvdec_release_canvases(struct amvdec_session *sess);
+
 /* Helpers to read/write to the various IPs (DOS, PARSER) */
 u32 amvdec_read_dos(struct amvdec_core *core, u32 reg);
 void amvdec_write_dos(struct amvdec_core *core, u32 reg, u32 val);
@@ -6,10 +6,10 @@
  * HEVC, VP9
  */
 
-#include <linux/firmware.h>
 #include <linux/clk.h>
 
 #include "vdec_1.h"
+#include "vdec_fw.h"
 #include "vdec_helpers.h"
 #include "vdec_hevc.h"
 #include "hevc_regs.h"
@@ -21,46 +21,24 @@
 	#define GEN_PWR_VDEC_HEVC (BIT(7) | BIT(6))
 	#define GEN_PWR_VDEC_HEVC_SM1 (BIT(2))
 
-#define MC_SIZE	(4096 * 4)
-
 static int vdec_hevc_load_firmware(struct amvdec_session *sess,
 				   const char *fwname)
 {
 	struct amvdec_core *core = sess->core;
 	struct device *dev = core->dev_dec;
-	const struct firmware *fw;
-	static void *mc_addr;
-	static dma_addr_t mc_addr_map;
-	int ret;
+	struct amvdec_fw *fw;
+	int ret = 0;
 	u32 i = 100;
 
-	ret = request_firmware(&fw, fwname, dev);
-	if (ret < 0)  {
-		dev_err(dev, "Unable to request firmware %s\n", fwname);
-		return ret;
-	}
-
-	if (fw->size < MC_SIZE) {
-		dev_err(dev, "Firmware size %zu is too small. Expected %u.\n",
-			fw->size, MC_SIZE);
-		ret = -EINVAL;
-		goto release_firmware;
-	}
-
-	mc_addr = dma_alloc_coherent(core->dev, MC_SIZE, &mc_addr_map,
-				     GFP_KERNEL);
-	if (!mc_addr) {
-		ret = -ENOMEM;
-		goto release_firmware;
-	}
-
-	memcpy(mc_addr, fw->data, MC_SIZE);
+	fw = amvdec_fw_get(core, fwname);
+	if (IS_ERR(fw))
+		return PTR_ERR(fw);
 
 	amvdec_write_dos(core, HEVC_MPSR, 0);
 	amvdec_write_dos(core, HEVC_CPSR, 0);
 
-	amvdec_write_dos(core, HEVC_IMEM_DMA_ADR, mc_addr_map);
-	amvdec_write_dos(core, HEVC_IMEM_DMA_COUNT, MC_SIZE / 4);
+	amvdec_write_dos(core, HEVC_IMEM_DMA_ADR, fw->mc_paddr);
+	amvdec_write_dos(core, HEVC_IMEM_DMA_COUNT, AMVDEC_FW_MC_SIZE / 4);
 	amvdec_write_dos(core, HEVC_IMEM_DMA_CTRL, (0x8000 | (7 << 16)));
 
 	while (i && (readl(core->dos_base + HEVC_IMEM_DMA_CTRL) & 0x8000))
@@ -71,9 +49,7 @@ static int vdec_hevc_load_firmware(struct amvdec_session *sess,
 		ret = -ENODEV;
 	}
 
-	dma_free_coherent(core->dev, MC_SIZE, mc_addr, mc_addr_map);
-release_firmware:
-	release_firmware(fw);
+	amvdec_fw_put(core, fw);
 	return ret;
 }
 
@@ -0,0 +1,102 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM meson_vdec
+
+#if !defined(__MESON_VDEC_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define __MESON_VDEC_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+#include "vdec.h"
+
+DECLARE_EVENT_CLASS(amvdec_ts,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 offset),
+	TP_ARGS(sess, ts, offset),
+	TP_STRUCT__entry(
+		__field(const void *, sess)
+		__field(u64, ts)
+		__field(u32, offset)
+		__field(u32, depth)
+	),
+	TP_fast_assign(
+		__entry->sess = sess;
+		__entry->ts = ts;
+		__entry->offset = offset;
+		__entry->depth = sess->ts_count;
+	),
+	TP_printk("sess %p ts %llu offset 0x%08x depth %u", __entry->sess,
+		  __entry->ts, __entry->offset, __entry->depth)
+);
+
+/* A src timestamp was queued along with its VIFIFO offset */
+DEFINE_EVENT(amvdec_ts, amvdec_ts_add,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 offset),
+	TP_ARGS(sess, ts, offset));
+/* A src timestamp was attached to a decoded frame */
+DEFINE_EVENT(amvdec_ts, amvdec_ts_done,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 offset),
+	TP_ARGS(sess, ts, offset));
+/* A src timestamp was discarded without ever being matched */
+DEFINE_EVENT(amvdec_ts, amvdec_ts_drop,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 offset),
+	TP_ARGS(sess, ts, offset));
+
+DECLARE_EVENT_CLASS(amvdec_es,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 size),
+	TP_ARGS(sess, ts, size),
+	TP_STRUCT__entry(
+		__field(const void *, sess)
+		__field(u64, ts)
+		__field(u32, size)
+		__field(u32, queued)
+	),
+	TP_fast_assign(
+		__entry->sess = sess;
+		__entry->ts = ts;
+		__entry->size = size;
+		__entry->queued = atomic_read(&sess->esparser_queued_bufs);
+	),
+	TP_printk("sess %p ts %llu size %u queued %u", __entry->sess,
+		  __entry->ts, __entry->size, __entry->queued)
+);
+
+/* A src buffer was handed to the ESPARSER */
+DEFINE_EVENT(amvdec_es, amvdec_es_write,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 size),
+	TP_ARGS(sess, ts, size));
+/* The ESPARSER is done with a src buffer, size is 0 on error */
+DEFINE_EVENT(amvdec_es, amvdec_es_done,
+	TP_PROTO(struct amvdec_session *sess, u64 ts, u32 size),
+	TP_ARGS(sess, ts, size));
+
+DECLARE_EVENT_CLASS(amvdec_irq,
+	TP_PROTO(struct amvdec_session *sess),
+	TP_ARGS(sess),
+	TP_STRUCT__entry(
+		__field(const void *, sess)
+		__field(u32, status)
+	),
+	TP_fast_assign(
+		__entry->sess = sess;
+		__entry->status = sess->status;
+	),
+	TP_printk("sess %p status %u", __entry->sess, __entry->status)
+);
+
+/* The decoder raised an interrupt for the running session */
+DEFINE_EVENT(amvdec_irq, amvdec_isr,
+	TP_PROTO(struct amvdec_session *sess),
+	TP_ARGS(sess));
+/* The threaded half of the decoder interrupt started running */
+DEFINE_EVENT(amvdec_irq, amvdec_threaded_isr,
+	TP_PROTO(struct amvdec_session *sess),
+	TP_ARGS(sess));
+
+#endif /* __MESON_VDEC_TRACE_H_ */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/staging/media/meson/vdec
+#define TRACE_INCLUDE_FILE vdec_trace
+#include <trace/define_trace.h>
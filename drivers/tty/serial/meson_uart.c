@@ -49,6 +49,7 @@
 #define AML_UART_DATA_LEN_5BIT		(0x03 << 20)
 
 /* AML_UART_STATUS bits */
+#define AML_UART_RX_CNT_MASK		GENMASK(6, 0)
 #define AML_UART_PARITY_ERR		BIT(16)
 #define AML_UART_FRAME_ERR		BIT(17)
 #define AML_UART_TX_FIFO_WERR		BIT(18)
@@ -171,16 +172,41 @@ static void meson_uart_start_tx(struct uart_port *port)
 		uart_write_wakeup(port);
 }
 
+static void meson_receive_bulk(struct uart_port *port, unsigned int count)
+{
+	struct tty_port *tport = &port->state->port;
+	unsigned char buf[AML_UART_RX_CNT_MASK + 1];
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		buf[i] = readl(port->membase + AML_UART_RFIFO) & 0xff;
+
+	port->icount.rx += count;
+	tty_insert_flip_string(tport, buf, count);
+}
+
 static void meson_receive_chars(struct uart_port *port)
 {
 	struct tty_port *tport = &port->state->port;
+	unsigned int count;
 	char flag;
 	u32 ostatus, status, ch, mode;
 
 	do {
+		ostatus = status = readl(port->membase + AML_UART_STATUS);
+
+		/*
+		 * Without any error pending, nor a sysrq sequence to look
+		 * for, what's in the FIFO goes to the tty layer in one go.
+		 */
+		count = status & AML_UART_RX_CNT_MASK;
+		if (count > 1 && !(status & AML_UART_ERR) && !port->sysrq) {
+			meson_receive_bulk(port, count);
+			continue;
+		}
+
 		flag = TTY_NORMAL;
 		port->icount.rx++;
-		ostatus = status = readl(port->membase + AML_UART_STATUS);
 
 		if (status & AML_UART_ERR) {
 			if (status & AML_UART_TX_FIFO_WERR)
@@ -5183,6 +5183,7 @@ int dwc2_hcd_init(struct dwc2_hsotg *hsotg)
 				"unable to create dwc2 hs isoc desc cache\n");
 
 			kmem_cache_destroy(hsotg->desc_gen_cache);
+			hsotg->desc_gen_cache = NULL;
 
 			/*
 			 * Disable descriptor dma mode since it will not be
@@ -345,8 +345,8 @@ int dwc2_hcd_qh_init_ddma(struct dwc2_hsotg *hsotg, struct dwc2_qh *qh,
 	int retval;
 
 	if (qh->do_split) {
-		dev_err(hsotg->dev,
-			"SPLIT Transfers are not supported in Descriptor DMA mode.\n");
+		dev_err_ratelimited(hsotg->dev,
+				    "SPLIT Transfers are not supported in Descriptor DMA mode.\n");
 		retval = -EINVAL;
 		goto err0;
 	}
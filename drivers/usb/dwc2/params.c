@@ -449,6 +449,21 @@ static void dwc2_get_device_properties(struct dwc2_hsotg *hsotg)
 		}
 	}
 
+	if ((hsotg->dr_mode == USB_DR_MODE_HOST) ||
+	    (hsotg->dr_mode == USB_DR_MODE_OTG)) {
+		/*
+		 * Descriptor DMA cuts the host interrupt load a lot, but it
+		 * can't do split transactions, so FS/LS devices behind a HS
+		 * hub stop working. Leave it to the board to opt in.
+		 */
+		if (device_property_read_bool(hsotg->dev, "snps,host-dma-desc"))
+			p->dma_desc_enable = true;
+
+		if (device_property_read_bool(hsotg->dev,
+					      "snps,host-dma-desc-fs"))
+			p->dma_desc_fs_enable = true;
+	}
+
 	if (of_find_property(hsotg->dev->of_node, "disable-over-current", NULL))
 		p->oc_disable = true;
 }
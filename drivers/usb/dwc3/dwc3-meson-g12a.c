@@ -269,6 +269,10 @@ static int dwc3_meson_g12a_usb_init(struct dwc3_meson_g12a *priv)
 	/* If we have an actual SuperSpeed port, initialize it */
 	if (priv->usb3_ports)
 		dwc3_meson_g12a_usb3_init(priv);
+	else
+		regmap_update_bits(priv->regmap, USB_R1,
+				USB_R1_U3H_HOST_U3_PORT_DISABLE,
+				USB_R1_U3H_HOST_U3_PORT_DISABLE);
 
 	dwc3_meson_g12a_usb_otg_apply_mode(priv);
 
@@ -300,6 +304,20 @@ static int dwc3_meson_g12a_get_phys(struct dwc3_meson_g12a *priv)
 			priv->usb2_ports++;
 	}
 
+	/*
+	 * In USB2-only mode the USB3 PHY is never initialized nor powered,
+	 * which keeps the shared USB3/PCIe PHY gated.
+	 */
+	if (priv->usb3_ports) {
+		enum usb_device_speed speed = usb_get_maximum_speed(priv->dev);
+
+		if (speed != USB_SPEED_UNKNOWN && speed <= USB_SPEED_HIGH) {
+			devm_phy_put(priv->dev, priv->phys[USB3_HOST_PHY]);
+			priv->phys[USB3_HOST_PHY] = NULL;
+			priv->usb3_ports = 0;
+		}
+	}
+
 	dev_info(priv->dev, "USB2 ports: %d\n", priv->usb2_ports);
 	dev_info(priv->dev, "USB3 ports: %d\n", priv->usb3_ports);
 
@@ -15,6 +15,7 @@
 /* #define VERBOSE_DEBUG */
 
 #include <linux/blkdev.h>
+#include <linux/dma-mapping.h>
 #include <linux/pagemap.h>
 #include <linux/export.h>
 #include <linux/fs_parser.h>
@@ -226,6 +227,11 @@ struct ffs_io_data {
 	struct sg_table sgt;
 	bool use_sg;
 
+	/* user pages the request transfers to/from directly, if any */
+	struct page **pages;
+	unsigned int n_pages;
+	bool zerocopy;
+
 	struct ffs_data *ffs;
 };
 
@@ -802,8 +808,81 @@ static inline void *ffs_alloc_buffer(struct ffs_io_data *io_data,
 	return kmalloc(data_len, GFP_KERNEL);
 }
 
+/*
+ * Large transfers from a single user buffer can be done straight to/from its
+ * pages instead of bouncing them through a kernel buffer.  OUT transfers need
+ * the buffer to span whole cache lines though, as invalidating a partial line
+ * before the DMA could clobber unrelated user data sharing it.
+ */
+static bool ffs_can_zerocopy(struct ffs_io_data *io_data, size_t data_len)
+{
+	struct iov_iter *iter = &io_data->data;
+	unsigned int align = dma_get_cache_alignment();
+
+	if (!iter_is_iovec(iter) || iter->nr_segs != 1)
+		return false;
+
+	if (!io_data->read)
+		return true;
+
+	return data_len == iov_iter_count(iter) &&
+	       IS_ALIGNED((unsigned long)iter->iov->iov_base + iter->iov_offset,
+			  align) &&
+	       IS_ALIGNED(data_len, align);
+}
+
+static int ffs_pin_user_buffer(struct ffs_io_data *io_data, size_t data_len)
+{
+	struct page **pages;
+	unsigned int n_pages, i;
+	size_t off;
+	ssize_t n;
+
+	n = iov_iter_get_pages_alloc(&io_data->data, &pages, data_len, &off);
+	if (n < 0)
+		return n;
+
+	n_pages = DIV_ROUND_UP(off + n, PAGE_SIZE);
+	if (n != data_len ||
+	    sg_alloc_table_from_pages(&io_data->sgt, pages, n_pages, off,
+				      data_len, GFP_KERNEL)) {
+		for (i = 0; i < n_pages; i++)
+			put_page(pages[i]);
+		kvfree(pages);
+		return -ENOMEM;
+	}
+
+	io_data->pages = pages;
+	io_data->n_pages = n_pages;
+
+	/* the data is consumed as soon as the request is queued */
+	if (!io_data->read)
+		iov_iter_advance(&io_data->data, data_len);
+
+	return 0;
+}
+
+static void ffs_unpin_user_buffer(struct ffs_io_data *io_data)
+{
+	unsigned int i;
+
+	sg_free_table(&io_data->sgt);
+	for (i = 0; i < io_data->n_pages; i++) {
+		if (io_data->read)
+			set_page_dirty_lock(io_data->pages[i]);
+		put_page(io_data->pages[i]);
+	}
+	kvfree(io_data->pages);
+	io_data->pages = NULL;
+}
+
 static inline void ffs_free_buffer(struct ffs_io_data *io_data)
 {
+	if (io_data->pages) {
+		ffs_unpin_user_buffer(io_data);
+		return;
+	}
+
 	if (!io_data->buf)
 		return;
 
@@ -823,7 +902,7 @@ static void ffs_user_copy_worker(struct work_struct *work)
 					 io_data->req->actual;
 	bool kiocb_has_eventfd = io_data->kiocb->ki_flags & IOCB_EVENTFD;
 
-	if (io_data->read && ret > 0) {
+	if (io_data->read && ret > 0 && !io_data->zerocopy) {
 		mm_segment_t oldfs = get_fs();
 
 		set_fs(USER_DS);
@@ -1016,15 +1095,22 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 		io_data->use_sg = gadget->sg_supported && data_len > PAGE_SIZE;
 		spin_unlock_irq(&epfile->ffs->eps_lock);
 
-		data = ffs_alloc_buffer(io_data, data_len);
-		if (unlikely(!data)) {
-			ret = -ENOMEM;
-			goto error_mutex;
-		}
-		if (!io_data->read &&
-		    !copy_from_iter_full(data, data_len, &io_data->data)) {
-			ret = -EFAULT;
-			goto error_mutex;
+		/* fall back to a bounce buffer if the pages can't be pinned */
+		io_data->zerocopy = io_data->use_sg &&
+				    ffs_can_zerocopy(io_data, data_len) &&
+				    !ffs_pin_user_buffer(io_data, data_len);
+
+		if (!io_data->zerocopy) {
+			data = ffs_alloc_buffer(io_data, data_len);
+			if (unlikely(!data)) {
+				ret = -ENOMEM;
+				goto error_mutex;
+			}
+			if (!io_data->read &&
+			    !copy_from_iter_full(data, data_len, &io_data->data)) {
+				ret = -EFAULT;
+				goto error_mutex;
+			}
 		}
 	}
 
@@ -1089,13 +1175,20 @@ static ssize_t ffs_epfile_io(struct file *file, struct ffs_io_data *io_data)
 			interrupted = ep->status < 0;
 		}
 
-		if (interrupted)
+		if (interrupted) {
 			ret = -EINTR;
-		else if (io_data->read && ep->status > 0)
-			ret = __ffs_epfile_read_data(epfile, data, ep->status,
-						     &io_data->data);
-		else
+		} else if (io_data->read && ep->status > 0) {
+			if (io_data->zerocopy) {
+				iov_iter_advance(&io_data->data, ep->status);
+				ret = ep->status;
+			} else {
+				ret = __ffs_epfile_read_data(epfile, data,
+							     ep->status,
+							     &io_data->data);
+			}
+		} else {
 			ret = ep->status;
+		}
 		goto error_mutex;
 	} else if (!(req = usb_ep_alloc_request(ep->ep, GFP_ATOMIC))) {
 		ret = -ENOMEM;
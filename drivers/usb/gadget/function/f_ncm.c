@@ -75,6 +75,13 @@ struct f_ncm {
 	bool				timer_force_tx;
 	struct hrtimer			task_timer;
 	bool				timer_stopping;
+
+	/* NTB aggregation settings and state */
+	u64				tx_timeout_ns;
+	u16				tx_max_dpe;
+	bool				tx_adaptive;
+	ktime_t				last_tx;
+	struct f_ncm_opts		*opts;
 };
 
 static inline struct f_ncm *func_to_ncm(struct usb_function *f)
@@ -113,8 +120,12 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
  */
 #define TX_MAX_NUM_DPE		32
 
+/* Upper bound of the NDP size that can be configured through configfs. */
+#define TX_MAX_NUM_DPE_LIMIT	128
+
 /* Delay for the transmit to wait before sending an unfilled NTB frame. */
-#define TX_TIMEOUT_NSECS	300000
+#define TX_TIMEOUT_USECS	300
+#define TX_TIMEOUT_MAX_USECS	10000
 
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
@@ -983,6 +994,8 @@ static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 	/* Set the final NDP wLength */
 	new_len = opts->ndp_size +
 			(ncm->ndp_dgram_count * dgram_idx_len);
+	ncm->opts->tx_ntbs++;
+	ncm->opts->tx_datagrams += ncm->ndp_dgram_count - 1;
 	ncm->ndp_dgram_count = 0;
 	/* Increment from start to wLength */
 	ntb_iter = (void *) ncm->skb_tx_ndp->data;
@@ -1031,6 +1044,19 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		return NULL;
 
 	if (skb) {
+		ktime_t now = ktime_get();
+		bool idle;
+
+		/*
+		 * Nothing was sent for longer than the aggregation timeout,
+		 * so there is no point in delaying this datagram waiting for
+		 * others; NTBs only grow when the datagrams come in bursts.
+		 */
+		idle = ncm->tx_adaptive && !ncm->skb_tx_data &&
+		       ktime_to_ns(ktime_sub(now, ncm->last_tx)) >
+		       ncm->tx_timeout_ns;
+		ncm->last_tx = now;
+
 		/* Add the CRC if required up front */
 		if (ncm->is_crc) {
 			uint32_t	crc;
@@ -1049,7 +1075,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		 * NOTE: Assume maximum align for speed of calculation.
 		 */
 		if (ncm->skb_tx_data
-		    && (ncm->ndp_dgram_count >= TX_MAX_NUM_DPE
+		    && (ncm->ndp_dgram_count >= ncm->tx_max_dpe
 		    || (ncm->skb_tx_data->len +
 		    div + rem + skb->len +
 		    ncm->skb_tx_ndp->len + ndp_align + (2 * dgram_idx_len))
@@ -1083,7 +1109,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			 */
 			ncm->skb_tx_ndp = alloc_skb((int)(opts->ndp_size
 						    + opts->dpe_size
-						    * TX_MAX_NUM_DPE),
+						    * ncm->tx_max_dpe),
 						    GFP_ATOMIC);
 			if (!ncm->skb_tx_ndp)
 				goto err;
@@ -1102,8 +1128,9 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		}
 
 		/* Delay the timer. */
-		hrtimer_start(&ncm->task_timer, TX_TIMEOUT_NSECS,
-			      HRTIMER_MODE_REL_SOFT);
+		if (!idle)
+			hrtimer_start(&ncm->task_timer, ncm->tx_timeout_ns,
+				      HRTIMER_MODE_REL_SOFT);
 
 		/* Add the datagram position entries */
 		ntb_ndp = skb_put_zero(ncm->skb_tx_ndp, dgram_idx_len);
@@ -1124,8 +1151,15 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		dev_consume_skb_any(skb);
 		skb = NULL;
 
+		if (idle) {
+			skb2 = package_for_tx(ncm);
+			if (!skb2)
+				goto err;
+		}
+
 	} else if (ncm->skb_tx_data && ncm->timer_force_tx) {
 		/* If the tx was requested because of a timeout then send */
+		ncm->opts->tx_timeout_flushes++;
 		skb2 = package_for_tx(ncm);
 		if (!skb2)
 			goto err;
@@ -1561,11 +1595,160 @@ USB_ETHERNET_CONFIGFS_ITEM_ATTR_QMULT(ncm);
 /* f_ncm_opts_ifname */
 USB_ETHERNET_CONFIGFS_ITEM_ATTR_IFNAME(ncm);
 
+static ssize_t ncm_opts_tx_timeout_usecs_show(struct config_item *item,
+					      char *page)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	u32 val;
+
+	mutex_lock(&opts->lock);
+	val = opts->tx_timeout_usecs;
+	mutex_unlock(&opts->lock);
+
+	return sprintf(page, "%u\n", val);
+}
+
+static ssize_t ncm_opts_tx_timeout_usecs_store(struct config_item *item,
+					       const char *page, size_t len)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	u32 val;
+	int ret;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = kstrtou32(page, 0, &val);
+	if (ret)
+		goto out;
+
+	if (!val || val > TX_TIMEOUT_MAX_USECS) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	opts->tx_timeout_usecs = val;
+	ret = len;
+out:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+CONFIGFS_ATTR(ncm_opts_, tx_timeout_usecs);
+
+static ssize_t ncm_opts_tx_max_datagrams_show(struct config_item *item,
+					      char *page)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	u16 val;
+
+	mutex_lock(&opts->lock);
+	val = opts->tx_max_datagrams;
+	mutex_unlock(&opts->lock);
+
+	return sprintf(page, "%u\n", val);
+}
+
+static ssize_t ncm_opts_tx_max_datagrams_store(struct config_item *item,
+					       const char *page, size_t len)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	u16 val;
+	int ret;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = kstrtou16(page, 0, &val);
+	if (ret)
+		goto out;
+
+	/* one NDP entry is always taken by the terminating null entry */
+	if (!val || val >= TX_MAX_NUM_DPE_LIMIT) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	opts->tx_max_datagrams = val;
+	ret = len;
+out:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+CONFIGFS_ATTR(ncm_opts_, tx_max_datagrams);
+
+static ssize_t ncm_opts_tx_adaptive_show(struct config_item *item,
+					 char *page)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	bool val;
+
+	mutex_lock(&opts->lock);
+	val = opts->tx_adaptive;
+	mutex_unlock(&opts->lock);
+
+	return sprintf(page, "%d\n", val);
+}
+
+static ssize_t ncm_opts_tx_adaptive_store(struct config_item *item,
+					  const char *page, size_t len)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+	bool val;
+	int ret;
+
+	mutex_lock(&opts->lock);
+	if (opts->refcnt) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = kstrtobool(page, &val);
+	if (ret)
+		goto out;
+
+	opts->tx_adaptive = val;
+	ret = len;
+out:
+	mutex_unlock(&opts->lock);
+	return ret;
+}
+
+CONFIGFS_ATTR(ncm_opts_, tx_adaptive);
+
+#define NCM_OPTS_ATTR_STAT(_name)					\
+	static ssize_t ncm_opts_##_name##_show(struct config_item *item, \
+					       char *page)		\
+	{								\
+		struct f_ncm_opts *opts = to_f_ncm_opts(item);		\
+									\
+		return sprintf(page, "%llu\n", READ_ONCE(opts->_name));	\
+	}								\
+									\
+	CONFIGFS_ATTR_RO(ncm_opts_, _name)
+
+NCM_OPTS_ATTR_STAT(tx_ntbs);
+NCM_OPTS_ATTR_STAT(tx_datagrams);
+NCM_OPTS_ATTR_STAT(tx_timeout_flushes);
+
 static struct configfs_attribute *ncm_attrs[] = {
 	&ncm_opts_attr_dev_addr,
 	&ncm_opts_attr_host_addr,
 	&ncm_opts_attr_qmult,
 	&ncm_opts_attr_ifname,
+	&ncm_opts_attr_tx_timeout_usecs,
+	&ncm_opts_attr_tx_max_datagrams,
+	&ncm_opts_attr_tx_adaptive,
+	&ncm_opts_attr_tx_ntbs,
+	&ncm_opts_attr_tx_datagrams,
+	&ncm_opts_attr_tx_timeout_flushes,
 	NULL,
 };
 
@@ -1601,6 +1784,9 @@ static struct usb_function_instance *ncm_alloc_inst(void)
 	opts->ncm_os_desc.ext_compat_id = opts->ncm_ext_compat_id;
 
 	mutex_init(&opts->lock);
+	opts->tx_timeout_usecs = TX_TIMEOUT_USECS;
+	opts->tx_max_datagrams = TX_MAX_NUM_DPE - 1;
+	opts->tx_adaptive = true;
 	opts->func_inst.free_func_inst = ncm_free_inst;
 	opts->net = gether_setup_default();
 	if (IS_ERR(opts->net)) {
@@ -1690,6 +1876,10 @@ static struct usb_function *ncm_alloc(struct usb_function_instance *fi)
 	spin_lock_init(&ncm->lock);
 	ncm_reset_values(ncm);
 	ncm->port.ioport = netdev_priv(opts->net);
+	ncm->tx_timeout_ns = (u64)opts->tx_timeout_usecs * NSEC_PER_USEC;
+	ncm->tx_max_dpe = opts->tx_max_datagrams + 1;
+	ncm->tx_adaptive = opts->tx_adaptive;
+	ncm->opts = opts;
 	mutex_unlock(&opts->lock);
 	ncm->port.is_fixed = true;
 	ncm->port.supports_multi_frame = true;
@@ -31,6 +31,16 @@ struct f_ncm_opts {
 	 */
 	struct mutex			lock;
 	int				refcnt;
+
+	/* NTB aggregation tunables, applied when the function is allocated */
+	u32				tx_timeout_usecs;
+	u16				tx_max_datagrams;
+	bool				tx_adaptive;
+
+	/* TX statistics, updated without the lock */
+	u64				tx_ntbs;
+	u64				tx_datagrams;
+	u64				tx_timeout_flushes;
 };
 
 #endif /* U_NCM_H */
@@ -73,6 +73,14 @@ extern unsigned int uvc_gadget_trace_param;
  * Structures
  */
 
+struct uvc_request {
+	struct usb_request *req;
+	u8 *req_buffer;
+	struct uvc_video *video;
+	struct sg_table sgt;
+	u8 header[2];
+};
+
 struct uvc_video {
 	struct uvc_device *uvc;
 	struct usb_ep *ep;
@@ -87,8 +95,7 @@ struct uvc_video {
 
 	/* Requests */
 	unsigned int req_size;
-	struct usb_request *req[UVC_NUM_REQUESTS];
-	__u8 *req_buffer[UVC_NUM_REQUESTS];
+	struct uvc_request *ureq;
 	struct list_head req_free;
 	spinlock_t req_lock;
 
@@ -9,6 +9,7 @@
 #include <linux/kernel.h>
 #include <linux/device.h>
 #include <linux/errno.h>
+#include <linux/scatterlist.h>
 #include <linux/usb/ch9.h>
 #include <linux/usb/gadget.h>
 #include <linux/usb/video.h>
@@ -94,6 +95,56 @@ uvc_video_encode_bulk(struct usb_request *req, struct uvc_video *video,
 		video->payload_size = 0;
 }
 
+static void
+uvc_video_encode_isoc_sg(struct usb_request *req, struct uvc_video *video,
+		struct uvc_buffer *buf)
+{
+	unsigned int pending = buf->bytesused - video->queue.buf_used;
+	struct uvc_request *ureq = req->context;
+	struct scatterlist *sg = ureq->sgt.sgl;
+	unsigned int len = video->req_size;
+	unsigned int nents = 1;
+	int header_len;
+
+	sg_init_table(sg, ureq->sgt.orig_nents);
+
+	/* The header lives in the request, the payload in the buffer pages. */
+	header_len = uvc_video_encode_header(video, buf, ureq->header, len);
+	sg_set_buf(sg, ureq->header, header_len);
+	len = min(len - header_len, pending);
+	req->length = header_len + len;
+
+	while (len && buf->sg && nents < ureq->sgt.orig_nents) {
+		unsigned int part = min(len, buf->sg->length - buf->offset);
+
+		sg = sg_next(sg);
+		sg_set_page(sg, sg_page(buf->sg), part,
+			    buf->sg->offset + buf->offset);
+		nents++;
+
+		buf->offset += part;
+		if (buf->offset == buf->sg->length) {
+			buf->offset = 0;
+			buf->sg = sg_next(buf->sg);
+		}
+		len -= part;
+	}
+	sg_mark_end(sg);
+
+	req->buf = NULL;
+	req->sg = ureq->sgt.sgl;
+	req->num_sgs = nents;
+	req->length -= len;
+	video->queue.buf_used += req->length - header_len;
+
+	if (buf->bytesused == video->queue.buf_used || !buf->sg) {
+		video->queue.buf_used = 0;
+		buf->state = UVC_BUF_STATE_DONE;
+		uvcg_queue_next_buffer(&video->queue, buf);
+		video->fid ^= UVC_STREAM_FID;
+	}
+}
+
 static void
 uvc_video_encode_isoc(struct usb_request *req, struct uvc_video *video,
 		struct uvc_buffer *buf)
@@ -175,7 +226,8 @@ static int uvcg_video_ep_queue(struct uvc_video *video, struct usb_request *req)
 static void
 uvc_video_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct uvc_video *video = req->context;
+	struct uvc_request *ureq = req->context;
+	struct uvc_video *video = ureq->video;
 	struct uvc_video_queue *queue = &video->queue;
 	struct uvc_buffer *buf;
 	unsigned long flags;
@@ -228,16 +280,22 @@ uvc_video_free_requests(struct uvc_video *video)
 {
 	unsigned int i;
 
-	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		if (video->req[i]) {
-			usb_ep_free_request(video->ep, video->req[i]);
-			video->req[i] = NULL;
-		}
+	if (video->ureq) {
+		for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
+			sg_free_table(&video->ureq[i].sgt);
+
+			if (video->ureq[i].req) {
+				usb_ep_free_request(video->ep,
+						    video->ureq[i].req);
+				video->ureq[i].req = NULL;
+			}
 
-		if (video->req_buffer[i]) {
-			kfree(video->req_buffer[i]);
-			video->req_buffer[i] = NULL;
+			kfree(video->ureq[i].req_buffer);
+			video->ureq[i].req_buffer = NULL;
 		}
+
+		kfree(video->ureq);
+		video->ureq = NULL;
 	}
 
 	INIT_LIST_HEAD(&video->req_free);
@@ -258,21 +316,39 @@ uvc_video_alloc_requests(struct uvc_video *video)
 		 * max_t(unsigned int, video->ep->maxburst, 1)
 		 * (video->ep->mult);
 
+	video->ureq = kcalloc(UVC_NUM_REQUESTS, sizeof(*video->ureq),
+			      GFP_KERNEL);
+	if (video->ureq == NULL)
+		return -ENOMEM;
+
 	for (i = 0; i < UVC_NUM_REQUESTS; ++i) {
-		video->req_buffer[i] = kmalloc(req_size, GFP_KERNEL);
-		if (video->req_buffer[i] == NULL)
+		struct uvc_request *ureq = &video->ureq[i];
+
+		ureq->req_buffer = kmalloc(req_size, GFP_KERNEL);
+		if (ureq->req_buffer == NULL)
 			goto error;
 
-		video->req[i] = usb_ep_alloc_request(video->ep, GFP_KERNEL);
-		if (video->req[i] == NULL)
+		ureq->req = usb_ep_alloc_request(video->ep, GFP_KERNEL);
+		if (ureq->req == NULL)
 			goto error;
 
-		video->req[i]->buf = video->req_buffer[i];
-		video->req[i]->length = 0;
-		video->req[i]->complete = uvc_video_complete;
-		video->req[i]->context = video;
+		ureq->req->buf = ureq->req_buffer;
+		ureq->req->length = 0;
+		ureq->req->complete = uvc_video_complete;
+		ureq->req->context = ureq;
+		ureq->video = video;
+
+		/*
+		 * One entry for the header, and enough for a payload that
+		 * starts in the middle of a page.
+		 */
+		if (video->queue.use_sg &&
+		    sg_alloc_table(&ureq->sgt,
+				   DIV_ROUND_UP(req_size, PAGE_SIZE) + 2,
+				   GFP_KERNEL))
+			goto error;
 
-		list_add_tail(&video->req[i]->list, &video->req_free);
+		list_add_tail(&ureq->req->list, &video->req_free);
 	}
 
 	video->req_size = req_size;
@@ -363,9 +439,11 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	}
 
 	if (!enable) {
-		for (i = 0; i < UVC_NUM_REQUESTS; ++i)
-			if (video->req[i])
-				usb_ep_dequeue(video->ep, video->req[i]);
+		if (video->ureq)
+			for (i = 0; i < UVC_NUM_REQUESTS; ++i)
+				if (video->ureq[i].req)
+					usb_ep_dequeue(video->ep,
+						       video->ureq[i].req);
 
 		uvc_video_free_requests(video);
 		uvcg_queue_enable(&video->queue, 0);
@@ -381,8 +459,11 @@ int uvcg_video_enable(struct uvc_video *video, int enable)
 	if (video->max_payload_size) {
 		video->encode = uvc_video_encode_bulk;
 		video->payload_size = 0;
-	} else
+	} else if (video->queue.use_sg) {
+		video->encode = uvc_video_encode_isoc_sg;
+	} else {
 		video->encode = uvc_video_encode_isoc;
+	}
 
 	return uvcg_video_pump(video);
 }
@@ -403,8 +484,9 @@ int uvcg_video_init(struct uvc_video *video, struct uvc_device *uvc)
 	video->imagesize = 320 * 240 * 2;
 
 	/* Initialize the video buffers queue. */
-	uvcg_queue_init(&video->queue, V4L2_BUF_TYPE_VIDEO_OUTPUT,
-			&video->mutex);
+	uvcg_queue_init(&video->queue, uvc->v4l2_dev.dev->parent,
+			uvc->func.config->cdev->gadget->sg_supported,
+			V4L2_BUF_TYPE_VIDEO_OUTPUT, &video->mutex);
 	return 0;
 }
 
@@ -395,6 +395,57 @@ static const struct file_operations port_fops = {
 	.release		= single_release,
 };
 
+static int xhci_imod_show(struct seq_file *s, void *unused)
+{
+	struct xhci_hcd		*xhci = s->private;
+
+	seq_printf(s, "%u\n", xhci->imod_interval);
+
+	return 0;
+}
+
+static int xhci_imod_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, xhci_imod_show, inode->i_private);
+}
+
+static ssize_t xhci_imod_write(struct file *file,  const char __user *ubuf,
+			       size_t count, loff_t *ppos)
+{
+	struct seq_file         *s = file->private_data;
+	struct xhci_hcd		*xhci = s->private;
+	unsigned long		flags;
+	u32			imod;
+	u32			temp;
+	int			ret;
+
+	ret = kstrtou32_from_user(ubuf, count, 0, &imod);
+	if (ret)
+		return ret;
+
+	/* IMODI counts in 250ns units */
+	if (imod / 250 > ER_IRQ_INTERVAL_MASK)
+		return -ERANGE;
+
+	spin_lock_irqsave(&xhci->lock, flags);
+	xhci->imod_interval = imod;
+	temp = readl(&xhci->ir_set->irq_control);
+	temp &= ~ER_IRQ_INTERVAL_MASK;
+	temp |= (imod / 250) & ER_IRQ_INTERVAL_MASK;
+	writel(temp, &xhci->ir_set->irq_control);
+	spin_unlock_irqrestore(&xhci->lock, flags);
+
+	return count;
+}
+
+static const struct file_operations imod_fops = {
+	.open			= xhci_imod_open,
+	.write                  = xhci_imod_write,
+	.read			= seq_read,
+	.llseek			= seq_lseek,
+	.release		= single_release,
+};
+
 static void xhci_debugfs_create_files(struct xhci_hcd *xhci,
 				      struct xhci_file_map *files,
 				      size_t nentries, void *data,
@@ -582,6 +633,9 @@ void xhci_debugfs_init(struct xhci_hcd *xhci)
 				     "event-ring",
 				     xhci->debugfs_root);
 
+	debugfs_create_file("imod-interval-ns", 0644, xhci->debugfs_root, xhci,
+			    &imod_fops);
+
 	xhci->debugfs_slots = debugfs_create_dir("devices", xhci->debugfs_root);
 
 	xhci_debugfs_create_ports(xhci, xhci->debugfs_root);
@@ -24,13 +24,147 @@
 #include <linux/module.h>
 #include <linux/bio.h>
 #include <linux/namei.h>
+#include <linux/scatterlist.h>
+#include <crypto/skcipher.h>
 #include "fscrypt_private.h"
 
+/*
+ * With an asynchronous cipher implementation, e.g. a hardware engine, all the
+ * blocks of a bio are queued at once and waited for together, instead of one
+ * round trip to the engine per block.
+ */
+struct fscrypt_bio_batch {
+	atomic_t pending;
+	struct completion done;
+};
+
+struct fscrypt_batch_req {
+	struct fscrypt_bio_batch *batch;
+	const struct inode *inode;
+	struct page *page;
+	u64 lblk_num;
+	union fscrypt_iv iv;
+	struct scatterlist sg;
+	/* must be last, followed by the tfm request context */
+	struct skcipher_request req;
+};
+
+static void fscrypt_batch_put(struct fscrypt_bio_batch *batch)
+{
+	if (atomic_dec_and_test(&batch->pending))
+		complete(&batch->done);
+}
+
+static void fscrypt_batch_req_done(struct crypto_async_request *areq, int err)
+{
+	struct fscrypt_batch_req *breq = areq->data;
+	struct fscrypt_bio_batch *batch = breq->batch;
+
+	/* A backlogged request has only been started */
+	if (err == -EINPROGRESS)
+		return;
+
+	if (err) {
+		fscrypt_err(breq->inode, "Decryption failed for block %llu: %d",
+			    breq->lblk_num, err);
+		SetPageError(breq->page);
+	}
+	kfree(breq);
+	fscrypt_batch_put(batch);
+}
+
+static void fscrypt_batch_decrypt_block(struct fscrypt_bio_batch *batch,
+					struct page *page, unsigned int len,
+					unsigned int offs, u64 lblk_num)
+{
+	const struct inode *inode = page->mapping->host;
+	struct fscrypt_info *ci = inode->i_crypt_info;
+	struct crypto_skcipher *tfm = ci->ci_ctfm;
+	struct fscrypt_batch_req *breq;
+	int err;
+
+	breq = kmalloc(sizeof(*breq) + crypto_skcipher_reqsize(tfm), GFP_NOFS);
+	if (!breq) {
+		/* Fall back to decrypting this block synchronously */
+		if (fscrypt_crypt_block(inode, FS_DECRYPT, lblk_num, page,
+					page, len, offs, GFP_NOFS))
+			SetPageError(page);
+		return;
+	}
+
+	breq->batch = batch;
+	breq->inode = inode;
+	breq->page = page;
+	breq->lblk_num = lblk_num;
+	fscrypt_generate_iv(&breq->iv, lblk_num, ci);
+
+	sg_init_table(&breq->sg, 1);
+	sg_set_page(&breq->sg, page, len, offs);
+
+	skcipher_request_set_tfm(&breq->req, tfm);
+	skcipher_request_set_callback(&breq->req,
+				      CRYPTO_TFM_REQ_MAY_BACKLOG |
+				      CRYPTO_TFM_REQ_MAY_SLEEP,
+				      fscrypt_batch_req_done, breq);
+	skcipher_request_set_crypt(&breq->req, &breq->sg, &breq->sg, len,
+				   &breq->iv);
+
+	atomic_inc(&batch->pending);
+	err = crypto_skcipher_decrypt(&breq->req);
+	if (err != -EINPROGRESS && err != -EBUSY)
+		fscrypt_batch_req_done(&breq->req.base, err);
+}
+
+static bool fscrypt_decrypt_bio_batched(struct bio *bio)
+{
+	const struct inode *inode = bio_first_page_all(bio)->mapping->host;
+	struct crypto_skcipher *tfm = inode->i_crypt_info->ci_ctfm;
+	const unsigned int blockbits = inode->i_blkbits;
+	const unsigned int blocksize = 1 << blockbits;
+	struct fscrypt_bio_batch batch;
+	struct bio_vec *bv;
+	struct bvec_iter_all iter_all;
+
+	if (!(crypto_skcipher_get_flags(tfm) & CRYPTO_ALG_ASYNC))
+		return false;
+
+	/* Hold a reference so the batch can't complete while submitting */
+	atomic_set(&batch.pending, 1);
+	init_completion(&batch.done);
+
+	bio_for_each_segment_all(bv, bio, iter_all) {
+		struct page *page = bv->bv_page;
+		u64 lblk_num = ((u64)page->index << (PAGE_SHIFT - blockbits)) +
+			       (bv->bv_offset >> blockbits);
+		unsigned int i;
+
+		if (WARN_ON_ONCE(page->mapping->host != inode ||
+				 !IS_ALIGNED(bv->bv_len | bv->bv_offset,
+					     blocksize))) {
+			SetPageError(page);
+			continue;
+		}
+
+		for (i = bv->bv_offset; i < bv->bv_offset + bv->bv_len;
+		     i += blocksize, lblk_num++)
+			fscrypt_batch_decrypt_block(&batch, page, blocksize, i,
+						    lblk_num);
+	}
+
+	fscrypt_batch_put(&batch);
+	wait_for_completion(&batch.done);
+
+	return true;
+}
+
 void fscrypt_decrypt_bio(struct bio *bio)
 {
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 
+	if (fscrypt_decrypt_bio_batched(bio))
+		return;
+
 	bio_for_each_segment_all(bv, bio, iter_all) {
 		struct page *page = bv->bv_page;
 		int ret = fscrypt_decrypt_pagecache_blocks(page, bv->bv_len,
@@ -8,6 +8,7 @@
 #define __EROFS_FS_COMPRESS_H
 
 #include "internal.h"
+#include <linux/vmalloc.h>
 
 enum {
 	Z_EROFS_COMPRESSION_SHIFTED = Z_EROFS_COMPRESSION_MAX,
@@ -53,8 +54,38 @@ static inline bool z_erofs_put_stagingpage(struct list_head *pagepool,
 	return true;
 }
 
+static inline void *erofs_vm_map_ram(struct page **pages, unsigned int count)
+{
+	int i = 0;
+
+	while (1) {
+		void *addr = vm_map_ram(pages, count, -1, PAGE_KERNEL);
+
+		/* retry two more times (totally 3 times) */
+		if (addr || ++i >= 3)
+			return addr;
+		vm_unmap_aliases();
+	}
+	return NULL;
+}
+
 int z_erofs_decompress(struct z_erofs_decompress_req *rq,
 		       struct list_head *pagepool);
 
+/* decompressor_lzma.c */
+#ifdef CONFIG_EROFS_FS_ZIP_LZMA
+int z_erofs_lzma_decompress(struct z_erofs_decompress_req *rq,
+			    struct list_head *pagepool);
+void z_erofs_lzma_exit(void);
+#else
+static inline int z_erofs_lzma_decompress(struct z_erofs_decompress_req *rq,
+					  struct list_head *pagepool)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline void z_erofs_lzma_exit(void) {}
+#endif
+
 #endif
 
@@ -110,17 +110,33 @@ static void *generic_copy_inplace_data(struct z_erofs_decompress_req *rq,
 	return tmp;
 }
 
+static void z_erofs_unmap_inpages(u8 *src, unsigned int nrpages_in)
+{
+	if (nrpages_in == 1)
+		kunmap_atomic(src);
+	else
+		vm_unmap_ram(src, nrpages_in);
+}
+
 static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 {
-	unsigned int inputmargin, inlen;
+	const unsigned int nrpages_in =
+		PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT;
+	unsigned int inputmargin, inlen, i;
 	u8 *src;
 	bool copied, support_0padding;
 	int ret;
 
-	if (rq->inputsize > PAGE_SIZE)
+	if (nrpages_in > Z_EROFS_CLUSTER_MAX_PAGES)
 		return -EOPNOTSUPP;
 
-	src = kmap_atomic(*rq->in);
+	/* big pclusters are mapped contiguously for the LZ4 decoder */
+	if (nrpages_in == 1)
+		src = kmap_atomic(*rq->in);
+	else
+		src = erofs_vm_map_ram(rq->in, nrpages_in);
+	if (!src)
+		return -ENOMEM;
 	inputmargin = 0;
 	support_0padding = false;
 
@@ -134,7 +150,7 @@ static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 				break;
 
 		if (inputmargin >= rq->inputsize) {
-			kunmap_atomic(src);
+			z_erofs_unmap_inpages(src, nrpages_in);
 			return -EIO;
 		}
 	}
@@ -146,11 +162,21 @@ static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 				   rq->outputsize) & ~PAGE_MASK;
 		const uint nr = PAGE_ALIGN(rq->pageofs_out +
 					   rq->outputsize) >> PAGE_SHIFT;
-
-		if (rq->partial_decoding || !support_0padding ||
-		    rq->out[nr - 1] != rq->in[0] ||
-		    rq->inputsize - oend <
-		      LZ4_DECOMPRESS_INPLACE_MARGIN(inlen)) {
+		bool safe = !rq->partial_decoding && support_0padding &&
+			nr >= nrpages_in &&
+			rq->inputsize - (nrpages_in - 1) * PAGE_SIZE - oend >=
+			  LZ4_DECOMPRESS_INPLACE_MARGIN(inlen);
+
+		/* compressed pages must make up the tail of the output */
+		for (i = 0; safe && i < nrpages_in; ++i)
+			safe = rq->out[nr - nrpages_in + i] == rq->in[i];
+
+		if (!safe) {
+			/* vm_unmap_ram() may sleep, drop the mapping first */
+			if (nrpages_in > 1) {
+				vm_unmap_ram(src, nrpages_in);
+				src = NULL;
+			}
 			src = generic_copy_inplace_data(rq, src, inputmargin);
 			inputmargin = 0;
 			copied = true;
@@ -184,7 +210,7 @@ static int z_erofs_lz4_decompress(struct z_erofs_decompress_req *rq, u8 *out)
 	if (copied)
 		erofs_put_pcpubuf(src);
 	else
-		kunmap_atomic(src);
+		z_erofs_unmap_inpages(src, nrpages_in);
 	return ret;
 }
 
@@ -197,6 +223,9 @@ static struct z_erofs_decompressor decompressors[] = {
 		.decompress = z_erofs_lz4_decompress,
 		.name = "lz4"
 	},
+	[Z_EROFS_COMPRESSION_LZMA] = {
+		.name = "lzma"
+	},
 };
 
 static void copy_from_pcpubuf(struct page **out, const char *dst,
@@ -231,12 +260,18 @@ static int z_erofs_decompress_generic(struct z_erofs_decompress_req *rq,
 {
 	const unsigned int nrpages_out =
 		PAGE_ALIGN(rq->pageofs_out + rq->outputsize) >> PAGE_SHIFT;
+	const unsigned int nrpages_in =
+		PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT;
 	const struct z_erofs_decompressor *alg = decompressors + rq->alg;
 	unsigned int dst_maptype;
 	void *dst;
-	int ret, i;
+	int ret;
 
-	if (nrpages_out == 1 && !rq->inplace_io) {
+	/*
+	 * mapping several input pages may sleep, so the atomic fast paths
+	 * below are only usable for single-page pclusters.
+	 */
+	if (nrpages_out == 1 && nrpages_in == 1 && !rq->inplace_io) {
 		DBG_BUGON(!*rq->out);
 		dst = kmap_atomic(*rq->out);
 		dst_maptype = 0;
@@ -248,7 +283,7 @@ static int z_erofs_decompress_generic(struct z_erofs_decompress_req *rq,
 	 * than PAGE_SIZE), memcpy the decompressed data rather than
 	 * compressed data is preferred.
 	 */
-	if (rq->outputsize <= PAGE_SIZE * 7 / 8) {
+	if (rq->outputsize <= PAGE_SIZE * 7 / 8 && nrpages_in == 1) {
 		dst = erofs_get_pcpubuf(0);
 		if (IS_ERR(dst))
 			return PTR_ERR(dst);
@@ -272,16 +307,7 @@ static int z_erofs_decompress_generic(struct z_erofs_decompress_req *rq,
 		goto dstmap_out;
 	}
 
-	i = 0;
-	while (1) {
-		dst = vm_map_ram(rq->out, nrpages_out, -1, PAGE_KERNEL);
-
-		/* retry two more times (totally 3 times) */
-		if (dst || ++i >= 3)
-			break;
-		vm_unmap_aliases();
-	}
-
+	dst = erofs_vm_map_ram(rq->out, nrpages_out);
 	if (!dst)
 		return -ENOMEM;
 
@@ -341,6 +367,9 @@ int z_erofs_decompress(struct z_erofs_decompress_req *rq,
 {
 	if (rq->alg == Z_EROFS_COMPRESSION_SHIFTED)
 		return z_erofs_shifted_transform(rq, pagepool);
+	/* the LZMA decoder may sleep, keep it away from the pcpubuf paths */
+	if (rq->alg == Z_EROFS_COMPRESSION_LZMA)
+		return z_erofs_lzma_decompress(rq, pagepool);
 	return z_erofs_decompress_generic(rq, pagepool);
 }
 
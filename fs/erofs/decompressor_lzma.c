@@ -0,0 +1,254 @@
+// SPDX-License-Identifier: GPL-2.0-only
+#include "compress.h"
+#include <linux/highmem.h>
+#include <linux/xz.h>
+
+/*
+ * MicroLZMA streams are decoded in XZ_SINGLE mode straight into the mapped
+ * output pages, so the dictionary size is only an upper bound of match
+ * distances rather than an allocation.
+ */
+#define Z_EROFS_LZMA_MAX_DICT_SIZE	(8 * 1024 * 1024)
+
+struct z_erofs_lzma {
+	struct z_erofs_lzma *next;
+	struct xz_dec_microlzma *state;
+};
+
+/* decoder states are allocated on demand, one per possible cpu at most */
+static DEFINE_SPINLOCK(z_erofs_lzma_lock);
+static DECLARE_WAIT_QUEUE_HEAD(z_erofs_lzma_wq);
+static struct z_erofs_lzma *z_erofs_lzma_head;
+static unsigned int z_erofs_lzma_nstrms;
+
+void z_erofs_lzma_exit(void)
+{
+	/* there should be no running fs instance */
+	while (z_erofs_lzma_head) {
+		struct z_erofs_lzma *strm = z_erofs_lzma_head;
+
+		z_erofs_lzma_head = strm->next;
+		xz_dec_microlzma_end(strm->state);
+		kfree(strm);
+	}
+	z_erofs_lzma_nstrms = 0;
+}
+
+static struct z_erofs_lzma *z_erofs_lzma_alloc_stream(void)
+{
+	struct z_erofs_lzma *strm = kmalloc(sizeof(*strm), GFP_KERNEL);
+
+	if (!strm)
+		return NULL;
+
+	strm->state = xz_dec_microlzma_alloc(XZ_SINGLE,
+					     Z_EROFS_LZMA_MAX_DICT_SIZE);
+	if (!strm->state) {
+		kfree(strm);
+		return NULL;
+	}
+	return strm;
+}
+
+static struct z_erofs_lzma *z_erofs_lzma_get_stream(void)
+{
+	struct z_erofs_lzma *strm;
+
+again:
+	spin_lock(&z_erofs_lzma_lock);
+	strm = z_erofs_lzma_head;
+	if (strm) {
+		z_erofs_lzma_head = strm->next;
+		spin_unlock(&z_erofs_lzma_lock);
+		return strm;
+	}
+
+	if (z_erofs_lzma_nstrms < num_possible_cpus()) {
+		++z_erofs_lzma_nstrms;
+		spin_unlock(&z_erofs_lzma_lock);
+
+		strm = z_erofs_lzma_alloc_stream();
+		if (strm)
+			return strm;
+
+		spin_lock(&z_erofs_lzma_lock);
+		--z_erofs_lzma_nstrms;
+		spin_unlock(&z_erofs_lzma_lock);
+		/* fall back to waiting for a busy stream if any exists */
+		if (!READ_ONCE(z_erofs_lzma_nstrms))
+			return NULL;
+		goto again;
+	}
+	spin_unlock(&z_erofs_lzma_lock);
+
+	wait_event(z_erofs_lzma_wq, READ_ONCE(z_erofs_lzma_head));
+	goto again;
+}
+
+static void z_erofs_lzma_put_stream(struct z_erofs_lzma *strm)
+{
+	spin_lock(&z_erofs_lzma_lock);
+	strm->next = z_erofs_lzma_head;
+	z_erofs_lzma_head = strm;
+	spin_unlock(&z_erofs_lzma_lock);
+	wake_up(&z_erofs_lzma_wq);
+}
+
+/*
+ * LZMA references the whole decoded extent, so unlike LZ4 no bounce page
+ * can be reused once its data falls out of a sliding window.
+ */
+static int z_erofs_lzma_prepare_destpages(struct z_erofs_decompress_req *rq,
+					  struct list_head *pagepool)
+{
+	const unsigned int nr =
+		PAGE_ALIGN(rq->pageofs_out + rq->outputsize) >> PAGE_SHIFT;
+	unsigned int i;
+
+	for (i = 0; i < nr; ++i) {
+		struct page *victim;
+
+		if (rq->out[i])
+			continue;
+
+		victim = erofs_allocpage(pagepool, GFP_KERNEL);
+		if (!victim)
+			return -ENOMEM;
+		victim->mapping = Z_EROFS_MAPPING_STAGING;
+		rq->out[i] = victim;
+	}
+	return 0;
+}
+
+/*
+ * in-place compressed pages are overwritten while they are still being
+ * read, so decode from private copies of them instead.
+ */
+static int z_erofs_lzma_bounce_inpages(struct z_erofs_decompress_req *rq,
+				       struct page **in,
+				       struct list_head *pagepool)
+{
+	const unsigned int nrpages_in =
+		PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT;
+	unsigned int i;
+
+	for (i = 0; i < nrpages_in; ++i) {
+		in[i] = erofs_allocpage(pagepool, GFP_KERNEL);
+		if (!in[i]) {
+			while (i)
+				list_add(&in[--i]->lru, pagepool);
+			return -ENOMEM;
+		}
+		copy_highpage(in[i], rq->in[i]);
+	}
+	return 0;
+}
+
+int z_erofs_lzma_decompress(struct z_erofs_decompress_req *rq,
+			    struct list_head *pagepool)
+{
+	const unsigned int nrpages_out =
+		PAGE_ALIGN(rq->pageofs_out + rq->outputsize) >> PAGE_SHIFT;
+	const unsigned int nrpages_in =
+		PAGE_ALIGN(rq->inputsize) >> PAGE_SHIFT;
+	struct page *bounced[Z_EROFS_CLUSTER_MAX_PAGES];
+	struct page **in = rq->in;
+	unsigned int inputmargin, inlen, i;
+	struct z_erofs_lzma *strm;
+	struct xz_buf buf = {};
+	bool support_0padding;
+	enum xz_ret xz_err;
+	u8 *kin, *dst;
+	int err;
+
+	if (nrpages_in > Z_EROFS_CLUSTER_MAX_PAGES)
+		return -EOPNOTSUPP;
+
+	err = z_erofs_lzma_prepare_destpages(rq, pagepool);
+	if (err)
+		return err;
+
+	if (rq->inplace_io) {
+		err = z_erofs_lzma_bounce_inpages(rq, bounced, pagepool);
+		if (err)
+			return err;
+		in = bounced;
+	}
+
+	/* compressed data is tail-aligned if 0padding is enabled */
+	inputmargin = 0;
+	support_0padding = EROFS_SB(rq->sb)->feature_incompat &
+		EROFS_FEATURE_INCOMPAT_LZ4_0PADDING;
+	if (support_0padding) {
+		kin = kmap_atomic(*in);
+		while (!kin[inputmargin & ~PAGE_MASK])
+			if (!(++inputmargin & ~PAGE_MASK))
+				break;
+		kunmap_atomic(kin);
+
+		if (inputmargin >= rq->inputsize) {
+			err = -EFSCORRUPTED;
+			goto out_bounced;
+		}
+	}
+	inlen = rq->inputsize - inputmargin;
+
+	if (nrpages_out == 1)
+		dst = kmap(*rq->out);
+	else
+		dst = erofs_vm_map_ram(rq->out, nrpages_out);
+	if (!dst) {
+		err = -ENOMEM;
+		goto out_bounced;
+	}
+
+	strm = z_erofs_lzma_get_stream();
+	if (!strm) {
+		err = -ENOMEM;
+		goto out_unmap;
+	}
+
+	/* the exact size is unknown if only the head of an extent is wanted */
+	xz_dec_microlzma_reset(strm->state, inlen, rq->outputsize,
+			       !rq->partial_decoding && support_0padding);
+
+	buf.out = dst + rq->pageofs_out;
+	buf.out_size = rq->outputsize;
+
+	/* XZ_SINGLE accepts non-contiguous input, feed one page at a time */
+	i = inputmargin >> PAGE_SHIFT;
+	inputmargin &= ~PAGE_MASK;
+	xz_err = XZ_OK;
+	for (; i < nrpages_in; ++i) {
+		kin = kmap(in[i]);
+		buf.in = kin + inputmargin;
+		buf.in_pos = 0;
+		buf.in_size = min_t(unsigned int, inlen,
+				    PAGE_SIZE - inputmargin);
+		inlen -= buf.in_size;
+		inputmargin = 0;
+
+		xz_err = xz_dec_microlzma_run(strm->state, &buf);
+		kunmap(in[i]);
+		if (xz_err != XZ_OK || !inlen)
+			break;
+	}
+
+	if (xz_err != XZ_STREAM_END || buf.out_pos != rq->outputsize) {
+		erofs_err(rq->sb, "failed to decompress %d in[%u] out[%u]",
+			  xz_err, rq->inputsize, rq->outputsize);
+		err = xz_err == XZ_DATA_ERROR ? -EFSCORRUPTED : -EIO;
+	}
+	z_erofs_lzma_put_stream(strm);
+
+out_unmap:
+	if (nrpages_out == 1)
+		kunmap(*rq->out);
+	else
+		vm_unmap_ram(dst, nrpages_out);
+out_bounced:
+	if (in == bounced)
+		for (i = 0; i < nrpages_in; ++i)
+			list_add(&bounced[i]->lru, pagepool);
+	return err;
+}
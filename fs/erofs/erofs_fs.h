@@ -191,7 +191,8 @@ static inline unsigned int erofs_xattr_entry_size(struct erofs_xattr_entry *e)
 
 /* available compression algorithm types (for h_algorithmtype) */
 enum {
-	Z_EROFS_COMPRESSION_LZ4	= 0,
+	Z_EROFS_COMPRESSION_LZ4		= 0,
+	Z_EROFS_COMPRESSION_LZMA	= 1,
 	Z_EROFS_COMPRESSION_MAX
 };
 
@@ -228,6 +229,8 @@ struct z_erofs_map_header {
  *    0 - literal (uncompressed) cluster
  *    1 - compressed cluster (for the head logical cluster)
  *    2 - compressed cluster (for the other logical clusters)
+ *    3 - compressed cluster (for the head logical cluster, which
+ *        uses the algorithm and physical cluster size of head 2)
  *
  * In detail,
  *    0 - literal (uncompressed) cluster,
@@ -252,7 +255,7 @@ enum {
 	Z_EROFS_VLE_CLUSTER_TYPE_PLAIN		= 0,
 	Z_EROFS_VLE_CLUSTER_TYPE_HEAD		= 1,
 	Z_EROFS_VLE_CLUSTER_TYPE_NONHEAD	= 2,
-	Z_EROFS_VLE_CLUSTER_TYPE_RESERVED	= 3,
+	Z_EROFS_VLE_CLUSTER_TYPE_HEAD2		= 3,
 	Z_EROFS_VLE_CLUSTER_TYPE_MAX
 };
 
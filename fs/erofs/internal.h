@@ -55,7 +55,10 @@ struct erofs_sb_info {
 	/* managed XArray arranged in physical block number */
 	struct xarray managed_pslots;
 
-	/* threshold for decompression synchronously */
+	/*
+	 * reads of up to this many pages are decompressed inline by the
+	 * reader, larger ones and pure readahead go to the workqueue.
+	 */
 	unsigned int max_sync_decompress_pages;
 
 	unsigned int shrinker_run_no;
@@ -325,6 +328,8 @@ struct erofs_map_blocks {
 	u64 m_plen, m_llen;
 
 	unsigned int m_flags;
+	/* compression algorithm of the extent, valid if EROFS_MAP_ZIPPED */
+	unsigned char m_algorithmformat;
 
 	struct page *mpage;
 };
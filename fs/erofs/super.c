@@ -248,6 +248,7 @@ enum {
 	Opt_acl,
 	Opt_noacl,
 	Opt_cache_strategy,
+	Opt_sync_decompress,
 	Opt_err
 };
 
@@ -257,6 +258,7 @@ static match_table_t erofs_tokens = {
 	{Opt_acl, "acl"},
 	{Opt_noacl, "noacl"},
 	{Opt_cache_strategy, "cache_strategy=%s"},
+	{Opt_sync_decompress, "sync_decompress=%u"},
 	{Opt_err, NULL}
 };
 
@@ -264,7 +266,7 @@ static int erofs_parse_options(struct super_block *sb, char *options)
 {
 	substring_t args[MAX_OPT_ARGS];
 	char *p;
-	int err;
+	int err, arg;
 
 	if (!options)
 		return 0;
@@ -314,6 +316,15 @@ static int erofs_parse_options(struct super_block *sb, char *options)
 			if (err)
 				return err;
 			break;
+		case Opt_sync_decompress:
+			if (match_int(&args[0], &arg) || arg < 0)
+				return -EINVAL;
+#ifdef CONFIG_EROFS_FS_ZIP
+			EROFS_SB(sb)->max_sync_decompress_pages = arg;
+#else
+			erofs_info(sb, "EROFS compression is disabled, so sync_decompress is ignored");
+#endif
+			break;
 		default:
 			erofs_err(sb, "Unrecognized mount option \"%s\" or missing value", p);
 			return -EINVAL;
@@ -599,6 +610,7 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 	} else if (sbi->cache_strategy == EROFS_ZIP_CACHE_READAROUND) {
 		seq_puts(seq, ",cache_strategy=readaround");
 	}
+	seq_printf(seq, ",sync_decompress=%u", sbi->max_sync_decompress_pages);
 #endif
 	return 0;
 }
@@ -34,10 +34,71 @@ typedef tagptr1_t compressed_page_t;
 static struct workqueue_struct *z_erofs_workqueue __read_mostly;
 static struct kmem_cache *pcluster_cachep __read_mostly;
 
+/*
+ * page maps for pclusters too large for the stack, one per possible cpu
+ * so that decompression on different cores won't serialize on a single
+ * global array.
+ */
+struct z_erofs_pagemap {
+	struct mutex lock;
+	struct page *pages[Z_EROFS_VMAP_PCPU_PAGES];
+};
+static struct z_erofs_pagemap **z_pagemap_pcpu __read_mostly;
+
+static void z_erofs_destroy_pagemaps(void)
+{
+	unsigned int cpu;
+
+	for_each_possible_cpu(cpu)
+		kvfree(z_pagemap_pcpu[cpu]);
+	kfree(z_pagemap_pcpu);
+}
+
+static int z_erofs_init_pagemaps(void)
+{
+	unsigned int cpu;
+
+	z_pagemap_pcpu = kcalloc(nr_cpu_ids, sizeof(*z_pagemap_pcpu),
+				 GFP_KERNEL);
+	if (!z_pagemap_pcpu)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct z_erofs_pagemap *pm = kvmalloc(sizeof(*pm), GFP_KERNEL);
+
+		if (!pm) {
+			z_erofs_destroy_pagemaps();
+			return -ENOMEM;
+		}
+		mutex_init(&pm->lock);
+		z_pagemap_pcpu[cpu] = pm;
+	}
+	return 0;
+}
+
+/* prefer the local page map, otherwise borrow an idle one of other cpus */
+static struct z_erofs_pagemap *z_erofs_trylock_pagemap(void)
+{
+	struct z_erofs_pagemap *pm = z_pagemap_pcpu[raw_smp_processor_id()];
+	unsigned int cpu;
+
+	if (mutex_trylock(&pm->lock))
+		return pm;
+
+	for_each_possible_cpu(cpu) {
+		pm = z_pagemap_pcpu[cpu];
+		if (mutex_trylock(&pm->lock))
+			return pm;
+	}
+	return NULL;
+}
+
 void z_erofs_exit_zip_subsystem(void)
 {
 	destroy_workqueue(z_erofs_workqueue);
+	z_erofs_destroy_pagemaps();
 	kmem_cache_destroy(pcluster_cachep);
+	z_erofs_lzma_exit();
 }
 
 static inline int z_erofs_init_workqueue(void)
@@ -74,9 +135,11 @@ int __init z_erofs_init_zip_subsystem(void)
 					    SLAB_RECLAIM_ACCOUNT,
 					    z_erofs_pcluster_init_once);
 	if (pcluster_cachep) {
-		if (!z_erofs_init_workqueue())
-			return 0;
-
+		if (!z_erofs_init_pagemaps()) {
+			if (!z_erofs_init_workqueue())
+				return 0;
+			z_erofs_destroy_pagemaps();
+		}
 		kmem_cache_destroy(pcluster_cachep);
 	}
 	return -ENOMEM;
@@ -148,24 +211,21 @@ struct z_erofs_decompress_frontend {
 	.inode = __i, .clt = COLLECTOR_INIT(), \
 	.backmost = true, }
 
-static struct page *z_pagemap_global[Z_EROFS_VMAP_GLOBAL_PAGES];
-static DEFINE_MUTEX(z_pagemap_global_lock);
-
 static void preload_compressed_pages(struct z_erofs_collector *clt,
 				     struct address_space *mc,
 				     enum z_erofs_cache_alloctype type,
 				     struct list_head *pagepool)
 {
-	const struct z_erofs_pcluster *pcl = clt->pcl;
+	struct z_erofs_pcluster *pcl = clt->pcl;
 	const unsigned int clusterpages = BIT(pcl->clusterbits);
-	struct page **pages = clt->compressedpages;
-	pgoff_t index = pcl->obj.index + (pages - pcl->compressed_pages);
+	struct page **pages = pcl->compressed_pages;
+	pgoff_t index = pcl->obj.index;
 	bool standalone = true;
 
 	if (clt->mode < COLLECT_PRIMARY_FOLLOWED)
 		return;
 
-	for (; pages < pcl->compressed_pages + clusterpages; ++pages) {
+	for (; pages < pcl->compressed_pages + clusterpages; ++pages, ++index) {
 		struct page *page;
 		compressed_page_t t;
 
@@ -179,9 +239,7 @@ static void preload_compressed_pages(struct z_erofs_collector *clt,
 			t = tag_compressed_page_justfound(page);
 		} else if (type == DELAYEDALLOC) {
 			t = tagptr_init(compressed_page_t, PAGE_UNALLOCATED);
-		} else {	/* DONTALLOC */
-			if (standalone)
-				clt->compressedpages = pages;
+		} else {	/* DONTALLOC, leave the slot for inplace I/O */
 			standalone = false;
 			continue;
 		}
@@ -267,10 +325,14 @@ static inline bool z_erofs_try_inplace_io(struct z_erofs_collector *clt,
 					  struct page *page)
 {
 	struct z_erofs_pcluster *const pcl = clt->pcl;
-	const unsigned int clusterpages = BIT(pcl->clusterbits);
 
-	while (clt->compressedpages < pcl->compressed_pages + clusterpages) {
-		if (!cmpxchg(clt->compressedpages++, NULL, page))
+	/*
+	 * file pages are attached from the end of the extent, so fill the
+	 * compressed slots backwards to line them up with the tail of the
+	 * decompressed output for in-place decompression.
+	 */
+	while (clt->compressedpages > pcl->compressed_pages) {
+		if (!cmpxchg(--clt->compressedpages, NULL, page))
 			return true;
 	}
 	return false;
@@ -399,12 +461,12 @@ static int z_erofs_register_collection(struct z_erofs_collector *clt,
 			Z_EROFS_PCLUSTER_FULL_LENGTH : 0);
 
 	if (map->m_flags & EROFS_MAP_ZIPPED)
-		pcl->algorithmformat = Z_EROFS_COMPRESSION_LZ4;
+		pcl->algorithmformat = map->m_algorithmformat;
 	else
 		pcl->algorithmformat = Z_EROFS_COMPRESSION_SHIFTED;
 
-	pcl->clusterbits = EROFS_I(inode)->z_physical_clusterbits[0];
-	pcl->clusterbits -= PAGE_SHIFT;
+	pcl->clusterbits = ilog2(map->m_plen) - PAGE_SHIFT;
+	DBG_BUGON(BIT(pcl->clusterbits) > Z_EROFS_CLUSTER_MAX_PAGES);
 
 	/* new pclusters should be claimed as type 1, primary and followed */
 	pcl->next = clt->owned_head;
@@ -489,9 +551,10 @@ static int z_erofs_collector_begin(struct z_erofs_collector *clt,
 	z_erofs_pagevec_ctor_init(&clt->vector, Z_EROFS_NR_INLINE_PAGEVECS,
 				  clt->cl->pagevec, clt->cl->vcnt);
 
+	/* in-place I/O takes compressed slots from the last one backwards */
 	clt->compressedpages = clt->pcl->compressed_pages;
-	if (clt->mode <= COLLECT_PRIMARY) /* cannot do in-place I/O */
-		clt->compressedpages += Z_EROFS_CLUSTER_MAX_PAGES;
+	if (clt->mode > COLLECT_PRIMARY)
+		clt->compressedpages += BIT(clt->pcl->clusterbits);
 	return 0;
 }
 
@@ -749,6 +812,7 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	unsigned int i, outputsize, llen, nr_pages;
 	struct page *pages_onstack[Z_EROFS_VMAP_ONSTACK_PAGES];
 	struct page **pages, **compressed_pages, *page;
+	struct z_erofs_pagemap *pagemap = NULL;
 
 	enum z_erofs_page_type page_type;
 	bool overlapped, partial;
@@ -764,22 +828,27 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 
 	if (nr_pages <= Z_EROFS_VMAP_ONSTACK_PAGES) {
 		pages = pages_onstack;
-	} else if (nr_pages <= Z_EROFS_VMAP_GLOBAL_PAGES &&
-		   mutex_trylock(&z_pagemap_global_lock)) {
-		pages = z_pagemap_global;
 	} else {
-		gfp_t gfp_flags = GFP_KERNEL;
+		if (nr_pages <= Z_EROFS_VMAP_PCPU_PAGES)
+			pagemap = z_erofs_trylock_pagemap();
+
+		if (pagemap) {
+			pages = pagemap->pages;
+		} else {
+			gfp_t gfp_flags = GFP_KERNEL;
 
-		if (nr_pages > Z_EROFS_VMAP_GLOBAL_PAGES)
-			gfp_flags |= __GFP_NOFAIL;
+			if (nr_pages > Z_EROFS_VMAP_PCPU_PAGES)
+				gfp_flags |= __GFP_NOFAIL;
 
-		pages = kvmalloc_array(nr_pages, sizeof(struct page *),
-				       gfp_flags);
+			pages = kvmalloc_array(nr_pages, sizeof(struct page *),
+					       gfp_flags);
+		}
 
-		/* fallback to global pagemap for the lowmem scenario */
+		/* fallback to the local pagemap for the lowmem scenario */
 		if (!pages) {
-			mutex_lock(&z_pagemap_global_lock);
-			pages = z_pagemap_global;
+			pagemap = z_pagemap_pcpu[raw_smp_processor_id()];
+			mutex_lock(&pagemap->lock);
+			pages = pagemap->pages;
 		}
 	}
 
@@ -884,7 +953,7 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 					.in = compressed_pages,
 					.out = pages,
 					.pageofs_out = cl->pageofs,
-					.inputsize = PAGE_SIZE,
+					.inputsize = clusterpages * PAGE_SIZE,
 					.outputsize = outputsize,
 					.alg = pcl->algorithmformat,
 					.inplace_io = overlapped,
@@ -922,8 +991,8 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 		z_erofs_onlinepage_endio(page);
 	}
 
-	if (pages == z_pagemap_global)
-		mutex_unlock(&z_pagemap_global_lock);
+	if (pagemap)
+		mutex_unlock(&pagemap->lock);
 	else if (pages != pages_onstack)
 		kvfree(pages);
 
@@ -961,6 +1030,68 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 	}
 }
 
+static void z_erofs_decompressqueue_work(struct work_struct *work);
+
+/*
+ * All I/O of an asynchronous queue has completed, so each pcluster is only
+ * reachable from this chain. Cut it into per-cpu sized pieces and queue
+ * all but the first one, so that a large readahead is decompressed on all
+ * cores instead of one pcluster after another by a single worker.
+ */
+static void z_erofs_split_queue(struct z_erofs_decompressqueue *q)
+{
+	const unsigned int nr_cpus = num_online_cpus();
+	z_erofs_next_pcluster_t owned = q->head;
+	struct z_erofs_decompressqueue *subq;
+	struct z_erofs_pcluster *pcl;
+	unsigned int nr, chunk, i;
+
+	if (nr_cpus <= 1)
+		return;
+
+	nr = 0;
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		++nr;
+	}
+
+	chunk = max_t(unsigned int, DIV_ROUND_UP(nr, nr_cpus),
+		      Z_EROFS_ASYNC_MIN_PCLUSTERS);
+	if (nr <= chunk)
+		return;
+
+	owned = q->head;
+	i = 0;
+	subq = NULL;
+	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+		struct z_erofs_decompressqueue *nextq;
+
+		pcl = container_of(owned, struct z_erofs_pcluster, next);
+		owned = READ_ONCE(pcl->next);
+		if (++i < chunk || owned == Z_EROFS_PCLUSTER_TAIL_CLOSED)
+			continue;
+
+		/* the current piece just takes the rest if out of memory */
+		nextq = kvzalloc(sizeof(*nextq), GFP_NOIO | __GFP_NOWARN);
+		if (!nextq)
+			break;
+		INIT_WORK(&nextq->u.work, z_erofs_decompressqueue_work);
+		nextq->sb = q->sb;
+		nextq->head = owned;
+
+		/* close the current piece before it can be walked by others */
+		WRITE_ONCE(pcl->next, Z_EROFS_PCLUSTER_TAIL_CLOSED);
+		if (subq)
+			queue_work(z_erofs_workqueue, &subq->u.work);
+		subq = nextq;
+		i = 0;
+	}
+
+	if (subq)
+		queue_work(z_erofs_workqueue, &subq->u.work);
+}
+
 static void z_erofs_decompressqueue_work(struct work_struct *work)
 {
 	struct z_erofs_decompressqueue *bgq =
@@ -968,6 +1099,8 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
+	if (bgq->split)
+		z_erofs_split_queue(bgq);
 	z_erofs_decompress_queue(bgq, &pagepool);
 
 	put_pages_list(&pagepool);
@@ -1099,6 +1232,7 @@ jobqueue_init(struct super_block *sb,
 			goto fg_out;
 		}
 		INIT_WORK(&q->u.work, z_erofs_decompressqueue_work);
+		q->split = true;
 	} else {
 fg_out:
 		q = fgq;
@@ -88,6 +88,8 @@ struct z_erofs_decompressqueue {
 	struct super_block *sb;
 	atomic_t pending_bios;
 	z_erofs_next_pcluster_t head;
+	/* spread over several workers, pieces split off aren't split again */
+	bool split;
 
 	union {
 		wait_queue_head_t wait;
@@ -183,7 +185,10 @@ static inline void z_erofs_onlinepage_endio(struct page *page)
 
 #define Z_EROFS_VMAP_ONSTACK_PAGES	\
 	min_t(unsigned int, THREAD_SIZE / 8 / sizeof(struct page *), 96U)
-#define Z_EROFS_VMAP_GLOBAL_PAGES	2048
+#define Z_EROFS_VMAP_PCPU_PAGES		2048
+
+/* minimum number of pclusters per worker when splitting a readahead queue */
+#define Z_EROFS_ASYNC_MIN_PCLUSTERS	4
 
 #endif
 
@@ -63,9 +63,20 @@ static int z_erofs_fill_inode_lazy(struct inode *inode)
 	vi->z_algorithmtype[0] = h->h_algorithmtype & 15;
 	vi->z_algorithmtype[1] = h->h_algorithmtype >> 4;
 
-	if (vi->z_algorithmtype[0] >= Z_EROFS_COMPRESSION_MAX) {
-		erofs_err(sb, "unknown compression format %u for nid %llu, please upgrade kernel",
-			  vi->z_algorithmtype[0], vi->nid);
+	if (vi->z_algorithmtype[0] >= Z_EROFS_COMPRESSION_MAX ||
+	    vi->z_algorithmtype[1] >= Z_EROFS_COMPRESSION_MAX) {
+		erofs_err(sb, "unknown compression format %u/%u for nid %llu, please upgrade kernel",
+			  vi->z_algorithmtype[0], vi->z_algorithmtype[1],
+			  vi->nid);
+		err = -EOPNOTSUPP;
+		goto unmap_done;
+	}
+
+	if (!IS_ENABLED(CONFIG_EROFS_FS_ZIP_LZMA) &&
+	    (vi->z_algorithmtype[0] == Z_EROFS_COMPRESSION_LZMA ||
+	     vi->z_algorithmtype[1] == Z_EROFS_COMPRESSION_LZMA)) {
+		erofs_err(sb, "LZMA compressed nid %llu needs CONFIG_EROFS_FS_ZIP_LZMA",
+			  vi->nid);
 		err = -EOPNOTSUPP;
 		goto unmap_done;
 	}
@@ -73,16 +84,27 @@ static int z_erofs_fill_inode_lazy(struct inode *inode)
 	vi->z_logical_clusterbits = LOG_BLOCK_SIZE + (h->h_clusterbits & 7);
 	vi->z_physical_clusterbits[0] = vi->z_logical_clusterbits +
 					((h->h_clusterbits >> 3) & 3);
+	vi->z_physical_clusterbits[1] = vi->z_logical_clusterbits +
+					((h->h_clusterbits >> 5) & 7);
 
-	if (vi->z_physical_clusterbits[0] != LOG_BLOCK_SIZE) {
-		erofs_err(sb, "unsupported physical clusterbits %u for nid %llu, please upgrade kernel",
-			  vi->z_physical_clusterbits[0], vi->nid);
+	if (vi->z_logical_clusterbits != LOG_BLOCK_SIZE) {
+		erofs_err(sb, "unsupported logical clusterbits %u for nid %llu, please upgrade kernel",
+			  vi->z_logical_clusterbits, vi->nid);
+		err = -EOPNOTSUPP;
+		goto unmap_done;
+	}
+
+	if (BIT(vi->z_physical_clusterbits[0] - LOG_BLOCK_SIZE) >
+	    Z_EROFS_CLUSTER_MAX_PAGES ||
+	    BIT(vi->z_physical_clusterbits[1] - LOG_BLOCK_SIZE) >
+	    Z_EROFS_CLUSTER_MAX_PAGES) {
+		erofs_err(sb, "physical clusterbits %u/%u for nid %llu exceed CONFIG_EROFS_FS_CLUSTER_PAGE_LIMIT",
+			  vi->z_physical_clusterbits[0],
+			  vi->z_physical_clusterbits[1], vi->nid);
 		err = -EOPNOTSUPP;
 		goto unmap_done;
 	}
 
-	vi->z_physical_clusterbits[1] = vi->z_logical_clusterbits +
-					((h->h_clusterbits >> 5) & 7);
 	set_bit(EROFS_I_Z_INITED_BIT, &vi->flags);
 unmap_done:
 	kunmap_atomic(kaddr);
@@ -100,7 +122,7 @@ struct z_erofs_maprecorder {
 
 	unsigned long lcn;
 	/* compression extent information gathered */
-	u8  type;
+	u8  type, headtype;
 	u16 clusterofs;
 	u16 delta[2];
 	erofs_blk_t pblk;
@@ -170,6 +192,7 @@ static int legacy_load_cluster_from_disk(struct z_erofs_maprecorder *m,
 		break;
 	case Z_EROFS_VLE_CLUSTER_TYPE_PLAIN:
 	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD:
+	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD2:
 		m->clusterofs = le16_to_cpu(di->di_clusterofs);
 		m->pblk = le32_to_cpu(di->di_u.blkaddr);
 		break;
@@ -199,6 +222,11 @@ static int unpack_compacted_index(struct z_erofs_maprecorder *m,
 	struct erofs_inode *const vi = EROFS_I(m->inode);
 	const unsigned int lclusterbits = vi->z_logical_clusterbits;
 	const unsigned int lomask = (1 << lclusterbits) - 1;
+	/* compressed heads take a whole physical cluster, plain ones a block */
+	const unsigned int pblks[2] = {
+		1 << (vi->z_physical_clusterbits[0] - LOG_BLOCK_SIZE),
+		1 << (vi->z_physical_clusterbits[1] - LOG_BLOCK_SIZE),
+	};
 	unsigned int vcnt, base, lo, encodebits, nblk;
 	int i;
 	u8 *in, type;
@@ -245,10 +273,20 @@ static int unpack_compacted_index(struct z_erofs_maprecorder *m,
 		--i;
 		lo = decode_compactedbits(lclusterbits, lomask,
 					  in, encodebits * i, &type);
-		if (type == Z_EROFS_VLE_CLUSTER_TYPE_NONHEAD)
+		if (type == Z_EROFS_VLE_CLUSTER_TYPE_NONHEAD) {
 			i -= lo;
+			if (i < 0)
+				break;
+			if (pblks[0] > 1 || pblks[1] > 1)
+				decode_compactedbits(lclusterbits, lomask,
+						     in, encodebits * i, &type);
+		}
 
-		if (i >= 0)
+		if (type == Z_EROFS_VLE_CLUSTER_TYPE_HEAD)
+			nblk += pblks[0];
+		else if (type == Z_EROFS_VLE_CLUSTER_TYPE_HEAD2)
+			nblk += pblks[1];
+		else
 			++nblk;
 	}
 	in += (vcnt << amortizedshift) - sizeof(__le32);
@@ -361,6 +399,8 @@ static int z_erofs_extent_lookback(struct z_erofs_maprecorder *m,
 		map->m_flags &= ~EROFS_MAP_ZIPPED;
 		/* fallthrough */
 	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD:
+	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD2:
+		m->headtype = m->type;
 		map->m_la = (lcn << lclusterbits) | m->clusterofs;
 		break;
 	default:
@@ -418,7 +458,9 @@ int z_erofs_map_blocks_iter(struct inode *inode,
 			map->m_flags &= ~EROFS_MAP_ZIPPED;
 		/* fallthrough */
 	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD:
+	case Z_EROFS_VLE_CLUSTER_TYPE_HEAD2:
 		if (endoff >= m.clusterofs) {
+			m.headtype = m.type;
 			map->m_la = (m.lcn << lclusterbits) | m.clusterofs;
 			break;
 		}
@@ -449,7 +491,17 @@ int z_erofs_map_blocks_iter(struct inode *inode,
 	}
 
 	map->m_llen = end - map->m_la;
-	map->m_plen = 1 << lclusterbits;
+	/* uncompressed extents always sit in a single logical cluster */
+	if (map->m_flags & EROFS_MAP_ZIPPED) {
+		/* HEAD2 extents use the second algorithm of this inode */
+		const unsigned int i =
+			m.headtype == Z_EROFS_VLE_CLUSTER_TYPE_HEAD2;
+
+		map->m_plen = 1 << vi->z_physical_clusterbits[i];
+		map->m_algorithmformat = vi->z_algorithmtype[i];
+	} else {
+		map->m_plen = 1 << lclusterbits;
+	}
 	map->m_pa = blknr_to_addr(m.pblk);
 	map->m_flags |= EROFS_MAP_MAPPED;
 
@@ -10,22 +10,6 @@
 #include "exfat_raw.h"
 #include "exfat_fs.h"
 
-static const unsigned char free_bit[] = {
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*  0 ~  19*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3,/* 20 ~  39*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/* 40 ~  59*/
-	0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/* 60 ~  79*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5, 0, 1, 0, 2,/* 80 ~  99*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3,/*100 ~ 119*/
-	0, 1, 0, 2, 0, 1, 0, 7, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*120 ~ 139*/
-	0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 5,/*140 ~ 159*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2,/*160 ~ 179*/
-	0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 6, 0, 1, 0, 2, 0, 1, 0, 3,/*180 ~ 199*/
-	0, 1, 0, 2, 0, 1, 0, 4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2,/*200 ~ 219*/
-	0, 1, 0, 5, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0, 4,/*220 ~ 239*/
-	0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0                /*240 ~ 254*/
-};
-
 static const unsigned char used_bit[] = {
 	0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 1, 2, 2, 3,/*  0 ~  19*/
 	2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5, 1, 2, 2, 3, 2, 3, 3, 4,/* 20 ~  39*/
@@ -75,6 +59,15 @@ static int exfat_allocate_bitmap(struct super_block *sb,
 	if (!sbi->vol_amap)
 		return -ENOMEM;
 
+	/* filled in by exfat_count_used_clusters() */
+	sbi->map_free = kvcalloc(sbi->map_sectors, sizeof(unsigned int),
+				GFP_KERNEL);
+	if (!sbi->map_free) {
+		kfree(sbi->vol_amap);
+		sbi->vol_amap = NULL;
+		return -ENOMEM;
+	}
+
 	sector = exfat_cluster_to_sector(sbi, sbi->map_clu);
 	for (i = 0; i < sbi->map_sectors; i++) {
 		sbi->vol_amap[i] = sb_bread(sb, sector + i);
@@ -85,6 +78,8 @@ static int exfat_allocate_bitmap(struct super_block *sb,
 			while (j < i)
 				brelse(sbi->vol_amap[j++]);
 
+			kvfree(sbi->map_free);
+			sbi->map_free = NULL;
 			kfree(sbi->vol_amap);
 			sbi->vol_amap = NULL;
 			return -EIO;
@@ -139,9 +134,51 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi)
 	for (i = 0; i < sbi->map_sectors; i++)
 		__brelse(sbi->vol_amap[i]);
 
+	kvfree(sbi->map_free);
 	kfree(sbi->vol_amap);
 }
 
+/* number of bitmap entries which map to clusters in bitmap sector "i" */
+static unsigned int exfat_bitmap_sector_ents(struct super_block *sb,
+		unsigned int i)
+{
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(EXFAT_SB(sb));
+
+	return min_t(unsigned int, total_ents - i * BITS_PER_SECTOR(sb),
+			BITS_PER_SECTOR(sb));
+}
+
+/*
+ * Return the first bitmap entry in [ent, end) which is set ("used" is true)
+ * or clear, or "end" if there is none.  The per-sector free counts let this
+ * skip sectors which are entirely used or entirely free.
+ */
+static unsigned int exfat_bitmap_next(struct super_block *sb,
+		unsigned int ent, unsigned int end, bool used)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int i, b, ents;
+
+	while (ent < end) {
+		i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent);
+		b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent);
+		ents = exfat_bitmap_sector_ents(sb, i);
+
+		if (used ? sbi->map_free[i] < ents : sbi->map_free[i] > 0) {
+			const void *map = sbi->vol_amap[i]->b_data;
+
+			b = used ? find_next_bit_le(map, ents, b) :
+				find_next_zero_bit_le(map, ents, b);
+			if (b < ents)
+				return min_t(unsigned int,
+					i * BITS_PER_SECTOR(sb) + b, end);
+		}
+		ent = (i + 1) * BITS_PER_SECTOR(sb);
+	}
+
+	return end;
+}
+
 /*
  * If the value of "clu" is 0, it means cluster 2 which is the first cluster of
  * the cluster heap.
@@ -158,7 +195,8 @@ int exfat_set_bitmap(struct inode *inode, unsigned int clu)
 	i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
 	b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
 
-	set_bit_le(b, sbi->vol_amap[i]->b_data);
+	if (!test_and_set_bit_le(b, sbi->vol_amap[i]->b_data))
+		sbi->map_free[i]--;
 	exfat_update_bh(sb, sbi->vol_amap[i], IS_DIRSYNC(inode));
 	return 0;
 }
@@ -180,7 +218,8 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu)
 	i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
 	b = BITMAP_OFFSET_BIT_IN_SECTOR(sb, ent_idx);
 
-	clear_bit_le(b, sbi->vol_amap[i]->b_data);
+	if (test_and_clear_bit_le(b, sbi->vol_amap[i]->b_data))
+		sbi->map_free[i]++;
 	exfat_update_bh(sb, sbi->vol_amap[i], IS_DIRSYNC(inode));
 
 	if (opts->discard) {
@@ -205,71 +244,103 @@ void exfat_clear_bitmap(struct inode *inode, unsigned int clu)
  */
 unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu)
 {
-	unsigned int i, map_i, map_b, ent_idx;
-	unsigned int clu_base, clu_free;
-	unsigned char k, clu_mask;
+	unsigned int ent_idx, ent;
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(sbi);
 
 	WARN_ON(clu < EXFAT_FIRST_CLUSTER);
 	ent_idx = CLUSTER_TO_BITMAP_ENT(clu);
-	clu_base = BITMAP_ENT_TO_CLUSTER(ent_idx & ~(BITS_PER_BYTE_MASK));
-	clu_mask = IGNORED_BITS_REMAINED(clu, clu_base);
-
-	map_i = BITMAP_OFFSET_SECTOR_INDEX(sb, ent_idx);
-	map_b = BITMAP_OFFSET_BYTE_IN_SECTOR(sb, ent_idx);
-
-	for (i = EXFAT_FIRST_CLUSTER; i < sbi->num_clusters;
-	     i += BITS_PER_BYTE) {
-		k = *(sbi->vol_amap[map_i]->b_data + map_b);
-		if (clu_mask > 0) {
-			k |= clu_mask;
-			clu_mask = 0;
-		}
-		if (k < 0xFF) {
-			clu_free = clu_base + free_bit[k];
-			if (clu_free < sbi->num_clusters)
-				return clu_free;
-		}
-		clu_base += BITS_PER_BYTE;
+	if (ent_idx >= total_ents)
+		ent_idx = 0;
+
+	ent = exfat_bitmap_next(sb, ent_idx, total_ents, false);
+	if (ent == total_ents) {
+		/* wrap around for the entries before the hint */
+		ent = exfat_bitmap_next(sb, 0, ent_idx, false);
+		if (ent == ent_idx)
+			return EXFAT_EOF_CLUSTER;
+	}
 
-		if (++map_b >= sb->s_blocksize ||
-		    clu_base >= sbi->num_clusters) {
-			if (++map_i >= sbi->map_sectors) {
-				clu_base = EXFAT_FIRST_CLUSTER;
-				map_i = 0;
-			}
-			map_b = 0;
+	return BITMAP_ENT_TO_CLUSTER(ent);
+}
+
+/*
+ * Find the first run of at least "len" free clusters starting at or after
+ * "clu", wrapping around to the start of the cluster heap.
+ */
+unsigned int exfat_find_free_run(struct super_block *sb, unsigned int clu,
+		unsigned int len)
+{
+	unsigned int ent_idx, ent, end, limit, next, pass;
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(sbi);
+
+	if (len > total_ents - sbi->used_clusters)
+		return EXFAT_EOF_CLUSTER;
+
+	ent_idx = CLUSTER_TO_BITMAP_ENT(clu);
+	if (ent_idx >= total_ents)
+		ent_idx = 0;
+
+	ent = ent_idx;
+	end = total_ents;
+	for (pass = 0; pass < 2; pass++) {
+		while ((ent = exfat_bitmap_next(sb, ent, end, false)) < end) {
+			/* a run may extend past "end" on the second pass */
+			limit = total_ents - ent < len ? total_ents : ent + len;
+			next = exfat_bitmap_next(sb, ent, limit, true);
+			if (next - ent >= len)
+				return BITMAP_ENT_TO_CLUSTER(ent);
+			ent = next;
 		}
+		ent = 0;
+		end = ent_idx;
 	}
 
 	return EXFAT_EOF_CLUSTER;
 }
 
+/*
+ * Count the free extents of the cluster heap by size, hist[n] being the
+ * number of runs of 2^n up to 2^(n+1) - 1 free clusters.
+ */
+void exfat_free_extent_histogram(struct super_block *sb, unsigned int *hist)
+{
+	unsigned int ent = 0, end;
+	unsigned int total_ents = EXFAT_DATA_CLUSTER_COUNT(EXFAT_SB(sb));
+
+	memset(hist, 0, EXFAT_FREE_EXTENT_ORDERS * sizeof(*hist));
+	while ((ent = exfat_bitmap_next(sb, ent, total_ents, false)) <
+	       total_ents) {
+		end = exfat_bitmap_next(sb, ent, total_ents, true);
+		hist[min_t(unsigned int, ilog2(end - ent),
+			   EXFAT_FREE_EXTENT_ORDERS - 1)]++;
+		ent = end;
+	}
+}
+
 int exfat_count_used_clusters(struct super_block *sb, unsigned int *ret_count)
 {
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 	unsigned int count = 0;
-	unsigned int i, map_i = 0, map_b = 0;
-	unsigned int total_clus = EXFAT_DATA_CLUSTER_COUNT(sbi);
-	unsigned int last_mask = total_clus & BITS_PER_BYTE_MASK;
-	unsigned char clu_bits;
+	unsigned int i, b, ents, used;
+	unsigned char *map;
 	const unsigned char last_bit_mask[] = {0, 0b00000001, 0b00000011,
 		0b00000111, 0b00001111, 0b00011111, 0b00111111, 0b01111111};
 
-	total_clus &= ~last_mask;
-	for (i = 0; i < total_clus; i += BITS_PER_BYTE) {
-		clu_bits = *(sbi->vol_amap[map_i]->b_data + map_b);
-		count += used_bit[clu_bits];
-		if (++map_b >= (unsigned int)sb->s_blocksize) {
-			map_i++;
-			map_b = 0;
-		}
-	}
-
-	if (last_mask) {
-		clu_bits = *(sbi->vol_amap[map_i]->b_data + map_b);
-		clu_bits &= last_bit_mask[last_mask];
-		count += used_bit[clu_bits];
+	for (i = 0; i < sbi->map_sectors; i++) {
+		map = (unsigned char *)sbi->vol_amap[i]->b_data;
+		ents = exfat_bitmap_sector_ents(sb, i);
+
+		used = 0;
+		for (b = 0; b < ents / BITS_PER_BYTE; b++)
+			used += used_bit[map[b]];
+		if (ents & BITS_PER_BYTE_MASK)
+			used += used_bit[map[b] &
+				last_bit_mask[ents & BITS_PER_BYTE_MASK]];
+
+		sbi->map_free[i] = ents - used;
+		count += used;
 	}
 
 	*ret_count = count;
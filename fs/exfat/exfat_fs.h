@@ -9,6 +9,8 @@
 #include <linux/fs.h>
 #include <linux/ratelimit.h>
 #include <linux/nls.h>
+#include <linux/kobject.h>
+#include <linux/completion.h>
 
 #define EXFAT_SUPER_MAGIC       0x2011BAB0UL
 #define EXFAT_ROOT_INO		1
@@ -17,6 +19,17 @@
 
 #define EXFAT_CLUSTERS_UNTRACKED (~0u)
 
+/* size classes of the free extent histogram, 2^n clusters each */
+#define EXFAT_FREE_EXTENT_ORDERS	32
+
+/*
+ * Length of the free run a file moves on to when it can't be extended in
+ * place, so files written a cluster at a time stay mostly contiguous.
+ */
+#define EXFAT_ALLOC_RUN_BYTES	(1024 * 1024)
+#define EXFAT_ALLOC_RUN_CLUSTERS(sbi) \
+	max_t(unsigned int, EXFAT_ALLOC_RUN_BYTES >> (sbi)->cluster_size_bits, 1)
+
 /*
  * exfat error flags
  */
@@ -236,6 +249,7 @@ struct exfat_sb_info {
 	unsigned int map_clu; /* allocation bitmap start cluster */
 	unsigned int map_sectors; /* num of allocation bitmap sectors */
 	struct buffer_head **vol_amap; /* allocation bitmap */
+	unsigned int *map_free; /* free clusters per allocation bitmap sector */
 
 	unsigned short *vol_utbl; /* upcase table */
 
@@ -251,6 +265,10 @@ struct exfat_sb_info {
 	spinlock_t inode_hash_lock;
 	struct hlist_head inode_hashtable[EXFAT_HASH_SIZE];
 
+	struct super_block *sb;
+	struct kobject s_kobj; /* /sys/fs/exfat/<dev> */
+	struct completion s_kobj_unregister;
+
 	struct rcu_head rcu;
 };
 
@@ -415,6 +433,9 @@ void exfat_free_bitmap(struct exfat_sb_info *sbi);
 int exfat_set_bitmap(struct inode *inode, unsigned int clu);
 void exfat_clear_bitmap(struct inode *inode, unsigned int clu);
 unsigned int exfat_find_free_bitmap(struct super_block *sb, unsigned int clu);
+unsigned int exfat_find_free_run(struct super_block *sb, unsigned int clu,
+		unsigned int len);
+void exfat_free_extent_histogram(struct super_block *sb, unsigned int *hist);
 int exfat_count_used_clusters(struct super_block *sb, unsigned int *ret_count);
 
 /* file.c */
@@ -517,4 +538,10 @@ void exfat_chain_set(struct exfat_chain *ec, unsigned int dir,
 		unsigned int size, unsigned char flags);
 void exfat_chain_dup(struct exfat_chain *dup, struct exfat_chain *ec);
 
+/* exfat/sysfs.c */
+int exfat_register_sysfs(struct super_block *sb);
+void exfat_unregister_sysfs(struct super_block *sb);
+int __init exfat_sysfs_init(void);
+void exfat_sysfs_exit(void);
+
 #endif /* !_EXFAT_FS_H */
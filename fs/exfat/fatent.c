@@ -316,8 +316,9 @@ int exfat_alloc_cluster(struct inode *inode, unsigned int num_alloc,
 		struct exfat_chain *p_chain)
 {
 	int ret = -ENOSPC;
-	unsigned int num_clusters = 0, total_cnt;
+	unsigned int num_clusters = 0, total_cnt, run_len;
 	unsigned int hint_clu, new_clu, last_clu = EXFAT_EOF_CLUSTER;
+	bool extend;
 	struct super_block *sb = inode->i_sb;
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 
@@ -334,6 +335,9 @@ int exfat_alloc_cluster(struct inode *inode, unsigned int num_alloc,
 		return -ENOSPC;
 
 	hint_clu = p_chain->dir;
+	extend = hint_clu != EXFAT_EOF_CLUSTER;
+	run_len = extend ? max(num_alloc, EXFAT_ALLOC_RUN_CLUSTERS(sbi)) :
+		num_alloc;
 	/* find new cluster */
 	if (hint_clu == EXFAT_EOF_CLUSTER) {
 		if (sbi->clu_srch_ptr < EXFAT_FIRST_CLUSTER) {
@@ -361,6 +365,18 @@ int exfat_alloc_cluster(struct inode *inode, unsigned int num_alloc,
 		}
 	}
 
+	/*
+	 * Rather than filling the first hole after the hint, start a new
+	 * chain in a free run holding all of it, and move a chain which
+	 * can't be extended in place over to a run long enough for a while.
+	 */
+	if (run_len > 1 &&
+	    (!extend || exfat_find_free_bitmap(sb, hint_clu) != hint_clu)) {
+		new_clu = exfat_find_free_run(sb, hint_clu, run_len);
+		if (new_clu != EXFAT_EOF_CLUSTER)
+			hint_clu = new_clu;
+	}
+
 	set_bit(EXFAT_SB_DIRTY, &sbi->s_state);
 
 	p_chain->dir = EXFAT_EOF_CLUSTER;
@@ -44,6 +44,8 @@ static void exfat_put_super(struct super_block *sb)
 {
 	struct exfat_sb_info *sbi = EXFAT_SB(sb);
 
+	exfat_unregister_sysfs(sb);
+
 	mutex_lock(&sbi->s_lock);
 	if (test_and_clear_bit(EXFAT_SB_DIRTY, &sbi->s_state))
 		sync_blockdev(sb->s_bdev);
@@ -579,11 +581,17 @@ static int exfat_fill_super(struct super_block *sb, struct fs_context *fc)
 	else
 		sb->s_d_op = &exfat_dentry_ops;
 
+	err = exfat_register_sysfs(sb);
+	if (err) {
+		exfat_msg(sb, KERN_ERR, "failed to register sysfs entries.");
+		goto free_table;
+	}
+
 	root_inode = new_inode(sb);
 	if (!root_inode) {
 		exfat_msg(sb, KERN_ERR, "failed to allocate root inode.");
 		err = -ENOMEM;
-		goto free_table;
+		goto unregister_sysfs;
 	}
 
 	root_inode->i_ino = EXFAT_ROOT_INO;
@@ -610,6 +618,9 @@ static int exfat_fill_super(struct super_block *sb, struct fs_context *fc)
 	iput(root_inode);
 	sb->s_root = NULL;
 
+unregister_sysfs:
+	exfat_unregister_sysfs(sb);
+
 free_table:
 	exfat_free_upcase_table(sbi);
 	exfat_free_bitmap(sbi);
@@ -698,12 +709,18 @@ static int __init init_exfat_fs(void)
 		goto shutdown_cache;
 	}
 
-	err = register_filesystem(&exfat_fs_type);
+	err = exfat_sysfs_init();
 	if (err)
 		goto destroy_cache;
 
+	err = register_filesystem(&exfat_fs_type);
+	if (err)
+		goto exit_sysfs;
+
 	return 0;
 
+exit_sysfs:
+	exfat_sysfs_exit();
 destroy_cache:
 	kmem_cache_destroy(exfat_inode_cachep);
 shutdown_cache:
@@ -720,6 +737,7 @@ static void __exit exit_exfat_fs(void)
 	rcu_barrier();
 	kmem_cache_destroy(exfat_inode_cachep);
 	unregister_filesystem(&exfat_fs_type);
+	exfat_sysfs_exit();
 	exfat_cache_shutdown();
 }
 
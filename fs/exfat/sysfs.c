@@ -0,0 +1,123 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * sysfs interface of exfat, one directory per mounted volume under
+ * /sys/fs/exfat/.
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+
+#include "exfat_raw.h"
+#include "exfat_fs.h"
+
+static struct kset *exfat_kset;
+
+struct exfat_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct exfat_sb_info *sbi, char *buf);
+};
+
+#define EXFAT_ATTR_RO(_name)					\
+static struct exfat_attr exfat_attr_##_name = {			\
+	.attr = { .name = __stringify(_name), .mode = 0444 },	\
+	.show = _name##_show,					\
+}
+
+/*
+ * Free extent counts by size: the n-th number counts the free runs of
+ * 2^n up to 2^(n+1) - 1 clusters, up to the largest run on the volume.
+ */
+static ssize_t free_extents_show(struct exfat_sb_info *sbi, char *buf)
+{
+	unsigned int hist[EXFAT_FREE_EXTENT_ORDERS];
+	int i, last = 0;
+	ssize_t len = 0;
+
+	mutex_lock(&sbi->s_lock);
+	exfat_free_extent_histogram(sbi->sb, hist);
+	mutex_unlock(&sbi->s_lock);
+
+	for (i = 0; i < EXFAT_FREE_EXTENT_ORDERS; i++)
+		if (hist[i])
+			last = i;
+
+	for (i = 0; i <= last; i++)
+		len += scnprintf(buf + len, PAGE_SIZE - len, "%u%c", hist[i],
+				 i == last ? '\n' : ' ');
+	return len;
+}
+EXFAT_ATTR_RO(free_extents);
+
+static struct attribute *exfat_attrs[] = {
+	&exfat_attr_free_extents.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(exfat);
+
+static ssize_t exfat_attr_show(struct kobject *kobj, struct attribute *attr,
+		char *buf)
+{
+	struct exfat_sb_info *sbi = container_of(kobj, struct exfat_sb_info,
+						 s_kobj);
+	struct exfat_attr *a = container_of(attr, struct exfat_attr, attr);
+
+	return a->show(sbi, buf);
+}
+
+static const struct sysfs_ops exfat_attr_ops = {
+	.show	= exfat_attr_show,
+};
+
+static void exfat_sb_release(struct kobject *kobj)
+{
+	struct exfat_sb_info *sbi = container_of(kobj, struct exfat_sb_info,
+						 s_kobj);
+
+	complete(&sbi->s_kobj_unregister);
+}
+
+static struct kobj_type exfat_sb_ktype = {
+	.default_groups	= exfat_groups,
+	.sysfs_ops	= &exfat_attr_ops,
+	.release	= exfat_sb_release,
+};
+
+int exfat_register_sysfs(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+	int err;
+
+	sbi->sb = sb;
+	sbi->s_kobj.kset = exfat_kset;
+	init_completion(&sbi->s_kobj_unregister);
+	err = kobject_init_and_add(&sbi->s_kobj, &exfat_sb_ktype, NULL, "%s",
+				   sb->s_id);
+	if (err) {
+		kobject_put(&sbi->s_kobj);
+		wait_for_completion(&sbi->s_kobj_unregister);
+	}
+	return err;
+}
+
+void exfat_unregister_sysfs(struct super_block *sb)
+{
+	struct exfat_sb_info *sbi = EXFAT_SB(sb);
+
+	kobject_del(&sbi->s_kobj);
+	kobject_put(&sbi->s_kobj);
+	wait_for_completion(&sbi->s_kobj_unregister);
+}
+
+int __init exfat_sysfs_init(void)
+{
+	exfat_kset = kset_create_and_add("exfat", NULL, fs_kobj);
+	if (!exfat_kset)
+		return -ENOMEM;
+	return 0;
+}
+
+void exfat_sysfs_exit(void)
+{
+	kset_unregister(exfat_kset);
+}
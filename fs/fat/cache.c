@@ -10,13 +10,21 @@
  */
 
 #include <linux/slab.h>
+#include <linux/rbtree.h>
 #include "fat.h"
 
 /* this must be > 0. */
 #define FAT_MAX_CACHE	8
+/*
+ * Large files get one more cache per 2^FAT_CACHE_SHIFT clusters, so that
+ * seeking in a fragmented file does not have to walk the whole chain.
+ */
+#define FAT_CACHE_SHIFT		8
+#define FAT_MAX_CACHE_LIMIT	1024
 
 struct fat_cache {
 	struct list_head cache_list;
+	struct rb_node rb_node;
 	int nr_contig;	/* number of contiguous clusters */
 	int fcluster;	/* cluster number in the file. */
 	int dcluster;	/* cluster number on disk. */
@@ -31,7 +39,10 @@ struct fat_cache_id {
 
 static inline int fat_max_cache(struct inode *inode)
 {
-	return FAT_MAX_CACHE;
+	struct msdos_sb_info *sbi = MSDOS_SB(inode->i_sb);
+	loff_t nr = i_size_read(inode) >> (sbi->cluster_bits + FAT_CACHE_SHIFT);
+
+	return clamp_t(loff_t, nr, FAT_MAX_CACHE, FAT_MAX_CACHE_LIMIT);
 }
 
 static struct kmem_cache *fat_cache_cachep;
@@ -41,6 +52,7 @@ static void init_once(void *foo)
 	struct fat_cache *cache = (struct fat_cache *)foo;
 
 	INIT_LIST_HEAD(&cache->cache_list);
+	RB_CLEAR_NODE(&cache->rb_node);
 }
 
 int __init fat_cache_init(void)
@@ -67,6 +79,7 @@ static inline struct fat_cache *fat_cache_alloc(struct inode *inode)
 static inline void fat_cache_free(struct fat_cache *cache)
 {
 	BUG_ON(!list_empty(&cache->cache_list));
+	BUG_ON(!RB_EMPTY_NODE(&cache->rb_node));
 	kmem_cache_free(fat_cache_cachep, cache);
 }
 
@@ -77,29 +90,61 @@ static inline void fat_cache_update_lru(struct inode *inode,
 		list_move(&cache->cache_list, &MSDOS_I(inode)->cache_lru);
 }
 
-static int fat_cache_lookup(struct inode *inode, int fclus,
-			    struct fat_cache_id *cid,
-			    int *cached_fclus, int *cached_dclus)
+static void fat_cache_insert(struct inode *inode, struct fat_cache *cache)
 {
-	static struct fat_cache nohit = { .fcluster = 0, };
+	struct rb_node **p = &MSDOS_I(inode)->cache_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct fat_cache *tmp;
+
+	while (*p) {
+		parent = *p;
+		tmp = rb_entry(parent, struct fat_cache, rb_node);
+		if (cache->fcluster < tmp->fcluster)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&cache->rb_node, parent, p);
+	rb_insert_color(&cache->rb_node, &MSDOS_I(inode)->cache_tree);
+}
 
-	struct fat_cache *hit = &nohit, *p;
-	int offset = -1;
+static void fat_cache_erase(struct inode *inode, struct fat_cache *cache)
+{
+	rb_erase(&cache->rb_node, &MSDOS_I(inode)->cache_tree);
+	RB_CLEAR_NODE(&cache->rb_node);
+}
 
-	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
-		/* Find the cache of "fclus" or nearest cache. */
-		if (p->fcluster <= fclus && hit->fcluster < p->fcluster) {
+/* Find the cache starting at "fclus" or the nearest one before it. */
+static struct fat_cache *fat_cache_find(struct inode *inode, int fclus)
+{
+	struct rb_node *n = MSDOS_I(inode)->cache_tree.rb_node;
+	struct fat_cache *p, *hit = NULL;
+
+	while (n) {
+		p = rb_entry(n, struct fat_cache, rb_node);
+		if (p->fcluster > fclus) {
+			n = n->rb_left;
+		} else {
 			hit = p;
-			if ((hit->fcluster + hit->nr_contig) < fclus) {
-				offset = hit->nr_contig;
-			} else {
-				offset = fclus - hit->fcluster;
+			if (p->fcluster == fclus)
 				break;
-			}
+			n = n->rb_right;
 		}
 	}
-	if (hit != &nohit) {
+	return hit;
+}
+
+static int fat_cache_lookup(struct inode *inode, int fclus,
+			    struct fat_cache_id *cid,
+			    int *cached_fclus, int *cached_dclus)
+{
+	struct fat_cache *hit;
+	int offset = -1;
+
+	spin_lock(&MSDOS_I(inode)->cache_lru_lock);
+	hit = fat_cache_find(inode, fclus);
+	if (hit) {
+		offset = min(hit->nr_contig, fclus - hit->fcluster);
 		fat_cache_update_lru(inode, hit);
 
 		cid->id = MSDOS_I(inode)->cache_valid_id;
@@ -119,14 +164,13 @@ static struct fat_cache *fat_cache_merge(struct inode *inode,
 {
 	struct fat_cache *p;
 
-	list_for_each_entry(p, &MSDOS_I(inode)->cache_lru, cache_list) {
-		/* Find the same part as "new" in cluster-chain. */
-		if (p->fcluster == new->fcluster) {
-			BUG_ON(p->dcluster != new->dcluster);
-			if (new->nr_contig > p->nr_contig)
-				p->nr_contig = new->nr_contig;
-			return p;
-		}
+	/* Find the same part as "new" in cluster-chain. */
+	p = fat_cache_find(inode, new->fcluster);
+	if (p && p->fcluster == new->fcluster) {
+		BUG_ON(p->dcluster != new->dcluster);
+		if (new->nr_contig > p->nr_contig)
+			p->nr_contig = new->nr_contig;
+		return p;
 	}
 	return NULL;
 }
@@ -168,10 +212,12 @@ static void fat_cache_add(struct inode *inode, struct fat_cache_id *new)
 		} else {
 			struct list_head *p = MSDOS_I(inode)->cache_lru.prev;
 			cache = list_entry(p, struct fat_cache, cache_list);
+			fat_cache_erase(inode, cache);
 		}
 		cache->fcluster = new->fcluster;
 		cache->dcluster = new->dcluster;
 		cache->nr_contig = new->nr_contig;
+		fat_cache_insert(inode, cache);
 	}
 out_update_lru:
 	fat_cache_update_lru(inode, cache);
@@ -192,6 +238,7 @@ static void __fat_cache_inval_inode(struct inode *inode)
 		cache = list_entry(i->cache_lru.next,
 				   struct fat_cache, cache_list);
 		list_del_init(&cache->cache_list);
+		fat_cache_erase(inode, cache);
 		i->nr_caches--;
 		fat_cache_free(cache);
 	}
@@ -229,6 +276,7 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 	const int limit = sb->s_maxbytes >> sbi->cluster_bits;
 	struct fat_entry fatent;
 	struct fat_cache_id cid;
+	bool cache_runs;
 	int nr;
 
 	BUG_ON(MSDOS_I(inode)->i_start == 0);
@@ -251,6 +299,11 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		 */
 		cache_init(&cid, -1, -1);
 	}
+	/*
+	 * Files with more caches than the default also keep the runs
+	 * passed on the way, so that the next seek does not walk them.
+	 */
+	cache_runs = fat_max_cache(inode) > FAT_MAX_CACHE;
 
 	fatent_init(&fatent);
 	while (*fclus < cluster) {
@@ -278,8 +331,14 @@ int fat_get_cluster(struct inode *inode, int cluster, int *fclus, int *dclus)
 		}
 		(*fclus)++;
 		*dclus = nr;
-		if (!cache_contiguous(&cid, *dclus))
+		if (!cache_contiguous(&cid, *dclus)) {
+			if (cache_runs) {
+				/* cache_contiguous() counted the new cluster */
+				cid.nr_contig--;
+				fat_cache_add(inode, &cid);
+			}
 			cache_init(&cid, *fclus, *dclus);
+		}
 	}
 	nr = 0;
 	fat_cache_add(inode, &cid);
@@ -112,6 +112,7 @@ struct msdos_sb_info {
 struct msdos_inode_info {
 	spinlock_t cache_lru_lock;
 	struct list_head cache_lru;
+	struct rb_root cache_tree;	/* caches sorted by fcluster */
 	int nr_caches;
 	/* for avoiding the race between fat_free() and fat_get_cluster() */
 	unsigned int cache_valid_id;
@@ -2251,6 +2251,17 @@ static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
 				fput(old);
 			}
 		}
+	} else if (cmd == FUSE_DEV_IOC_PASSTHROUGH_OPEN) {
+		struct fuse_dev *fud = fuse_get_dev(file);
+		int fd;
+
+		err = -EINVAL;
+		if (!fud)
+			return err;
+
+		err = -EFAULT;
+		if (!get_user(fd, (__u32 __user *) arg))
+			err = fuse_passthrough_open(fud->fc, fd);
 	}
 	return err;
 }
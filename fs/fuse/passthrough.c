@@ -0,0 +1,230 @@
+/*
+  FUSE: Filesystem in Userspace
+
+  Passthrough of file data I/O to a backing file opened by the server.
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+#include "fuse_i.h"
+
+#include <linux/file.h>
+#include <linux/fs_stack.h>
+#include <linux/uio.h>
+
+/*
+ * Register a file the server has open for a later FOPEN_PASSTHROUGH reply.
+ * The server's credentials are recorded here so that I/O on the backing
+ * file is checked against the server rather than the caller of read/write.
+ * Returns the id to place in fuse_open_out.passthrough_fh.
+ */
+int fuse_passthrough_open(struct fuse_conn *fc, int fd)
+{
+	struct fuse_passthrough *passthrough;
+	struct file *backing;
+	int id;
+
+	if (!fc->passthrough)
+		return -EPERM;
+
+	backing = fget(fd);
+	if (!backing)
+		return -EBADF;
+
+	id = -EINVAL;
+	if (!backing->f_op->read_iter || !backing->f_op->write_iter)
+		goto out_fput;
+
+	/* no stacking over another passthrough-capable (or stacked) fs */
+	id = -ELOOP;
+	if (file_inode(backing)->i_sb->s_stack_depth >=
+	    FILESYSTEM_MAX_STACK_DEPTH)
+		goto out_fput;
+
+	id = -ENOMEM;
+	passthrough = kmalloc(sizeof(*passthrough), GFP_KERNEL);
+	if (!passthrough)
+		goto out_fput;
+
+	passthrough->filp = backing;
+	passthrough->cred = prepare_creds();
+	if (!passthrough->cred)
+		goto out_free;
+
+	idr_preload(GFP_KERNEL);
+	spin_lock(&fc->passthrough_req_lock);
+	id = idr_alloc(&fc->passthrough_req, passthrough, 1, 0, GFP_ATOMIC);
+	spin_unlock(&fc->passthrough_req_lock);
+	idr_preload_end();
+	if (id > 0)
+		return id;
+
+	put_cred(passthrough->cred);
+out_free:
+	kfree(passthrough);
+out_fput:
+	fput(backing);
+	return id;
+}
+
+/*
+ * Claim the backing file named by an open reply.  Each registered id can
+ * be used by exactly one open.
+ */
+int fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_file *ff,
+			   struct fuse_open_out *openarg)
+{
+	struct fuse_passthrough *passthrough;
+	int id = openarg->passthrough_fh;
+
+	if (!fc->passthrough || id <= 0)
+		return -EINVAL;
+
+	spin_lock(&fc->passthrough_req_lock);
+	passthrough = idr_remove(&fc->passthrough_req, id);
+	spin_unlock(&fc->passthrough_req_lock);
+	if (!passthrough)
+		return -EINVAL;
+
+	ff->passthrough = *passthrough;
+	kfree(passthrough);
+	return 0;
+}
+
+void fuse_passthrough_release(struct fuse_passthrough *passthrough)
+{
+	if (passthrough->filp) {
+		fput(passthrough->filp);
+		passthrough->filp = NULL;
+	}
+	if (passthrough->cred) {
+		put_cred(passthrough->cred);
+		passthrough->cred = NULL;
+	}
+}
+
+static int fuse_passthrough_drop(int id, void *p, void *data)
+{
+	fuse_passthrough_release(p);
+	kfree(p);
+	return 0;
+}
+
+/* Drop backing files the server registered but never used */
+void fuse_passthrough_cleanup(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->passthrough_req, fuse_passthrough_drop, NULL);
+	idr_destroy(&fc->passthrough_req);
+}
+
+static rwf_t fuse_iocb_to_rwf(struct kiocb *iocb)
+{
+	int ifl = iocb->ki_flags;
+	rwf_t flags = 0;
+
+	if (ifl & IOCB_NOWAIT)
+		flags |= RWF_NOWAIT;
+	if (ifl & IOCB_HIPRI)
+		flags |= RWF_HIPRI;
+	if (ifl & IOCB_DSYNC)
+		flags |= RWF_DSYNC;
+	if (ifl & IOCB_SYNC)
+		flags |= RWF_SYNC;
+
+	return flags;
+}
+
+/*
+ * The backing file is accessed synchronously even for async kiocbs, which
+ * keeps the fuse file and its iocb alive for the whole operation.
+ */
+ssize_t fuse_passthrough_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(to))
+		return 0;
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = vfs_iter_read(backing, to, &iocb->ki_pos,
+			    fuse_iocb_to_rwf(iocb));
+	revert_creds(old_cred);
+
+	if (ret >= 0)
+		fsstack_copy_attr_atime(file_inode(file), file_inode(backing));
+	return ret;
+}
+
+ssize_t fuse_passthrough_write_iter(struct kiocb *iocb, struct iov_iter *from)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file_inode(file);
+	struct fuse_file *ff = file->private_data;
+	struct file *backing = ff->passthrough.filp;
+	struct inode *backing_inode = file_inode(backing);
+	const struct cred *old_cred;
+	ssize_t ret;
+
+	if (!iov_iter_count(from))
+		return 0;
+
+	inode_lock(inode);
+	old_cred = override_creds(ff->passthrough.cred);
+	file_start_write(backing);
+	ret = vfs_iter_write(backing, from, &iocb->ki_pos,
+			     fuse_iocb_to_rwf(iocb));
+	file_end_write(backing);
+	revert_creds(old_cred);
+
+	if (ret > 0) {
+		/* the server never sees this write, mirror what it changed */
+		fsstack_copy_inode_size(inode, backing_inode);
+		inode->i_mtime = backing_inode->i_mtime;
+		inode->i_ctime = backing_inode->i_ctime;
+	}
+	inode_unlock(inode);
+
+	return ret;
+}
+
+/*
+ * Map the backing file itself.  Its page cache is separate from that of
+ * the fuse inode, so files that mix passthrough and regular opens are only
+ * coherent to the extent the server keeps them so.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *backing = ff->passthrough.filp;
+	const struct cred *old_cred;
+	int ret;
+
+	if (!backing->f_op->mmap)
+		return -ENODEV;
+
+	if (WARN_ON(file != vma->vm_file))
+		return -EIO;
+
+	vma->vm_file = get_file(backing);
+
+	old_cred = override_creds(ff->passthrough.cred);
+	ret = call_mmap(vma->vm_file, vma);
+	revert_creds(old_cred);
+
+	if (ret) {
+		/* Drop reference count from new vm_file value */
+		fput(backing);
+	} else {
+		/* Drop reference count from previous vm_file value */
+		fput(file);
+	}
+
+	file_accessed(file);
+
+	return ret;
+}
@@ -762,6 +762,197 @@ int jbd2_complete_transaction(journal_t *journal, tid_t tid)
 }
 EXPORT_SYMBOL(jbd2_complete_transaction);
 
+/*
+ * Fast commits:
+ *
+ * A fast commit logs compact, filesystem defined deltas into a dedicated
+ * area at the end of the journal instead of committing the whole running
+ * transaction.  The deltas only make sense on top of the last full
+ * commit, so the area is reused from its start once a full commit
+ * completes, and a full commit has to wait for an ongoing fast commit.
+ * The client filesystem is responsible for keeping handles off the
+ * journal while it gathers its deltas.
+ */
+
+/**
+ * int jbd2_fc_begin_commit() - start a fast commit
+ * @journal: Journal to act on.
+ * @tid: Transaction the fast commit is for.
+ *
+ * Waits for any ongoing fast or full commit.  Returns 0 once the caller
+ * owns the fast commit area, -EALREADY if @tid has been fully committed in
+ * the meantime, and -EINVAL if the journal contents are not backed by a
+ * full commit yet, in which case the caller must do one.
+ */
+int jbd2_fc_begin_commit(journal_t *journal, tid_t tid)
+{
+	if (unlikely(is_journal_aborted(journal)))
+		return -EIO;
+
+	write_lock(&journal->j_state_lock);
+	while (journal->j_flags &
+	       (JBD2_FAST_COMMIT_ONGOING | JBD2_FULL_COMMIT_ONGOING)) {
+		DEFINE_WAIT(wait);
+
+		prepare_to_wait(&journal->j_fc_wait, &wait,
+				TASK_UNINTERRUPTIBLE);
+		write_unlock(&journal->j_state_lock);
+		schedule();
+		finish_wait(&journal->j_fc_wait, &wait);
+		write_lock(&journal->j_state_lock);
+	}
+
+	if (tid_geq(journal->j_commit_sequence, tid)) {
+		write_unlock(&journal->j_state_lock);
+		return -EALREADY;
+	}
+
+	/*
+	 * Recovery is skipped for an empty log, so fast commits are only
+	 * allowed once a full commit has made the log non-empty.
+	 */
+	if (journal->j_flags & JBD2_FLUSHED) {
+		write_unlock(&journal->j_state_lock);
+		return -EINVAL;
+	}
+
+	journal->j_flags |= JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_begin_commit);
+
+static void jbd2_fc_finish(journal_t *journal)
+{
+	if (journal->j_fc_cleanup_callback)
+		journal->j_fc_cleanup_callback(journal, 0);
+	write_lock(&journal->j_state_lock);
+	journal->j_flags &= ~JBD2_FAST_COMMIT_ONGOING;
+	write_unlock(&journal->j_state_lock);
+	wake_up(&journal->j_fc_wait);
+}
+
+/**
+ * int jbd2_fc_end_commit() - end a fast commit
+ * @journal: Journal to act on.
+ *
+ * The fast commit blocks must have been written and waited upon with
+ * jbd2_fc_wait_bufs() by now.
+ */
+int jbd2_fc_end_commit(journal_t *journal)
+{
+	jbd2_fc_finish(journal);
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit);
+
+/**
+ * int jbd2_fc_end_commit_fallback() - abandon a fast commit for a full one
+ * @journal: Journal to act on.
+ * @tid: Transaction to commit.
+ *
+ * For operations the fast commit format can't express, or when the fast
+ * commit area is full.  Ends the fast commit and then commits @tid in
+ * full, waiting for it to complete.
+ */
+int jbd2_fc_end_commit_fallback(journal_t *journal, tid_t tid)
+{
+	jbd2_fc_release_bufs(journal);
+	jbd2_fc_finish(journal);
+	return jbd2_complete_transaction(journal, tid);
+}
+EXPORT_SYMBOL(jbd2_fc_end_commit_fallback);
+
+/**
+ * int jbd2_fc_get_buf() - get the next block of the fast commit area
+ * @journal: Journal to act on.
+ * @bh_out: Returns the block's buffer head, with a reference held.
+ *
+ * Returns -ENOSPC once the area is used up until the next full commit.
+ */
+int jbd2_fc_get_buf(journal_t *journal, struct buffer_head **bh_out)
+{
+	unsigned long long pblock;
+	unsigned long blocknr;
+	struct buffer_head *bh;
+	int fc_off, ret;
+
+	*bh_out = NULL;
+
+	if (journal->j_fc_first + journal->j_fc_off >= journal->j_fc_last)
+		return -ENOSPC;
+
+	fc_off = journal->j_fc_off;
+	blocknr = journal->j_fc_first + fc_off;
+
+	ret = jbd2_journal_bmap(journal, blocknr, &pblock);
+	if (ret)
+		return ret;
+
+	bh = __getblk(journal->j_dev, pblock, journal->j_blocksize);
+	if (!bh)
+		return -ENOMEM;
+
+	journal->j_fc_wbuf[fc_off] = bh;
+	journal->j_fc_off++;
+	*bh_out = bh;
+
+	return 0;
+}
+EXPORT_SYMBOL(jbd2_fc_get_buf);
+
+/**
+ * int jbd2_fc_wait_bufs() - wait for the last fast commit blocks
+ * @journal: Journal to act on.
+ * @num_blks: Number of blocks, counted back from the last one handed out.
+ *
+ * Waits for the writes the caller submitted and drops the buffer
+ * references taken by jbd2_fc_get_buf().
+ */
+int jbd2_fc_wait_bufs(journal_t *journal, int num_blks)
+{
+	struct buffer_head *bh;
+	int i, j_fc_off, err = 0;
+
+	j_fc_off = journal->j_fc_off;
+
+	/*
+	 * Wait in reverse order to minimize chances of us being woken up
+	 * before all IOs have completed.
+	 */
+	for (i = j_fc_off - 1; i >= j_fc_off - num_blks; i--) {
+		bh = journal->j_fc_wbuf[i];
+		wait_on_buffer(bh);
+		if (unlikely(!buffer_uptodate(bh)))
+			err = -EIO;
+		put_bh(bh);
+		journal->j_fc_wbuf[i] = NULL;
+	}
+
+	return err;
+}
+EXPORT_SYMBOL(jbd2_fc_wait_bufs);
+
+/**
+ * void jbd2_fc_release_bufs() - drop fast commit blocks not waited upon
+ * @journal: Journal to act on.
+ */
+void jbd2_fc_release_bufs(journal_t *journal)
+{
+	struct buffer_head *bh;
+	int i;
+
+	for (i = journal->j_fc_off - 1; i >= 0; i--) {
+		bh = journal->j_fc_wbuf[i];
+		if (!bh)
+			break;
+		put_bh(bh);
+		journal->j_fc_wbuf[i] = NULL;
+	}
+}
+EXPORT_SYMBOL(jbd2_fc_release_bufs);
+
 /*
  * Log buffer allocation routines:
  */
@@ -1140,6 +1331,7 @@ static journal_t *journal_init_common(struct block_device *bdev,
 	init_waitqueue_head(&journal->j_wait_commit);
 	init_waitqueue_head(&journal->j_wait_updates);
 	init_waitqueue_head(&journal->j_wait_reserved);
+	init_waitqueue_head(&journal->j_fc_wait);
 	mutex_init(&journal->j_barrier);
 	mutex_init(&journal->j_checkpoint_mutex);
 	spin_lock_init(&journal->j_revoke_lock);
@@ -1305,6 +1497,8 @@ static int journal_reset(journal_t *journal)
 
 	first = be32_to_cpu(sb->s_first);
 	last = be32_to_cpu(sb->s_maxlen);
+	if (jbd2_has_feature_fast_commit(journal))
+		last = journal->j_fc_first;
 	if (first + JBD2_MIN_JOURNAL_BLOCKS > last + 1) {
 		printk(KERN_ERR "JBD2: Journal too short (blocks %llu-%llu).\n",
 		       first, last);
@@ -1640,6 +1834,40 @@ static int journal_get_superblock(journal_t *journal)
 	return err;
 }
 
+/*
+ * Carve the fast commit area out of the end of the journal.  The log
+ * proper then ends where the fast commit area starts.
+ */
+static int jbd2_journal_init_fast_commit(journal_t *journal)
+{
+	journal_superblock_t *sb = journal->j_superblock;
+	unsigned long num_fc_blks = jbd2_journal_get_num_fc_blks(sb);
+	unsigned long maxlen = be32_to_cpu(sb->s_maxlen);
+
+	if (be32_to_cpu(sb->s_first) + JBD2_MIN_JOURNAL_BLOCKS + num_fc_blks >
+	    maxlen + 1) {
+		printk(KERN_ERR "JBD2: Journal too short for %lu fast commit "
+		       "blocks\n", num_fc_blks);
+		return -ENOSPC;
+	}
+
+	if (!journal->j_fc_wbuf) {
+		journal->j_fc_wbuf = kcalloc(num_fc_blks,
+					     sizeof(struct buffer_head *),
+					     GFP_KERNEL);
+		if (!journal->j_fc_wbuf)
+			return -ENOMEM;
+	}
+
+	journal->j_fc_wbufsize = num_fc_blks;
+	journal->j_fc_last = maxlen;
+	journal->j_fc_first = maxlen - num_fc_blks;
+	journal->j_fc_off = 0;
+	journal->j_last = journal->j_fc_first;
+
+	return 0;
+}
+
 /*
  * Load the on-disk journal superblock and read the key fields into the
  * journal_t.
@@ -1662,6 +1890,9 @@ static int load_superblock(journal_t *journal)
 	journal->j_last = be32_to_cpu(sb->s_maxlen);
 	journal->j_errno = be32_to_cpu(sb->s_errno);
 
+	if (jbd2_has_feature_fast_commit(journal))
+		return jbd2_journal_init_fast_commit(journal);
+
 	return 0;
 }
 
@@ -1805,6 +2036,7 @@ int jbd2_journal_destroy(journal_t *journal)
 		jbd2_journal_destroy_revoke(journal);
 	if (journal->j_chksum_driver)
 		crypto_free_shash(journal->j_chksum_driver);
+	kfree(journal->j_fc_wbuf);
 	kfree(journal->j_wbuf);
 	kfree(journal);
 
@@ -1922,6 +2154,23 @@ int jbd2_journal_set_features (journal_t *journal, unsigned long compat,
 
 	sb = journal->j_superblock;
 
+	/*
+	 * The fast commit area shrinks the log, which is only safe while
+	 * nothing is logged yet, i.e. right after the journal is loaded.
+	 */
+	if (INCOMPAT_FEATURE_ON(JBD2_FEATURE_INCOMPAT_FAST_COMMIT)) {
+		unsigned long fc_first = be32_to_cpu(sb->s_maxlen) -
+				jbd2_journal_get_num_fc_blks(sb);
+
+		if (journal->j_head != journal->j_tail ||
+		    journal->j_head >= fc_first ||
+		    jbd2_journal_init_fast_commit(journal)) {
+			printk(KERN_ERR "JBD2: Cannot enable fast commits.\n");
+			return 0;
+		}
+		journal->j_free = journal->j_last - journal->j_first;
+	}
+
 	/* Load the checksum driver if necessary */
 	if ((journal->j_chksum_driver == NULL) &&
 	    INCOMPAT_FEATURE_ON(JBD2_FEATURE_INCOMPAT_CSUM_V3)) {
@@ -35,7 +35,6 @@ struct recovery_info
 	int		nr_revoke_hits;
 };
 
-enum passtype {PASS_SCAN, PASS_REVOKE, PASS_REPLAY};
 static int do_one_pass(journal_t *journal,
 				struct recovery_info *info, enum passtype pass);
 static int scan_revoke_records(journal_t *, struct buffer_head *,
@@ -334,6 +333,49 @@ int jbd2_journal_skip_recovery(journal_t *journal)
 	return err;
 }
 
+/*
+ * Hand the fast commit area to the client filesystem, block by block, once
+ * the regular log has been processed.  Only fast commits tagged with the
+ * transaction after the last complete one in the log are valid; it is up
+ * to the replay callback to check that and to tell us where the fast
+ * commit log ends.
+ */
+static int fc_do_one_pass(journal_t *journal,
+			  struct recovery_info *info, enum passtype pass)
+{
+	unsigned int expected_commit_id = info->end_transaction;
+	unsigned long next_fc_block;
+	struct buffer_head *bh;
+	int err = 0;
+
+	if (!journal->j_fc_replay_callback)
+		return 0;
+
+	next_fc_block = journal->j_fc_first;
+	while (next_fc_block < journal->j_fc_last) {
+		jbd_debug(3, "Fast commit replay: next block %ld\n",
+			  next_fc_block);
+		err = jread(&bh, journal, next_fc_block);
+		if (err)
+			break;
+
+		err = journal->j_fc_replay_callback(journal, bh, pass,
+					next_fc_block - journal->j_fc_first,
+					expected_commit_id);
+		brelse(bh);
+		next_fc_block++;
+		if (err < 0 || err == JBD2_FC_REPLAY_STOP)
+			break;
+		err = 0;
+	}
+
+	if (err < 0) {
+		jbd_debug(3, "Fast commit replay failed, err = %d\n", err);
+		return err;
+	}
+	return 0;
+}
+
 static inline unsigned long long read_tag_block(journal_t *journal,
 						journal_block_tag_t *tag)
 {
@@ -799,6 +841,12 @@ static int do_one_pass(journal_t *journal,
 				success = -EIO;
 		}
 	}
+	if (jbd2_has_feature_fast_commit(journal) && pass != PASS_REVOKE) {
+		err = fc_do_one_pass(journal, info, pass);
+		if (err)
+			success = err;
+	}
+
 	if (block_error && success == 0)
 		success = -EIO;
 	return success;
@@ -2,6 +2,7 @@
 #include <linux/fanotify.h>
 #include <linux/fdtable.h>
 #include <linux/fsnotify_backend.h>
+#include <linux/hash.h>
 #include <linux/init.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h> /* UINT_MAX */
@@ -111,13 +112,21 @@ static bool should_merge(struct fsnotify_event *old_fsn,
 	return false;
 }
 
-/* and the list better be locked by something too! */
-static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
+static struct hlist_head *fanotify_merge_bucket(struct fsnotify_group *group,
+						struct fsnotify_event *event)
 {
-	struct fsnotify_event *test_event;
+	return &group->fanotify_data.merge_hash[hash_long(event->objectid,
+							  FANOTIFY_HTABLE_BITS)];
+}
+
+/* Called with notification_lock held */
+static int fanotify_merge(struct fsnotify_group *group,
+			  struct fsnotify_event *event)
+{
+	struct fanotify_event *test_event;
 	struct fanotify_event *new;
 
-	pr_debug("%s: list=%p event=%p\n", __func__, list, event);
+	pr_debug("%s: group=%p event=%p\n", __func__, group, event);
 	new = FANOTIFY_E(event);
 
 	/*
@@ -128,9 +137,11 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	if (fanotify_is_perm_event(new->mask))
 		return 0;
 
-	list_for_each_entry_reverse(test_event, list, list) {
-		if (should_merge(test_event, event)) {
-			FANOTIFY_E(test_event)->mask |= new->mask;
+	/* Newest events are at the head of the bucket */
+	hlist_for_each_entry(test_event, fanotify_merge_bucket(group, event),
+			     merge_list) {
+		if (should_merge(&test_event->fse, event)) {
+			test_event->mask |= new->mask;
 			return 1;
 		}
 	}
@@ -138,6 +149,19 @@ static int fanotify_merge(struct list_head *list, struct fsnotify_event *event)
 	return 0;
 }
 
+/* Called with notification_lock held after the event was queued */
+static void fanotify_insert(struct fsnotify_group *group,
+			    struct fsnotify_event *event)
+{
+	struct fanotify_event *new = FANOTIFY_E(event);
+
+	/* Permission events are never merged, so don't hash them */
+	if (fanotify_is_perm_event(new->mask))
+		return;
+
+	hlist_add_head(&new->merge_list, fanotify_merge_bucket(group, event));
+}
+
 /*
  * Wait for response to permission event. The function also takes care of
  * freeing the permission event (or offloads that in case the wait is canceled
@@ -424,6 +448,7 @@ struct fanotify_event *fanotify_alloc_event(struct fsnotify_group *group,
 	 * reported on child when both directory and child watches exist.
 	 */
 	fsnotify_init_event(&event->fse, (unsigned long)id);
+	INIT_HLIST_NODE(&event->merge_list);
 	event->mask = mask;
 	if (FAN_GROUP_FLAG(group, FAN_REPORT_TID))
 		event->pid = get_pid(task_pid(current));
@@ -560,7 +585,8 @@ static int fanotify_handle_event(struct fsnotify_group *group,
 	}
 
 	fsn_event = &event->fse;
-	ret = fsnotify_add_event(group, fsn_event, fanotify_merge);
+	ret = fsnotify_add_event(group, fsn_event, fanotify_merge,
+				 fanotify_insert);
 	if (ret) {
 		/* Permission events shouldn't be merged */
 		BUG_ON(ret == 1 && mask & FANOTIFY_PERM_EVENTS);
@@ -583,6 +609,7 @@ static void fanotify_free_group_priv(struct fsnotify_group *group)
 {
 	struct user_struct *user;
 
+	kfree(group->fanotify_data.merge_hash);
 	user = group->fanotify_data.user;
 	atomic_dec(&user->fanotify_listeners);
 	free_uid(user);
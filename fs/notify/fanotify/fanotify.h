@@ -65,8 +65,16 @@ enum fanotify_event_type {
 	FANOTIFY_EVENT_TYPE_PATH_PERM,
 };
 
+/*
+ * Queued events are also hashed by object id so that a new event can find
+ * a mergeable one without walking the whole notification list.
+ */
+#define FANOTIFY_HTABLE_BITS	(7)
+#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
+
 struct fanotify_event {
 	struct fsnotify_event fse;
+	struct hlist_node merge_list;	/* member of group merge_hash */
 	u32 mask;
 	enum fanotify_event_type type;
 	struct pid *pid;
@@ -187,6 +195,12 @@ static inline struct fanotify_event *FANOTIFY_E(struct fsnotify_event *fse)
 	return container_of(fse, struct fanotify_event, fse);
 }
 
+/* Called with notification_lock held when dequeueing an event */
+static inline void fanotify_unhash_event(struct fanotify_event *event)
+{
+	hlist_del_init(&event->merge_list);
+}
+
 static inline bool fanotify_event_has_path(struct fanotify_event *event)
 {
 	return event->type == FANOTIFY_EVENT_TYPE_PATH ||
@@ -110,6 +110,7 @@ static struct fanotify_event *get_one_event(struct fsnotify_group *group,
 		goto out;
 	}
 	event = FANOTIFY_E(fsnotify_remove_first_event(group));
+	fanotify_unhash_event(event);
 	if (fanotify_is_perm_event(event->mask))
 		FANOTIFY_PERM(event)->state = FAN_EVENT_REPORTED;
 out:
@@ -537,6 +538,7 @@ static int fanotify_release(struct inode *ignored, struct file *file)
 		struct fanotify_event *event;
 
 		event = FANOTIFY_E(fsnotify_remove_first_event(group));
+		fanotify_unhash_event(event);
 		if (!(event->mask & FANOTIFY_PERM_EVENTS)) {
 			spin_unlock(&group->notification_lock);
 			fsnotify_destroy_event(group, &event->fse);
@@ -890,6 +892,13 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 	atomic_inc(&user->fanotify_listeners);
 	group->memcg = get_mem_cgroup_from_mm(current->mm);
 
+	group->fanotify_data.merge_hash = kcalloc(FANOTIFY_HTABLE_SIZE,
+					sizeof(struct hlist_head), GFP_KERNEL);
+	if (!group->fanotify_data.merge_hash) {
+		fd = -ENOMEM;
+		goto out_destroy_group;
+	}
+
 	oevent = fanotify_alloc_event(group, NULL, FS_Q_OVERFLOW, NULL,
 				      FSNOTIFY_EVENT_NONE, NULL, NULL);
 	if (unlikely(!oevent)) {
@@ -824,6 +824,7 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 	unsigned int i;
 	int err;
 	bool metacopy = false;
+	bool filtered;
 	struct ovl_lookup_data d = {
 		.sb = dentry->d_sb,
 		.name = dentry->d_name,
@@ -899,12 +900,20 @@ struct dentry *ovl_lookup(struct inode *dir, struct dentry *dentry,
 		else
 			d.last = lower.layer->idx == roe->numlower;
 
+		/* Filters only know the names in the parent's lower dirs */
+		filtered = !d.redirect && poe == dentry->d_parent->d_fsdata;
+		if (filtered && !ovl_lower_may_contain(poe, i, &d.name))
+			continue;
+
 		err = ovl_lookup_layer(lower.dentry, &d, &this);
 		if (err)
 			goto out_put;
 
-		if (!this)
+		if (!this) {
+			if (filtered)
+				ovl_lower_lookup_miss(poe);
 			continue;
+		}
 
 		/*
 		 * If no origin fh is stored in upper of a merge dir, store fh
@@ -393,6 +393,10 @@ int ovl_check_empty_dir(struct dentry *dentry, struct list_head *list);
 void ovl_cleanup_whiteouts(struct dentry *upper, struct list_head *list);
 void ovl_cache_free(struct list_head *list);
 void ovl_dir_cache_free(struct inode *inode);
+void ovl_lookup_cache_free(struct ovl_lookup_cache *cache);
+bool ovl_lower_may_contain(struct ovl_entry *oe, unsigned int layer,
+			   const struct qstr *name);
+void ovl_lower_lookup_miss(struct ovl_entry *oe);
 int ovl_check_d_type_supported(struct path *realpath);
 void ovl_workdir_cleanup(struct inode *dir, struct vfsmount *mnt,
 			 struct dentry *dentry, int level);
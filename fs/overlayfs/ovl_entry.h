@@ -92,6 +92,9 @@ struct ovl_entry {
 		};
 		struct rcu_head rcu;
 	};
+	/* Negative lower lookups and the filters they caused, see readdir.c */
+	atomic_t lookup_misses;
+	struct ovl_lookup_cache *lookup_cache;
 	unsigned numlower;
 	struct ovl_path lowerstack[];
 };
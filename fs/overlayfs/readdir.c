@@ -13,6 +13,8 @@
 #include <linux/security.h>
 #include <linux/cred.h>
 #include <linux/ratelimit.h>
+#include <linux/hash.h>
+#include <linux/mm.h>
 #include "overlayfs.h"
 
 struct ovl_cache_entry {
@@ -319,6 +321,176 @@ static inline int ovl_dir_read(struct path *realpath,
 	return err;
 }
 
+/*
+ * Name filters of the lower dirs of a dir, so that lookups skip layers that
+ * can't contain a name: a bit clear in the filter of a layer means that the
+ * name is not in that layer.  Lower layers must not change while the
+ * overlay is mounted, so a filter stays valid as long as the ovl_entry that
+ * holds the lower dirs.  Filters are only built for dirs that see repeated
+ * negative lookups; every name of a layer costs a byte of filter.
+ */
+#define OVL_LOOKUP_CACHE_MISSES		8
+#define OVL_LOOKUP_FILTER_MAX_NAMES	(1 << 20)
+
+struct ovl_name_filter {
+	unsigned int order;
+	unsigned long bits[];
+};
+
+struct ovl_lookup_cache {
+	unsigned int numlower;
+	struct ovl_name_filter *filter[];
+};
+
+struct ovl_filter_data {
+	struct dir_context ctx;
+	u32 *hashes;
+	unsigned int count;
+	unsigned int size;
+	bool added;
+	int err;
+};
+
+static bool ovl_name_filter_test(struct ovl_name_filter *filter, u32 hash)
+{
+	return test_bit(hash & ((1U << filter->order) - 1), filter->bits) &&
+	       test_bit(hash_32(hash, filter->order), filter->bits);
+}
+
+static int ovl_fill_filter(struct dir_context *ctx, const char *name,
+			   int namelen, loff_t offset, u64 ino,
+			   unsigned int d_type)
+{
+	struct ovl_filter_data *fd =
+		container_of(ctx, struct ovl_filter_data, ctx);
+
+	if (fd->count == fd->size) {
+		unsigned int size = fd->size ? fd->size * 2 : 256;
+		u32 *hashes;
+
+		if (size > OVL_LOOKUP_FILTER_MAX_NAMES) {
+			fd->err = -E2BIG;
+			return -E2BIG;
+		}
+		hashes = kvmalloc_array(size, sizeof(u32), GFP_KERNEL);
+		if (!hashes) {
+			fd->err = -ENOMEM;
+			return -ENOMEM;
+		}
+		if (fd->hashes) {
+			memcpy(hashes, fd->hashes, fd->count * sizeof(u32));
+			kvfree(fd->hashes);
+		}
+		fd->hashes = hashes;
+		fd->size = size;
+	}
+	fd->hashes[fd->count++] = full_name_hash(NULL, name, namelen);
+	fd->added = true;
+	return 0;
+}
+
+static struct ovl_name_filter *ovl_name_filter_build(struct path *realpath)
+{
+	struct ovl_filter_data fd = {
+		.ctx.actor = ovl_fill_filter,
+	};
+	struct ovl_name_filter *filter = NULL;
+	struct file *realfile;
+	unsigned int i, order;
+	int err;
+
+	realfile = ovl_path_open(realpath, O_RDONLY | O_DIRECTORY);
+	if (IS_ERR(realfile))
+		return NULL;
+
+	do {
+		fd.added = false;
+		fd.err = 0;
+		err = iterate_dir(realfile, &fd.ctx);
+		if (err >= 0)
+			err = fd.err;
+	} while (!err && fd.added);
+	fput(realfile);
+	if (err)
+		goto out;
+
+	/* 8 to 16 bits per name */
+	order = max_t(unsigned int, ilog2(fd.count * 8 | 1) + 1,
+		      ilog2(BITS_PER_LONG));
+	filter = kvzalloc(sizeof(*filter) + BITS_TO_LONGS(1U << order) *
+			  sizeof(unsigned long), GFP_KERNEL);
+	if (!filter)
+		goto out;
+
+	filter->order = order;
+	for (i = 0; i < fd.count; i++) {
+		__set_bit(fd.hashes[i] & ((1U << order) - 1), filter->bits);
+		__set_bit(hash_32(fd.hashes[i], order), filter->bits);
+	}
+out:
+	kvfree(fd.hashes);
+	return filter;
+}
+
+static void ovl_lookup_cache_build(struct ovl_entry *oe)
+{
+	struct ovl_lookup_cache *cache;
+	unsigned int i;
+
+	cache = kzalloc(struct_size(cache, filter, oe->numlower), GFP_KERNEL);
+	if (!cache)
+		return;
+
+	cache->numlower = oe->numlower;
+	for (i = 0; i < oe->numlower; i++) {
+		struct path realpath = {
+			.mnt = oe->lowerstack[i].layer->mnt,
+			.dentry = oe->lowerstack[i].dentry,
+		};
+
+		/* no filter just means that the layer is always looked up */
+		cache->filter[i] = ovl_name_filter_build(&realpath);
+	}
+
+	if (cmpxchg(&oe->lookup_cache, NULL, cache))
+		ovl_lookup_cache_free(cache);
+}
+
+void ovl_lookup_cache_free(struct ovl_lookup_cache *cache)
+{
+	unsigned int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->numlower; i++)
+		kvfree(cache->filter[i]);
+	kfree(cache);
+}
+
+/* Can the lower dir of @oe in stack position @layer contain @name? */
+bool ovl_lower_may_contain(struct ovl_entry *oe, unsigned int layer,
+			   const struct qstr *name)
+{
+	struct ovl_lookup_cache *cache = READ_ONCE(oe->lookup_cache);
+	struct ovl_name_filter *filter;
+
+	if (!cache)
+		return true;
+
+	filter = cache->filter[layer];
+	return !filter ||
+	       ovl_name_filter_test(filter,
+				    full_name_hash(NULL, name->name, name->len));
+}
+
+/* Record a negative lookup in a lower dir of @oe */
+void ovl_lower_lookup_miss(struct ovl_entry *oe)
+{
+	if (atomic_inc_return(&oe->lookup_misses) == OVL_LOOKUP_CACHE_MISSES)
+		ovl_lookup_cache_build(oe);
+}
+
 /*
  * Can we iterate real dir directly?
  *
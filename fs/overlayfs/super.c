@@ -59,6 +59,8 @@ static void ovl_entry_stack_free(struct ovl_entry *oe)
 
 	for (i = 0; i < oe->numlower; i++)
 		dput(oe->lowerstack[i].dentry);
+	ovl_lookup_cache_free(oe->lookup_cache);
+	oe->lookup_cache = NULL;
 }
 
 static bool ovl_metacopy_def = IS_ENABLED(CONFIG_OVERLAY_FS_METACOPY);
@@ -370,8 +370,8 @@ static int notrace ramoops_pstore_write(struct pstore_record *record)
 		else
 			zonenum = 0;
 
-		persistent_ram_write(cxt->fprzs[zonenum], record->buf,
-				     record->size);
+		persistent_ram_write_fast(cxt->fprzs[zonenum], record->buf,
+					  record->size);
 		return 0;
 	} else if (record->type == PSTORE_TYPE_PMSG) {
 		pr_warn_ratelimited("PMSG shouldn't call %s\n", __func__);
@@ -810,8 +810,10 @@ static int ramoops_probe(struct platform_device *pdev)
 	err = ramoops_init_przs("ftrace", dev, cxt, &cxt->fprzs, &paddr,
 				cxt->ftrace_size, -1,
 				&cxt->max_ftrace_cnt, LINUX_VERSION_CODE,
-				(cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
-					? PRZ_FLAG_NO_LOCK : 0);
+				((cxt->flags & RAMOOPS_FLAG_FTRACE_PER_CPU)
+					? PRZ_FLAG_NO_LOCK : 0) |
+				((cxt->flags & RAMOOPS_FLAG_FTRACE_NO_ECC)
+					? PRZ_FLAG_NO_ECC : 0));
 	if (err)
 		goto fail_init_fprz;
 
@@ -342,6 +342,40 @@ int notrace persistent_ram_write(struct persistent_ram_zone *prz,
 	return count;
 }
 
+/*
+ * Lockless, ECC-free variant of persistent_ram_write() for per-CPU zones.
+ * Word-aligned records that do not wrap are copied with 32-bit stores and
+ * the header is updated without the buffer lock; anything else falls back
+ * to the generic path.
+ */
+int notrace persistent_ram_write_fast(struct persistent_ram_zone *prz,
+	const void *s, unsigned int count)
+{
+	size_t start, size;
+
+	if (prz->ecc_info.ecc_size || !(prz->flags & PRZ_FLAG_NO_LOCK))
+		return persistent_ram_write(prz, s, count);
+
+	start = buffer_start(prz);
+	if (unlikely((start | count | prz->buffer_size) & 3 ||
+		     start + count > prz->buffer_size))
+		return persistent_ram_write(prz, s, count);
+
+	size = buffer_size(prz);
+	if (size != prz->buffer_size)
+		atomic_set(&prz->buffer->size,
+			   min(size + count, prz->buffer_size));
+
+	__iowrite32_copy(&prz->buffer->data[start], s, count / 4);
+
+	start += count;
+	if (start == prz->buffer_size)
+		start = 0;
+	atomic_set(&prz->buffer->start, start);
+
+	return count;
+}
+
 int notrace persistent_ram_write_user(struct persistent_ram_zone *prz,
 	const void __user *s, unsigned int count)
 {
@@ -580,7 +614,8 @@ struct persistent_ram_zone *persistent_ram_new(phys_addr_t start, size_t size,
 	if (ret)
 		goto err;
 
-	ret = persistent_ram_post_init(prz, sig, ecc_info);
+	ret = persistent_ram_post_init(prz, sig,
+				       (flags & PRZ_FLAG_NO_ECC) ? NULL : ecc_info);
 	if (ret)
 		goto err;
 
@@ -39,12 +39,37 @@
 #include <linux/spinlock.h>
 #include <linux/wait.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
 #include "squashfs.h"
 #include "page_actor.h"
 
+static inline struct hlist_head *squashfs_cache_bucket(
+	struct squashfs_cache *cache, u64 block)
+{
+	return &cache->hash[hash_64(block, cache->hash_bits)];
+}
+
+
+/*
+ * Find the cache entry of block, if any.  Called with the cache lock held.
+ */
+static struct squashfs_cache_entry *squashfs_cache_lookup(
+	struct squashfs_cache *cache, u64 block)
+{
+	struct squashfs_cache_entry *entry;
+
+	hlist_for_each_entry(entry, squashfs_cache_bucket(cache, block), hash)
+		if (entry->block == block)
+			return entry;
+
+	return NULL;
+}
+
+
 /*
  * Look-up block in cache, and increment usage count.  If not in cache, read
  * and decompress it from disk.
@@ -58,15 +83,9 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 	spin_lock(&cache->lock);
 
 	while (1) {
-		for (i = cache->curr_blk, n = 0; n < cache->entries; n++) {
-			if (cache->entry[i].block == block) {
-				cache->curr_blk = i;
-				break;
-			}
-			i = (i + 1) % cache->entries;
-		}
+		entry = squashfs_cache_lookup(cache, block);
 
-		if (n == cache->entries) {
+		if (entry == NULL) {
 			/*
 			 * Block not in cache, if all cache entries are used
 			 * go to sleep waiting for one to become available.
@@ -95,12 +114,20 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			cache->next_blk = (i + 1) % cache->entries;
 			entry = &cache->entry[i];
 
+			cache->misses++;
+			if (entry->block != SQUASHFS_INVALID_BLK) {
+				cache->evictions++;
+				hlist_del(&entry->hash);
+			}
+
 			/*
 			 * Initialise chosen cache entry, and fill it in from
 			 * disk.
 			 */
 			cache->unused--;
 			entry->block = block;
+			hlist_add_head(&entry->hash,
+				squashfs_cache_bucket(cache, block));
 			entry->refcount = 1;
 			entry->pending = 1;
 			entry->num_waiters = 0;
@@ -137,7 +164,7 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		 * previously unused there's one less cache entry available
 		 * for reuse.
 		 */
-		entry = &cache->entry[i];
+		cache->hits++;
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
@@ -158,7 +185,8 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 
 out:
 	TRACE("Got %s %d, start block %lld, refcount %d, error %d\n",
-		cache->name, i, entry->block, entry->refcount, entry->error);
+		cache->name, (int) (entry - cache->entry), entry->block,
+		entry->refcount, entry->error);
 
 	if (entry->error)
 		ERROR("Unable to read %s cache entry [%llx]\n", cache->name,
@@ -210,6 +238,7 @@ void squashfs_cache_delete(struct squashfs_cache *cache)
 		kfree(cache->entry[i].actor);
 	}
 
+	kfree(cache->hash);
 	kfree(cache->entry);
 	kfree(cache);
 }
@@ -237,7 +266,15 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		goto cleanup;
 	}
 
-	cache->curr_blk = 0;
+	/* Twice as many buckets as entries keeps the chains short */
+	cache->hash_bits = ilog2(roundup_pow_of_two(entries)) + 1;
+	cache->hash = kcalloc(1 << cache->hash_bits, sizeof(*(cache->hash)),
+		GFP_KERNEL);
+	if (cache->hash == NULL) {
+		ERROR("Failed to allocate %s cache\n", name);
+		goto cleanup;
+	}
+
 	cache->next_blk = 0;
 	cache->unused = entries;
 	cache->entries = entries;
@@ -255,6 +292,7 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 		init_waitqueue_head(&cache->entry[i].wait_queue);
 		entry->cache = cache;
 		entry->block = SQUASHFS_INVALID_BLK;
+		INIT_HLIST_NODE(&entry->hash);
 		entry->data = kcalloc(cache->pages, sizeof(void *), GFP_KERNEL);
 		if (entry->data == NULL) {
 			ERROR("Failed to allocate %s cache entry\n", name);
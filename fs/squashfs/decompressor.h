@@ -20,6 +20,8 @@ struct squashfs_decompressor {
 	int	id;
 	char	*name;
 	int	supported;
+	/* decompresses into squashfs_linear_page() when it is available */
+	int	linear_output;
 };
 
 static inline void *squashfs_comp_opts(struct squashfs_sb_info *msblk,
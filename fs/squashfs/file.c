@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -494,7 +495,112 @@ static int squashfs_readpage(struct file *file, struct page *page)
 	return 0;
 }
 
+/*
+ * Readahead.  The pages of the readahead window are batched per datablock,
+ * and each datablock is read by squashfs_readpage() on its first page,
+ * which fills the other pages of the block as well.  With more than one
+ * decompressor, every block but the first is handed to a worker, so that
+ * I/O for all of them is issued at once and they are decompressed in
+ * parallel while the caller reads the block it is waiting for.
+ */
+struct squashfs_readahead_work {
+	struct work_struct work;
+	int nr;
+	struct page *page[];
+};
+
+static void squashfs_readahead_block(struct squashfs_readahead_work *rw)
+{
+	int i;
+
+	/*
+	 * squashfs_readpage() only grabs the other pages of the block if it
+	 * can lock them, so let go of them first.  If someone else locks one
+	 * meanwhile, it is read through the intermediate buffer instead.
+	 */
+	for (i = 1; i < rw->nr; i++)
+		unlock_page(rw->page[i]);
+
+	squashfs_readpage(NULL, rw->page[0]);
+
+	for (i = 0; i < rw->nr; i++)
+		put_page(rw->page[i]);
+	kfree(rw);
+}
+
+static void squashfs_readahead_workfn(struct work_struct *work)
+{
+	squashfs_readahead_block(container_of(work,
+				struct squashfs_readahead_work, work));
+}
+
+static void squashfs_readahead_submit(struct squashfs_readahead_work *rw,
+	struct squashfs_readahead_work **first, bool parallel)
+{
+	if (!parallel) {
+		squashfs_readahead_block(rw);
+	} else if (*first == NULL) {
+		*first = rw;
+	} else {
+		INIT_WORK(&rw->work, squashfs_readahead_workfn);
+		queue_work(system_unbound_wq, &rw->work);
+	}
+}
+
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned int nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_SHIFT;
+	gfp_t gfp = readahead_gfp_mask(mapping);
+	bool parallel = squashfs_max_decompressors() > 1 &&
+		num_online_cpus() > 1;
+	struct squashfs_readahead_work *rw = NULL, *first = NULL;
+
+	TRACE("Entered squashfs_readpages, %u pages, start block %llx\n",
+				nr_pages, squashfs_i(inode)->start);
+
+	for (; nr_pages; nr_pages--) {
+		struct page *page = lru_to_page(pages);
+
+		list_del(&page->lru);
+		if (add_to_page_cache_lru(page, mapping, page->index, gfp)) {
+			put_page(page);
+			continue;
+		}
+
+		if (rw && (page->index >> shift) !=
+					(rw->page[0]->index >> shift)) {
+			squashfs_readahead_submit(rw, &first, parallel);
+			rw = NULL;
+		}
+
+		if (rw == NULL) {
+			rw = kmalloc(struct_size(rw, page, 1 << shift),
+								GFP_KERNEL);
+			if (rw == NULL) {
+				/* Out of memory, read this page on its own */
+				squashfs_readpage(file, page);
+				put_page(page);
+				continue;
+			}
+			rw->nr = 0;
+		}
+		rw->page[rw->nr++] = page;
+	}
+
+	if (rw)
+		squashfs_readahead_submit(rw, &first, parallel);
+
+	if (first)
+		squashfs_readahead_block(first);
+
+	return 0;
+}
+
 
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
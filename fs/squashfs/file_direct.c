@@ -16,6 +16,7 @@
 #include "squashfs_fs_sb.h"
 #include "squashfs_fs_i.h"
 #include "squashfs.h"
+#include "decompressor.h"
 #include "page_actor.h"
 
 static int squashfs_read_cache(struct page *target_page, u64 block, int bsize,
@@ -89,8 +90,17 @@ int squashfs_readpage_block(struct page *target_page, u64 block, int bsize,
 		goto out;
 	}
 
+	/*
+	 * Decompressors which need contiguous output get the pages mapped
+	 * linearly, otherwise they bounce through an intermediate buffer.
+	 * Failing to map is not fatal, the page by page path still works.
+	 */
+	if (msblk->decompressor->linear_output)
+		squashfs_page_actor_map_linear(actor);
+
 	/* Decompress directly into the page cache buffers */
 	res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
+	squashfs_page_actor_unmap_linear(actor);
 	if (res < 0)
 		goto mark_errored;
 
@@ -93,7 +93,7 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	struct squashfs_page_actor *output)
 {
 	struct squashfs_lz4 *stream = strm;
-	void *buff = stream->input, *data;
+	void *buff = stream->input, *data, *linear;
 	int avail, i, bytes = length, res;
 
 	for (i = 0; i < b; i++) {
@@ -105,6 +105,15 @@ static int lz4_uncompress(struct squashfs_sb_info *msblk, void *strm,
 		put_bh(bh[i]);
 	}
 
+	/* Output pages mapped contiguously need no bounce through the buffer */
+	linear = squashfs_linear_page(output);
+	if (linear) {
+		res = LZ4_decompress_safe(stream->input, linear, length,
+			output->length);
+
+		return res < 0 ? -EIO : res;
+	}
+
 	res = LZ4_decompress_safe(stream->input, stream->output,
 		length, output->length);
 
@@ -136,5 +145,6 @@ const struct squashfs_decompressor squashfs_lz4_comp_ops = {
 	.decompress = lz4_uncompress,
 	.id = LZ4_COMPRESSION,
 	.name = "lz4",
-	.supported = 1
+	.supported = 1,
+	.linear_output = 1
 };
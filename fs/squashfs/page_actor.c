@@ -7,6 +7,7 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/pagemap.h>
+#include <linux/vmalloc.h>
 #include "page_actor.h"
 
 /*
@@ -50,6 +51,7 @@ struct squashfs_page_actor *squashfs_page_actor_init(void **buffer,
 	actor->buffer = buffer;
 	actor->pages = pages;
 	actor->next_page = 0;
+	actor->linear = pages == 1 ? buffer[0] : NULL;
 	actor->squashfs_first_page = cache_first_page;
 	actor->squashfs_next_page = cache_next_page;
 	actor->squashfs_finish_page = cache_finish_page;
@@ -91,8 +93,38 @@ struct squashfs_page_actor *squashfs_page_actor_init_special(struct page **page,
 	actor->pages = pages;
 	actor->next_page = 0;
 	actor->pageaddr = NULL;
+	actor->linear = NULL;
 	actor->squashfs_first_page = direct_first_page;
 	actor->squashfs_next_page = direct_next_page;
 	actor->squashfs_finish_page = direct_finish_page;
 	return actor;
 }
+
+/*
+ * Map all the page cache pages of a direct actor into one contiguous
+ * virtual range, for decompressors which can't write output a page at a
+ * time.  All pages must be present, and as this may sleep it has to be
+ * done before the decompressor is entered.
+ */
+int squashfs_page_actor_map_linear(struct squashfs_page_actor *actor)
+{
+	if (actor->pages == 1)
+		actor->linear = kmap(actor->page[0]);
+	else
+		actor->linear = vm_map_ram(actor->page, actor->pages, -1,
+					   PAGE_KERNEL);
+
+	return actor->linear ? 0 : -ENOMEM;
+}
+
+void squashfs_page_actor_unmap_linear(struct squashfs_page_actor *actor)
+{
+	if (actor->linear == NULL)
+		return;
+
+	if (actor->pages == 1)
+		kunmap(actor->page[0]);
+	else
+		vm_unmap_ram(actor->linear, actor->pages);
+	actor->linear = NULL;
+}
@@ -29,6 +29,15 @@ static inline struct squashfs_page_actor *squashfs_page_actor_init(void **page,
 	return actor;
 }
 
+/*
+ * Return the output as one virtually contiguous buffer if the actor has
+ * one, letting the decompressor write into it without bouncing.
+ */
+static inline void *squashfs_linear_page(struct squashfs_page_actor *actor)
+{
+	return actor->pages == 1 ? actor->page[0] : NULL;
+}
+
 static inline void *squashfs_first_page(struct squashfs_page_actor *actor)
 {
 	actor->next_page = 1;
@@ -52,6 +61,7 @@ struct squashfs_page_actor {
 		struct page	**page;
 	};
 	void	*pageaddr;
+	void	*linear;
 	void    *(*squashfs_first_page)(struct squashfs_page_actor *);
 	void    *(*squashfs_next_page)(struct squashfs_page_actor *);
 	void    (*squashfs_finish_page)(struct squashfs_page_actor *);
@@ -63,6 +73,12 @@ struct squashfs_page_actor {
 extern struct squashfs_page_actor *squashfs_page_actor_init(void **, int, int);
 extern struct squashfs_page_actor *squashfs_page_actor_init_special(struct page
 							 **, int, int);
+extern int squashfs_page_actor_map_linear(struct squashfs_page_actor *);
+extern void squashfs_page_actor_unmap_linear(struct squashfs_page_actor *);
+static inline void *squashfs_linear_page(struct squashfs_page_actor *actor)
+{
+	return actor->linear;
+}
 static inline void *squashfs_first_page(struct squashfs_page_actor *actor)
 {
 	return actor->squashfs_first_page(actor);
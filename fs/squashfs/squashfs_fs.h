@@ -203,6 +203,10 @@ static inline int squashfs_block_size(__le32 raw)
 /* cached data constants for filesystem */
 #define SQUASHFS_CACHED_BLKS		8
 
+/* upper limits of the cache sizes selectable at mount time */
+#define SQUASHFS_CACHED_BLKS_MAX	256
+#define SQUASHFS_CACHED_FRAGMENTS_MAX	64
+
 /* meta index cache */
 #define SQUASHFS_META_INDEXES	(SQUASHFS_METADATA_SIZE / sizeof(unsigned int))
 #define SQUASHFS_META_ENTRIES	127
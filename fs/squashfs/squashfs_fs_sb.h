@@ -15,7 +15,6 @@
 struct squashfs_cache {
 	char			*name;
 	int			entries;
-	int			curr_blk;
 	int			next_blk;
 	int			num_waiters;
 	int			unused;
@@ -24,6 +23,11 @@ struct squashfs_cache {
 	spinlock_t		lock;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache_entry *entry;
+	struct hlist_head	*hash;
+	unsigned int		hash_bits;
+	unsigned long		hits;
+	unsigned long		misses;
+	unsigned long		evictions;
 };
 
 struct squashfs_cache_entry {
@@ -36,6 +40,7 @@ struct squashfs_cache_entry {
 	int			num_waiters;
 	wait_queue_head_t	wait_queue;
 	struct squashfs_cache	*cache;
+	struct hlist_node	hash;
 	void			**data;
 	struct squashfs_page_actor	*actor;
 };
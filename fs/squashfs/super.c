@@ -18,6 +18,7 @@
 
 #include <linux/fs.h>
 #include <linux/fs_context.h>
+#include <linux/fs_parser.h>
 #include <linux/vfs.h>
 #include <linux/slab.h>
 #include <linux/mutex.h>
@@ -26,6 +27,7 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -37,6 +39,57 @@
 static struct file_system_type squashfs_fs_type;
 static const struct super_operations squashfs_super_ops;
 
+/* Mount options, only used by squashfs_fill_super() */
+struct squashfs_mount_opts {
+	unsigned int	meta_cache_entries;
+	unsigned int	fragment_cache_entries;
+};
+
+enum squashfs_param {
+	Opt_meta_cache,
+	Opt_fragment_cache,
+};
+
+static const struct fs_parameter_spec squashfs_fs_parameters[] = {
+	fsparam_u32("meta_cache",	Opt_meta_cache),
+	fsparam_u32("fragment_cache",	Opt_fragment_cache),
+	{}
+};
+
+static int squashfs_parse_param(struct fs_context *fc,
+	struct fs_parameter *param)
+{
+	struct squashfs_mount_opts *opts = fc->fs_private;
+	struct fs_parse_result result;
+	int opt;
+
+	opt = fs_parse(fc, squashfs_fs_parameters, param, &result);
+	if (opt < 0)
+		return opt;
+
+	switch (opt) {
+	case Opt_meta_cache:
+		/* The block list walk in file.c relies on the default size */
+		if (result.uint_32 < SQUASHFS_CACHED_BLKS ||
+				result.uint_32 > SQUASHFS_CACHED_BLKS_MAX)
+			return invalfc(fc, "meta_cache must be %d to %d entries",
+				SQUASHFS_CACHED_BLKS, SQUASHFS_CACHED_BLKS_MAX);
+		opts->meta_cache_entries = result.uint_32;
+		break;
+	case Opt_fragment_cache:
+		if (result.uint_32 < 1 ||
+				result.uint_32 > SQUASHFS_CACHED_FRAGMENTS_MAX)
+			return invalfc(fc, "fragment_cache must be 1 to %d entries",
+				SQUASHFS_CACHED_FRAGMENTS_MAX);
+		opts->fragment_cache_entries = result.uint_32;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static const struct squashfs_decompressor *supported_squashfs_filesystem(
 	struct fs_context *fc,
 	short major, short minor, short id)
@@ -67,6 +120,7 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(
 
 static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 {
+	struct squashfs_mount_opts *opts = fc->fs_private;
 	struct squashfs_sb_info *msblk;
 	struct squashfs_super_block *sblk = NULL;
 	struct inode *root;
@@ -194,7 +248,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	err = -ENOMEM;
 
 	msblk->block_cache = squashfs_cache_init("metadata",
-			SQUASHFS_CACHED_BLKS, SQUASHFS_METADATA_SIZE);
+			opts->meta_cache_entries, SQUASHFS_METADATA_SIZE);
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
@@ -270,7 +324,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		opts->fragment_cache_entries, msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -355,17 +409,78 @@ static int squashfs_reconfigure(struct fs_context *fc)
 	return 0;
 }
 
+static void squashfs_free_fs_context(struct fs_context *fc)
+{
+	kfree(fc->fs_private);
+}
+
 static const struct fs_context_operations squashfs_context_ops = {
+	.parse_param	= squashfs_parse_param,
 	.get_tree	= squashfs_get_tree,
 	.reconfigure	= squashfs_reconfigure,
+	.free		= squashfs_free_fs_context,
 };
 
 static int squashfs_init_fs_context(struct fs_context *fc)
 {
+	struct squashfs_mount_opts *opts;
+
+	opts = kzalloc(sizeof(*opts), GFP_KERNEL);
+	if (!opts)
+		return -ENOMEM;
+
+	opts->meta_cache_entries = SQUASHFS_CACHED_BLKS;
+	opts->fragment_cache_entries = SQUASHFS_CACHED_FRAGMENTS;
+
+	fc->fs_private = opts;
 	fc->ops = &squashfs_context_ops;
 	return 0;
 }
 
+static int squashfs_show_options(struct seq_file *s, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	if (msblk->block_cache->entries != SQUASHFS_CACHED_BLKS)
+		seq_printf(s, ",meta_cache=%d", msblk->block_cache->entries);
+	if (msblk->fragment_cache &&
+			msblk->fragment_cache->entries != SQUASHFS_CACHED_FRAGMENTS)
+		seq_printf(s, ",fragment_cache=%d",
+			msblk->fragment_cache->entries);
+
+	return 0;
+}
+
+static void squashfs_show_cache_stats(struct seq_file *s,
+	struct squashfs_cache *cache)
+{
+	unsigned long hits, misses, evictions;
+
+	if (cache == NULL)
+		return;
+
+	spin_lock(&cache->lock);
+	hits = cache->hits;
+	misses = cache->misses;
+	evictions = cache->evictions;
+	spin_unlock(&cache->lock);
+
+	seq_printf(s, "\n\t%s cache: entries %d hits %lu misses %lu evictions %lu",
+		cache->name, cache->entries, hits, misses, evictions);
+}
+
+/* Per superblock cache statistics, reported in /proc/<pid>/mountstats */
+static int squashfs_show_stats(struct seq_file *s, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	squashfs_show_cache_stats(s, msblk->block_cache);
+	squashfs_show_cache_stats(s, msblk->fragment_cache);
+	squashfs_show_cache_stats(s, msblk->read_page);
+
+	return 0;
+}
+
 static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 {
 	struct squashfs_sb_info *msblk = dentry->d_sb->s_fs_info;
@@ -492,6 +607,8 @@ static const struct super_operations squashfs_super_ops = {
 	.free_inode = squashfs_free_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
+	.show_options = squashfs_show_options,
+	.show_stats = squashfs_show_stats,
 };
 
 module_init(init_squashfs_fs);
@@ -24,6 +24,7 @@ struct workspace {
 	void *mem;
 	size_t mem_size;
 	size_t window_size;
+	void *input;
 };
 
 static void *zstd_init(struct squashfs_sb_info *msblk, void *buff)
@@ -39,10 +40,16 @@ static void *zstd_init(struct squashfs_sb_info *msblk, void *buff)
 	if (wksp->mem == NULL)
 		goto failed;
 
+	wksp->input = vmalloc(wksp->window_size);
+	if (wksp->input == NULL)
+		goto failed;
+
 	return wksp;
 
 failed:
 	ERROR("Failed to allocate zstd workspace\n");
+	if (wksp)
+		vfree(wksp->mem);
 	kfree(wksp);
 	return ERR_PTR(-ENOMEM);
 }
@@ -52,12 +59,60 @@ static void zstd_free(void *strm)
 {
 	struct workspace *wksp = strm;
 
-	if (wksp)
+	if (wksp) {
 		vfree(wksp->mem);
+		vfree(wksp->input);
+	}
 	kfree(wksp);
 }
 
 
+/*
+ * With both input and output contiguous zstd decodes the frame in a single
+ * pass straight into the output, rather than through its window buffer.
+ */
+static int zstd_uncompress_linear(struct squashfs_sb_info *msblk,
+	struct workspace *wksp, ZSTD_DStream *stream, struct buffer_head **bh,
+	int b, int offset, int length, void *linear, int size)
+{
+	ZSTD_inBuffer in_buf = { NULL, length, 0 };
+	ZSTD_outBuffer out_buf = { linear, size, 0 };
+	void *buff = wksp->input;
+	int avail, i, bytes = length;
+	size_t zstd_err;
+
+	if (b == 1) {
+		in_buf.src = bh[0]->b_data + offset;
+	} else {
+		for (i = 0; i < b; i++) {
+			avail = min(bytes, msblk->devblksize - offset);
+			memcpy(buff, bh[i]->b_data + offset, avail);
+			buff += avail;
+			bytes -= avail;
+			offset = 0;
+		}
+		in_buf.src = wksp->input;
+	}
+
+	zstd_err = ZSTD_decompressStream(stream, &out_buf, &in_buf);
+
+	for (i = 0; i < b; i++)
+		put_bh(bh[i]);
+
+	if (ZSTD_isError(zstd_err)) {
+		ERROR("zstd decompression error: %d\n",
+				(int)ZSTD_getErrorCode(zstd_err));
+		return -EIO;
+	}
+
+	/* the whole stream was available, so it must have ended */
+	if (zstd_err != 0)
+		return -EIO;
+
+	return (int)out_buf.pos;
+}
+
+
 static int zstd_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	struct buffer_head **bh, int b, int offset, int length,
 	struct squashfs_page_actor *output)
@@ -69,6 +124,7 @@ static int zstd_uncompress(struct squashfs_sb_info *msblk, void *strm,
 	int k = 0;
 	ZSTD_inBuffer in_buf = { NULL, 0, 0 };
 	ZSTD_outBuffer out_buf = { NULL, 0, 0 };
+	void *linear;
 
 	stream = ZSTD_initDStream(wksp->window_size, wksp->mem, wksp->mem_size);
 
@@ -77,6 +133,11 @@ static int zstd_uncompress(struct squashfs_sb_info *msblk, void *strm,
 		goto out;
 	}
 
+	linear = squashfs_linear_page(output);
+	if (linear)
+		return zstd_uncompress_linear(msblk, wksp, stream, bh, b, offset,
+			length, linear, output->length);
+
 	out_buf.size = PAGE_SIZE;
 	out_buf.dst = squashfs_first_page(output);
 
@@ -138,5 +199,6 @@ const struct squashfs_decompressor squashfs_zstd_comp_ops = {
 	.decompress = zstd_uncompress,
 	.id = ZSTD_COMPRESSION,
 	.name = "zstd",
-	.supported = 1
+	.supported = 1,
+	.linear_output = 1
 };
@@ -19,6 +19,7 @@
 #include <linux/mempool.h>
 
 struct ahash_request;
+struct crypto_shash;
 
 /*
  * Implementation limit: maximum depth of the Merkle tree.  For now 8 is plenty;
@@ -35,6 +36,7 @@ struct ahash_request;
 /* A hash algorithm supported by fs-verity */
 struct fsverity_hash_alg {
 	struct crypto_ahash *tfm; /* hash tfm, allocated on demand */
+	struct crypto_shash *mb_tfm; /* same, if it can hash 2 pages at once */
 	const char *name;	  /* crypto API name, e.g. sha256 */
 	unsigned int digest_size; /* digest size in bytes, e.g. 32 for SHA-256 */
 	unsigned int block_size;  /* block size in bytes, e.g. 64 for SHA-256 */
@@ -128,6 +130,9 @@ const u8 *fsverity_prepare_hash_state(struct fsverity_hash_alg *alg,
 int fsverity_hash_page(const struct merkle_tree_params *params,
 		       const struct inode *inode,
 		       struct ahash_request *req, struct page *page, u8 *out);
+int fsverity_hash_2pages(const struct merkle_tree_params *params,
+			 const struct inode *inode, struct page *page1,
+			 struct page *page2, u8 *out1, u8 *out2);
 int fsverity_hash_buffer(struct fsverity_hash_alg *alg,
 			 const void *data, size_t size, u8 *out);
 void __init fsverity_check_hash_algs(void);
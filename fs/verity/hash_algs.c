@@ -8,6 +8,7 @@
 #include "fsverity_private.h"
 
 #include <crypto/hash.h>
+#include <linux/highmem.h>
 #include <linux/scatterlist.h>
 
 /* The hash algorithms supported by fs-verity */
@@ -43,6 +44,7 @@ struct fsverity_hash_alg *fsverity_get_hash_alg(const struct inode *inode,
 {
 	struct fsverity_hash_alg *alg;
 	struct crypto_ahash *tfm;
+	struct crypto_shash *mb_tfm;
 	int err;
 
 	if (num >= ARRAY_SIZE(fsverity_hash_algs) ||
@@ -93,8 +95,24 @@ struct fsverity_hash_alg *fsverity_get_hash_alg(const struct inode *inode,
 	if (err)
 		goto err_free_tfm;
 
-	pr_info("%s using implementation \"%s\"\n",
-		alg->name, crypto_ahash_driver_name(tfm));
+	/*
+	 * If the chosen implementation is synchronous and can also finish two
+	 * messages at once, keep a shash handle to it so that data pages can
+	 * be verified in pairs.
+	 */
+	mb_tfm = crypto_alloc_shash(alg->name, 0, 0);
+	if (!IS_ERR(mb_tfm)) {
+		if (crypto_shash_has_finup2x(mb_tfm) &&
+		    !strcmp(crypto_shash_driver_name(mb_tfm),
+			    crypto_ahash_driver_name(tfm)))
+			alg->mb_tfm = mb_tfm;
+		else
+			crypto_free_shash(mb_tfm);
+	}
+
+	pr_info("%s using implementation \"%s\"%s\n",
+		alg->name, crypto_ahash_driver_name(tfm),
+		alg->mb_tfm ? " (2-way)" : "");
 
 	/* pairs with smp_load_acquire() above */
 	smp_store_release(&alg->tfm, tfm);
@@ -266,6 +284,67 @@ int fsverity_hash_page(const struct merkle_tree_params *params,
 	return err;
 }
 
+static int fsverity_shash_init(const struct merkle_tree_params *params,
+			       struct shash_desc *desc)
+{
+	if (params->hashstate)
+		return crypto_shash_import(desc, params->hashstate);
+	return crypto_shash_init(desc);
+}
+
+/**
+ * fsverity_hash_2pages() - hash two data or hash pages at once
+ * @params: the Merkle tree's parameters
+ * @inode: inode for which the hashing is being done
+ * @page1: the first page to hash
+ * @page2: the second page to hash
+ * @out1: output digest of @page1, size 'params->digest_size' bytes
+ * @out2: output digest of @page2, size 'params->digest_size' bytes
+ *
+ * Like fsverity_hash_page(), but for two pages, letting the hash algorithm
+ * interleave the two computations.  Only valid if the hash algorithm has an
+ * ->mb_tfm.
+ *
+ * Return: 0 on success, -errno on failure
+ */
+int fsverity_hash_2pages(const struct merkle_tree_params *params,
+			 const struct inode *inode, struct page *page1,
+			 struct page *page2, u8 *out1, u8 *out2)
+{
+	struct crypto_shash *tfm = params->hash_alg->mb_tfm;
+	SHASH_DESC_ON_STACK(desc, tfm);
+	void *virt1, *virt2;
+	int err;
+
+	if (WARN_ON(params->block_size != PAGE_SIZE))
+		return -EINVAL;
+
+	desc->tfm = tfm;
+	virt1 = kmap_atomic(page1);
+	virt2 = kmap_atomic(page2);
+
+	err = fsverity_shash_init(params, desc);
+	if (!err)
+		err = crypto_shash_finup2x(desc, virt1, virt2, PAGE_SIZE,
+					   out1, out2);
+	if (err == -EOPNOTSUPP) {
+		/* e.g. SIMD isn't usable here, so hash the pages one by one */
+		err = crypto_shash_finup(desc, virt1, PAGE_SIZE, out1);
+		if (!err)
+			err = fsverity_shash_init(params, desc);
+		if (!err)
+			err = crypto_shash_finup(desc, virt2, PAGE_SIZE, out2);
+	}
+
+	kunmap_atomic(virt2);
+	kunmap_atomic(virt1);
+	shash_desc_zero(desc);
+
+	if (err)
+		fsverity_err(inode, "Error %d computing page hashes", err);
+	return err;
+}
+
 /**
  * fsverity_hash_buffer() - hash some data
  * @alg: the hash algorithm to use
@@ -67,7 +67,27 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
 }
 
 /*
- * Verify a single data page against the file's Merkle tree.
+ * The last verified leaf hash page seen while verifying a bio.  Consecutive data
+ * pages of a bio usually share the same leaf hash page, which then doesn't need
+ * to be looked up again in the pagecache for each of them.
+ */
+struct fsverity_leaf_cache {
+	pgoff_t hindex;
+	struct page *hpage;
+};
+
+static void leaf_cache_set(struct fsverity_leaf_cache *lc, pgoff_t hindex,
+			   struct page *hpage)
+{
+	if (lc->hpage)
+		put_page(lc->hpage);
+	lc->hindex = hindex;
+	lc->hpage = hpage;
+}
+
+/*
+ * Verify the hash pages on the path from a data page to the root of the file's
+ * Merkle tree, and return the hash that the data page itself must have.
  *
  * In principle, we need to verify the entire path to the root node.  However,
  * for efficiency the filesystem may cache the hash pages.  Therefore we need
@@ -81,27 +101,26 @@ static inline int cmp_hashes(const struct fsverity_info *vi,
  * Note that multiple processes may race to verify a hash page and mark it
  * Checked, but it doesn't matter; the result will be the same either way.
  *
- * Return: true if the page is valid, else false.
+ * If @lc is given, the verified leaf hash page is kept there for the next data
+ * page instead of being released.
+ *
+ * Return: 0 if the path is valid and @data_hash was filled in, else -errno.
  */
-static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
-			struct ahash_request *req, struct page *data_page,
-			unsigned long level0_ra_pages)
+static int verify_hash_path(struct inode *inode, const struct fsverity_info *vi,
+			    struct ahash_request *req, pgoff_t index,
+			    unsigned long level0_ra_pages, u8 *data_hash,
+			    struct fsverity_leaf_cache *lc)
 {
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
-	const pgoff_t index = data_page->index;
 	int level;
 	u8 _want_hash[FS_VERITY_MAX_DIGEST_SIZE];
 	const u8 *want_hash;
 	u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
 	struct page *hpages[FS_VERITY_MAX_LEVELS];
 	unsigned int hoffsets[FS_VERITY_MAX_LEVELS];
-	int err;
-
-	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
-		return false;
-
-	pr_debug_ratelimited("Verifying data page %lu...\n", index);
+	pgoff_t hindex0 = 0;
+	int err = 0;
 
 	/*
 	 * Starting at the leaf level, ascend the tree saving hash pages along
@@ -118,6 +137,15 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		pr_debug_ratelimited("Level %d: hindex=%lu, hoffset=%u\n",
 				     level, hindex, hoffset);
 
+		if (level == 0) {
+			hindex0 = hindex;
+			if (lc && lc->hpage && lc->hindex == hindex) {
+				extract_hash(lc->hpage, hoffset, hsize,
+					     data_hash);
+				return 0;
+			}
+		}
+
 		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode, hindex,
 				level == 0 ? level0_ra_pages : 0);
 		if (IS_ERR(hpage)) {
@@ -131,7 +159,10 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		if (PageChecked(hpage)) {
 			extract_hash(hpage, hoffset, hsize, _want_hash);
 			want_hash = _want_hash;
-			put_page(hpage);
+			if (level == 0 && lc)
+				leaf_cache_set(lc, hindex, hpage);
+			else
+				put_page(hpage);
 			pr_debug_ratelimited("Hash page already checked, want %s:%*phN\n",
 					     params->hash_alg->name,
 					     hsize, want_hash);
@@ -160,21 +191,76 @@ static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
 		SetPageChecked(hpage);
 		extract_hash(hpage, hoffset, hsize, _want_hash);
 		want_hash = _want_hash;
-		put_page(hpage);
+		if (level == 1 && lc)
+			leaf_cache_set(lc, hindex0, hpage);
+		else
+			put_page(hpage);
 		pr_debug("Verified hash page at level %d, now want %s:%*phN\n",
 			 level - 1, params->hash_alg->name, hsize, want_hash);
 	}
 
-	/* Finally, verify the data page */
-	err = fsverity_hash_page(params, inode, req, data_page, real_hash);
-	if (err)
-		goto out;
-	err = cmp_hashes(vi, want_hash, real_hash, index, -1);
+	memcpy(data_hash, want_hash, hsize);
 out:
 	for (; level > 0; level--)
 		put_page(hpages[level - 1]);
 
-	return err == 0;
+	return err;
+}
+
+static bool check_data_page(struct page *data_page)
+{
+	if (WARN_ON_ONCE(!PageLocked(data_page) || PageUptodate(data_page)))
+		return false;
+
+	pr_debug_ratelimited("Verifying data page %lu...\n", data_page->index);
+	return true;
+}
+
+/*
+ * Verify a single data page against the file's Merkle tree.
+ *
+ * Return: true if the page is valid, else false.
+ */
+static bool verify_page(struct inode *inode, const struct fsverity_info *vi,
+			struct ahash_request *req, struct page *data_page,
+			unsigned long level0_ra_pages,
+			struct fsverity_leaf_cache *lc)
+{
+	const struct merkle_tree_params *params = &vi->tree_params;
+	u8 want_hash[FS_VERITY_MAX_DIGEST_SIZE];
+	u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
+
+	if (!check_data_page(data_page))
+		return false;
+
+	if (verify_hash_path(inode, vi, req, data_page->index,
+			     level0_ra_pages, want_hash, lc))
+		return false;
+
+	/* Finally, verify the data page */
+	if (fsverity_hash_page(params, inode, req, data_page, real_hash))
+		return false;
+	return cmp_hashes(vi, want_hash, real_hash, data_page->index, -1) == 0;
+}
+
+/*
+ * Verify two data pages whose hash paths have already been verified, hashing
+ * them at the same time.  Pages that don't match are set to the Error state.
+ */
+static void verify_page_pair(struct inode *inode,
+			     const struct fsverity_info *vi,
+			     struct page *pages[2],
+			     u8 want_hashes[2][FS_VERITY_MAX_DIGEST_SIZE])
+{
+	u8 real_hashes[2][FS_VERITY_MAX_DIGEST_SIZE];
+	int i, err;
+
+	err = fsverity_hash_2pages(&vi->tree_params, inode, pages[0], pages[1],
+				   real_hashes[0], real_hashes[1]);
+	for (i = 0; i < 2; i++)
+		if (err || cmp_hashes(vi, want_hashes[i], real_hashes[i],
+				      pages[i]->index, -1))
+			SetPageError(pages[i]);
 }
 
 /**
@@ -195,7 +281,7 @@ bool fsverity_verify_page(struct page *page)
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(vi->tree_params.hash_alg, GFP_NOFS);
 
-	valid = verify_page(inode, vi, req, page, 0);
+	valid = verify_page(inode, vi, req, page, 0, NULL);
 
 	fsverity_free_hash_request(vi->tree_params.hash_alg, req);
 
@@ -217,6 +303,10 @@ EXPORT_SYMBOL_GPL(fsverity_verify_page);
  * populate the page cache without issuing bios (e.g. non block-based
  * filesystems) must instead call fsverity_verify_page() directly on each page.
  * All filesystems must also call fsverity_verify_page() on holes.
+ *
+ * If the hash algorithm can hash two pages at once, the data pages are hashed
+ * in pairs once their hash paths have been verified.  The leaf hash page is
+ * kept across consecutive data pages of the bio.
  */
 void fsverity_verify_bio(struct bio *bio)
 {
@@ -227,6 +317,10 @@ void fsverity_verify_bio(struct bio *bio)
 	struct bio_vec *bv;
 	struct bvec_iter_all iter_all;
 	unsigned long max_ra_pages = 0;
+	struct page *pending[2];
+	u8 want_hashes[2][FS_VERITY_MAX_DIGEST_SIZE];
+	struct fsverity_leaf_cache lc = { .hpage = NULL };
+	int npending = 0;
 
 	/* This allocation never fails, since it's mempool-backed. */
 	req = fsverity_alloc_hash_request(params->hash_alg, GFP_NOFS);
@@ -252,11 +346,42 @@ void fsverity_verify_bio(struct bio *bio)
 		unsigned long level0_ra_pages =
 			min(max_ra_pages, params->level0_blocks - level0_index);
 
-		if (!PageError(page) &&
-		    !verify_page(inode, vi, req, page, level0_ra_pages))
+		if (PageError(page))
+			continue;
+
+		if (!params->hash_alg->mb_tfm) {
+			if (!verify_page(inode, vi, req, page, level0_ra_pages,
+					 &lc))
+				SetPageError(page);
+			continue;
+		}
+
+		if (!check_data_page(page) ||
+		    verify_hash_path(inode, vi, req, page->index,
+				     level0_ra_pages, want_hashes[npending],
+				     &lc)) {
 			SetPageError(page);
+			continue;
+		}
+		pending[npending++] = page;
+		if (npending == 2) {
+			verify_page_pair(inode, vi, pending, want_hashes);
+			npending = 0;
+		}
 	}
 
+	if (npending) {
+		u8 real_hash[FS_VERITY_MAX_DIGEST_SIZE];
+		struct page *page = pending[0];
+
+		if (fsverity_hash_page(params, inode, req, page, real_hash) ||
+		    cmp_hashes(vi, want_hashes[0], real_hash, page->index, -1))
+			SetPageError(page);
+	}
+
+	if (lc.hpage)
+		put_page(lc.hpage);
+
 	fsverity_free_hash_request(params->hash_alg, req);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
@@ -165,6 +165,11 @@ struct shash_desc {
  * @update: see struct ahash_alg
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
+ * @finup2x: **[optional]** Finish two messages of the same length that share
+ *	     the state in @desc, e.g. two blocks hashed after a common salt.
+ *	     Meant for implementations that can interleave the two
+ *	     computations.  May return -EOPNOTSUPP for cases it does not
+ *	     handle, the caller then has to hash the messages separately.
  * @digest: see struct ahash_alg
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
@@ -194,6 +199,9 @@ struct shash_alg {
 	int (*final)(struct shash_desc *desc, u8 *out);
 	int (*finup)(struct shash_desc *desc, const u8 *data,
 		     unsigned int len, u8 *out);
+	int (*finup2x)(struct shash_desc *desc, const u8 *data1,
+		       const u8 *data2, unsigned int len, u8 *out1,
+		       u8 *out2);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
 	int (*export)(struct shash_desc *desc, void *out);
@@ -965,6 +973,46 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_has_finup2x() - check for two message finalization support
+ * @tfm: cipher handle
+ *
+ * Return: true if the algorithm can finish two messages in one call
+ */
+static inline bool crypto_shash_has_finup2x(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->finup2x != NULL;
+}
+
+/**
+ * crypto_shash_finup2x() - calculate message digests of two buffers
+ * @desc: operational state, shared by both messages
+ * @data1: first message
+ * @data2: second message
+ * @len: length of each message
+ * @out1: message digest of @data1
+ * @out2: message digest of @data2
+ *
+ * Equivalent to crypto_shash_finup() on two copies of @desc, but lets the
+ * implementation work on both messages at the same time.  The descriptor
+ * is consumed.
+ *
+ * Context: Any context.
+ * Return: 0 on success; -EOPNOTSUPP if the algorithm cannot handle this
+ *	   request as a pair, in which case @desc is left untouched; other
+ *	   < 0 values on error
+ */
+static inline int crypto_shash_finup2x(struct shash_desc *desc,
+				       const u8 *data1, const u8 *data2,
+				       unsigned int len, u8 *out1, u8 *out2)
+{
+	struct shash_alg *shash = crypto_shash_alg(desc->tfm);
+
+	if (!shash->finup2x)
+		return -EOPNOTSUPP;
+	return shash->finup2x(desc, data1, data2, len, out1, out2);
+}
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
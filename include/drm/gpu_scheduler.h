@@ -27,6 +27,7 @@
 #include <drm/spsc_queue.h>
 #include <linux/dma-fence.h>
 #include <linux/completion.h>
+#include <linux/mutex.h>
 
 #define MAX_WAIT_SCHED_ENTITY_Q_EMPTY msecs_to_jiffies(1000)
 
@@ -265,6 +266,13 @@ struct drm_sched_backend_ops {
  * @num_jobs: the number of jobs in queue in the scheduler
  * @ready: marks if the underlying HW is ready to work
  * @free_guilty: A hit to time out handler to free the guilty job.
+ * @direct_submit: set by the driver after drm_sched_init() to let
+ *                 drm_sched_entity_push_job() run jobs inline when the
+ *                 scheduler is idle; run_job must then be callable from the
+ *                 submitting context.
+ * @direct_blocked: inline submission is held off during GPU recovery.
+ * @run_lock: serializes job pop and run_job between the scheduler thread and
+ *            inline submission.
  *
  * One scheduler is implemented for each hardware ring.
  */
@@ -286,6 +294,9 @@ struct drm_gpu_scheduler {
 	atomic_t                        num_jobs;
 	bool			ready;
 	bool				free_guilty;
+	bool				direct_submit;
+	bool				direct_blocked;
+	struct mutex			run_lock;
 };
 
 int drm_sched_init(struct drm_gpu_scheduler *sched,
@@ -303,6 +314,7 @@ void drm_sched_entity_modify_sched(struct drm_sched_entity *entity,
 
 void drm_sched_job_cleanup(struct drm_sched_job *job);
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched);
+bool drm_sched_direct_submit(struct drm_sched_entity *entity);
 void drm_sched_stop(struct drm_gpu_scheduler *sched, struct drm_sched_job *bad);
 void drm_sched_start(struct drm_gpu_scheduler *sched, bool full_recovery);
 void drm_sched_resubmit_jobs(struct drm_gpu_scheduler *sched);
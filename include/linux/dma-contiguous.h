@@ -79,6 +79,9 @@ static inline void dma_contiguous_set_default(struct cma *cma)
 
 void dma_contiguous_reserve(phys_addr_t addr_limit);
 
+int dma_contiguous_for_each_heap_area(int (*it)(struct cma *cma, void *data),
+				      void *data);
+
 int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 				       phys_addr_t limit, struct cma **res_cma,
 				       bool fixed);
@@ -114,6 +117,7 @@ bool dma_release_from_contiguous(struct device *dev, struct page *pages,
 				 int count);
 struct page *dma_alloc_contiguous(struct device *dev, size_t size, gfp_t gfp);
 void dma_free_contiguous(struct device *dev, struct page *page, size_t size);
+int dma_contiguous_evacuate(struct device *dev, size_t size);
 
 #else
 
@@ -128,6 +132,13 @@ static inline void dma_contiguous_set_default(struct cma *cma) { }
 
 static inline void dma_contiguous_reserve(phys_addr_t limit) { }
 
+static inline
+int dma_contiguous_for_each_heap_area(int (*it)(struct cma *cma, void *data),
+				      void *data)
+{
+	return 0;
+}
+
 static inline int dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 				       phys_addr_t limit, struct cma **res_cma,
 				       bool fixed)
@@ -169,6 +180,11 @@ static inline void dma_free_contiguous(struct device *dev, struct page *page,
 	__free_pages(page, get_order(size));
 }
 
+static inline int dma_contiguous_evacuate(struct device *dev, size_t size)
+{
+	return -ENODEV;
+}
+
 #endif
 
 #endif
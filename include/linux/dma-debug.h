@@ -13,6 +13,7 @@
 struct device;
 struct scatterlist;
 struct bus_type;
+struct dma_map_cache_stats;
 
 #ifdef CONFIG_DMA_API_DEBUG
 
@@ -69,6 +70,13 @@ extern void debug_dma_dump_mappings(struct device *dev);
 
 extern void debug_dma_assert_idle(struct page *page);
 
+extern struct dma_map_cache_stats *debug_dma_map_cache_create(struct device *dev);
+
+extern void debug_dma_map_cache_destroy(struct dma_map_cache_stats *stats);
+
+extern void debug_dma_map_cache_lookup(struct dma_map_cache_stats *stats,
+				       bool hit);
+
 #else /* CONFIG_DMA_API_DEBUG */
 
 static inline void dma_debug_add_bus(struct bus_type *bus)
@@ -161,6 +169,21 @@ static inline void debug_dma_assert_idle(struct page *page)
 {
 }
 
+static inline struct dma_map_cache_stats *
+debug_dma_map_cache_create(struct device *dev)
+{
+	return NULL;
+}
+
+static inline void debug_dma_map_cache_destroy(struct dma_map_cache_stats *stats)
+{
+}
+
+static inline void debug_dma_map_cache_lookup(struct dma_map_cache_stats *stats,
+					      bool hit)
+{
+}
+
 #endif /* CONFIG_DMA_API_DEBUG */
 
 #endif /* __DMA_DEBUG_H */
@@ -32,6 +32,7 @@ struct dma_fence_array_cb {
  * @num_fences: number of fences in the array
  * @num_pending: fences in the array still pending
  * @fences: array of the fences
+ * @signal_on_any: signal when any of the fences signals instead of all
  * @work: internal irq_work function
  */
 struct dma_fence_array {
@@ -41,6 +42,7 @@ struct dma_fence_array {
 	unsigned num_fences;
 	atomic_t num_pending;
 	struct dma_fence **fences;
+	bool signal_on_any;
 
 	struct irq_work work;
 };
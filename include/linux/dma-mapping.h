@@ -255,6 +255,8 @@ static inline void dma_direct_sync_sg_for_cpu(struct device *dev,
 
 size_t dma_direct_max_mapping_size(struct device *dev);
 
+struct dma_map_cache;
+
 #ifdef CONFIG_HAS_DMA
 #include <asm/dma-mapping.h>
 
@@ -443,6 +445,18 @@ void *dma_alloc_attrs(struct device *dev, size_t size, dma_addr_t *dma_handle,
 		gfp_t flag, unsigned long attrs);
 void dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 		dma_addr_t dma_handle, unsigned long attrs);
+struct page *dma_alloc_pages(struct device *dev, size_t size,
+		dma_addr_t *dma_handle, enum dma_data_direction dir, gfp_t gfp);
+void dma_free_pages(struct device *dev, size_t size, struct page *page,
+		dma_addr_t dma_handle, enum dma_data_direction dir);
+struct dma_map_cache *dma_map_cache_create(struct device *dev,
+		unsigned int nr_entries);
+void dma_map_cache_destroy(struct dma_map_cache *cache);
+dma_addr_t dma_map_cache_map(struct dma_map_cache *cache, void *ptr,
+		size_t size, enum dma_data_direction dir);
+void dma_map_cache_unmap(struct dma_map_cache *cache, dma_addr_t addr,
+		size_t size, enum dma_data_direction dir);
+void dma_map_cache_invalidate(struct dma_map_cache *cache, void *ptr);
 void *dmam_alloc_attrs(struct device *dev, size_t size, dma_addr_t *dma_handle,
 		gfp_t gfp, unsigned long attrs);
 void dmam_free_coherent(struct device *dev, size_t size, void *vaddr,
@@ -522,6 +536,37 @@ static void dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 		dma_addr_t dma_handle, unsigned long attrs)
 {
 }
+static inline struct page *dma_alloc_pages(struct device *dev, size_t size,
+		dma_addr_t *dma_handle, enum dma_data_direction dir, gfp_t gfp)
+{
+	return NULL;
+}
+static inline void dma_free_pages(struct device *dev, size_t size,
+		struct page *page, dma_addr_t dma_handle,
+		enum dma_data_direction dir)
+{
+}
+static inline struct dma_map_cache *dma_map_cache_create(struct device *dev,
+		unsigned int nr_entries)
+{
+	return NULL;
+}
+static inline void dma_map_cache_destroy(struct dma_map_cache *cache)
+{
+}
+static inline dma_addr_t dma_map_cache_map(struct dma_map_cache *cache,
+		void *ptr, size_t size, enum dma_data_direction dir)
+{
+	return DMA_MAPPING_ERROR;
+}
+static inline void dma_map_cache_unmap(struct dma_map_cache *cache,
+		dma_addr_t addr, size_t size, enum dma_data_direction dir)
+{
+}
+static inline void dma_map_cache_invalidate(struct dma_map_cache *cache,
+		void *ptr)
+{
+}
 static inline void *dmam_alloc_attrs(struct device *dev, size_t size,
 		dma_addr_t *dma_handle, gfp_t gfp, unsigned long attrs)
 {
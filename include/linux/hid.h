@@ -456,6 +456,8 @@ struct hid_field {
 	unsigned  report_count;		/* number of this field in the report */
 	unsigned  report_type;		/* (input,output,feature) */
 	__s32    *value;		/* last known value(s) */
+	__s32    *new_value;		/* newly read value(s) */
+	unsigned  extract;		/* HID_EXTRACT_* reader for value(s) */
 	__s32     logical_minimum;
 	__s32     logical_maximum;
 	__s32     physical_minimum;
@@ -471,6 +473,16 @@ struct hid_field {
 
 #define HID_MAX_FIELDS 256
 
+/*
+ * How hid_input_field() reads the values of a field, picked once when the
+ * report descriptor is parsed.  Byte aligned 8, 16 and 32 bit fields are
+ * loaded directly instead of going through the generic bit extractor.
+ */
+#define HID_EXTRACT_GENERIC	0
+#define HID_EXTRACT_8		1
+#define HID_EXTRACT_16		2
+#define HID_EXTRACT_32		3
+
 struct hid_report {
 	struct list_head list;
 	struct list_head hidinput_list;
@@ -214,6 +214,11 @@ devm_request_any_context_irq(struct device *dev, unsigned int irq,
 
 extern void devm_free_irq(struct device *dev, unsigned int irq, void *dev_id);
 
+struct irq_affinity;
+extern int devm_irq_spread_affinity(struct device *dev, const int *irqs,
+				    unsigned int nr_irqs,
+				    struct irq_affinity *affd);
+
 /*
  * On lockdep we dont want to enable hardirqs in hardirq
  * context. Use local_irq_enable_in_hardirq() to annotate
@@ -359,6 +364,9 @@ irq_set_affinity_notifier(unsigned int irq, struct irq_affinity_notify *notify);
 struct irq_affinity_desc *
 irq_create_affinity_masks(unsigned int nvec, struct irq_affinity *affd);
 
+int irq_spread_affinity(const int *irqs, unsigned int nr_irqs,
+			struct irq_affinity *affd);
+
 unsigned int irq_calc_affinity_vectors(unsigned int minvec, unsigned int maxvec,
 				       const struct irq_affinity *affd);
 
@@ -399,6 +407,12 @@ irq_create_affinity_masks(unsigned int nvec, struct irq_affinity *affd)
 	return NULL;
 }
 
+static inline int irq_spread_affinity(const int *irqs, unsigned int nr_irqs,
+				      struct irq_affinity *affd)
+{
+	return 0;
+}
+
 static inline unsigned int
 irq_calc_affinity_vectors(unsigned int minvec, unsigned int maxvec,
 			  const struct irq_affinity *affd)
@@ -79,6 +79,26 @@ struct mmc_ios {
 
 struct mmc_host;
 
+/*
+ * Request shapes a host can transfer in place, see ->get_dma_limits().
+ * Requests that fall outside of these take the host's slow path, which
+ * is usually a copy through a bounce buffer.
+ */
+struct mmc_dma_limits {
+	unsigned int	alignment;		/* see blk_queue_dma_alignment */
+	unsigned long	seg_boundary_mask;	/* see blk_queue_segment_boundary */
+	unsigned int	max_seg_size;		/* see blk_queue_max_segment_size */
+	unsigned short	max_segs;		/* see blk_queue_max_segments */
+};
+
+/* Data paths accounted in the host's debugfs directory */
+enum mmc_xfer_path {
+	MMC_XFER_DIRECT,		/* DMA straight to/from the request */
+	MMC_XFER_PARTIAL_BOUNCE,	/* some segments copied through a buffer */
+	MMC_XFER_BOUNCE,		/* whole request copied through a buffer */
+	MMC_XFER_NR_PATHS,
+};
+
 struct mmc_host_ops {
 	/*
 	 * It is optional for the host to implement pre_req and post_req in
@@ -169,6 +189,14 @@ struct mmc_host_ops {
 	 */
 	int	(*multi_io_quirk)(struct mmc_card *card,
 				  unsigned int direction, int blk_size);
+
+	/*
+	 * Optional callback to narrow the block queue limits to the requests
+	 * the host can DMA in place. @limits is pre-filled from the host's
+	 * max_segs and max_seg_size and the block layer defaults.
+	 */
+	void	(*get_dma_limits)(struct mmc_host *host,
+				  struct mmc_dma_limits *limits);
 };
 
 struct mmc_cqe_ops {
@@ -372,6 +400,8 @@ struct mmc_host {
 #define MMC_CAP2_CQE_DCMD	(1 << 24)	/* CQE can issue a direct command */
 #define MMC_CAP2_AVOID_3_3V	(1 << 25)	/* Host must negotiate down from 3.3V */
 #define MMC_CAP2_MERGE_CAPABLE	(1 << 26)	/* Host can merge a segment over the segment size */
+#define MMC_CAP2_SG_BLOCK_ALIGN	(1 << 27)	/* Multi-block sg entries must be block sized for DMA */
+#define MMC_CAP2_PACKED_WR	(1 << 28)	/* Allow eMMC packed write commands */
 
 	int			fixed_drv_type;	/* fixed driver type for non-removable media */
 
@@ -443,6 +473,9 @@ struct mmc_host {
 	struct mmc_supply	supply;
 
 	struct dentry		*debugfs_root;
+#ifdef CONFIG_DEBUG_FS
+	u64			xfer_stats[MMC_XFER_NR_PATHS];
+#endif
 
 	/* Ongoing data transfer that allows commands during transfer */
 	struct mmc_request	*ongoing_mrq;
@@ -502,6 +535,15 @@ void mmc_command_done(struct mmc_host *host, struct mmc_request *mrq);
 
 void mmc_cqe_request_done(struct mmc_host *host, struct mmc_request *mrq);
 
+/* Account a data transfer to one of the paths shown in debugfs */
+static inline void mmc_count_xfer(struct mmc_host *host,
+				  enum mmc_xfer_path path)
+{
+#ifdef CONFIG_DEBUG_FS
+	host->xfer_stats[path]++;
+#endif
+}
+
 /*
  * May be called from host driver's system/runtime suspend/resume callbacks,
  * to know if SDIO IRQs has been claimed.
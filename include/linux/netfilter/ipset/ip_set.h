@@ -66,6 +66,7 @@ enum ip_set_extension {
 #define SET_WITH_COMMENT(s)	((s)->extensions & IPSET_EXT_COMMENT)
 #define SET_WITH_SKBINFO(s)	((s)->extensions & IPSET_EXT_SKBINFO)
 #define SET_WITH_FORCEADD(s)	((s)->flags & IPSET_CREATE_FLAG_FORCEADD)
+#define SET_WITH_LPM(s)		((s)->flags & IPSET_CREATE_FLAG_LPM)
 
 /* Extension id, in size order */
 enum ip_set_ext_id {
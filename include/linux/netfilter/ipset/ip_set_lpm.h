@@ -0,0 +1,35 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _IP_SET_LPM_H
+#define _IP_SET_LPM_H
+
+#include <linux/types.h>
+#include <linux/rcupdate.h>
+
+/* Longest prefix match trie over the network prefixes stored in a
+ * hash:net* set. It only records which prefixes are present, the
+ * elements themselves still live in the hash.
+ */
+struct ip_set_lpm_node;
+
+struct ip_set_lpm {
+	struct ip_set_lpm_node __rcu *root;
+	size_t memsize;		/* memory used by the trie nodes */
+	u8 keylen;		/* key length in bytes */
+};
+
+static inline void
+ip_set_lpm_init(struct ip_set_lpm *t, u8 keylen)
+{
+	RCU_INIT_POINTER(t->root, NULL);
+	t->memsize = 0;
+	t->keylen = keylen;
+}
+
+/* Updates must be serialized by the caller, lookups need rcu_read_lock_bh */
+extern int ip_set_lpm_add(struct ip_set_lpm *t, const void *key, u8 prefixlen);
+extern int ip_set_lpm_del(struct ip_set_lpm *t, const void *key, u8 prefixlen);
+extern int ip_set_lpm_lookup(const struct ip_set_lpm *t, const void *key,
+			     u8 *cidrs, int max);
+extern void ip_set_lpm_flush(struct ip_set_lpm *t);
+
+#endif /* _IP_SET_LPM_H */
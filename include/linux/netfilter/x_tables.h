@@ -264,6 +264,12 @@ struct xt_table_info {
 	unsigned int stacksize;
 	void ***jumpstack;
 
+	/*
+	 * Optional, per entry offsets to the next entry which can match a
+	 * packet of a given protocol, in units of the entry alignment.
+	 */
+	unsigned short *skip;
+
 	unsigned char entries[] __aligned(8);
 };
 
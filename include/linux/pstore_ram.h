@@ -27,6 +27,12 @@
  * getting wiped after its contents get copied out after boot.
  */
 #define PRZ_FLAG_ZAP_OLD	BIT(1)
+/*
+ * Skip ECC for this zone, even when the backend was configured with it.
+ * Together with PRZ_FLAG_NO_LOCK this lets persistent_ram_write_fast()
+ * store records with plain word copies for high-rate writers like ftrace.
+ */
+#define PRZ_FLAG_NO_ECC		BIT(2)
 
 struct persistent_ram_buffer;
 struct rs_control;
@@ -107,6 +113,8 @@ void persistent_ram_zap(struct persistent_ram_zone *prz);
 
 int persistent_ram_write(struct persistent_ram_zone *prz, const void *s,
 			 unsigned int count);
+int persistent_ram_write_fast(struct persistent_ram_zone *prz, const void *s,
+			      unsigned int count);
 int persistent_ram_write_user(struct persistent_ram_zone *prz,
 			      const void __user *s, unsigned int count);
 
@@ -124,6 +132,7 @@ ssize_t persistent_ram_ecc_string(struct persistent_ram_zone *prz,
  */
 
 #define RAMOOPS_FLAG_FTRACE_PER_CPU	BIT(0)
+#define RAMOOPS_FLAG_FTRACE_NO_ECC	BIT(1)
 
 struct ramoops_platform_data {
 	unsigned long	mem_size;
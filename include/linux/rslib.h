@@ -22,6 +22,9 @@
  * @alpha_to:	log lookup table
  * @index_of:	Antilog lookup table
  * @genpoly:	Generator polynomial
+ * @synmul:	Per root multiply-by-alpha^((fcr+i)*prim) tables for the
+ *		syndrome computation, [nroots][nn + 1], only for symbol
+ *		widths up to 8 bits
  * @nroots:	Number of generator roots = number of parity symbols
  * @fcr:	First consecutive root, index form
  * @prim:	Primitive element, index form
@@ -37,6 +40,7 @@ struct rs_codec {
 	uint16_t	*alpha_to;
 	uint16_t	*index_of;
 	uint16_t	*genpoly;
+	uint8_t		*synmul;
 	int		nroots;
 	int		fcr;
 	int		prim;
@@ -22,6 +22,28 @@
 
 struct device;
 struct meson_canvas;
+struct meson_canvas_pool;
+
+/**
+ * struct meson_canvas_cfg - canvas configuration
+ *
+ * @index: canvas ID that was obtained via meson_canvas_alloc()
+ * @addr: physical address to the pixel buffer
+ * @stride: width of the buffer
+ * @height: height of the buffer
+ * @wrap: undocumented
+ * @blkmode: block mode (linear, 32x32, 64x64)
+ * @endian: byte swapping (swap16, swap32, swap64, swap128)
+ */
+struct meson_canvas_cfg {
+	u8 index;
+	u32 addr;
+	u32 stride;
+	u32 height;
+	unsigned int wrap;
+	unsigned int blkmode;
+	unsigned int endian;
+};
 
 /**
  * meson_canvas_get() - get a canvas provider instance
@@ -38,6 +60,18 @@ struct meson_canvas *meson_canvas_get(struct device *dev);
  */
 int meson_canvas_alloc(struct meson_canvas *canvas, u8 *canvas_index);
 
+/**
+ * meson_canvas_alloc_n() - take ownership of several canvases
+ *
+ * Either all the canvases are allocated or none is.
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @canvas_index: array of @num entries filled with the canvas IDs
+ * @num: number of canvases to allocate
+ */
+int meson_canvas_alloc_n(struct meson_canvas *canvas, u8 *canvas_index,
+			 unsigned int num);
+
 /**
  * meson_canvas_free() - remove ownership from a canvas
  *
@@ -63,4 +97,59 @@ int meson_canvas_config(struct meson_canvas *canvas, u8 canvas_index,
 			unsigned int wrap, unsigned int blkmode,
 			unsigned int endian);
 
+/**
+ * meson_canvas_config_batch() - configure several canvases at once
+ *
+ * Nothing is written if any of the configurations is invalid.
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @cfg: array of @num canvas configurations
+ * @num: number of canvases to configure
+ */
+int meson_canvas_config_batch(struct meson_canvas *canvas,
+			      const struct meson_canvas_cfg *cfg,
+			      unsigned int num);
+
+/**
+ * meson_canvas_pool_create() - reserve canvases for a consumer
+ *
+ * The reserved canvases can't be allocated by the other consumers, which
+ * lets the owner of the pool fail early instead of running out of
+ * canvases at a later stage.
+ *
+ * @canvas: canvas provider instance retrieved from meson_canvas_get()
+ * @size: number of canvases to reserve
+ *
+ * Return: the pool, ERR_PTR(-ENOSPC) if not enough canvases are left
+ */
+struct meson_canvas_pool *meson_canvas_pool_create(struct meson_canvas *canvas,
+						   unsigned int size);
+
+/**
+ * meson_canvas_pool_destroy() - release a reservation
+ *
+ * The canvases allocated from the pool must have been freed already.
+ *
+ * @pool: pool obtained via meson_canvas_pool_create()
+ */
+void meson_canvas_pool_destroy(struct meson_canvas_pool *pool);
+
+/**
+ * meson_canvas_pool_alloc_n() - take ownership of reserved canvases
+ *
+ * @pool: pool obtained via meson_canvas_pool_create()
+ * @canvas_index: array of @num entries filled with the canvas IDs
+ * @num: number of canvases to allocate
+ */
+int meson_canvas_pool_alloc_n(struct meson_canvas_pool *pool, u8 *canvas_index,
+			      unsigned int num);
+
+/**
+ * meson_canvas_pool_free() - give a canvas back to its pool
+ *
+ * @pool: pool obtained via meson_canvas_pool_create()
+ * @canvas_index: canvas ID that was obtained via meson_canvas_pool_alloc_n()
+ */
+int meson_canvas_pool_free(struct meson_canvas_pool *pool, u8 canvas_index);
+
 #endif
@@ -128,6 +128,7 @@ struct stmmac_rxq_cfg {
 	u8 pkt_route;
 	bool use_prio;
 	u32 prio;
+	u32 napi_budget;
 };
 
 struct stmmac_txq_cfg {
@@ -141,6 +142,7 @@ struct stmmac_txq_cfg {
 	bool use_prio;
 	u32 prio;
 	int tbs_en;
+	u32 napi_budget;
 };
 
 struct plat_stmmacenet_data {
@@ -181,6 +183,9 @@ struct plat_stmmacenet_data {
 	void (*serdes_powerdown)(struct net_device *ndev, void *priv);
 	int (*init)(struct platform_device *pdev, void *priv);
 	void (*exit)(struct platform_device *pdev, void *priv);
+	int (*set_rgmii_delay)(void *priv, unsigned int step);
+	unsigned int rgmii_delay_steps;
+	unsigned int rgmii_delay_default;
 	struct mac_device_info *(*setup)(void *priv);
 	void *bsp_priv;
 	struct clk *stmmac_clk;
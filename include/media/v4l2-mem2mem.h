@@ -15,14 +15,45 @@
 
 #include <media/videobuf2-v4l2.h>
 
+/* Most buffers of each queue handed to a single &v4l2_m2m_ops->device_run_batch */
+#define V4L2_M2M_MAX_BATCH	16
+
+/**
+ * struct v4l2_m2m_batch - buffers of one batched job
+ *
+ * @num_src:	number of entries in @src
+ * @num_dst:	number of entries in @dst
+ * @src:	source buffers, in queueing order
+ * @dst:	destination buffers, in queueing order
+ *
+ * The buffers have been removed from the ready queues and belong to the
+ * driver, which has to return each of them with v4l2_m2m_buf_done(), or
+ * put it back with v4l2_m2m_buf_queue() if it was not consumed.
+ */
+struct v4l2_m2m_batch {
+	unsigned int		num_src;
+	unsigned int		num_dst;
+	struct vb2_v4l2_buffer	*src[V4L2_M2M_MAX_BATCH];
+	struct vb2_v4l2_buffer	*dst[V4L2_M2M_MAX_BATCH];
+};
+
 /**
  * struct v4l2_m2m_ops - mem-to-mem device driver callbacks
- * @device_run:	required. Begin the actual job (transaction) inside this
- *		callback.
+ * @device_run:	required unless @device_run_batch is provided. Begin the
+ *		actual job (transaction) inside this callback.
  *		The job does NOT have to end before this callback returns
  *		(and it will be the usual case). When the job finishes,
  *		v4l2_m2m_job_finish() or v4l2_m2m_buf_done_and_job_finish()
  *		has to be called.
+ * @device_run_batch: optional. Used instead of @device_run, for devices
+ *		that can consume several source and destination buffers in
+ *		one job. It is passed all the ready buffers of the context,
+ *		up to &v4l2_m2m_ctx->max_batch of each queue, and otherwise
+ *		behaves like @device_run: v4l2_m2m_job_finish() has to be
+ *		called when the job ends. Buffers of the batch still owned
+ *		by the driver when streaming stops have to be returned from
+ *		&vb2_ops->stop_streaming. Not compatible with
+ *		%V4L2_BUF_CAP_SUPPORTS_M2M_HOLD_CAPTURE_BUF.
  * @job_ready:	optional. Should return 0 if the driver does not have a job
  *		fully prepared to run yet (i.e. it will not be able to finish a
  *		transaction without sleeping). If not provided, it will be
@@ -41,6 +72,7 @@
  */
 struct v4l2_m2m_ops {
 	void (*device_run)(void *priv);
+	void (*device_run_batch)(void *priv, struct v4l2_m2m_batch *batch);
 	int (*job_ready)(void *priv);
 	void (*job_abort)(void *priv);
 };
@@ -84,6 +116,9 @@ struct v4l2_m2m_queue_ctx {
  * @last_src_buf: indicate the last source buffer for draining
  * @next_buf_last: next capture queud buffer will be tagged as last
  * @has_stopped: indicate the device has been stopped
+ * @max_batch: maximum number of buffers of each queue passed to
+ *		&v4l2_m2m_ops->device_run_batch, at most %V4L2_M2M_MAX_BATCH.
+ *		Set to 1 by v4l2_m2m_ctx_init(), drivers may raise it.
  * @m2m_dev: opaque pointer to the internal data to handle M2M context
  * @cap_q_ctx: Capture (output to memory) queue context
  * @out_q_ctx: Output (input from memory) queue context
@@ -91,6 +126,7 @@ struct v4l2_m2m_queue_ctx {
  * @job_flags: Job queue flags, used internally by v4l2-mem2mem.c:
  *		%TRANS_QUEUED, %TRANS_RUNNING and %TRANS_ABORT.
  * @finished: Wait queue used to signalize when a job queue finished.
+ * @batch: buffers of the running batched job
  * @priv: Instance private data
  *
  * The memory to memory context is specific to a file handle, NOT to e.g.
@@ -107,6 +143,8 @@ struct v4l2_m2m_ctx {
 	bool				next_buf_last;
 	bool				has_stopped;
 
+	unsigned int			max_batch;
+
 	/* internal use only */
 	struct v4l2_m2m_dev		*m2m_dev;
 
@@ -119,6 +157,8 @@ struct v4l2_m2m_ctx {
 	unsigned long			job_flags;
 	wait_queue_head_t		finished;
 
+	struct v4l2_m2m_batch		batch;
+
 	void				*priv;
 };
 
@@ -45,6 +45,7 @@ enum vb2_memory {
 
 struct vb2_fileio_data;
 struct vb2_threadio_data;
+struct vb2_buf_pool;
 
 /**
  * struct vb2_mem_ops - memory handling/memory allocator operations.
@@ -263,6 +264,10 @@ struct vb2_buffer {
 	 *			after the 'buf_finish' op is called.
 	 * copied_timestamp:	the timestamp of this capture buffer was copied
 	 *			from an output buffer.
+	 * skip_cache_sync_on_prepare: skip the 'prepare' memop, i.e. the cache
+	 *			clean before the buffer is handed to the device.
+	 * skip_cache_sync_on_finish: skip the 'finish' memop, i.e. the cache
+	 *			invalidation when the device is done with it.
 	 * queued_entry:	entry on the queued buffers list, which holds
 	 *			all buffers queued from userspace
 	 * done_entry:		entry on the list that stores all buffers ready
@@ -273,6 +278,8 @@ struct vb2_buffer {
 	unsigned int		synced:1;
 	unsigned int		prepared:1;
 	unsigned int		copied_timestamp:1;
+	unsigned int		skip_cache_sync_on_prepare:1;
+	unsigned int		skip_cache_sync_on_finish:1;
 
 	struct vb2_plane	planes[VB2_MAX_PLANES];
 	struct list_head	queued_entry;
@@ -476,6 +483,14 @@ struct vb2_buf_ops {
  *		not bidirectional but the hardware (firmware) trying to access
  *		the buffer (in the opposite direction) this could lead to an
  *		IOMMU protection faults.
+ * @non_coherent_mem: when set, MMAP buffers are allocated as cacheable
+ *		memory by allocators that support it, with the cache
+ *		maintenance done in the 'prepare' and 'finish' memops.  Speeds
+ *		up CPU accesses to the buffers on non-coherent platforms.
+ * @allow_cache_hints: when set, userspace may skip the cache maintenance for
+ *		a buffer with %V4L2_BUF_FLAG_NO_CACHE_CLEAN and
+ *		%V4L2_BUF_FLAG_NO_CACHE_INVALIDATE, e.g. if the CPU never
+ *		touches its contents.
  * @fileio_read_once:		report EOF after reading the first buffer
  * @fileio_write_immediately:	queue buffer after each write() call
  * @allow_zero_bytesused:	allow bytesused == 0 to be passed to the driver
@@ -523,6 +538,10 @@ struct vb2_buf_ops {
  *		@start_streaming can be called. Used when a DMA engine
  *		cannot be started unless at least this number of buffers
  *		have been queued into the driver.
+ * @buf_pool:	optional pool created with vb2_buf_pool_create(), keeping
+ *		the memory of freed MMAP buffers for reuse by later
+ *		allocations of the same size. May be shared by the queues of
+ *		a device, and must outlive them.
  */
 /*
  * Private elements (won't appear at the uAPI book):
@@ -559,6 +578,8 @@ struct vb2_queue {
 	struct device			*dev;
 	unsigned long			dma_attrs;
 	unsigned			bidirectional:1;
+	unsigned			non_coherent_mem:1;
+	unsigned			allow_cache_hints:1;
 	unsigned			fileio_read_once:1;
 	unsigned			fileio_write_immediately:1;
 	unsigned			allow_zero_bytesused:1;
@@ -581,6 +602,7 @@ struct vb2_queue {
 	u32				timestamp_flags;
 	gfp_t				gfp_flags;
 	u32				min_buffers_needed;
+	struct vb2_buf_pool		*buf_pool;
 
 	struct device			*alloc_devs[VB2_MAX_PLANES];
 
@@ -913,6 +935,30 @@ int vb2_core_expbuf(struct vb2_queue *q, int *fd, unsigned int type,
  */
 int vb2_core_queue_init(struct vb2_queue *q);
 
+/**
+ * vb2_buf_pool_create() - create a pool of reusable buffer memory
+ * @max_bytes:	the most memory the pool keeps around
+ *
+ * Reallocating large buffers on each stream restart is expensive, in
+ * particular from CMA. A queue with &vb2_queue->buf_pool set hands the memory
+ * of its freed MMAP buffers to the pool instead, as long as they are not
+ * mapped or exported any more, and takes it back for a new buffer with the
+ * same allocation parameters. The memory is cleared before it is reused. The
+ * least recently freed memory is released when the pool grows past
+ * @max_bytes, or under memory pressure.
+ *
+ * Return: the pool, or an ERR_PTR() on failure.
+ */
+struct vb2_buf_pool *vb2_buf_pool_create(unsigned long max_bytes);
+
+/**
+ * vb2_buf_pool_destroy() - free a pool and all the memory it holds
+ * @pool:	pool created with vb2_buf_pool_create(), may be NULL
+ *
+ * No queue may use @pool any more when this is called.
+ */
+void vb2_buf_pool_destroy(struct vb2_buf_pool *pool);
+
 /**
  * vb2_core_queue_release() - stop streaming, release the queue and free memory
  * @q:		pointer to &struct vb2_queue with videobuf2 queue.
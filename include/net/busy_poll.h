@@ -128,12 +128,20 @@ static inline void sk_mark_napi_id(struct sock *sk, const struct sk_buff *skb)
 }
 
 /* variant used for unconnected sockets */
+static inline void __sk_mark_napi_id_once(struct sock *sk,
+					  unsigned int napi_id)
+{
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	if (!READ_ONCE(sk->sk_napi_id))
+		WRITE_ONCE(sk->sk_napi_id, napi_id);
+#endif
+}
+
 static inline void sk_mark_napi_id_once(struct sock *sk,
 					const struct sk_buff *skb)
 {
 #ifdef CONFIG_NET_RX_BUSY_POLL
-	if (!READ_ONCE(sk->sk_napi_id))
-		WRITE_ONCE(sk->sk_napi_id, skb->napi_id);
+	__sk_mark_napi_id_once(sk, skb->napi_id);
 #endif
 }
 
@@ -107,6 +107,9 @@ struct xdp_sock {
 	/* Protects generic receive. */
 	spinlock_t rx_lock;
 	u64 rx_dropped;
+	/* Busy poll loops run from syscalls, and how many found rx work */
+	u64 busy_poll;
+	u64 busy_poll_hits;
 	struct list_head map_list;
 	/* Protects map_list */
 	spinlock_t map_list_lock;
@@ -61,6 +61,69 @@ TRACE_EVENT(cma_release,
 		  __entry->count)
 );
 
+TRACE_EVENT(cma_alloc_latency,
+
+	TP_PROTO(const char *name, const struct page *page,
+		 unsigned int count, u64 latency_ns, unsigned long migrated),
+
+	TP_ARGS(name, page, count, latency_ns, migrated),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(const struct page *, page)
+		__field(unsigned int, count)
+		__field(u64, latency_ns)
+		__field(unsigned long, migrated)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->page = page;
+		__entry->count = count;
+		__entry->latency_ns = latency_ns;
+		__entry->migrated = migrated;
+	),
+
+	TP_printk("name=%s page=%p count=%u latency_ns=%llu migrated=%lu",
+		  __get_str(name),
+		  __entry->page,
+		  __entry->count,
+		  __entry->latency_ns,
+		  __entry->migrated)
+);
+
+TRACE_EVENT(cma_evacuate,
+
+	TP_PROTO(const char *name, unsigned long requested,
+		 unsigned long evacuated, u64 latency_ns,
+		 unsigned long migrated),
+
+	TP_ARGS(name, requested, evacuated, latency_ns, migrated),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned long, requested)
+		__field(unsigned long, evacuated)
+		__field(u64, latency_ns)
+		__field(unsigned long, migrated)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, name);
+		__entry->requested = requested;
+		__entry->evacuated = evacuated;
+		__entry->latency_ns = latency_ns;
+		__entry->migrated = migrated;
+	),
+
+	TP_printk("name=%s requested=%lu evacuated=%lu latency_ns=%llu migrated=%lu",
+		  __get_str(name),
+		  __entry->requested,
+		  __entry->evacuated,
+		  __entry->latency_ns,
+		  __entry->migrated)
+);
+
 #endif /* _TRACE_CMA_H */
 
 /* This part must be outside protection */
@@ -125,6 +125,39 @@ struct drm_lima_gem_submit {
 	__u32 in_sync[2];  /* in, drm_syncobj handle used to wait before start this task */
 };
 
+#define LIMA_SUBMIT_BATCH_MAX_TASKS 32
+
+/**
+ * one task of a batched submit
+ *
+ * Tasks of a batch on the same pipe run in array order. A task on the
+ * other pipe is only ordered after the tasks set in its deps mask, implicit
+ * sync being done against work submitted before the batch.
+ */
+struct drm_lima_gem_submit_task {
+	__u32 pipe;        /* in, which pipe to use, GP/PP */
+	__u32 nr_bos;      /* in, array length of bos field */
+	__u32 frame_size;  /* in, size of frame field */
+	__u32 flags;       /* in, submit flags */
+	__u64 bos;         /* in, array of drm_lima_gem_submit_bo */
+	__u64 frame;       /* in, GP/PP frame */
+	__u32 out_sync;    /* in, drm_syncobj handle used to wait task finish after submission */
+	__u32 in_sync[2];  /* in, drm_syncobj handle used to wait before start this task */
+	__u32 deps;        /* in, bitmask of earlier tasks in the batch to wait for */
+};
+
+/**
+ * submit several tasks to GPU in one call
+ *
+ * The buffers of all tasks are locked once and either all tasks are
+ * queued or none of them.
+ */
+struct drm_lima_gem_submit_batch {
+	__u32 ctx;         /* in, context handle tasks are submitted to */
+	__u32 nr_tasks;    /* in, array length of tasks field, at most LIMA_SUBMIT_BATCH_MAX_TASKS */
+	__u64 tasks;       /* in, array of drm_lima_gem_submit_task */
+};
+
 #define LIMA_GEM_WAIT_READ   0x01
 #define LIMA_GEM_WAIT_WRITE  0x02
 
@@ -153,6 +186,47 @@ struct drm_lima_ctx_free {
 	__u32 _pad;        /* pad, must be zero */
 };
 
+#define LIMA_MADV_WILLNEED 0
+#define LIMA_MADV_DONTNEED 1
+
+/**
+ * mark a buffer purgeable or not
+ *
+ * Purgeable buffers may have their pages released under memory
+ * pressure, retained tells if the contents are still valid when
+ * the buffer is marked needed again.
+ */
+struct drm_lima_gem_madvise {
+	__u32 handle;      /* in, GEM buffer handle */
+	__u32 madv;        /* in, LIMA_MADV_* */
+	__u32 retained;    /* out, whether backing store still exists */
+	__u32 pad;         /* pad, must be zero */
+};
+
+#define LIMA_PERFCNT_NUM     2   /* counters per GP or PP core */
+#define LIMA_PERFCNT_MAX_PP  8
+
+/**
+ * start or stop sampling the GP/PP performance counters
+ *
+ * Only one client can use the counters at a time. While enabled, the
+ * counters are sampled for each task submitted by this client.
+ */
+struct drm_lima_perfcnt_enable {
+	__u32 enable;                      /* in, 1 to start, 0 to stop */
+	__u32 gp_src[LIMA_PERFCNT_NUM];    /* in, GP counter event sources */
+	__u32 pp_src[LIMA_PERFCNT_NUM];    /* in, PP counter event sources */
+	__u32 _pad;                        /* pad, must be zero */
+};
+
+/**
+ * read the counter values accumulated since the last enable or dump
+ */
+struct drm_lima_perfcnt_dump {
+	__u64 gp[LIMA_PERFCNT_NUM];                      /* out, GP counters */
+	__u64 pp[LIMA_PERFCNT_MAX_PP][LIMA_PERFCNT_NUM]; /* out, per PP core counters */
+};
+
 #define DRM_LIMA_GET_PARAM   0x00
 #define DRM_LIMA_GEM_CREATE  0x01
 #define DRM_LIMA_GEM_INFO    0x02
@@ -160,6 +234,10 @@ struct drm_lima_ctx_free {
 #define DRM_LIMA_GEM_WAIT    0x04
 #define DRM_LIMA_CTX_CREATE  0x05
 #define DRM_LIMA_CTX_FREE    0x06
+#define DRM_LIMA_GEM_MADVISE 0x07
+#define DRM_LIMA_PERFCNT_ENABLE 0x08
+#define DRM_LIMA_PERFCNT_DUMP   0x09
+#define DRM_LIMA_GEM_SUBMIT_BATCH 0x0a
 
 #define DRM_IOCTL_LIMA_GET_PARAM DRM_IOWR(DRM_COMMAND_BASE + DRM_LIMA_GET_PARAM, struct drm_lima_get_param)
 #define DRM_IOCTL_LIMA_GEM_CREATE DRM_IOWR(DRM_COMMAND_BASE + DRM_LIMA_GEM_CREATE, struct drm_lima_gem_create)
@@ -168,6 +246,10 @@ struct drm_lima_ctx_free {
 #define DRM_IOCTL_LIMA_GEM_WAIT DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_GEM_WAIT, struct drm_lima_gem_wait)
 #define DRM_IOCTL_LIMA_CTX_CREATE DRM_IOR(DRM_COMMAND_BASE + DRM_LIMA_CTX_CREATE, struct drm_lima_ctx_create)
 #define DRM_IOCTL_LIMA_CTX_FREE DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_CTX_FREE, struct drm_lima_ctx_free)
+#define DRM_IOCTL_LIMA_GEM_MADVISE DRM_IOWR(DRM_COMMAND_BASE + DRM_LIMA_GEM_MADVISE, struct drm_lima_gem_madvise)
+#define DRM_IOCTL_LIMA_PERFCNT_ENABLE DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_PERFCNT_ENABLE, struct drm_lima_perfcnt_enable)
+#define DRM_IOCTL_LIMA_PERFCNT_DUMP DRM_IOR(DRM_COMMAND_BASE + DRM_LIMA_PERFCNT_DUMP, struct drm_lima_perfcnt_dump)
+#define DRM_IOCTL_LIMA_GEM_SUBMIT_BATCH DRM_IOW(DRM_COMMAND_BASE + DRM_LIMA_GEM_SUBMIT_BATCH, struct drm_lima_gem_submit_batch)
 
 #if defined(__cplusplus)
 }
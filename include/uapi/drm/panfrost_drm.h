@@ -21,6 +21,8 @@ extern "C" {
 #define DRM_PANFROST_PERFCNT_ENABLE		0x06
 #define DRM_PANFROST_PERFCNT_DUMP		0x07
 #define DRM_PANFROST_MADVISE			0x08
+#define DRM_PANFROST_SET_PRIORITY		0x09
+#define DRM_PANFROST_PERFCNT_STREAM		0x0a
 
 #define DRM_IOCTL_PANFROST_SUBMIT		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_SUBMIT, struct drm_panfrost_submit)
 #define DRM_IOCTL_PANFROST_WAIT_BO		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_WAIT_BO, struct drm_panfrost_wait_bo)
@@ -29,6 +31,7 @@ extern "C" {
 #define DRM_IOCTL_PANFROST_GET_PARAM		DRM_IOWR(DRM_COMMAND_BASE + DRM_PANFROST_GET_PARAM, struct drm_panfrost_get_param)
 #define DRM_IOCTL_PANFROST_GET_BO_OFFSET	DRM_IOWR(DRM_COMMAND_BASE + DRM_PANFROST_GET_BO_OFFSET, struct drm_panfrost_get_bo_offset)
 #define DRM_IOCTL_PANFROST_MADVISE		DRM_IOWR(DRM_COMMAND_BASE + DRM_PANFROST_MADVISE, struct drm_panfrost_madvise)
+#define DRM_IOCTL_PANFROST_SET_PRIORITY		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_SET_PRIORITY, struct drm_panfrost_set_priority)
 
 /*
  * Unstable ioctl(s): only exposed when the unsafe unstable_ioctls module
@@ -38,6 +41,7 @@ extern "C" {
  */
 #define DRM_IOCTL_PANFROST_PERFCNT_ENABLE	DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_ENABLE, struct drm_panfrost_perfcnt_enable)
 #define DRM_IOCTL_PANFROST_PERFCNT_DUMP		DRM_IOW(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_DUMP, struct drm_panfrost_perfcnt_dump)
+#define DRM_IOCTL_PANFROST_PERFCNT_STREAM	DRM_IOWR(DRM_COMMAND_BASE + DRM_PANFROST_PERFCNT_STREAM, struct drm_panfrost_perfcnt_stream)
 
 #define PANFROST_JD_REQ_FS (1 << 0)
 /**
@@ -203,6 +207,28 @@ struct drm_panfrost_perfcnt_dump {
 	__u64 buf_ptr;
 };
 
+/* Starts periodic sampling of the counters enabled with PERFCNT_ENABLE.
+ * The GPU dumps the counters every period_ms into a ring of buffers, which
+ * is drained by read()ing the returned fd. poll() reports POLLIN when at
+ * least one sample is available and POLLHUP once perfcnt got disabled.
+ * Closing the fd stops the sampling; PERFCNT_DUMP returns -EBUSY meanwhile.
+ */
+struct drm_panfrost_perfcnt_stream {
+	__u32 period_ms;      /* in, sampling period, 1 to 10000 */
+	__u32 flags;          /* in, must be zero */
+	__s32 fd;             /* out, fd to read samples from */
+	__u32 pad;            /* pad, must be zero */
+};
+
+/* Each read() returns one or more whole samples, each made of this header
+ * followed by 'size' bytes laid out like a PERFCNT_DUMP buffer.
+ */
+struct drm_panfrost_perfcnt_sample {
+	__u64 timestamp;      /* CLOCK_MONOTONIC time of the dump, in ns */
+	__u32 size;           /* size of the counter dump following the header */
+	__u32 lost;           /* samples dropped since the previous one */
+};
+
 /* madvise provides a way to tell the kernel in case a buffers contents
  * can be discarded under memory pressure, which is useful for userspace
  * bo cache where we want to optimistically hold on to buffer allocate
@@ -223,6 +249,19 @@ struct drm_panfrost_madvise {
 	__u32 retained;       /* out, whether backing store still exists */
 };
 
+/* Scheduling priority of the jobs submitted through a DRM fd. Jobs from
+ * higher priority fds are picked first by the job slot schedulers.
+ * PANFROST_PRIORITY_HIGH requires CAP_SYS_NICE or DRM master.
+ */
+#define PANFROST_PRIORITY_LOW		0
+#define PANFROST_PRIORITY_NORMAL	1	/* default */
+#define PANFROST_PRIORITY_HIGH		2
+
+struct drm_panfrost_set_priority {
+	__u32 priority;       /* in, PANFROST_PRIORITY_x */
+	__u32 pad;            /* pad, must be zero */
+};
+
 #if defined(__cplusplus)
 }
 #endif
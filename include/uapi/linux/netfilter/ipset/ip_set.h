@@ -207,6 +207,8 @@ enum ipset_cadt_flags {
 	IPSET_FLAG_WITH_SKBINFO = (1 << IPSET_FLAG_BIT_WITH_SKBINFO),
 	IPSET_FLAG_BIT_IFACE_WILDCARD = 7,
 	IPSET_FLAG_IFACE_WILDCARD = (1 << IPSET_FLAG_BIT_IFACE_WILDCARD),
+	IPSET_FLAG_BIT_WITH_LPM = 8,
+	IPSET_FLAG_WITH_LPM = (1 << IPSET_FLAG_BIT_WITH_LPM),
 	IPSET_FLAG_CADT_MAX	= 15,
 };
 
@@ -214,6 +216,8 @@ enum ipset_cadt_flags {
 enum ipset_create_flags {
 	IPSET_CREATE_FLAG_BIT_FORCEADD = 0,
 	IPSET_CREATE_FLAG_FORCEADD = (1 << IPSET_CREATE_FLAG_BIT_FORCEADD),
+	IPSET_CREATE_FLAG_BIT_LPM = 1,
+	IPSET_CREATE_FLAG_LPM = (1 << IPSET_CREATE_FLAG_BIT_LPM),
 	IPSET_CREATE_FLAG_BIT_MAX = 7,
 };
 
@@ -339,6 +339,9 @@ enum
 	LINUX_MIB_TLSRXDEVICE,			/* TlsRxDevice */
 	LINUX_MIB_TLSDECRYPTERROR,		/* TlsDecryptError */
 	LINUX_MIB_TLSRXDEVICERESYNC,		/* TlsRxDeviceResync */
+	LINUX_MIB_TLSRXDECRYPTZC,		/* TlsRxDecryptZc */
+	LINUX_MIB_TLSRXDECRYPTCOPY,		/* TlsRxDecryptCopy */
+	LINUX_MIB_TLSRXDECRYPTRETRY,		/* TlsRxDecryptRetry */
 	__LINUX_MIB_TLSMAX
 };
 
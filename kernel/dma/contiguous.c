@@ -23,6 +23,13 @@
 #include <linux/sizes.h>
 #include <linux/dma-contiguous.h>
 #include <linux/cma.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
+#include <linux/slab.h>
+#include <linux/vmstat.h>
+#include <linux/workqueue.h>
+
+#include <trace/events/cma.h>
 
 #ifdef CONFIG_CMA_SIZE_MBYTES
 #define CMA_SIZE_MBYTES CONFIG_CMA_SIZE_MBYTES
@@ -32,6 +39,31 @@
 
 struct cma *dma_contiguous_default_area;
 
+/* Areas marked "linux,dma-heap" in DT, to be exported as dma-buf heaps */
+static struct cma *dma_contiguous_heap_areas[MAX_CMA_AREAS];
+static unsigned int dma_contiguous_heap_areas_count;
+
+/**
+ * dma_contiguous_for_each_heap_area() - iterate over the CMA areas that
+ *					  should get a dma-buf heap
+ * @it:   Callback, iteration stops at the first non-zero return value.
+ * @data: Argument passed to @it.
+ */
+int dma_contiguous_for_each_heap_area(int (*it)(struct cma *cma, void *data),
+				      void *data)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < dma_contiguous_heap_areas_count; i++) {
+		ret = it(dma_contiguous_heap_areas[i], data);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 /*
  * Default global CMA area size can be defined in kernel's .config.
  * This is useful mainly for distro maintainers to create a kernel
@@ -178,6 +210,42 @@ int __init dma_contiguous_reserve_area(phys_addr_t size, phys_addr_t base,
 	return 0;
 }
 
+/*
+ * Pages migrated system wide so far, to tell how much of the time spent in
+ * cma_alloc() went into moving pages out of the way.
+ */
+static unsigned long dma_contiguous_migrated(void)
+{
+	unsigned long sum = 0;
+#if defined(CONFIG_MIGRATION) && defined(CONFIG_VM_EVENT_COUNTERS)
+	int cpu;
+
+	for_each_online_cpu(cpu)
+		sum += per_cpu(vm_event_states, cpu).event[PGMIGRATE_SUCCESS];
+#endif
+	return sum;
+}
+
+static struct page *dma_contiguous_cma_alloc(struct cma *cma, size_t count,
+					     unsigned int align, bool no_warn)
+{
+	unsigned long migrated;
+	struct page *page;
+	u64 start;
+
+	if (!trace_cma_alloc_latency_enabled())
+		return cma_alloc(cma, count, align, no_warn);
+
+	migrated = dma_contiguous_migrated();
+	start = ktime_get_ns();
+	page = cma_alloc(cma, count, align, no_warn);
+	trace_cma_alloc_latency(cma_get_name(cma), page, count,
+				ktime_get_ns() - start,
+				dma_contiguous_migrated() - migrated);
+
+	return page;
+}
+
 /**
  * dma_alloc_from_contiguous() - allocate pages from contiguous area
  * @dev:   Pointer to device for which the allocation is performed.
@@ -196,7 +264,8 @@ struct page *dma_alloc_from_contiguous(struct device *dev, size_t count,
 	if (align > CONFIG_CMA_ALIGNMENT)
 		align = CONFIG_CMA_ALIGNMENT;
 
-	return cma_alloc(dev_get_cma_area(dev), count, align, no_warn);
+	return dma_contiguous_cma_alloc(dev_get_cma_area(dev), count, align,
+					no_warn);
 }
 
 /**
@@ -245,7 +314,8 @@ struct page *dma_alloc_contiguous(struct device *dev, size_t size, gfp_t gfp)
 		size_t align = get_order(size);
 		size_t cma_align = min_t(size_t, align, CONFIG_CMA_ALIGNMENT);
 
-		page = cma_alloc(cma, count, cma_align, gfp & __GFP_NOWARN);
+		page = dma_contiguous_cma_alloc(cma, count, cma_align,
+						gfp & __GFP_NOWARN);
 	}
 
 	return page;
@@ -269,6 +339,131 @@ void dma_free_contiguous(struct device *dev, struct page *page, size_t size)
 		__free_pages(page, get_order(size));
 }
 
+/*
+ * Background evacuation
+ *
+ * cma_alloc() has to migrate whatever movable pages occupy the range it
+ * picks, which can stall a large allocation for a long time.  When one is
+ * known to be coming, part of the area can be cleared out ahead of time by
+ * allocating it from a worker, which moves the current users elsewhere, and
+ * releasing it again.  Nothing stops movable pages from coming back
+ * afterwards, so this only pays off if the real allocation follows soon.
+ */
+#define DMA_CONTIGUOUS_EVACUATE_CHUNK	(SZ_4M >> PAGE_SHIFT)
+
+struct dma_contiguous_evacuation {
+	struct work_struct work;
+	struct cma *cma;
+	size_t count;
+};
+
+static atomic_t dma_contiguous_evacuating = ATOMIC_INIT(0);
+
+static void dma_contiguous_evacuate_work(struct work_struct *work)
+{
+	struct dma_contiguous_evacuation *ev =
+		container_of(work, struct dma_contiguous_evacuation, work);
+	size_t nr_chunks = DIV_ROUND_UP(ev->count,
+					DMA_CONTIGUOUS_EVACUATE_CHUNK);
+	unsigned long migrated = dma_contiguous_migrated();
+	u64 start = ktime_get_ns();
+	size_t i, n = 0, done = 0;
+	struct page **chunks;
+
+	chunks = kcalloc(nr_chunks, sizeof(*chunks), GFP_KERNEL);
+	if (!chunks)
+		goto out;
+
+	/* hold on to each chunk so that the next one lands elsewhere */
+	for (n = 0; n < nr_chunks; n++) {
+		size_t count = min_t(size_t, ev->count - done,
+				     DMA_CONTIGUOUS_EVACUATE_CHUNK);
+
+		chunks[n] = cma_alloc(ev->cma, count, 0, true);
+		if (!chunks[n])
+			break;
+		done += count;
+	}
+
+	for (i = 0; i < n; i++)
+		cma_release(ev->cma, chunks[i],
+			    min_t(size_t, done - i * DMA_CONTIGUOUS_EVACUATE_CHUNK,
+				  DMA_CONTIGUOUS_EVACUATE_CHUNK));
+	kfree(chunks);
+
+out:
+	trace_cma_evacuate(cma_get_name(ev->cma), ev->count, done,
+			   ktime_get_ns() - start,
+			   dma_contiguous_migrated() - migrated);
+	kfree(ev);
+	atomic_set(&dma_contiguous_evacuating, 0);
+}
+
+static int dma_contiguous_evacuate_area(struct cma *cma, size_t size)
+{
+	struct dma_contiguous_evacuation *ev;
+
+	if (!cma)
+		return -ENODEV;
+
+	size = min_t(size_t, size, cma_get_size(cma));
+	if (size < PAGE_SIZE)
+		return 0;
+
+	/* one at a time, evacuating in parallel would only compete */
+	if (atomic_xchg(&dma_contiguous_evacuating, 1))
+		return -EBUSY;
+
+	ev = kmalloc(sizeof(*ev), GFP_KERNEL);
+	if (!ev) {
+		atomic_set(&dma_contiguous_evacuating, 0);
+		return -ENOMEM;
+	}
+
+	INIT_WORK(&ev->work, dma_contiguous_evacuate_work);
+	ev->cma = cma;
+	ev->count = size >> PAGE_SHIFT;
+	queue_work(system_unbound_wq, &ev->work);
+
+	return 0;
+}
+
+/**
+ * dma_contiguous_evacuate() - clear out part of a device's CMA area
+ * @dev:  Pointer to device for which a large allocation is expected.
+ * @size: Amount of memory to clear out, in bytes.
+ *
+ * Migrates movable pages out of up to @size bytes of the contiguous area of
+ * @dev in the background, so that an allocation shortly afterwards doesn't
+ * have to.  Drivers call this when they can tell that large buffers will be
+ * needed soon, e.g. when a video device is opened.  Returns -EBUSY if an
+ * evacuation is already running.
+ */
+int dma_contiguous_evacuate(struct device *dev, size_t size)
+{
+	return dma_contiguous_evacuate_area(dev_get_cma_area(dev), size);
+}
+EXPORT_SYMBOL_GPL(dma_contiguous_evacuate);
+
+static int dma_contiguous_evacuate_set(const char *val,
+				       const struct kernel_param *kp)
+{
+	char *end;
+	unsigned long long size = memparse(val, &end);
+
+	if (end == val)
+		return -EINVAL;
+
+	return dma_contiguous_evacuate_area(dma_contiguous_default_area, size);
+}
+
+static const struct kernel_param_ops dma_contiguous_evacuate_ops = {
+	.set = dma_contiguous_evacuate_set,
+};
+module_param_cb(evacuate, &dma_contiguous_evacuate_ops, NULL, 0200);
+MODULE_PARM_DESC(evacuate,
+		 "Write a size to clear that much of the default CMA area out in the background");
+
 /*
  * Support for reserved memory regions defined in device tree
  */
@@ -331,6 +526,11 @@ static int __init rmem_cma_setup(struct reserved_mem *rmem)
 
 	if (default_cma)
 		dma_contiguous_set_default(cma);
+	else if (of_get_flat_dt_prop(node, "linux,dma-heap", NULL) &&
+		 dma_contiguous_heap_areas_count <
+		 ARRAY_SIZE(dma_contiguous_heap_areas))
+		dma_contiguous_heap_areas[dma_contiguous_heap_areas_count++] =
+			cma;
 
 	rmem->ops = &rmem_cma_ops;
 	rmem->priv = cma;
@@ -844,6 +844,68 @@ static int dump_show(struct seq_file *seq, void *v)
 }
 DEFINE_SHOW_ATTRIBUTE(dump);
 
+/*
+ * Hit statistics of the persistent mapping caches, see dma_map_cache_create()
+ */
+struct dma_map_cache_stats {
+	struct list_head	list;
+	struct device		*dev;
+	atomic_long_t		hits;
+	atomic_long_t		misses;
+};
+
+static LIST_HEAD(map_cache_stats);
+static DEFINE_SPINLOCK(map_cache_stats_lock);
+
+struct dma_map_cache_stats *debug_dma_map_cache_create(struct device *dev)
+{
+	struct dma_map_cache_stats *stats;
+
+	stats = kzalloc(sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return NULL;
+
+	stats->dev = dev;
+	spin_lock(&map_cache_stats_lock);
+	list_add_tail(&stats->list, &map_cache_stats);
+	spin_unlock(&map_cache_stats_lock);
+	return stats;
+}
+
+void debug_dma_map_cache_destroy(struct dma_map_cache_stats *stats)
+{
+	if (!stats)
+		return;
+
+	spin_lock(&map_cache_stats_lock);
+	list_del(&stats->list);
+	spin_unlock(&map_cache_stats_lock);
+	kfree(stats);
+}
+
+void debug_dma_map_cache_lookup(struct dma_map_cache_stats *stats, bool hit)
+{
+	if (!stats)
+		return;
+
+	atomic_long_inc(hit ? &stats->hits : &stats->misses);
+}
+
+static int map_cache_show(struct seq_file *seq, void *v)
+{
+	struct dma_map_cache_stats *stats;
+
+	spin_lock(&map_cache_stats_lock);
+	list_for_each_entry(stats, &map_cache_stats, list)
+		seq_printf(seq, "%s %s hits %ld misses %ld\n",
+			   dev_name(stats->dev), dev_driver_string(stats->dev),
+			   atomic_long_read(&stats->hits),
+			   atomic_long_read(&stats->misses));
+	spin_unlock(&map_cache_stats_lock);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(map_cache);
+
 static void dma_debug_fs_init(void)
 {
 	struct dentry *dentry = debugfs_create_dir("dma-api", NULL);
@@ -857,6 +919,7 @@ static void dma_debug_fs_init(void)
 	debugfs_create_u32("nr_total_entries", 0444, dentry, &nr_total_entries);
 	debugfs_create_file("driver_filter", 0644, dentry, NULL, &filter_fops);
 	debugfs_create_file("dump", 0444, dentry, NULL, &dump_fops);
+	debugfs_create_file("map_cache", 0444, dentry, NULL, &map_cache_fops);
 }
 
 static int device_dma_allocations(struct device *dev, struct dma_debug_entry **out_entry)
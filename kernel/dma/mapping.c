@@ -7,6 +7,7 @@
  */
 #include <linux/memblock.h> /* for max_pfn */
 #include <linux/acpi.h>
+#include <linux/dma-contiguous.h>
 #include <linux/dma-direct.h>
 #include <linux/dma-noncoherent.h>
 #include <linux/export.h>
@@ -316,6 +317,281 @@ void dma_free_attrs(struct device *dev, size_t size, void *cpu_addr,
 }
 EXPORT_SYMBOL(dma_free_attrs);
 
+/**
+ * dma_alloc_pages - allocate cacheable memory for streaming DMA
+ * @dev: device the memory is for
+ * @size: size of the allocation
+ * @dma_handle: returns the device address of the memory
+ * @dir: direction the device will use the memory in
+ * @gfp: allocation flags
+ *
+ * Like dma_alloc_attrs() this returns memory that is contiguous and
+ * addressable by @dev, but the memory is not made coherent: the CPU accesses
+ * it through the normal cacheable kernel mapping, and ownership has to be
+ * passed back and forth with dma_sync_single_for_device() and
+ * dma_sync_single_for_cpu() as for a streaming mapping.  The memory is zeroed
+ * and owned by the device on return.
+ *
+ * Only implemented for direct mapping; otherwise NULL is returned and the
+ * caller is expected to fall back to dma_alloc_attrs().
+ */
+struct page *dma_alloc_pages(struct device *dev, size_t size,
+		dma_addr_t *dma_handle, enum dma_data_direction dir, gfp_t gfp)
+{
+	const struct dma_map_ops *ops = get_dma_ops(dev);
+	struct page *page;
+
+	if (WARN_ON_ONCE(!dev->coherent_dma_mask))
+		return NULL;
+	if (!dma_is_direct(ops) || force_dma_unencrypted(dev))
+		return NULL;
+
+	/* let the implementation decide on the zone to allocate from: */
+	gfp &= ~(__GFP_DMA | __GFP_DMA32 | __GFP_HIGHMEM);
+
+	page = __dma_direct_alloc_pages(dev, size, gfp, 0);
+	if (!page)
+		return NULL;
+	if (PageHighMem(page)) {
+		dma_free_contiguous(dev, page, size);
+		return NULL;
+	}
+
+	memset(page_address(page), 0, size);
+	*dma_handle = phys_to_dma(dev, page_to_phys(page));
+	dma_sync_single_for_device(dev, *dma_handle, size, dir);
+	return page;
+}
+EXPORT_SYMBOL_GPL(dma_alloc_pages);
+
+/**
+ * dma_free_pages - free memory allocated with dma_alloc_pages()
+ * @dev: device the memory was allocated for
+ * @size: size of the allocation
+ * @page: the memory returned by dma_alloc_pages()
+ * @dma_handle: the device address returned by dma_alloc_pages()
+ * @dir: direction passed to dma_alloc_pages()
+ */
+void dma_free_pages(struct device *dev, size_t size, struct page *page,
+		dma_addr_t dma_handle, enum dma_data_direction dir)
+{
+	dma_free_contiguous(dev, page, size);
+}
+EXPORT_SYMBOL_GPL(dma_free_pages);
+
+/*
+ * Persistent streaming mappings
+ */
+struct dma_map_cache_entry {
+	void			*ptr;
+	size_t			size;
+	enum dma_data_direction	dir;
+	dma_addr_t		addr;
+	unsigned int		users;
+	unsigned long		last_used;
+};
+
+struct dma_map_cache {
+	struct device		*dev;
+	spinlock_t		lock;
+	unsigned long		clock;
+	struct dma_map_cache_stats *stats;
+	unsigned int		nr_entries;
+	struct dma_map_cache_entry entries[];
+};
+
+/**
+ * dma_map_cache_create - create a cache of streaming mappings for a device
+ * @dev: device the buffers are mapped for
+ * @nr_entries: number of mappings kept alive
+ *
+ * Drivers that hand the same buffers to the device over and over again can
+ * map them through the cache with dma_map_cache_map() instead of
+ * dma_map_single().  The mapping of a buffer is kept when it is "unmapped"
+ * with dma_map_cache_unmap(), and mapping it again only hands ownership back
+ * to the device, which skips the translation setup and any IOMMU work.
+ *
+ * The least recently used idle mapping is released when a new buffer needs
+ * an entry.  A buffer must be dropped with dma_map_cache_invalidate() before
+ * it is freed.
+ */
+struct dma_map_cache *dma_map_cache_create(struct device *dev,
+		unsigned int nr_entries)
+{
+	struct dma_map_cache *cache;
+
+	cache = kzalloc(struct_size(cache, entries, nr_entries), GFP_KERNEL);
+	if (!cache)
+		return NULL;
+
+	cache->dev = dev;
+	spin_lock_init(&cache->lock);
+	cache->nr_entries = nr_entries;
+	cache->stats = debug_dma_map_cache_create(dev);
+	return cache;
+}
+EXPORT_SYMBOL_GPL(dma_map_cache_create);
+
+static void dma_map_cache_release(struct dma_map_cache *cache,
+		struct dma_map_cache_entry *e)
+{
+	WARN_ON(e->users);
+	dma_unmap_single(cache->dev, e->addr, e->size, e->dir);
+	e->ptr = NULL;
+}
+
+/**
+ * dma_map_cache_destroy - release all mappings of a cache and free it
+ * @cache: cache returned by dma_map_cache_create(), or NULL
+ */
+void dma_map_cache_destroy(struct dma_map_cache *cache)
+{
+	unsigned int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < cache->nr_entries; i++)
+		if (cache->entries[i].ptr)
+			dma_map_cache_release(cache, &cache->entries[i]);
+
+	debug_dma_map_cache_destroy(cache->stats);
+	kfree(cache);
+}
+EXPORT_SYMBOL_GPL(dma_map_cache_destroy);
+
+/**
+ * dma_map_cache_map - map a buffer, reusing a cached mapping if possible
+ * @cache: the mapping cache
+ * @ptr: the buffer, as for dma_map_single()
+ * @size: length to map
+ * @dir: direction of the transfer
+ *
+ * Returns the device address of the buffer, or an address for which
+ * dma_mapping_error() is true.  Every successful call must be paired with a
+ * dma_map_cache_unmap() once the device is done with the buffer.
+ */
+dma_addr_t dma_map_cache_map(struct dma_map_cache *cache, void *ptr,
+		size_t size, enum dma_data_direction dir)
+{
+	struct dma_map_cache_entry *e, *victim = NULL, old = { };
+	unsigned long flags;
+	dma_addr_t addr;
+	unsigned int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < cache->nr_entries; i++) {
+		e = &cache->entries[i];
+		if (e->ptr == ptr && e->dir == dir && size <= e->size) {
+			e->users++;
+			e->last_used = ++cache->clock;
+			addr = e->addr;
+			spin_unlock_irqrestore(&cache->lock, flags);
+
+			debug_dma_map_cache_lookup(cache->stats, true);
+			dma_sync_single_for_device(cache->dev, addr, size, dir);
+			return addr;
+		}
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	debug_dma_map_cache_lookup(cache->stats, false);
+	addr = dma_map_single(cache->dev, ptr, size, dir);
+	if (dma_mapping_error(cache->dev, addr))
+		return addr;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < cache->nr_entries; i++) {
+		e = &cache->entries[i];
+		if (e->users)
+			continue;
+		if (!victim || !e->ptr ||
+		    (victim->ptr && e->last_used < victim->last_used))
+			victim = e;
+		if (!e->ptr)
+			break;
+	}
+	if (victim) {
+		old = *victim;
+		victim->ptr = ptr;
+		victim->size = size;
+		victim->dir = dir;
+		victim->addr = addr;
+		victim->users = 1;
+		victim->last_used = ++cache->clock;
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	/* all entries in use: the mapping goes away again when unmapped */
+	if (old.ptr)
+		dma_unmap_single(cache->dev, old.addr, old.size, old.dir);
+	return addr;
+}
+EXPORT_SYMBOL_GPL(dma_map_cache_map);
+
+/**
+ * dma_map_cache_unmap - give a buffer mapped with dma_map_cache_map() back
+ * @cache: the mapping cache
+ * @addr: the address returned by dma_map_cache_map()
+ * @size: length passed to dma_map_cache_map()
+ * @dir: direction passed to dma_map_cache_map()
+ *
+ * The CPU owns the buffer again on return, but its mapping stays cached.
+ */
+void dma_map_cache_unmap(struct dma_map_cache *cache, dma_addr_t addr,
+		size_t size, enum dma_data_direction dir)
+{
+	struct dma_map_cache_entry *e;
+	unsigned long flags;
+	unsigned int i;
+
+	spin_lock_irqsave(&cache->lock, flags);
+	for (i = 0; i < cache->nr_entries; i++) {
+		e = &cache->entries[i];
+		if (e->ptr && e->users && e->addr == addr && e->dir == dir) {
+			e->users--;
+			spin_unlock_irqrestore(&cache->lock, flags);
+
+			dma_sync_single_for_cpu(cache->dev, addr, size, dir);
+			return;
+		}
+	}
+	spin_unlock_irqrestore(&cache->lock, flags);
+
+	dma_unmap_single(cache->dev, addr, size, dir);
+}
+EXPORT_SYMBOL_GPL(dma_map_cache_unmap);
+
+/**
+ * dma_map_cache_invalidate - drop the cached mappings of a buffer
+ * @cache: the mapping cache
+ * @ptr: the buffer, which must not be mapped through the cache at the moment
+ *
+ * Must be called before a buffer that went through the cache is freed.
+ */
+void dma_map_cache_invalidate(struct dma_map_cache *cache, void *ptr)
+{
+	struct dma_map_cache_entry *e, old;
+	unsigned long flags;
+	unsigned int i;
+
+	for (i = 0; i < cache->nr_entries; i++) {
+		e = &cache->entries[i];
+
+		spin_lock_irqsave(&cache->lock, flags);
+		if (e->ptr != ptr || WARN_ON(e->users)) {
+			spin_unlock_irqrestore(&cache->lock, flags);
+			continue;
+		}
+		old = *e;
+		e->ptr = NULL;
+		spin_unlock_irqrestore(&cache->lock, flags);
+
+		dma_unmap_single(cache->dev, old.addr, old.size, old.dir);
+	}
+}
+EXPORT_SYMBOL_GPL(dma_map_cache_invalidate);
+
 int dma_supported(struct device *dev, u64 mask)
 {
 	const struct dma_map_ops *ops = get_dma_ops(dev);
@@ -77,17 +77,34 @@ phys_addr_t io_tlb_start, io_tlb_end;
  */
 static unsigned long io_tlb_nslabs;
 
-/*
- * The number of used IO TLB block
- */
-static unsigned long io_tlb_used;
-
 /*
  * This is a free list describing the number of free entries available from
  * each index
  */
 static unsigned int *io_tlb_list;
-static unsigned int io_tlb_index;
+
+/*
+ * The slots are split into areas, each with its own lock and allocation
+ * cursor, so that CPUs bouncing at the same time don't all serialize on one
+ * lock.  A CPU allocates from its own area first and only moves on to the
+ * others when that one is full.  Areas are made of whole segments, the last
+ * one takes the slots left over.
+ */
+#define IO_TLB_MAX_AREAS 32
+
+struct io_tlb_area {
+	spinlock_t lock;
+	unsigned int index;
+	unsigned long used;
+} ____cacheline_aligned_in_smp;
+
+static struct io_tlb_area io_tlb_areas[IO_TLB_MAX_AREAS];
+static unsigned int io_tlb_nareas = 1;
+static unsigned long io_tlb_area_nslabs;
+
+/* statistics, summed up for debugfs */
+static DEFINE_PER_CPU(unsigned long, io_tlb_bounced_bytes);
+static DEFINE_PER_CPU(unsigned long, io_tlb_contended);
 
 /*
  * Max segment that we can provide which (if pages are contingous) will
@@ -102,11 +119,6 @@ unsigned int max_segment;
 #define INVALID_PHYS_ADDR (~(phys_addr_t)0)
 static phys_addr_t *io_tlb_orig_addr;
 
-/*
- * Protect the above data structures in the map and unmap calls
- */
-static DEFINE_SPINLOCK(io_tlb_lock);
-
 static int late_alloc;
 
 static int __init
@@ -172,10 +184,64 @@ void swiotlb_print_info(void)
 		return;
 	}
 
-	pr_info("mapped [mem %#010llx-%#010llx] (%luMB)\n",
+	pr_info("mapped [mem %#010llx-%#010llx] (%luMB, %u areas)\n",
 	       (unsigned long long)io_tlb_start,
 	       (unsigned long long)io_tlb_end,
-	       bytes >> 20);
+	       bytes >> 20, io_tlb_nareas);
+}
+
+static void swiotlb_init_areas(void)
+{
+	unsigned int i, nareas;
+
+	nareas = min_t(unsigned int, roundup_pow_of_two(num_possible_cpus()),
+		       IO_TLB_MAX_AREAS);
+	while (nareas > 1 && io_tlb_nslabs / nareas < IO_TLB_SEGSIZE)
+		nareas >>= 1;
+
+	io_tlb_nareas = nareas;
+	io_tlb_area_nslabs = rounddown(io_tlb_nslabs / nareas, IO_TLB_SEGSIZE);
+	for (i = 0; i < nareas; i++) {
+		spin_lock_init(&io_tlb_areas[i].lock);
+		io_tlb_areas[i].index = i * io_tlb_area_nslabs;
+		io_tlb_areas[i].used = 0;
+	}
+}
+
+static inline unsigned int swiotlb_area_start(unsigned int area)
+{
+	return area * io_tlb_area_nslabs;
+}
+
+static inline unsigned int swiotlb_area_end(unsigned int area)
+{
+	return area == io_tlb_nareas - 1 ? io_tlb_nslabs :
+		(area + 1) * io_tlb_area_nslabs;
+}
+
+static inline unsigned int swiotlb_slot_area(unsigned int index)
+{
+	return min_t(unsigned int, index / io_tlb_area_nslabs,
+		     io_tlb_nareas - 1);
+}
+
+static unsigned long swiotlb_used(void)
+{
+	unsigned long used = 0;
+	unsigned int i;
+
+	for (i = 0; i < io_tlb_nareas; i++)
+		used += READ_ONCE(io_tlb_areas[i].used);
+	return used;
+}
+
+static void swiotlb_lock_area(struct io_tlb_area *area, unsigned long *flags)
+{
+	if (spin_trylock_irqsave(&area->lock, *flags))
+		return;
+
+	this_cpu_inc(io_tlb_contended);
+	spin_lock_irqsave(&area->lock, *flags);
 }
 
 /*
@@ -230,7 +296,7 @@ int __init swiotlb_init_with_tbl(char *tlb, unsigned long nslabs, int verbose)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 
 	if (verbose)
 		swiotlb_print_info();
@@ -361,7 +427,7 @@ swiotlb_late_init_with_tbl(char *tlb, unsigned long nslabs)
 		io_tlb_list[i] = IO_TLB_SEGSIZE - OFFSET(i, IO_TLB_SEGSIZE);
 		io_tlb_orig_addr[i] = INVALID_PHYS_ADDR;
 	}
-	io_tlb_index = 0;
+	swiotlb_init_areas();
 
 	swiotlb_print_info();
 
@@ -412,6 +478,8 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	unsigned long pfn = PFN_DOWN(orig_addr);
 	unsigned char *vaddr = phys_to_virt(tlb_addr);
 
+	this_cpu_add(io_tlb_bounced_bytes, size);
+
 	if (PageHighMem(pfn_to_page(pfn))) {
 		/* The buffer does not have a mapping.  Map it in and copy */
 		unsigned int offset = orig_addr & ~PAGE_MASK;
@@ -443,6 +511,73 @@ static void swiotlb_bounce(phys_addr_t orig_addr, phys_addr_t tlb_addr,
 	}
 }
 
+/*
+ * Find and claim nslots free slots in the given area, or return -1.
+ */
+static int swiotlb_area_find_slots(unsigned int area_index,
+				   unsigned long offset_slots,
+				   unsigned long max_slots,
+				   unsigned int nslots, unsigned int stride)
+{
+	struct io_tlb_area *area = io_tlb_areas + area_index;
+	unsigned int start = swiotlb_area_start(area_index);
+	unsigned int end = swiotlb_area_end(area_index);
+	unsigned int index, wrap;
+	unsigned long flags;
+	int i, count;
+
+	swiotlb_lock_area(area, &flags);
+
+	if (unlikely(nslots > end - start - area->used))
+		goto not_found;
+
+	index = ALIGN(area->index, stride);
+	if (index >= end)
+		index = start;
+	wrap = index;
+
+	do {
+		while (iommu_is_span_boundary(index, nslots, offset_slots,
+					      max_slots)) {
+			index += stride;
+			if (index >= end)
+				index = start;
+			if (index == wrap)
+				goto not_found;
+		}
+
+		/*
+		 * If we find a slot that indicates we have 'nslots' number of
+		 * contiguous buffers, we allocate the buffers from that slot
+		 * and mark the entries as '0' indicating unavailable.
+		 */
+		if (io_tlb_list[index] >= nslots) {
+			count = 0;
+			for (i = index; i < (int) (index + nslots); i++)
+				io_tlb_list[i] = 0;
+			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
+				io_tlb_list[i] = ++count;
+
+			/*
+			 * Update the indices to avoid searching in the next
+			 * round.
+			 */
+			area->index = index + nslots < end ? index + nslots :
+				      start;
+			area->used += nslots;
+			spin_unlock_irqrestore(&area->lock, flags);
+			return index;
+		}
+		index += stride;
+		if (index >= end)
+			index = start;
+	} while (index != wrap);
+
+not_found:
+	spin_unlock_irqrestore(&area->lock, flags);
+	return -1;
+}
+
 phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   dma_addr_t tbl_dma_addr,
 				   phys_addr_t orig_addr,
@@ -451,14 +586,12 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 				   enum dma_data_direction dir,
 				   unsigned long attrs)
 {
-	unsigned long flags;
 	phys_addr_t tlb_addr;
-	unsigned int nslots, stride, index, wrap;
-	int i;
+	unsigned int nslots, stride, start_area, area;
+	int i, index;
 	unsigned long mask;
 	unsigned long offset_slots;
 	unsigned long max_slots;
-	unsigned long tmp_io_tlb_used;
 
 	if (no_iotlb_memory)
 		panic("Can not allocate SWIOTLB buffer earlier and can't now provide you with the DMA bounce buffer");
@@ -499,67 +632,25 @@ phys_addr_t swiotlb_tbl_map_single(struct device *hwdev,
 
 	/*
 	 * Find suitable number of IO TLB entries size that will fit this
-	 * request and allocate a buffer from that IO TLB pool.
+	 * request and allocate a buffer from that IO TLB pool, starting with
+	 * the area of the current CPU.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
-
-	if (unlikely(nslots > io_tlb_nslabs - io_tlb_used))
-		goto not_found;
-
-	index = ALIGN(io_tlb_index, stride);
-	if (index >= io_tlb_nslabs)
-		index = 0;
-	wrap = index;
-
+	start_area = area = raw_smp_processor_id() & (io_tlb_nareas - 1);
 	do {
-		while (iommu_is_span_boundary(index, nslots, offset_slots,
-					      max_slots)) {
-			index += stride;
-			if (index >= io_tlb_nslabs)
-				index = 0;
-			if (index == wrap)
-				goto not_found;
-		}
-
-		/*
-		 * If we find a slot that indicates we have 'nslots' number of
-		 * contiguous buffers, we allocate the buffers from that slot
-		 * and mark the entries as '0' indicating unavailable.
-		 */
-		if (io_tlb_list[index] >= nslots) {
-			int count = 0;
-
-			for (i = index; i < (int) (index + nslots); i++)
-				io_tlb_list[i] = 0;
-			for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE - 1) && io_tlb_list[i]; i--)
-				io_tlb_list[i] = ++count;
-			tlb_addr = io_tlb_start + (index << IO_TLB_SHIFT);
-
-			/*
-			 * Update the indices to avoid searching in the next
-			 * round.
-			 */
-			io_tlb_index = ((index + nslots) < io_tlb_nslabs
-					? (index + nslots) : 0);
-
+		index = swiotlb_area_find_slots(area, offset_slots, max_slots,
+						nslots, stride);
+		if (index >= 0)
 			goto found;
-		}
-		index += stride;
-		if (index >= io_tlb_nslabs)
-			index = 0;
-	} while (index != wrap);
+		if (++area == io_tlb_nareas)
+			area = 0;
+	} while (area != start_area);
 
-not_found:
-	tmp_io_tlb_used = io_tlb_used;
-
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
 	if (!(attrs & DMA_ATTR_NO_WARN) && printk_ratelimit())
 		dev_warn(hwdev, "swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
-			 alloc_size, io_tlb_nslabs, tmp_io_tlb_used);
+			 alloc_size, io_tlb_nslabs, swiotlb_used());
 	return (phys_addr_t)DMA_MAPPING_ERROR;
 found:
-	io_tlb_used += nslots;
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	tlb_addr = io_tlb_start + ((phys_addr_t)index << IO_TLB_SHIFT);
 
 	/*
 	 * Save away the mapping from the original address to the DMA address.
@@ -586,6 +677,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	int i, count, nslots = ALIGN(alloc_size, 1 << IO_TLB_SHIFT) >> IO_TLB_SHIFT;
 	int index = (tlb_addr - io_tlb_start) >> IO_TLB_SHIFT;
 	phys_addr_t orig_addr = io_tlb_orig_addr[index];
+	struct io_tlb_area *area = io_tlb_areas + swiotlb_slot_area(index);
 
 	/*
 	 * First, sync the memory before unmapping the entry
@@ -601,7 +693,7 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 	 * While returning the entries to the free list, we merge the entries
 	 * with slots below and above the pool being returned.
 	 */
-	spin_lock_irqsave(&io_tlb_lock, flags);
+	swiotlb_lock_area(area, &flags);
 	{
 		count = ((index + nslots) < ALIGN(index + 1, IO_TLB_SEGSIZE) ?
 			 io_tlb_list[index + nslots] : 0);
@@ -620,9 +712,9 @@ void swiotlb_tbl_unmap_single(struct device *hwdev, phys_addr_t tlb_addr,
 		for (i = index - 1; (OFFSET(i, IO_TLB_SEGSIZE) != IO_TLB_SEGSIZE -1) && io_tlb_list[i]; i--)
 			io_tlb_list[i] = ++count;
 
-		io_tlb_used -= nslots;
+		area->used -= nslots;
 	}
-	spin_unlock_irqrestore(&io_tlb_lock, flags);
+	spin_unlock_irqrestore(&area->lock, flags);
 }
 
 void swiotlb_tbl_sync_single(struct device *hwdev, phys_addr_t tlb_addr,
@@ -707,13 +799,39 @@ bool is_swiotlb_active(void)
 
 #ifdef CONFIG_DEBUG_FS
 
+static int io_tlb_used_get(void *data, u64 *val)
+{
+	*val = swiotlb_used();
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
+
+static int io_tlb_percpu_get(void *data, u64 *val)
+{
+	unsigned long __percpu *counter = data;
+	int cpu;
+
+	*val = 0;
+	for_each_possible_cpu(cpu)
+		*val += *per_cpu_ptr(counter, cpu);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_percpu, io_tlb_percpu_get, NULL, "%llu\n");
+
 static int __init swiotlb_create_debugfs(void)
 {
 	struct dentry *root;
 
 	root = debugfs_create_dir("swiotlb", NULL);
 	debugfs_create_ulong("io_tlb_nslabs", 0400, root, &io_tlb_nslabs);
-	debugfs_create_ulong("io_tlb_used", 0400, root, &io_tlb_used);
+	debugfs_create_file("io_tlb_used", 0400, root, NULL, &fops_io_tlb_used);
+	debugfs_create_u32("io_tlb_nareas", 0400, root, &io_tlb_nareas);
+	debugfs_create_file("bounced_bytes", 0400, root,
+			    (void __force *)&io_tlb_bounced_bytes,
+			    &fops_io_tlb_percpu);
+	debugfs_create_file("lock_contended", 0400, root,
+			    (void __force *)&io_tlb_contended,
+			    &fops_io_tlb_percpu);
 	return 0;
 }
 
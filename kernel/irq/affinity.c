@@ -487,6 +487,56 @@ irq_create_affinity_masks(unsigned int nvecs, struct irq_affinity *affd)
 	return masks;
 }
 
+/**
+ * irq_spread_affinity - Spread already requested interrupts over the CPUs
+ * @irqs:	The interrupts, e.g. one per queue of a platform device
+ * @nr_irqs:	The number of entries in @irqs
+ * @affd:	Description of the affinity requirements, NULL for a plain
+ *		spread of all of them
+ *
+ * Interrupts of platform devices are allocated when the device is created,
+ * long before the driver knows how they relate to each other, so they can't
+ * become managed the way PCI MSI vectors do.  This computes the same spread
+ * as irq_create_affinity_masks() and applies it as affinity and affinity
+ * hint instead.  Pre and post vectors are left alone.  The hints must be
+ * cleared with irq_set_affinity_hint(irq, NULL) before the interrupts are
+ * freed.
+ */
+int irq_spread_affinity(const int *irqs, unsigned int nr_irqs,
+			struct irq_affinity *affd)
+{
+	struct irq_affinity plain = { };
+	struct irq_affinity_desc *masks;
+	unsigned int i;
+	int ret = 0;
+
+	if (!affd)
+		affd = &plain;
+
+	if (nr_irqs <= affd->pre_vectors + affd->post_vectors)
+		return 0;
+
+	masks = irq_create_affinity_masks(nr_irqs, affd);
+	if (!masks)
+		return -ENOMEM;
+
+	for (i = 0; i < nr_irqs; i++) {
+		if (!masks[i].is_managed)
+			continue;
+
+		ret = irq_set_affinity_hint(irqs[i], &masks[i].mask);
+		if (ret) {
+			while (i--)
+				irq_set_affinity_hint(irqs[i], NULL);
+			break;
+		}
+	}
+
+	kfree(masks);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(irq_spread_affinity);
+
 /**
  * irq_calc_affinity_vectors - Calculate the optimal number of vectors
  * @minvec:	The minimum number of vectors available
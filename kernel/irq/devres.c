@@ -146,6 +146,56 @@ void devm_free_irq(struct device *dev, unsigned int irq, void *dev_id)
 }
 EXPORT_SYMBOL(devm_free_irq);
 
+struct irq_spread_devres {
+	unsigned int nr_irqs;
+	int irqs[];
+};
+
+static void devm_irq_spread_release(struct device *dev, void *res)
+{
+	struct irq_spread_devres *this = res;
+	unsigned int i;
+
+	for (i = 0; i < this->nr_irqs; i++)
+		irq_set_affinity_hint(this->irqs[i], NULL);
+}
+
+/**
+ *	devm_irq_spread_affinity - spread the interrupts of a managed device
+ *	@dev: device the interrupts belong to
+ *	@irqs: the interrupts, as returned by platform_get_irq()
+ *	@nr_irqs: number of entries in @irqs
+ *	@affd: affinity requirements, NULL for a plain spread
+ *
+ *	Like irq_spread_affinity(), but the affinity hints are cleared again
+ *	on driver detach.  Call it after the interrupts have been requested
+ *	with devm_request_irq(), so that the hints go away before the
+ *	interrupts are freed.
+ */
+int devm_irq_spread_affinity(struct device *dev, const int *irqs,
+			     unsigned int nr_irqs, struct irq_affinity *affd)
+{
+	struct irq_spread_devres *dr;
+	int rc;
+
+	dr = devres_alloc(devm_irq_spread_release,
+			  struct_size(dr, irqs, nr_irqs), GFP_KERNEL);
+	if (!dr)
+		return -ENOMEM;
+
+	rc = irq_spread_affinity(irqs, nr_irqs, affd);
+	if (rc) {
+		devres_free(dr);
+		return rc;
+	}
+
+	dr->nr_irqs = nr_irqs;
+	memcpy(dr->irqs, irqs, nr_irqs * sizeof(*irqs));
+	devres_add(dev, dr);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(devm_irq_spread_affinity);
+
 struct irq_desc_devres {
 	unsigned int from;
 	unsigned int cnt;
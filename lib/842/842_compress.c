@@ -136,8 +136,13 @@ struct sw842_param {
 	 ? find_index(p, b, n)			\
 	 : (p)->index##b[n] >= 0)
 
+/* a node already holding the same data is left in place, it still
+ * describes its fifo slot and sits in the right bucket
+ */
 #define replace_hash(p, b, i, d)	do {				\
 	struct sw842_hlist_node##b *_n = &(p)->node##b[(i)+(d)];	\
+	if (_n->data == (p)->data##b[d] && hash_hashed(&_n->node))	\
+		break;							\
 	hash_del(&_n->node);						\
 	_n->data = (p)->data##b[d];					\
 	pr_debug("add hash index%x %x pos %x data %lx\n", b,		\
@@ -405,15 +410,20 @@ static bool check_template(struct sw842_param *p, u8 c)
 	return true;
 }
 
+/* the 4 and 2 byte fields are big-endian slices of the 8 byte one,
+ * so a single load is enough
+ */
 static void get_next_data(struct sw842_param *p)
 {
-	p->data8[0] = get_input_data(p, 0, 64);
-	p->data4[0] = get_input_data(p, 0, 32);
-	p->data4[1] = get_input_data(p, 4, 32);
-	p->data2[0] = get_input_data(p, 0, 16);
-	p->data2[1] = get_input_data(p, 2, 16);
-	p->data2[2] = get_input_data(p, 4, 16);
-	p->data2[3] = get_input_data(p, 6, 16);
+	u64 d = get_input_data(p, 0, 64);
+
+	p->data8[0] = d;
+	p->data4[0] = d >> 32;
+	p->data4[1] = d;
+	p->data2[0] = d >> 48;
+	p->data2[1] = d >> 32;
+	p->data2[2] = d >> 16;
+	p->data2[3] = d;
 }
 
 /* update the hashtable entries.
@@ -482,6 +492,7 @@ int sw842_compress(const u8 *in, unsigned int ilen,
 	u64 last, next, pad, total;
 	u8 repeat_count = 0;
 	u32 crc;
+	u64 start = sw842_time_start();
 
 	BUILD_BUG_ON(sizeof(*p) > SW842_MEM_COMPRESS);
 
@@ -605,6 +616,8 @@ int sw842_compress(const u8 *in, unsigned int ilen,
 
 	*olen = total - p->olen;
 
+	sw842_time_end(start, ilen);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(sw842_compress);
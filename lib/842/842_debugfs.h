@@ -4,6 +4,7 @@
 #define __842_DEBUGFS_H__
 
 #include <linux/debugfs.h>
+#include <linux/timekeeping.h>
 
 static bool sw842_template_counts;
 module_param_named(template_counts, sw842_template_counts, bool, 0444);
@@ -11,8 +12,39 @@ module_param_named(template_counts, sw842_template_counts, bool, 0444);
 static atomic_t template_count[OPS_MAX], template_repeat_count,
 	template_zeros_count, template_short_data_count, template_end_count;
 
+/* time spent in successful calls, and the uncompressed bytes they handled */
+static atomic64_t sw842_time_ns, sw842_bytes;
+
 static struct dentry *sw842_debugfs_root;
 
+static inline u64 sw842_time_start(void)
+{
+	return sw842_template_counts ? ktime_get_ns() : 0;
+}
+
+static inline void sw842_time_end(u64 start, unsigned int bytes)
+{
+	if (!sw842_template_counts)
+		return;
+
+	atomic64_add(ktime_get_ns() - start, &sw842_time_ns);
+	atomic64_add(bytes, &sw842_bytes);
+}
+
+static int sw842_atomic64_get(void *data, u64 *val)
+{
+	*val = atomic64_read((atomic64_t *)data);
+	return 0;
+}
+
+static int sw842_atomic64_set(void *data, u64 val)
+{
+	atomic64_set((atomic64_t *)data, val);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(sw842_atomic64_fops, sw842_atomic64_get,
+			 sw842_atomic64_set, "%llu\n");
+
 static int __init sw842_debugfs_create(void)
 {
 	umode_t m = S_IRUGO | S_IWUSR;
@@ -38,6 +70,10 @@ static int __init sw842_debugfs_create(void)
 				&template_short_data_count);
 	debugfs_create_atomic_t("template_end", m, sw842_debugfs_root,
 				&template_end_count);
+	debugfs_create_file_unsafe("time_ns", m, sw842_debugfs_root,
+				   &sw842_time_ns, &sw842_atomic64_fops);
+	debugfs_create_file_unsafe("bytes", m, sw842_debugfs_root,
+				   &sw842_bytes, &sw842_atomic64_fops);
 
 	return 0;
 }
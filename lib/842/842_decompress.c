@@ -281,6 +281,7 @@ int sw842_decompress(const u8 *in, unsigned int ilen,
 	int ret;
 	u64 op, rep, tmp, bytes, total;
 	u64 crc;
+	u64 start = sw842_time_start();
 
 	p.in = (u8 *)in;
 	p.bit = 0;
@@ -392,6 +393,8 @@ int sw842_decompress(const u8 *in, unsigned int ilen,
 
 	*olen = total - p.olen;
 
+	sw842_time_end(start, *olen);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(sw842_decompress);
@@ -170,6 +170,32 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+/*
+ * same contract as LZ4_wildCopy(), but moves 16 bytes per step on
+ * arm64, where the two 8-byte accesses pair into a single ldp/stp;
+ * srcPtr must then be at least 16 bytes behind dstPtr
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+#if defined(CONFIG_ARM64)
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	while (d + 8 < e) {
+		LZ4_copy8(d, s);
+		LZ4_copy8(d + 8, s + 8);
+		d += 16;
+		s += 16;
+	}
+	if (d < e)
+		LZ4_copy8(d, s);
+#else
+	LZ4_wildCopy(dstPtr, srcPtr, dstEnd);
+#endif
+}
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
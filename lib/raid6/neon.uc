@@ -53,6 +53,24 @@ static inline unative_t PMUL(unative_t v, unative_t u)
 	return (unative_t)vmulq_p8((poly8x16_t)v, (poly8x16_t)u);
 }
 
+/*
+ * In-order cores such as the Cortex-A53 only track a few streams in the
+ * hardware prefetcher, fewer than the disks we walk in parallel, so ask
+ * for the lines PREFETCH_AHEAD bytes ahead on each disk explicitly, once
+ * per 64 byte line.
+ */
+#define PREFETCH_AHEAD	256
+
+static inline void PREFETCH(const uint8_t *ptr, unsigned long d)
+{
+	int i;
+
+	if (NSIZE*$# < 64 && (d & 63))
+		return;
+	for (i = 0; i < NSIZE*$#; i += 64)
+		__builtin_prefetch(ptr + d + i + PREFETCH_AHEAD);
+}
+
 void raid6_neon$#_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs)
 {
 	uint8_t **dptr = (uint8_t **)ptrs;
@@ -67,8 +85,10 @@ void raid6_neon$#_gen_syndrome_real(int disks, unsigned long bytes, void **ptrs)
 	q = dptr[z0+2];		/* RS syndrome */
 
 	for ( d = 0 ; d < bytes ; d += NSIZE*$# ) {
+		PREFETCH(dptr[z0], d);
 		wq$$ = wp$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
 		for ( z = z0-1 ; z >= 0 ; z-- ) {
+			PREFETCH(dptr[z], d);
 			wd$$ = vld1q_u8(&dptr[z][d+$$*NSIZE]);
 			wp$$ = veorq_u8(wp$$, wd$$);
 			w2$$ = MASK(wq$$);
@@ -98,11 +118,15 @@ void raid6_neon$#_xor_syndrome_real(int disks, int start, int stop,
 	q = dptr[disks-1];	/* RS syndrome */
 
 	for ( d = 0 ; d < bytes ; d += NSIZE*$# ) {
+		PREFETCH(dptr[z0], d);
+		PREFETCH(p, d);
+		PREFETCH(q, d);
 		wq$$ = vld1q_u8(&dptr[z0][d+$$*NSIZE]);
 		wp$$ = veorq_u8(vld1q_u8(&p[d+$$*NSIZE]), wq$$);
 
 		/* P/Q data pages */
 		for ( z = z0-1 ; z >= start ; z-- ) {
+			PREFETCH(dptr[z], d);
 			wd$$ = vld1q_u8(&dptr[z][d+$$*NSIZE]);
 			wp$$ = veorq_u8(wp$$, wd$$);
 			w2$$ = MASK(wq$$);
@@ -24,6 +24,23 @@ static uint8x16_t vqtbl1q_u8(uint8x16_t a, uint8x16_t b)
 }
 #endif
 
+/*
+ * Both loops below handle two 16 byte vectors per pass: the two chains of
+ * table lookups are independent, which keeps in-order cores such as the
+ * Cortex-A53 from stalling on each vqtbl1q_u8() result.  The lines a few
+ * passes ahead are prefetched since every pointer is its own stream.
+ */
+#define RECOV_PREFETCH_AHEAD	256
+
+static inline uint8x16_t gf_mul(uint8x16_t x, uint8x16_t m0, uint8x16_t m1,
+				uint8x16_t x0f)
+{
+	uint8x16_t lo = vqtbl1q_u8(m0, vandq_u8(x, x0f));
+	uint8x16_t hi = vqtbl1q_u8(m1, vshrq_n_u8(x, 4));
+
+	return veorq_u8(lo, hi);
+}
+
 void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
 			      uint8_t *dq, const uint8_t *pbmul,
 			      const uint8_t *qmul)
@@ -46,31 +63,45 @@ void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
 	 * }
 	 */
 
-	while (bytes) {
-		uint8x16_t vx, vy, px, qx, db;
-
-		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
-		vx = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+	while (bytes >= 32) {
+		uint8x16_t px0, px1, qx0, qx1, db0, db1;
+
+		__builtin_prefetch(p + RECOV_PREFETCH_AHEAD);
+		__builtin_prefetch(q + RECOV_PREFETCH_AHEAD);
+		__builtin_prefetch(dp + RECOV_PREFETCH_AHEAD, 1);
+		__builtin_prefetch(dq + RECOV_PREFETCH_AHEAD, 1);
+
+		px0 = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		px1 = veorq_u8(vld1q_u8(p + 16), vld1q_u8(dp + 16));
+		qx0 = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		qx1 = veorq_u8(vld1q_u8(q + 16), vld1q_u8(dq + 16));
+
+		qx0 = gf_mul(qx0, qm0, qm1, x0f);
+		qx1 = gf_mul(qx1, qm0, qm1, x0f);
+		db0 = veorq_u8(gf_mul(px0, pm0, pm1, x0f), qx0);
+		db1 = veorq_u8(gf_mul(px1, pm0, pm1, x0f), qx1);
+
+		vst1q_u8(dq, db0);
+		vst1q_u8(dq + 16, db1);
+		vst1q_u8(dp, veorq_u8(db0, px0));
+		vst1q_u8(dp + 16, veorq_u8(db1, px1));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dp += 32;
+		dq += 32;
+	}
 
-		vy = vshrq_n_u8(vx, 4);
-		vx = vqtbl1q_u8(qm0, vandq_u8(vx, x0f));
-		vy = vqtbl1q_u8(qm1, vy);
-		qx = veorq_u8(vx, vy);
+	if (bytes) {
+		uint8x16_t px, qx, db;
 
-		vy = vshrq_n_u8(px, 4);
-		vx = vqtbl1q_u8(pm0, vandq_u8(px, x0f));
-		vy = vqtbl1q_u8(pm1, vy);
-		vx = veorq_u8(vx, vy);
-		db = veorq_u8(vx, qx);
+		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		qx = gf_mul(veorq_u8(vld1q_u8(q), vld1q_u8(dq)), qm0, qm1, x0f);
+		db = veorq_u8(gf_mul(px, pm0, pm1, x0f), qx);
 
 		vst1q_u8(dq, db);
 		vst1q_u8(dp, veorq_u8(db, px));
-
-		bytes -= 16;
-		p += 16;
-		q += 16;
-		dp += 16;
-		dq += 16;
 	}
 }
 
@@ -88,23 +119,36 @@ void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dq,
 	 * }
 	 */
 
-	while (bytes) {
-		uint8x16_t vx, vy;
+	while (bytes >= 32) {
+		uint8x16_t vx0, vx1;
 
-		vx = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		__builtin_prefetch(p + RECOV_PREFETCH_AHEAD, 1);
+		__builtin_prefetch(q + RECOV_PREFETCH_AHEAD);
+		__builtin_prefetch(dq + RECOV_PREFETCH_AHEAD, 1);
 
-		vy = vshrq_n_u8(vx, 4);
-		vx = vqtbl1q_u8(qm0, vandq_u8(vx, x0f));
-		vy = vqtbl1q_u8(qm1, vy);
-		vx = veorq_u8(vx, vy);
-		vy = veorq_u8(vx, vld1q_u8(p));
+		vx0 = veorq_u8(vld1q_u8(q), vld1q_u8(dq));
+		vx1 = veorq_u8(vld1q_u8(q + 16), vld1q_u8(dq + 16));
 
-		vst1q_u8(dq, vx);
-		vst1q_u8(p, vy);
+		vx0 = gf_mul(vx0, qm0, qm1, x0f);
+		vx1 = gf_mul(vx1, qm0, qm1, x0f);
 
-		bytes -= 16;
-		p += 16;
-		q += 16;
-		dq += 16;
+		vst1q_u8(dq, vx0);
+		vst1q_u8(dq + 16, vx1);
+		vst1q_u8(p, veorq_u8(vx0, vld1q_u8(p)));
+		vst1q_u8(p + 16, veorq_u8(vx1, vld1q_u8(p + 16)));
+
+		bytes -= 32;
+		p += 32;
+		q += 32;
+		dq += 32;
+	}
+
+	if (bytes) {
+		uint8x16_t vx;
+
+		vx = gf_mul(veorq_u8(vld1q_u8(q), vld1q_u8(dq)), qm0, qm1, x0f);
+
+		vst1q_u8(dq, vx);
+		vst1q_u8(p, veorq_u8(vx, vld1q_u8(p)));
 	}
 }
@@ -58,6 +58,29 @@
 
 	/* form the syndromes; i.e., evaluate data(x) at roots of
 	 * g(x) */
+	if (rs->synmul) {
+		const uint8_t *mul;
+
+		for (i = 0; i < nroots; i++)
+			syn[i] = (((uint16_t) data[0]) ^ invmsk) & msk;
+
+		/* the nroots chains are independent, keep them interleaved */
+		for (j = 1; j < len; j++) {
+			u = (((uint16_t) data[j]) ^ invmsk) & msk;
+			for (i = 0, mul = rs->synmul; i < nroots;
+			     i++, mul += nn + 1)
+				syn[i] = mul[syn[i]] ^ u;
+		}
+
+		for (j = 0; j < nroots; j++) {
+			u = ((uint16_t) par[j]) & msk;
+			for (i = 0, mul = rs->synmul; i < nroots;
+			     i++, mul += nn + 1)
+				syn[i] = mul[syn[i]] ^ u;
+		}
+		goto syn_done;
+	}
+
 	for (i = 0; i < nroots; i++)
 		syn[i] = (((uint16_t) data[0]) ^ invmsk) & msk;
 
@@ -86,6 +109,8 @@
 			}
 		}
 	}
+
+ syn_done:
 	s = syn;
 
 	/* Convert syndromes to index form, checking for nonzero condition */
@@ -152,11 +152,32 @@ static struct rs_codec *codec_init(int symsize, int gfpoly, int (*gffunc)(int),
 	for (i = 0; i <= nroots; i++)
 		rs->genpoly[i] = rs->index_of[rs->genpoly[i]];
 
+	/*
+	 * With symbols of up to 8 bits, the syndrome step x * alpha**root
+	 * for each root fits a byte table of nn + 1 entries, which saves
+	 * the log/antilog round trip per symbol and root in the decoder.
+	 */
+	if (symsize <= 8) {
+		rs->synmul = kmalloc_array(nroots, rs->nn + 1, gfp);
+		if (rs->synmul == NULL)
+			goto err;
+
+		for (i = 0, root = fcr * prim; i < nroots; i++, root += prim) {
+			uint8_t *mul = rs->synmul + i * (rs->nn + 1);
+
+			mul[0] = 0;
+			for (j = 1; j <= rs->nn; j++)
+				mul[j] = rs->alpha_to[rs_modnn(rs,
+						rs->index_of[j] + root)];
+		}
+	}
+
 	rs->users = 1;
 	list_add(&rs->list, &codec_list);
 	return rs;
 
 err:
+	kfree(rs->synmul);
 	kfree(rs->genpoly);
 	kfree(rs->index_of);
 	kfree(rs->alpha_to);
@@ -188,6 +209,7 @@ void free_rs(struct rs_control *rs)
 		kfree(cd->alpha_to);
 		kfree(cd->index_of);
 		kfree(cd->genpoly);
+		kfree(cd->synmul);
 		kfree(cd);
 	}
 	mutex_unlock(&rslistlock);
@@ -7,10 +7,12 @@
  */
 #include <linux/rslib.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
 #include <linux/slab.h>
+#include <linux/timekeeping.h>
 
 enum verbosity {
 	V_SILENT,
@@ -32,6 +34,7 @@ enum method {
 __param(int, v, V_PROGRESS, "Verbosity level");
 __param(int, ewsc, 1, "Erasures without symbol corruption");
 __param(int, bc, 1, "Test for correct behaviour beyond error correction capacity");
+__param(int, bench, 0, "Decodes per code for the throughput benchmark, 0 to skip");
 
 struct etab {
 	int	symsize;
@@ -439,6 +442,36 @@ static int exercise_rs_bc(struct rs_control *rs, struct wspace *ws,
 	return stat.noncw;
 }
 
+/*
+ * Decode throughput of a full length word, without errors (the syndrome
+ * check every clean read pays) and at the error correction capacity.
+ */
+static void bench_rs(struct rs_control *rs, struct wspace *ws, int len,
+		     int trials)
+{
+	int nroots = rs->codec->nroots;
+	int errs[] = { 0, nroots / 2 };
+	int dlen = len - nroots;
+	u64 start, ns;
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(errs); i++) {
+		if (i && !errs[i])
+			break;
+
+		get_rcw_we(rs, ws, len, errs[i], 0);
+
+		start = ktime_get_ns();
+		for (j = 0; j < trials; j++)
+			decode_rs16(rs, ws->r, ws->r + dlen, dlen, NULL, 0,
+				    NULL, 0, ws->corr);
+		ns = ktime_get_ns() - start;
+
+		pr_info("  %d errors: %llu symbols/s\n", errs[i],
+			div64_u64((u64)trials * len * NSEC_PER_SEC, ns ?: 1));
+	}
+}
+
 static int run_exercise(struct etab *e)
 {
 	int nn = (1 << e->symsize) - 1;
@@ -477,6 +510,11 @@ static int run_exercise(struct etab *e)
 			retval |= exercise_rs_bc(rsc, ws, len, e->ntrials);
 	}
 
+	if (bench) {
+		pr_info("Benchmarking (%d,%d)_%d code...\n", nn, kk, nn + 1);
+		bench_rs(rsc, ws, nn, bench);
+	}
+
 	free_ws(ws);
 
 err:
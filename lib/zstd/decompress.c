@@ -50,6 +50,26 @@
 *  Memory operations
 **********************************************************/
 static void ZSTD_copy4(void *dst, const void *src) { memcpy(dst, src, 4); }
+static void ZSTD_copy16(void *dst, const void *src) { memcpy(dst, src, 16); }
+
+/*! ZSTD_wildcopy16() :
+*   like ZSTD_wildcopy(), but moves 16 bytes per step : can copy up to 15 bytes too many,
+*   and dst must be at least 16 bytes past src when both lie in the same buffer */
+#define ZSTD_DEC_WILDCOPY_OVERLENGTH 16
+static void ZSTD_wildcopy16(void *dst, const void *src, ptrdiff_t length)
+{
+	const BYTE *ip = (const BYTE *)src;
+	BYTE *op = (BYTE *)dst;
+	BYTE *const oend = op + length;
+
+	if (length <= 16)
+		return ZSTD_copy16(dst, src);
+	do {
+		ZSTD_copy16(op, ip);
+		op += 16;
+		ip += 16;
+	} while (op < oend);
+}
 
 /*-*************************************************************
 *   Context management
@@ -97,7 +117,7 @@ struct ZSTD_DCtx_s {
 	ZSTD_customMem customMem;
 	size_t litSize;
 	size_t rleSize;
-	BYTE litBuffer[ZSTD_BLOCKSIZE_ABSOLUTEMAX + WILDCOPY_OVERLENGTH];
+	BYTE litBuffer[ZSTD_BLOCKSIZE_ABSOLUTEMAX + ZSTD_DEC_WILDCOPY_OVERLENGTH];
 	BYTE headerBuffer[ZSTD_FRAMEHEADERSIZE_MAX];
 }; /* typedef'd to ZSTD_DCtx within "zstd.h" */
 
@@ -154,7 +174,7 @@ size_t ZSTD_freeDCtx(ZSTD_DCtx *dctx)
 
 void ZSTD_copyDCtx(ZSTD_DCtx *dstDCtx, const ZSTD_DCtx *srcDCtx)
 {
-	size_t const workSpaceSize = (ZSTD_BLOCKSIZE_ABSOLUTEMAX + WILDCOPY_OVERLENGTH) + ZSTD_frameHeaderSize_max;
+	size_t const workSpaceSize = (ZSTD_BLOCKSIZE_ABSOLUTEMAX + ZSTD_DEC_WILDCOPY_OVERLENGTH) + ZSTD_frameHeaderSize_max;
 	memcpy(dstDCtx, srcDCtx, sizeof(ZSTD_DCtx) - workSpaceSize); /* no need to copy workspace */
 }
 
@@ -495,7 +515,7 @@ size_t ZSTD_decodeLiteralsBlock(ZSTD_DCtx *dctx, const void *src, size_t srcSize
 				dctx->litEntropy = 1;
 				if (litEncType == set_compressed)
 					dctx->HUFptr = dctx->entropy.hufTable;
-				memset(dctx->litBuffer + dctx->litSize, 0, WILDCOPY_OVERLENGTH);
+				memset(dctx->litBuffer + dctx->litSize, 0, ZSTD_DEC_WILDCOPY_OVERLENGTH);
 				return litCSize + lhSize;
 			}
 
@@ -519,13 +539,13 @@ size_t ZSTD_decodeLiteralsBlock(ZSTD_DCtx *dctx, const void *src, size_t srcSize
 				break;
 			}
 
-			if (lhSize + litSize + WILDCOPY_OVERLENGTH > srcSize) { /* risk reading beyond src buffer with wildcopy */
+			if (lhSize + litSize + ZSTD_DEC_WILDCOPY_OVERLENGTH > srcSize) { /* risk reading beyond src buffer with wildcopy */
 				if (litSize + lhSize > srcSize)
 					return ERROR(corruption_detected);
 				memcpy(dctx->litBuffer, istart + lhSize, litSize);
 				dctx->litPtr = dctx->litBuffer;
 				dctx->litSize = litSize;
-				memset(dctx->litBuffer + dctx->litSize, 0, WILDCOPY_OVERLENGTH);
+				memset(dctx->litBuffer + dctx->litSize, 0, ZSTD_DEC_WILDCOPY_OVERLENGTH);
 				return lhSize + litSize;
 			}
 			/* direct reference into compressed stream */
@@ -557,7 +577,7 @@ size_t ZSTD_decodeLiteralsBlock(ZSTD_DCtx *dctx, const void *src, size_t srcSize
 			}
 			if (litSize > ZSTD_BLOCKSIZE_ABSOLUTEMAX)
 				return ERROR(corruption_detected);
-			memset(dctx->litBuffer, istart[lhSize], litSize + WILDCOPY_OVERLENGTH);
+			memset(dctx->litBuffer, istart[lhSize], litSize + ZSTD_DEC_WILDCOPY_OVERLENGTH);
 			dctx->litPtr = dctx->litBuffer;
 			dctx->litSize = litSize;
 			return lhSize + 1;
@@ -883,13 +903,13 @@ size_t ZSTD_execSequenceLast7(BYTE *op, BYTE *const oend, seq_t sequence, const
 	BYTE *const oLitEnd = op + sequence.litLength;
 	size_t const sequenceLength = sequence.litLength + sequence.matchLength;
 	BYTE *const oMatchEnd = op + sequenceLength; /* risk : address space overflow (32-bits) */
-	BYTE *const oend_w = oend - WILDCOPY_OVERLENGTH;
+	BYTE *const oend_w = oend - ZSTD_DEC_WILDCOPY_OVERLENGTH;
 	const BYTE *const iLitEnd = *litPtr + sequence.litLength;
 	const BYTE *match = oLitEnd - sequence.offset;
 
 	/* check */
 	if (oMatchEnd > oend)
-		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of WILDCOPY_OVERLENGTH from oend */
+		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of ZSTD_DEC_WILDCOPY_OVERLENGTH from oend */
 	if (iLitEnd > litLimit)
 		return ERROR(corruption_detected); /* over-read beyond lit buffer */
 	if (oLitEnd <= oend_w)
@@ -1010,23 +1030,23 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 	BYTE *const oLitEnd = op + sequence.litLength;
 	size_t const sequenceLength = sequence.litLength + sequence.matchLength;
 	BYTE *const oMatchEnd = op + sequenceLength; /* risk : address space overflow (32-bits) */
-	BYTE *const oend_w = oend - WILDCOPY_OVERLENGTH;
+	BYTE *const oend_w = oend - ZSTD_DEC_WILDCOPY_OVERLENGTH;
 	const BYTE *const iLitEnd = *litPtr + sequence.litLength;
 	const BYTE *match = oLitEnd - sequence.offset;
 
 	/* check */
 	if (oMatchEnd > oend)
-		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of WILDCOPY_OVERLENGTH from oend */
+		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of ZSTD_DEC_WILDCOPY_OVERLENGTH from oend */
 	if (iLitEnd > litLimit)
 		return ERROR(corruption_detected); /* over-read beyond lit buffer */
 	if (oLitEnd > oend_w)
 		return ZSTD_execSequenceLast7(op, oend, sequence, litPtr, litLimit, base, vBase, dictEnd);
 
 	/* copy Literals */
-	ZSTD_copy8(op, *litPtr);
-	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	ZSTD_copy16(op, *litPtr);
+	if (sequence.litLength > 16)
+		ZSTD_wildcopy16(op + 16, (*litPtr) + 16,
+				sequence.litLength - 16); /* note : since oLitEnd <= oend-ZSTD_DEC_WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1057,6 +1077,12 @@ size_t ZSTD_execSequence(BYTE *op, BYTE *const oend, seq_t sequence, const BYTE
 	}
 	/* Requirement: op <= oend_w && sequence.matchLength >= MINMATCH */
 
+	/* far match : no overlap within a 16 bytes step */
+	if (sequence.offset >= 16 && oMatchEnd <= oend_w) {
+		ZSTD_wildcopy16(op, match, sequence.matchLength);
+		return sequenceLength;
+	}
+
 	/* match within prefix */
 	if (sequence.offset < 8) {
 		/* close range match, overlap */
@@ -1266,23 +1292,23 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 	BYTE *const oLitEnd = op + sequence.litLength;
 	size_t const sequenceLength = sequence.litLength + sequence.matchLength;
 	BYTE *const oMatchEnd = op + sequenceLength; /* risk : address space overflow (32-bits) */
-	BYTE *const oend_w = oend - WILDCOPY_OVERLENGTH;
+	BYTE *const oend_w = oend - ZSTD_DEC_WILDCOPY_OVERLENGTH;
 	const BYTE *const iLitEnd = *litPtr + sequence.litLength;
 	const BYTE *match = sequence.match;
 
 	/* check */
 	if (oMatchEnd > oend)
-		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of WILDCOPY_OVERLENGTH from oend */
+		return ERROR(dstSize_tooSmall); /* last match must start at a minimum distance of ZSTD_DEC_WILDCOPY_OVERLENGTH from oend */
 	if (iLitEnd > litLimit)
 		return ERROR(corruption_detected); /* over-read beyond lit buffer */
 	if (oLitEnd > oend_w)
 		return ZSTD_execSequenceLast7(op, oend, sequence, litPtr, litLimit, base, vBase, dictEnd);
 
 	/* copy Literals */
-	ZSTD_copy8(op, *litPtr);
-	if (sequence.litLength > 8)
-		ZSTD_wildcopy(op + 8, (*litPtr) + 8,
-			      sequence.litLength - 8); /* note : since oLitEnd <= oend-WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
+	ZSTD_copy16(op, *litPtr);
+	if (sequence.litLength > 16)
+		ZSTD_wildcopy16(op + 16, (*litPtr) + 16,
+				sequence.litLength - 16); /* note : since oLitEnd <= oend-ZSTD_DEC_WILDCOPY_OVERLENGTH, no risk of overwrite beyond oend */
 	op = oLitEnd;
 	*litPtr = iLitEnd; /* update for next sequence */
 
@@ -1312,6 +1338,12 @@ size_t ZSTD_execSequenceLong(BYTE *op, BYTE *const oend, seq_t sequence, const B
 	}
 	/* Requirement: op <= oend_w && sequence.matchLength >= MINMATCH */
 
+	/* far match : no overlap within a 16 bytes step */
+	if (sequence.offset >= 16 && oMatchEnd <= oend_w) {
+		ZSTD_wildcopy16(op, match, sequence.matchLength);
+		return sequenceLength;
+	}
+
 	/* match within prefix */
 	if (sequence.offset < 8) {
 		/* close range match, overlap */
@@ -2185,7 +2217,7 @@ size_t ZSTD_DStreamWorkspaceBound(size_t maxWindowSize)
 {
 	size_t const blockSize = MIN(maxWindowSize, ZSTD_BLOCKSIZE_ABSOLUTEMAX);
 	size_t const inBuffSize = blockSize;
-	size_t const outBuffSize = maxWindowSize + blockSize + WILDCOPY_OVERLENGTH * 2;
+	size_t const outBuffSize = maxWindowSize + blockSize + ZSTD_DEC_WILDCOPY_OVERLENGTH * 2;
 	return ZSTD_DCtxWorkspaceBound() + ZSTD_ALIGN(sizeof(ZSTD_DStream)) + ZSTD_ALIGN(inBuffSize) + ZSTD_ALIGN(outBuffSize);
 }
 
@@ -2230,7 +2262,7 @@ ZSTD_DStream *ZSTD_initDStream(size_t maxWindowSize, void *workspace, size_t wor
 
 	{
 		size_t const blockSize = MIN(zds->maxWindowSize, ZSTD_BLOCKSIZE_ABSOLUTEMAX);
-		size_t const neededOutSize = zds->maxWindowSize + blockSize + WILDCOPY_OVERLENGTH * 2;
+		size_t const neededOutSize = zds->maxWindowSize + blockSize + ZSTD_DEC_WILDCOPY_OVERLENGTH * 2;
 
 		zds->inBuff = (char *)ZSTD_malloc(blockSize, zds->customMem);
 		zds->inBuffSize = blockSize;
@@ -2365,7 +2397,7 @@ size_t ZSTD_decompressStream(ZSTD_DStream *zds, ZSTD_outBuffer *output, ZSTD_inB
 			/* Buffers are preallocated, but double check */
 			{
 				size_t const blockSize = MIN(zds->maxWindowSize, ZSTD_BLOCKSIZE_ABSOLUTEMAX);
-				size_t const neededOutSize = zds->maxWindowSize + blockSize + WILDCOPY_OVERLENGTH * 2;
+				size_t const neededOutSize = zds->maxWindowSize + blockSize + ZSTD_DEC_WILDCOPY_OVERLENGTH * 2;
 				if (zds->inBuffSize < blockSize) {
 					return ERROR(GENERIC);
 				}
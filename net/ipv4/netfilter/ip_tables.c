@@ -220,6 +220,67 @@ struct ipt_entry *ipt_next_entry(const struct ipt_entry *entry)
 	return (void *)entry + entry->next_offset;
 }
 
+/*
+ * Protocol buckets of the skip table. A packet failing a rule goes straight
+ * to the next rule whose ipt_ip can match its protocol: the rules skipped
+ * would have failed ip_packet_match() without side effects, so the first
+ * match is the same as with the linear walk. Chain heads and tails have no
+ * protocol, so a skip never leaves the chain.
+ */
+enum {
+	IPT_SKIP_TCP,
+	IPT_SKIP_UDP,
+	IPT_SKIP_ICMP,
+	IPT_SKIP_OTHER,
+	IPT_SKIP_BUCKETS,
+};
+
+#define IPT_SKIP_ALIGN	__alignof__(struct ipt_entry)
+
+static inline unsigned int ipt_skip_bucket(u8 proto)
+{
+	switch (proto) {
+	case IPPROTO_TCP:
+		return IPT_SKIP_TCP;
+	case IPPROTO_UDP:
+		return IPT_SKIP_UDP;
+	case IPPROTO_ICMP:
+		return IPT_SKIP_ICMP;
+	default:
+		return IPT_SKIP_OTHER;
+	}
+}
+
+/* Whether a rule can match packets of the given bucket */
+static bool ipt_skip_candidate(const struct ipt_ip *ip, unsigned int bucket)
+{
+	bool same;
+
+	if (!ip->proto)
+		return true;
+
+	same = ipt_skip_bucket(ip->proto) == bucket;
+	if (ip->invflags & IPT_INV_PROTO)
+		return !same || bucket == IPT_SKIP_OTHER;
+
+	return same;
+}
+
+/* Performance critical */
+static inline struct ipt_entry *
+ipt_next_candidate(const struct xt_table_info *private,
+		   const void *table_base, const struct ipt_entry *e,
+		   unsigned int bucket)
+{
+	unsigned int idx = ((const void *)e - table_base) / IPT_SKIP_ALIGN;
+
+	if (!private->skip)
+		return ipt_next_entry(e);
+
+	return (void *)e +
+	       private->skip[idx * IPT_SKIP_BUCKETS + bucket] * IPT_SKIP_ALIGN;
+}
+
 /* Returns one of the generic firewall policies, like NF_ACCEPT. */
 unsigned int
 ipt_do_table(struct sk_buff *skb,
@@ -238,6 +299,7 @@ ipt_do_table(struct sk_buff *skb,
 	const struct xt_table_info *private;
 	struct xt_action_param acpar;
 	unsigned int addend;
+	unsigned int bucket;
 
 	/* Initialization */
 	stackidx = 0;
@@ -254,6 +316,7 @@ ipt_do_table(struct sk_buff *skb,
 	acpar.thoff   = ip_hdrlen(skb);
 	acpar.hotdrop = false;
 	acpar.state   = state;
+	bucket = ipt_skip_bucket(ip->protocol);
 
 	WARN_ON(!(table->valid_hooks & (1 << hook)));
 	local_bh_disable();
@@ -284,7 +347,7 @@ ipt_do_table(struct sk_buff *skb,
 		if (!ip_packet_match(ip, indev, outdev,
 		    &e->ip, acpar.fragoff)) {
  no_match:
-			e = ipt_next_entry(e);
+			e = ipt_next_candidate(private, table_base, e, bucket);
 			continue;
 		}
 
@@ -347,6 +410,7 @@ ipt_do_table(struct sk_buff *skb,
 		if (verdict == XT_CONTINUE) {
 			/* Target might have changed stuff. */
 			ip = ip_hdr(skb);
+			bucket = ipt_skip_bucket(ip->protocol);
 			e = ipt_next_entry(e);
 		} else {
 			/* Verdict */
@@ -655,6 +719,52 @@ cleanup_entry(struct ipt_entry *e, struct net *net)
 	xt_percpu_counter_free(&e->counters);
 }
 
+static void ipt_free_table_info(struct xt_table_info *info)
+{
+	kvfree(info->skip);
+	xt_free_table_info(info);
+}
+
+/*
+ * Build the skip table from the entry offsets. It is only an optimization,
+ * so the linear walk is kept if it can't be allocated, and an entry whose
+ * next candidate is out of reach simply points to the next entry.
+ */
+static void ipt_build_skip(struct xt_table_info *newinfo, void *entry0,
+			   const unsigned int *offsets)
+{
+	unsigned int next[IPT_SKIP_BUCKETS];
+	unsigned int i, b;
+	unsigned short *skip;
+
+	skip = kvcalloc(newinfo->size / IPT_SKIP_ALIGN * IPT_SKIP_BUCKETS,
+			sizeof(*skip), GFP_KERNEL_ACCOUNT);
+	if (!skip)
+		return;
+
+	for (b = 0; b < IPT_SKIP_BUCKETS; b++)
+		next[b] = newinfo->size;
+
+	for (i = newinfo->number; i-- > 0; ) {
+		const struct ipt_entry *e = entry0 + offsets[i];
+		unsigned int idx = offsets[i] / IPT_SKIP_ALIGN;
+
+		for (b = 0; b < IPT_SKIP_BUCKETS; b++) {
+			unsigned int delta = (next[b] - offsets[i]) /
+					     IPT_SKIP_ALIGN;
+
+			if (next[b] == newinfo->size || delta > USHRT_MAX)
+				delta = e->next_offset / IPT_SKIP_ALIGN;
+			skip[idx * IPT_SKIP_BUCKETS + b] = delta;
+
+			if (ipt_skip_candidate(&e->ip, b))
+				next[b] = offsets[i];
+		}
+	}
+
+	newinfo->skip = skip;
+}
+
 /* Checks and translates the user-supplied table segment (held in
    newinfo) */
 static int
@@ -709,6 +819,7 @@ translate_table(struct net *net, struct xt_table_info *newinfo, void *entry0,
 		ret = -ELOOP;
 		goto out_free;
 	}
+	ipt_build_skip(newinfo, entry0, offsets);
 	kvfree(offsets);
 
 	/* Finally, each sanity check must pass */
@@ -1084,7 +1195,7 @@ __do_replace(struct net *net, const char *name, unsigned int valid_hooks,
 	xt_entry_foreach(iter, oldinfo->entries, oldinfo->size)
 		cleanup_entry(iter, net);
 
-	xt_free_table_info(oldinfo);
+	ipt_free_table_info(oldinfo);
 	if (copy_to_user(counters_ptr, counters,
 			 sizeof(struct xt_counters) * num_counters) != 0) {
 		/* Silent error, can't fail, new table is already in place */
@@ -1147,7 +1258,7 @@ do_replace(struct net *net, const void __user *user, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1468,11 +1579,11 @@ translate_compat_table(struct net *net,
 
 	*pinfo = newinfo;
 	*pentry0 = entry1;
-	xt_free_table_info(info);
+	ipt_free_table_info(info);
 	return 0;
 
 free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 out_unlock:
 	xt_compat_flush_offsets(AF_INET);
@@ -1530,7 +1641,7 @@ compat_do_replace(struct net *net, void __user *user, unsigned int len)
 	xt_entry_foreach(iter, loc_cpu_entry, newinfo->size)
 		cleanup_entry(iter, net);
  free_newinfo:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
@@ -1749,7 +1860,7 @@ static void __ipt_unregister_table(struct net *net, struct xt_table *table)
 		cleanup_entry(iter, net);
 	if (private->number > private->initial_entries)
 		module_put(table_owner);
-	xt_free_table_info(private);
+	ipt_free_table_info(private);
 }
 
 int ipt_register_table(struct net *net, const struct xt_table *table,
@@ -1793,7 +1904,7 @@ int ipt_register_table(struct net *net, const struct xt_table *table,
 	return ret;
 
 out_free:
-	xt_free_table_info(newinfo);
+	ipt_free_table_info(newinfo);
 	return ret;
 }
 
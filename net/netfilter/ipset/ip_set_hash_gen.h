@@ -229,6 +229,8 @@ htable_bits(u32 hashsize)
 #undef mtype_ext_cleanup
 #undef mtype_add_cidr
 #undef mtype_del_cidr
+#undef mtype_lpm_add
+#undef mtype_lpm_del
 #undef mtype_ahash_memsize
 #undef mtype_flush
 #undef mtype_destroy
@@ -239,6 +241,7 @@ htable_bits(u32 hashsize)
 #undef mtype_add
 #undef mtype_del
 #undef mtype_test_cidrs
+#undef mtype_test_lpm
 #undef mtype_test
 #undef mtype_uref
 #undef mtype_resize
@@ -273,6 +276,8 @@ htable_bits(u32 hashsize)
 #define mtype_ext_cleanup	IPSET_TOKEN(MTYPE, _ext_cleanup)
 #define mtype_add_cidr		IPSET_TOKEN(MTYPE, _add_cidr)
 #define mtype_del_cidr		IPSET_TOKEN(MTYPE, _del_cidr)
+#define mtype_lpm_add		IPSET_TOKEN(MTYPE, _lpm_add)
+#define mtype_lpm_del		IPSET_TOKEN(MTYPE, _lpm_del)
 #define mtype_ahash_memsize	IPSET_TOKEN(MTYPE, _ahash_memsize)
 #define mtype_flush		IPSET_TOKEN(MTYPE, _flush)
 #define mtype_destroy		IPSET_TOKEN(MTYPE, _destroy)
@@ -283,6 +288,7 @@ htable_bits(u32 hashsize)
 #define mtype_add		IPSET_TOKEN(MTYPE, _add)
 #define mtype_del		IPSET_TOKEN(MTYPE, _del)
 #define mtype_test_cidrs	IPSET_TOKEN(MTYPE, _test_cidrs)
+#define mtype_test_lpm		IPSET_TOKEN(MTYPE, _test_lpm)
 #define mtype_test		IPSET_TOKEN(MTYPE, _test)
 #define mtype_uref		IPSET_TOKEN(MTYPE, _uref)
 #define mtype_resize		IPSET_TOKEN(MTYPE, _resize)
@@ -332,6 +338,10 @@ struct htype {
 #ifdef IP_SET_HASH_WITH_NETS
 	struct net_prefixes nets[NLEN]; /* book-keeping of prefixes */
 #endif
+#ifdef IP_SET_HASH_WITH_LPM
+	struct ip_set_lpm lpm;	/* prefix trie for the lookups */
+	bool lpm_failed;	/* trie dropped after allocation failure */
+#endif
 };
 
 /* ADD|DEL entries saved during resize */
@@ -397,6 +407,41 @@ mtype_del_cidr(struct ip_set *set, struct htype *h, u8 cidr, u8 n)
 }
 #endif
 
+#ifdef IP_SET_HASH_WITH_LPM
+/* The trie mirrors nets[] when the set was created with the lpm flag.
+ * If a node cannot be allocated, the trie is dropped and the lookups
+ * fall back to nets[] until the set is flushed.
+ */
+static void
+mtype_lpm_add(struct ip_set *set, struct htype *h,
+	      const struct mtype_elem *d)
+{
+	if (!SET_WITH_LPM(set))
+		return;
+	spin_lock_bh(&set->lock);
+	if (!h->lpm_failed &&
+	    ip_set_lpm_add(&h->lpm, &d->ip, DCIDR_GET(d->cidr, 0))) {
+		pr_warn("Cannot allocate prefix trie of set %s, using linear lookup\n",
+			set->name);
+		WRITE_ONCE(h->lpm_failed, true);
+		ip_set_lpm_flush(&h->lpm);
+	}
+	spin_unlock_bh(&set->lock);
+}
+
+static void
+mtype_lpm_del(struct ip_set *set, struct htype *h,
+	      const struct mtype_elem *d)
+{
+	if (!SET_WITH_LPM(set))
+		return;
+	spin_lock_bh(&set->lock);
+	if (!h->lpm_failed)
+		ip_set_lpm_del(&h->lpm, &d->ip, DCIDR_GET(d->cidr, 0));
+	spin_unlock_bh(&set->lock);
+}
+#endif
+
 /* Calculate the actual memory size of the set data */
 static size_t
 mtype_ahash_memsize(const struct htype *h, const struct htable *t)
@@ -448,6 +493,12 @@ mtype_flush(struct ip_set *set)
 #ifdef IP_SET_HASH_WITH_NETS
 	memset(h->nets, 0, sizeof(h->nets));
 #endif
+#ifdef IP_SET_HASH_WITH_LPM
+	spin_lock_bh(&set->lock);
+	ip_set_lpm_flush(&h->lpm);
+	WRITE_ONCE(h->lpm_failed, false);
+	spin_unlock_bh(&set->lock);
+#endif
 }
 
 /* Destroy the hashtable part of the set */
@@ -482,6 +533,9 @@ mtype_destroy(struct ip_set *set)
 		cancel_delayed_work_sync(&h->gc.dwork);
 
 	mtype_ahash_destroy(set, ipset_dereference_nfnl(h->table), true);
+#ifdef IP_SET_HASH_WITH_LPM
+	ip_set_lpm_flush(&h->lpm);
+#endif
 	list_for_each_safe(l, lt, &h->ad) {
 		list_del(l);
 		kfree(l);
@@ -543,6 +597,9 @@ mtype_gc_do(struct ip_set *set, struct htype *h, struct htable *t, u32 r)
 				mtype_del_cidr(set, h,
 					NCIDR_PUT(DCIDR_GET(data->cidr, k)),
 					k);
+#endif
+#ifdef IP_SET_HASH_WITH_LPM
+			mtype_lpm_del(set, h, data);
 #endif
 			t->hregion[r].elements--;
 			ip_set_ext_destroy(set, data);
@@ -940,6 +997,9 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 				mtype_del_cidr(set, h,
 					NCIDR_PUT(DCIDR_GET(data->cidr, i)),
 					i);
+#endif
+#ifdef IP_SET_HASH_WITH_LPM
+			mtype_lpm_del(set, h, data);
 #endif
 			ip_set_ext_destroy(set, data);
 			t->hregion[r].elements--;
@@ -980,6 +1040,9 @@ mtype_add(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 #ifdef IP_SET_HASH_WITH_NETS
 	for (i = 0; i < IPSET_NET_COUNT; i++)
 		mtype_add_cidr(set, h, NCIDR_PUT(DCIDR_GET(d->cidr, i)), i);
+#endif
+#ifdef IP_SET_HASH_WITH_LPM
+	mtype_lpm_add(set, h, d);
 #endif
 	memcpy(data, d, sizeof(struct mtype_elem));
 overwrite_extensions:
@@ -1090,6 +1153,9 @@ mtype_del(struct ip_set *set, void *value, const struct ip_set_ext *ext,
 		for (j = 0; j < IPSET_NET_COUNT; j++)
 			mtype_del_cidr(set, h,
 				       NCIDR_PUT(DCIDR_GET(d->cidr, j)), j);
+#endif
+#ifdef IP_SET_HASH_WITH_LPM
+		mtype_lpm_del(set, h, d);
 #endif
 		ip_set_ext_destroy(set, data);
 
@@ -1162,6 +1228,50 @@ mtype_data_match(struct mtype_elem *data, const struct ip_set_ext *ext,
 	return mtype_do_data_match(data);
 }
 
+#ifdef IP_SET_HASH_WITH_LPM
+/* Test by the prefixes from the trie which actually cover the address
+ * instead of every network size stored in the set
+ */
+static int
+mtype_test_lpm(struct ip_set *set, struct mtype_elem *d,
+	       const struct ip_set_ext *ext,
+	       struct ip_set_ext *mext, u32 flags)
+{
+	struct htype *h = set->data;
+	struct htable *t = rcu_dereference_bh(h->table);
+	struct hbucket *n;
+	struct mtype_elem *data;
+	u8 cidrs[HOST_MASK + 1];
+	int ret, i, j, nr;
+	u32 key, multi = 0;
+
+	pr_debug("test by prefix trie\n");
+	nr = ip_set_lpm_lookup(&h->lpm, &d->ip, cidrs, ARRAY_SIZE(cidrs));
+	for (j = 0; j < nr && !multi; j++) {
+		mtype_data_netmask(d, cidrs[j]);
+		key = HKEY(d, h->initval, t->htable_bits);
+		n = rcu_dereference_bh(hbucket(t, key));
+		if (!n)
+			continue;
+		for (i = 0; i < n->pos; i++) {
+			if (!test_bit(i, n->used))
+				continue;
+			data = ahash_data(n, i, set->dsize);
+			if (!mtype_data_equal(data, d, &multi))
+				continue;
+			ret = mtype_data_match(data, ext, mext, set, flags);
+			if (ret != 0)
+				return ret;
+#ifdef IP_SET_HASH_WITH_MULTI
+			/* No match, reset multiple match flag */
+			multi = 0;
+#endif
+		}
+	}
+	return 0;
+}
+#endif
+
 #ifdef IP_SET_HASH_WITH_NETS
 /* Special test function which takes into account the different network
  * sizes added to the set
@@ -1183,6 +1293,10 @@ mtype_test_cidrs(struct ip_set *set, struct mtype_elem *d,
 #endif
 	u32 key, multi = 0;
 
+#ifdef IP_SET_HASH_WITH_LPM
+	if (SET_WITH_LPM(set) && !READ_ONCE(h->lpm_failed))
+		return mtype_test_lpm(set, d, ext, mext, flags);
+#endif
 	pr_debug("test by nets\n");
 	for (; j < NLEN && h->nets[j].cidr[0] && !multi; j++) {
 #if IPSET_NET_COUNT == 2
@@ -1286,6 +1400,9 @@ mtype_head(struct ip_set *set, struct sk_buff *skb)
 	t = rcu_dereference_bh(h->table);
 	mtype_ext_size(set, &elements, &ext_size);
 	memsize = mtype_ahash_memsize(h, t) + ext_size + set->ext_size;
+#ifdef IP_SET_HASH_WITH_LPM
+	memsize += READ_ONCE(h->lpm.memsize);
+#endif
 	htable_bits = t->htable_bits;
 	rcu_read_unlock_bh();
 
@@ -1548,6 +1665,13 @@ IPSET_TOKEN(HTYPE, _create)(struct net *net, struct ip_set *set,
 	h->markmask = markmask;
 #endif
 	get_random_bytes(&h->initval, sizeof(h->initval));
+#ifdef IP_SET_HASH_WITH_LPM
+	if (tb[IPSET_ATTR_CADT_FLAGS] &&
+	    (ip_set_get_h32(tb[IPSET_ATTR_CADT_FLAGS]) & IPSET_FLAG_WITH_LPM))
+		set->flags |= IPSET_CREATE_FLAG_LPM;
+	ip_set_lpm_init(&h->lpm, set->family == NFPROTO_IPV4 ?
+			sizeof(__be32) : sizeof(union nf_inet_addr));
+#endif
 
 	t->htable_bits = hbits;
 	t->maxelem = h->maxelem / ahash_numof_locks(hbits);
@@ -17,6 +17,7 @@
 #include <linux/netfilter/ipset/pfxlen.h>
 #include <linux/netfilter/ipset/ip_set.h>
 #include <linux/netfilter/ipset/ip_set_hash.h>
+#include <linux/netfilter/ipset/ip_set_lpm.h>
 
 #define IPSET_TYPE_REV_MIN	0
 /*				1    Range as input support for IPv4 added */
@@ -24,7 +25,8 @@
 /*				3    Counters support added */
 /*				4    Comments support added */
 /*				5    Forceadd support added */
-#define IPSET_TYPE_REV_MAX	6 /* skbinfo mapping support added */
+/*				6    skbinfo mapping support added */
+#define IPSET_TYPE_REV_MAX	7 /* lpm lookup support added */
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Jozsef Kadlecsik <kadlec@netfilter.org>");
@@ -34,6 +36,7 @@ MODULE_ALIAS("ip_set_hash:net");
 /* Type specific function prefix */
 #define HTYPE		hash_net
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_LPM
 
 /* IPv4 variant */
 
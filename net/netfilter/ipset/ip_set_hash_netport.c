@@ -18,6 +18,7 @@
 #include <linux/netfilter/ipset/ip_set.h>
 #include <linux/netfilter/ipset/ip_set_getport.h>
 #include <linux/netfilter/ipset/ip_set_hash.h>
+#include <linux/netfilter/ipset/ip_set_lpm.h>
 
 #define IPSET_TYPE_REV_MIN	0
 /*				1    SCTP and UDPLITE support added */
@@ -26,7 +27,8 @@
 /*				4    Counters support added */
 /*				5    Comments support added */
 /*				6    Forceadd support added */
-#define IPSET_TYPE_REV_MAX	7 /* skbinfo support added */
+/*				7    skbinfo support added */
+#define IPSET_TYPE_REV_MAX	8 /* lpm lookup support added */
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Jozsef Kadlecsik <kadlec@netfilter.org>");
@@ -37,6 +39,7 @@ MODULE_ALIAS("ip_set_hash:net,port");
 #define HTYPE		hash_netport
 #define IP_SET_HASH_WITH_PROTO
 #define IP_SET_HASH_WITH_NETS
+#define IP_SET_HASH_WITH_LPM
 
 /* We squeeze the "nomatch" flag into cidr: we don't support cidr == 0
  * However this way we have to store internally cidr - 1,
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* Path compressed binary trie of the network prefixes of a hash:net* set.
+ *
+ * Every node stores a prefix; nodes with a zero reference count are
+ * intermediate nodes which exist only to join two subtrees and always
+ * have both children. The layout follows the BPF LPM trie map.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/export.h>
+#include <linux/netfilter/ipset/ip_set_lpm.h>
+
+struct ip_set_lpm_node {
+	struct rcu_head rcu;
+	struct ip_set_lpm_node __rcu *child[2];
+	u32 refcnt;		/* elements with exactly this prefix */
+	u8 prefixlen;
+	u8 key[];
+};
+
+#define lpm_dereference(p)	rcu_dereference_protected(p, 1)
+
+static inline int
+lpm_bit(const u8 *key, u32 index)
+{
+	return !!(key[index / 8] & (1 << (7 - (index % 8))));
+}
+
+/* Number of leading bits shared by the node and the key, at most the
+ * shorter of the two prefixes.
+ */
+static u32
+lpm_match(const struct ip_set_lpm *t, const struct ip_set_lpm_node *node,
+	  const u8 *key, u32 prefixlen)
+{
+	u32 limit = min_t(u32, node->prefixlen, prefixlen);
+	u32 i;
+	u8 diff;
+
+	for (i = 0; i < t->keylen && i * 8 < limit; i++) {
+		diff = node->key[i] ^ key[i];
+		if (diff)
+			return min_t(u32, i * 8 + 8 - fls(diff), limit);
+	}
+	return limit;
+}
+
+static struct ip_set_lpm_node *
+lpm_node_alloc(struct ip_set_lpm *t, const u8 *key, u8 prefixlen, u32 refcnt)
+{
+	struct ip_set_lpm_node *node;
+
+	node = kmalloc(sizeof(*node) + t->keylen, GFP_ATOMIC);
+	if (!node)
+		return NULL;
+	RCU_INIT_POINTER(node->child[0], NULL);
+	RCU_INIT_POINTER(node->child[1], NULL);
+	node->refcnt = refcnt;
+	node->prefixlen = prefixlen;
+	memcpy(node->key, key, t->keylen);
+	t->memsize += sizeof(*node) + t->keylen;
+
+	return node;
+}
+
+static void
+lpm_node_free(struct ip_set_lpm *t, struct ip_set_lpm_node *node)
+{
+	t->memsize -= sizeof(*node) + t->keylen;
+	kfree_rcu(node, rcu);
+}
+
+int
+ip_set_lpm_add(struct ip_set_lpm *t, const void *key, u8 prefixlen)
+{
+	struct ip_set_lpm_node *node, *new, *im;
+	struct ip_set_lpm_node __rcu **slot = &t->root;
+	u32 maxlen = t->keylen * 8;
+	u32 matchlen = 0;
+
+	if (prefixlen > maxlen)
+		return -EINVAL;
+
+	while ((node = lpm_dereference(*slot))) {
+		matchlen = lpm_match(t, node, key, prefixlen);
+		if (node->prefixlen != matchlen ||
+		    node->prefixlen == prefixlen ||
+		    node->prefixlen == maxlen)
+			break;
+		slot = &node->child[lpm_bit(key, node->prefixlen)];
+	}
+
+	/* Same prefix: just take another reference */
+	if (node && node->prefixlen == matchlen) {
+		WRITE_ONCE(node->refcnt, node->refcnt + 1);
+		return 0;
+	}
+
+	new = lpm_node_alloc(t, key, prefixlen, 1);
+	if (!new)
+		return -ENOMEM;
+
+	if (!node) {
+		rcu_assign_pointer(*slot, new);
+		return 0;
+	}
+
+	/* The new prefix covers the node */
+	if (matchlen == prefixlen) {
+		RCU_INIT_POINTER(new->child[lpm_bit(node->key, matchlen)],
+				 node);
+		rcu_assign_pointer(*slot, new);
+		return 0;
+	}
+
+	im = lpm_node_alloc(t, node->key, matchlen, 0);
+	if (!im) {
+		t->memsize -= sizeof(*new) + t->keylen;
+		kfree(new);
+		return -ENOMEM;
+	}
+	if (lpm_bit(key, matchlen)) {
+		RCU_INIT_POINTER(im->child[0], node);
+		RCU_INIT_POINTER(im->child[1], new);
+	} else {
+		RCU_INIT_POINTER(im->child[0], new);
+		RCU_INIT_POINTER(im->child[1], node);
+	}
+	rcu_assign_pointer(*slot, im);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ip_set_lpm_add);
+
+int
+ip_set_lpm_del(struct ip_set_lpm *t, const void *key, u8 prefixlen)
+{
+	struct ip_set_lpm_node __rcu **slot = &t->root, **pslot = NULL;
+	struct ip_set_lpm_node *node, *parent = NULL, *child;
+	u32 matchlen = 0;
+
+	while ((node = lpm_dereference(*slot))) {
+		matchlen = lpm_match(t, node, key, prefixlen);
+		if (node->prefixlen != matchlen ||
+		    node->prefixlen == prefixlen)
+			break;
+		parent = node;
+		pslot = slot;
+		slot = &node->child[lpm_bit(key, node->prefixlen)];
+	}
+
+	if (!node || node->prefixlen != prefixlen ||
+	    node->prefixlen != matchlen || !node->refcnt)
+		return -ENOENT;
+
+	WRITE_ONCE(node->refcnt, node->refcnt - 1);
+	if (node->refcnt)
+		return 0;
+
+	/* Keep it as an intermediate node */
+	if (lpm_dereference(node->child[0]) &&
+	    lpm_dereference(node->child[1]))
+		return 0;
+
+	/* A leaf below an intermediate node: the sibling replaces both */
+	if (parent && !parent->refcnt &&
+	    !lpm_dereference(node->child[0]) &&
+	    !lpm_dereference(node->child[1])) {
+		child = lpm_dereference(parent->child[slot == &parent->child[0]]);
+		rcu_assign_pointer(*pslot, child);
+		lpm_node_free(t, parent);
+		lpm_node_free(t, node);
+		return 0;
+	}
+
+	/* At most one child left, which takes the place of the node */
+	child = lpm_dereference(node->child[0]);
+	if (!child)
+		child = lpm_dereference(node->child[1]);
+	rcu_assign_pointer(*slot, child);
+	lpm_node_free(t, node);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ip_set_lpm_del);
+
+/* Fill cidrs with the stored prefixes covering the key, longest first */
+int
+ip_set_lpm_lookup(const struct ip_set_lpm *t, const void *key,
+		  u8 *cidrs, int max)
+{
+	const struct ip_set_lpm_node *node;
+	u32 maxlen = t->keylen * 8;
+	int i, n = 0;
+	u8 tmp;
+
+	for (node = rcu_dereference_bh(t->root); node && n < max;) {
+		if (lpm_match(t, node, key, maxlen) != node->prefixlen)
+			break;
+		if (READ_ONCE(node->refcnt))
+			cidrs[n++] = node->prefixlen;
+		if (node->prefixlen == maxlen)
+			break;
+		node = rcu_dereference_bh(node->child[lpm_bit(key,
+							      node->prefixlen)]);
+	}
+
+	for (i = 0; i < n / 2; i++) {
+		tmp = cidrs[i];
+		cidrs[i] = cidrs[n - 1 - i];
+		cidrs[n - 1 - i] = tmp;
+	}
+
+	return n;
+}
+EXPORT_SYMBOL_GPL(ip_set_lpm_lookup);
+
+void
+ip_set_lpm_flush(struct ip_set_lpm *t)
+{
+	struct ip_set_lpm_node __rcu **slot;
+	struct ip_set_lpm_node *node;
+
+	/* Detach the leaves one by one, so that concurrent lookups
+	 * always see a valid trie.
+	 */
+	for (;;) {
+		slot = &t->root;
+		node = lpm_dereference(*slot);
+		if (!node)
+			break;
+		for (;;) {
+			if (lpm_dereference(node->child[0]))
+				slot = &node->child[0];
+			else if (lpm_dereference(node->child[1]))
+				slot = &node->child[1];
+			else
+				break;
+			node = lpm_dereference(*slot);
+		}
+		rcu_assign_pointer(*slot, NULL);
+		kfree_rcu(node, rcu);
+	}
+	t->memsize = 0;
+}
+EXPORT_SYMBOL_GPL(ip_set_lpm_flush);
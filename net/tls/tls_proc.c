@@ -18,6 +18,9 @@ static const struct snmp_mib tls_mib_list[] = {
 	SNMP_MIB_ITEM("TlsRxDevice", LINUX_MIB_TLSRXDEVICE),
 	SNMP_MIB_ITEM("TlsDecryptError", LINUX_MIB_TLSDECRYPTERROR),
 	SNMP_MIB_ITEM("TlsRxDeviceResync", LINUX_MIB_TLSRXDEVICERESYNC),
+	SNMP_MIB_ITEM("TlsRxDecryptZc", LINUX_MIB_TLSRXDECRYPTZC),
+	SNMP_MIB_ITEM("TlsRxDecryptCopy", LINUX_MIB_TLSRXDECRYPTCOPY),
+	SNMP_MIB_ITEM("TlsRxDecryptRetry", LINUX_MIB_TLSRXDECRYPTRETRY),
 	SNMP_MIB_SENTINEL
 };
 
@@ -1388,6 +1388,9 @@ static int tls_setup_from_iter(struct sock *sk, struct iov_iter *from,
  * out_iov or out_sg must be non-NULL. In case both out_iov and out_sg are
  * NULL, then the decryption happens inside skb buffers itself, i.e.
  * zero-copy gets disabled and 'zc' is updated.
+ *
+ * For TLS 1.3 the inner content type is decrypted into ctx->tail rather
+ * than into out_iov, the caller has to check it before trusting the data.
  */
 
 static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
@@ -1411,7 +1414,8 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 
 	if (*zc && (out_iov || out_sg)) {
 		if (out_iov)
-			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1;
+			n_sgout = iov_iter_npages(out_iov, INT_MAX) + 1 +
+				  prot->tail_size;
 		else
 			n_sgout = sg_nents(out_sg);
 		n_sgin = skb_nsg(skb, rxm->offset + prot->prepend_size,
@@ -1495,11 +1499,19 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			sg_set_buf(&sgout[0], aad, prot->aad_size);
 
 			*chunk = 0;
-			err = tls_setup_from_iter(sk, out_iov, data_len,
+			err = tls_setup_from_iter(sk, out_iov,
+						  data_len - prot->tail_size,
 						  &pages, chunk, &sgout[1],
-						  (n_sgout - 1));
+						  (n_sgout - 1 - prot->tail_size));
 			if (err < 0)
 				goto fallback_to_reg_recv;
+
+			if (prot->tail_size) {
+				sg_unmark_end(&sgout[pages]);
+				sg_set_buf(&sgout[pages + 1], &ctx->tail,
+					   prot->tail_size);
+				sg_mark_end(&sgout[pages + 1]);
+			}
 		} else if (out_sg) {
 			memcpy(sgout, out_sg, n_sgout * sizeof(*sgout));
 		} else {
@@ -1548,22 +1560,55 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 		if (!ctx->decrypted) {
 			err = decrypt_internal(sk, skb, dest, NULL, chunk, zc,
 					       async);
-			if (err < 0) {
-				if (err == -EINPROGRESS)
-					tls_advance_record_sn(sk, prot,
-							      &tls_ctx->rx);
-				else if (err == -EBADMSG)
+			if (err < 0 && err != -EINPROGRESS) {
+				if (err == -EBADMSG)
 					TLS_INC_STATS(sock_net(sk),
 						      LINUX_MIB_TLSDECRYPTERROR);
 				return err;
 			}
+
+			/* A TLS 1.3 record turned out to be padded or not
+			 * to carry data, so what was written to the user
+			 * buffer is not the payload. The ciphertext is still
+			 * intact in the skb, decrypt it again in place.
+			 */
+			if (*zc && prot->version == TLS_1_3_VERSION &&
+			    ctx->tail != TLS_RECORD_TYPE_DATA) {
+				TLS_INC_STATS(sock_net(sk),
+					      LINUX_MIB_TLSRXDECRYPTRETRY);
+				iov_iter_revert(dest, *chunk);
+				*zc = false;
+				err = decrypt_internal(sk, skb, NULL, NULL,
+						       chunk, zc, false);
+				if (err < 0) {
+					if (err == -EBADMSG)
+						TLS_INC_STATS(sock_net(sk),
+							      LINUX_MIB_TLSDECRYPTERROR);
+					return err;
+				}
+			}
+
+			TLS_INC_STATS(sock_net(sk), *zc ?
+				      LINUX_MIB_TLSRXDECRYPTZC :
+				      LINUX_MIB_TLSRXDECRYPTCOPY);
+
+			if (err == -EINPROGRESS) {
+				tls_advance_record_sn(sk, prot, &tls_ctx->rx);
+				return err;
+			}
 		} else {
 			*zc = false;
 		}
 
-		pad = padding_length(ctx, prot, skb);
-		if (pad < 0)
-			return pad;
+		if (*zc && prot->version == TLS_1_3_VERSION) {
+			/* the tail was checked above, there is no padding */
+			ctx->control = ctx->tail;
+			pad = 0;
+		} else {
+			pad = padding_length(ctx, prot, skb);
+			if (pad < 0)
+				return pad;
+		}
 
 		rxm->full_len -= pad;
 		rxm->offset += prot->prepend_size;
@@ -1803,9 +1848,12 @@ int tls_sw_recvmsg(struct sock *sk,
 
 		to_decrypt = rxm->full_len - prot->overhead_size;
 
+		/* TLS 1.3 records always claim to be data in the clear
+		 * header, decrypt_skb_update() falls back to a copy if the
+		 * inner type says otherwise.
+		 */
 		if (to_decrypt <= len && !is_kvec && !is_peek &&
-		    ctx->control == TLS_RECORD_TYPE_DATA &&
-		    prot->version != TLS_1_3_VERSION)
+		    ctx->control == TLS_RECORD_TYPE_DATA)
 			zc = true;
 
 		/* Do not use async mode if record is non-data */
@@ -22,6 +22,7 @@
 #include <linux/net.h>
 #include <linux/netdevice.h>
 #include <linux/rculist.h>
+#include <net/busy_poll.h>
 #include <net/xdp_sock.h>
 #include <net/xdp.h>
 
@@ -209,6 +210,8 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 	if (xs->dev != xdp->rxq->dev || xs->queue_id != xdp->rxq->queue_index)
 		return -EINVAL;
 
+	__sk_mark_napi_id_once(&xs->sk, xdp->rxq->napi_id);
+
 	len = xdp->data_end - xdp->data;
 
 	return (xdp->rxq->mem.type == MEM_TYPE_ZERO_COPY) ?
@@ -238,6 +241,8 @@ int xsk_generic_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 		goto out_unlock;
 	}
 
+	__sk_mark_napi_id_once(&xs->sk, xdp->rxq->napi_id);
+
 	if (!xskq_cons_peek_addr(xs->umem->fq, &addr, xs->umem) ||
 	    len > xs->umem->chunk_size_nohr - XDP_PACKET_HEADROOM) {
 		err = -ENOSPC;
@@ -371,11 +376,55 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Like dev_direct_xmit(), but hands the whole list to the driver under a
+ * single tx lock so that it only has to kick the hardware for the last one.
+ * Anything the driver did not take is freed, which completes it as if it
+ * had been sent.
+ */
+static int xsk_direct_xmit_list(struct sk_buff *skb, u16 queue_id)
+{
+	struct net_device *dev = skb->dev;
+	struct netdev_queue *txq;
+	int ret = NETDEV_TX_BUSY;
+	bool again = false;
+
+	if (unlikely(!netif_running(dev) ||
+		     !netif_carrier_ok(dev))) {
+		atomic_long_inc(&dev->tx_dropped);
+		kfree_skb_list(skb);
+		return NET_XMIT_DROP;
+	}
+
+	skb = validate_xmit_skb_list(skb, dev, &again);
+	if (unlikely(!skb)) {
+		atomic_long_inc(&dev->tx_dropped);
+		return NET_XMIT_DROP;
+	}
+
+	txq = netdev_get_tx_queue(dev, queue_id);
+
+	local_bh_disable();
+
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	if (!netif_xmit_frozen_or_drv_stopped(txq))
+		skb = dev_hard_start_xmit(skb, dev, txq, &ret);
+	HARD_TX_UNLOCK(dev, txq);
+
+	local_bh_enable();
+
+	if (skb) {
+		kfree_skb_list(skb);
+		return NETDEV_TX_BUSY;
+	}
+
+	return ret;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
+	struct sk_buff *head = NULL, **tail = &head;
 	u32 max_batch = TX_BATCH_SIZE;
-	bool sent_frame = false;
 	struct xdp_desc desc;
 	struct sk_buff *skb;
 	int err = 0;
@@ -392,14 +441,14 @@ static int xsk_generic_xmit(struct sock *sk)
 
 		if (max_batch-- == 0) {
 			err = -EAGAIN;
-			goto out;
+			break;
 		}
 
 		len = desc.len;
 		skb = sock_alloc_send_skb(sk, len, 1, &err);
 		if (unlikely(!skb)) {
 			err = -EAGAIN;
-			goto out;
+			break;
 		}
 
 		skb_put(skb, len);
@@ -413,45 +462,96 @@ static int xsk_generic_xmit(struct sock *sk)
 		 */
 		if (unlikely(err) || xskq_prod_reserve(xs->umem->cq)) {
 			kfree_skb(skb);
-			goto out;
+			break;
 		}
 
 		skb->dev = xs->dev;
 		skb->priority = sk->sk_priority;
 		skb->mark = sk->sk_mark;
+		skb_set_queue_mapping(skb, xs->queue_id);
 		skb_shinfo(skb)->destructor_arg = (void *)(long)desc.addr;
 		skb->destructor = xsk_destruct_skb;
 
-		err = dev_direct_xmit(skb, xs->queue_id);
 		xskq_cons_release(xs->tx);
+		*tail = skb;
+		tail = &skb->next;
+	}
+
+	if (head) {
+		int ret = xsk_direct_xmit_list(head, xs->queue_id);
+
 		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP || err == NETDEV_TX_BUSY) {
-			/* SKB completed but not sent */
+		if (ret == NET_XMIT_DROP || ret == NETDEV_TX_BUSY)
+			/* SKBs completed but not sent */
 			err = -EBUSY;
-			goto out;
-		}
 
-		sent_frame = true;
+		sk->sk_write_space(sk);
 	}
 
 out:
-	if (sent_frame)
-		sk->sk_write_space(sk);
 
 	mutex_unlock(&xs->mutex);
 	return err;
 }
 
-static int __xsk_sendmsg(struct sock *sk)
+#ifdef CONFIG_NET_RX_BUSY_POLL
+static bool xsk_busy_loop_end(void *p, unsigned long start_time)
+{
+	struct xdp_sock *xs = p;
+
+	return (xs->rx && !xskq_prod_is_empty(xs->rx)) ||
+	       sk_busy_loop_timeout(&xs->sk, start_time);
+}
+
+/* Spin on the NAPI of the bound queue for up to SO_BUSY_POLL usecs, or
+ * until something shows up on the rx ring. Returns true if the NAPI was
+ * run, which also drives the tx ring of zero-copy sockets.
+ */
+static bool xsk_busy_loop(struct xdp_sock *xs, bool nonblock)
+{
+	struct sock *sk = &xs->sk;
+
+	if (!sk_can_busy_loop(sk))
+		return false;
+
+	napi_busy_loop(READ_ONCE(sk->sk_napi_id),
+		       nonblock ? NULL : xsk_busy_loop_end, xs);
+
+	xs->busy_poll++;
+	if (xs->rx && !xskq_prod_is_empty(xs->rx))
+		xs->busy_poll_hits++;
+
+	return true;
+}
+#else
+static bool xsk_busy_loop(struct xdp_sock *xs, bool nonblock)
+{
+	return false;
+}
+#endif
+
+static int __xsk_sendmsg(struct sock *sk, bool busy_poll)
 {
 	struct xdp_sock *xs = xdp_sk(sk);
+	int err;
 
 	if (unlikely(!(xs->dev->flags & IFF_UP)))
 		return -ENETDOWN;
 	if (unlikely(!xs->tx))
 		return -ENOBUFS;
 
-	return xs->zc ? xsk_zc_xmit(xs) : xsk_generic_xmit(sk);
+	if (xs->zc) {
+		/* The busy loop ran the driver's NAPI, no need to kick it */
+		if (busy_poll && xsk_busy_loop(xs, false))
+			return 0;
+		return xsk_zc_xmit(xs);
+	}
+
+	err = xsk_generic_xmit(sk);
+	if (busy_poll)
+		xsk_busy_loop(xs, false);
+
+	return err;
 }
 
 static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
@@ -465,7 +565,31 @@ static int xsk_sendmsg(struct socket *sock, struct msghdr *m, size_t total_len)
 	if (unlikely(need_wait))
 		return -EOPNOTSUPP;
 
-	return __xsk_sendmsg(sk);
+	return __xsk_sendmsg(sk, true);
+}
+
+static int xsk_recvmsg(struct socket *sock, struct msghdr *m, size_t len,
+		       int flags)
+{
+	bool need_wait = !(flags & MSG_DONTWAIT);
+	struct sock *sk = sock->sk;
+	struct xdp_sock *xs = xdp_sk(sk);
+
+	if (unlikely(!xsk_is_bound(xs)))
+		return -ENXIO;
+	if (unlikely(!(xs->dev->flags & IFF_UP)))
+		return -ENETDOWN;
+	if (unlikely(!xs->rx))
+		return -ENOBUFS;
+	if (unlikely(need_wait))
+		return -EOPNOTSUPP;
+
+	if (xsk_busy_loop(xs, false))
+		return 0;
+
+	if (xs->zc)
+		return xsk_wakeup(xs, XDP_WAKEUP_RX);
+	return 0;
 }
 
 static __poll_t xsk_poll(struct file *file, struct socket *sock,
@@ -486,7 +610,7 @@ static __poll_t xsk_poll(struct file *file, struct socket *sock,
 			xsk_wakeup(xs, umem->need_wakeup);
 		else
 			/* Poll needs to drive Tx also in copy mode */
-			__xsk_sendmsg(sk);
+			__xsk_sendmsg(sk, false);
 	}
 
 	if (xs->rx && !xskq_prod_is_empty(xs->rx))
@@ -1098,7 +1222,7 @@ static const struct proto_ops xsk_proto_ops = {
 	.setsockopt	= xsk_setsockopt,
 	.getsockopt	= xsk_getsockopt,
 	.sendmsg	= xsk_sendmsg,
-	.recvmsg	= sock_no_recvmsg,
+	.recvmsg	= xsk_recvmsg,
 	.mmap		= xsk_mmap,
 	.sendpage	= sock_no_sendpage,
 };
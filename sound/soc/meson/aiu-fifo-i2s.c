@@ -27,6 +27,7 @@ static struct snd_pcm_hardware fifo_i2s_pcm = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED |
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
 		 SNDRV_PCM_INFO_PAUSE),
 	.formats = AIU_FORMATS,
 	.rate_min = 5512,
@@ -38,8 +39,8 @@ static struct snd_pcm_hardware fifo_i2s_pcm = {
 	.periods_min = 2,
 	.periods_max = UINT_MAX,
 
-	/* No real justification for this */
-	.buffer_bytes_max = 1 * 1024 * 1024,
+	/* Anything above the preallocation is allocated on demand */
+	.buffer_bytes_max = AIU_FIFO_BUFFER_MAX,
 };
 
 static int aiu_fifo_i2s_trigger(struct snd_pcm_substream *substream, int cmd,
@@ -125,7 +126,6 @@ const struct snd_soc_dai_ops aiu_fifo_i2s_dai_ops = {
 	.trigger	= aiu_fifo_i2s_trigger,
 	.prepare	= aiu_fifo_i2s_prepare,
 	.hw_params	= aiu_fifo_i2s_hw_params,
-	.hw_free	= aiu_fifo_hw_free,
 	.startup	= aiu_fifo_startup,
 	.shutdown	= aiu_fifo_shutdown,
 };
@@ -31,6 +31,7 @@ static struct snd_pcm_hardware fifo_spdif_pcm = {
 	.info = (SNDRV_PCM_INFO_INTERLEAVED |
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
 		 SNDRV_PCM_INFO_PAUSE),
 	.formats = AIU_FORMATS,
 	.rate_min = 5512,
@@ -42,8 +43,8 @@ static struct snd_pcm_hardware fifo_spdif_pcm = {
 	.periods_min = 2,
 	.periods_max = UINT_MAX,
 
-	/* No real justification for this */
-	.buffer_bytes_max = 1 * 1024 * 1024,
+	/* Anything above the preallocation is allocated on demand */
+	.buffer_bytes_max = AIU_FIFO_BUFFER_MAX,
 };
 
 static void fifo_spdif_dcu_enable(struct snd_soc_component *component,
@@ -158,7 +159,6 @@ const struct snd_soc_dai_ops aiu_fifo_spdif_dai_ops = {
 	.trigger	= fifo_spdif_trigger,
 	.prepare	= fifo_spdif_prepare,
 	.hw_params	= fifo_spdif_hw_params,
-	.hw_free	= aiu_fifo_hw_free,
 	.startup	= aiu_fifo_startup,
 	.shutdown	= aiu_fifo_shutdown,
 };
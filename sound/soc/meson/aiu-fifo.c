@@ -100,11 +100,6 @@ int aiu_fifo_hw_params(struct snd_pcm_substream *substream,
 	struct snd_soc_component *component = dai->component;
 	struct aiu_fifo *fifo = dai->playback_dma_data;
 	dma_addr_t end;
-	int ret;
-
-	ret = snd_pcm_lib_malloc_pages(substream, params_buffer_bytes(params));
-	if (ret < 0)
-		return ret;
 
 	/* Setup the fifo boundaries */
 	end = runtime->dma_addr + runtime->dma_bytes - fifo->fifo_block;
@@ -122,13 +117,19 @@ int aiu_fifo_hw_params(struct snd_pcm_substream *substream,
 				      FIELD_PREP(AIU_MEM_MASK_CH_RD, 0xff) |
 				      FIELD_PREP(AIU_MEM_MASK_CH_MEM, 0xff));
 
-	return 0;
-}
+	/*
+	 * Without period wakeups, userspace schedules itself from a timer and
+	 * relies on the read pointer only, keep the fifo irq masked then.
+	 */
+	if (runtime->no_period_wakeup != fifo->irq_masked) {
+		if (runtime->no_period_wakeup)
+			disable_irq(fifo->irq);
+		else
+			enable_irq(fifo->irq);
+		fifo->irq_masked = runtime->no_period_wakeup;
+	}
 
-int aiu_fifo_hw_free(struct snd_pcm_substream *substream,
-		     struct snd_soc_dai *dai)
-{
-	return snd_pcm_lib_free_pages(substream);
+	return 0;
 }
 
 static irqreturn_t aiu_fifo_isr(int irq, void *dev_id)
@@ -168,6 +169,7 @@ int aiu_fifo_startup(struct snd_pcm_substream *substream,
 	if (ret)
 		return ret;
 
+	fifo->irq_masked = false;
 	ret = request_irq(fifo->irq, aiu_fifo_isr, 0, dev_name(dai->dev),
 			  substream);
 	if (ret)
@@ -181,6 +183,8 @@ void aiu_fifo_shutdown(struct snd_pcm_substream *substream,
 {
 	struct aiu_fifo *fifo = dai->playback_dma_data;
 
+	if (fifo->irq_masked)
+		enable_irq(fifo->irq);
 	free_irq(fifo->irq, substream);
 	clk_disable_unprepare(fifo->pclk);
 }
@@ -192,11 +196,11 @@ int aiu_fifo_pcm_new(struct snd_soc_pcm_runtime *rtd,
 		rtd->pcm->streams[SNDRV_PCM_STREAM_PLAYBACK].substream;
 	struct snd_card *card = rtd->card->snd_card;
 	struct aiu_fifo *fifo = dai->playback_dma_data;
-	size_t size = fifo->pcm->buffer_bytes_max;
+	size_t max = fifo->pcm->buffer_bytes_max;
 
-	snd_pcm_lib_preallocate_pages(substream,
-				      SNDRV_DMA_TYPE_DEV,
-				      card->dev, size, size);
+	/* Larger buffers are allocated at hw_params, from CMA if available */
+	snd_pcm_set_managed_buffer(substream, SNDRV_DMA_TYPE_DEV, card->dev,
+				   min_t(size_t, AIU_FIFO_PREALLOC, max), max);
 
 	return 0;
 }
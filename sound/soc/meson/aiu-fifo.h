@@ -17,12 +17,16 @@ struct snd_soc_dai;
 struct snd_pcm_hw_params;
 struct platform_device;
 
+#define AIU_FIFO_PREALLOC	(1 * 1024 * 1024)
+#define AIU_FIFO_BUFFER_MAX	(16 * 1024 * 1024)
+
 struct aiu_fifo {
 	struct snd_pcm_hardware *pcm;
 	unsigned int mem_offset;
 	unsigned int fifo_block;
 	struct clk *pclk;
 	int irq;
+	bool irq_masked;
 };
 
 int aiu_fifo_dai_probe(struct snd_soc_dai *dai);
@@ -38,8 +42,6 @@ int aiu_fifo_prepare(struct snd_pcm_substream *substream,
 int aiu_fifo_hw_params(struct snd_pcm_substream *substream,
 		       struct snd_pcm_hw_params *params,
 		       struct snd_soc_dai *dai);
-int aiu_fifo_hw_free(struct snd_pcm_substream *substream,
-		     struct snd_soc_dai *dai);
 int aiu_fifo_startup(struct snd_pcm_substream *substream,
 		     struct snd_soc_dai *dai);
 void aiu_fifo_shutdown(struct snd_pcm_substream *substream,
@@ -27,6 +27,8 @@ static struct snd_pcm_hardware axg_fifo_hw = {
 		 SNDRV_PCM_INFO_MMAP |
 		 SNDRV_PCM_INFO_MMAP_VALID |
 		 SNDRV_PCM_INFO_BLOCK_TRANSFER |
+		 SNDRV_PCM_INFO_NO_PERIOD_WAKEUP |
+		 SNDRV_PCM_INFO_SYNC_START |
 		 SNDRV_PCM_INFO_PAUSE),
 
 	.formats = AXG_FIFO_FORMATS,
@@ -39,8 +41,8 @@ static struct snd_pcm_hardware axg_fifo_hw = {
 	.periods_min = 2,
 	.periods_max = UINT_MAX,
 
-	/* No real justification for this */
-	.buffer_bytes_max = 1 * 1024 * 1024,
+	/* Anything above the preallocation is allocated on demand */
+	.buffer_bytes_max = AXG_FIFO_BUFFER_MAX,
 };
 
 static struct snd_soc_dai *axg_fifo_dai(struct snd_pcm_substream *ss)
@@ -70,6 +72,12 @@ static void __dma_enable(struct axg_fifo *fifo,  bool enable)
 			   enable ? CTRL0_DMA_EN : 0);
 }
 
+/*
+ * Starting or stopping a fifo is a single register write so linked
+ * streams, such as a microphone capture and the TDM loopback capture of
+ * the playback it should cancel, are started within a few bus cycles of
+ * each other. Advertise it so userspace can rely on snd_pcm_link().
+ */
 int axg_fifo_pcm_trigger(struct snd_soc_component *component,
 			 struct snd_pcm_substream *ss, int cmd)
 {
@@ -107,6 +115,25 @@ snd_pcm_uframes_t axg_fifo_pcm_pointer(struct snd_soc_component *component,
 }
 EXPORT_SYMBOL_GPL(axg_fifo_pcm_pointer);
 
+snd_pcm_sframes_t axg_fifo_dai_delay(struct snd_pcm_substream *ss,
+				     struct snd_soc_dai *dai)
+{
+	struct axg_fifo *fifo = snd_soc_dai_get_drvdata(dai);
+	struct snd_pcm_runtime *runtime = ss->runtime;
+
+	/*
+	 * The pointer tracks the memory side of the fifo. On playback, the
+	 * frddr keeps its fifo full so up to its depth has been read from
+	 * memory but not played yet. On capture, the toddr only writes
+	 * to memory once the threshold is reached.
+	 */
+	if (ss->stream == SNDRV_PCM_STREAM_PLAYBACK)
+		return bytes_to_frames(runtime, fifo->depth);
+
+	return bytes_to_frames(runtime, fifo->threshold);
+}
+EXPORT_SYMBOL_GPL(axg_fifo_dai_delay);
+
 int axg_fifo_pcm_hw_params(struct snd_soc_component *component,
 			   struct snd_pcm_substream *ss,
 			   struct snd_pcm_hw_params *params)
@@ -133,6 +160,7 @@ int axg_fifo_pcm_hw_params(struct snd_soc_component *component,
 	 * - Half the period size
 	 */
 	threshold = min(period / 2, fifo->depth / 2);
+	fifo->threshold = threshold;
 
 	/*
 	 * With the threshold in bytes, register value is:
@@ -142,9 +170,13 @@ int axg_fifo_pcm_hw_params(struct snd_soc_component *component,
 	regmap_field_write(fifo->field_threshold,
 			   threshold ? threshold - 1 : 0);
 
-	/* Enable block count irq */
+	/*
+	 * Enable block count irq, unless the application relies on timers
+	 * and the pointer only
+	 */
 	regmap_update_bits(fifo->map, FIFO_CTRL0,
 			   CTRL0_INT_EN(FIFO_INT_COUNT_REPEAT),
+			   runtime->no_period_wakeup ? 0 :
 			   CTRL0_INT_EN(FIFO_INT_COUNT_REPEAT));
 
 	return 0;
@@ -297,11 +329,22 @@ EXPORT_SYMBOL_GPL(axg_fifo_pcm_close);
 int axg_fifo_pcm_new(struct snd_soc_pcm_runtime *rtd, unsigned int type)
 {
 	struct snd_card *card = rtd->card->snd_card;
-	size_t size = axg_fifo_hw.buffer_bytes_max;
+	size_t max = axg_fifo_hw.buffer_bytes_max;
+	u32 size;
+
+	/*
+	 * The card may ask for a larger preallocation, for wide capture
+	 * streams which need a lot of buffering for example. Larger buffers
+	 * are allocated at hw_params, from CMA when it is available.
+	 */
+	if (device_property_read_u32(card->dev, "amlogic,fifo-prealloc-bytes",
+				     &size))
+		size = AXG_FIFO_PREALLOC;
+	size = clamp_t(u32, size, AXG_FIFO_BURST, max);
 
 	snd_pcm_set_managed_buffer(rtd->pcm->streams[type].substream,
 				   SNDRV_DMA_TYPE_DEV, card->dev,
-				   size, size);
+				   size, max);
 	return 0;
 }
 EXPORT_SYMBOL_GPL(axg_fifo_pcm_new);
@@ -31,6 +31,8 @@ struct snd_soc_pcm_runtime;
 					 SNDRV_PCM_FMTBIT_IEC958_SUBFRAME_LE)
 
 #define AXG_FIFO_BURST			8
+#define AXG_FIFO_PREALLOC		(1 * 1024 * 1024)
+#define AXG_FIFO_BUFFER_MAX		(16 * 1024 * 1024)
 
 #define FIFO_INT_ADDR_FINISH		BIT(0)
 #define FIFO_INT_ADDR_INT		BIT(1)
@@ -67,6 +69,7 @@ struct axg_fifo {
 	struct reset_control *arb;
 	struct regmap_field *field_threshold;
 	unsigned int depth;
+	unsigned int threshold;
 	int irq;
 };
 
@@ -92,6 +95,8 @@ snd_pcm_uframes_t axg_fifo_pcm_pointer(struct snd_soc_component *component,
 				       struct snd_pcm_substream *ss);
 int axg_fifo_pcm_trigger(struct snd_soc_component *component,
 			 struct snd_pcm_substream *ss, int cmd);
+snd_pcm_sframes_t axg_fifo_dai_delay(struct snd_pcm_substream *ss,
+				     struct snd_soc_dai *dai);
 
 int axg_fifo_pcm_new(struct snd_soc_pcm_runtime *rtd, unsigned int type);
 int axg_fifo_probe(struct platform_device *pdev);
@@ -86,6 +86,7 @@ static int axg_frddr_pcm_new(struct snd_soc_pcm_runtime *rtd,
 static const struct snd_soc_dai_ops axg_frddr_ops = {
 	.startup	= axg_frddr_dai_startup,
 	.shutdown	= axg_frddr_dai_shutdown,
+	.delay		= axg_fifo_dai_delay,
 };
 
 static struct snd_soc_dai_driver axg_frddr_dai_drv = {
@@ -159,6 +160,7 @@ static const struct snd_soc_dai_ops g12a_frddr_ops = {
 	.prepare	= g12a_frddr_dai_prepare,
 	.startup	= axg_frddr_dai_startup,
 	.shutdown	= axg_frddr_dai_shutdown,
+	.delay		= axg_fifo_dai_delay,
 };
 
 static struct snd_soc_dai_driver g12a_frddr_dai_drv = {
@@ -83,8 +83,14 @@ struct axg_pdm_filters {
 	struct axg_pdm_lpf lpf[PDM_LPF_NUM];
 };
 
+enum {
+	PDM_PROFILE_FULL = 0,
+	PDM_PROFILE_LOW_POWER,
+	PDM_PROFILE_NUM,
+};
+
 struct axg_pdm_cfg {
-	const struct axg_pdm_filters *filters;
+	const struct axg_pdm_filters *filters[PDM_PROFILE_NUM];
 	unsigned int sys_rate;
 };
 
@@ -94,8 +100,17 @@ struct axg_pdm {
 	struct clk *dclk;
 	struct clk *sysclk;
 	struct clk *pclk;
+	/* Protects the profile against concurrent stream setup */
+	struct mutex lock;
+	unsigned int profile;
+	unsigned int rate;
 };
 
+static const struct axg_pdm_filters *axg_pdm_filters(struct axg_pdm *priv)
+{
+	return priv->cfg->filters[priv->profile];
+}
+
 static void axg_pdm_enable(struct regmap *map)
 {
 	/* Reset AFIFO */
@@ -147,7 +162,7 @@ static int axg_pdm_trigger(struct snd_pcm_substream *substream, int cmd,
 
 static unsigned int axg_pdm_get_os(struct axg_pdm *priv)
 {
-	const struct axg_pdm_filters *filters = priv->cfg->filters;
+	const struct axg_pdm_filters *filters = axg_pdm_filters(priv);
 	unsigned int os = filters->hcic.ds;
 	int i;
 
@@ -220,12 +235,38 @@ static void axg_pdm_set_channel_mask(struct axg_pdm *priv,
 			   PDM_CTRL_CHAN_EN(mask));
 }
 
+static int axg_pdm_set_clocks(struct axg_pdm *priv, struct device *dev,
+			      unsigned int rate)
+{
+	unsigned int os = axg_pdm_get_os(priv);
+	int ret;
+
+	ret = axg_pdm_set_sysclk(priv, os, rate);
+	if (ret) {
+		dev_err(dev, "failed to set system clock\n");
+		return ret;
+	}
+
+	ret = clk_set_rate(priv->dclk, rate * os);
+	if (ret) {
+		dev_err(dev, "failed to set dclk\n");
+		return ret;
+	}
+
+	ret = axg_pdm_set_sample_pointer(priv);
+	if (ret) {
+		dev_err(dev, "invalid clock setting\n");
+		return ret;
+	}
+
+	return 0;
+}
+
 static int axg_pdm_hw_params(struct snd_pcm_substream *substream,
 			     struct snd_pcm_hw_params *params,
 			     struct snd_soc_dai *dai)
 {
 	struct axg_pdm *priv = snd_soc_dai_get_drvdata(dai);
-	unsigned int os = axg_pdm_get_os(priv);
 	unsigned int rate = params_rate(params);
 	unsigned int val;
 	int ret;
@@ -244,23 +285,13 @@ static int axg_pdm_hw_params(struct snd_pcm_substream *substream,
 
 	regmap_update_bits(priv->map, PDM_CTRL, PDM_CTRL_OUT_MODE, val);
 
-	ret = axg_pdm_set_sysclk(priv, os, rate);
-	if (ret) {
-		dev_err(dai->dev, "failed to set system clock\n");
-		return ret;
-	}
-
-	ret = clk_set_rate(priv->dclk, rate * os);
-	if (ret) {
-		dev_err(dai->dev, "failed to set dclk\n");
+	mutex_lock(&priv->lock);
+	ret = axg_pdm_set_clocks(priv, dai->dev, rate);
+	if (!ret)
+		priv->rate = rate;
+	mutex_unlock(&priv->lock);
+	if (ret)
 		return ret;
-	}
-
-	ret = axg_pdm_set_sample_pointer(priv);
-	if (ret) {
-		dev_err(dai->dev, "invalid clock setting\n");
-		return ret;
-	}
 
 	axg_pdm_set_channel_mask(priv, params_channels(params));
 
@@ -290,6 +321,10 @@ static void axg_pdm_shutdown(struct snd_pcm_substream *substream,
 {
 	struct axg_pdm *priv = snd_soc_dai_get_drvdata(dai);
 
+	mutex_lock(&priv->lock);
+	priv->rate = 0;
+	mutex_unlock(&priv->lock);
+
 	axg_pdm_filters_enable(priv->map, false);
 	clk_disable_unprepare(priv->dclk);
 }
@@ -303,7 +338,7 @@ static const struct snd_soc_dai_ops axg_pdm_dai_ops = {
 
 static void axg_pdm_set_hcic_ctrl(struct axg_pdm *priv)
 {
-	const struct axg_pdm_hcic *hcic = &priv->cfg->filters->hcic;
+	const struct axg_pdm_hcic *hcic = &axg_pdm_filters(priv)->hcic;
 	unsigned int val;
 
 	val = PDM_HCIC_CTRL1_STAGE_NUM(hcic->steps);
@@ -321,7 +356,7 @@ static void axg_pdm_set_hcic_ctrl(struct axg_pdm *priv)
 
 static void axg_pdm_set_lpf_ctrl(struct axg_pdm *priv, unsigned int index)
 {
-	const struct axg_pdm_lpf *lpf = &priv->cfg->filters->lpf[index];
+	const struct axg_pdm_lpf *lpf = &axg_pdm_filters(priv)->lpf[index];
 	unsigned int offset = index * regmap_get_reg_stride(priv->map)
 		+ PDM_F1_CTRL;
 	unsigned int val;
@@ -339,7 +374,7 @@ static void axg_pdm_set_lpf_ctrl(struct axg_pdm *priv, unsigned int index)
 
 static void axg_pdm_set_hpf_ctrl(struct axg_pdm *priv)
 {
-	const struct axg_pdm_hpf *hpf = &priv->cfg->filters->hpf;
+	const struct axg_pdm_hpf *hpf = &axg_pdm_filters(priv)->hpf;
 	unsigned int val;
 
 	val = PDM_HPF_OUT_FACTOR(hpf->out_factor);
@@ -353,7 +388,7 @@ static void axg_pdm_set_hpf_ctrl(struct axg_pdm *priv)
 
 static int axg_pdm_set_lpf_filters(struct axg_pdm *priv)
 {
-	const struct axg_pdm_lpf *lpf = priv->cfg->filters->lpf;
+	const struct axg_pdm_lpf *lpf = axg_pdm_filters(priv)->lpf;
 	unsigned int count = 0;
 	int i, j;
 
@@ -378,6 +413,14 @@ static int axg_pdm_set_lpf_filters(struct axg_pdm *priv)
 	return 0;
 }
 
+static int axg_pdm_load_filters(struct axg_pdm *priv)
+{
+	axg_pdm_set_hcic_ctrl(priv);
+	axg_pdm_set_hpf_ctrl(priv);
+
+	return axg_pdm_set_lpf_filters(priv);
+}
+
 static int axg_pdm_dai_probe(struct snd_soc_dai *dai)
 {
 	struct axg_pdm *priv = snd_soc_dai_get_drvdata(dai);
@@ -412,10 +455,7 @@ static int axg_pdm_dai_probe(struct snd_soc_dai *dai)
 	regmap_update_bits(priv->map, PDM_CTRL, PDM_CTRL_BYPASS_MODE, 0);
 
 	/* Load filter settings */
-	axg_pdm_set_hcic_ctrl(priv);
-	axg_pdm_set_hpf_ctrl(priv);
-
-	ret = axg_pdm_set_lpf_filters(priv);
+	ret = axg_pdm_load_filters(priv);
 	if (ret) {
 		dev_err(dai->dev, "invalid filter configuration\n");
 		goto err_sysclk;
@@ -440,6 +480,84 @@ static int axg_pdm_dai_remove(struct snd_soc_dai *dai)
 	return 0;
 }
 
+static const char * const axg_pdm_profile_texts[] = {
+	"Full", "Low Power",
+};
+
+static SOC_ENUM_SINGLE_EXT_DECL(axg_pdm_profile_enum, axg_pdm_profile_texts);
+
+static int axg_pdm_profile_get(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct axg_pdm *priv = snd_soc_component_get_drvdata(component);
+
+	ucontrol->value.enumerated.item[0] = priv->profile;
+
+	return 0;
+}
+
+static int axg_pdm_profile_put(struct snd_kcontrol *kcontrol,
+			       struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *component =
+		snd_soc_kcontrol_component(kcontrol);
+	struct axg_pdm *priv = snd_soc_component_get_drvdata(component);
+	unsigned int profile = ucontrol->value.enumerated.item[0];
+	unsigned int ctrl, old;
+	int ret = 0, changed = 0;
+
+	if (profile >= PDM_PROFILE_NUM || !priv->cfg->filters[profile])
+		return -EINVAL;
+
+	mutex_lock(&priv->lock);
+
+	if (profile == priv->profile)
+		goto out;
+
+	old = priv->profile;
+	priv->profile = profile;
+	changed = 1;
+
+	/* Not streaming: the clocks are set by the next hw_params */
+	if (!priv->rate) {
+		ret = axg_pdm_load_filters(priv);
+		goto out;
+	}
+
+	/*
+	 * While streaming, pause the converter long enough to load the new
+	 * filters and oversampling rate. The stream itself keeps running,
+	 * only a few samples are lost in the switch.
+	 */
+	regmap_read(priv->map, PDM_CTRL, &ctrl);
+	axg_pdm_disable(priv->map);
+
+	ret = axg_pdm_load_filters(priv);
+	if (!ret)
+		ret = axg_pdm_set_clocks(priv, component->dev, priv->rate);
+
+	if (ret) {
+		priv->profile = old;
+		axg_pdm_load_filters(priv);
+		axg_pdm_set_clocks(priv, component->dev, priv->rate);
+		changed = 0;
+	}
+
+	if (ctrl & PDM_CTRL_EN)
+		axg_pdm_enable(priv->map);
+
+out:
+	mutex_unlock(&priv->lock);
+	return ret ? ret : changed;
+}
+
+static const struct snd_kcontrol_new axg_pdm_controls[] = {
+	SOC_ENUM_EXT("PDM Filter Profile", axg_pdm_profile_enum,
+		     axg_pdm_profile_get, axg_pdm_profile_put),
+};
+
 static struct snd_soc_dai_driver axg_pdm_dai_drv = {
 	.name = "PDM",
 	.capture = {
@@ -457,7 +575,10 @@ static struct snd_soc_dai_driver axg_pdm_dai_drv = {
 	.remove		= axg_pdm_dai_remove,
 };
 
-static const struct snd_soc_component_driver axg_pdm_component_drv = {};
+static const struct snd_soc_component_driver axg_pdm_component_drv = {
+	.controls	= axg_pdm_controls,
+	.num_controls	= ARRAY_SIZE(axg_pdm_controls),
+};
 
 static const struct regmap_config axg_pdm_regmap_cfg = {
 	.reg_bits	= 32,
@@ -568,8 +689,51 @@ static const struct axg_pdm_filters axg_default_filters = {
 	},
 };
 
+/*
+ * Low power profile, meant for always-on voice detection: the HCIC only
+ * decimates by 4, for an OS of 32. This halves the dmic clock for a given
+ * rate, 512kHz at 16kHz, so most dmic can switch to their low power mode.
+ * The LPFs are the same as the default ones, only the HCIC gain follows
+ * its ds^steps growth.
+ */
+static const struct axg_pdm_filters axg_low_power_filters = {
+	.hcic = {
+		.shift = 0x0e,
+		.mult = 0x80,
+		.steps = 7,
+		.ds = 4,
+	},
+	.hpf = {
+		.out_factor = 0x8000,
+		.steps = 13,
+	},
+	.lpf = {
+		[0] = {
+			.ds = 2,
+			.round_mode = 1,
+			.tap = lpf1_default_tap,
+			.tap_num = ARRAY_SIZE(lpf1_default_tap),
+		},
+		[1] = {
+			.ds = 2,
+			.round_mode = 0,
+			.tap = lpf2_default_tap,
+			.tap_num = ARRAY_SIZE(lpf2_default_tap),
+		},
+		[2] = {
+			.ds = 2,
+			.round_mode = 1,
+			.tap = lpf3_default_tap,
+			.tap_num = ARRAY_SIZE(lpf3_default_tap)
+		},
+	},
+};
+
 static const struct axg_pdm_cfg axg_pdm_config = {
-	.filters = &axg_default_filters,
+	.filters = {
+		[PDM_PROFILE_FULL] = &axg_default_filters,
+		[PDM_PROFILE_LOW_POWER] = &axg_low_power_filters,
+	},
 	.sys_rate = 250000000,
 };
 
@@ -592,6 +756,7 @@ static int axg_pdm_probe(struct platform_device *pdev)
 	if (!priv)
 		return -ENOMEM;
 	platform_set_drvdata(pdev, priv);
+	mutex_init(&priv->lock);
 
 	priv->cfg = of_device_get_match_data(dev);
 	if (!priv->cfg) {
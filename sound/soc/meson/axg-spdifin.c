@@ -92,6 +92,29 @@ static unsigned int axg_spdifin_get_rate(struct axg_spdifin *priv)
 	return rate;
 }
 
+static unsigned int axg_spdifin_measure_rate(struct axg_spdifin *priv)
+{
+	unsigned int stat, maxw;
+
+	regmap_read(priv->map, SPDIFIN_STAT0, &stat);
+	maxw = FIELD_GET(SPDIFIN_STAT0_MAXW, stat);
+
+	/* Not capturing anything */
+	if (!maxw)
+		return 0;
+
+	/*
+	 * The widest pulse of a biphase mark stream is the 3 half bits
+	 * pulse of the preambles, 128 half bits make a sample. The maximum
+	 * width is measured in reference clock cycles, so the measure is
+	 * only precise to a few per mille. It can't tell a drifting clock
+	 * from a nominal one but it does tell the rates the mode detection
+	 * does not know about.
+	 */
+	return DIV_ROUND_CLOSEST_ULL(3ULL * clk_get_rate(priv->refclk),
+				     128 * maxw);
+}
+
 static int axg_spdifin_prepare(struct snd_pcm_substream *substream,
 			       struct snd_soc_dai *dai)
 {
@@ -378,8 +401,41 @@ static int axg_spdifin_rate_lock_get(struct snd_kcontrol *kcontrol,
 		.name = xname,					\
 	}
 
+static int axg_spdifin_rate_measured_info(struct snd_kcontrol *kcontrol,
+					  struct snd_ctl_elem_info *uinfo)
+{
+	uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+	uinfo->count = 1;
+	uinfo->value.integer.min = 0;
+	uinfo->value.integer.max = 384000;
+
+	return 0;
+}
+
+static int axg_spdifin_rate_measured_get(struct snd_kcontrol *kcontrol,
+					 struct snd_ctl_elem_value *ucontrol)
+{
+	struct snd_soc_component *c = snd_kcontrol_chip(kcontrol);
+	struct axg_spdifin *priv = snd_soc_component_get_drvdata(c);
+
+	ucontrol->value.integer.value[0] = axg_spdifin_measure_rate(priv);
+
+	return 0;
+}
+
+#define AXG_SPDIFIN_MEASURED_RATE(xname)			\
+	{							\
+		.iface = SNDRV_CTL_ELEM_IFACE_PCM,		\
+		.access = (SNDRV_CTL_ELEM_ACCESS_READ |		\
+			   SNDRV_CTL_ELEM_ACCESS_VOLATILE),	\
+		.get = axg_spdifin_rate_measured_get,		\
+		.info = axg_spdifin_rate_measured_info,		\
+		.name = xname,					\
+	}
+
 static const struct snd_kcontrol_new axg_spdifin_controls[] = {
 	AXG_SPDIFIN_LOCK_RATE("Capture Rate Lock"),
+	AXG_SPDIFIN_MEASURED_RATE("Capture Rate Measured"),
 	SOC_DOUBLE("Capture Switch", SPDIFIN_CTRL0, 7, 6, 1, 1),
 	SOC_ENUM(SNDRV_CTL_NAME_IEC958("", CAPTURE, NONE) "Src",
 		 axg_spdifin_chsts_src_enum),
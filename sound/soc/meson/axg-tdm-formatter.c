@@ -45,7 +45,7 @@ int axg_tdm_formatter_set_channel_masks(struct regmap *map,
 		for (j = find_first_bit(&mask, 32);
 		     (j < 32) && ch;
 		     j = find_next_bit(&mask, 32, j + 1)) {
-			val |= 1 << j;
+			val |= BIT(j);
 			ch -= 1;
 		}
 
@@ -32,6 +32,21 @@ static unsigned int axg_tdm_slots_total(u32 *mask)
 	return slots;
 }
 
+static bool axg_tdm_slots_valid(u32 *mask, unsigned int slots)
+{
+	u32 used = 0;
+	int i;
+
+	if (!mask)
+		return true;
+
+	for (i = 0; i < AXG_TDM_NUM_LANES; i++)
+		used |= mask[i];
+
+	/* A slot past the frame width would never be transferred */
+	return !(used & ~GENMASK(slots - 1, 0));
+}
+
 int axg_tdm_set_tdm_slots(struct snd_soc_dai *dai, u32 *tx_mask,
 			  u32 *rx_mask, unsigned int slots,
 			  unsigned int slot_width)
@@ -53,6 +68,18 @@ int axg_tdm_set_tdm_slots(struct snd_soc_dai *dai, u32 *tx_mask,
 		return -EINVAL;
 	}
 
+	/* Each lane carries at most 32 slots per frame */
+	if (!slots || slots > 32) {
+		dev_err(dai->dev, "unsupported slot number: %u\n", slots);
+		return -EINVAL;
+	}
+
+	if (!axg_tdm_slots_valid(tx_mask, slots) ||
+	    !axg_tdm_slots_valid(rx_mask, slots)) {
+		dev_err(dai->dev, "slot mask exceeds the %u slots\n", slots);
+		return -EINVAL;
+	}
+
 	iface->slots = slots;
 
 	switch (slot_width) {
@@ -121,6 +121,7 @@ static const struct snd_soc_dai_ops axg_toddr_ops = {
 	.hw_params	= axg_toddr_dai_hw_params,
 	.startup	= axg_toddr_dai_startup,
 	.shutdown	= axg_toddr_dai_shutdown,
+	.delay		= axg_fifo_dai_delay,
 };
 
 static struct snd_soc_dai_driver axg_toddr_dai_drv = {
@@ -194,6 +195,7 @@ static const struct snd_soc_dai_ops g12a_toddr_ops = {
 	.hw_params	= axg_toddr_dai_hw_params,
 	.startup	= axg_toddr_dai_startup,
 	.shutdown	= axg_toddr_dai_shutdown,
+	.delay		= axg_fifo_dai_delay,
 };
 
 static struct snd_soc_dai_driver g12a_toddr_dai_drv = {